@@ -0,0 +1,86 @@
+// ble_adv_parser.h
+
+#ifndef BLE_ADV_PARSER_H
+#define BLE_ADV_PARSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Single pass decoder for BLE advertising data. The GAP discovery callback
+// decodes every advertisement once and hands the result to all scan
+// handlers. Pointers in the decoded struct point into the original
+// advertisement buffer. Pure C so it can be exercised off-target.
+
+#define BLE_ADV_MAX_UUID16        8
+#define BLE_ADV_MAX_UUID32        4
+#define BLE_ADV_MAX_UUID128       2
+#define BLE_ADV_MAX_SERVICE_DATA  3
+#define BLE_ADV_NAME_LEN          32
+
+// AD types (Bluetooth Assigned Numbers, Generic Access Profile)
+#define BLE_AD_FLAGS              0x01
+#define BLE_AD_INCOMP_UUID16      0x02
+#define BLE_AD_COMP_UUID16        0x03
+#define BLE_AD_INCOMP_UUID32      0x04
+#define BLE_AD_COMP_UUID32        0x05
+#define BLE_AD_INCOMP_UUID128     0x06
+#define BLE_AD_COMP_UUID128       0x07
+#define BLE_AD_SHORT_NAME         0x08
+#define BLE_AD_COMP_NAME          0x09
+#define BLE_AD_TX_POWER           0x0A
+#define BLE_AD_SERVICE_DATA16     0x16
+#define BLE_AD_APPEARANCE         0x19
+#define BLE_AD_MFG_DATA           0xFF
+
+typedef struct {
+    uint16_t uuid;
+    const uint8_t *data;
+    uint8_t len;
+} ble_adv_service_data_t;
+
+typedef struct {
+    uint8_t flags;
+    bool has_flags;
+
+    char name[BLE_ADV_NAME_LEN];            // Complete name, else shortened name, else empty
+    bool name_complete;
+
+    int8_t tx_power;
+    bool has_tx_power;
+
+    uint16_t appearance;
+    bool has_appearance;
+
+    uint16_t uuid16[BLE_ADV_MAX_UUID16];
+    uint8_t uuid16_count;
+    uint32_t uuid32[BLE_ADV_MAX_UUID32];
+    uint8_t uuid32_count;
+    uint8_t uuid128[BLE_ADV_MAX_UUID128][16];   // Little endian, as transmitted
+    uint8_t uuid128_count;
+
+    bool has_mfg;
+    uint16_t company_id;
+    const uint8_t *mfg_data;                // Bytes after the company ID
+    uint8_t mfg_len;
+
+    ble_adv_service_data_t service_data[BLE_ADV_MAX_SERVICE_DATA];
+    uint8_t service_data_count;
+
+    const uint8_t *raw;
+    uint8_t raw_len;
+    bool truncated;                         // A field ran past the end of the data
+} ble_adv_t;
+
+// Decode advertising data. Always fills out with whatever fields were
+// complete; returns false if the data was truncated or malformed.
+bool ble_adv_parse(const uint8_t *data, size_t len, ble_adv_t *out);
+
+// True when uuid is advertised as a 16-bit, 32-bit or Bluetooth base 128-bit UUID.
+bool ble_adv_has_service(const ble_adv_t *adv, uint32_t uuid);
+
+// If uuid128 (little endian) is derived from the Bluetooth base UUID, store its
+// 32-bit short form and return true.
+bool ble_uuid128_to_short(const uint8_t *uuid128, uint32_t *short_uuid);
+
+#endif // BLE_ADV_PARSER_H
@@ -0,0 +1,24 @@
+// ble_company_ids.h
+
+#ifndef BLE_COMPANY_IDS_H
+#define BLE_COMPANY_IDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bluetooth SIG company identifiers, as found at the start of manufacturer
+// specific data. The table is generated at build time from
+// scripts/ble_company_ids.csv by scripts/gen_ble_company_ids.py and indexed
+// directly by company ID, so a lookup is one array read and the table lives
+// in flash. Pure C so it can be exercised off-target.
+
+// Company name for an identifier, or NULL when it is not in the table.
+const char *ble_company_name(uint16_t company_id);
+
+// Like ble_company_name, but never NULL.
+const char *ble_company_label(uint16_t company_id);
+
+// Number of companies in the generated table.
+size_t ble_company_count(void);
+
+#endif // BLE_COMPANY_IDS_H
@@ -0,0 +1,89 @@
+// ble_device_table.h
+
+#ifndef BLE_DEVICE_TABLE_H
+#define BLE_DEVICE_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "core/ble_adv_parser.h"
+
+// BLE devices seen while scanning, keyed by address. The controller's
+// duplicate filter is off, so every advertisement lands here; the table
+// keeps per-device statistics and tells the caller when a device is new,
+// changed its payload or came back after being absent, so handlers only run
+// on those. Storage is allocated once and lookups use a bounded probe
+// window, evicting the least recently seen device when it is full. Pure C so
+// it can be exercised off-target.
+
+#define BLE_DEVICE_TABLE_DEFAULT_CAPACITY 128
+#define BLE_DEVICE_TABLE_MAX_CAPACITY     8192
+#define BLE_DEVICE_TABLE_DEFAULT_DEVICES  100     // Devices BLE_DEVICE_TABLE_DEFAULT_CAPACITY is sized for
+#define BLE_DEVICE_TABLE_MAX_DEVICES      (BLE_DEVICE_TABLE_MAX_CAPACITY * 4 / 5)
+#define BLE_DEVICE_TABLE_MAX_PROBE        16      // Slots inspected per lookup before evicting
+#define BLE_DEVICE_ABSENT_MS              30000   // Silence after which a device counts as returned
+#define BLE_DEVICE_EXPIRE_MS              300000  // Silence after which a device is dropped
+
+typedef enum {
+    BLE_DEVICE_SEEN = 0,    // Known device, same payload
+    BLE_DEVICE_NEW,
+    BLE_DEVICE_CHANGED,     // Advertising or scan response payload differs from the last one
+    BLE_DEVICE_RETURNED     // Seen again after BLE_DEVICE_ABSENT_MS of silence
+} ble_device_event_t;
+
+typedef struct {
+    bool in_use;
+    uint8_t addr_type;
+    uint8_t addr[6];
+    bool has_mfg;
+    uint16_t company_id;
+    int8_t rssi;                 // Last RSSI
+    int8_t rssi_min;
+    int8_t rssi_max;
+    int16_t rssi_avg_q4;         // Moving average, 1/16 dBm
+    uint16_t payload_changes;
+    uint32_t adv_hash;           // FNV-1a of the last advertising payload, 0 if none yet
+    uint32_t scan_rsp_hash;      // Same for scan responses, kept apart so they do not count as changes
+    uint32_t adv_count;
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+    char name[BLE_ADV_NAME_LEN];
+} ble_device_t;
+
+typedef struct {
+    ble_device_t *devices;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t adverts_seen;
+    uint32_t evictions;          // Devices recycled because their probe window was full
+    uint32_t expired;
+} ble_device_table_t;
+
+// Allocate storage for capacity devices (power of two). Returns false on a
+// bad capacity or when out of memory; the table is left empty in that case.
+bool ble_device_table_init(ble_device_table_t *table, uint32_t capacity);
+
+void ble_device_table_free(ble_device_table_t *table);
+
+// Smallest valid capacity that holds max_devices with a quarter of the slots
+// spare, so probe windows stay short. Clamped to the valid range.
+uint32_t ble_device_table_capacity_for(uint32_t max_devices);
+
+void ble_device_table_clear(ble_device_table_t *table);
+
+ble_device_t *ble_device_table_find(const ble_device_table_t *table, uint8_t addr_type, const uint8_t *addr);
+
+// Record one advertising report. Returns the device entry, or NULL if the
+// table is not initialized, and stores what happened in *event.
+ble_device_t *ble_device_table_update(ble_device_table_t *table, uint8_t addr_type, const uint8_t *addr,
+                                      int8_t rssi, bool scan_rsp, const ble_adv_t *adv,
+                                      uint32_t now_ms, ble_device_event_t *event);
+
+// Drop devices silent for longer than max_age_ms. Returns how many were dropped.
+uint32_t ble_device_table_expire(ble_device_table_t *table, uint32_t now_ms, uint32_t max_age_ms);
+
+// Fill order with indexes of used slots, most recently seen first. Returns
+// the number written.
+size_t ble_device_table_sort(const ble_device_table_t *table, uint32_t *order, size_t max);
+
+#endif // BLE_DEVICE_TABLE_H
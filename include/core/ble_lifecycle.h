@@ -0,0 +1,64 @@
+// ble_lifecycle.h
+
+#ifndef BLE_LIFECYCLE_H
+#define BLE_LIFECYCLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// When the BLE host and controller are up. Nothing is started at boot: the
+// first user brings the stack up, and once the last user is gone and the
+// stack has sat idle for the timeout it is torn down again so its heap goes
+// back to WiFi. Starting and stopping go through ops so the state machine
+// runs off-target with stubs. Callers serialize access. Pure C so it can be
+// exercised off-target.
+
+#define BLE_STACK_DEFAULT_IDLE_MS 60000
+
+typedef enum {
+    BLE_STACK_OFF = 0,
+    BLE_STACK_STARTING,
+    BLE_STACK_ON,
+    BLE_STACK_STOPPING
+} ble_stack_state_t;
+
+typedef struct {
+    int (*start)(void *ctx);     // Bring host and controller up, 0 on success
+    int (*stop)(void *ctx);      // Tear them down, 0 on success
+    void *ctx;
+} ble_lifecycle_ops_t;
+
+typedef struct {
+    ble_lifecycle_ops_t ops;
+    ble_stack_state_t state;
+    uint32_t users;
+    uint32_t idle_timeout_ms;
+    uint32_t idle_since_ms;      // When the last user left
+    uint32_t starts;
+    uint32_t stops;
+    uint32_t failures;
+} ble_lifecycle_t;
+
+void ble_lifecycle_init(ble_lifecycle_t *lc, const ble_lifecycle_ops_t *ops, uint32_t idle_timeout_ms);
+
+// Add a user, starting the stack if it is off. Returns 0, the start error,
+// or -1 if called while the stack is starting or stopping.
+int ble_lifecycle_acquire(ble_lifecycle_t *lc);
+
+// Drop a user. The stack stays up until ble_lifecycle_poll finds it idle.
+void ble_lifecycle_release(ble_lifecycle_t *lc, uint32_t now_ms);
+
+// Tear the stack down if nobody has used it for the idle timeout. Returns
+// true when it was stopped.
+bool ble_lifecycle_poll(ble_lifecycle_t *lc, uint32_t now_ms);
+
+// Tear the stack down now if it has no users. Returns true when it was stopped.
+bool ble_lifecycle_shutdown(ble_lifecycle_t *lc);
+
+// Time until ble_lifecycle_poll would stop the stack, 0 if due now,
+// UINT32_MAX if it is off or in use.
+uint32_t ble_lifecycle_idle_remaining_ms(const ble_lifecycle_t *lc, uint32_t now_ms);
+
+const char *ble_stack_state_name(ble_stack_state_t state);
+
+#endif // BLE_LIFECYCLE_H
@@ -0,0 +1,55 @@
+// ble_pcap.h
+
+#ifndef BLE_PCAP_H
+#define BLE_PCAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Rebuilds BLE advertising reports as link layer packets for pcap link type
+// 256 (LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR): a 10 byte pseudo header with
+// channel and signal, then access address, PDU header, PDU and CRC. The
+// controller strips the access address and CRC, so both are regenerated.
+// Pure C so it can be exercised off-target.
+
+#define BLE_PCAP_PHDR_LEN              10
+#define BLE_PCAP_MAX_ADV_DATA          31      // Legacy advertising
+#define BLE_PCAP_MAX_FRAME             (BLE_PCAP_PHDR_LEN + 4 + 2 + 6 + BLE_PCAP_MAX_ADV_DATA + 3)
+
+#define BLE_ADV_ACCESS_ADDRESS         0x8E89BED6
+#define BLE_ADV_CRC_INIT               0x555555
+#define BLE_PCAP_CHANNEL_UNKNOWN       -1
+
+// Pseudo header flags
+#define BLE_PHDR_FLAG_DEWHITENED       0x0001
+#define BLE_PHDR_FLAG_SIGNAL_VALID     0x0002
+#define BLE_PHDR_FLAG_NOISE_VALID      0x0004
+#define BLE_PHDR_FLAG_REF_AA_VALID     0x0010
+#define BLE_PHDR_FLAG_CHANNEL_ALIASED  0x0040
+#define BLE_PHDR_FLAG_CRC_CHECKED      0x0400
+#define BLE_PHDR_FLAG_CRC_VALID        0x0800
+
+// Advertising PDU types
+#define BLE_PDU_ADV_IND                0x0
+#define BLE_PDU_ADV_DIRECT_IND         0x1
+#define BLE_PDU_ADV_NONCONN_IND        0x2
+#define BLE_PDU_SCAN_RSP               0x4
+#define BLE_PDU_ADV_SCAN_IND           0x6
+
+// Link layer CRC over a PDU, as transmitted (least significant byte first).
+uint32_t ble_ll_crc(const uint8_t *pdu, size_t len, uint32_t crc_init);
+
+// Advertising PDU type for an HCI LE advertising report event type, or -1.
+int ble_pdu_type_from_report(uint8_t report_event_type);
+
+// Build one pcap record body. addr is the advertiser address and
+// direct_addr the target of directed adverts (may be NULL), both as NimBLE
+// stores them (little endian). rf_channel is the advertising channel (37-39)
+// or BLE_PCAP_CHANNEL_UNKNOWN. Returns the frame length, 0 if it does not fit
+// or the report is not a legacy advertising PDU.
+size_t ble_pcap_build_adv(uint8_t *out, size_t out_size, uint8_t report_event_type, bool random_addr,
+                          const uint8_t *addr, const uint8_t *direct_addr, const uint8_t *data, size_t len,
+                          int8_t rssi, int rf_channel);
+
+#endif // BLE_PCAP_H
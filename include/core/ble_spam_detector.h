@@ -0,0 +1,99 @@
+// ble_spam_detector.h
+
+#ifndef BLE_SPAM_DETECTOR_H
+#define BLE_SPAM_DETECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "core/ble_adv_parser.h"
+
+// Advertisement spam detector (popup/pairing floods from forged vendors).
+// Spam tools pick a fresh random address for almost every advertisement,
+// while real devices keep theirs for minutes. So the detector counts
+// previously unseen addresses per payload class (company ID or service UUID
+// plus the first payload bytes) in a count-min sketch over fixed windows,
+// keeping the heaviest classes as candidates. Memory is bounded no matter
+// how many devices or vendors are in the air. Pure C so it can be exercised
+// off-target.
+
+#define BLE_SPAM_SKETCH_DEPTH        4
+#define BLE_SPAM_SKETCH_WIDTH        256    // Counters per row (power of two)
+#define BLE_SPAM_ADDR_BITS           2048   // Address novelty bitmap per window (power of two)
+#define BLE_SPAM_CANDIDATES          4      // Heavy hitter classes kept per window
+#define BLE_SPAM_MAX_REPORTS         (BLE_SPAM_CANDIDATES + 1)
+
+#define BLE_SPAM_DEFAULT_WINDOW_MS   1000
+#define BLE_SPAM_DEFAULT_THRESHOLD   5      // New addresses per known spam class per window
+#define BLE_SPAM_DEFAULT_HOLDOFF_MS  10000  // Minimum time between reports of one spam type
+#define BLE_SPAM_FLOOD_FACTOR        4      // Thresholds needed for unknown classes and for all classes together
+
+typedef enum {
+    BLE_SPAM_GENERIC = 0,    // Address randomization flood without a known payload
+    BLE_SPAM_APPLE_POPUP,    // Apple proximity pairing (type 0x07), e.g. AppleJuice
+    BLE_SPAM_APPLE_ACTION,   // Apple nearby action (type 0x0F), e.g. Sour Apple
+    BLE_SPAM_SWIFT_PAIR,     // Microsoft Swift Pair beacons
+    BLE_SPAM_SAMSUNG,        // Samsung EasySetup
+    BLE_SPAM_FAST_PAIR,      // Google Fast Pair service data (0xFE2C)
+    BLE_SPAM_MULTI_VENDOR,   // Several of the above interleaved, none heavy on its own
+    BLE_SPAM_TYPE_COUNT
+} ble_spam_type_t;
+
+typedef enum {
+    BLE_SPAM_INTENSITY_LOW = 0,   // At or above the threshold
+    BLE_SPAM_INTENSITY_MEDIUM,    // 3x the threshold
+    BLE_SPAM_INTENSITY_HIGH       // 10x the threshold
+} ble_spam_intensity_t;
+
+typedef struct {
+    ble_spam_type_t type;
+    ble_spam_intensity_t intensity;
+    uint16_t company_id;        // Or service UUID for Fast Pair, 0 for address and multi-vendor floods
+    bool has_company;           // company_id is a manufacturer ID rather than a UUID
+    uint32_t addresses;         // New addresses seen for this class in the window
+    uint32_t adverts;           // All adverts in the window
+    uint32_t rate_per_sec;      // New addresses per second
+} ble_spam_report_t;
+
+typedef struct {
+    uint32_t key;
+    uint16_t count;
+    uint8_t type;               // ble_spam_type_t
+    uint16_t company_id;
+} ble_spam_candidate_t;
+
+typedef struct {
+    uint16_t sketch[BLE_SPAM_SKETCH_DEPTH][BLE_SPAM_SKETCH_WIDTH];
+    uint8_t addr_seen[2][BLE_SPAM_ADDR_BITS / 8];   // Current and previous window
+    uint8_t addr_current;
+    bool primed;                // A full window has passed, so new addresses really are new
+    ble_spam_candidate_t candidates[BLE_SPAM_CANDIDATES];
+    uint8_t candidate_count;
+    uint32_t window_start_ms;
+    uint32_t window_adverts;
+    uint32_t window_new_addresses;
+    uint32_t window_ms;
+    uint32_t threshold;
+    uint32_t holdoff_ms;
+    uint32_t last_report_ms[BLE_SPAM_TYPE_COUNT];
+    bool reported[BLE_SPAM_TYPE_COUNT];
+    uint32_t adverts_seen;
+    uint32_t detections;
+} ble_spam_detector_t;
+
+void ble_spam_detector_init(ble_spam_detector_t *det, uint32_t window_ms, uint32_t threshold, uint32_t holdoff_ms);
+
+// Feed one advertisement. When this closes a window, up to
+// BLE_SPAM_MAX_REPORTS detections are written to reports and their number
+// is returned.
+size_t ble_spam_detector_update(ble_spam_detector_t *det, const uint8_t *addr, const ble_adv_t *adv,
+                                uint32_t now_ms, ble_spam_report_t *reports);
+
+// Payload class of an advertisement, as used for counting. Returns the spam
+// type the payload would indicate and stores the class key and company ID.
+ble_spam_type_t ble_spam_classify(const ble_adv_t *adv, uint32_t *key, uint16_t *company_id);
+
+const char *ble_spam_type_name(ble_spam_type_t type);
+const char *ble_spam_intensity_name(ble_spam_intensity_t intensity);
+
+#endif // BLE_SPAM_DETECTOR_H
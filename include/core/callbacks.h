@@ -1,7 +1,16 @@
 #ifndef CALLBACKS_H
 #define CALLBACKS_H
+#include "esp_err.h"
 #include "esp_wifi_types.h"
 #include <esp_timer.h>
+#include "core/wps_set.h"
+#include "core/probe_tracker.h"
+
+// Length handed to the frame parsers: sig_len counts the trailing FCS, which
+// is only kept in the pcap
+static inline size_t wifi_frame_len(const wifi_promiscuous_pkt_t *pkt) {
+    return pkt->rx_ctrl.sig_len > 4 ? pkt->rx_ctrl.sig_len - 4 : 0;
+}
 
 void wifi_wps_detection_callback(void *buf, wifi_promiscuous_pkt_type_t type);
 void wifi_beacon_scan_callback(void* buf, wifi_promiscuous_pkt_type_t type);
@@ -11,22 +20,28 @@ void wifi_probe_scan_callback(void* buf, wifi_promiscuous_pkt_type_t type);
 void wifi_raw_scan_callback(void* buf, wifi_promiscuous_pkt_type_t type);
 void wifi_eapol_scan_callback(void* buf, wifi_promiscuous_pkt_type_t type);
 
-typedef enum {
-    WPS_MODE_NONE = 0,   // No WPS support
-    WPS_MODE_PBC,        // Push Button Configuration (PBC)
-    WPS_MODE_PIN         // PIN method (Display or Keypad)
-} wps_modes_t;
+// Clear the deauth/disassoc flood detector state before a new capture
+void wifi_deauth_detector_reset(void);
+
+// (Re)allocate the WPS table for capacity networks and forget previous results
+esp_err_t wifi_wps_set_reset(uint32_t capacity);
+
+// Probe request tracking (client -> probed SSIDs), fed by capture -probe and
+// scansta. The station list reads its probed SSIDs from here.
+#define PROBES_JSON_PATH "/mnt/ghostesp/scans/probes.json"
+esp_err_t wifi_probe_tracker_reset(void);
+void wifi_probe_tracker_feed(const wifi_promiscuous_pkt_t *pkt);
+const probe_tracker_t *wifi_probe_tracker_get(void);
+void wifi_probe_tracker_print(bool json, bool clusters);
 
-typedef struct {
-    char ssid[33];        // SSID (max 32 characters + null terminator)
-    uint8_t bssid[6];     // BSSID (MAC address)
-    bool wps_enabled;     // True if WPS is enabled
-    wps_modes_t wps_mode;  // WPS mode (PIN or PBC)
-} wps_network_t;
+// Forget pwnagotchis reported by a previous capture
+void wifi_pwn_table_reset(void);
 
+// Rogue AP / evil twin detection against an SSID->BSSID/security allowlist
+esp_err_t wifi_rogue_ap_load_allowlist(const char *path);
+void wifi_rogue_ap_callback(void *buf, wifi_promiscuous_pkt_type_t type);
 
-extern wps_network_t detected_wps_networks[MAX_WPS_NETWORKS];
-extern int detected_network_count;
+extern wps_set_t detected_wps_networks;
 extern esp_timer_handle_t stop_timer;
 extern int should_store_wps;
 static uint8_t router_ip[4];
@@ -0,0 +1,143 @@
+// cmd_registry.h
+
+#ifndef CMD_REGISTRY_H
+#define CMD_REGISTRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Command table for the console. Each command declares its options (flags,
+// integers with a range and default, strings, one-of choices) once, and the
+// parser, validation errors, help text and tab-completion candidates are all
+// derived from that declaration. Names are found through an FNV-1a hash over
+// a fixed open-addressed index, and help lists commands in the order they
+// were added. Specs are not copied, so they must outlive their registration.
+// Pure C so it can be exercised off-target.
+
+#define CMD_REGISTRY_MAX   64
+#define CMD_REGISTRY_SLOTS 128   // Power of two, at most half full
+#define CMD_MAX_OPTS       16
+#define CMD_MAX_POSITIONAL 8
+#define CMD_ERR_LEN        128
+#define CMD_MAX_ARGS       32
+
+// cmd_tokenize errors
+#define CMD_TOKENIZE_TOO_MANY     -1
+#define CMD_TOKENIZE_UNTERMINATED -2
+
+typedef enum {
+    CMD_OPT_FLAG = 0,
+    CMD_OPT_INT,
+    CMD_OPT_STRING,
+    CMD_OPT_CHOICE
+} cmd_opt_type_t;
+
+// cmd_opt_t flags
+#define CMD_OPT_ALONE          0x01  // Nothing else may be given with it
+#define CMD_OPT_VALUE_OPTIONAL 0x02  // The value may be left off, the default is used
+#define CMD_OPT_NO_DEFAULT     0x04  // Handler works the default out itself, help omits it
+
+// cmd_spec_t flags
+#define CMD_SPEC_RAW           0x01  // Handler parses argv itself, options are only documentation
+#define CMD_SPEC_NEEDS_OPTION  0x02  // At least one option must be given
+
+typedef struct {
+    const char *name;            // Including the dash, e.g. "-t"
+    cmd_opt_type_t type;
+    uint8_t flags;
+    const char *value_name;      // Shown in usage, defaults to the choices or "n"
+    const char *help;
+    int32_t min;                 // INT range, inclusive
+    int32_t max;
+    int32_t def;                 // INT default, CHOICE default index
+    const char *const *choices;  // CHOICE values, NULL terminated, matched ignoring case
+} cmd_opt_t;
+
+struct cmd_args;
+
+typedef void (*cmd_handler_t)(const struct cmd_args *args);
+typedef void (*cmd_raw_handler_t)(int argc, char **argv);
+
+typedef struct {
+    const char *name;
+    const char *summary;
+    const char *usage;           // Replaces the generated usage line when set
+    const char *positional;      // Usage text for positional arguments
+    uint8_t min_positional;
+    uint8_t max_positional;
+    uint8_t flags;
+    uint8_t opt_count;
+    const cmd_opt_t *opts;
+    cmd_handler_t run;           // Gets the parsed arguments
+    cmd_raw_handler_t run_raw;   // Used when run is NULL, gets argv once it has validated
+} cmd_spec_t;
+
+typedef struct cmd_args {
+    const cmd_spec_t *spec;
+    uint32_t present;            // Bit per option given
+    int32_t ival[CMD_MAX_OPTS];
+    const char *sval[CMD_MAX_OPTS];
+    const char *positional[CMD_MAX_POSITIONAL];
+    int positional_count;
+} cmd_args_t;
+
+typedef enum {
+    CMD_PARSE_OK = 0,
+    CMD_PARSE_HELP,              // --help was given
+    CMD_PARSE_ERROR
+} cmd_parse_result_t;
+
+typedef struct {
+    const cmd_spec_t *specs[CMD_REGISTRY_MAX];   // Registration order
+    uint32_t hashes[CMD_REGISTRY_MAX];
+    uint8_t index[CMD_REGISTRY_SLOTS];           // Entry + 1, 0 when empty
+    uint8_t count;
+} cmd_registry_t;
+
+void cmd_registry_init(cmd_registry_t *reg);
+
+// Returns false when the table is full, the name is taken or the spec
+// declares more than CMD_MAX_OPTS options.
+bool cmd_registry_add(cmd_registry_t *reg, const cmd_spec_t *spec);
+
+bool cmd_registry_remove(cmd_registry_t *reg, const char *name);
+
+const cmd_spec_t *cmd_registry_find(const cmd_registry_t *reg, const char *name);
+
+// Split a command line into argv in place, without allocating. Words are
+// separated by spaces or tabs; "double" and 'single' quotes group words and
+// may be empty, and a backslash takes the next character literally (inside
+// double quotes too). Returns argc, CMD_TOKENIZE_TOO_MANY or
+// CMD_TOKENIZE_UNTERMINATED. argv points into line.
+int cmd_tokenize(char *line, char **argv, int max_args);
+
+// Check argv (argv[0] is the command) against the spec. Values point into
+// argv. On CMD_PARSE_ERROR err holds a message starting with the command name.
+cmd_parse_result_t cmd_parse(const cmd_spec_t *spec, int argc, char **argv,
+                             cmd_args_t *out, char *err, size_t err_len);
+
+bool cmd_arg_given(const cmd_args_t *args, const char *opt);
+
+// Option value, or its default when it was not given
+int32_t cmd_arg_int(const cmd_args_t *args, const char *opt);
+
+// STRING value or NULL, CHOICE value or the default choice
+const char *cmd_arg_str(const cmd_args_t *args, const char *opt);
+
+// Usage line and full help block. Both behave like snprintf: the output is
+// truncated to len and the return value is the length it needed.
+size_t cmd_format_usage(const cmd_spec_t *spec, char *buf, size_t len);
+size_t cmd_format_help(const cmd_spec_t *spec, char *buf, size_t len);
+
+// Candidates for the last word of a partial command line: command names for
+// the first word, then the command's unused options, or the choices when
+// the word is the value of a CHOICE option. Fills up to max_out and returns
+// how many there were in total.
+size_t cmd_registry_complete(const cmd_registry_t *reg, const char *line,
+                             const char **out, size_t max_out);
+
+// Length of the prefix shared by all candidates
+size_t cmd_common_prefix_len(const char *const *cands, size_t count);
+
+#endif // CMD_REGISTRY_H
@@ -0,0 +1,69 @@
+// coex_scheduler.h
+
+#ifndef COEX_SCHEDULER_H
+#define COEX_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Time slicing between passive WiFi capture and BLE scanning. Time is cut
+// into fixed slots and each slot goes to the radio that is furthest behind
+// its share (smooth weighted round robin), so the shares hold over any
+// stretch of time and each radio's longest wait stays as short as the duty
+// cycles allow. Share not given to either radio is idle time. The caller
+// performs the switch and reports what it cost, so the statistics show the
+// duty cycle each radio really got. Pure C so it can be exercised off-target.
+
+#define COEX_DEFAULT_SLOT_MS   100
+#define COEX_MIN_SLOT_MS       20
+#define COEX_MAX_SLOT_MS       10000
+
+typedef enum {
+    COEX_RADIO_WIFI = 0,
+    COEX_RADIO_BLE,
+    COEX_RADIO_IDLE,
+    COEX_RADIO_COUNT
+} coex_radio_t;
+
+typedef struct {
+    uint32_t on_ms;          // Time the radio held the air
+    uint32_t switch_us;      // Time lost switching to it
+    uint32_t slots;          // Turns, consecutive slots count once
+    uint32_t max_gap_ms;     // Longest wait between two turns
+    uint32_t last_off_ms;
+    bool ever_on;
+} coex_radio_stats_t;
+
+typedef struct {
+    uint32_t slot_ms;
+    uint8_t weight[COEX_RADIO_COUNT];     // Percent
+    int32_t current[COEX_RADIO_COUNT];    // Round robin credit
+    coex_radio_t active;
+    bool running;
+    uint32_t start_ms;
+    uint32_t active_since_ms;
+    coex_radio_stats_t stats[COEX_RADIO_COUNT];
+} coex_scheduler_t;
+
+// Returns false if slot_ms is out of range or the shares add up to more
+// than 100 or to nothing.
+bool coex_scheduler_init(coex_scheduler_t *sched, uint32_t slot_ms, uint8_t wifi_pct, uint8_t ble_pct);
+
+// Close the running slot at now_ms and pick the radio for the next one.
+// The first call starts the schedule.
+coex_radio_t coex_scheduler_next(coex_scheduler_t *sched, uint32_t now_ms);
+
+// Charge the time spent switching to radio against its on time.
+void coex_scheduler_add_switch_cost(coex_scheduler_t *sched, coex_radio_t radio, uint32_t switch_us);
+
+// Statistics for radio up to now_ms, including the running slot or wait.
+void coex_scheduler_stats(const coex_scheduler_t *sched, coex_radio_t radio, uint32_t now_ms,
+                          coex_radio_stats_t *out);
+
+// Share of the time since the start that radio was really usable, in
+// tenths of a percent (on time minus switch cost).
+uint32_t coex_scheduler_effective_permille(const coex_scheduler_t *sched, coex_radio_t radio, uint32_t now_ms);
+
+const char *coex_radio_name(coex_radio_t radio);
+
+#endif // COEX_SCHEDULER_H
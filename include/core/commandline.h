@@ -4,20 +4,21 @@
 #define COMMAND_H
 
 #include "driver/gpio.h"
-
-typedef void (*CommandFunction)(int argc, char **argv);
-
-typedef struct Command {
-    char *name;
-    CommandFunction function;
-    struct Command *next;
-} Command;
+#include "esp_err.h"
+#include "core/cmd_registry.h"
 
 // Functions to manage commands
 void command_init();
-void register_command(const char *name, CommandFunction function);
+bool register_command(const cmd_spec_t *spec);
 void unregister_command(const char *name);
-CommandFunction find_command(const char *name);
+const cmd_spec_t *find_command(const char *name);
+
+// Validate argv[0]'s arguments against its spec and run it. Prints the error
+// and usage when they do not fit.
+esp_err_t command_execute(int argc, char **argv);
+
+// Tab-completion candidates for a partial command line, see cmd_registry_complete
+size_t command_complete(const char *line, const char **out, size_t max_out);
 
 void* VisualizerHandle;
 
@@ -0,0 +1,81 @@
+// deauth_detector.h
+
+#ifndef DEAUTH_DETECTOR_H
+#define DEAUTH_DETECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Fixed-memory sliding window rate tracker for deauth/disassoc floods.
+// Pure C (no ESP-IDF dependencies) so it can be exercised off-target.
+
+#define DEAUTH_DETECTOR_MAX_TRACKED   32     // Table slots (shared by BSSID and source keys)
+#define DEAUTH_DETECTOR_MAX_PROBE     8      // Max slots inspected per lookup
+#define DEAUTH_DETECTOR_BUCKETS       10     // Number of buckets in the sliding window
+#define DEAUTH_DETECTOR_BUCKET_MS     1000   // Width of one bucket
+#define DEAUTH_DETECTOR_REASON_BINS   16     // Reason codes 0-14, bin 15 collects everything else
+
+#define DEAUTH_DETECTOR_DEFAULT_THRESHOLD  50     // Frames per window before alerting
+#define DEAUTH_DETECTOR_DEFAULT_HOLDOFF_MS 10000  // Minimum time between alerts per key
+
+#define DEAUTH_SUBTYPE_DISASSOC 0x0A
+#define DEAUTH_SUBTYPE_DEAUTH   0x0C
+
+typedef enum {
+    DEAUTH_KEY_BSSID = 0,   // Frames grouped by the targeted network
+    DEAUTH_KEY_SOURCE       // Frames grouped by the transmitter address
+} deauth_key_type_t;
+
+typedef struct {
+    bool in_use;
+    uint8_t key_type;                                   // deauth_key_type_t
+    uint8_t mac[6];                                     // BSSID or source MAC
+    uint8_t last_peer[6];                               // Last BSSID (source keys) or source (BSSID keys)
+    uint32_t head_epoch;                                // Bucket index of the newest bucket
+    uint16_t buckets[DEAUTH_DETECTOR_BUCKETS];
+    uint32_t window_total;                              // Sum of all buckets
+    uint16_t reason_hist[DEAUTH_DETECTOR_REASON_BINS];  // Reset whenever the window drains
+    uint32_t deauth_count;
+    uint32_t disassoc_count;
+    uint32_t last_seen_ms;
+    uint32_t last_alert_ms;
+    bool alerted;
+} deauth_tracker_t;
+
+typedef struct {
+    deauth_tracker_t trackers[DEAUTH_DETECTOR_MAX_TRACKED];
+    uint32_t threshold;
+    uint32_t holdoff_ms;
+    uint32_t frames_seen;
+    uint32_t evictions;
+} deauth_detector_t;
+
+typedef struct {
+    deauth_key_type_t key_type;
+    uint8_t target[6];          // BSSID or source the alert is about
+    uint8_t peer[6];            // Most recent counterpart address
+    uint32_t frames_in_window;
+    uint32_t rate_per_sec;
+    uint32_t deauth_count;
+    uint32_t disassoc_count;
+    uint16_t reason_hist[DEAUTH_DETECTOR_REASON_BINS];
+} deauth_alert_t;
+
+// Reset all trackers and set the alert threshold (frames per window) and hold-off.
+void deauth_detector_init(deauth_detector_t *det, uint32_t threshold, uint32_t holdoff_ms);
+
+// Feed one deauth/disassoc frame. Returns the number of alerts written to
+// alerts (0-2, one per key type that crossed its threshold on this frame).
+int deauth_detector_process(deauth_detector_t *det, const uint8_t *bssid, const uint8_t *source,
+                            uint8_t subtype, uint16_t reason, uint32_t now_ms,
+                            deauth_alert_t alerts[2]);
+
+// Frames counted in the current window for a key, 0 if the key is not tracked.
+uint32_t deauth_detector_window_count(deauth_detector_t *det, deauth_key_type_t key_type,
+                                      const uint8_t *mac, uint32_t now_ms);
+
+// Render the non-zero reason code bins as "code:count" pairs.
+void deauth_detector_format_reasons(const uint16_t *hist, char *out, size_t out_size);
+
+#endif // DEAUTH_DETECTOR_H
@@ -0,0 +1,90 @@
+// job_table.h
+
+#ifndef JOB_TABLE_H
+#define JOB_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// State of long running operations (scans, captures, spam, portal). Each job
+// gets an id and holds resources while it runs, and a job that needs a
+// resource someone else holds is refused instead of silently taking it over.
+// A job is running, stopping while its stop hook runs, then done, cancelled
+// or failed; finished jobs stay listed until their slot is needed.
+// Pure C so it can be exercised off-target.
+
+#define JOB_TABLE_SLOTS 8
+#define JOB_LABEL_LEN   24
+
+// Resources, one holder at a time
+#define JOB_RES_WIFI    0x01     // WiFi mode, promiscuous callback and the TX tasks
+#define JOB_RES_BLE     0x02     // BLE scanning
+#define JOB_RES_PCAP    0x04     // The capture file
+#define JOB_RES_SCRIPT  0x08     // The script runner
+
+typedef enum {
+    JOB_RUNNING = 0,
+    JOB_STOPPING,
+    JOB_DONE,
+    JOB_CANCELLED,
+    JOB_FAILED
+} job_state_t;
+
+typedef struct {
+    uint32_t id;                 // 0 for an unused slot
+    job_state_t state;
+    char label[JOB_LABEL_LEN];   // e.g. "capture -probe"
+    uint32_t resources;
+    const void *owner;           // Caller's description of the job
+    uint32_t started_ms;
+    uint32_t ended_ms;
+    int32_t result;              // esp_err_t once finished
+    uint32_t heap_at_start;
+    int32_t heap_delta;          // Free heap change, final once finished
+    uint32_t items;              // Progress reported by the job (APs, packets, ...)
+} job_t;
+
+typedef void (*job_finish_cb_t)(const job_t *job, void *ctx);
+
+typedef struct {
+    job_t jobs[JOB_TABLE_SLOTS];
+    uint32_t next_id;
+    job_finish_cb_t on_finish;
+    void *ctx;
+} job_table_t;
+
+void job_table_init(job_table_t *t, job_finish_cb_t on_finish, void *ctx);
+
+// Returns the new job's id, or 0 when it cannot start: *holder is then the
+// running job holding one of the resources, or 0 when every slot is running.
+uint32_t job_table_start(job_table_t *t, const char *label, uint32_t resources, const void *owner,
+                         uint32_t now_ms, uint32_t heap_free, uint32_t *holder);
+
+// Running to stopping, before the job's stop hook is called. False when the
+// job does not exist or is not running.
+bool job_table_stop(job_table_t *t, uint32_t id);
+
+// The job ended: done or failed by result, cancelled when it was stopping.
+// Releases its resources and reports it to on_finish. False if not active.
+bool job_table_finish(job_table_t *t, uint32_t id, int32_t result, uint32_t now_ms, uint32_t heap_free);
+
+// Finish every active job started by this owner, for the stop commands that
+// end an operation without knowing its id. Returns how many ended.
+size_t job_table_release(job_table_t *t, const void *owner, int32_t result, uint32_t now_ms, uint32_t heap_free);
+
+job_t *job_table_find(job_table_t *t, uint32_t id);
+
+// Resources held by running and stopping jobs
+uint32_t job_table_held(const job_table_t *t);
+
+bool job_state_active(job_state_t state);
+const char *job_state_name(job_state_t state);
+
+// Runtime so far, or total once finished
+uint32_t job_runtime_ms(const job_t *job, uint32_t now_ms);
+
+// Slots in use ordered newest first; returns the count
+size_t job_table_list(job_table_t *t, job_t **out, size_t max_out);
+
+#endif // JOB_TABLE_H
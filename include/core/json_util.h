@@ -0,0 +1,17 @@
+// json_util.h
+
+#ifndef JSON_UTIL_H
+#define JSON_UTIL_H
+
+#include <stddef.h>
+
+// Helpers shared by the engines that render their tables as JSON. Pure C so
+// it can be exercised off-target.
+
+// Append s as a quoted JSON string at out[used]. Quotes and backslashes are
+// escaped, control and non-ASCII bytes are written as \u00XX. Returns the
+// length the output needs, which is past out_size if it did not fit; the
+// buffer stays NUL terminated either way.
+size_t json_append_string(char *out, size_t out_size, size_t used, const char *s);
+
+#endif // JSON_UTIL_H
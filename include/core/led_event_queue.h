@@ -0,0 +1,61 @@
+// led_event_queue.h
+
+#ifndef LED_EVENT_QUEUE_H
+#define LED_EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pending LED notifications. Posting never waits: an event that matches a
+// pending one is folded into it, and when the queue is full a new event only
+// gets in by displacing a pending event of lower priority. The LED task pops
+// the highest priority event, oldest first. Locking is left to the caller.
+// Pure C so it can be exercised off-target.
+
+#define LED_EVENT_QUEUE_LEN  8
+
+typedef enum {
+    LED_EVENT_PRIORITY_LOW = 0,   // Informational, e.g. a device of interest was seen
+    LED_EVENT_PRIORITY_NORMAL,
+    LED_EVENT_PRIORITY_HIGH,      // Alerts
+    LED_EVENT_PRIORITY_COUNT
+} led_event_priority_t;
+
+typedef enum {
+    LED_PATTERN_PULSE = 0,        // Fade in and out, then off
+    LED_PATTERN_SOLID,            // Set and keep the color
+} led_pattern_t;
+
+typedef struct {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t pattern;              // led_pattern_t
+    uint8_t priority;             // led_event_priority_t
+    uint16_t count;               // Posts folded into this event
+    uint32_t seq;                 // Post order, for FIFO within a priority
+} led_event_t;
+
+typedef struct {
+    led_event_t events[LED_EVENT_QUEUE_LEN];
+    uint8_t length;
+    uint32_t next_seq;
+    uint32_t posted;
+    uint32_t coalesced;
+    uint32_t dropped;
+} led_event_queue_t;
+
+void led_event_queue_init(led_event_queue_t *q);
+
+// Queue an event. Returns false if it was dropped because every pending
+// event has at least its priority.
+bool led_event_queue_post(led_event_queue_t *q, uint8_t red, uint8_t green, uint8_t blue,
+                          led_pattern_t pattern, led_event_priority_t priority);
+
+// Take the next event to show. Returns false when nothing is pending.
+bool led_event_queue_pop(led_event_queue_t *q, led_event_t *out);
+
+// Highest pending priority, or -1 when the queue is empty.
+int led_event_queue_top_priority(const led_event_queue_t *q);
+
+#endif // LED_EVENT_QUEUE_H
@@ -0,0 +1,47 @@
+// line_discipline.h
+
+#ifndef LINE_DISCIPLINE_H
+#define LINE_DISCIPLINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Turns console bytes into command lines, the same way for every input
+// (UART, USB-JTAG, the second UART on Ghost boards). CR, LF and CRLF all end
+// a line, empty lines are dropped, backspace and DEL erase, and other control
+// characters are ignored. A line too long for the buffer is thrown away whole
+// instead of being run in pieces. Tab hands the line to a completion hook.
+// Pure C so it can be exercised off-target.
+
+// Called with the finished line, NUL terminated. The buffer is reused after
+// the callback returns.
+typedef void (*line_discipline_line_cb_t)(char *line, size_t len, void *ctx);
+
+// Called on tab with the NUL terminated line so far. May extend it in place
+// up to cap characters and returns the new length.
+typedef size_t (*line_discipline_complete_cb_t)(char *line, size_t len, size_t cap, void *ctx);
+
+typedef struct {
+    char *buf;
+    size_t cap;                  // Buffer size including the terminator
+    size_t len;
+    bool discarding;             // Overflowed, dropping bytes until end of line
+    bool after_cr;               // Swallow the LF of a CRLF
+    line_discipline_line_cb_t on_line;
+    line_discipline_complete_cb_t on_complete;
+    void *ctx;
+    uint32_t lines;
+    uint32_t overflows;
+} line_discipline_t;
+
+void line_discipline_init(line_discipline_t *ld, char *buf, size_t cap,
+                          line_discipline_line_cb_t on_line,
+                          line_discipline_complete_cb_t on_complete, void *ctx);
+
+void line_discipline_feed(line_discipline_t *ld, const uint8_t *data, size_t len);
+
+// Drop the partial line, e.g. after the driver lost input
+void line_discipline_reset(line_discipline_t *ld);
+
+#endif // LINE_DISCIPLINE_H
@@ -0,0 +1,93 @@
+// log_ring.h
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// The one log every producer writes to and every consumer reads from.
+// Writing never waits: a line takes the next sequence number with one atomic
+// add and is copied into its slot over the oldest line. Each consumer keeps
+// its own cursor and reads at its own pace. One that falls a whole ring
+// behind skips ahead and counts what it missed, so a slow consumer holds up
+// neither the producers nor the other consumers.
+//
+// A writer that is lapped in the middle of its copy, which takes a full ring
+// of lines from other tasks while it is preempted, loses its line and the
+// one that lapped it; both read back as missed rather than garbled.
+// Pure C so it can be exercised off-target.
+
+// 256 slots are about 33 KB. At the 50-100 lines a second of a busy scan
+// that is 2.5-5 s, so a web UI stream polled every LOG_STREAM_POLL_MS keeps
+// up through a burst and a late poll or two.
+#define LOG_RING_SLOTS  256      // Power of two
+#define LOG_RING_TEXT   120      // Longer lines are split across slots
+
+typedef enum {
+    LOG_RING_ERROR = 1,          // Same values as esp_log_level_t
+    LOG_RING_WARN,
+    LOG_RING_INFO,
+    LOG_RING_DEBUG,
+    LOG_RING_VERBOSE
+} log_ring_level_t;
+
+#define LOG_RING_NO_UART  0x01   // The producer already printed it on the console
+
+typedef struct {
+    _Atomic uint32_t state;      // Sequence number << 2 | writing and hole bits
+    uint32_t ms;
+    uint8_t level;               // log_ring_level_t
+    uint8_t flags;
+    uint8_t len;
+    char text[LOG_RING_TEXT];
+} log_slot_t;
+
+typedef struct {
+    _Atomic uint32_t head;       // Sequence number the next line gets
+    _Atomic uint32_t lost;       // Lines lost to a lapped writer
+    log_slot_t slots[LOG_RING_SLOTS];
+} log_ring_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t ms;
+    uint8_t level;
+    uint8_t flags;
+    uint8_t len;
+    char text[LOG_RING_TEXT + 1];
+} log_entry_t;
+
+typedef struct {
+    uint32_t next;               // Sequence number of the next line to read
+    uint32_t missed;             // Lines gone before this consumer got to them
+} log_cursor_t;
+
+void log_ring_init(log_ring_t *r);
+
+// Adds a line, split over as many slots as it needs. Returns the slots used.
+size_t log_ring_write(log_ring_t *r, uint8_t level, uint8_t flags, uint32_t ms, const char *text, size_t len);
+
+// Copies out the line at the cursor and advances it. False when the consumer
+// has caught up, or the next line is still being written.
+bool log_ring_read(log_ring_t *r, log_cursor_t *c, log_entry_t *out);
+
+// Positions a cursor at the oldest line still held, or at the next line
+// written when history is false
+void log_ring_cursor_init(log_ring_t *r, log_cursor_t *c, bool history);
+
+// Positions a cursor at line seq, for a client picking up where it left off.
+// Lines already overwritten count as missed. A seq ahead of everything
+// written, from before a restart, starts at the oldest line instead.
+void log_ring_cursor_from(log_ring_t *r, log_cursor_t *c, uint32_t seq);
+
+uint32_t log_ring_head(log_ring_t *r);
+
+// Strips colour escapes and trailing line breaks from an ESP_LOG style line
+// in place and returns its level, LOG_RING_INFO for a line without the
+// "E (1234) TAG:" prefix
+uint8_t log_ring_clean_line(char *line, size_t *len);
+
+#endif // LOG_RING_H
@@ -0,0 +1,105 @@
+// probe_tracker.h
+
+#ifndef PROBE_TRACKER_H
+#define PROBE_TRACKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Preferred network lists built from probe requests. Devices, SSIDs and
+// fingerprint clusters live in fixed hashed tables with a bounded probe
+// window, so each frame costs constant time. Pure C so it can be exercised
+// off-target.
+
+#define PROBE_TRACKER_MAX_DEVICES     64   // Client MACs (power of two)
+#define PROBE_TRACKER_MAX_SSIDS       128  // Distinct SSIDs shared by all devices (power of two)
+#define PROBE_TRACKER_MAX_CLUSTERS    32   // IE fingerprints of randomized MACs (power of two)
+#define PROBE_TRACKER_MAX_PROBE       8    // Slots inspected per lookup before evicting
+#define PROBE_TRACKER_SSIDS_PER_DEV   6    // SSIDs remembered per device
+
+typedef struct {
+    uint8_t ssid;             // Index into probe_tracker_t.ssids
+    int8_t rssi;              // Last RSSI for this SSID
+    uint16_t generation;      // Must match the SSID slot, otherwise the SSID was evicted
+    uint16_t count;
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+} probe_ssid_ref_t;
+
+typedef struct {
+    bool in_use;
+    uint8_t mac[6];
+    bool randomized;          // Locally administered bit set
+    int8_t rssi;              // Last RSSI
+    int8_t rssi_max;
+    uint8_t ssid_count;
+    uint32_t fingerprint;     // Hash of the probe IEs that do not change between frames
+    uint32_t probes;          // Including wildcard probes
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+    probe_ssid_ref_t ssids[PROBE_TRACKER_SSIDS_PER_DEV];
+} probe_device_t;
+
+typedef struct {
+    bool in_use;
+    uint8_t len;
+    uint16_t generation;
+    uint32_t hash;
+    uint32_t last_seen_ms;
+    char ssid[33];
+} probe_ssid_t;
+
+typedef struct {
+    bool in_use;
+    uint32_t fingerprint;
+    uint16_t mac_count;       // Distinct randomized MACs seen with this fingerprint
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+} probe_cluster_t;
+
+typedef struct {
+    probe_device_t devices[PROBE_TRACKER_MAX_DEVICES];
+    probe_ssid_t ssids[PROBE_TRACKER_MAX_SSIDS];
+    probe_cluster_t clusters[PROBE_TRACKER_MAX_CLUSTERS];
+    uint32_t device_count;
+    uint32_t frames_seen;
+    uint32_t device_evictions;
+    uint32_t ssid_evictions;
+} probe_tracker_t;
+
+typedef struct {
+    probe_device_t *device;   // NULL if the frame was ignored
+    bool new_device;
+    bool new_ssid;            // First time this device probed for this SSID
+    const char *ssid;         // SSID carried by the frame, NULL for wildcard probes
+} probe_update_t;
+
+void probe_tracker_init(probe_tracker_t *tracker);
+
+// Hash the information elements of a probe request that identify the
+// hardware/driver (rates, HT/VHT/extended capabilities, vendor OUIs, element
+// order) and skip those that change per frame (SSID, DS parameter, vendor
+// payloads).
+uint32_t probe_fingerprint(const uint8_t *ies, size_t len);
+
+// Feed one raw 802.11 frame. Anything other than a probe request from a
+// unicast address is ignored.
+void probe_tracker_update(probe_tracker_t *tracker, const uint8_t *frame, size_t len,
+                          int8_t rssi, uint32_t now_ms, probe_update_t *result);
+
+// Device entry for a client MAC, NULL if it never probed or was evicted.
+const probe_device_t *probe_tracker_find(const probe_tracker_t *tracker, const uint8_t *mac);
+
+// SSID for a device reference, NULL if it has since been evicted.
+const char *probe_tracker_ssid(const probe_tracker_t *tracker, const probe_ssid_ref_t *ref);
+
+// Cluster for a fingerprint, NULL if no randomized MAC used it.
+const probe_cluster_t *probe_tracker_cluster(const probe_tracker_t *tracker, uint32_t fingerprint);
+
+// Render one device as a JSON object. Returns the length written, or 0 if
+// it did not fit.
+size_t probe_tracker_format_json(const probe_tracker_t *tracker, const probe_device_t *device,
+                                 char *out, size_t out_size);
+
+#endif // PROBE_TRACKER_H
@@ -0,0 +1,66 @@
+// pwnagotchi.h
+
+#ifndef PWNAGOTCHI_H
+#define PWNAGOTCHI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Pwnagotchi advertisement decoding. A pwnagotchi announces itself with
+// beacons sent from DE:AD:BE:EF:DE:AD whose JSON status is split across
+// consecutive vendor IEs with element ID 222. Pure C so it can be exercised
+// off-target.
+
+#define PWNAGOTCHI_IE_ID          222
+#define PWNAGOTCHI_MAX_PAYLOAD    2048  // Reassembled JSON, larger payloads are rejected
+#define PWNAGOTCHI_MAX_PEERS      16
+#define PWNAGOTCHI_NAME_LEN       32
+#define PWNAGOTCHI_VERSION_LEN    16
+#define PWNAGOTCHI_IDENTITY_LEN   65    // SHA256 fingerprint as hex
+
+typedef struct {
+    char name[PWNAGOTCHI_NAME_LEN];
+    char version[PWNAGOTCHI_VERSION_LEN];
+    char identity[PWNAGOTCHI_IDENTITY_LEN];
+    uint32_t pwnd_run;                  // Handshakes captured this session
+    uint32_t pwnd_tot;                  // Handshakes captured overall
+} pwnagotchi_info_t;
+
+typedef struct {
+    bool in_use;
+    pwnagotchi_info_t info;
+    int8_t rssi;
+    uint8_t channel;
+    uint32_t beacons;
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+} pwnagotchi_peer_t;
+
+typedef struct {
+    pwnagotchi_peer_t peers[PWNAGOTCHI_MAX_PEERS];
+    uint32_t peer_count;
+    uint32_t malformed;                 // Beacons from DE:AD:BE:EF:DE:AD that failed to decode
+} pwnagotchi_table_t;
+
+// True for a beacon transmitted by the pwnagotchi MAC.
+bool pwnagotchi_is_beacon(const uint8_t *frame, size_t len);
+
+// Concatenate the payloads of all IE 222 elements into out (NUL terminated).
+// A truncated element ends the list. Returns the JSON length, or -1 when no
+// IE 222 is present or the payload does not fit.
+int pwnagotchi_reassemble(const uint8_t *frame, size_t len, char *out, size_t out_size);
+
+// Pull name, version, identity and pwnd counts out of the top level of the JSON
+// object. Unknown keys and nested values (policy, etc.) are skipped.
+bool pwnagotchi_parse_json(const char *json, size_t len, pwnagotchi_info_t *info);
+
+void pwnagotchi_table_init(pwnagotchi_table_t *table);
+
+// Record a decoded advertisement. Returns the peer and sets *is_new when the
+// device was not in the table yet. Devices are keyed by identity, falling back
+// to name. When the table is full the least recently seen peer is replaced.
+pwnagotchi_peer_t *pwnagotchi_table_update(pwnagotchi_table_t *table, const pwnagotchi_info_t *info,
+                                           int8_t rssi, uint8_t channel, uint32_t now_ms, bool *is_new);
+
+#endif // PWNAGOTCHI_H
@@ -0,0 +1,112 @@
+// rogue_ap_detector.h
+
+#ifndef ROGUE_AP_DETECTOR_H
+#define ROGUE_AP_DETECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Allowlist based rogue AP / evil twin matcher. Pure C so the beacon parser
+// and matcher can be exercised off-target.
+
+#define ROGUE_AP_SSID_SLOTS        32   // Owned SSIDs (power of two)
+#define ROGUE_AP_BSSIDS_PER_SSID   8    // Known BSSIDs per owned SSID
+#define ROGUE_AP_REPORT_SLOTS      64   // Recently reported (BSSID, reason) pairs (power of two)
+#define ROGUE_AP_REPORT_PROBE      8
+#define ROGUE_AP_HOLDOFF_MS        30000
+#define ROGUE_AP_DEFAULT_ALLOWLIST "/mnt/ghostesp/allowlist.csv"
+
+typedef enum {
+    ROGUE_AP_SEC_OPEN = 0,
+    ROGUE_AP_SEC_WEP,
+    ROGUE_AP_SEC_WPA,
+    ROGUE_AP_SEC_WPA2,
+    ROGUE_AP_SEC_WPA3,
+    ROGUE_AP_SEC_WPA2_WPA3, // Transition mode, PSK and SAE both offered
+    ROGUE_AP_SEC_ANY        // Allowlist wildcard
+} rogue_ap_security_t;
+
+// Reasons are a bitmask, one beacon can trip several at once
+#define ROGUE_AP_REASON_UNKNOWN_BSSID  (1u << 0)
+#define ROGUE_AP_REASON_SECURITY       (1u << 1)
+#define ROGUE_AP_REASON_CHANNEL        (1u << 2)
+#define ROGUE_AP_REASON_OUI            (1u << 3)
+
+typedef struct {
+    char ssid[33];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t channel;                // 0 if no DS parameter set
+    rogue_ap_security_t security;
+} rogue_ap_beacon_t;
+
+typedef struct {
+    char ssid[33];
+    uint8_t bssid[6];
+    rogue_ap_security_t security;
+    uint8_t channel;                // 0 = any
+} rogue_ap_entry_t;
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t security;               // rogue_ap_security_t
+    uint8_t channel;                // Allowlisted channel, 0 = any
+    uint8_t seen_channel;           // Last channel observed on air, 0 = not seen yet
+} rogue_ap_known_bssid_t;
+
+typedef struct {
+    bool in_use;
+    uint32_t hash;
+    char ssid[33];
+    uint8_t ssid_len;
+    uint8_t bssid_count;
+    rogue_ap_known_bssid_t bssids[ROGUE_AP_BSSIDS_PER_SSID];
+} rogue_ap_ssid_slot_t;
+
+typedef struct {
+    uint8_t bssid[6];
+    uint32_t reasons;
+    uint32_t last_report_ms;
+    bool in_use;
+} rogue_ap_report_t;
+
+typedef struct {
+    rogue_ap_ssid_slot_t ssids[ROGUE_AP_SSID_SLOTS];
+    rogue_ap_report_t reports[ROGUE_AP_REPORT_SLOTS];
+    uint32_t entry_count;
+    uint32_t beacons_checked;
+    uint32_t alerts_raised;
+} rogue_ap_detector_t;
+
+typedef struct {
+    uint32_t reasons;
+    rogue_ap_beacon_t beacon;
+    rogue_ap_security_t expected_security;  // First allowlisted value for the SSID
+    uint8_t expected_channel;
+} rogue_ap_alert_t;
+
+void rogue_ap_init(rogue_ap_detector_t *det);
+
+// Add one allowlist tuple. Returns false if the table is full.
+bool rogue_ap_add_entry(rogue_ap_detector_t *det, const rogue_ap_entry_t *entry);
+
+// Parse "SSID,AA:BB:CC:DD:EE:FF,SECURITY[,CHANNEL]". SSIDs may contain commas.
+// Blank lines and lines starting with '#' return false.
+bool rogue_ap_parse_allowlist_line(const char *line, rogue_ap_entry_t *entry);
+
+// Extract SSID, BSSID, channel and security from a raw beacon/probe response.
+bool rogue_ap_parse_beacon(const uint8_t *frame, size_t len, rogue_ap_beacon_t *out);
+
+// Match a parsed beacon against the allowlist. Returns true and fills alert
+// when something is wrong and it was not reported within the hold-off.
+// Security only counts when it got weaker: an AP allowlisted as WPA2 that
+// starts offering SAE, or a WPA2/WPA3 entry seen as either, is fine.
+bool rogue_ap_check(rogue_ap_detector_t *det, const rogue_ap_beacon_t *beacon, uint32_t now_ms,
+                    rogue_ap_alert_t *alert);
+
+const char *rogue_ap_security_name(rogue_ap_security_t security);
+
+bool rogue_ap_parse_security(const char *name, rogue_ap_security_t *security);
+
+#endif // ROGUE_AP_DETECTOR_H
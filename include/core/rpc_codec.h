@@ -0,0 +1,103 @@
+// rpc_codec.h
+
+#ifndef RPC_CODEC_H
+#define RPC_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Framing and payload encoding for the binary RPC protocol (methods and
+// topics are in rpc_schema.h). A frame is
+//
+//   kind (1) | id (2, LE) | code (1) | payload | CRC-16/CCITT-FALSE (2, LE)
+//
+// COBS encoded and sent as 0x00 <frame> 0x00, so a reader resynchronises on
+// the next zero after noise or text from the console. The payload is a run
+// of tagged values, so any frame can be decoded without knowing the method.
+// Pure C so it can be exercised off-target.
+
+#define RPC_MAX_PAYLOAD   512
+#define RPC_HEADER_LEN    4
+#define RPC_CRC_LEN       2
+#define RPC_MAX_RAW       (RPC_HEADER_LEN + RPC_MAX_PAYLOAD + RPC_CRC_LEN)
+// COBS adds a byte per 254, plus the leading and trailing delimiters
+#define RPC_MAX_FRAME     (RPC_MAX_RAW + RPC_MAX_RAW / 254 + 1 + 2)
+
+// Frame kinds
+#define RPC_KIND_REQUEST  1      // Host to device, code is the method
+#define RPC_KIND_RESPONSE 2      // Same id as the request, code is the status
+#define RPC_KIND_NOTIFY   3      // Unsolicited, code is the topic
+
+// Value tags
+#define RPC_TAG_U32       1      // LEB128 varint
+#define RPC_TAG_I32       2      // Zigzag then varint
+#define RPC_TAG_BOOL      3      // One byte
+#define RPC_TAG_STR       4      // Varint length, UTF-8 without terminator
+#define RPC_TAG_BYTES     5      // Varint length, raw
+
+typedef struct {
+    uint8_t kind;
+    uint16_t id;
+    uint8_t code;
+    const uint8_t *payload;
+    size_t payload_len;
+} rpc_frame_t;
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;               // Something did not fit, the payload is unusable
+} rpc_writer_t;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool error;                  // Wrong tag or truncated value, later gets fail too
+} rpc_reader_t;
+
+typedef void (*rpc_frame_cb_t)(const rpc_frame_t *frame, void *ctx);
+
+typedef struct {
+    uint8_t buf[RPC_MAX_FRAME];
+    size_t len;
+    bool discarding;             // Too long, dropping until the next delimiter
+    rpc_frame_cb_t on_frame;
+    void *ctx;
+    uint32_t frames;
+    uint32_t bad_frames;         // Bad COBS, CRC or length
+    uint32_t overflows;
+} rpc_decoder_t;
+
+uint16_t rpc_crc16(const uint8_t *data, size_t len);
+
+void rpc_writer_init(rpc_writer_t *w, uint8_t *buf, size_t cap);
+void rpc_put_u32(rpc_writer_t *w, uint32_t value);
+void rpc_put_i32(rpc_writer_t *w, int32_t value);
+void rpc_put_bool(rpc_writer_t *w, bool value);
+void rpc_put_str(rpc_writer_t *w, const char *str);
+void rpc_put_bytes(rpc_writer_t *w, const uint8_t *data, size_t len);
+
+void rpc_reader_init(rpc_reader_t *r, const uint8_t *buf, size_t len);
+bool rpc_get_u32(rpc_reader_t *r, uint32_t *value);
+bool rpc_get_i32(rpc_reader_t *r, int32_t *value);
+bool rpc_get_bool(rpc_reader_t *r, bool *value);
+// Strings and byte strings point into the payload and are not terminated
+bool rpc_get_str(rpc_reader_t *r, const char **str, size_t *len);
+bool rpc_get_bytes(rpc_reader_t *r, const uint8_t **data, size_t *len);
+// Every value read and nothing left over
+bool rpc_reader_done(const rpc_reader_t *r);
+
+// Encode a frame, delimiters included. Returns the encoded length, or 0 when
+// the payload is over RPC_MAX_PAYLOAD or out is too small.
+size_t rpc_frame_encode(const rpc_frame_t *frame, uint8_t *out, size_t cap);
+
+void rpc_decoder_init(rpc_decoder_t *d, rpc_frame_cb_t on_frame, void *ctx);
+
+// Feed received bytes; on_frame is called for every frame that checks out.
+// The frame's payload points into the decoder and is only valid in the callback.
+void rpc_decoder_feed(rpc_decoder_t *d, const uint8_t *data, size_t len);
+
+#endif // RPC_CODEC_H
@@ -0,0 +1,45 @@
+// rpc_schema.h
+
+#ifndef RPC_SCHEMA_H
+#define RPC_SCHEMA_H
+
+// Methods, notification topics and status codes of the binary RPC protocol.
+// scripts/ghost_rpc.py reads this file to build its client, so keep every
+// entry on one line in the X(...) form below. Field lists name the typed
+// values of a payload in order: u32, i32, bool, str, bytes.
+
+// X(code, NAME, "name", "request fields", "response fields")
+#define RPC_METHODS(X) \
+    X(0x01, PING,      "ping",      "u32", "u32")                        /* Echoes its argument */ \
+    X(0x02, INFO,      "info",      "",    "str u32 u32")                /* Target, free heap, uptime ms */ \
+    X(0x03, RUN,       "run",       "str", "i32")                        /* Console command, esp_err_t result */ \
+    X(0x04, SUBSCRIBE, "subscribe", "u32", "u32")                        /* Topic bit mask, returns the new mask */ \
+    X(0x05, AP_LIST,   "ap_list",   "",    "u32")                        /* Streams an ap notification per AP, then the count */ \
+    X(0x06, STATS,     "stats",     "",    "u32 u32 u32 u32 u32 u32")    /* Same fields as the stats topic */ \
+    X(0x07, EXIT,      "exit",      "",    "")                           /* Back to the text console */
+
+// X(code, NAME, "name", "fields"). The frame id of a notification is a
+// running sequence number, so a client can tell when some were dropped.
+#define RPC_TOPICS(X) \
+    X(0, AP,    "ap",    "u32 bytes str i32 u32 u32")                    /* Index, BSSID, SSID, RSSI, channel, auth mode */ \
+    X(1, ALERT, "alert", "u32 str str u32")                              /* Severity, source, message, uptime ms */ \
+    X(2, STATS, "stats", "u32 u32 u32 u32 u32 u32")                      /* Uptime ms, free heap, min free heap, alerts dropped, frames, bad frames; every second */ \
+    X(3, JOB,   "job",   "u32 str str i32 u32 u32")                      /* Id, label, final state, esp_err_t, runtime ms, items; when a job ends */
+
+// X(code, NAME, "name")
+#define RPC_STATUSES(X) \
+    X(0, OK,             "ok") \
+    X(1, UNKNOWN_METHOD, "unknown method") \
+    X(2, BAD_ARGS,       "bad arguments") \
+    X(3, FAILED,         "failed") \
+    X(4, TOO_LARGE,      "response too large")
+
+#define RPC_ENUM_METHOD(code, NAME, name, req, resp) RPC_METHOD_##NAME = code,
+#define RPC_ENUM_TOPIC(code, NAME, name, fields)     RPC_TOPIC_##NAME = code,
+#define RPC_ENUM_STATUS(code, NAME, name)            RPC_STATUS_##NAME = code,
+
+typedef enum { RPC_METHODS(RPC_ENUM_METHOD) } rpc_method_t;
+typedef enum { RPC_TOPICS(RPC_ENUM_TOPIC) } rpc_topic_t;
+typedef enum { RPC_STATUSES(RPC_ENUM_STATUS) } rpc_status_t;
+
+#endif // RPC_SCHEMA_H
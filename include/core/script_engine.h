@@ -0,0 +1,96 @@
+// script_engine.h
+
+#ifndef SCRIPT_ENGINE_H
+#define SCRIPT_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Interpreter for command scripts, one statement per line:
+//
+//   # comment
+//   delay <duration>          500ms, 30s, 10m, 2h; a bare number is seconds
+//   repeat [count] ... end    no count repeats until the script is stopped
+//   while <cond> ... end
+//   if <cond> ... [else ...] end
+//   waitjob [timeout]         wait for the most recently started job to end
+//   exit
+//   anything else runs as a console command
+//
+// Conditions compare free SD space, time of day or uptime:
+//   free < 100M    time >= 22:30    uptime > 6h
+// A condition whose value is unknown (no card, clock never set) is false.
+//
+// The whole script is checked before anything runs, so a typo at the end
+// cannot leave a capture running with nobody to stop it. Statements point
+// into the caller's text, which must outlive the script.
+// Pure C so it can be exercised off-target.
+
+#define SCRIPT_MAX_OPS    128
+#define SCRIPT_MAX_DEPTH  8
+#define SCRIPT_POLL_MS    200    // waitjob checks the job this often
+
+typedef enum {
+    SCRIPT_OP_CMD = 0,
+    SCRIPT_OP_DELAY,
+    SCRIPT_OP_REPEAT,
+    SCRIPT_OP_WHILE,
+    SCRIPT_OP_IF,
+    SCRIPT_OP_ELSE,
+    SCRIPT_OP_END,
+    SCRIPT_OP_WAITJOB,
+    SCRIPT_OP_EXIT
+} script_op_kind_t;
+
+typedef enum { SCRIPT_VAR_FREE = 0, SCRIPT_VAR_TIME, SCRIPT_VAR_UPTIME } script_var_t;
+typedef enum { SCRIPT_LT = 0, SCRIPT_LE, SCRIPT_GT, SCRIPT_GE, SCRIPT_EQ, SCRIPT_NE } script_cmp_t;
+
+typedef struct {
+    uint8_t kind;                // script_op_kind_t
+    uint8_t var;                 // script_var_t, conditions only
+    uint8_t cmp;                 // script_cmp_t
+    uint16_t line;
+    uint16_t jump;               // if: else or end, else: end, loops: end, end: block start
+    uint64_t value;              // ms, count, bytes or minutes of day
+    uint64_t left;               // Repeat iterations remaining while running
+    const char *text;            // Command line
+} script_op_t;
+
+typedef struct {
+    script_op_t ops[SCRIPT_MAX_OPS];
+    uint16_t count;
+    uint16_t error_line;         // Set when parsing fails
+    const char *error;
+    uint32_t commands;           // Run so far
+    uint32_t failed;             // Commands that returned an error
+} script_t;
+
+typedef enum {
+    SCRIPT_DONE = 0,             // Ran off the end
+    SCRIPT_EXITED,               // exit statement
+    SCRIPT_STOPPED               // sleep() reported the script was cancelled
+} script_result_t;
+
+typedef struct {
+    int (*run)(const char *line, void *ctx);            // Returns 0 on success
+    bool (*sleep)(uint32_t ms, void *ctx);              // False once the script should stop
+    bool (*free_bytes)(uint64_t *out, void *ctx);       // False when unknown
+    bool (*time_of_day)(uint32_t *minutes, void *ctx);  // False when the clock is not set
+    uint64_t (*uptime_ms)(void *ctx);
+    uint32_t (*latest_job)(void *ctx);                  // 0 when no job was started
+    bool (*job_active)(uint32_t id, void *ctx);
+    void (*note)(uint16_t line, const char *msg, void *ctx);  // Runtime warnings, may be NULL
+    void *ctx;
+} script_env_t;
+
+// Splits text into statements in place. Returns false with error and
+// error_line set when the script is malformed.
+bool script_parse(script_t *s, char *text);
+
+script_result_t script_run(script_t *s, const script_env_t *env);
+
+// "30s" style durations, also used for waitjob timeouts
+bool script_parse_duration(const char *text, uint64_t *ms);
+
+#endif // SCRIPT_ENGINE_H
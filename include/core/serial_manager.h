@@ -4,6 +4,8 @@
 #define SERIAL_MANAGER_H
 
 #include <esp_types.h>
+#include <esp_err.h>
+#include "sdkconfig.h"
 #include <managers/display_manager.h>
 
 // Initialize the SerialManager
@@ -12,9 +14,38 @@ void serial_manager_init();
 // Task function for reading serial commands
 void serial_task(void *pvParameter);
 
+// Run a command line now, on the calling task. Waits while another task
+// (a script) is in the middle of a command.
 int handle_serial_command(const char *input);
 
-void simulateCommand(const char* commandString);
+// Queue a command line for the serial task. Never blocks: returns
+// ESP_ERR_NO_MEM when the queue is full, ESP_ERR_INVALID_SIZE when the line
+// does not fit a SerialCommand.
+esp_err_t simulateCommand(const char* commandString);
+
+// Print wakeup, latency and throughput counters for the console input path
+void serial_manager_print_stats(bool reset);
+
+// Switch the console input the current command came from to binary RPC
+// frames (see rpc_manager.h). ESP_ERR_NOT_SUPPORTED when the command did not
+// come from the UART or USB-JTAG console.
+esp_err_t serial_manager_start_rpc(void);
+
+#define SERIAL_MIN_BAUD 9600
+#define SERIAL_MAX_BAUD 5000000
+#ifdef CONFIG_ESP_CONSOLE_UART_BAUDRATE
+#define SERIAL_DEFAULT_BAUD CONFIG_ESP_CONSOLE_UART_BAUDRATE
+#else
+#define SERIAL_DEFAULT_BAUD 115200
+#endif
+
+// Switch the UART console to another baud rate after output already buffered
+// has gone out at the old one. Returns ESP_ERR_INVALID_ARG outside
+// SERIAL_MIN_BAUD..SERIAL_MAX_BAUD. The USB-JTAG console is not affected.
+esp_err_t serial_manager_set_baud(uint32_t baud);
+
+// Baud rate the UART is actually running at, after clock divider rounding
+uint32_t serial_manager_get_baud(void);
 
 QueueHandle_tt commandQueue;
 
@@ -0,0 +1,74 @@
+// station_stats.h
+
+#ifndef STATION_STATS_H
+#define STATION_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "core/probe_tracker.h"
+
+// Fixed-memory per-station traffic statistics built from sniffed data and
+// probe request frames. Every update touches at most STATION_STATS_MAX_PROBE
+// slots, so the cost per frame is constant. Pure C so it can be exercised
+// off-target.
+
+#define STATION_STATS_MAX_STATIONS 64   // Table slots (power of two)
+#define STATION_STATS_MAX_PROBE    8    // Slots inspected per lookup before evicting
+
+typedef enum {
+    STATION_SORT_RECENT = 0,   // Most recently seen first
+    STATION_SORT_FRAMES,       // Most frames (up + down) first
+    STATION_SORT_BYTES,        // Most bytes (up + down) first
+    STATION_SORT_RSSI          // Strongest average signal first
+} station_sort_t;
+
+typedef struct {
+    bool in_use;
+    uint8_t mac[6];
+    uint8_t ap_bssid[6];                    // Last AP seen in a data frame, zero if only probing
+    uint32_t frames_up;                     // Station -> AP (ToDS)
+    uint32_t frames_down;                   // AP -> station (FromDS)
+    uint32_t bytes_up;
+    uint32_t bytes_down;
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+    int8_t rssi_min;                        // Only frames sent by the station
+    int8_t rssi_max;
+    int16_t rssi_avg_q4;                    // Exponential moving average, 1/16 dBm
+    uint16_t ps_transitions;                // Power management bit changes
+    bool power_save;                        // Current power management state
+    bool has_rssi;
+    uint16_t probe_requests;                // Including wildcard probes, SSIDs live in the probe tracker
+} station_entry_t;
+
+typedef struct {
+    station_entry_t stations[STATION_STATS_MAX_STATIONS];
+    uint32_t station_count;
+    uint32_t frames_seen;
+    uint32_t evictions;
+} station_stats_t;
+
+void station_stats_init(station_stats_t *stats);
+
+// Feed one raw 802.11 frame. Data frames update the traffic counters of the
+// non-AP side, probe requests only bump probe_requests (feed the same frame to
+// a probe_tracker_t for the SSIDs). The frame must not include the FCS. Returns the entry
+// that was updated (NULL if the frame was ignored) and sets *is_new when the
+// station was added by this frame.
+station_entry_t *station_stats_update(station_stats_t *stats, const uint8_t *frame, size_t len,
+                                      int8_t rssi, uint32_t now_ms, bool *is_new);
+
+// Fill order with the indices of the in-use stations sorted by key. Returns
+// the number of indices written.
+size_t station_stats_sort(const station_stats_t *stats, station_sort_t key, uint16_t *order, size_t max);
+
+// Render one station as a JSON object, with the SSIDs it probed for taken
+// from probes (may be NULL). Returns the length written, or 0 if it did not
+// fit.
+size_t station_stats_format_json(const station_entry_t *entry, const probe_tracker_t *probes,
+                                 char *out, size_t out_size);
+
+bool station_stats_parse_sort(const char *name, station_sort_t *key);
+
+#endif // STATION_STATS_H
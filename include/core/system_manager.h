@@ -5,7 +5,9 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <esp_err.h>
 #include <stdbool.h>
+#include "core/job_table.h"
 
 typedef struct ManagedTask {
     TaskHandle_t task_handle;
@@ -36,4 +38,36 @@ bool system_manager_set_task_priority(const char *task_name, UBaseType_t new_pri
 // Print the list of all tasks
 void system_manager_list_tasks();
 
+// How a kind of job holds resources, ends early and reports progress
+typedef struct {
+    uint32_t resources;              // JOB_RES_* bits
+    void (*stop)(void);              // Ends the job early, NULL if it cannot be killed
+    uint32_t (*progress)(void);      // Items so far (APs, packets), may be NULL
+} job_desc_t;
+
+// Start a job, returns its id, or 0 after printing which job holds a resource it needs
+uint32_t system_manager_job_start(const job_desc_t *desc, const char *label);
+
+// A job ended on its own; ESP_OK marks it done, anything else failed
+void system_manager_job_finish(uint32_t id, esp_err_t result);
+
+// A stop command ended whatever jobs of this kind are running
+void system_manager_job_release(const job_desc_t *desc);
+
+// Run the job's stop hook and mark it cancelled
+esp_err_t system_manager_job_kill(uint32_t id);
+
+// Run the stop hook of the running jobs of this kind and mark them
+// cancelled. Returns how many were stopped, 0 leaves everything untouched.
+size_t system_manager_job_stop(const job_desc_t *desc);
+
+// Print running and recent jobs with runtime, heap change and progress
+void system_manager_print_jobs(void);
+
+// Id of the most recently started job, 0 before the first
+uint32_t system_manager_job_latest(void);
+
+// True while the job is running or stopping
+bool system_manager_job_active(uint32_t id);
+
 #endif // SYSTEM_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,91 @@
+// tracker_detector.h
+
+#ifndef TRACKER_DETECTOR_H
+#define TRACKER_DETECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "core/ble_adv_parser.h"
+
+// Tracker-following detector. Item trackers change their address (and for
+// SmartTags their advertised ID) over time, so each tracker is keyed by an
+// identity taken from the payload, and SmartTag ID rotations are stitched
+// together with the aging counter they carry. Every tracker keeps a one bit
+// per minute presence history; once it has been around for the dwell time
+// without a long gap it is reported once. Pure C so it can be exercised
+// off-target.
+
+#define TRACKER_DETECTOR_MAX_TRACKERS  32
+#define TRACKER_BUCKET_MS              60000   // One history bit per minute
+#define TRACKER_HISTORY_BUCKETS        64
+#define TRACKER_MAX_GAP_BUCKETS        3       // Missing minutes tolerated inside a dwell
+#define TRACKER_LINK_WINDOW_MS         (20 * 60000)  // SmartTag ID rotations are 15 min apart
+
+#define TRACKER_DEFAULT_DWELL_MS       (10 * 60000)
+
+typedef enum {
+    TRACKER_FIND_MY = 0,     // Apple Find My network, separated from its owner (AirTag and accessories)
+    TRACKER_TILE,
+    TRACKER_SMARTTAG,        // Samsung Galaxy SmartTag, offline finding
+    TRACKER_TYPE_COUNT
+} tracker_type_t;
+
+typedef struct {
+    tracker_type_t type;
+    uint32_t identity;       // Hash of the payload identity (Find My key, SmartTag privacy ID, Tile address)
+    bool has_link;
+    uint32_t link;           // SmartTag aging counter, +1 per privacy ID rotation
+    uint8_t status;          // Find My status byte / SmartTag state byte
+} tracker_sighting_t;
+
+typedef struct {
+    bool in_use;
+    uint8_t type;            // tracker_type_t
+    bool has_link;
+    bool alerted;
+    uint8_t addr[6];         // Last address
+    int8_t rssi;             // Last RSSI
+    int8_t rssi_max;
+    uint16_t rotations;      // Identity changes stitched onto this tracker
+    uint32_t identity;
+    uint32_t link;
+    uint32_t head_bucket;    // Minute of bit 0 in history
+    uint64_t history;        // Bit n set: seen in minute head_bucket - n
+    uint32_t sightings;
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+} tracker_entry_t;
+
+typedef struct {
+    tracker_entry_t trackers[TRACKER_DETECTOR_MAX_TRACKERS];
+    uint32_t dwell_ms;
+    uint32_t sightings;
+    uint32_t evictions;
+    uint32_t alerts;
+} tracker_detector_t;
+
+typedef struct {
+    const tracker_entry_t *tracker;
+    uint32_t dwell_ms;       // Presence time that triggered the alert
+} tracker_alert_t;
+
+void tracker_detector_init(tracker_detector_t *det, uint32_t dwell_ms);
+
+// Recognize a tracker advertisement. Returns false for anything else.
+bool tracker_parse(const ble_adv_t *adv, const uint8_t *addr, tracker_sighting_t *out);
+
+// Record a sighting. Returns the tracker entry and sets *is_new when it was
+// not known before. Returns true in *alerted (and fills alert) the first
+// time the tracker reaches the dwell time.
+tracker_entry_t *tracker_detector_update(tracker_detector_t *det, const tracker_sighting_t *sighting,
+                                         const uint8_t *addr, int8_t rssi, uint32_t now_ms,
+                                         bool *is_new, bool *alerted, tracker_alert_t *alert);
+
+// Minutes the tracker has been present up to now_ms, counting back from the
+// most recent minute and stopping at a gap longer than TRACKER_MAX_GAP_BUCKETS.
+uint32_t tracker_dwell_ms(const tracker_entry_t *tracker, uint32_t now_ms);
+
+const char *tracker_type_name(tracker_type_t type);
+
+#endif // TRACKER_DETECTOR_H
@@ -35,14 +35,7 @@ void scale_grb_by_brightness(uint8_t *g, uint8_t *r, uint8_t *b, float brightnes
     *r = (int)((float)(original_r) * scale_factor);
     *b = (int)((float)(original_b) * scale_factor);
 
-    
-    if (*g > 255) *g = 255;
-    if (*r > 255) *r = 255;
-    if (*b > 255) *b = 255;
-
-    if (*g < 0) *g = 0;
-    if (*r < 0) *r = 0;
-    if (*b < 0) *b = 0;
+    // The scale is clamped to [0, 1], so the channels stay in range
 }
 
 bool is_in_task_context(void);
@@ -0,0 +1,76 @@
+// wps_set.h
+
+#ifndef WPS_SET_H
+#define WPS_SET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// WPS capable access points seen during a scan, keyed by BSSID. Storage is
+// allocated once with a caller chosen capacity so lookups from the
+// promiscuous callback never allocate. Pure C so it can be exercised
+// off-target.
+
+#define WPS_SET_DEFAULT_CAPACITY 64
+#define WPS_SET_MAX_CAPACITY     1024
+#define WPS_STRING_LEN           33     // WPS strings are at most 32 bytes (64 for device name, truncated)
+
+#define WPS_CONF_METHODS_PIN_DISPLAY 0x0004
+#define WPS_CONF_METHODS_PIN_KEYPAD  0x0008
+#define WPS_CONF_METHODS_PBC         0x0080
+
+#define WPS_STATE_UNCONFIGURED 0x01
+#define WPS_STATE_CONFIGURED   0x02
+
+typedef enum {
+    WPS_MODE_NONE = 0,   // No WPS support
+    WPS_MODE_PBC,        // Push Button Configuration (PBC)
+    WPS_MODE_PIN         // PIN method (Display or Keypad)
+} wps_modes_t;
+
+typedef struct {
+    char ssid[33];        // SSID (max 32 characters + null terminator)
+    uint8_t bssid[6];     // BSSID (MAC address)
+    bool wps_enabled;     // True if WPS is enabled
+    wps_modes_t wps_mode;  // WPS mode (PIN or PBC)
+    uint16_t config_methods;              // 0x1008, 0 if not advertised
+    uint8_t version;                      // Version2 from 0x1049 if present, else 0x104A; 0x20 = 2.0
+    uint8_t state;                        // 0x1044, WPS_STATE_*
+    bool locked;                          // 0x1057 AP setup locked
+    char manufacturer[WPS_STRING_LEN];    // 0x1021
+    char device_name[WPS_STRING_LEN];     // 0x1011
+    char model_name[WPS_STRING_LEN];      // 0x1023
+    char model_number[WPS_STRING_LEN];    // 0x1024
+} wps_network_t;
+
+typedef struct {
+    wps_network_t *networks;   // Dense, in discovery order
+    uint16_t *slots;           // Open addressed index into networks, 0 = empty
+    uint32_t capacity;
+    uint32_t slot_mask;
+    uint32_t count;
+    uint32_t dropped;          // Networks not recorded because the set was full
+} wps_set_t;
+
+// Allocate storage for capacity networks. Returns false on a bad capacity or
+// when out of memory; the set is left empty in that case.
+bool wps_set_init(wps_set_t *set, uint32_t capacity);
+
+void wps_set_free(wps_set_t *set);
+
+void wps_set_clear(wps_set_t *set);
+
+wps_network_t *wps_set_find(const wps_set_t *set, const uint8_t *bssid);
+
+// Return the entry for bssid, adding an empty one if needed. Sets *is_new for
+// added entries. Returns NULL when the set is full or not initialized.
+wps_network_t *wps_set_insert(wps_set_t *set, const uint8_t *bssid, bool *is_new);
+
+// Parse a beacon or probe response. Returns true when it carries a WPS IE, in
+// which case out holds the SSID, BSSID and all decoded WPS attributes.
+bool wps_parse_frame(const uint8_t *frame, size_t len, wps_network_t *out);
+
+const char *wps_mode_name(wps_modes_t mode);
+
+#endif // WPS_SET_H
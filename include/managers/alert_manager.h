@@ -0,0 +1,40 @@
+#ifndef ALERT_MANAGER_H
+#define ALERT_MANAGER_H
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ALERT_SOURCE_LEN 16
+#define ALERT_MESSAGE_LEN 192
+#define ALERT_LOG_PATH "/mnt/ghostesp/alerts.log"
+
+typedef enum {
+    ALERT_SEVERITY_INFO = 0,
+    ALERT_SEVERITY_WARNING,
+    ALERT_SEVERITY_CRITICAL
+} alert_severity_t;
+
+typedef struct {
+    alert_severity_t severity;
+    char source[ALERT_SOURCE_LEN];    // Detector that raised the alert (e.g. "DEAUTH")
+    char message[ALERT_MESSAGE_LEN];  // Human readable, single line
+    uint32_t uptime_ms;
+} alert_t;
+
+/**
+ * @brief Create the alert queue and the task that fans alerts out to the
+ *        terminal, web log, LEDs and the SD alert log.
+ */
+esp_err_t alert_manager_init(void);
+
+/**
+ * @brief Queue an alert without blocking. Safe to call from WiFi/BLE callbacks.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if not initialized, ESP_ERR_TIMEOUT if the queue is full
+ */
+esp_err_t alert_manager_post(alert_severity_t severity, const char *source, const char *fmt, ...);
+
+// Number of alerts dropped because the queue was full
+uint32_t alert_manager_dropped_count(void);
+
+#endif // ALERT_MANAGER_H
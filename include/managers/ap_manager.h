@@ -9,7 +9,7 @@ esp_err_t ap_manager_init(void);
 // Deinitialize and stop the servers
 void ap_manager_deinit(void);
 
-// Function to add log messages
+// Adds a line to the shared log, see log_manager.h
 void ap_manager_add_log(const char* log_message);
 
 // only indeded to be used after ap_manager_init has been called once
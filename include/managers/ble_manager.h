@@ -4,39 +4,48 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "esp_err.h"
-
-#define MAX_UUID16 10
-#define MAX_UUID32 5
-#define MAX_UUID128 3
-#define MAX_PAYLOADS 10         // Maximum number of similar payloads to consider as spam
-#define PAYLOAD_COMPARE_LEN 20  // Length of the payload to compare for similarity
-#define TIME_WINDOW_MS 3000
+#include "core/ble_adv_parser.h"
+#include "core/ble_device_table.h"
+#include "core/ble_spam_detector.h"
+#include "core/tracker_detector.h"
+#include "core/ble_pcap.h"
+#include "core/ble_company_ids.h"
+#include "core/ble_lifecycle.h"
 
 
 #ifndef CONFIG_IDF_TARGET_ESP32S2
 
-typedef void (*ble_data_handler_t)(struct ble_gap_event *event, size_t len);
-
-typedef struct {
-    uint16_t uuid16[MAX_UUID16];
-    int uuid16_count;
+struct ble_gap_event;
 
-    uint32_t uuid32[MAX_UUID32];
-    int uuid32_count;
+// Handlers get the raw GAP event and the advertisement decoded once by the
+// scanner. They run for new devices, payload changes and returning devices
+// only, unless registered with BLE_HANDLER_ALL_ADVERTS.
+typedef void (*ble_data_handler_t)(struct ble_gap_event *event, const ble_adv_t *adv);
 
-    char uuid128[MAX_UUID128][37];
-    int uuid128_count;
-} ble_service_uuids_t;
+#define BLE_HANDLER_ALL_ADVERTS 0x01   // Also run for repeats of an unchanged advertisement
 
 esp_err_t ble_register_handler(ble_data_handler_t handler);
+esp_err_t ble_register_handler_flags(ble_data_handler_t handler, uint32_t flags);
 esp_err_t ble_unregister_handler(ble_data_handler_t handler);
-void ble_init(void);
 void ble_start_find_flippers(void);
 void ble_stop(void);
+// Stop any scan and release the BLE host and controller now instead of
+// waiting for the idle timeout. The stack comes back up on the next scan.
 void stop_ble_stack(void);
 void ble_start_airtag_scanner(void);
+void ble_start_tracker_detector(uint32_t dwell_minutes);
 void ble_start_raw_ble_packetscan(void);
+void ble_start_pcap_capture(void);
 void ble_start_blespam_detector(void);
+void ble_list_devices(void);
+void ble_start_scanning(void);
+// Size the device table for max_devices from the next scan on. Returns the
+// number of table slots that will be allocated.
+uint32_t ble_set_device_capacity(uint32_t max_devices);
+
+// Stop and restart discovery without touching handlers or the device table
+esp_err_t ble_pause_scanning(void);
+esp_err_t ble_resume_scanning(void);
 
 #endif 
 #endif // BLE_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef COEX_MANAGER_H
+#define COEX_MANAGER_H
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "core/coex_scheduler.h"
+
+#ifndef CONFIG_IDF_TARGET_ESP32S2
+
+#define COEX_DEFAULT_WIFI_PCT 50
+#define COEX_DEFAULT_BLE_PCT  50
+
+/**
+ * @brief Time-slice passive WiFi capture (station sniffer) and BLE scanning.
+ * @param slot_ms Slot length, COEX_MIN_SLOT_MS to COEX_MAX_SLOT_MS
+ * @param wifi_pct Share of time for WiFi promiscuous capture
+ * @param ble_pct Share of time for BLE scanning; whatever is left over is idle
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for bad shares or slot length,
+ *         ESP_ERR_INVALID_STATE if already running, ESP_FAIL if the BLE stack could not be started
+ *
+ * @note Radios are switched by toggling promiscuous mode and BLE discovery, not
+ *       by restarting the stacks. Where software coexistence is enabled the
+ *       coexistence preference follows the slot owner.
+ */
+esp_err_t coex_manager_start(uint32_t slot_ms, uint8_t wifi_pct, uint8_t ble_pct);
+
+/**
+ * @brief Stop time slicing and turn both captures off.
+ */
+void coex_manager_stop(void);
+
+bool coex_manager_is_running(void);
+
+/**
+ * @brief Print the configured and effective duty cycle, worst gap and traffic per radio.
+ */
+void coex_manager_print_status(void);
+
+#endif
+#endif // COEX_MANAGER_H
@@ -0,0 +1,42 @@
+#ifndef LOG_MANAGER_H
+#define LOG_MANAGER_H
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "core/log_ring.h"
+
+#define LOG_LINE_MAX         256   // Longest line formatted in one go
+#define LOG_UART_TASK_STACK  3072
+
+/**
+ * @brief Set up the shared log ring, route ESP_LOG output into it and start
+ *        the task that copies it to the console. Call first thing in app_main.
+ */
+esp_err_t log_manager_init(void);
+
+/**
+ * @brief Add a line to the log without blocking. Safe from any task.
+ * @param level log_ring_level_t
+ * @param flags LOG_RING_NO_UART for text the caller has already printed
+ */
+void log_manager_write(uint8_t level, uint8_t flags, const char *text);
+
+/**
+ * @brief Start a consumer at the oldest line still held, or at the next line
+ *        written when history is false.
+ */
+void log_manager_cursor(log_cursor_t *cursor, bool history);
+
+/**
+ * @brief Start a consumer at line seq, see log_ring_cursor_from.
+ */
+void log_manager_cursor_from(log_cursor_t *cursor, uint32_t seq);
+
+/**
+ * @brief Copy out the next line for a consumer.
+ * @return false once the consumer has caught up
+ */
+bool log_manager_read(log_cursor_t *cursor, log_entry_t *out);
+
+#endif // LOG_MANAGER_H
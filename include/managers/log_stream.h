@@ -0,0 +1,31 @@
+#ifndef LOG_STREAM_H
+#define LOG_STREAM_H
+
+#include <esp_err.h>
+#include <esp_http_server.h>
+
+#define LOG_STREAM_CLIENTS       4       // Each keeps one of the server's sockets open
+#define LOG_STREAM_POLL_MS       250
+#define LOG_STREAM_KEEPALIVE_MS  15000
+#define LOG_STREAM_RETRY_MS      2000    // Reconnect delay suggested to EventSource
+#define LOG_STREAM_CHUNK         1024    // Events are batched into chunks up to this size
+
+/**
+ * @brief Serve the shared log at /api/logs as a Server-Sent Events stream.
+ *
+ * Each line is an event whose id is its sequence number, and every client
+ * reads with its own cursor. The stream starts at ?since=N when given,
+ * otherwise at the oldest line still held. An EventSource that reconnects
+ * sends Last-Event-ID and resumes after it. Lines overwritten before a client
+ * got to them arrive as a "missed" event carrying the count. An idle stream
+ * gets a comment every LOG_STREAM_KEEPALIVE_MS. With LOG_STREAM_CLIENTS
+ * streams open, further requests get what is held and the response ends.
+ */
+esp_err_t log_stream_register(httpd_handle_t server);
+
+/**
+ * @brief Stop feeding the streams. Call before stopping the server.
+ */
+void log_stream_stop(void);
+
+#endif // LOG_STREAM_H
@@ -2,7 +2,10 @@
 #define RGB_MANAGER_H
 
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "vendor/led/led_strip.h"
+#include "core/led_event_queue.h"
 
 // Struct for the RGB manager (addressable LED strip)
 typedef struct {
@@ -59,7 +62,19 @@ void rainbow_task(void* pvParameter);
 
 void police_task(void* pvParameter);
 
-void pulse_once(RGBManager_t* rgb_manager, uint8_t red, uint8_t green, uint8_t blue);
+/**
+ * @brief Queue an LED notification for the LED task without waiting
+ * @param red Red component (0-255)
+ * @param green Green component (0-255)
+ * @param blue Blue component (0-255)
+ * @param pattern Pulse once or set a solid color
+ * @param priority Higher priority events are shown first and cut a running pulse short
+ * @return esp_err_t ESP_OK when queued or folded into a pending event, ESP_FAIL when dropped,
+ *         ESP_ERR_INVALID_STATE before rgb_manager_init
+ *
+ * @note Safe to call from BLE and WiFi callbacks
+ */
+esp_err_t rgb_manager_post_event(uint8_t red, uint8_t green, uint8_t blue, led_pattern_t pattern, led_event_priority_t priority);
 
 
 void rgb_manager_rainbow_effect_matrix(RGBManager_t* rgb_manager, int delay_ms);
@@ -68,8 +83,8 @@ void rgb_manager_rainbow_effect_matrix(RGBManager_t* rgb_manager, int delay_ms);
 void update_led_visualizer(uint8_t *amplitudes, size_t num_bars, bool square_mode);
 
 
-RGBManager_t rgb_manager;
+extern RGBManager_t rgb_manager;
 
-TaskHandle_t rgb_effect_task_handle;
+extern TaskHandle_t rgb_effect_task_handle;
 
 #endif // RGB_MANAGER_H
\ No newline at end of file
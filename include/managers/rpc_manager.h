@@ -0,0 +1,55 @@
+#ifndef RPC_MANAGER_H
+#define RPC_MANAGER_H
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "core/rpc_codec.h"
+#include "core/rpc_schema.h"
+#include "managers/alert_manager.h"
+#include "core/job_table.h"
+
+#define RPC_POLL_MS          250       // How often the serial task polls an open session
+#define RPC_IDLE_TIMEOUT_MS  60000     // A session with no valid frame for this long ends
+#define RPC_STATS_PERIOD_MS  1000
+
+typedef void (*rpc_write_fn_t)(const uint8_t *data, size_t len);
+
+/**
+ * @brief Start a binary RPC session. Console input goes to rpc_manager_feed
+ *        until the host sends exit or goes quiet for RPC_IDLE_TIMEOUT_MS.
+ * @param write Sends encoded frames back over the link the session came in on
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if a session is already open,
+ *         ESP_ERR_NO_MEM if the lock could not be created
+ */
+esp_err_t rpc_manager_open(rpc_write_fn_t write);
+
+void rpc_manager_close(void);
+
+bool rpc_manager_is_open(void);
+
+/**
+ * @brief Decode received bytes and answer any complete requests. Runs on the
+ *        serial task, so run requests execute there like typed commands.
+ */
+void rpc_manager_feed(const uint8_t *data, size_t len);
+
+/**
+ * @brief Send the periodic stats notification and end an idle session.
+ *        Call at least every RPC_POLL_MS while a session is open.
+ */
+void rpc_manager_poll(void);
+
+/**
+ * @brief Forward an alert to the host if it subscribed to the alert topic.
+ */
+void rpc_manager_notify_alert(const alert_t *alert);
+
+/**
+ * @brief Tell a subscribed host that a job finished, so scripts can chain
+ *        commands on completion instead of polling.
+ */
+void rpc_manager_notify_job(const job_t *job);
+
+#endif // RPC_MANAGER_H
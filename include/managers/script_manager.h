@@ -0,0 +1,33 @@
+#ifndef SCRIPT_MANAGER_H
+#define SCRIPT_MANAGER_H
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include "core/script_engine.h"
+
+#define SCRIPT_DIR               "/mnt/ghostesp"
+#define SCRIPT_AUTORUN_PATH      SCRIPT_DIR "/autorun"
+#define SCRIPT_MAX_SIZE          4096
+#define SCRIPT_AUTORUN_DELAY_MS  3000      // Time to kill a bad autorun before it starts
+#define SCRIPT_TASK_STACK        8192      // Commands run on it, same as the serial task
+
+/**
+ * @brief Check a script and run it in the background as a job, see
+ *        script_engine.h for the language. Problems are printed.
+ * @param path File on the SD card, relative to SCRIPT_DIR unless it starts with /
+ * @param check_only Only report whether the script is valid
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if the file cannot be read,
+ *         ESP_ERR_INVALID_SIZE if it is larger than SCRIPT_MAX_SIZE,
+ *         ESP_ERR_INVALID_ARG for a malformed script,
+ *         ESP_ERR_INVALID_STATE if a script is already running,
+ *         ESP_ERR_NO_MEM
+ */
+esp_err_t script_manager_exec(const char *path, bool check_only);
+
+/**
+ * @brief Run SCRIPT_AUTORUN_PATH after SCRIPT_AUTORUN_DELAY_MS if the card
+ *        has one. Call once the SD card is mounted.
+ */
+void script_manager_autorun(void);
+
+#endif // SCRIPT_MANAGER_H
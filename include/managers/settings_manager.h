@@ -68,6 +68,9 @@ typedef struct {
     char printer_text[257];       // Last printed text (max 256 characters + null terminator)
     uint8_t printer_font_size;    // Font size for printing
     PrinterAlignment printer_alignment; // Text alignment
+
+    // Console
+    uint32_t console_baud;        // UART console baud rate, applied after boot
 } FSettings;
 
 // Function declarations
@@ -128,6 +131,10 @@ uint8_t settings_get_printer_font_size(const FSettings* settings);
 void settings_set_printer_alignment(FSettings* settings, PrinterAlignment alignment);
 PrinterAlignment settings_get_printer_alignment(const FSettings* settings);
 
+// Getters and Setters for the console
+void settings_set_console_baud(FSettings* settings, uint32_t baud);
+uint32_t settings_get_console_baud(const FSettings* settings);
+
 static nvs_handle_t nvsHandle;
 
 FSettings G_Settings;
@@ -0,0 +1,34 @@
+#ifndef WEB_UI_H
+#define WEB_UI_H
+
+#include <esp_err.h>
+#include <esp_http_server.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// One file of the web UI, gzipped at build time by scripts/gen_web_assets.py
+typedef struct {
+    const char *uri;             // "/" for the page, content-hashed names for the rest
+    const char *type;
+    const char *cache_control;
+    const char *etag;            // Quoted, as sent
+    const uint8_t *data;         // gzip
+    uint32_t len;
+    uint32_t raw_len;
+} web_asset_t;
+
+/**
+ * @brief Register a GET handler for every file of the web UI. Each is served
+ *        gzipped with its ETag, or as 304 Not Modified when the browser
+ *        already has it.
+ * @return ESP_OK, or the first registration error
+ */
+esp_err_t web_ui_register(httpd_handle_t server);
+
+/**
+ * @brief Whether an If-None-Match header value names this ETag: a
+ *        comma-separated list, weak (W/) tags compared by value, or "*".
+ */
+bool web_ui_etag_matches(const char *if_none_match, const char *etag);
+
+#endif // WEB_UI_H
@@ -5,27 +5,18 @@
 
 #include "esp_err.h"
 #include "esp_wifi_types.h"
+#include "core/station_stats.h"
 
 
 #define RANDOM_SSID_LEN 8
 #define BEACON_INTERVAL 0x0064  // 100 Time Units (TU)
 #define CAPABILITY_INFO 0x0411  // Capability information (ESS)
-#define MAX_STATIONS 50
-
-typedef struct {
-    uint8_t station_mac[6];  // MAC address of the station (client)
-    uint8_t ap_bssid[6];     // BSSID (MAC address) of the access point
-} station_ap_pair_t;
-
-static station_ap_pair_t station_ap_list[MAX_STATIONS];  // Array to store station-AP pairs
-static int station_count = 0;
+#define STATIONS_JSON_PATH "/mnt/ghostesp/scans/stations.json"
 
 extern wifi_ap_record_t* scanned_aps;
+extern uint16_t ap_count;
 extern wifi_ap_record_t selected_ap;
 
-static void* beacon_task_handle;
-static void* deauth_task_handle;
-static int beacon_task_running = 0;
 
 typedef struct {
     uint8_t frame_control[2];  // Frame Control
@@ -110,7 +101,7 @@ void wifi_manager_stop_monitor_mode();
 
 void wifi_manager_start_monitor_mode(wifi_promiscuous_cb_t_t callback);
 
-void wifi_manager_list_stations();
+void wifi_manager_list_stations(station_sort_t sort, bool json);
 
 void wifi_manager_start_deauth();
 
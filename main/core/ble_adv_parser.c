@@ -0,0 +1,156 @@
+#include "core/ble_adv_parser.h"
+#include <string.h>
+
+// 00000000-0000-1000-8000-00805F9B34FB without the 32-bit short UUID, little endian
+static const uint8_t bluetooth_base_uuid[12] = {
+    0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00
+};
+
+static void copy_name(ble_adv_t *out, const uint8_t *value, uint8_t len) {
+    if (len > BLE_ADV_NAME_LEN - 1) {
+        len = BLE_ADV_NAME_LEN - 1;
+    }
+    memcpy(out->name, value, len);
+    out->name[len] = '\0';
+}
+
+bool ble_adv_parse(const uint8_t *data, size_t len, ble_adv_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->raw = data;
+    out->raw_len = len > 255 ? 255 : (uint8_t)len;
+
+    size_t index = 0;
+    while (index < len) {
+        uint8_t field_len = data[index];
+
+        // Zero length marks early termination of the significant part
+        if (field_len == 0) {
+            break;
+        }
+
+        if (index + 1 + field_len > len) {
+            out->truncated = true;
+            break;
+        }
+
+        uint8_t type = data[index + 1];
+        const uint8_t *value = &data[index + 2];
+        uint8_t value_len = field_len - 1;
+
+        switch (type) {
+            case BLE_AD_FLAGS:
+                if (value_len >= 1) {
+                    out->flags = value[0];
+                    out->has_flags = true;
+                }
+                break;
+
+            case BLE_AD_INCOMP_UUID16:
+            case BLE_AD_COMP_UUID16:
+                for (uint8_t i = 0; i + 2 <= value_len && out->uuid16_count < BLE_ADV_MAX_UUID16; i += 2) {
+                    out->uuid16[out->uuid16_count++] = value[i] | (value[i + 1] << 8);
+                }
+                break;
+
+            case BLE_AD_INCOMP_UUID32:
+            case BLE_AD_COMP_UUID32:
+                for (uint8_t i = 0; i + 4 <= value_len && out->uuid32_count < BLE_ADV_MAX_UUID32; i += 4) {
+                    out->uuid32[out->uuid32_count++] = (uint32_t)value[i] | ((uint32_t)value[i + 1] << 8) |
+                                                       ((uint32_t)value[i + 2] << 16) | ((uint32_t)value[i + 3] << 24);
+                }
+                break;
+
+            case BLE_AD_INCOMP_UUID128:
+            case BLE_AD_COMP_UUID128:
+                for (uint8_t i = 0; i + 16 <= value_len && out->uuid128_count < BLE_ADV_MAX_UUID128; i += 16) {
+                    memcpy(out->uuid128[out->uuid128_count++], &value[i], 16);
+                }
+                break;
+
+            case BLE_AD_SHORT_NAME:
+                if (!out->name_complete) {
+                    copy_name(out, value, value_len);
+                }
+                break;
+
+            case BLE_AD_COMP_NAME:
+                copy_name(out, value, value_len);
+                out->name_complete = true;
+                break;
+
+            case BLE_AD_TX_POWER:
+                if (value_len >= 1) {
+                    out->tx_power = (int8_t)value[0];
+                    out->has_tx_power = true;
+                }
+                break;
+
+            case BLE_AD_APPEARANCE:
+                if (value_len >= 2) {
+                    out->appearance = value[0] | (value[1] << 8);
+                    out->has_appearance = true;
+                }
+                break;
+
+            case BLE_AD_SERVICE_DATA16:
+                if (value_len >= 2 && out->service_data_count < BLE_ADV_MAX_SERVICE_DATA) {
+                    ble_adv_service_data_t *sd = &out->service_data[out->service_data_count++];
+                    sd->uuid = value[0] | (value[1] << 8);
+                    sd->data = &value[2];
+                    sd->len = value_len - 2;
+                }
+                break;
+
+            case BLE_AD_MFG_DATA:
+                if (value_len >= 2 && !out->has_mfg) {
+                    out->has_mfg = true;
+                    out->company_id = value[0] | (value[1] << 8);
+                    out->mfg_data = &value[2];
+                    out->mfg_len = value_len - 2;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        index += 1 + field_len;
+    }
+
+    return !out->truncated;
+}
+
+bool ble_uuid128_to_short(const uint8_t *uuid128, uint32_t *short_uuid) {
+    if (memcmp(uuid128, bluetooth_base_uuid, sizeof(bluetooth_base_uuid)) != 0) {
+        return false;
+    }
+
+    *short_uuid = (uint32_t)uuid128[12] | ((uint32_t)uuid128[13] << 8) |
+                  ((uint32_t)uuid128[14] << 16) | ((uint32_t)uuid128[15] << 24);
+    return true;
+}
+
+bool ble_adv_has_service(const ble_adv_t *adv, uint32_t uuid) {
+    if (uuid <= 0xFFFF) {
+        for (uint8_t i = 0; i < adv->uuid16_count; i++) {
+            if (adv->uuid16[i] == uuid) {
+                return true;
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < adv->uuid32_count; i++) {
+        if (adv->uuid32[i] == uuid) {
+            return true;
+        }
+    }
+
+    for (uint8_t i = 0; i < adv->uuid128_count; i++) {
+        uint32_t short_uuid;
+        if (ble_uuid128_to_short(adv->uuid128[i], &short_uuid) && short_uuid == uuid) {
+            return true;
+        }
+    }
+
+    return false;
+}
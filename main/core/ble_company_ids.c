@@ -0,0 +1,22 @@
+#include "core/ble_company_ids.h"
+#include "ble_company_ids_table.h"     // Generated into the build directory
+
+const char *ble_company_name(uint16_t company_id) {
+#if BLE_COMPANY_TABLE_SIZE <= 0xFFFF
+    if (company_id >= BLE_COMPANY_TABLE_SIZE) {
+        return NULL;
+    }
+#endif
+
+    ble_company_offset_t offset = ble_company_offsets[company_id];
+    return offset != 0 ? &ble_company_names[offset] : NULL;
+}
+
+const char *ble_company_label(uint16_t company_id) {
+    const char *name = ble_company_name(company_id);
+    return name != NULL ? name : "Unknown";
+}
+
+size_t ble_company_count(void) {
+    return BLE_COMPANY_TABLE_COUNT;
+}
@@ -0,0 +1,203 @@
+#include "core/ble_device_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t fnv1a(uint32_t h, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t addr_hash(uint8_t addr_type, const uint8_t *addr) {
+    return fnv1a(fnv1a(2166136261u, &addr_type, 1), addr, 6);
+}
+
+static uint32_t payload_hash(const uint8_t *data, size_t len) {
+    uint32_t h = fnv1a(2166136261u, data, len);
+    // 0 is reserved for "no payload yet"
+    return h != 0 ? h : 1;
+}
+
+bool ble_device_table_init(ble_device_table_t *table, uint32_t capacity) {
+    memset(table, 0, sizeof(*table));
+
+    if (capacity < BLE_DEVICE_TABLE_MAX_PROBE || capacity > BLE_DEVICE_TABLE_MAX_CAPACITY ||
+        (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+
+    table->devices = calloc(capacity, sizeof(ble_device_t));
+    if (table->devices == NULL) {
+        return false;
+    }
+
+    table->capacity = capacity;
+    return true;
+}
+
+uint32_t ble_device_table_capacity_for(uint32_t max_devices) {
+    uint32_t wanted = max_devices + max_devices / 4;
+    uint32_t capacity = BLE_DEVICE_TABLE_MAX_PROBE;
+
+    while (capacity < wanted && capacity < BLE_DEVICE_TABLE_MAX_CAPACITY) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+void ble_device_table_free(ble_device_table_t *table) {
+    free(table->devices);
+    memset(table, 0, sizeof(*table));
+}
+
+void ble_device_table_clear(ble_device_table_t *table) {
+    if (table->devices != NULL) {
+        memset(table->devices, 0, table->capacity * sizeof(ble_device_t));
+    }
+    table->count = 0;
+    table->adverts_seen = 0;
+    table->evictions = 0;
+    table->expired = 0;
+}
+
+ble_device_t *ble_device_table_find(const ble_device_table_t *table, uint8_t addr_type, const uint8_t *addr) {
+    if (table->devices == NULL) {
+        return NULL;
+    }
+
+    uint32_t mask = table->capacity - 1;
+    uint32_t start = addr_hash(addr_type, addr) & mask;
+
+    // Expired slots are simply released, so the whole window is always scanned
+    for (int i = 0; i < BLE_DEVICE_TABLE_MAX_PROBE; i++) {
+        ble_device_t *d = &table->devices[(start + i) & mask];
+        if (d->in_use && d->addr_type == addr_type && memcmp(d->addr, addr, 6) == 0) {
+            return d;
+        }
+    }
+
+    return NULL;
+}
+
+static ble_device_t *claim_slot(ble_device_table_t *table, uint8_t addr_type, const uint8_t *addr, uint32_t now_ms) {
+    uint32_t mask = table->capacity - 1;
+    uint32_t start = addr_hash(addr_type, addr) & mask;
+    ble_device_t *oldest = NULL;
+
+    for (int i = 0; i < BLE_DEVICE_TABLE_MAX_PROBE; i++) {
+        ble_device_t *d = &table->devices[(start + i) & mask];
+        if (!d->in_use) {
+            table->count++;
+            return d;
+        }
+        if (oldest == NULL || (now_ms - d->last_seen_ms) > (now_ms - oldest->last_seen_ms)) {
+            oldest = d;
+        }
+    }
+
+    // Probe window is full, recycle the least recently seen device
+    table->evictions++;
+    return oldest;
+}
+
+ble_device_t *ble_device_table_update(ble_device_table_t *table, uint8_t addr_type, const uint8_t *addr,
+                                      int8_t rssi, bool scan_rsp, const ble_adv_t *adv,
+                                      uint32_t now_ms, ble_device_event_t *event) {
+    *event = BLE_DEVICE_SEEN;
+
+    if (table->devices == NULL) {
+        return NULL;
+    }
+
+    table->adverts_seen++;
+
+    uint32_t hash = payload_hash(adv->raw, adv->raw_len);
+    ble_device_t *d = ble_device_table_find(table, addr_type, addr);
+
+    if (d == NULL) {
+        d = claim_slot(table, addr_type, addr, now_ms);
+        memset(d, 0, sizeof(*d));
+        d->in_use = true;
+        d->addr_type = addr_type;
+        memcpy(d->addr, addr, 6);
+        d->first_seen_ms = now_ms;
+        d->rssi_min = rssi;
+        d->rssi_max = rssi;
+        d->rssi_avg_q4 = (int16_t)(rssi * 16);
+        *event = BLE_DEVICE_NEW;
+    } else {
+        if (now_ms - d->last_seen_ms > BLE_DEVICE_ABSENT_MS) {
+            *event = BLE_DEVICE_RETURNED;
+        }
+
+        if (rssi < d->rssi_min) d->rssi_min = rssi;
+        if (rssi > d->rssi_max) d->rssi_max = rssi;
+        d->rssi_avg_q4 += (int16_t)((rssi * 16 - d->rssi_avg_q4) / 16);
+    }
+
+    uint32_t *last_hash = scan_rsp ? &d->scan_rsp_hash : &d->adv_hash;
+    if (*last_hash != hash) {
+        if (*last_hash != 0) {
+            d->payload_changes++;
+            if (*event == BLE_DEVICE_SEEN) {
+                *event = BLE_DEVICE_CHANGED;
+            }
+        }
+        *last_hash = hash;
+    }
+
+    if (adv->name[0] != '\0') {
+        memcpy(d->name, adv->name, sizeof(d->name));
+    }
+    if (adv->has_mfg) {
+        d->has_mfg = true;
+        d->company_id = adv->company_id;
+    }
+
+    d->rssi = rssi;
+    d->adv_count++;
+    d->last_seen_ms = now_ms;
+    return d;
+}
+
+uint32_t ble_device_table_expire(ble_device_table_t *table, uint32_t now_ms, uint32_t max_age_ms) {
+    uint32_t dropped = 0;
+
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        ble_device_t *d = &table->devices[i];
+        if (d->in_use && now_ms - d->last_seen_ms > max_age_ms) {
+            d->in_use = false;
+            dropped++;
+        }
+    }
+
+    table->count -= dropped;
+    table->expired += dropped;
+    return dropped;
+}
+
+static const ble_device_table_t *sort_table;
+
+static int compare_devices(const void *a, const void *b) {
+    uint32_t x = sort_table->devices[*(const uint32_t *)a].last_seen_ms;
+    uint32_t y = sort_table->devices[*(const uint32_t *)b].last_seen_ms;
+
+    // Descending
+    return (x < y) - (x > y);
+}
+
+size_t ble_device_table_sort(const ble_device_table_t *table, uint32_t *order, size_t max) {
+    size_t count = 0;
+
+    for (uint32_t i = 0; i < table->capacity && count < max; i++) {
+        if (table->devices[i].in_use) {
+            order[count++] = i;
+        }
+    }
+
+    sort_table = table;
+    qsort(order, count, sizeof(order[0]), compare_devices);
+    return count;
+}
@@ -0,0 +1,82 @@
+#include "core/ble_lifecycle.h"
+#include <string.h>
+
+static const char *state_names[] = { "off", "starting", "on", "stopping" };
+
+void ble_lifecycle_init(ble_lifecycle_t *lc, const ble_lifecycle_ops_t *ops, uint32_t idle_timeout_ms) {
+    memset(lc, 0, sizeof(*lc));
+    lc->ops = *ops;
+    lc->idle_timeout_ms = idle_timeout_ms;
+}
+
+int ble_lifecycle_acquire(ble_lifecycle_t *lc) {
+    if (lc->state == BLE_STACK_STARTING || lc->state == BLE_STACK_STOPPING) {
+        return -1;
+    }
+
+    if (lc->state == BLE_STACK_OFF) {
+        lc->state = BLE_STACK_STARTING;
+        int rc = lc->ops.start(lc->ops.ctx);
+        if (rc != 0) {
+            lc->state = BLE_STACK_OFF;
+            lc->failures++;
+            return rc;
+        }
+        lc->state = BLE_STACK_ON;
+        lc->starts++;
+    }
+
+    lc->users++;
+    return 0;
+}
+
+void ble_lifecycle_release(ble_lifecycle_t *lc, uint32_t now_ms) {
+    if (lc->users == 0) {
+        return;
+    }
+
+    if (--lc->users == 0) {
+        lc->idle_since_ms = now_ms;
+    }
+}
+
+static bool stop_stack(ble_lifecycle_t *lc) {
+    lc->state = BLE_STACK_STOPPING;
+    if (lc->ops.stop(lc->ops.ctx) != 0) {
+        // Leave it up rather than guess how far the teardown got
+        lc->state = BLE_STACK_ON;
+        lc->failures++;
+        return false;
+    }
+
+    lc->state = BLE_STACK_OFF;
+    lc->stops++;
+    return true;
+}
+
+bool ble_lifecycle_poll(ble_lifecycle_t *lc, uint32_t now_ms) {
+    if (ble_lifecycle_idle_remaining_ms(lc, now_ms) != 0) {
+        return false;
+    }
+    return stop_stack(lc);
+}
+
+bool ble_lifecycle_shutdown(ble_lifecycle_t *lc) {
+    if (lc->state != BLE_STACK_ON || lc->users != 0) {
+        return false;
+    }
+    return stop_stack(lc);
+}
+
+uint32_t ble_lifecycle_idle_remaining_ms(const ble_lifecycle_t *lc, uint32_t now_ms) {
+    if (lc->state != BLE_STACK_ON || lc->users != 0) {
+        return UINT32_MAX;
+    }
+
+    uint32_t idle_ms = now_ms - lc->idle_since_ms;
+    return idle_ms >= lc->idle_timeout_ms ? 0 : lc->idle_timeout_ms - idle_ms;
+}
+
+const char *ble_stack_state_name(ble_stack_state_t state) {
+    return state <= BLE_STACK_STOPPING ? state_names[state] : "unknown";
+}
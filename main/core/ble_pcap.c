@@ -0,0 +1,130 @@
+#include "core/ble_pcap.h"
+#include <string.h>
+
+// HCI LE advertising report event types
+#define REPORT_ADV_IND          0x00
+#define REPORT_ADV_DIRECT_IND   0x01
+#define REPORT_ADV_SCAN_IND     0x02
+#define REPORT_ADV_NONCONN_IND  0x03
+#define REPORT_SCAN_RSP         0x04
+
+#define PDU_HDR_TXADD 0x40
+
+static uint32_t reverse24(uint32_t v) {
+    uint32_t r = 0;
+    for (int i = 0; i < 24; i++) {
+        r = (r << 1) | ((v >> i) & 1);
+    }
+    return r;
+}
+
+uint32_t ble_ll_crc(const uint8_t *pdu, size_t len, uint32_t crc_init) {
+    // Polynomial x^24 + x^10 + x^9 + x^6 + x^4 + x^3 + x + 1, run least
+    // significant bit first like the radio, so the register is kept reflected
+    uint32_t state = reverse24(crc_init);
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t cur = pdu[i];
+        for (int bit = 0; bit < 8; bit++) {
+            uint32_t feedback = (state ^ cur) & 1;
+            cur >>= 1;
+            state >>= 1;
+            if (feedback) {
+                state |= 1u << 23;
+                state ^= 0x5A6000;
+            }
+        }
+    }
+
+    return state;
+}
+
+int ble_pdu_type_from_report(uint8_t report_event_type) {
+    switch (report_event_type) {
+        case REPORT_ADV_IND:         return BLE_PDU_ADV_IND;
+        case REPORT_ADV_DIRECT_IND:  return BLE_PDU_ADV_DIRECT_IND;
+        case REPORT_ADV_SCAN_IND:    return BLE_PDU_ADV_SCAN_IND;
+        case REPORT_ADV_NONCONN_IND: return BLE_PDU_ADV_NONCONN_IND;
+        case REPORT_SCAN_RSP:        return BLE_PDU_SCAN_RSP;
+        default:                     return -1;
+    }
+}
+
+static void put_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    put_le16(p, (uint16_t)v);
+    put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+size_t ble_pcap_build_adv(uint8_t *out, size_t out_size, uint8_t report_event_type, bool random_addr,
+                          const uint8_t *addr, const uint8_t *direct_addr, const uint8_t *data, size_t len,
+                          int8_t rssi, int rf_channel) {
+    int pdu_type = ble_pdu_type_from_report(report_event_type);
+    if (pdu_type < 0) {
+        return 0;
+    }
+
+    // Directed adverts carry the target address instead of data
+    size_t payload_len = pdu_type == BLE_PDU_ADV_DIRECT_IND ? 12 : 6 + len;
+    if (len > BLE_PCAP_MAX_ADV_DATA || BLE_PCAP_PHDR_LEN + 4 + 2 + payload_len + 3 > out_size) {
+        return 0;
+    }
+
+    uint16_t flags = BLE_PHDR_FLAG_DEWHITENED | BLE_PHDR_FLAG_SIGNAL_VALID | BLE_PHDR_FLAG_REF_AA_VALID |
+                     BLE_PHDR_FLAG_CRC_CHECKED | BLE_PHDR_FLAG_CRC_VALID;
+
+    // The pseudo header wants the RF channel: 37 is RF 0, 38 is RF 12, 39 is RF 39.
+    // Scan reports do not say which channel they came from, so mark it aliased.
+    uint8_t rf = 0;
+    if (rf_channel == 38) {
+        rf = 12;
+    } else if (rf_channel == 39) {
+        rf = 39;
+    } else if (rf_channel != 37) {
+        flags |= BLE_PHDR_FLAG_CHANNEL_ALIASED;
+    }
+
+    uint8_t *p = out;
+    p[0] = rf;
+    p[1] = (uint8_t)rssi;
+    p[2] = 0;                       // Noise power, not valid
+    p[3] = 0;                       // Access address offenses
+    put_le32(&p[4], BLE_ADV_ACCESS_ADDRESS);
+    put_le16(&p[8], flags);
+    p += BLE_PCAP_PHDR_LEN;
+
+    put_le32(p, BLE_ADV_ACCESS_ADDRESS);
+    p += 4;
+
+    uint8_t *pdu = p;
+    p[0] = (uint8_t)pdu_type | (random_addr ? PDU_HDR_TXADD : 0);
+    p[1] = (uint8_t)payload_len;
+    p += 2;
+
+    memcpy(p, addr, 6);
+    p += 6;
+
+    if (pdu_type == BLE_PDU_ADV_DIRECT_IND) {
+        if (direct_addr != NULL) {
+            memcpy(p, direct_addr, 6);
+        } else {
+            memset(p, 0, 6);
+        }
+        p += 6;
+    } else {
+        memcpy(p, data, len);
+        p += len;
+    }
+
+    uint32_t crc = ble_ll_crc(pdu, (size_t)(p - pdu), BLE_ADV_CRC_INIT);
+    p[0] = (uint8_t)crc;
+    p[1] = (uint8_t)(crc >> 8);
+    p[2] = (uint8_t)(crc >> 16);
+    p += 3;
+
+    return (size_t)(p - out);
+}
@@ -0,0 +1,258 @@
+#include "core/ble_spam_detector.h"
+#include <string.h>
+
+#define COMPANY_APPLE      0x004C
+#define COMPANY_MICROSOFT  0x0006
+#define COMPANY_SAMSUNG    0x0075
+#define UUID_FAST_PAIR     0xFE2C
+
+#define APPLE_TYPE_PROXIMITY_PAIRING 0x07
+#define APPLE_TYPE_NEARBY_ACTION     0x0F
+#define SWIFT_PAIR_BEACON            0x03
+
+// Class key layout: source tag, 16-bit company ID or UUID, first payload byte
+#define KEY_MFG          0x01000000u
+#define KEY_SERVICE      0x02000000u
+#define KEY_NONE         0x03000000u
+
+static const char *type_names[BLE_SPAM_TYPE_COUNT] = {
+    "Address flood", "Apple popup", "Apple action", "Swift Pair", "Samsung EasySetup", "Fast Pair", "Multi-vendor"
+};
+
+static const char *intensity_names[] = { "low", "medium", "high" };
+
+static const uint32_t row_seeds[BLE_SPAM_SKETCH_DEPTH] = {
+    0x9E3779B1u, 0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu
+};
+
+static uint32_t mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint32_t addr_bit(const uint8_t *addr) {
+    // FNV-1a over the address
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        h ^= addr[i];
+        h *= 16777619u;
+    }
+    return mix32(h) & (BLE_SPAM_ADDR_BITS - 1);
+}
+
+void ble_spam_detector_init(ble_spam_detector_t *det, uint32_t window_ms, uint32_t threshold, uint32_t holdoff_ms) {
+    memset(det, 0, sizeof(*det));
+    det->window_ms = window_ms;
+    det->threshold = threshold;
+    det->holdoff_ms = holdoff_ms;
+}
+
+ble_spam_type_t ble_spam_classify(const ble_adv_t *adv, uint32_t *key, uint16_t *company_id) {
+    if (adv->has_mfg) {
+        uint8_t first = adv->mfg_len > 0 ? adv->mfg_data[0] : 0;
+        *company_id = adv->company_id;
+        *key = KEY_MFG | ((uint32_t)adv->company_id << 8) | first;
+
+        switch (adv->company_id) {
+            case COMPANY_APPLE:
+                if (first == APPLE_TYPE_PROXIMITY_PAIRING) return BLE_SPAM_APPLE_POPUP;
+                if (first == APPLE_TYPE_NEARBY_ACTION) return BLE_SPAM_APPLE_ACTION;
+                break;
+            case COMPANY_MICROSOFT:
+                if (first == SWIFT_PAIR_BEACON) return BLE_SPAM_SWIFT_PAIR;
+                break;
+            case COMPANY_SAMSUNG:
+                return BLE_SPAM_SAMSUNG;
+            default:
+                break;
+        }
+        return BLE_SPAM_GENERIC;
+    }
+
+    if (adv->service_data_count > 0) {
+        const ble_adv_service_data_t *sd = &adv->service_data[0];
+        *company_id = sd->uuid;
+        *key = KEY_SERVICE | ((uint32_t)sd->uuid << 8);
+        return sd->uuid == UUID_FAST_PAIR ? BLE_SPAM_FAST_PAIR : BLE_SPAM_GENERIC;
+    }
+
+    *company_id = 0;
+    *key = KEY_NONE;
+    return BLE_SPAM_GENERIC;
+}
+
+static uint16_t sketch_add(ble_spam_detector_t *det, uint32_t key) {
+    uint16_t estimate = UINT16_MAX;
+
+    for (int row = 0; row < BLE_SPAM_SKETCH_DEPTH; row++) {
+        uint32_t col = mix32(key ^ row_seeds[row]) & (BLE_SPAM_SKETCH_WIDTH - 1);
+        uint16_t *counter = &det->sketch[row][col];
+        if (*counter < UINT16_MAX) {
+            (*counter)++;
+        }
+        if (*counter < estimate) {
+            estimate = *counter;
+        }
+    }
+
+    return estimate;
+}
+
+static void track_candidate(ble_spam_detector_t *det, uint32_t key, uint16_t estimate,
+                            ble_spam_type_t type, uint16_t company_id) {
+    ble_spam_candidate_t *smallest = NULL;
+
+    for (int i = 0; i < det->candidate_count; i++) {
+        ble_spam_candidate_t *c = &det->candidates[i];
+        if (c->key == key) {
+            c->count = estimate;
+            return;
+        }
+        if (smallest == NULL || c->count < smallest->count) {
+            smallest = c;
+        }
+    }
+
+    ble_spam_candidate_t *slot;
+    if (det->candidate_count < BLE_SPAM_CANDIDATES) {
+        slot = &det->candidates[det->candidate_count++];
+    } else if (estimate > smallest->count) {
+        slot = smallest;
+    } else {
+        return;
+    }
+
+    slot->key = key;
+    slot->count = estimate;
+    slot->type = (uint8_t)type;
+    slot->company_id = company_id;
+}
+
+static bool may_report(ble_spam_detector_t *det, ble_spam_type_t type, uint32_t now_ms) {
+    if (det->reported[type] && now_ms - det->last_report_ms[type] < det->holdoff_ms) {
+        return false;
+    }
+    det->reported[type] = true;
+    det->last_report_ms[type] = now_ms;
+    return true;
+}
+
+static void fill_report(const ble_spam_detector_t *det, ble_spam_report_t *report, ble_spam_type_t type,
+                        uint16_t company_id, bool has_company, uint32_t addresses) {
+    report->type = type;
+    report->company_id = company_id;
+    report->has_company = has_company;
+    report->addresses = addresses;
+    report->adverts = det->window_adverts;
+    report->rate_per_sec = det->window_ms ? addresses * 1000 / det->window_ms : addresses;
+
+    if (addresses >= det->threshold * 10) {
+        report->intensity = BLE_SPAM_INTENSITY_HIGH;
+    } else if (addresses >= det->threshold * 3) {
+        report->intensity = BLE_SPAM_INTENSITY_MEDIUM;
+    } else {
+        report->intensity = BLE_SPAM_INTENSITY_LOW;
+    }
+}
+
+static size_t close_window(ble_spam_detector_t *det, uint32_t now_ms, ble_spam_report_t *reports) {
+    size_t count = 0;
+    bool any_heavy = false;
+    uint32_t spam_types = 0;
+
+    // Every address is new to a freshly started detector
+    if (det->primed) {
+        for (int i = 0; i < det->candidate_count; i++) {
+            const ble_spam_candidate_t *c = &det->candidates[i];
+            ble_spam_type_t type = (ble_spam_type_t)c->type;
+
+            if (type != BLE_SPAM_GENERIC) {
+                spam_types |= 1u << type;
+            }
+
+            // Busy places see bursts of real arrivals, so classes that carry no
+            // known spam payload need a much stronger signal
+            uint32_t threshold = type == BLE_SPAM_GENERIC ? det->threshold * BLE_SPAM_FLOOD_FACTOR : det->threshold;
+            if (c->count < threshold) {
+                continue;
+            }
+            any_heavy = true;
+            if (may_report(det, type, now_ms)) {
+                bool has_company = (c->key & 0xFF000000u) == KEY_MFG;
+                fill_report(det, &reports[count++], type, c->company_id, has_company, c->count);
+            }
+        }
+
+        // Many new addresses, but spread over classes too small to stand out
+        if (!any_heavy && det->window_new_addresses >= det->threshold * BLE_SPAM_FLOOD_FACTOR) {
+            bool multi_vendor = (spam_types & (spam_types - 1)) != 0;
+            ble_spam_type_t type = multi_vendor ? BLE_SPAM_MULTI_VENDOR : BLE_SPAM_GENERIC;
+            if (may_report(det, type, now_ms)) {
+                fill_report(det, &reports[count++], type, 0, false, det->window_new_addresses);
+            }
+        }
+    }
+
+    det->detections += count;
+
+    // Addresses seen in the closing window stay known for one more window;
+    // after a longer gap everything counts as new again
+    bool gap = now_ms - det->window_start_ms >= 2 * det->window_ms;
+    det->addr_current ^= 1;
+    memset(det->addr_seen[det->addr_current], 0, sizeof(det->addr_seen[0]));
+    if (gap) {
+        memset(det->addr_seen[det->addr_current ^ 1], 0, sizeof(det->addr_seen[0]));
+    }
+    det->primed = !gap;
+
+    memset(det->sketch, 0, sizeof(det->sketch));
+    det->candidate_count = 0;
+    det->window_adverts = 0;
+    det->window_new_addresses = 0;
+    det->window_start_ms = now_ms;
+    return count;
+}
+
+size_t ble_spam_detector_update(ble_spam_detector_t *det, const uint8_t *addr, const ble_adv_t *adv,
+                                uint32_t now_ms, ble_spam_report_t *reports) {
+    size_t count = 0;
+
+    if (det->adverts_seen == 0) {
+        det->window_start_ms = now_ms;
+    } else if (now_ms - det->window_start_ms >= det->window_ms) {
+        count = close_window(det, now_ms, reports);
+    }
+
+    det->adverts_seen++;
+    det->window_adverts++;
+
+    uint32_t bit = addr_bit(addr);
+    uint8_t mask = (uint8_t)(1u << (bit & 7));
+    uint8_t *current = &det->addr_seen[det->addr_current][bit >> 3];
+    bool known = (*current & mask) || (det->addr_seen[det->addr_current ^ 1][bit >> 3] & mask);
+    *current |= mask;
+
+    if (known) {
+        return count;
+    }
+
+    det->window_new_addresses++;
+
+    uint32_t key;
+    uint16_t company_id;
+    ble_spam_type_t type = ble_spam_classify(adv, &key, &company_id);
+    track_candidate(det, key, sketch_add(det, key), type, company_id);
+    return count;
+}
+
+const char *ble_spam_type_name(ble_spam_type_t type) {
+    return type < BLE_SPAM_TYPE_COUNT ? type_names[type] : "Unknown";
+}
+
+const char *ble_spam_intensity_name(ble_spam_intensity_t intensity) {
+    return intensity <= BLE_SPAM_INTENSITY_HIGH ? intensity_names[intensity] : "unknown";
+}
@@ -2,24 +2,38 @@
 #include "managers/wifi_manager.h"
 #include <esp_log.h>
 #include <string.h>
+#include <stdio.h>
 #include "vendor/pcap.h"
+#include "core/deauth_detector.h"
+#include "core/rogue_ap_detector.h"
+#include "core/pwnagotchi.h"
+#include "core/probe_tracker.h"
+#include "managers/sd_card_manager.h"
+#include <stdlib.h>
+#include "managers/alert_manager.h"
+#include <esp_timer.h>
+
+// Include Outside so we have access to the Terminal View Macro
+#include "managers/views/terminal_screen.h"
 
-#define WPS_OUI 0x0050f204 
 #define TAG "WIFI_MONITOR"
-#define WPS_CONF_METHODS_PBC        0x0080
-#define WPS_CONF_METHODS_PIN_DISPLAY 0x0004
-#define WPS_CONF_METHODS_PIN_KEYPAD  0x0008
 #define WIFI_PKT_DEAUTH 0x0C // Deauth subtype
+#define WIFI_PKT_DISASSOC 0x0A // Disassociation subtype
 #define WIFI_PKT_BEACON 0x08 // Beacon subtype
 #define WIFI_PKT_PROBE_REQ 0x04  // Probe Request subtype
 #define WIFI_PKT_PROBE_RESP 0x05 // Probe Response subtype
 #define WIFI_PKT_EAPOL 0x80
 
-wps_network_t detected_wps_networks[MAX_WPS_NETWORKS];
-int detected_network_count = 0;
+wps_set_t detected_wps_networks;
 esp_timer_handle_t stop_timer;
 int should_store_wps = 1;
 
+static deauth_detector_t deauth_detector;
+static rogue_ap_detector_t rogue_ap_detector;
+static pwnagotchi_table_t pwnagotchi_table;
+static probe_tracker_t *probe_tracker = NULL; // Allocated on the first probe capture
+static char pwnagotchi_json[PWNAGOTCHI_MAX_PAYLOAD]; // Only touched from the promiscuous callback
+
 bool compare_bssid(const uint8_t *bssid1, const uint8_t *bssid2) {
     for (int i = 0; i < 6; i++) {
         if (bssid1[i] != bssid2[i]) {
@@ -29,15 +43,6 @@ bool compare_bssid(const uint8_t *bssid1, const uint8_t *bssid2) {
     return true;
 }
 
-bool is_network_duplicate(const char *ssid, const uint8_t *bssid) {
-    for (int i = 0; i < detected_network_count; i++) {
-        if (strcmp(detected_wps_networks[i].ssid, ssid) == 0 && compare_bssid(detected_wps_networks[i].bssid, bssid)) {
-            return true;
-        }
-    }
-    return false;
-}
-
 void get_frame_type_and_subtype(const wifi_promiscuous_pkt_t *pkt, uint8_t *frame_type, uint8_t *frame_subtype) {
     if (pkt->rx_ctrl.sig_len < 24) {
         *frame_type = 0xFF;
@@ -68,6 +73,13 @@ bool is_deauth_packet(const wifi_promiscuous_pkt_t *pkt) {
 }
 
 
+bool is_disassoc_packet(const wifi_promiscuous_pkt_t *pkt) {
+    uint8_t frame_type, frame_subtype;
+    get_frame_type_and_subtype(pkt, &frame_type, &frame_subtype);
+    return (frame_type == WIFI_PKT_MGMT && frame_subtype == WIFI_PKT_DISASSOC);
+}
+
+
 bool is_probe_request(const wifi_promiscuous_pkt_t *pkt) {
     uint8_t frame_type, frame_subtype;
     get_frame_type_and_subtype(pkt, &frame_type, &frame_subtype);
@@ -94,14 +106,7 @@ bool is_eapol_response(const wifi_promiscuous_pkt_t *pkt) {
 }
 
 bool is_pwn_response(const wifi_promiscuous_pkt_t *pkt) {
-    const uint8_t *frame = pkt->payload;
-    
-    if (frame[0] == 0x80)
-    {
-        return true;
-    }
-
-    return false;
+    return pwnagotchi_is_beacon(pkt->payload, wifi_frame_len(pkt));
 }
 
 
@@ -132,13 +137,159 @@ void wifi_probe_scan_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
 
     
     if (is_probe_request(pkt) || is_probe_response(pkt)) {
-        ESP_LOGI(TAG, "Probe packet detected, length: %d", pkt->rx_ctrl.sig_len);
-        
         esp_err_t ret = pcap_write_packet_to_buffer(pkt->payload, pkt->rx_ctrl.sig_len);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to write Probe packet to PCAP buffer.");
         }
     }
+
+    if (probe_tracker != NULL && is_probe_request(pkt)) {
+        probe_update_t update;
+
+        probe_tracker_update(probe_tracker, pkt->payload, wifi_frame_len(pkt), pkt->rx_ctrl.rssi,
+                             (uint32_t)(esp_timer_get_time() / 1000), &update);
+
+        if (update.new_ssid) {
+            const uint8_t *mac = update.device->mac;
+            printf("Probe: %02X:%02X:%02X:%02X:%02X:%02X%s -> \"%s\" (%d dBm)\n",
+                   mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+                   update.device->randomized ? " (random)" : "", update.ssid, pkt->rx_ctrl.rssi);
+            TERMINAL_VIEW_ADD_TEXT("%02X:%02X:%02X:%02X:%02X:%02X -> %s\n",
+                   mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], update.ssid);
+        }
+    }
+}
+
+esp_err_t wifi_probe_tracker_reset(void) {
+    if (probe_tracker == NULL) {
+        probe_tracker = malloc(sizeof(probe_tracker_t));
+        if (probe_tracker == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate probe tracker");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    probe_tracker_init(probe_tracker);
+    return ESP_OK;
+}
+
+void wifi_probe_tracker_feed(const wifi_promiscuous_pkt_t *pkt) {
+    if (probe_tracker == NULL || !is_probe_request(pkt)) {
+        return;
+    }
+
+    probe_update_t update;
+    probe_tracker_update(probe_tracker, pkt->payload, wifi_frame_len(pkt), pkt->rx_ctrl.rssi,
+                         (uint32_t)(esp_timer_get_time() / 1000), &update);
+}
+
+const probe_tracker_t *wifi_probe_tracker_get(void) {
+    return probe_tracker;
+}
+
+static void print_probe_clusters(void) {
+    printf("Randomized MAC clusters (same probe IE fingerprint):\n");
+
+    int shown = 0;
+    for (int i = 0; i < PROBE_TRACKER_MAX_CLUSTERS; i++) {
+        const probe_cluster_t *c = &probe_tracker->clusters[i];
+        if (!c->in_use || c->mac_count < 2) {
+            continue;
+        }
+        printf("  %08lx: %u MACs, last seen %lus ago\n", (unsigned long)c->fingerprint, c->mac_count,
+               (unsigned long)(((uint32_t)(esp_timer_get_time() / 1000) - c->last_seen_ms) / 1000));
+        TERMINAL_VIEW_ADD_TEXT("Cluster %08lx: %u MACs\n", (unsigned long)c->fingerprint, c->mac_count);
+        shown++;
+    }
+
+    if (shown == 0) {
+        printf("  none\n");
+    }
+}
+
+static void export_probes_json(void) {
+    static char device_json[1024];
+    FILE *f = NULL;
+
+    if (sd_card_manager.is_initialized) {
+        f = fopen(PROBES_JSON_PATH, "w");
+        if (f == NULL) {
+            ESP_LOGE(TAG, "Failed to open %s", PROBES_JSON_PATH);
+        }
+    }
+
+    printf("[");
+    if (f) fputc('[', f);
+
+    bool first = true;
+    for (int i = 0; i < PROBE_TRACKER_MAX_DEVICES; i++) {
+        const probe_device_t *d = &probe_tracker->devices[i];
+        if (!d->in_use || probe_tracker_format_json(probe_tracker, d, device_json, sizeof(device_json)) == 0) {
+            continue;
+        }
+        printf("%s%s", first ? "\n" : ",\n", device_json);
+        if (f) fprintf(f, "%s%s", first ? "" : ",", device_json);
+        first = false;
+    }
+
+    printf("\n]\n");
+    if (f) {
+        fputs("]\n", f);
+        fclose(f);
+        printf("Saved to %s\n", PROBES_JSON_PATH);
+    }
+}
+
+void wifi_probe_tracker_print(bool json, bool clusters) {
+    if (probe_tracker == NULL || probe_tracker->device_count == 0) {
+        printf("No probe requests recorded, start one with capture -probe\n");
+        TERMINAL_VIEW_ADD_TEXT("No probe requests recorded\n");
+        return;
+    }
+
+    if (json) {
+        export_probes_json();
+        return;
+    }
+
+    if (clusters) {
+        print_probe_clusters();
+        return;
+    }
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    printf("%lu devices, %lu probe requests (%lu devices / %lu SSIDs evicted):\n",
+           (unsigned long)probe_tracker->device_count, (unsigned long)probe_tracker->frames_seen,
+           (unsigned long)probe_tracker->device_evictions, (unsigned long)probe_tracker->ssid_evictions);
+
+    for (int i = 0; i < PROBE_TRACKER_MAX_DEVICES; i++) {
+        const probe_device_t *d = &probe_tracker->devices[i];
+        if (!d->in_use) {
+            continue;
+        }
+
+        const probe_cluster_t *c = d->randomized ? probe_tracker_cluster(probe_tracker, d->fingerprint) : NULL;
+
+        printf("%02X:%02X:%02X:%02X:%02X:%02X %s probes %lu RSSI %d (max %d) seen %lus ago fp %08lx",
+               d->mac[0], d->mac[1], d->mac[2], d->mac[3], d->mac[4], d->mac[5],
+               d->randomized ? "random" : "global", (unsigned long)d->probes, d->rssi, d->rssi_max,
+               (unsigned long)((now_ms - d->last_seen_ms) / 1000), (unsigned long)d->fingerprint);
+        if (c != NULL && c->mac_count > 1) {
+            printf(" (cluster of %u)", c->mac_count);
+        }
+        printf("\n");
+
+        for (int j = 0; j < d->ssid_count; j++) {
+            const char *ssid = probe_tracker_ssid(probe_tracker, &d->ssids[j]);
+            if (ssid == NULL) {
+                continue;
+            }
+            printf("    \"%s\" x%u, %d dBm\n", ssid, d->ssids[j].count, d->ssids[j].rssi);
+            TERMINAL_VIEW_ADD_TEXT("%02X:%02X:%02X:%02X:%02X:%02X %s\n",
+                                   d->mac[0], d->mac[1], d->mac[2], d->mac[3], d->mac[4], d->mac[5], ssid);
+        }
+    }
 }
 
 
@@ -159,150 +310,247 @@ void wifi_beacon_scan_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
 
 
 void wifi_pwn_scan_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
+    if (type != WIFI_PKT_MGMT) {
+        return;
+    }
+
     wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)buf;
 
-    
-    if (is_pwn_response(pkt)) {
-        ESP_LOGI(TAG, "Pwn packet detected, length: %d", pkt->rx_ctrl.sig_len);
+    if (!is_pwn_response(pkt)) {
+        return;
+    }
 
-        
-        esp_err_t ret = pcap_write_packet_to_buffer(pkt->payload, pkt->rx_ctrl.sig_len);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to write pwn packet to PCAP buffer.");
-        }
+    esp_err_t ret = pcap_write_packet_to_buffer(pkt->payload, pkt->rx_ctrl.sig_len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write pwn packet to PCAP buffer.");
     }
+
+    pwnagotchi_info_t info;
+    int json_len = pwnagotchi_reassemble(pkt->payload, wifi_frame_len(pkt), pwnagotchi_json, sizeof(pwnagotchi_json));
+    if (json_len < 0 || !pwnagotchi_parse_json(pwnagotchi_json, (size_t)json_len, &info)) {
+        pwnagotchi_table.malformed++;
+        return;
+    }
+
+    bool is_new;
+    pwnagotchi_table_update(&pwnagotchi_table, &info, pkt->rx_ctrl.rssi, pkt->rx_ctrl.channel,
+                            (uint32_t)(esp_timer_get_time() / 1000), &is_new);
+
+    // Only announce each device once, they beacon every few seconds
+    if (is_new) {
+        printf("Pwnagotchi found: %s (v%s) pwnd %lu/%lu RSSI %d ch %d\n  identity: %s\n",
+               info.name, info.version[0] ? info.version : "?",
+               (unsigned long)info.pwnd_run, (unsigned long)info.pwnd_tot,
+               pkt->rx_ctrl.rssi, pkt->rx_ctrl.channel, info.identity[0] ? info.identity : "unknown");
+        TERMINAL_VIEW_ADD_TEXT("Pwnagotchi: %s v%s pwnd %lu/%lu\n",
+               info.name, info.version[0] ? info.version : "?",
+               (unsigned long)info.pwnd_run, (unsigned long)info.pwnd_tot);
+    }
+}
+
+void wifi_pwn_table_reset(void) {
+    pwnagotchi_table_init(&pwnagotchi_table);
 }
 
 
+void wifi_deauth_detector_reset(void) {
+    deauth_detector_init(&deauth_detector, DEAUTH_DETECTOR_DEFAULT_THRESHOLD, DEAUTH_DETECTOR_DEFAULT_HOLDOFF_MS);
+}
+
+static void report_deauth_alert(const deauth_alert_t *alert) {
+    char reasons[96];
+    deauth_detector_format_reasons(alert->reason_hist, reasons, sizeof(reasons));
+
+    alert_manager_post(ALERT_SEVERITY_CRITICAL, "DEAUTH",
+        "%s flood %s %02X:%02X:%02X:%02X:%02X:%02X (last %s %02X:%02X:%02X:%02X:%02X:%02X): "
+        "%lu frames/%ds, %lu/s, deauth=%lu disassoc=%lu, reasons [%s]",
+        alert->disassoc_count > alert->deauth_count ? "Disassoc" : "Deauth",
+        alert->key_type == DEAUTH_KEY_BSSID ? "against BSSID" : "from source",
+        alert->target[0], alert->target[1], alert->target[2],
+        alert->target[3], alert->target[4], alert->target[5],
+        alert->key_type == DEAUTH_KEY_BSSID ? "src" : "BSSID",
+        alert->peer[0], alert->peer[1], alert->peer[2],
+        alert->peer[3], alert->peer[4], alert->peer[5],
+        (unsigned long)alert->frames_in_window,
+        (DEAUTH_DETECTOR_BUCKETS * DEAUTH_DETECTOR_BUCKET_MS) / 1000,
+        (unsigned long)alert->rate_per_sec,
+        (unsigned long)alert->deauth_count, (unsigned long)alert->disassoc_count,
+        reasons);
+}
+
 void wifi_deauth_scan_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
     wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)buf;
 
-    
-    if (is_deauth_packet(pkt)) {
-        ESP_LOGI(TAG, "Deauth packet detected, length: %d", pkt->rx_ctrl.sig_len);
-        
-        esp_err_t ret = pcap_write_packet_to_buffer(pkt->payload, pkt->rx_ctrl.sig_len);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to write deauth packet to PCAP buffer.");
+    bool deauth = is_deauth_packet(pkt);
+    if (!deauth && !is_disassoc_packet(pkt)) {
+        return;
+    }
+
+    esp_err_t ret = pcap_write_packet_to_buffer(pkt->payload, pkt->rx_ctrl.sig_len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write deauth packet to PCAP buffer.");
+    }
+
+    if (pkt->rx_ctrl.sig_len < 26) {
+        return;
+    }
+
+    const wifi_ieee80211_mac_hdr_t *hdr = (const wifi_ieee80211_mac_hdr_t *)pkt->payload;
+    uint16_t reason = pkt->payload[24] | (pkt->payload[25] << 8);
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    deauth_alert_t alerts[2];
+    int alert_count = deauth_detector_process(&deauth_detector, hdr->addr3, hdr->addr2,
+                                              deauth ? DEAUTH_SUBTYPE_DEAUTH : DEAUTH_SUBTYPE_DISASSOC,
+                                              reason, now_ms, alerts);
+    for (int i = 0; i < alert_count; i++) {
+        report_deauth_alert(&alerts[i]);
+    }
+}
+
+esp_err_t wifi_rogue_ap_load_allowlist(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open allowlist %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    rogue_ap_init(&rogue_ap_detector);
+
+    char line[160];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_number++;
+
+        rogue_ap_entry_t entry;
+        if (!rogue_ap_parse_allowlist_line(line, &entry)) {
+            if (line[strspn(line, " \t\r\n")] != '\0' && line[strspn(line, " \t")] != '#') {
+                ESP_LOGW(TAG, "Allowlist line %d ignored (expected SSID,BSSID,SECURITY[,CHANNEL])", line_number);
+            }
+            continue;
+        }
+
+        if (!rogue_ap_add_entry(&rogue_ap_detector, &entry)) {
+            ESP_LOGW(TAG, "Allowlist full, line %d ignored", line_number);
         }
     }
+
+    fclose(f);
+
+    ESP_LOGI(TAG, "Loaded %lu allowlist entries from %s", (unsigned long)rogue_ap_detector.entry_count, path);
+    return rogue_ap_detector.entry_count > 0 ? ESP_OK : ESP_ERR_INVALID_SIZE;
 }
 
-void wifi_wps_detection_callback(void *buf, wifi_promiscuous_pkt_type_t type) {
+void wifi_rogue_ap_callback(void *buf, wifi_promiscuous_pkt_type_t type) {
     if (type != WIFI_PKT_MGMT) {
         return;
     }
 
     const wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)buf;
-    const wifi_ieee80211_packet_t *ipkt = (wifi_ieee80211_packet_t *)pkt->payload;
-    const wifi_ieee80211_mac_hdr_t *hdr = &ipkt->hdr;
 
-    const uint8_t *payload = pkt->payload;
-    int len = pkt->rx_ctrl.sig_len;
+    rogue_ap_beacon_t beacon;
+    if (!rogue_ap_parse_beacon(pkt->payload, wifi_frame_len(pkt), &beacon)) {
+        return;
+    }
 
-   
-    uint8_t frame_type = hdr->frame_ctrl & 0xFC;
-    if (frame_type != 0x80 && frame_type != 0x50) {
+    if (beacon.channel == 0) {
+        beacon.channel = pkt->rx_ctrl.channel;
+    }
+
+    rogue_ap_alert_t alert;
+    if (!rogue_ap_check(&rogue_ap_detector, &beacon, (uint32_t)(esp_timer_get_time() / 1000), &alert)) {
         return;
     }
 
-    
-    int index = 36;
-    char ssid[33] = {0};
-    bool wps_found = false;
-    uint8_t bssid[6];
-    memcpy(bssid, hdr->addr3, 6);
+    char reasons[48];
+    snprintf(reasons, sizeof(reasons), "%s%s%s%s",
+             (alert.reasons & ROGUE_AP_REASON_UNKNOWN_BSSID) ? " unknown-bssid" : "",
+             (alert.reasons & ROGUE_AP_REASON_OUI) ? " foreign-oui" : "",
+             (alert.reasons & ROGUE_AP_REASON_SECURITY) ? " security" : "",
+             (alert.reasons & ROGUE_AP_REASON_CHANNEL) ? " channel" : "");
+
+    alert_manager_post((alert.reasons & ROGUE_AP_REASON_UNKNOWN_BSSID) ? ALERT_SEVERITY_CRITICAL : ALERT_SEVERITY_WARNING,
+        "ROGUE_AP",
+        "SSID '%s' from %02X:%02X:%02X:%02X:%02X:%02X ch %u %s (allowlist: %s ch %u), reasons:%s",
+        alert.beacon.ssid,
+        alert.beacon.bssid[0], alert.beacon.bssid[1], alert.beacon.bssid[2],
+        alert.beacon.bssid[3], alert.beacon.bssid[4], alert.beacon.bssid[5],
+        alert.beacon.channel, rogue_ap_security_name(alert.beacon.security),
+        rogue_ap_security_name(alert.expected_security), alert.expected_channel,
+        reasons);
+}
 
-    
-    while (index + 1 < len) {
-        uint8_t id = payload[index];
-        uint8_t ie_len = payload[index + 1];
+esp_err_t wifi_wps_set_reset(uint32_t capacity) {
+    if (detected_wps_networks.capacity == capacity) {
+        wps_set_clear(&detected_wps_networks);
+        return ESP_OK;
+    }
 
-       
-        if (index + 2 + ie_len > len) {
-            break;
-        }
+    wps_set_free(&detected_wps_networks);
+    if (!wps_set_init(&detected_wps_networks, capacity)) {
+        ESP_LOGE(TAG, "Failed to allocate WPS table for %lu networks", (unsigned long)capacity);
+        return ESP_ERR_NO_MEM;
+    }
 
+    return ESP_OK;
+}
 
-        if (id == 0 && ie_len <= 32) {
-            memcpy(ssid, &payload[index + 2], ie_len);
-            ssid[ie_len] = '\0';
-        }
+void wifi_wps_detection_callback(void *buf, wifi_promiscuous_pkt_type_t type) {
+    if (type != WIFI_PKT_MGMT) {
+        return;
+    }
 
+    const wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)buf;
+    const wifi_ieee80211_packet_t *ipkt = (wifi_ieee80211_packet_t *)pkt->payload;
+    const wifi_ieee80211_mac_hdr_t *hdr = &ipkt->hdr;
+
+    uint8_t frame_type = hdr->frame_ctrl & 0xFC;
+    if (frame_type != 0x80 && frame_type != 0x50) {
+        return;
+    }
 
-        if (is_network_duplicate(ssid, bssid)) {
-            return;
+    // Attributes are only parsed the first time a BSSID shows up
+    if (wps_set_find(&detected_wps_networks, hdr->addr3) != NULL) {
+        if (should_store_wps == 0) {
+            pcap_write_packet_to_buffer(pkt->payload, pkt->rx_ctrl.sig_len);
         }
+        return;
+    }
 
+    wps_network_t parsed;
+    if (!wps_parse_frame(pkt->payload, wifi_frame_len(pkt), &parsed)) {
+        return;
+    }
 
-        if (id == 221 && ie_len >= 4) {
-            uint32_t oui = (payload[index + 2] << 16) | (payload[index + 3] << 8) | payload[index + 4];
-            uint8_t oui_type = payload[index + 5];
-
-           
-            if (oui == 0x0050f2 && oui_type == 0x04) {
-                wps_found = true;
-
-                
-                int attr_index = index + 6;
-                int wps_ie_end = index + 2 + ie_len;
-
-                while (attr_index + 4 <= wps_ie_end) {
-                    uint16_t attr_id = (payload[attr_index] << 8) | payload[attr_index + 1];
-                    uint16_t attr_len = (payload[attr_index + 2] << 8) | payload[attr_index + 3];
-
-                    
-                    if (attr_len > (wps_ie_end - (attr_index + 4))) {
-                        break;
-                    }
-
-                    
-                    if (attr_id == 0x1008 && attr_len == 2) {
-                        uint16_t config_methods = (payload[attr_index + 4] << 8) | payload[attr_index + 5];
-
-                       
-                        ESP_LOGI(TAG, "Configuration Methods found: 0x%04x", config_methods);
-
-                        
-                        if (config_methods & WPS_CONF_METHODS_PBC) {
-                            ESP_LOGI(TAG, "WPS Push Button detected for network: %s", ssid);
-                        } else if (config_methods & (WPS_CONF_METHODS_PIN_DISPLAY | WPS_CONF_METHODS_PIN_KEYPAD)) {
-                            ESP_LOGI(TAG, "WPS PIN detected for network: %s", ssid);
-                        } else {
-                            ESP_LOGI(TAG, "WPS mode not detected (unknown config method) for network: %s", ssid);
-                        }
-
-
-                        if (should_store_wps == 1)
-                        {
-                            wps_network_t new_network;
-                            strncpy(new_network.ssid, ssid, sizeof(new_network.ssid) - 1);
-                            new_network.ssid[sizeof(new_network.ssid) - 1] = '\0';  // Ensure null termination
-                            memcpy(new_network.bssid, bssid, sizeof(new_network.bssid));
-                            new_network.wps_enabled = true;
-                            new_network.wps_mode = config_methods & (WPS_CONF_METHODS_PIN_DISPLAY | WPS_CONF_METHODS_PIN_KEYPAD) ? WPS_MODE_PIN : WPS_MODE_PBC;
-
-                            detected_wps_networks[detected_network_count++] = new_network;
-                        }
-                        else 
-                        {
-                            pcap_write_packet_to_buffer(pkt->payload, pkt->rx_ctrl.sig_len);
-                        }
-                        
-                        if (detected_network_count >= MAX_WPS_NETWORKS) {
-                            ESP_LOGI(TAG, "Maximum number of WPS networks detected. Stopping monitor mode.");
-                            wifi_manager_stop_monitor_mode();
-                        }     
-
-                    }
-
-
-                    attr_index += (4 + attr_len);
-                }
-            }
-        }
+    if (should_store_wps == 0) {
+        pcap_write_packet_to_buffer(pkt->payload, pkt->rx_ctrl.sig_len);
+    }
 
+    bool is_new;
+    wps_network_t *network = wps_set_insert(&detected_wps_networks, parsed.bssid, &is_new);
+    if (network == NULL) {
+        if (detected_wps_networks.dropped == 1) {
+            ESP_LOGW(TAG, "WPS table full (%lu networks), new networks are not tracked",
+                     (unsigned long)detected_wps_networks.capacity);
+        }
+        if (should_store_wps == 1) {
+            ESP_LOGI(TAG, "Maximum number of WPS networks detected. Stopping monitor mode.");
+            wifi_manager_stop_monitor_mode();
+        }
+        return;
+    }
 
-        index += (2 + ie_len);
+    *network = parsed;
+
+    ESP_LOGI(TAG, "WPS %s on %s (%02x:%02x:%02x:%02x:%02x:%02x) methods 0x%04x v%d.%d %s%s",
+             wps_mode_name(network->wps_mode), network->ssid,
+             network->bssid[0], network->bssid[1], network->bssid[2],
+             network->bssid[3], network->bssid[4], network->bssid[5],
+             network->config_methods, network->version >> 4, network->version & 0x0F,
+             network->state == WPS_STATE_CONFIGURED ? "configured" : "unconfigured",
+             network->locked ? " LOCKED" : "");
+    if (network->device_name[0] || network->model_name[0]) {
+        ESP_LOGI(TAG, "  Device: %s %s %s %s", network->manufacturer, network->device_name,
+                 network->model_name, network->model_number);
     }
-}
\ No newline at end of file
+}
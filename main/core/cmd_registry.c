@@ -0,0 +1,544 @@
+#include "core/cmd_registry.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define SLOT_MASK (CMD_REGISTRY_SLOTS - 1)
+#define COMPLETE_MAX_WORDS 16
+
+// snprintf into a fixed buffer, counting what did not fit
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t pos;
+} writer_t;
+
+static void put(writer_t *w, const char *fmt, ...) {
+    size_t room = w->pos < w->len ? w->len - w->pos : 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(room ? w->buf + w->pos : NULL, room, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        w->pos += (size_t)n;
+    }
+}
+
+static uint32_t fnv1a(const char *s, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)s[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int lookup(const cmd_registry_t *reg, const char *name, size_t len) {
+    uint32_t hash = fnv1a(name, len);
+
+    for (uint32_t slot = hash & SLOT_MASK; reg->index[slot] != 0; slot = (slot + 1) & SLOT_MASK) {
+        int e = reg->index[slot] - 1;
+        const char *candidate = reg->specs[e]->name;
+        if (reg->hashes[e] == hash && strncmp(candidate, name, len) == 0 && candidate[len] == '\0') {
+            return e;
+        }
+    }
+    return -1;
+}
+
+static void index_entry(cmd_registry_t *reg, int e) {
+    uint32_t slot = reg->hashes[e] & SLOT_MASK;
+    while (reg->index[slot] != 0) {
+        slot = (slot + 1) & SLOT_MASK;
+    }
+    reg->index[slot] = (uint8_t)(e + 1);
+}
+
+void cmd_registry_init(cmd_registry_t *reg) {
+    memset(reg, 0, sizeof(*reg));
+}
+
+bool cmd_registry_add(cmd_registry_t *reg, const cmd_spec_t *spec) {
+    if (spec == NULL || spec->name == NULL || reg->count >= CMD_REGISTRY_MAX ||
+        spec->opt_count > CMD_MAX_OPTS) {
+        return false;
+    }
+
+    size_t len = strlen(spec->name);
+    if (lookup(reg, spec->name, len) >= 0) {
+        return false;
+    }
+
+    int e = reg->count++;
+    reg->specs[e] = spec;
+    reg->hashes[e] = fnv1a(spec->name, len);
+    index_entry(reg, e);
+    return true;
+}
+
+bool cmd_registry_remove(cmd_registry_t *reg, const char *name) {
+    int e = lookup(reg, name, strlen(name));
+    if (e < 0) {
+        return false;
+    }
+
+    // Keep registration order for help, then rebuild the index since every
+    // later entry moved. Removal is rare enough not to bother with tombstones.
+    int tail = reg->count - e - 1;
+    memmove(&reg->specs[e], &reg->specs[e + 1], tail * sizeof(reg->specs[0]));
+    memmove(&reg->hashes[e], &reg->hashes[e + 1], tail * sizeof(reg->hashes[0]));
+    reg->count--;
+
+    memset(reg->index, 0, sizeof(reg->index));
+    for (int i = 0; i < reg->count; i++) {
+        index_entry(reg, i);
+    }
+    return true;
+}
+
+const cmd_spec_t *cmd_registry_find(const cmd_registry_t *reg, const char *name) {
+    int e = lookup(reg, name, strlen(name));
+    return e < 0 ? NULL : reg->specs[e];
+}
+
+int cmd_tokenize(char *line, char **argv, int max_args) {
+    // Unquoting only ever shortens a word, so the write position trails the read position
+    char *r = line;
+    char *w = line;
+    int argc = 0;
+
+    while (true) {
+        while (*r == ' ' || *r == '\t') {
+            r++;
+        }
+        if (*r == '\0') {
+            return argc;
+        }
+        if (argc == max_args) {
+            return CMD_TOKENIZE_TOO_MANY;
+        }
+        argv[argc++] = w;
+
+        char quote = 0;
+        for (;; r++) {
+            char c = *r;
+            if (c == '\0') {
+                if (quote) {
+                    return CMD_TOKENIZE_UNTERMINATED;
+                }
+                break;
+            }
+            if (quote) {
+                if (c == quote) {
+                    quote = 0;
+                } else if (c == '\\' && quote == '"' && r[1] != '\0') {
+                    *w++ = *++r;
+                } else {
+                    *w++ = c;
+                }
+            } else if (c == ' ' || c == '\t') {
+                r++;
+                break;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '\\' && r[1] != '\0') {
+                *w++ = *++r;
+            } else {
+                *w++ = c;
+            }
+        }
+        *w++ = '\0';
+    }
+}
+
+static int find_opt(const cmd_spec_t *spec, const char *name, size_t len) {
+    for (int i = 0; i < spec->opt_count; i++) {
+        const char *opt = spec->opts[i].name;
+        if (strncmp(opt, name, len) == 0 && opt[len] == '\0') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool is_negative_number(const char *s) {
+    return s[0] == '-' && isdigit((unsigned char)s[1]);
+}
+
+static bool parse_int(const char *s, int32_t *out) {
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (*s == '\0' || *end != '\0' || errno == ERANGE || v < INT32_MIN || v > INT32_MAX) {
+        return false;
+    }
+    *out = (int32_t)v;
+    return true;
+}
+
+static int match_choice(const cmd_opt_t *opt, const char *value) {
+    for (int i = 0; opt->choices && opt->choices[i]; i++) {
+        if (strcasecmp(opt->choices[i], value) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void put_choices(writer_t *w, const cmd_opt_t *opt, const char *sep) {
+    for (int i = 0; opt->choices && opt->choices[i]; i++) {
+        put(w, "%s%s", i ? sep : "", opt->choices[i]);
+    }
+}
+
+static void put_value_name(writer_t *w, const cmd_opt_t *opt) {
+    if (opt->value_name) {
+        put(w, "%s", opt->value_name);
+    } else if (opt->type == CMD_OPT_CHOICE) {
+        put_choices(w, opt, "|");
+    } else {
+        put(w, opt->type == CMD_OPT_INT ? "n" : "value");
+    }
+}
+
+cmd_parse_result_t cmd_parse(const cmd_spec_t *spec, int argc, char **argv,
+                             cmd_args_t *out, char *err, size_t err_len) {
+    writer_t w = { err, err ? err_len : 0, 0 };
+    if (w.len) {
+        err[0] = '\0';
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->spec = spec;
+    for (int i = 0; i < spec->opt_count; i++) {
+        const cmd_opt_t *opt = &spec->opts[i];
+        out->ival[i] = opt->def;
+        if (opt->type == CMD_OPT_CHOICE && opt->choices) {
+            out->sval[i] = opt->choices[opt->def];
+        }
+    }
+
+    int alone = -1;
+    int given = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *tok = argv[i];
+        int idx = tok[0] == '-' ? find_opt(spec, tok, strlen(tok)) : -1;
+
+        if (idx < 0 && tok[0] == '-' && tok[1] != '\0' && !is_negative_number(tok)) {
+            if (strcmp(tok, "--help") == 0) {
+                return CMD_PARSE_HELP;
+            }
+            put(&w, "%s: unknown option %s", spec->name, tok);
+            return CMD_PARSE_ERROR;
+        }
+
+        if (idx < 0) {
+            if (out->positional_count >= spec->max_positional ||
+                out->positional_count >= CMD_MAX_POSITIONAL) {
+                put(&w, "%s: unexpected argument '%s'", spec->name, tok);
+                return CMD_PARSE_ERROR;
+            }
+            out->positional[out->positional_count++] = tok;
+            continue;
+        }
+
+        const cmd_opt_t *opt = &spec->opts[idx];
+        if (out->present & (1u << idx)) {
+            put(&w, "%s: %s given more than once", spec->name, opt->name);
+            return CMD_PARSE_ERROR;
+        }
+        out->present |= 1u << idx;
+        given++;
+        if (opt->flags & CMD_OPT_ALONE) {
+            alone = idx;
+        }
+
+        if (opt->type == CMD_OPT_FLAG) {
+            continue;
+        }
+
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if ((opt->flags & CMD_OPT_VALUE_OPTIONAL) &&
+            (value == NULL || (value[0] == '-' && !is_negative_number(value)))) {
+            continue;
+        }
+        if (value == NULL) {
+            put(&w, "%s: %s needs a value <", spec->name, opt->name);
+            put_value_name(&w, opt);
+            put(&w, ">");
+            return CMD_PARSE_ERROR;
+        }
+        i++;
+
+        if (opt->type == CMD_OPT_INT) {
+            if (!parse_int(value, &out->ival[idx])) {
+                put(&w, "%s: %s expects a number, got '%s'", spec->name, opt->name, value);
+                return CMD_PARSE_ERROR;
+            }
+            if (out->ival[idx] < opt->min || out->ival[idx] > opt->max) {
+                put(&w, "%s: %s must be %ld-%ld", spec->name, opt->name, (long)opt->min, (long)opt->max);
+                return CMD_PARSE_ERROR;
+            }
+        } else if (opt->type == CMD_OPT_CHOICE) {
+            int choice = match_choice(opt, value);
+            if (choice < 0) {
+                put(&w, "%s: %s must be one of ", spec->name, opt->name);
+                put_choices(&w, opt, ", ");
+                return CMD_PARSE_ERROR;
+            }
+            out->ival[idx] = choice;
+            out->sval[idx] = opt->choices[choice];
+        } else {
+            out->sval[idx] = value;
+        }
+    }
+
+    if (alone >= 0 && (given > 1 || out->positional_count > 0)) {
+        put(&w, "%s: %s cannot be combined with other arguments", spec->name, spec->opts[alone].name);
+        return CMD_PARSE_ERROR;
+    }
+
+    if (out->positional_count < spec->min_positional) {
+        put(&w, "%s: missing %s", spec->name, spec->positional ? spec->positional : "arguments");
+        return CMD_PARSE_ERROR;
+    }
+
+    if ((spec->flags & CMD_SPEC_NEEDS_OPTION) && given == 0) {
+        put(&w, "%s: expected one of ", spec->name);
+        for (int i = 0; i < spec->opt_count; i++) {
+            put(&w, "%s%s", i ? ", " : "", spec->opts[i].name);
+        }
+        return CMD_PARSE_ERROR;
+    }
+
+    return CMD_PARSE_OK;
+}
+
+bool cmd_arg_given(const cmd_args_t *args, const char *opt) {
+    int idx = find_opt(args->spec, opt, strlen(opt));
+    return idx >= 0 && (args->present & (1u << idx));
+}
+
+int32_t cmd_arg_int(const cmd_args_t *args, const char *opt) {
+    int idx = find_opt(args->spec, opt, strlen(opt));
+    return idx < 0 ? 0 : args->ival[idx];
+}
+
+const char *cmd_arg_str(const cmd_args_t *args, const char *opt) {
+    int idx = find_opt(args->spec, opt, strlen(opt));
+    return idx < 0 ? NULL : args->sval[idx];
+}
+
+static void put_opt_usage(writer_t *w, const cmd_opt_t *opt) {
+    put(w, "%s", opt->name);
+    if (opt->type == CMD_OPT_FLAG) {
+        return;
+    }
+
+    bool optional = opt->flags & CMD_OPT_VALUE_OPTIONAL;
+    put(w, optional ? " [" : " <");
+    put_value_name(w, opt);
+    put(w, optional ? "]" : ">");
+}
+
+static void put_usage(writer_t *w, const cmd_spec_t *spec) {
+    if (spec->usage) {
+        put(w, "%s", spec->usage);
+        return;
+    }
+
+    // Options that must stand alone become alternatives after the main form
+    bool base = !(spec->flags & CMD_SPEC_NEEDS_OPTION) || spec->positional;
+    for (int i = 0; i < spec->opt_count; i++) {
+        if (!(spec->opts[i].flags & CMD_OPT_ALONE)) {
+            base = true;
+        }
+    }
+
+    bool first = true;
+    if (base) {
+        put(w, "%s", spec->name);
+        for (int i = 0; i < spec->opt_count; i++) {
+            if (!(spec->opts[i].flags & CMD_OPT_ALONE)) {
+                put(w, " [");
+                put_opt_usage(w, &spec->opts[i]);
+                put(w, "]");
+            }
+        }
+        if (spec->positional) {
+            put(w, " %s", spec->positional);
+        }
+        first = false;
+    }
+
+    for (int i = 0; i < spec->opt_count; i++) {
+        if (spec->opts[i].flags & CMD_OPT_ALONE) {
+            put(w, "%s%s ", first ? "" : " | ", spec->name);
+            put_opt_usage(w, &spec->opts[i]);
+            first = false;
+        }
+    }
+}
+
+size_t cmd_format_usage(const cmd_spec_t *spec, char *buf, size_t len) {
+    writer_t w = { buf, buf ? len : 0, 0 };
+    if (w.len) {
+        buf[0] = '\0';
+    }
+    put_usage(&w, spec);
+    return w.pos;
+}
+
+size_t cmd_format_help(const cmd_spec_t *spec, char *buf, size_t len) {
+    writer_t w = { buf, buf ? len : 0, 0 };
+    if (w.len) {
+        buf[0] = '\0';
+    }
+
+    put(&w, "%s\n", spec->name);
+    if (spec->summary) {
+        put(&w, "    Description: %s\n", spec->summary);
+    }
+    put(&w, "    Usage: ");
+    put_usage(&w, spec);
+    put(&w, "\n");
+
+    if (spec->opt_count > 0) {
+        int width = 0;
+        for (int i = 0; i < spec->opt_count; i++) {
+            int n = (int)strlen(spec->opts[i].name);
+            width = n > width ? n : width;
+        }
+
+        put(&w, "    Arguments:\n");
+        for (int i = 0; i < spec->opt_count; i++) {
+            const cmd_opt_t *opt = &spec->opts[i];
+            put(&w, "        %-*s : %s", width, opt->name, opt->help ? opt->help : "");
+
+            if (opt->type == CMD_OPT_INT) {
+                put(&w, " (%ld-%ld", (long)opt->min, (long)opt->max);
+                if (!(opt->flags & CMD_OPT_NO_DEFAULT)) {
+                    put(&w, ", default %ld", (long)opt->def);
+                }
+                put(&w, ")");
+            } else if (opt->type == CMD_OPT_CHOICE && opt->choices && !(opt->flags & CMD_OPT_NO_DEFAULT)) {
+                put(&w, " (default %s)", opt->choices[opt->def]);
+            }
+            put(&w, "\n");
+        }
+    }
+
+    put(&w, "\n");
+    return w.pos;
+}
+
+static bool has_prefix(const char *s, const char *prefix, size_t len) {
+    return strncmp(s, prefix, len) == 0;
+}
+
+size_t cmd_registry_complete(const cmd_registry_t *reg, const char *line,
+                             const char **out, size_t max_out) {
+    const char *word[COMPLETE_MAX_WORDS];
+    size_t word_len[COMPLETE_MAX_WORDS];
+    int words = 0;
+
+    const char *p = line;
+    while (*p) {
+        while (*p == ' ') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        if (words == COMPLETE_MAX_WORDS) {
+            return 0;
+        }
+        word[words] = p;
+        while (*p && *p != ' ') {
+            p++;
+        }
+        word_len[words] = (size_t)(p - word[words]);
+        words++;
+    }
+
+    // A trailing space means a new word is being started
+    bool fresh = words == 0 || p[-1] == ' ';
+    int cur = fresh ? words : words - 1;
+    const char *prefix = fresh ? "" : word[cur];
+    size_t prefix_len = fresh ? 0 : word_len[cur];
+    size_t found = 0;
+
+#define EMIT(s) do { if (found < max_out) { out[found] = (s); } found++; } while (0)
+
+    if (cur == 0) {
+        for (int e = 0; e < reg->count; e++) {
+            if (has_prefix(reg->specs[e]->name, prefix, prefix_len)) {
+                EMIT(reg->specs[e]->name);
+            }
+        }
+        return found;
+    }
+
+    int e = lookup(reg, word[0], word_len[0]);
+    if (e < 0) {
+        return 0;
+    }
+    const cmd_spec_t *spec = reg->specs[e];
+
+    int prev = find_opt(spec, word[cur - 1], word_len[cur - 1]);
+    if (prev >= 0 && spec->opts[prev].type != CMD_OPT_FLAG) {
+        const cmd_opt_t *opt = &spec->opts[prev];
+        if (opt->type == CMD_OPT_CHOICE) {
+            for (int i = 0; opt->choices && opt->choices[i]; i++) {
+                if (strncasecmp(opt->choices[i], prefix, prefix_len) == 0) {
+                    EMIT(opt->choices[i]);
+                }
+            }
+            return found;
+        }
+        if (!(opt->flags & CMD_OPT_VALUE_OPTIONAL)) {
+            // Free-form value, nothing to offer
+            return 0;
+        }
+    }
+
+    if (prefix_len > 0 && prefix[0] != '-') {
+        return 0;
+    }
+
+    for (int i = 0; i < spec->opt_count; i++) {
+        const char *name = spec->opts[i].name;
+        bool used = false;
+        for (int j = 1; j < cur && !used; j++) {
+            used = strlen(name) == word_len[j] && strncmp(name, word[j], word_len[j]) == 0;
+        }
+        if (!used && has_prefix(name, prefix, prefix_len)) {
+            EMIT(name);
+        }
+    }
+
+#undef EMIT
+
+    return found;
+}
+
+size_t cmd_common_prefix_len(const char *const *cands, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+
+    size_t len = strlen(cands[0]);
+    for (size_t i = 1; i < count; i++) {
+        size_t j = 0;
+        while (j < len && cands[i][j] == cands[0][j]) {
+            j++;
+        }
+        len = j;
+    }
+    return len;
+}
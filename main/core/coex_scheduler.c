@@ -0,0 +1,105 @@
+#include "core/coex_scheduler.h"
+#include <string.h>
+
+static const char *radio_names[COEX_RADIO_COUNT] = { "WiFi", "BLE", "Idle" };
+
+bool coex_scheduler_init(coex_scheduler_t *sched, uint32_t slot_ms, uint8_t wifi_pct, uint8_t ble_pct) {
+    memset(sched, 0, sizeof(*sched));
+
+    if (slot_ms < COEX_MIN_SLOT_MS || slot_ms > COEX_MAX_SLOT_MS ||
+        wifi_pct + ble_pct > 100 || wifi_pct + ble_pct == 0) {
+        return false;
+    }
+
+    sched->slot_ms = slot_ms;
+    sched->weight[COEX_RADIO_WIFI] = wifi_pct;
+    sched->weight[COEX_RADIO_BLE] = ble_pct;
+    sched->weight[COEX_RADIO_IDLE] = (uint8_t)(100 - wifi_pct - ble_pct);
+    return true;
+}
+
+static coex_radio_t pick(coex_scheduler_t *sched) {
+    int best = -1;
+
+    // Every radio earns its weight per slot and the winner pays back the
+    // total, which spreads each radio's slots as evenly as possible
+    for (int r = 0; r < COEX_RADIO_COUNT; r++) {
+        if (sched->weight[r] == 0) {
+            continue;
+        }
+        sched->current[r] += sched->weight[r];
+        if (best < 0 || sched->current[r] > sched->current[best]) {
+            best = r;
+        }
+    }
+
+    sched->current[best] -= 100;
+    return (coex_radio_t)best;
+}
+
+coex_radio_t coex_scheduler_next(coex_scheduler_t *sched, uint32_t now_ms) {
+    coex_radio_t next = pick(sched);
+
+    if (!sched->running) {
+        sched->running = true;
+        sched->start_ms = now_ms;
+    } else if (next == sched->active) {
+        return next;
+    } else {
+        coex_radio_stats_t *prev = &sched->stats[sched->active];
+        prev->on_ms += now_ms - sched->active_since_ms;
+        prev->last_off_ms = now_ms;
+    }
+
+    coex_radio_stats_t *s = &sched->stats[next];
+    if (s->ever_on && now_ms - s->last_off_ms > s->max_gap_ms) {
+        s->max_gap_ms = now_ms - s->last_off_ms;
+    }
+    s->ever_on = true;
+    s->slots++;
+
+    sched->active = next;
+    sched->active_since_ms = now_ms;
+    return next;
+}
+
+void coex_scheduler_add_switch_cost(coex_scheduler_t *sched, coex_radio_t radio, uint32_t switch_us) {
+    if (radio < COEX_RADIO_COUNT) {
+        sched->stats[radio].switch_us += switch_us;
+    }
+}
+
+void coex_scheduler_stats(const coex_scheduler_t *sched, coex_radio_t radio, uint32_t now_ms,
+                          coex_radio_stats_t *out) {
+    *out = sched->stats[radio];
+    if (!sched->running) {
+        return;
+    }
+
+    if (radio == sched->active) {
+        out->on_ms += now_ms - sched->active_since_ms;
+    } else {
+        // A radio still waiting may already be past its worst gap
+        uint32_t since = out->ever_on ? out->last_off_ms : sched->start_ms;
+        if (now_ms - since > out->max_gap_ms) {
+            out->max_gap_ms = now_ms - since;
+        }
+    }
+}
+
+uint32_t coex_scheduler_effective_permille(const coex_scheduler_t *sched, coex_radio_t radio, uint32_t now_ms) {
+    if (!sched->running || now_ms == sched->start_ms) {
+        return 0;
+    }
+
+    coex_radio_stats_t s;
+    coex_scheduler_stats(sched, radio, now_ms, &s);
+
+    uint64_t usable_us = (uint64_t)s.on_ms * 1000;
+    usable_us = s.switch_us < usable_us ? usable_us - s.switch_us : 0;
+    return (uint32_t)(usable_us / (now_ms - sched->start_ms));
+}
+
+const char *coex_radio_name(coex_radio_t radio) {
+    return radio < COEX_RADIO_COUNT ? radio_names[radio] : "Unknown";
+}
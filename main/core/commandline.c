@@ -5,83 +5,156 @@
 #include "managers/rgb_manager.h"
 #include "managers/ap_manager.h"
 #include "managers/ble_manager.h"
+#include "managers/coex_manager.h"
 #include "managers/settings_manager.h"
+#include "managers/script_manager.h"
 #include <stdlib.h>
 #include <string.h>
 #include <vendor/dial_client.h>
 #include "managers/dial_manager.h"
 #include "core/callbacks.h"
+#include "core/serial_manager.h"
+#include "core/system_manager.h"
+#include "core/rogue_ap_detector.h"
 #include <esp_timer.h>
 #include "vendor/pcap.h"
 #include <sys/socket.h>
 #include <netdb.h>
 #include "vendor/printer.h"
 
-static Command *command_list_head = NULL;
+static const char *TAG = "COMMANDLINE";
+
+static cmd_registry_t command_registry;
 
 void command_init() {
-    command_list_head = NULL;
+    cmd_registry_init(&command_registry);
 }
 
-void register_command(const char *name, CommandFunction function) {
-    // Check if the command already exists
-    Command *current = command_list_head;
-    while (current != NULL) {
-        if (strcmp(current->name, name) == 0) {
-            // Command already registered
-            return;
-        }
-        current = current->next;
+bool register_command(const cmd_spec_t *spec) {
+    if (!cmd_registry_add(&command_registry, spec)) {
+        ESP_LOGW(TAG, "Could not register command %s", spec->name);
+        return false;
     }
+    return true;
+}
+
+void unregister_command(const char *name) {
+    cmd_registry_remove(&command_registry, name);
+}
 
-    // Create a new command
-    Command *new_command = (Command *)malloc(sizeof(Command));
-    if (new_command == NULL) {
-        // Handle memory allocation failure
+const cmd_spec_t *find_command(const char *name) {
+    return cmd_registry_find(&command_registry, name);
+}
+
+static void print_command_help(const cmd_spec_t *spec) {
+    size_t len = cmd_format_help(spec, NULL, 0) + 1;
+    char *buf = malloc(len);
+    if (buf == NULL) {
         return;
     }
-    new_command->name = strdup(name);
-    new_command->function = function;
-    new_command->next = command_list_head;
-    command_list_head = new_command;
+    cmd_format_help(spec, buf, len);
+    fputs(buf, stdout);
+    free(buf);
 }
 
-void unregister_command(const char *name) {
-    Command *current = command_list_head;
-    Command *previous = NULL;
-
-    while (current != NULL) {
-        if (strcmp(current->name, name) == 0) {
-            // Found the command to remove
-            if (previous == NULL) {
-                command_list_head = current->next;
-            } else {
-                previous->next = current->next;
-            }
-            free(current->name);
-            free(current);
-            return;
+static void print_command_usage(const cmd_spec_t *spec) {
+    char usage[256];
+    cmd_format_usage(spec, usage, sizeof(usage));
+    printf("Usage: %s\n", usage);
+}
+
+esp_err_t command_execute(int argc, char **argv) {
+    if (argc < 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const cmd_spec_t *spec = cmd_registry_find(&command_registry, argv[0]);
+    if (spec == NULL) {
+        printf("Unknown command: %s\n", argv[0]);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (spec->flags & CMD_SPEC_RAW) {
+        if (argc == 2 && strcmp(argv[1], "--help") == 0) {
+            print_command_help(spec);
+        } else {
+            spec->run_raw(argc, argv);
         }
-        previous = current;
-        current = current->next;
+        return ESP_OK;
+    }
+
+    cmd_args_t args;
+    char err[CMD_ERR_LEN];
+    switch (cmd_parse(spec, argc, argv, &args, err, sizeof(err))) {
+    case CMD_PARSE_HELP:
+        print_command_help(spec);
+        return ESP_OK;
+    case CMD_PARSE_ERROR:
+        printf("Error: %s\n", err);
+        print_command_usage(spec);
+        return ESP_ERR_INVALID_ARG;
+    default:
+        break;
+    }
+
+    if (spec->run) {
+        spec->run(&args);
+    } else {
+        spec->run_raw(argc, argv);
     }
+    return ESP_OK;
 }
 
-CommandFunction find_command(const char *name) {
-    Command *current = command_list_head;
-    while (current != NULL) {
-        if (strcmp(current->name, name) == 0) {
-            return current->function;
+size_t command_complete(const char *line, const char **out, size_t max_out) {
+    return cmd_registry_complete(&command_registry, line, out, max_out);
+}
+
+// Name of the option given, for job labels
+static const char *given_option(const cmd_args_t *args) {
+    for (uint8_t i = 0; i < args->spec->opt_count; i++) {
+        if (args->present & (1u << i)) {
+            return args->spec->opts[i].name;
         }
-        current = current->next;
     }
-    return NULL;
+    return "";
+}
+
+static uint32_t scanned_ap_count(void) {
+    return ap_count;
+}
+
+static void stop_capture(void) {
+    wifi_manager_stop_monitor_mode();
+    pcap_file_close();
+}
+
+// Long running commands run as jobs, see the jobs and kill commands
+static const job_desc_t scanap_job = { .resources = JOB_RES_WIFI, .progress = scanned_ap_count };
+static const job_desc_t scansta_job = { .resources = JOB_RES_WIFI, .stop = wifi_manager_stop_monitor_mode };
+static const job_desc_t capture_job = {
+    .resources = JOB_RES_WIFI | JOB_RES_PCAP, .stop = stop_capture, .progress = pcap_packet_count,
+};
+static const job_desc_t rogueap_job = { .resources = JOB_RES_WIFI, .stop = wifi_manager_stop_monitor_mode };
+static const job_desc_t beaconspam_job = { .resources = JOB_RES_WIFI, .stop = wifi_manager_stop_beacon };
+static const job_desc_t attack_job = { .resources = JOB_RES_WIFI, .stop = wifi_manager_stop_deauth };
+static const job_desc_t portal_job = { .resources = JOB_RES_WIFI, .stop = wifi_manager_stop_evil_portal };
+
+// capture -stop and rogueap -s end monitor mode whichever command started it
+static void release_monitor_jobs(void) {
+    system_manager_job_release(&scansta_job);
+    system_manager_job_release(&capture_job);
+    system_manager_job_release(&rogueap_job);
 }
 
 void cmd_wifi_scan_start(int argc, char **argv) {
+    uint32_t job = system_manager_job_start(&scanap_job, "scanap");
+    if (job == 0) {
+        return;
+    }
     ap_manager_add_log("WiFi scan started.\n");
     wifi_manager_start_scan();
     wifi_manager_print_scan_results_with_oui();
+    system_manager_job_finish(job, ESP_OK);
 }
 
 void cmd_wifi_scan_stop(int argc, char **argv) {
@@ -94,107 +167,93 @@ void cmd_wifi_scan_results(int argc, char **argv) {
     ap_manager_add_log("WiFi scan results displayed with OUI matching.\n");
 }
 
-void handle_list(int argc, char **argv) {
-    if (argc > 1 && strcmp(argv[1], "-a") == 0) {
-        cmd_wifi_scan_results(argc, argv);
-        return;
-    } 
-    else if (argc > 1 && strcmp(argv[1], "-s") == 0)
-    {
-        wifi_manager_list_stations();
-        ap_manager_add_log("Listed Stations...");
+void handle_list(const cmd_args_t *args) {
+    if (cmd_arg_given(args, "-a")) {
+        cmd_wifi_scan_results(0, NULL);
         return;
     }
-    else {
-        ap_manager_add_log("Usage: list -a (for Wi-Fi scan results)\n");
-    }
+
+    station_sort_t sort = STATION_SORT_RECENT;
+    station_stats_parse_sort(cmd_arg_str(args, "-o"), &sort);
+    wifi_manager_list_stations(sort, cmd_arg_given(args, "-j"));
+    ap_manager_add_log("Listed Stations...");
 }
 
 void handle_beaconspam(int argc, char **argv) {
-    if (argc > 1 && strcmp(argv[1], "-r") == 0) {
+    if (argc < 2) {
+        ap_manager_add_log("Usage: beaconspam -r (for Beacon Spam Random)\n");
+        return;
+    }
+
+    char label[JOB_LABEL_LEN];
+    snprintf(label, sizeof(label), "beaconspam %s", argv[1]);
+    if (system_manager_job_start(&beaconspam_job, label) == 0) {
+        return;
+    }
+
+    if (strcmp(argv[1], "-r") == 0) {
         ap_manager_add_log("Starting Random beacon spam...\n");
         wifi_manager_start_beacon(NULL);
         return;
     }
 
-    if (argc > 1 && strcmp(argv[1], "-rr") == 0) {
+    if (strcmp(argv[1], "-rr") == 0) {
         ap_manager_add_log("Starting Rickroll beacon spam...\n");
         wifi_manager_start_beacon("RICKROLL");
         return;
     }
 
-    if (argc > 1 && strcmp(argv[1], "-l") == 0) {
+    if (strcmp(argv[1], "-l") == 0) {
         ap_manager_add_log("Starting AP List beacon spam...\n");
         wifi_manager_start_beacon("APLISTMODE");
         return;
     }
 
-    if (argc > 1)
-    {
-        wifi_manager_start_beacon(argv[1]);
-        return;
-    }
-    else {
-        ap_manager_add_log("Usage: beaconspam -r (for Beacon Spam Random)\n");
-    }
+    wifi_manager_start_beacon(argv[1]);
 }
 
 
 void handle_stop_spam(int argc, char **argv)
 {
     wifi_manager_stop_beacon();
+    system_manager_job_release(&beaconspam_job);
     ap_manager_add_log("Beacon Spam Stopped...");
 }
 
 void handle_sta_scan(int argc, char **argv)
 {
+    if (system_manager_job_start(&scansta_job, "scansta") == 0) {
+        return;
+    }
+    if (wifi_probe_tracker_reset() != ESP_OK) {
+        printf("Warning: not enough memory to track probed SSIDs\n");
+    }
     wifi_manager_start_monitor_mode(wifi_stations_sniffer_callback);
     ap_manager_add_log("Started Station Scan...");
 }
 
 
-void handle_attack_cmd(int argc, char **argv)
+void handle_attack_cmd(const cmd_args_t *args)
 {
-    if (argc > 1 && strcmp(argv[1], "-d") == 0) {
-        ap_manager_add_log("Deauth Attack Starting...");
-        wifi_manager_start_deauth();
+    if (system_manager_job_start(&attack_job, "attack -d") == 0) {
         return;
     }
-    else 
-    {
-        ap_manager_add_log("Usage: attack -d (for deauthing access points)\n");
-    }
+    ap_manager_add_log("Deauth Attack Starting...");
+    wifi_manager_start_deauth();
 }
 
 
 void handle_stop_deauth(int argc, char **argv)
 {
     wifi_manager_stop_deauth();
+    system_manager_job_release(&attack_job);
     ap_manager_add_log("Deauthing Stopped....\n");
 }
 
 
-void handle_select_cmd(int argc, char **argv)
+void handle_select_cmd(const cmd_args_t *args)
 {
-    if (argc != 3) {
-        ap_manager_add_log("Invalid number of arguments. Usage: select -a <number>\n");
-        return;
-    }
-
-    if (strcmp(argv[1], "-a") == 0) {
-        char *endptr;
-        
-        int num = (int)strtol(argv[2], &endptr, 10);
-
-
-        if (*endptr == '\0') {
-            wifi_manager_select_ap(num);
-        } else {
-            ap_manager_add_log("Error: is not a valid number.\n");
-        }
-    } else {
-        ap_manager_add_log("Invalid option. Usage: select -a <number>\n");
-    }
+    wifi_manager_select_ap((int)cmd_arg_int(args, "-a"));
 }
 
 
@@ -218,11 +277,32 @@ void discover_task(void *pvParameter) {
     vTaskDelete(NULL);
 }
 
+#ifndef CONFIG_IDF_TARGET_ESP32S2
+static void stop_ble_capture(void) {
+    ble_stop();
+    pcap_file_close();
+}
+
+static const job_desc_t blescan_job = { .resources = JOB_RES_BLE, .stop = ble_stop };
+static const job_desc_t blescan_pcap_job = {
+    .resources = JOB_RES_BLE | JOB_RES_PCAP, .stop = stop_ble_capture, .progress = pcap_packet_count,
+};
+static const job_desc_t coex_job = { .resources = JOB_RES_WIFI | JOB_RES_BLE, .stop = coex_manager_stop };
+#endif
+
+// Each job's own hook ends it, so a BLE capture also closes its pcap and coex
+// mode stops scheduling; the bare calls cover what runs without a job
 void handle_stop_flipper(int argc, char** argv)
 {
-    wifi_manager_stop_deauth();
+    if (system_manager_job_stop(&attack_job) == 0) {
+        wifi_manager_stop_deauth();
+    }
 #ifndef CONFIG_IDF_TARGET_ESP32S2
-    ble_stop();
+    size_t ble_jobs = system_manager_job_stop(&blescan_job) + system_manager_job_stop(&blescan_pcap_job) +
+                      system_manager_job_stop(&coex_job);
+    if (ble_jobs == 0) {
+        ble_stop();
+    }
 #endif
 }
 
@@ -262,39 +342,111 @@ void handle_wifi_connection(int argc, char** argv) {
 
 #ifndef CONFIG_IDF_TARGET_ESP32S2
 
-void handle_ble_scan_cmd(int argc, char**argv)
+void handle_ble_scan_cmd(const cmd_args_t *args)
 {
-    if (argc > 1 && strcmp(argv[1], "-f") == 0) {
-        ap_manager_add_log("Starting Find the Flippers...\n");
-        ble_start_find_flippers();
+    if (cmd_arg_given(args, "-l")) {
+        ble_list_devices();
         return;
     }
 
-    if (argc > 1 && strcmp(argv[1], "-ds") == 0) {
-        ap_manager_add_log("Starting BLE Spam Detector...\n");
-        ble_start_blespam_detector();
+    if (cmd_arg_given(args, "-n")) {
+        uint32_t max_devices = (uint32_t)cmd_arg_int(args, "-n");
+        uint32_t slots = ble_set_device_capacity(max_devices);
+        printf("BLE scans track up to %lu devices (%lu slots, %lu bytes) from the next scan\n",
+               (unsigned long)max_devices, (unsigned long)slots, (unsigned long)(slots * sizeof(ble_device_t)));
         return;
     }
 
-    if (argc > 1 && strcmp(argv[1], "-a") == 0) {
-        ap_manager_add_log("Starting AirTag Scanner...\n");
-        ble_start_airtag_scanner();
+    if (cmd_arg_given(args, "-s")) {
+        ap_manager_add_log("Stopping BLE Scan...\n");
+        // Only the capture job's hook closes the pcap, which may belong to a WiFi capture
+        if (system_manager_job_stop(&blescan_job) + system_manager_job_stop(&blescan_pcap_job) == 0) {
+            ble_stop();
+        }
+        return;
+    }
+
+    char label[JOB_LABEL_LEN];
+    snprintf(label, sizeof(label), "blescan %s", given_option(args));
+    uint32_t job = system_manager_job_start(cmd_arg_given(args, "-pcap") ? &blescan_pcap_job : &blescan_job, label);
+    if (job == 0) {
         return;
     }
 
-    if (argc > 1 && strcmp(argv[1], "-r") == 0) {
+    if (cmd_arg_given(args, "-f")) {
+        ap_manager_add_log("Starting Find the Flippers...\n");
+        ble_start_find_flippers();
+    } else if (cmd_arg_given(args, "-ds")) {
+        ap_manager_add_log("Starting BLE Spam Detector...\n");
+        ble_start_blespam_detector();
+    } else if (cmd_arg_given(args, "-a")) {
+        ap_manager_add_log("Starting AirTag Scanner...\n");
+        ble_start_airtag_scanner();
+    } else if (cmd_arg_given(args, "-t")) {
+        int32_t dwell_minutes = cmd_arg_int(args, "-t");
+        printf("Starting tracker-following detector, alert after %ld min\n", (long)dwell_minutes);
+        ap_manager_add_log("Starting Tracker Detector...\n");
+        ble_start_tracker_detector((uint32_t)dwell_minutes);
+    } else if (cmd_arg_given(args, "-r")) {
         ap_manager_add_log("Scanning for Raw Packets\n");
         ble_start_raw_ble_packetscan();
+    } else if (cmd_arg_given(args, "-pcap")) {
+        int err = pcap_file_open_with_linktype("blescan", PCAP_LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR);
+        if (err != ESP_OK) {
+            printf("Error: pcap failed to open\n");
+            system_manager_job_finish(job, err);
+            return;
+        }
+        ap_manager_add_log("Capturing BLE Advertisements to PCAP...\n");
+        ble_start_pcap_capture();
+    }
+}
+
+void handle_coex_cmd(const cmd_args_t *args)
+{
+    if (cmd_arg_given(args, "-s")) {
+        ap_manager_add_log("Stopping Coexistence Mode...\n");
+        if (system_manager_job_stop(&coex_job) == 0) {
+            coex_manager_stop();
+        }
         return;
     }
 
-    if (argc > 1 && strcmp(argv[1], "-s") == 0) {
-        ap_manager_add_log("Stopping BLE Scan...\n");
-        ble_stop();
+    if (cmd_arg_given(args, "-i")) {
+        coex_manager_print_status();
+        return;
+    }
+
+    int32_t wifi_pct = cmd_arg_int(args, "-w");
+    int32_t slot_ms = cmd_arg_int(args, "-t");
+
+    // With only a WiFi share given, BLE gets the rest
+    int32_t ble_pct = cmd_arg_given(args, "-b") ? cmd_arg_int(args, "-b") : 100 - wifi_pct;
+
+    if (wifi_pct + ble_pct < 1 || wifi_pct + ble_pct > 100) {
+        printf("Shares must add up to 1-100%%\n");
+        return;
+    }
+
+    uint32_t job = system_manager_job_start(&coex_job, "coex");
+    if (job == 0) {
+        return;
+    }
+
+    esp_err_t err = coex_manager_start((uint32_t)slot_ms, (uint8_t)wifi_pct, (uint8_t)ble_pct);
+    if (err == ESP_ERR_INVALID_STATE) {
+        printf("Coexistence mode is already running, stop it with coex -s\n");
+    } else if (err != ESP_OK) {
+        printf("Error: failed to start coexistence mode\n");
+    }
+    if (err != ESP_OK) {
+        system_manager_job_finish(job, err);
         return;
     }
 
-    ap_manager_add_log("Invalid Command Syntax...");
+    printf("Coexistence mode: WiFi %ld%%, BLE %ld%%, idle %ld%%, %ld ms slots\n",
+           (long)wifi_pct, (long)ble_pct, (long)(100 - wifi_pct - ble_pct), (long)slot_ms);
+    ap_manager_add_log("Starting Coexistence Mode...\n");
 }
 
 #endif
@@ -355,11 +507,20 @@ void handle_start_portal(int argc, char **argv)
         return;
     }
 
-    if (ssid && ssid[0] != '\0' && password && password[0] != '\0' && !offlinemode) {
+    bool online = ssid && ssid[0] != '\0' && password && password[0] != '\0' && !offlinemode;
+    if (!online && !offlinemode) {
+        return;
+    }
+
+    if (system_manager_job_start(&portal_job, "startportal") == 0) {
+        return;
+    }
+
+    if (online) {
         printf("Starting portal with SSID: %s, Password: %s, AP_SSID: %s, Domain: %s\n", ssid, password, ap_ssid, domain);
         wifi_manager_start_evil_portal(url, ssid, password, ap_ssid, domain);
     }
-    else if (offlinemode){
+    else {
         printf("Starting portal in offline mode with AP_SSID: %s, Domain: %s\n", ap_ssid, domain);
         wifi_manager_start_evil_portal(url, NULL, NULL, ap_ssid, domain);
     }
@@ -513,94 +674,111 @@ void handle_tp_link_test(int argc, char **argv)
     }
 }
 
-void handle_capture_scan(int argc, char** argv)
+void handle_capture_scan(const cmd_args_t *args)
 {
-    if (argc != 2) {
-        printf("Error: Incorrect number of arguments.\n");
+    if (cmd_arg_given(args, "-stop"))
+    {
+        stop_capture();
+        release_monitor_jobs();
         return;
     }
 
-    char *capturetype = argv[1];
-
-    if (capturetype == NULL || capturetype[0] == '\0') {
-        printf("Error: Capture Type cannot be empty.\n");
+    char label[JOB_LABEL_LEN];
+    snprintf(label, sizeof(label), "capture %s", given_option(args));
+    uint32_t job = system_manager_job_start(&capture_job, label);
+    if (job == 0)
+    {
         return;
     }
 
-    if (strcmp(capturetype, "-probe") == 0)
+    if (cmd_arg_given(args, "-probe"))
     {
         int err = pcap_file_open("probescan");
         
         if (err != ESP_OK)
         {
             printf("Error: pcap failed to open\n");
+            system_manager_job_finish(job, err);
             return;
         }
+        if (wifi_probe_tracker_reset() != ESP_OK)
+        {
+            printf("Warning: not enough memory to track probed SSIDs\n");
+        }
         wifi_manager_start_monitor_mode(wifi_probe_scan_callback);
     }
 
-    if (strcmp(capturetype, "-deauth") == 0)
+    if (cmd_arg_given(args, "-deauth"))
     {
         int err = pcap_file_open("deauthscan");
         
         if (err != ESP_OK)
         {
             printf("Error: pcap failed to open\n");
+            system_manager_job_finish(job, err);
             return;
         }
+        wifi_deauth_detector_reset();
         wifi_manager_start_monitor_mode(wifi_deauth_scan_callback);
     }
 
-    if (strcmp(capturetype, "-beacon") == 0)
+    if (cmd_arg_given(args, "-beacon"))
     {
         int err = pcap_file_open("beaconscan");
         
         if (err != ESP_OK)
         {
             printf("Error: pcap failed to open\n");
+            system_manager_job_finish(job, err);
             return;
         }
         wifi_manager_start_monitor_mode(wifi_beacon_scan_callback);
     }
 
-    if (strcmp(capturetype, "-raw") == 0)
+    if (cmd_arg_given(args, "-raw"))
     {
         int err = pcap_file_open("rawscan");
         
         if (err != ESP_OK)
         {
             printf("Error: pcap failed to open\n");
+            system_manager_job_finish(job, err);
             return;
         }
         wifi_manager_start_monitor_mode(wifi_raw_scan_callback);
     }
 
-    if (strcmp(capturetype, "-eapol") == 0)
+    if (cmd_arg_given(args, "-eapol"))
     {
         int err = pcap_file_open("eapolscan");
         
         if (err != ESP_OK)
         {
             printf("Error: pcap failed to open\n");
+            system_manager_job_finish(job, err);
             return;
         }
         wifi_manager_start_monitor_mode(wifi_eapol_scan_callback);
     }
 
-    if (strcmp(capturetype, "-pwn") == 0)
+    if (cmd_arg_given(args, "-pwn"))
     {
         int err = pcap_file_open("pwnscan");
         
         if (err != ESP_OK)
         {
             printf("Error: pcap failed to open\n");
+            system_manager_job_finish(job, err);
             return;
         }
+        wifi_pwn_table_reset();
         wifi_manager_start_monitor_mode(wifi_pwn_scan_callback);
     }
 
-    if (strcmp(capturetype, "-wps") == 0)
+    if (cmd_arg_given(args, "-wps"))
     {
+        uint32_t capacity = (uint32_t)cmd_arg_int(args, "-wps");
+
         int err = pcap_file_open("wpsscan");
 
         should_store_wps = 0;
@@ -608,21 +786,155 @@ void handle_capture_scan(int argc, char** argv)
         if (err != ESP_OK)
         {
             printf("Error: pcap failed to open\n");
+            system_manager_job_finish(job, err);
+            return;
+        }
+
+        if (wifi_wps_set_reset(capacity) != ESP_OK)
+        {
+            printf("Error: not enough memory for %lu WPS networks\n", (unsigned long)capacity);
+            pcap_file_close();
+            system_manager_job_finish(job, ESP_ERR_NO_MEM);
             return;
         }
         wifi_manager_start_monitor_mode(wifi_wps_detection_callback);
     }
+}
+
+void handle_probes(const cmd_args_t *args)
+{
+    wifi_probe_tracker_print(cmd_arg_given(args, "-j"), cmd_arg_given(args, "-c"));
+}
 
-    if (strcmp(capturetype, "-stop") == 0)
+void handle_rogueap(const cmd_args_t *args)
+{
+    if (cmd_arg_given(args, "-s"))
     {
         wifi_manager_stop_monitor_mode();
-        pcap_file_close();
+        release_monitor_jobs();
+        printf("Rogue AP detection stopped.\n");
+        return;
+    }
+
+    uint32_t job = system_manager_job_start(&rogueap_job, "rogueap");
+    if (job == 0)
+    {
+        return;
+    }
+
+    const char *path = cmd_arg_given(args, "-f") ? cmd_arg_str(args, "-f") : ROGUE_AP_DEFAULT_ALLOWLIST;
+
+    esp_err_t err = wifi_rogue_ap_load_allowlist(path);
+    if (err != ESP_OK)
+    {
+        printf("Error: no usable allowlist entries in %s (SSID,BSSID,SECURITY[,CHANNEL])\n", path);
+        system_manager_job_finish(job, err);
+        return;
     }
+
+    printf("Watching beacons for rogue copies of allowlisted networks...\n");
+    wifi_manager_start_monitor_mode(wifi_rogue_ap_callback);
 }
 
 void stop_portal(int argc, char **argv)
 {
     wifi_manager_stop_evil_portal();
+    system_manager_job_release(&portal_job);
+}
+
+void handle_jobs(int argc, char **argv)
+{
+    system_manager_print_jobs();
+}
+
+void handle_kill(const cmd_args_t *args)
+{
+    char *end;
+    unsigned long id = strtoul(args->positional[0], &end, 10);
+    if (*end != '\0' || id == 0)
+    {
+        printf("Error: job id must be a number from 'jobs'\n");
+        return;
+    }
+
+    // Success is reported by the job's completion line
+    esp_err_t err = system_manager_job_kill(id);
+    if (err == ESP_ERR_NOT_FOUND)
+    {
+        printf("Error: no running job %lu\n", id);
+    }
+    else if (err == ESP_ERR_NOT_SUPPORTED)
+    {
+        printf("Error: job %lu cannot be stopped early\n", id);
+    }
+    else if (err == ESP_ERR_INVALID_STATE)
+    {
+        printf("Job %lu is already stopping\n", id);
+    }
+}
+
+void handle_serialstats(const cmd_args_t *args)
+{
+    serial_manager_print_stats(cmd_arg_given(args, "-r"));
+}
+
+void handle_baud(const cmd_args_t *args)
+{
+    if (args->positional_count == 0)
+    {
+        printf("Console baud rate: %lu (saved: %lu)\n", (unsigned long)serial_manager_get_baud(),
+               (unsigned long)settings_get_console_baud(&G_Settings));
+        return;
+    }
+
+    char *end;
+    unsigned long baud = strtoul(args->positional[0], &end, 10);
+    if (*end != '\0' || baud < SERIAL_MIN_BAUD || baud > SERIAL_MAX_BAUD)
+    {
+        printf("Error: baud rate must be %d-%d\n", SERIAL_MIN_BAUD, SERIAL_MAX_BAUD);
+        return;
+    }
+
+    printf("Switching console to %lu baud\n", baud);
+    if (serial_manager_set_baud(baud) != ESP_OK)
+    {
+        printf("Error: could not set the baud rate\n");
+        return;
+    }
+
+    if (!cmd_arg_given(args, "-n"))
+    {
+        settings_set_console_baud(&G_Settings, baud);
+        settings_save(&G_Settings);
+    }
+    printf("Console now at %lu baud%s\n", (unsigned long)serial_manager_get_baud(),
+           cmd_arg_given(args, "-n") ? ", not saved" : "");
+}
+
+void handle_rpc(int argc, char **argv)
+{
+    printf("Switching this console to binary RPC, see scripts/ghost_rpc.py\n");
+    fflush(stdout);
+
+    esp_err_t err = serial_manager_start_rpc();
+    if (err == ESP_ERR_NOT_SUPPORTED)
+    {
+        printf("Error: rpc only works from the serial or USB console\n");
+    }
+    else if (err == ESP_ERR_INVALID_STATE)
+    {
+        printf("Error: an RPC session is already open\n");
+    }
+    else if (err != ESP_OK)
+    {
+        printf("Error: could not start RPC: %s\n", esp_err_to_name(err));
+    }
+}
+
+void handle_exec(const cmd_args_t *args)
+{
+    // Errors name the file and line, the manager prints them
+    script_manager_exec(args->positional[0], cmd_arg_given(args, "-n"));
 }
 
 void handle_reboot(int argc, char **argv)
@@ -667,143 +979,309 @@ void handle_crash(int argc, char **argv)
     *ptr = 42;
 }
 
-void handle_help(int argc, char **argv) {
+void handle_help(const cmd_args_t *args) {
+    if (args->positional_count > 0) {
+        const cmd_spec_t *spec = cmd_registry_find(&command_registry, args->positional[0]);
+        if (spec == NULL) {
+            printf("Unknown command: %s\n", args->positional[0]);
+            return;
+        }
+        print_command_help(spec);
+        return;
+    }
+
     printf("\n Ghost ESP Commands:\n\n");
 
     //print_art();
-    
-    printf("help\n");
-    printf("    Description: Display this help message.\n");
-    printf("    Usage: help\n\n");
-
-    printf("scanap\n");
-    printf("    Description: Start a Wi-Fi access point (AP) scan.\n");
-    printf("    Usage: scanap\n\n");
-
-    printf("scansta\n");
-    printf("    Description: Start scanning for Wi-Fi stations.\n");
-    printf("    Usage: scansta\n\n");
-
-    printf("stopscan\n");
-    printf("    Description: Stop any ongoing Wi-Fi scan.\n");
-    printf("    Usage: stopscan\n\n");
-
-    printf("attack\n");
-    printf("    Description: Launch an attack (e.g., deauthentication attack).\n");
-    printf("    Usage: attack -d\n");
-    printf("    Arguments:\n");
-    printf("        -d  : Start deauth attack\n\n");
-
-    printf("list\n");
-    printf("    Description: List Wi-Fi scan results or connected stations.\n");
-    printf("    Usage: list -a | list -s\n");
-    printf("    Arguments:\n");
-    printf("        -a  : Show access points from Wi-Fi scan\n");
-    printf("        -s  : List connected stations\n\n");
-
-    printf("beaconspam\n");
-    printf("    Description: Start beacon spam with different modes.\n");
-    printf("    Usage: beaconspam [OPTION]\n");
-    printf("    Arguments:\n");
-    printf("        -r   : Start random beacon spam\n");
-    printf("        -rr  : Start Rickroll beacon spam\n");
-    printf("        -l   : Start AP List beacon spam\n");
-    printf("        [SSID]: Use specified SSID for beacon spam\n\n");
-
-    printf("stopspam\n");
-    printf("    Description: Stop ongoing beacon spam.\n");
-    printf("    Usage: stopspam\n\n");
-
-    printf("stopdeauth\n");
-    printf("    Description: Stop ongoing deauthentication attack.\n");
-    printf("    Usage: stopdeauth\n\n");
-
-    printf("select\n");
-    printf("    Description: Select an access point by index from the scan results.\n");
-    printf("    Usage: select -a <number>\n");
-    printf("    Arguments:\n");
-    printf("        -a  : AP selection index (must be a valid number)\n\n");
-
-    printf("startportal\n");
-    printf("    Description: Start a portal with specified SSID and password.\n");
-    printf("    Usage: startportal <URL> <SSID> <Password> <AP_ssid> <Domain>\n");
-    printf("    Arguments:\n");
-    printf("        <URL>       : URL for the portal\n");
-    printf("        <SSID>      : Wi-Fi SSID for the portal\n");
-    printf("        <Password>  : Wi-Fi password for the portal\n");
-    printf("        <AP_ssid>   : SSID for the access point\n\n");
-    printf("        <Domain>    : Custom Domain to Spoof In Address Bar\n\n");
-    printf("  OR \n\n");
-    printf("Offline Usage: startportal <FilePath> <AP_ssid> <Domain>\n");
-
-    printf("stopportal\n");
-    printf("    Description: Stop Evil Portal\n");
-    printf("    Usage: stopportal\n\n");
-
-#ifndef CONFIG_IDF_TARGET_ESP32S2
-    printf("blescan\n");
-    printf("    Description: Handle BLE scanning with various modes.\n");
-    printf("    Usage: blescan [OPTION]\n");
-    printf("    Arguments:\n");
-    printf("        -f   : Start 'Find the Flippers' mode\n");
-    printf("        -ds  : Start BLE spam detector\n");
-    printf("        -a   : Start AirTag scanner\n");
-    printf("        -r   : Scan for raw BLE packets\n");
-    printf("        -s   : Stop BLE scanning\n\n");
-#endif
 
-    printf("capture\n");
-    printf("    Description: Start a WiFi Capture (Requires SD Card or Flipper)\n");
-    printf("    Usage: capture [OPTION]\n");
-    printf("    Arguments:\n");
-    printf("        -probe   : Start Capturing Probe Packets\n");
-    printf("        -beacon  : Start Capturing Beacon Packets\n");
-    printf("        -deauth   : Start Capturing Deauth Packets\n");
-    printf("        -raw   :   Start Capturing Raw Packets\n");
-    printf("        -wps   :   Start Capturing WPS Packets and there Auth Type");
-    printf("        -pwn   :   Start Capturing Pwnagotchi Packets");
-    printf("        -stop   : Stops the active capture\n\n");
-
-
-    printf("connect\n");
-    printf("    Description: Connects to Specific WiFi Network\n");
-    printf("    Usage: connect <SSID> <Password>\n");
+    for (int i = 0; i < command_registry.count; i++) {
+        print_command_help(command_registry.specs[i]);
+    }
+}
 
-    printf("dialconnect\n");
-    printf("    Description: Cast a Random Youtube Video on all Smart TV's on your LAN (Requires You to Run Connect First)\n");
-    printf("    Usage: dialconnect\n");
+// Command specs. Usage, help, validation and completion all come from these,
+// so a new option only needs an entry here and a cmd_arg_* call in its handler.
+
+static const cmd_spec_t help_spec = {
+    .name = "help", .summary = "Display this help message, or the help for one command.",
+    .positional = "[command]", .max_positional = 1, .run = handle_help,
+};
+
+static const cmd_spec_t scanap_spec = {
+    .name = "scanap", .summary = "Start a Wi-Fi access point (AP) scan.", .run_raw = cmd_wifi_scan_start,
+};
+
+static const cmd_spec_t scansta_spec = {
+    .name = "scansta", .summary = "Start scanning for Wi-Fi stations.", .run_raw = handle_sta_scan,
+};
+
+static const cmd_spec_t stopscan_spec = {
+    .name = "stopscan", .summary = "Stop any ongoing Wi-Fi scan.", .run_raw = cmd_wifi_scan_stop,
+};
+
+static const cmd_opt_t attack_opts[] = {
+    { .name = "-d", .flags = CMD_OPT_ALONE, .help = "Start deauth attack" },
+};
+
+static const cmd_spec_t attack_spec = {
+    .name = "attack", .summary = "Launch an attack (e.g., deauthentication attack).",
+    .flags = CMD_SPEC_NEEDS_OPTION, .opts = attack_opts, .opt_count = 1, .run = handle_attack_cmd,
+};
+
+static const char *const station_sort_names[] = { "recent", "frames", "bytes", "rssi", NULL };
+
+static const cmd_opt_t list_opts[] = {
+    { .name = "-a", .flags = CMD_OPT_ALONE, .help = "Show access points from Wi-Fi scan" },
+    { .name = "-s", .help = "List stations with traffic, signal and probe statistics" },
+    { .name = "-o", .type = CMD_OPT_CHOICE, .help = "Sort stations by", .choices = station_sort_names },
+    { .name = "-j", .help = "Print stations as JSON (also saved to SD when mounted)" },
+};
+
+static const cmd_spec_t list_spec = {
+    .name = "list", .summary = "List Wi-Fi scan results or connected stations.",
+    .flags = CMD_SPEC_NEEDS_OPTION, .opts = list_opts, .opt_count = 4, .run = handle_list,
+};
+
+static const cmd_opt_t beaconspam_opts[] = {
+    { .name = "-r", .flags = CMD_OPT_ALONE, .help = "Start random beacon spam" },
+    { .name = "-rr", .flags = CMD_OPT_ALONE, .help = "Start Rickroll beacon spam" },
+    { .name = "-l", .flags = CMD_OPT_ALONE, .help = "Start AP List beacon spam" },
+};
+
+static const cmd_spec_t beaconspam_spec = {
+    .name = "beaconspam", .summary = "Start beacon spam with different modes, or with the given SSID.",
+    .positional = "[SSID]", .max_positional = 1,
+    .opts = beaconspam_opts, .opt_count = 3, .run_raw = handle_beaconspam,
+};
+
+static const cmd_spec_t stopspam_spec = {
+    .name = "stopspam", .summary = "Stop ongoing beacon spam.", .run_raw = handle_stop_spam,
+};
+
+static const cmd_spec_t stopdeauth_spec = {
+    .name = "stopdeauth", .summary = "Stop ongoing deauthentication attack.", .run_raw = handle_stop_deauth,
+};
+
+static const cmd_opt_t select_opts[] = {
+    { .name = "-a", .type = CMD_OPT_INT, .flags = CMD_OPT_ALONE | CMD_OPT_NO_DEFAULT, .value_name = "number",
+      .help = "AP selection index", .min = 0, .max = UINT16_MAX },
+};
+
+static const cmd_spec_t select_spec = {
+    .name = "select", .summary = "Select an access point by index from the scan results.",
+    .flags = CMD_SPEC_NEEDS_OPTION, .opts = select_opts, .opt_count = 1, .run = handle_select_cmd,
+};
+
+static const cmd_opt_t capture_opts[] = {
+    { .name = "-probe", .flags = CMD_OPT_ALONE, .help = "Start Capturing Probe Packets and track probed SSIDs per client" },
+    { .name = "-beacon", .flags = CMD_OPT_ALONE, .help = "Start Capturing Beacon Packets" },
+    { .name = "-deauth", .flags = CMD_OPT_ALONE, .help = "Start Capturing Deauth/Disassoc Packets and alert on floods" },
+    { .name = "-raw", .flags = CMD_OPT_ALONE, .help = "Start Capturing Raw Packets" },
+    { .name = "-eapol", .flags = CMD_OPT_ALONE, .help = "Start Capturing EAPOL Packets" },
+    { .name = "-wps", .type = CMD_OPT_INT, .flags = CMD_OPT_ALONE | CMD_OPT_VALUE_OPTIONAL, .value_name = "max",
+      .help = "Start Capturing WPS Packets and their Auth Type, tracking up to max networks",
+      .min = 1, .max = WPS_SET_MAX_CAPACITY, .def = WPS_SET_DEFAULT_CAPACITY },
+    { .name = "-pwn", .flags = CMD_OPT_ALONE, .help = "Start Capturing Pwnagotchi Packets and list each unit once" },
+    { .name = "-stop", .flags = CMD_OPT_ALONE, .help = "Stops the active capture" },
+};
+
+static const cmd_spec_t capture_spec = {
+    .name = "capture", .summary = "Start a WiFi Capture (Requires SD Card or Flipper)",
+    .flags = CMD_SPEC_NEEDS_OPTION, .opts = capture_opts, .opt_count = 8, .run = handle_capture_scan,
+};
+
+static const cmd_opt_t probes_opts[] = {
+    { .name = "-j", .help = "Print as JSON (also saved to SD when mounted)" },
+    { .name = "-c", .help = "Show randomized MACs grouped by probe fingerprint" },
+};
+
+static const cmd_spec_t probes_spec = {
+    .name = "probes", .summary = "Show the SSIDs each client probed for during capture -probe",
+    .opts = probes_opts, .opt_count = 2, .run = handle_probes,
+};
+
+static const cmd_opt_t rogueap_opts[] = {
+    { .name = "-f", .type = CMD_OPT_STRING, .value_name = "allowlist.csv",
+      .help = "Allowlist to load (default " ROGUE_AP_DEFAULT_ALLOWLIST ")" },
+    { .name = "-s", .flags = CMD_OPT_ALONE, .help = "Stop rogue AP detection" },
+};
+
+static const cmd_spec_t rogueap_spec = {
+    .name = "rogueap", .summary = "Alert on beacons that impersonate allowlisted networks (evil twins, downgrades, wrong channel)",
+    .opts = rogueap_opts, .opt_count = 2, .run = handle_rogueap,
+};
+
+static const cmd_spec_t startportal_spec = {
+    .name = "startportal",
+    .summary = "Start an evil portal. Arguments left out come from the saved settings; "
+               "the offline form serves a file from the SD card.",
+    .usage = "startportal <URL> <SSID> <Password> <AP_ssid> <Domain> | startportal <FilePath> <AP_ssid> <Domain>",
+    .flags = CMD_SPEC_RAW, .run_raw = handle_start_portal,
+};
+
+static const cmd_spec_t stopportal_spec = {
+    .name = "stopportal", .summary = "Stop Evil Portal", .run_raw = stop_portal,
+};
+
+static const cmd_spec_t connect_spec = {
+    .name = "connect", .summary = "Connects to Specific WiFi Network",
+    .positional = "<SSID> <Password>", .min_positional = 2, .max_positional = 2,
+    .run_raw = handle_wifi_connection,
+};
+
+static const cmd_spec_t dialconnect_spec = {
+    .name = "dialconnect",
+    .summary = "Cast a Random Youtube Video on all Smart TV's on your LAN (Requires You to Run Connect First)",
+    .run_raw = handle_dial_command,
+};
+
+static const cmd_spec_t powerprinter_spec = {
+    .name = "powerprinter",
+    .summary = "Print Custom Text to a Printer on your LAN (Requires You to Run Connect First). "
+               "Alignment is CM (Center Middle), TL, TR, BR or BL; arguments left out come from the saved settings.",
+    .positional = "<Printer IP> <Text> <FontSize> <alignment>", .max_positional = 4,
+    .run_raw = handle_printer_command,
+};
+
+static const cmd_spec_t tplinktest_spec = {
+    .name = "tplinktest", .summary = "Switch TP-Link smart plugs on your LAN on or off, or keep toggling them.",
+    .positional = "<on|off|loop>", .min_positional = 1, .max_positional = 1,
+    .run_raw = handle_tp_link_test,
+};
+
+static const cmd_spec_t stop_spec = {
+    .name = "stop", .summary = "Stop deauthing, BLE scans and captures, and coexistence mode.",
+    .run_raw = handle_stop_flipper,
+};
+
+static const cmd_spec_t jobs_spec = {
+    .name = "jobs", .summary = "List running and recent jobs with their runtime, heap change and progress.",
+    .run_raw = handle_jobs,
+};
+
+static const cmd_spec_t kill_spec = {
+    .name = "kill", .summary = "Stop a running job by its id from jobs.",
+    .positional = "<id>", .min_positional = 1, .max_positional = 1, .run = handle_kill,
+};
+
+static const cmd_opt_t exec_opts[] = {
+    { .name = "-n", .help = "Check the script without running it" },
+};
+
+static const cmd_spec_t exec_spec = {
+    .name = "exec", .summary = "Run a script of console commands from the SD card in the background.",
+    .positional = "<file>", .min_positional = 1, .max_positional = 1,
+    .opts = exec_opts, .opt_count = 1, .run = handle_exec,
+};
+
+static const cmd_opt_t serialstats_opts[] = {
+    { .name = "-r", .help = "Reset the counters after printing them" },
+};
+
+static const cmd_spec_t serialstats_spec = {
+    .name = "serialstats", .summary = "Show console wakeups, idle wakeups per second and command latency.",
+    .opts = serialstats_opts, .opt_count = 1, .run = handle_serialstats,
+};
+
+static const cmd_opt_t baud_opts[] = {
+    { .name = "-n", .help = "Switch now without saving, a reset goes back to the saved rate" },
+};
+
+static const cmd_spec_t baud_spec = {
+    .name = "baud", .summary = "Show or change the UART console baud rate, saved across resets.",
+    .positional = "[rate]", .max_positional = 1, .opts = baud_opts, .opt_count = 1, .run = handle_baud,
+};
+
+static const cmd_spec_t rpc_spec = {
+    .name = "rpc", .summary = "Switch this console to framed binary RPC for scripted control (scripts/ghost_rpc.py).",
+    .run_raw = handle_rpc,
+};
+
+static const cmd_spec_t reboot_spec = {
+    .name = "reboot", .summary = "Restart the device.", .run_raw = handle_reboot,
+};
 
+#ifdef DEBUG
+static const cmd_spec_t crash_spec = {
+    .name = "crash", .summary = "Dereference NULL to test crash handling.", .run_raw = handle_crash,
+};
+#endif
 
-    printf("powerprinter\n");
-    printf("    Description: Print Custom Text to a Printer on your LAN (Requires You to Run Connect First)\n");
-    printf("    Usage: powerprinter <Printer IP> <Text> <FontSize> <alignment>\n");
-    printf("    aligment options: CM = Center Middle, TL = Top Left, TR = Top Right, BR = Bottom Right, BL = Bottom Left\n\n");
-}
+#ifndef CONFIG_IDF_TARGET_ESP32S2
+static const cmd_opt_t blescan_opts[] = {
+    { .name = "-f", .flags = CMD_OPT_ALONE, .help = "Start 'Find the Flippers' mode" },
+    { .name = "-ds", .flags = CMD_OPT_ALONE, .help = "Start BLE spam detector (alerts with spam type and intensity)" },
+    { .name = "-a", .flags = CMD_OPT_ALONE, .help = "Start AirTag scanner" },
+    { .name = "-t", .type = CMD_OPT_INT, .flags = CMD_OPT_ALONE | CMD_OPT_VALUE_OPTIONAL, .value_name = "minutes",
+      .help = "Alert on a Find My / Tile / SmartTag tracker that stays nearby",
+      // The presence history only reaches back an hour
+      .min = 1, .max = TRACKER_HISTORY_BUCKETS - TRACKER_MAX_GAP_BUCKETS, .def = TRACKER_DEFAULT_DWELL_MS / 60000 },
+    { .name = "-r", .flags = CMD_OPT_ALONE, .help = "Scan for raw BLE packets" },
+    { .name = "-pcap", .flags = CMD_OPT_ALONE, .help = "Capture BLE advertisements to a PCAP file (Bluetooth LE LL with PHDR)" },
+    { .name = "-l", .flags = CMD_OPT_ALONE, .help = "List BLE devices seen by the current or last scan" },
+    { .name = "-n", .type = CMD_OPT_INT, .flags = CMD_OPT_ALONE | CMD_OPT_VALUE_OPTIONAL, .value_name = "max",
+      .help = "Track up to max devices from the next scan on",
+      .min = 1, .max = BLE_DEVICE_TABLE_MAX_DEVICES, .def = BLE_DEVICE_TABLE_DEFAULT_DEVICES },
+    { .name = "-s", .flags = CMD_OPT_ALONE, .help = "Stop BLE scanning" },
+};
+
+static const cmd_spec_t blescan_spec = {
+    .name = "blescan", .summary = "Handle BLE scanning with various modes.",
+    .flags = CMD_SPEC_NEEDS_OPTION, .opts = blescan_opts, .opt_count = 9, .run = handle_ble_scan_cmd,
+};
+
+static const cmd_opt_t coex_opts[] = {
+    { .name = "-w", .type = CMD_OPT_INT, .value_name = "wifi %",
+      .help = "Share of time for WiFi capture, BLE gets the rest unless -b is given",
+      .min = 0, .max = 100, .def = COEX_DEFAULT_WIFI_PCT },
+    { .name = "-b", .type = CMD_OPT_INT, .flags = CMD_OPT_NO_DEFAULT, .value_name = "ble %",
+      .help = "Share of time for BLE scanning, anything left over is idle",
+      .min = 0, .max = 100, .def = COEX_DEFAULT_BLE_PCT },
+    { .name = "-t", .type = CMD_OPT_INT, .value_name = "slot ms", .help = "Slot length in ms",
+      .min = COEX_MIN_SLOT_MS, .max = COEX_MAX_SLOT_MS, .def = COEX_DEFAULT_SLOT_MS },
+    { .name = "-i", .flags = CMD_OPT_ALONE, .help = "Show effective duty cycle and worst gap per radio" },
+    { .name = "-s", .flags = CMD_OPT_ALONE, .help = "Stop coexistence mode" },
+};
+
+static const cmd_spec_t coex_spec = {
+    .name = "coex", .summary = "Time-slice passive WiFi station capture and BLE scanning.",
+    .opts = coex_opts, .opt_count = 5, .run = handle_coex_cmd,
+};
+#endif
 
 void register_commands() {
-    register_command("help", handle_help);
-    register_command("scanap", cmd_wifi_scan_start);
-    register_command("scansta", handle_sta_scan);
-    register_command("stopscan", cmd_wifi_scan_stop);
-    register_command("attack", handle_attack_cmd);
-    register_command("list", handle_list);
-    register_command("beaconspam", handle_beaconspam);
-    register_command("stopspam", handle_stop_spam);
-    register_command("stopdeauth", handle_stop_deauth);
-    register_command("select", handle_select_cmd);
-    register_command("capture", handle_capture_scan);
-    register_command("startportal", handle_start_portal);
-    register_command("stopportal", stop_portal);
-    register_command("connect", handle_wifi_connection);
-    register_command("dialconnect", handle_dial_command);
-    register_command("powerprinter", handle_printer_command);
-    register_command("tplinktest", handle_tp_link_test);
-    register_command("stop", handle_stop_flipper);
-    register_command("reboot", handle_reboot);
+    register_command(&help_spec);
+    register_command(&scanap_spec);
+    register_command(&scansta_spec);
+    register_command(&stopscan_spec);
+    register_command(&attack_spec);
+    register_command(&list_spec);
+    register_command(&beaconspam_spec);
+    register_command(&stopspam_spec);
+    register_command(&stopdeauth_spec);
+    register_command(&select_spec);
+    register_command(&capture_spec);
+    register_command(&probes_spec);
+    register_command(&rogueap_spec);
+    register_command(&startportal_spec);
+    register_command(&stopportal_spec);
+    register_command(&connect_spec);
+    register_command(&dialconnect_spec);
+    register_command(&powerprinter_spec);
+    register_command(&tplinktest_spec);
+    register_command(&stop_spec);
+    register_command(&jobs_spec);
+    register_command(&kill_spec);
+    register_command(&exec_spec);
+    register_command(&serialstats_spec);
+    register_command(&baud_spec);
+    register_command(&rpc_spec);
+    register_command(&reboot_spec);
 #ifdef DEBUG
-    register_command("crash", handle_crash); // For Debugging
+    register_command(&crash_spec); // For Debugging
 #endif
 #ifndef CONFIG_IDF_TARGET_ESP32S2
-    register_command("blescan", handle_ble_scan_cmd);
+    register_command(&blescan_spec);
+    register_command(&coex_spec);
 #endif
 }
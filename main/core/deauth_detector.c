@@ -0,0 +1,203 @@
+#include "core/deauth_detector.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WINDOW_MS (DEAUTH_DETECTOR_BUCKETS * DEAUTH_DETECTOR_BUCKET_MS)
+
+static uint32_t mac_hash(const uint8_t *mac, uint8_t key_type) {
+    // FNV-1a over the address and key type
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        h ^= mac[i];
+        h *= 16777619u;
+    }
+    h ^= key_type;
+    h *= 16777619u;
+    return h;
+}
+
+// Slide the window forward so the newest bucket matches now_ms.
+static void advance_window(deauth_tracker_t *t, uint32_t now_ms) {
+    uint32_t epoch = now_ms / DEAUTH_DETECTOR_BUCKET_MS;
+    uint32_t delta = epoch - t->head_epoch;
+
+    if (delta == 0) {
+        return;
+    }
+
+    if (delta >= DEAUTH_DETECTOR_BUCKETS) {
+        memset(t->buckets, 0, sizeof(t->buckets));
+        t->window_total = 0;
+    } else {
+        for (uint32_t i = 1; i <= delta; i++) {
+            uint32_t idx = (t->head_epoch + i) % DEAUTH_DETECTOR_BUCKETS;
+            t->window_total -= t->buckets[idx];
+            t->buckets[idx] = 0;
+        }
+    }
+
+    t->head_epoch = epoch;
+
+    if (t->window_total == 0) {
+        // Burst is over, start a fresh histogram for the next one
+        memset(t->reason_hist, 0, sizeof(t->reason_hist));
+        t->deauth_count = 0;
+        t->disassoc_count = 0;
+        t->alerted = false;
+    }
+}
+
+static deauth_tracker_t *find_tracker(deauth_detector_t *det, deauth_key_type_t key_type,
+                                      const uint8_t *mac, bool create, uint32_t now_ms) {
+    uint32_t start = mac_hash(mac, key_type) % DEAUTH_DETECTOR_MAX_TRACKED;
+    deauth_tracker_t *free_slot = NULL;
+    deauth_tracker_t *oldest = NULL;
+
+    for (int i = 0; i < DEAUTH_DETECTOR_MAX_PROBE; i++) {
+        deauth_tracker_t *t = &det->trackers[(start + i) % DEAUTH_DETECTOR_MAX_TRACKED];
+
+        if (!t->in_use) {
+            if (free_slot == NULL) {
+                free_slot = t;
+            }
+            continue;
+        }
+
+        if (t->key_type == key_type && memcmp(t->mac, mac, 6) == 0) {
+            return t;
+        }
+
+        if (oldest == NULL || (now_ms - t->last_seen_ms) > (now_ms - oldest->last_seen_ms)) {
+            oldest = t;
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    deauth_tracker_t *slot = free_slot;
+    if (slot == NULL) {
+        // Probe window is full, recycle the least recently seen key
+        slot = oldest;
+        det->evictions++;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->in_use = true;
+    slot->key_type = key_type;
+    memcpy(slot->mac, mac, 6);
+    slot->head_epoch = now_ms / DEAUTH_DETECTOR_BUCKET_MS;
+    return slot;
+}
+
+static bool track_frame(deauth_detector_t *det, deauth_key_type_t key_type, const uint8_t *mac,
+                        const uint8_t *peer, uint8_t subtype, uint16_t reason, uint32_t now_ms,
+                        deauth_alert_t *alert) {
+    deauth_tracker_t *t = find_tracker(det, key_type, mac, true, now_ms);
+
+    advance_window(t, now_ms);
+
+    uint32_t idx = t->head_epoch % DEAUTH_DETECTOR_BUCKETS;
+    if (t->buckets[idx] < UINT16_MAX) {
+        t->buckets[idx]++;
+        t->window_total++;
+    }
+
+    uint16_t bin = reason < DEAUTH_DETECTOR_REASON_BINS - 1 ? reason : DEAUTH_DETECTOR_REASON_BINS - 1;
+    if (t->reason_hist[bin] < UINT16_MAX) {
+        t->reason_hist[bin]++;
+    }
+
+    if (subtype == DEAUTH_SUBTYPE_DISASSOC) {
+        t->disassoc_count++;
+    } else {
+        t->deauth_count++;
+    }
+
+    memcpy(t->last_peer, peer, 6);
+    t->last_seen_ms = now_ms;
+
+    if (t->window_total < det->threshold) {
+        return false;
+    }
+
+    if (t->alerted && (now_ms - t->last_alert_ms) < det->holdoff_ms) {
+        return false;
+    }
+
+    t->alerted = true;
+    t->last_alert_ms = now_ms;
+
+    alert->key_type = key_type;
+    memcpy(alert->target, t->mac, 6);
+    memcpy(alert->peer, t->last_peer, 6);
+    alert->frames_in_window = t->window_total;
+    alert->rate_per_sec = (t->window_total * 1000) / WINDOW_MS;
+    alert->deauth_count = t->deauth_count;
+    alert->disassoc_count = t->disassoc_count;
+    memcpy(alert->reason_hist, t->reason_hist, sizeof(alert->reason_hist));
+    return true;
+}
+
+void deauth_detector_init(deauth_detector_t *det, uint32_t threshold, uint32_t holdoff_ms) {
+    memset(det, 0, sizeof(*det));
+    det->threshold = threshold > 0 ? threshold : DEAUTH_DETECTOR_DEFAULT_THRESHOLD;
+    det->holdoff_ms = holdoff_ms;
+}
+
+int deauth_detector_process(deauth_detector_t *det, const uint8_t *bssid, const uint8_t *source,
+                            uint8_t subtype, uint16_t reason, uint32_t now_ms,
+                            deauth_alert_t alerts[2]) {
+    int count = 0;
+
+    det->frames_seen++;
+
+    if (track_frame(det, DEAUTH_KEY_BSSID, bssid, source, subtype, reason, now_ms, &alerts[count])) {
+        count++;
+    }
+
+    // Spoofed floods usually carry the AP address as transmitter, don't double count those
+    if (memcmp(bssid, source, 6) != 0 &&
+        track_frame(det, DEAUTH_KEY_SOURCE, source, bssid, subtype, reason, now_ms, &alerts[count])) {
+        count++;
+    }
+
+    return count;
+}
+
+uint32_t deauth_detector_window_count(deauth_detector_t *det, deauth_key_type_t key_type,
+                                      const uint8_t *mac, uint32_t now_ms) {
+    deauth_tracker_t *t = find_tracker(det, key_type, mac, false, now_ms);
+    if (t == NULL) {
+        return 0;
+    }
+
+    advance_window(t, now_ms);
+    return t->window_total;
+}
+
+void deauth_detector_format_reasons(const uint16_t *hist, char *out, size_t out_size) {
+    size_t offset = 0;
+
+    if (out_size == 0) {
+        return;
+    }
+    out[0] = '\0';
+
+    for (int i = 0; i < DEAUTH_DETECTOR_REASON_BINS; i++) {
+        if (hist[i] == 0) {
+            continue;
+        }
+
+        int written = snprintf(out + offset, out_size - offset, "%s%s%d:%u",
+                               offset > 0 ? " " : "",
+                               i == DEAUTH_DETECTOR_REASON_BINS - 1 ? ">=" : "",
+                               i, hist[i]);
+        if (written < 0 || (size_t)written >= out_size - offset) {
+            out[offset] = '\0';   // Drop the pair that did not fit rather than half of it
+            break;
+        }
+        offset += written;
+    }
+}
@@ -0,0 +1,152 @@
+#include "core/job_table.h"
+#include <string.h>
+
+void job_table_init(job_table_t *t, job_finish_cb_t on_finish, void *ctx) {
+    memset(t, 0, sizeof(*t));
+    t->next_id = 1;
+    t->on_finish = on_finish;
+    t->ctx = ctx;
+}
+
+bool job_state_active(job_state_t state) {
+    return state == JOB_RUNNING || state == JOB_STOPPING;
+}
+
+const char *job_state_name(job_state_t state) {
+    switch (state) {
+        case JOB_RUNNING: return "running";
+        case JOB_STOPPING: return "stopping";
+        case JOB_DONE: return "done";
+        case JOB_CANCELLED: return "cancelled";
+        default: return "failed";
+    }
+}
+
+uint32_t job_table_held(const job_table_t *t) {
+    uint32_t held = 0;
+    for (size_t i = 0; i < JOB_TABLE_SLOTS; i++) {
+        if (t->jobs[i].id != 0 && job_state_active(t->jobs[i].state)) {
+            held |= t->jobs[i].resources;
+        }
+    }
+    return held;
+}
+
+uint32_t job_table_start(job_table_t *t, const char *label, uint32_t resources, const void *owner,
+                         uint32_t now_ms, uint32_t heap_free, uint32_t *holder) {
+    job_t *slot = NULL;
+    *holder = 0;
+
+    for (size_t i = 0; i < JOB_TABLE_SLOTS; i++) {
+        job_t *job = &t->jobs[i];
+        if (job->id != 0 && job_state_active(job->state)) {
+            if (job->resources & resources) {
+                *holder = job->id;
+                return 0;
+            }
+            continue;
+        }
+        // Prefer an empty slot, then the oldest finished job
+        if (slot == NULL || (slot->id != 0 && (job->id == 0 || job->id < slot->id))) {
+            slot = job;
+        }
+    }
+    if (slot == NULL) {
+        return 0;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->id = t->next_id++;
+    if (t->next_id == 0) {
+        t->next_id = 1;
+    }
+    slot->state = JOB_RUNNING;
+    strncpy(slot->label, label, sizeof(slot->label) - 1);
+    slot->resources = resources;
+    slot->owner = owner;
+    slot->started_ms = now_ms;
+    slot->heap_at_start = heap_free;
+    return slot->id;
+}
+
+job_t *job_table_find(job_table_t *t, uint32_t id) {
+    if (id == 0) {
+        return NULL;
+    }
+    for (size_t i = 0; i < JOB_TABLE_SLOTS; i++) {
+        if (t->jobs[i].id == id) {
+            return &t->jobs[i];
+        }
+    }
+    return NULL;
+}
+
+bool job_table_stop(job_table_t *t, uint32_t id) {
+    job_t *job = job_table_find(t, id);
+    if (job == NULL || job->state != JOB_RUNNING) {
+        return false;
+    }
+    job->state = JOB_STOPPING;
+    return true;
+}
+
+static void finish(job_table_t *t, job_t *job, int32_t result, uint32_t now_ms, uint32_t heap_free) {
+    if (job->state == JOB_STOPPING) {
+        job->state = JOB_CANCELLED;
+    } else {
+        job->state = result == 0 ? JOB_DONE : JOB_FAILED;
+    }
+    job->result = result;
+    job->ended_ms = now_ms;
+    job->heap_delta = (int32_t)(heap_free - job->heap_at_start);
+    if (t->on_finish) {
+        t->on_finish(job, t->ctx);
+    }
+}
+
+bool job_table_finish(job_table_t *t, uint32_t id, int32_t result, uint32_t now_ms, uint32_t heap_free) {
+    job_t *job = job_table_find(t, id);
+    if (job == NULL || !job_state_active(job->state)) {
+        return false;
+    }
+    finish(t, job, result, now_ms, heap_free);
+    return true;
+}
+
+size_t job_table_release(job_table_t *t, const void *owner, int32_t result, uint32_t now_ms, uint32_t heap_free) {
+    size_t ended = 0;
+    for (size_t i = 0; i < JOB_TABLE_SLOTS; i++) {
+        job_t *job = &t->jobs[i];
+        if (job->id != 0 && job_state_active(job->state) && job->owner == owner) {
+            finish(t, job, result, now_ms, heap_free);
+            ended++;
+        }
+    }
+    return ended;
+}
+
+uint32_t job_runtime_ms(const job_t *job, uint32_t now_ms) {
+    return (job_state_active(job->state) ? now_ms : job->ended_ms) - job->started_ms;
+}
+
+size_t job_table_list(job_table_t *t, job_t **out, size_t max_out) {
+    size_t count = 0;
+    for (size_t i = 0; i < JOB_TABLE_SLOTS; i++) {
+        if (t->jobs[i].id == 0) {
+            continue;
+        }
+        // Insertion sort by id, newest first
+        size_t pos = count < max_out ? count : max_out;
+        while (pos > 0 && out[pos - 1]->id < t->jobs[i].id) {
+            if (pos < max_out) {
+                out[pos] = out[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max_out) {
+            out[pos] = &t->jobs[i];
+        }
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,35 @@
+#include "core/json_util.h"
+#include <stdio.h>
+#include <string.h>
+
+static size_t put(char *out, size_t out_size, size_t used, const char *s, size_t n) {
+    if (used < out_size) {
+        size_t room = out_size - used - 1;
+        size_t copy = n < room ? n : room;
+        memcpy(&out[used], s, copy);
+        out[used + copy] = '\0';
+    }
+    return used + n;
+}
+
+size_t json_append_string(char *out, size_t out_size, size_t used, const char *s) {
+    used = put(out, out_size, used, "\"", 1);
+
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        char esc[7];
+
+        if (ch == '"' || ch == '\\') {
+            esc[0] = '\\';
+            esc[1] = (char)ch;
+            used = put(out, out_size, used, esc, 2);
+        } else if (ch < 0x20 || ch >= 0x7F) {
+            snprintf(esc, sizeof(esc), "\\u%04x", ch);
+            used = put(out, out_size, used, esc, 6);
+        } else {
+            used = put(out, out_size, used, (const char *)&ch, 1);
+        }
+    }
+
+    return put(out, out_size, used, "\"", 1);
+}
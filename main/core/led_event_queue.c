@@ -0,0 +1,90 @@
+#include "core/led_event_queue.h"
+#include <string.h>
+
+void led_event_queue_init(led_event_queue_t *q) {
+    memset(q, 0, sizeof(*q));
+}
+
+// Index of the event that should go first (or be kept longest)
+static int best_index(const led_event_queue_t *q) {
+    int best = -1;
+    for (int i = 0; i < q->length; i++) {
+        const led_event_t *e = &q->events[i];
+        if (best < 0 || e->priority > q->events[best].priority ||
+            (e->priority == q->events[best].priority && e->seq < q->events[best].seq)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Index of the event to give up first: lowest priority, newest
+static int worst_index(const led_event_queue_t *q) {
+    int worst = -1;
+    for (int i = 0; i < q->length; i++) {
+        const led_event_t *e = &q->events[i];
+        if (worst < 0 || e->priority < q->events[worst].priority ||
+            (e->priority == q->events[worst].priority && e->seq > q->events[worst].seq)) {
+            worst = i;
+        }
+    }
+    return worst;
+}
+
+bool led_event_queue_post(led_event_queue_t *q, uint8_t red, uint8_t green, uint8_t blue,
+                          led_pattern_t pattern, led_event_priority_t priority) {
+    q->posted++;
+
+    // A burst of the same notification shows once
+    for (int i = 0; i < q->length; i++) {
+        led_event_t *e = &q->events[i];
+        if (e->red == red && e->green == green && e->blue == blue && e->pattern == pattern) {
+            if (priority > e->priority) {
+                e->priority = (uint8_t)priority;
+            }
+            if (e->count < UINT16_MAX) {
+                e->count++;
+            }
+            q->coalesced++;
+            return true;
+        }
+    }
+
+    led_event_t *slot;
+    if (q->length < LED_EVENT_QUEUE_LEN) {
+        slot = &q->events[q->length++];
+    } else {
+        int worst = worst_index(q);
+        if (q->events[worst].priority >= priority) {
+            q->dropped++;
+            return false;
+        }
+        slot = &q->events[worst];
+        q->dropped++;
+    }
+
+    slot->red = red;
+    slot->green = green;
+    slot->blue = blue;
+    slot->pattern = (uint8_t)pattern;
+    slot->priority = (uint8_t)priority;
+    slot->count = 1;
+    slot->seq = q->next_seq++;
+    return true;
+}
+
+bool led_event_queue_pop(led_event_queue_t *q, led_event_t *out) {
+    int best = best_index(q);
+    if (best < 0) {
+        return false;
+    }
+
+    *out = q->events[best];
+    q->events[best] = q->events[--q->length];
+    return true;
+}
+
+int led_event_queue_top_priority(const led_event_queue_t *q) {
+    int best = best_index(q);
+    return best < 0 ? -1 : q->events[best].priority;
+}
@@ -0,0 +1,70 @@
+#include "core/line_discipline.h"
+#include <string.h>
+
+void line_discipline_init(line_discipline_t *ld, char *buf, size_t cap,
+                          line_discipline_line_cb_t on_line,
+                          line_discipline_complete_cb_t on_complete, void *ctx) {
+    memset(ld, 0, sizeof(*ld));
+    ld->buf = buf;
+    ld->cap = cap;
+    ld->on_line = on_line;
+    ld->on_complete = on_complete;
+    ld->ctx = ctx;
+}
+
+void line_discipline_reset(line_discipline_t *ld) {
+    ld->len = 0;
+    ld->discarding = false;
+    ld->after_cr = false;
+}
+
+static void end_of_line(line_discipline_t *ld) {
+    if (ld->discarding) {
+        ld->discarding = false;
+        return;
+    }
+    if (ld->len == 0) {
+        return;
+    }
+
+    ld->buf[ld->len] = '\0';
+    size_t len = ld->len;
+    ld->len = 0;
+    ld->lines++;
+    ld->on_line(ld->buf, len, ld->ctx);
+}
+
+void line_discipline_feed(line_discipline_t *ld, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = data[i];
+        bool after_cr = ld->after_cr;
+        ld->after_cr = c == '\r';
+
+        if (c == '\r' || c == '\n') {
+            if (c == '\n' && after_cr) {
+                continue;
+            }
+            end_of_line(ld);
+        } else if (c == '\b' || c == 0x7F) {
+            if (ld->len > 0 && !ld->discarding) {
+                ld->len--;
+            }
+        } else if (c == '\t') {
+            if (ld->on_complete && !ld->discarding) {
+                ld->buf[ld->len] = '\0';
+                size_t n = ld->on_complete(ld->buf, ld->len, ld->cap - 1, ld->ctx);
+                ld->len = n < ld->cap ? n : ld->cap - 1;
+            }
+        } else if (c < 0x20) {
+            // Other control characters never belong in a command
+        } else if (ld->discarding) {
+            // Keep dropping until the end of the line
+        } else if (ld->len < ld->cap - 1) {
+            ld->buf[ld->len++] = (char)c;
+        } else {
+            ld->len = 0;
+            ld->discarding = true;
+            ld->overflows++;
+        }
+    }
+}
@@ -0,0 +1,186 @@
+#include "core/log_ring.h"
+#include <string.h>
+
+#define SLOT_WRITING  0x1u
+#define SLOT_HOLE     0x2u       // Final for its sequence number, nothing to read
+#define SLOT_MASK     (LOG_RING_SLOTS - 1)
+
+_Static_assert((LOG_RING_SLOTS & SLOT_MASK) == 0, "LOG_RING_SLOTS must be a power of two");
+_Static_assert(LOG_RING_TEXT <= UINT8_MAX, "slot length is a uint8_t");
+
+// Slot states keep 30 bits of the sequence number, compare them modulo that
+static int32_t seq_diff(uint32_t state, uint32_t seq) {
+    return (int32_t)((state & ~3u) - (seq << 2)) / 4;
+}
+
+void log_ring_init(log_ring_t *r) {
+    memset(r, 0, sizeof(*r));
+    // Each slot starts as a hole one lap before its first line, so readers
+    // wait for that line instead of taking the zeroed slot as line 0
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++) {
+        atomic_init(&r->slots[i].state, ((i - LOG_RING_SLOTS) << 2) | SLOT_HOLE);
+    }
+    atomic_init(&r->head, 0);
+    atomic_init(&r->lost, 0);
+}
+
+static void put(log_ring_t *r, uint8_t level, uint8_t flags, uint32_t ms, const char *text, size_t len) {
+    uint32_t seq = atomic_fetch_add_explicit(&r->head, 1, memory_order_relaxed);
+    log_slot_t *slot = &r->slots[seq & SLOT_MASK];
+    uint32_t mine = seq << 2;
+    uint32_t state = atomic_load_explicit(&slot->state, memory_order_relaxed);
+
+    for (;;) {
+        if (seq_diff(state, seq) >= 0) {
+            // Lapped before starting, a newer line already has the slot
+            atomic_fetch_add_explicit(&r->lost, 1, memory_order_relaxed);
+            return;
+        }
+        if (state & SLOT_WRITING) {
+            // An older writer is still copying; it turns the slot into our
+            // hole when it finds out, rather than either of us waiting
+            if (atomic_compare_exchange_weak_explicit(&slot->state, &state, mine | SLOT_WRITING | SLOT_HOLE,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                atomic_fetch_add_explicit(&r->lost, 1, memory_order_relaxed);
+                return;
+            }
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&slot->state, &state, mine | SLOT_WRITING,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            break;
+        }
+    }
+    atomic_thread_fence(memory_order_release);
+
+    slot->ms = ms;
+    slot->level = level;
+    slot->flags = flags;
+    slot->len = (uint8_t)len;
+    memcpy(slot->text, text, len);
+
+    uint32_t expected = mine | SLOT_WRITING;
+    if (!atomic_compare_exchange_strong_explicit(&slot->state, &expected, mine,
+                                                 memory_order_release, memory_order_relaxed)) {
+        // Lapped while copying: publish the newer writer's hole, ours is lost too
+        while (!atomic_compare_exchange_weak_explicit(&slot->state, &expected, expected & ~SLOT_WRITING,
+                                                      memory_order_release, memory_order_relaxed)) {
+        }
+        atomic_fetch_add_explicit(&r->lost, 1, memory_order_relaxed);
+    }
+}
+
+size_t log_ring_write(log_ring_t *r, uint8_t level, uint8_t flags, uint32_t ms, const char *text, size_t len) {
+    size_t used = 0;
+    while (len > 0) {
+        size_t chunk = len > LOG_RING_TEXT ? LOG_RING_TEXT : len;
+        put(r, level, flags, ms, text, chunk);
+        text += chunk;
+        len -= chunk;
+        used++;
+    }
+    return used;
+}
+
+bool log_ring_read(log_ring_t *r, log_cursor_t *c, log_entry_t *out) {
+    for (;;) {
+        uint32_t behind = atomic_load_explicit(&r->head, memory_order_acquire) - c->next;
+        if (behind == 0) {
+            return false;
+        }
+        if (behind > LOG_RING_SLOTS) {
+            c->missed += behind - LOG_RING_SLOTS;
+            c->next += behind - LOG_RING_SLOTS;
+        }
+
+        log_slot_t *slot = &r->slots[c->next & SLOT_MASK];
+        uint32_t state = atomic_load_explicit(&slot->state, memory_order_acquire);
+        int32_t diff = seq_diff(state, c->next);
+        if (diff < 0 || (diff == 0 && (state & (SLOT_WRITING | SLOT_HOLE)) == SLOT_WRITING)) {
+            return false;
+        }
+        if (diff > 0 || (state & SLOT_HOLE)) {
+            c->missed++;
+            c->next++;
+            continue;
+        }
+
+        uint8_t len = slot->len;
+        if (len > LOG_RING_TEXT) {
+            len = LOG_RING_TEXT;
+        }
+        out->ms = slot->ms;
+        out->level = slot->level;
+        out->flags = slot->flags;
+        memcpy(out->text, slot->text, len);
+
+        // A writer that took the slot during the copy changed its state
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->state, memory_order_relaxed) != state) {
+            c->missed++;
+            c->next++;
+            continue;
+        }
+        out->len = len;
+        out->text[len] = '\0';
+        out->seq = c->next++;
+        return true;
+    }
+}
+
+void log_ring_cursor_init(log_ring_t *r, log_cursor_t *c, bool history) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    c->missed = 0;
+    if (!history) {
+        c->next = head;
+    } else {
+        c->next = head < LOG_RING_SLOTS ? 0 : head - LOG_RING_SLOTS;
+    }
+}
+
+void log_ring_cursor_from(log_ring_t *r, log_cursor_t *c, uint32_t seq) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    // Not modular: a client from before a restart can be any distance ahead
+    if (seq > head) {
+        log_ring_cursor_init(r, c, true);
+        return;
+    }
+    // log_ring_read skips ahead and counts the missed lines
+    c->next = seq;
+    c->missed = 0;
+}
+
+uint32_t log_ring_head(log_ring_t *r) {
+    return atomic_load_explicit(&r->head, memory_order_acquire);
+}
+
+uint8_t log_ring_clean_line(char *line, size_t *len) {
+    size_t out = 0;
+    for (size_t i = 0; i < *len; i++) {
+        // CSI sequences such as "\033[0;31m", up to their final letter
+        if (line[i] == '\033' && i + 1 < *len && line[i + 1] == '[') {
+            i += 2;
+            while (i < *len && !(line[i] >= 0x40 && line[i] <= 0x7e)) {
+                i++;
+            }
+            continue;
+        }
+        line[out++] = line[i];
+    }
+    while (out > 0 && (line[out - 1] == '\n' || line[out - 1] == '\r')) {
+        out--;
+    }
+    line[out] = '\0';
+    *len = out;
+
+    if (out >= 3 && line[1] == ' ' && line[2] == '(') {
+        switch (line[0]) {
+            case 'E': return LOG_RING_ERROR;
+            case 'W': return LOG_RING_WARN;
+            case 'D': return LOG_RING_DEBUG;
+            case 'V': return LOG_RING_VERBOSE;
+            default: break;
+        }
+    }
+    return LOG_RING_INFO;
+}
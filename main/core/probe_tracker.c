@@ -0,0 +1,345 @@
+#include "core/probe_tracker.h"
+#include "core/json_util.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MGMT_HDR_LEN 24
+#define SUBTYPE_PROBE_REQ 0x40
+
+#define IE_SSID      0
+#define IE_DS_PARAMS 3
+#define IE_VENDOR    221
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME  16777619u
+
+static uint32_t fnv_add(uint32_t h, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+void probe_tracker_init(probe_tracker_t *tracker) {
+    memset(tracker, 0, sizeof(*tracker));
+}
+
+uint32_t probe_fingerprint(const uint8_t *ies, size_t len) {
+    uint32_t h = FNV_OFFSET;
+    size_t index = 0;
+
+    while (index + 2 <= len) {
+        uint8_t id = ies[index];
+        uint8_t ie_len = ies[index + 1];
+        const uint8_t *ie = &ies[index + 2];
+
+        if (index + 2 + ie_len > len) {
+            break;
+        }
+
+        if (id == IE_SSID || id == IE_DS_PARAMS) {
+            // Differ per frame, only the element order is kept
+            h = fnv_add(h, &id, 1);
+        } else if (id == IE_VENDOR) {
+            // OUI and type identify the vendor extension, the payload may carry
+            // per-frame data (WPS UUIDs, sequence counters)
+            h = fnv_add(h, &id, 1);
+            h = fnv_add(h, ie, ie_len < 4 ? ie_len : 4);
+        } else {
+            h = fnv_add(h, &ies[index], 2 + (size_t)ie_len);
+        }
+
+        index += 2 + ie_len;
+    }
+
+    return h;
+}
+
+static probe_device_t *find_device(probe_tracker_t *tracker, const uint8_t *mac, uint32_t now_ms, bool *is_new) {
+    uint32_t start = fnv_add(FNV_OFFSET, mac, 6) & (PROBE_TRACKER_MAX_DEVICES - 1);
+    probe_device_t *free_slot = NULL;
+    probe_device_t *oldest = NULL;
+
+    *is_new = false;
+
+    for (int i = 0; i < PROBE_TRACKER_MAX_PROBE; i++) {
+        probe_device_t *d = &tracker->devices[(start + i) & (PROBE_TRACKER_MAX_DEVICES - 1)];
+
+        if (!d->in_use) {
+            if (free_slot == NULL) {
+                free_slot = d;
+            }
+            continue;
+        }
+
+        if (memcmp(d->mac, mac, 6) == 0) {
+            return d;
+        }
+
+        if (oldest == NULL || (now_ms - d->last_seen_ms) > (now_ms - oldest->last_seen_ms)) {
+            oldest = d;
+        }
+    }
+
+    probe_device_t *slot = free_slot;
+    if (slot == NULL) {
+        // Probe window is full, recycle the least recently seen device
+        slot = oldest;
+        tracker->device_evictions++;
+    } else {
+        tracker->device_count++;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->in_use = true;
+    memcpy(slot->mac, mac, 6);
+    slot->randomized = (mac[0] & 0x02) != 0;
+    slot->first_seen_ms = now_ms;
+    *is_new = true;
+    return slot;
+}
+
+static int find_ssid(probe_tracker_t *tracker, const char *ssid, uint8_t len, uint32_t now_ms) {
+    uint32_t h = fnv_add(FNV_OFFSET, (const uint8_t *)ssid, len);
+    uint32_t start = h & (PROBE_TRACKER_MAX_SSIDS - 1);
+    int free_slot = -1;
+    int oldest = -1;
+
+    for (int i = 0; i < PROBE_TRACKER_MAX_PROBE; i++) {
+        int index = (int)((start + i) & (PROBE_TRACKER_MAX_SSIDS - 1));
+        probe_ssid_t *s = &tracker->ssids[index];
+
+        if (!s->in_use) {
+            if (free_slot < 0) {
+                free_slot = index;
+            }
+            continue;
+        }
+
+        if (s->hash == h && s->len == len && memcmp(s->ssid, ssid, len) == 0) {
+            s->last_seen_ms = now_ms;
+            return index;
+        }
+
+        if (oldest < 0 || (now_ms - s->last_seen_ms) > (now_ms - tracker->ssids[oldest].last_seen_ms)) {
+            oldest = index;
+        }
+    }
+
+    int index = free_slot;
+    if (index < 0) {
+        // Device references to the old SSID go stale through the generation
+        index = oldest;
+        tracker->ssid_evictions++;
+    }
+
+    probe_ssid_t *s = &tracker->ssids[index];
+    s->in_use = true;
+    s->generation++;
+    s->hash = h;
+    s->len = len;
+    s->last_seen_ms = now_ms;
+    memcpy(s->ssid, ssid, len);
+    s->ssid[len] = '\0';
+    return index;
+}
+
+static probe_cluster_t *find_cluster(probe_tracker_t *tracker, uint32_t fingerprint, uint32_t now_ms, bool create) {
+    uint32_t start = fingerprint & (PROBE_TRACKER_MAX_CLUSTERS - 1);
+    probe_cluster_t *free_slot = NULL;
+    probe_cluster_t *oldest = NULL;
+
+    for (int i = 0; i < PROBE_TRACKER_MAX_PROBE; i++) {
+        probe_cluster_t *c = &tracker->clusters[(start + i) & (PROBE_TRACKER_MAX_CLUSTERS - 1)];
+
+        if (!c->in_use) {
+            if (free_slot == NULL) {
+                free_slot = c;
+            }
+            continue;
+        }
+
+        if (c->fingerprint == fingerprint) {
+            return c;
+        }
+
+        if (oldest == NULL || (now_ms - c->last_seen_ms) > (now_ms - oldest->last_seen_ms)) {
+            oldest = c;
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    probe_cluster_t *slot = free_slot != NULL ? free_slot : oldest;
+    memset(slot, 0, sizeof(*slot));
+    slot->in_use = true;
+    slot->fingerprint = fingerprint;
+    slot->first_seen_ms = now_ms;
+    return slot;
+}
+
+static bool ref_is_live(const probe_tracker_t *tracker, const probe_ssid_ref_t *ref) {
+    const probe_ssid_t *s = &tracker->ssids[ref->ssid];
+    return s->in_use && s->generation == ref->generation;
+}
+
+static bool record_ssid(probe_tracker_t *tracker, probe_device_t *d, int index, int8_t rssi, uint32_t now_ms) {
+    uint16_t generation = tracker->ssids[index].generation;
+    probe_ssid_ref_t *stale = NULL;
+    probe_ssid_ref_t *oldest = NULL;
+
+    for (int i = 0; i < d->ssid_count; i++) {
+        probe_ssid_ref_t *ref = &d->ssids[i];
+
+        if (ref->ssid == index && ref->generation == generation) {
+            ref->count++;
+            ref->rssi = rssi;
+            ref->last_seen_ms = now_ms;
+            return false;
+        }
+
+        if (!ref_is_live(tracker, ref)) {
+            stale = ref;
+        } else if (oldest == NULL || (now_ms - ref->last_seen_ms) > (now_ms - oldest->last_seen_ms)) {
+            oldest = ref;
+        }
+    }
+
+    // Reuse a free slot, then one whose SSID was evicted, then the least recently probed
+    probe_ssid_ref_t *slot = stale != NULL ? stale : oldest;
+    if (d->ssid_count < PROBE_TRACKER_SSIDS_PER_DEV) {
+        slot = &d->ssids[d->ssid_count++];
+    }
+
+    slot->ssid = (uint8_t)index;
+    slot->generation = generation;
+    slot->count = 1;
+    slot->rssi = rssi;
+    slot->first_seen_ms = now_ms;
+    slot->last_seen_ms = now_ms;
+    return true;
+}
+
+void probe_tracker_update(probe_tracker_t *tracker, const uint8_t *frame, size_t len,
+                          int8_t rssi, uint32_t now_ms, probe_update_t *result) {
+    memset(result, 0, sizeof(*result));
+
+    if (len < MGMT_HDR_LEN || (frame[0] & 0xFC) != SUBTYPE_PROBE_REQ) {
+        return;
+    }
+
+    const uint8_t *source = &frame[10];
+    if (source[0] & 0x01) {
+        return;
+    }
+
+    tracker->frames_seen++;
+
+    const uint8_t *ies = &frame[MGMT_HDR_LEN];
+    size_t ies_len = len - MGMT_HDR_LEN;
+
+    probe_device_t *d = find_device(tracker, source, now_ms, &result->new_device);
+    if (result->new_device) {
+        d->fingerprint = probe_fingerprint(ies, ies_len);
+        d->rssi_max = rssi;
+
+        if (d->randomized) {
+            probe_cluster_t *c = find_cluster(tracker, d->fingerprint, now_ms, true);
+            c->mac_count++;
+        }
+    }
+
+    d->probes++;
+    d->rssi = rssi;
+    if (rssi > d->rssi_max) {
+        d->rssi_max = rssi;
+    }
+    d->last_seen_ms = now_ms;
+
+    if (d->randomized) {
+        probe_cluster_t *c = find_cluster(tracker, d->fingerprint, now_ms, false);
+        if (c != NULL) {
+            c->last_seen_ms = now_ms;
+        }
+    }
+
+    result->device = d;
+
+    // The SSID is the first element of a probe request, empty for wildcard probes
+    if (ies_len < 2 || ies[0] != IE_SSID || ies[1] == 0 || ies[1] > 32 || (size_t)ies[1] + 2 > ies_len) {
+        return;
+    }
+
+    int index = find_ssid(tracker, (const char *)&ies[2], ies[1], now_ms);
+    result->new_ssid = record_ssid(tracker, d, index, rssi, now_ms);
+    result->ssid = tracker->ssids[index].ssid;
+}
+
+const probe_device_t *probe_tracker_find(const probe_tracker_t *tracker, const uint8_t *mac) {
+    uint32_t start = fnv_add(FNV_OFFSET, mac, 6) & (PROBE_TRACKER_MAX_DEVICES - 1);
+
+    for (int i = 0; i < PROBE_TRACKER_MAX_PROBE; i++) {
+        const probe_device_t *d = &tracker->devices[(start + i) & (PROBE_TRACKER_MAX_DEVICES - 1)];
+        if (d->in_use && memcmp(d->mac, mac, 6) == 0) {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+const char *probe_tracker_ssid(const probe_tracker_t *tracker, const probe_ssid_ref_t *ref) {
+    return ref_is_live(tracker, ref) ? tracker->ssids[ref->ssid].ssid : NULL;
+}
+
+const probe_cluster_t *probe_tracker_cluster(const probe_tracker_t *tracker, uint32_t fingerprint) {
+    return find_cluster((probe_tracker_t *)tracker, fingerprint, 0, false);
+}
+
+static size_t append(char *out, size_t out_size, size_t used, const char *fmt, ...) {
+    if (used >= out_size) {
+        return used;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(&out[used], out_size - used, fmt, args);
+    va_end(args);
+
+    return n < 0 ? out_size : used + (size_t)n;
+}
+
+size_t probe_tracker_format_json(const probe_tracker_t *tracker, const probe_device_t *d,
+                                 char *out, size_t out_size) {
+    const probe_cluster_t *c = d->randomized ? probe_tracker_cluster(tracker, d->fingerprint) : NULL;
+
+    size_t used = append(out, out_size, 0,
+        "{\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"randomized\":%s,\"fingerprint\":\"%08lx\","
+        "\"cluster_size\":%u,\"probes\":%lu,\"rssi\":%d,\"rssi_max\":%d,"
+        "\"first_seen_ms\":%lu,\"last_seen_ms\":%lu,\"ssids\":[",
+        d->mac[0], d->mac[1], d->mac[2], d->mac[3], d->mac[4], d->mac[5],
+        d->randomized ? "true" : "false", (unsigned long)d->fingerprint,
+        c != NULL ? c->mac_count : 1, (unsigned long)d->probes, d->rssi, d->rssi_max,
+        (unsigned long)d->first_seen_ms, (unsigned long)d->last_seen_ms);
+
+    bool first = true;
+    for (int i = 0; i < d->ssid_count; i++) {
+        const probe_ssid_ref_t *ref = &d->ssids[i];
+        const char *ssid = probe_tracker_ssid(tracker, ref);
+        if (ssid == NULL) {
+            continue;
+        }
+
+        used = append(out, out_size, used, "%s{\"ssid\":", first ? "" : ",");
+        used = json_append_string(out, out_size, used, ssid);
+        used = append(out, out_size, used, ",\"count\":%u,\"rssi\":%d,\"first_seen_ms\":%lu,\"last_seen_ms\":%lu}",
+                      ref->count, ref->rssi, (unsigned long)ref->first_seen_ms, (unsigned long)ref->last_seen_ms);
+        first = false;
+    }
+
+    used = append(out, out_size, used, "]}");
+    return used < out_size ? used : 0;
+}
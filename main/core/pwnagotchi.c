@@ -0,0 +1,382 @@
+#include "core/pwnagotchi.h"
+#include <string.h>
+
+#define BEACON_FIXED_LEN 36      // MAC header (24) + timestamp, interval, capabilities (12)
+#define JSON_MAX_DEPTH   16
+#define JSON_KEY_LEN     32
+
+static const uint8_t pwnagotchi_mac[6] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xDE, 0xAD };
+
+typedef struct {
+    const char *p;
+    const char *end;
+} json_cursor_t;
+
+bool pwnagotchi_is_beacon(const uint8_t *frame, size_t len) {
+    if (len < BEACON_FIXED_LEN) {
+        return false;
+    }
+
+    if ((frame[0] & 0xFC) != 0x80) {
+        return false;
+    }
+
+    return memcmp(&frame[10], pwnagotchi_mac, sizeof(pwnagotchi_mac)) == 0;
+}
+
+int pwnagotchi_reassemble(const uint8_t *frame, size_t len, char *out, size_t out_size) {
+    if (len < BEACON_FIXED_LEN || out_size == 0) {
+        return -1;
+    }
+
+    size_t used = 0;
+    bool found = false;
+    size_t index = BEACON_FIXED_LEN;
+
+    while (index + 2 <= len) {
+        uint8_t id = frame[index];
+        uint8_t ie_len = frame[index + 1];
+
+        // A truncated element (or the FCS) ends the list
+        if (index + 2 + ie_len > len) {
+            break;
+        }
+
+        if (id == PWNAGOTCHI_IE_ID) {
+            if (used + ie_len >= out_size) {
+                return -1;
+            }
+            memcpy(&out[used], &frame[index + 2], ie_len);
+            used += ie_len;
+            found = true;
+        }
+
+        index += 2 + ie_len;
+    }
+
+    if (!found) {
+        return -1;
+    }
+
+    out[used] = '\0';
+    return (int)used;
+}
+
+static void skip_ws(json_cursor_t *c) {
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\r' || *c->p == '\n')) {
+        c->p++;
+    }
+}
+
+static int hex_value(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+// Decode a string into out (truncating to out_size). out may be NULL to skip.
+// Escapes outside ASCII are replaced by '?'.
+static bool parse_string(json_cursor_t *c, char *out, size_t out_size) {
+    if (c->p >= c->end || *c->p != '"') {
+        return false;
+    }
+    c->p++;
+
+    size_t used = 0;
+    while (c->p < c->end) {
+        char ch = *c->p++;
+
+        if (ch == '"') {
+            if (out != NULL) {
+                out[used] = '\0';
+            }
+            return true;
+        }
+
+        if ((unsigned char)ch < 0x20) {
+            return false;
+        }
+
+        if (ch == '\\') {
+            if (c->p >= c->end) {
+                return false;
+            }
+            char esc = *c->p++;
+            switch (esc) {
+                case '"': case '\\': case '/': ch = esc; break;
+                case 'b': ch = '\b'; break;
+                case 'f': ch = '\f'; break;
+                case 'n': ch = '\n'; break;
+                case 'r': ch = '\r'; break;
+                case 't': ch = '\t'; break;
+                case 'u': {
+                    if (c->end - c->p < 4) {
+                        return false;
+                    }
+                    int code = 0;
+                    for (int i = 0; i < 4; i++) {
+                        int v = hex_value(c->p[i]);
+                        if (v < 0) {
+                            return false;
+                        }
+                        code = (code << 4) | v;
+                    }
+                    c->p += 4;
+                    ch = (code >= 0x20 && code < 0x7F) ? (char)code : '?';
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        if (out != NULL && used + 1 < out_size) {
+            out[used++] = ch;
+        }
+    }
+
+    return false;
+}
+
+static bool parse_number(json_cursor_t *c, uint32_t *value) {
+    const char *start = c->p;
+    uint64_t v = 0;
+    bool negative = false;
+
+    if (c->p < c->end && *c->p == '-') {
+        negative = true;
+        c->p++;
+    }
+
+    const char *digits = c->p;
+    while (c->p < c->end && *c->p >= '0' && *c->p <= '9') {
+        if (v < UINT32_MAX) {
+            v = v * 10 + (uint64_t)(*c->p - '0');
+        }
+        c->p++;
+    }
+    if (c->p == digits) {
+        c->p = start;
+        return false;
+    }
+
+    // Fraction and exponent are accepted but dropped
+    if (c->p < c->end && *c->p == '.') {
+        c->p++;
+        while (c->p < c->end && *c->p >= '0' && *c->p <= '9') c->p++;
+    }
+    if (c->p < c->end && (*c->p == 'e' || *c->p == 'E')) {
+        c->p++;
+        if (c->p < c->end && (*c->p == '+' || *c->p == '-')) c->p++;
+        while (c->p < c->end && *c->p >= '0' && *c->p <= '9') c->p++;
+    }
+
+    if (value != NULL) {
+        *value = negative ? 0 : (v > UINT32_MAX ? UINT32_MAX : (uint32_t)v);
+    }
+    return true;
+}
+
+static bool skip_literal(json_cursor_t *c, const char *literal) {
+    size_t n = strlen(literal);
+    if ((size_t)(c->end - c->p) < n || memcmp(c->p, literal, n) != 0) {
+        return false;
+    }
+    c->p += n;
+    return true;
+}
+
+static bool skip_value(json_cursor_t *c, int depth) {
+    if (depth > JSON_MAX_DEPTH) {
+        return false;
+    }
+
+    skip_ws(c);
+    if (c->p >= c->end) {
+        return false;
+    }
+
+    char ch = *c->p;
+    if (ch == '"') {
+        return parse_string(c, NULL, 0);
+    }
+    if (ch == 't') return skip_literal(c, "true");
+    if (ch == 'f') return skip_literal(c, "false");
+    if (ch == 'n') return skip_literal(c, "null");
+    if (ch != '{' && ch != '[') {
+        return parse_number(c, NULL);
+    }
+
+    char close = (ch == '{') ? '}' : ']';
+    c->p++;
+    skip_ws(c);
+    if (c->p < c->end && *c->p == close) {
+        c->p++;
+        return true;
+    }
+
+    while (c->p < c->end) {
+        if (close == '}') {
+            skip_ws(c);
+            if (!parse_string(c, NULL, 0)) {
+                return false;
+            }
+            skip_ws(c);
+            if (c->p >= c->end || *c->p != ':') {
+                return false;
+            }
+            c->p++;
+        }
+
+        if (!skip_value(c, depth + 1)) {
+            return false;
+        }
+
+        skip_ws(c);
+        if (c->p >= c->end) {
+            return false;
+        }
+        if (*c->p == ',') {
+            c->p++;
+            continue;
+        }
+        if (*c->p == close) {
+            c->p++;
+            return true;
+        }
+        return false;
+    }
+
+    return false;
+}
+
+bool pwnagotchi_parse_json(const char *json, size_t len, pwnagotchi_info_t *info) {
+    json_cursor_t c = { json, json + len };
+    memset(info, 0, sizeof(*info));
+
+    skip_ws(&c);
+    if (c.p >= c.end || *c.p != '{') {
+        return false;
+    }
+    c.p++;
+
+    skip_ws(&c);
+    if (c.p < c.end && *c.p == '}') {
+        return false;
+    }
+
+    while (c.p < c.end) {
+        char key[JSON_KEY_LEN];
+
+        skip_ws(&c);
+        if (!parse_string(&c, key, sizeof(key))) {
+            return false;
+        }
+        skip_ws(&c);
+        if (c.p >= c.end || *c.p != ':') {
+            return false;
+        }
+        c.p++;
+        skip_ws(&c);
+
+        bool is_string = (c.p < c.end && *c.p == '"');
+        bool ok;
+
+        if (is_string && strcmp(key, "name") == 0) {
+            ok = parse_string(&c, info->name, sizeof(info->name));
+        } else if (is_string && strcmp(key, "version") == 0) {
+            ok = parse_string(&c, info->version, sizeof(info->version));
+        } else if (is_string && strcmp(key, "identity") == 0) {
+            ok = parse_string(&c, info->identity, sizeof(info->identity));
+        } else if (!is_string && strcmp(key, "pwnd_run") == 0) {
+            ok = parse_number(&c, &info->pwnd_run);
+        } else if (!is_string && strcmp(key, "pwnd_tot") == 0) {
+            ok = parse_number(&c, &info->pwnd_tot);
+        } else {
+            ok = skip_value(&c, 1);
+        }
+
+        if (!ok) {
+            return false;
+        }
+
+        skip_ws(&c);
+        if (c.p >= c.end) {
+            return false;
+        }
+        if (*c.p == ',') {
+            c.p++;
+            continue;
+        }
+        if (*c.p == '}') {
+            // Something has to identify the device
+            return info->name[0] != '\0' || info->identity[0] != '\0';
+        }
+        return false;
+    }
+
+    return false;
+}
+
+void pwnagotchi_table_init(pwnagotchi_table_t *table) {
+    memset(table, 0, sizeof(*table));
+}
+
+static bool same_device(const pwnagotchi_info_t *a, const pwnagotchi_info_t *b) {
+    if (a->identity[0] != '\0' || b->identity[0] != '\0') {
+        return strcmp(a->identity, b->identity) == 0;
+    }
+    return strcmp(a->name, b->name) == 0;
+}
+
+pwnagotchi_peer_t *pwnagotchi_table_update(pwnagotchi_table_t *table, const pwnagotchi_info_t *info,
+                                           int8_t rssi, uint8_t channel, uint32_t now_ms, bool *is_new) {
+    pwnagotchi_peer_t *free_slot = NULL;
+    pwnagotchi_peer_t *oldest = NULL;
+
+    *is_new = false;
+
+    for (int i = 0; i < PWNAGOTCHI_MAX_PEERS; i++) {
+        pwnagotchi_peer_t *peer = &table->peers[i];
+
+        if (!peer->in_use) {
+            if (free_slot == NULL) {
+                free_slot = peer;
+            }
+            continue;
+        }
+
+        if (same_device(&peer->info, info)) {
+            // Name and counters change over a session, keep the latest
+            peer->info = *info;
+            peer->rssi = rssi;
+            peer->channel = channel;
+            peer->beacons++;
+            peer->last_seen_ms = now_ms;
+            return peer;
+        }
+
+        if (oldest == NULL || (int32_t)(peer->last_seen_ms - oldest->last_seen_ms) < 0) {
+            oldest = peer;
+        }
+    }
+
+    pwnagotchi_peer_t *peer = free_slot;
+    if (peer == NULL) {
+        peer = oldest;
+    } else {
+        table->peer_count++;
+    }
+
+    memset(peer, 0, sizeof(*peer));
+    peer->in_use = true;
+    peer->info = *info;
+    peer->rssi = rssi;
+    peer->channel = channel;
+    peer->beacons = 1;
+    peer->first_seen_ms = now_ms;
+    peer->last_seen_ms = now_ms;
+    *is_new = true;
+    return peer;
+}
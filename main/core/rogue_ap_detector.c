@@ -0,0 +1,394 @@
+#include "core/rogue_ap_detector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#define BEACON_FIXED_LEN 36      // MAC header (24) + timestamp, interval, capabilities (12)
+#define CAPABILITY_PRIVACY 0x0010
+
+#define IE_SSID 0
+#define IE_DS_PARAMS 3
+#define IE_RSN 48
+#define IE_VENDOR 221
+
+static const char *security_names[] = { "OPEN", "WEP", "WPA", "WPA2", "WPA3", "WPA2/WPA3", "ANY" };
+
+// Weakest protocol a client can be made to use, transition mode allows WPA2
+static const uint8_t security_strength[] = { 0, 1, 2, 3, 4, 3, 0 };
+
+static uint32_t ssid_hash(const char *ssid, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)ssid[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t bssid_hash(const uint8_t *bssid) {
+    // Low bytes vary the most between devices
+    return (uint32_t)bssid[5] | ((uint32_t)bssid[4] << 8) | ((uint32_t)bssid[3] << 16);
+}
+
+static rogue_ap_ssid_slot_t *find_ssid(rogue_ap_detector_t *det, const char *ssid, size_t len, bool create) {
+    uint32_t h = ssid_hash(ssid, len);
+
+    for (uint32_t i = 0; i < ROGUE_AP_SSID_SLOTS; i++) {
+        rogue_ap_ssid_slot_t *slot = &det->ssids[(h + i) & (ROGUE_AP_SSID_SLOTS - 1)];
+
+        if (!slot->in_use) {
+            if (!create) {
+                return NULL;
+            }
+            slot->in_use = true;
+            slot->hash = h;
+            slot->ssid_len = (uint8_t)len;
+            memcpy(slot->ssid, ssid, len);
+            slot->ssid[len] = '\0';
+            return slot;
+        }
+
+        if (slot->hash == h && slot->ssid_len == len && memcmp(slot->ssid, ssid, len) == 0) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+void rogue_ap_init(rogue_ap_detector_t *det) {
+    memset(det, 0, sizeof(*det));
+}
+
+bool rogue_ap_add_entry(rogue_ap_detector_t *det, const rogue_ap_entry_t *entry) {
+    size_t len = strnlen(entry->ssid, 32);
+    rogue_ap_ssid_slot_t *slot = find_ssid(det, entry->ssid, len, true);
+    if (slot == NULL) {
+        return false;
+    }
+
+    for (int i = 0; i < slot->bssid_count; i++) {
+        if (memcmp(slot->bssids[i].bssid, entry->bssid, 6) == 0) {
+            slot->bssids[i].security = entry->security;
+            slot->bssids[i].channel = entry->channel;
+            return true;
+        }
+    }
+
+    if (slot->bssid_count >= ROGUE_AP_BSSIDS_PER_SSID) {
+        return false;
+    }
+
+    rogue_ap_known_bssid_t *known = &slot->bssids[slot->bssid_count++];
+    memcpy(known->bssid, entry->bssid, 6);
+    known->security = entry->security;
+    known->channel = entry->channel;
+    known->seen_channel = 0;
+    det->entry_count++;
+    return true;
+}
+
+const char *rogue_ap_security_name(rogue_ap_security_t security) {
+    if (security > ROGUE_AP_SEC_ANY) {
+        return "?";
+    }
+    return security_names[security];
+}
+
+bool rogue_ap_parse_security(const char *name, rogue_ap_security_t *security) {
+    for (int i = 0; i <= ROGUE_AP_SEC_ANY; i++) {
+        if (strcasecmp(name, security_names[i]) == 0) {
+            *security = (rogue_ap_security_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_mac(const char *str, uint8_t *mac) {
+    unsigned int b[6];
+    char tail;
+    if (sscanf(str, "%x:%x:%x:%x:%x:%x%c", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &tail) != 6) {
+        return false;
+    }
+    for (int i = 0; i < 6; i++) {
+        if (b[i] > 0xFF) {
+            return false;
+        }
+        mac[i] = (uint8_t)b[i];
+    }
+    return true;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return s;
+}
+
+bool rogue_ap_parse_allowlist_line(const char *line, rogue_ap_entry_t *entry) {
+    char buf[160];
+    char *fields[8];
+    int count = 0;
+
+    strncpy(buf, line, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    buf[strcspn(buf, "\r\n")] = '\0';
+
+    char *start = trim(buf);
+    if (*start == '\0' || *start == '#') {
+        return false;
+    }
+
+    // Split on every comma, the SSID is re-joined below if it contained any
+    fields[count++] = start;
+    for (char *p = start; *p != '\0' && count < 8; p++) {
+        if (*p == ',') {
+            *p = '\0';
+            fields[count++] = p + 1;
+        }
+    }
+
+    if (count < 3) {
+        return false;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+
+    int mac_index;
+    if (parse_mac(trim(fields[count - 2]), entry->bssid)) {
+        mac_index = count - 2;
+    } else if (count >= 4 && parse_mac(trim(fields[count - 3]), entry->bssid)) {
+        mac_index = count - 3;
+        char *end;
+        long channel = strtol(trim(fields[count - 1]), &end, 10);
+        if (*end != '\0' || channel < 0 || channel > 196) {
+            return false;
+        }
+        entry->channel = (uint8_t)channel;
+    } else {
+        return false;
+    }
+
+    if (!rogue_ap_parse_security(trim(fields[mac_index + 1]), &entry->security)) {
+        return false;
+    }
+
+    // Restore commas inside the SSID
+    for (int i = 1; i < mac_index; i++) {
+        fields[i][-1] = ',';
+    }
+
+    size_t ssid_len = strlen(fields[0]);
+    if (ssid_len == 0 || ssid_len > 32) {
+        return false;
+    }
+    memcpy(entry->ssid, fields[0], ssid_len);
+    entry->ssid[ssid_len] = '\0';
+    return true;
+}
+
+static rogue_ap_security_t parse_rsn_security(const uint8_t *ie, uint8_t len) {
+    // version(2) group cipher(4) pairwise count(2) + list, AKM count(2) + list
+    size_t pos = 6;
+    if (len < pos + 2) {
+        return ROGUE_AP_SEC_WPA2;
+    }
+
+    uint16_t pairwise_count = ie[pos] | (ie[pos + 1] << 8);
+    pos += 2 + (size_t)pairwise_count * 4;
+    if (len < pos + 2) {
+        return ROGUE_AP_SEC_WPA2;
+    }
+
+    uint16_t akm_count = ie[pos] | (ie[pos + 1] << 8);
+    pos += 2;
+
+    bool sae = false;
+    bool other = false;
+    for (uint16_t i = 0; i < akm_count && pos + 4 <= len; i++, pos += 4) {
+        // 00-0F-AC:8 SAE, 00-0F-AC:24 SAE-EXT-KEY
+        if (ie[pos] == 0x00 && ie[pos + 1] == 0x0F && ie[pos + 2] == 0xAC &&
+            (ie[pos + 3] == 8 || ie[pos + 3] == 24)) {
+            sae = true;
+        } else {
+            other = true;
+        }
+    }
+
+    if (!sae) {
+        return ROGUE_AP_SEC_WPA2;
+    }
+    return other ? ROGUE_AP_SEC_WPA2_WPA3 : ROGUE_AP_SEC_WPA3;
+}
+
+bool rogue_ap_parse_beacon(const uint8_t *frame, size_t len, rogue_ap_beacon_t *out) {
+    if (len < BEACON_FIXED_LEN) {
+        return false;
+    }
+
+    uint8_t fc = frame[0] & 0xFC;
+    if (fc != 0x80 && fc != 0x50) {
+        return false;
+    }
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out->bssid, &frame[16], 6);
+
+    uint16_t capabilities = frame[34] | (frame[35] << 8);
+    bool has_rsn = false;
+    bool has_wpa = false;
+    bool has_ssid = false;
+
+    size_t index = BEACON_FIXED_LEN;
+    while (index + 2 <= len) {
+        uint8_t id = frame[index];
+        uint8_t ie_len = frame[index + 1];
+        const uint8_t *ie = &frame[index + 2];
+
+        if (index + 2 + ie_len > len) {
+            break;
+        }
+
+        if (id == IE_SSID && ie_len <= 32 && !has_ssid) {
+            memcpy(out->ssid, ie, ie_len);
+            out->ssid[ie_len] = '\0';
+            out->ssid_len = ie_len;
+            has_ssid = true;
+        } else if (id == IE_DS_PARAMS && ie_len >= 1) {
+            out->channel = ie[0];
+        } else if (id == IE_RSN && !has_rsn) {
+            out->security = parse_rsn_security(ie, ie_len);
+            has_rsn = true;
+        } else if (id == IE_VENDOR && ie_len >= 4 &&
+                   ie[0] == 0x00 && ie[1] == 0x50 && ie[2] == 0xF2 && ie[3] == 0x01) {
+            has_wpa = true;
+        }
+
+        index += 2 + ie_len;
+    }
+
+    if (!has_ssid) {
+        return false;
+    }
+
+    if (!has_rsn) {
+        if (has_wpa) {
+            out->security = ROGUE_AP_SEC_WPA;
+        } else if (capabilities & CAPABILITY_PRIVACY) {
+            out->security = ROGUE_AP_SEC_WEP;
+        } else {
+            out->security = ROGUE_AP_SEC_OPEN;
+        }
+    }
+
+    return true;
+}
+
+// Returns true if these reasons for this BSSID should be reported now.
+static bool should_report(rogue_ap_detector_t *det, const uint8_t *bssid, uint32_t reasons, uint32_t now_ms) {
+    uint32_t start = bssid_hash(bssid);
+    rogue_ap_report_t *free_slot = NULL;
+    rogue_ap_report_t *oldest = NULL;
+
+    for (uint32_t i = 0; i < ROGUE_AP_REPORT_PROBE; i++) {
+        rogue_ap_report_t *r = &det->reports[(start + i) & (ROGUE_AP_REPORT_SLOTS - 1)];
+
+        if (r->in_use && memcmp(r->bssid, bssid, 6) == 0) {
+            bool new_reason = (reasons & ~r->reasons) != 0;
+            if (!new_reason && (now_ms - r->last_report_ms) < ROGUE_AP_HOLDOFF_MS) {
+                return false;
+            }
+            r->reasons |= reasons;
+            r->last_report_ms = now_ms;
+            return true;
+        }
+
+        if (!r->in_use) {
+            if (free_slot == NULL) {
+                free_slot = r;
+            }
+        } else if (oldest == NULL || (now_ms - r->last_report_ms) > (now_ms - oldest->last_report_ms)) {
+            oldest = r;
+        }
+    }
+
+    if (free_slot != NULL) {
+        oldest = free_slot;
+    }
+
+    memcpy(oldest->bssid, bssid, 6);
+    oldest->reasons = reasons;
+    oldest->last_report_ms = now_ms;
+    oldest->in_use = true;
+    return true;
+}
+
+bool rogue_ap_check(rogue_ap_detector_t *det, const rogue_ap_beacon_t *beacon, uint32_t now_ms,
+                    rogue_ap_alert_t *alert) {
+    det->beacons_checked++;
+
+    if (beacon->ssid_len == 0) {
+        return false;
+    }
+
+    rogue_ap_ssid_slot_t *slot = find_ssid(det, beacon->ssid, beacon->ssid_len, false);
+    if (slot == NULL) {
+        // Not one of ours
+        return false;
+    }
+
+    uint32_t reasons = 0;
+    rogue_ap_known_bssid_t *known = NULL;
+    bool oui_match = false;
+
+    for (int i = 0; i < slot->bssid_count; i++) {
+        if (memcmp(slot->bssids[i].bssid, beacon->bssid, 6) == 0) {
+            known = &slot->bssids[i];
+            break;
+        }
+        if (memcmp(slot->bssids[i].bssid, beacon->bssid, 3) == 0) {
+            oui_match = true;
+        }
+    }
+
+    if (known == NULL) {
+        reasons |= ROGUE_AP_REASON_UNKNOWN_BSSID;
+        if (!oui_match) {
+            reasons |= ROGUE_AP_REASON_OUI;
+        }
+    } else {
+        if (known->security != ROGUE_AP_SEC_ANY &&
+            security_strength[beacon->security] < security_strength[known->security]) {
+            reasons |= ROGUE_AP_REASON_SECURITY;
+        }
+
+        if (beacon->channel != 0) {
+            if (known->channel != 0 && known->channel != beacon->channel) {
+                reasons |= ROGUE_AP_REASON_CHANNEL;
+            } else if (known->channel == 0 && known->seen_channel != 0 && known->seen_channel != beacon->channel) {
+                reasons |= ROGUE_AP_REASON_CHANNEL;
+            }
+            known->seen_channel = beacon->channel;
+        }
+    }
+
+    if (reasons == 0 || !should_report(det, beacon->bssid, reasons, now_ms)) {
+        return false;
+    }
+
+    const rogue_ap_known_bssid_t *expected = known != NULL ? known : &slot->bssids[0];
+    alert->reasons = reasons;
+    alert->beacon = *beacon;
+    alert->expected_security = (rogue_ap_security_t)expected->security;
+    alert->expected_channel = expected->channel;
+    det->alerts_raised++;
+    return true;
+}
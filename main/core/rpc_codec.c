@@ -0,0 +1,314 @@
+#include "core/rpc_codec.h"
+#include <string.h>
+
+static uint16_t crc16_update(uint16_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint16_t rpc_crc16(const uint8_t *data, size_t len) {
+    return crc16_update(0xFFFF, data, len);
+}
+
+// Writer
+
+void rpc_writer_init(rpc_writer_t *w, uint8_t *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = false;
+}
+
+static void put_byte(rpc_writer_t *w, uint8_t b) {
+    if (w->len < w->cap) {
+        w->buf[w->len++] = b;
+    } else {
+        w->overflow = true;
+    }
+}
+
+static void put_varint(rpc_writer_t *w, uint32_t value) {
+    while (value >= 0x80) {
+        put_byte(w, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    put_byte(w, (uint8_t)value);
+}
+
+void rpc_put_u32(rpc_writer_t *w, uint32_t value) {
+    put_byte(w, RPC_TAG_U32);
+    put_varint(w, value);
+}
+
+void rpc_put_i32(rpc_writer_t *w, int32_t value) {
+    put_byte(w, RPC_TAG_I32);
+    put_varint(w, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+void rpc_put_bool(rpc_writer_t *w, bool value) {
+    put_byte(w, RPC_TAG_BOOL);
+    put_byte(w, value ? 1 : 0);
+}
+
+static void put_blob(rpc_writer_t *w, uint8_t tag, const uint8_t *data, size_t len) {
+    put_byte(w, tag);
+    put_varint(w, (uint32_t)len);
+    if (len > w->cap - w->len) {
+        w->overflow = true;
+        w->len = w->cap;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+void rpc_put_str(rpc_writer_t *w, const char *str) {
+    put_blob(w, RPC_TAG_STR, (const uint8_t *)str, strlen(str));
+}
+
+void rpc_put_bytes(rpc_writer_t *w, const uint8_t *data, size_t len) {
+    put_blob(w, RPC_TAG_BYTES, data, len);
+}
+
+// Reader
+
+void rpc_reader_init(rpc_reader_t *r, const uint8_t *buf, size_t len) {
+    r->buf = buf;
+    r->len = len;
+    r->pos = 0;
+    r->error = false;
+}
+
+static bool get_tag(rpc_reader_t *r, uint8_t tag) {
+    if (r->error || r->pos >= r->len || r->buf[r->pos] != tag) {
+        r->error = true;
+        return false;
+    }
+    r->pos++;
+    return true;
+}
+
+static bool get_varint(rpc_reader_t *r, uint32_t *value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (r->pos >= r->len) {
+            break;
+        }
+        uint8_t b = r->buf[r->pos++];
+        // The fifth byte only has room for the top four bits
+        if (shift == 28 && b > 0x0F) {
+            break;
+        }
+        result |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    r->error = true;
+    return false;
+}
+
+bool rpc_get_u32(rpc_reader_t *r, uint32_t *value) {
+    return get_tag(r, RPC_TAG_U32) && get_varint(r, value);
+}
+
+bool rpc_get_i32(rpc_reader_t *r, int32_t *value) {
+    uint32_t raw;
+    if (!get_tag(r, RPC_TAG_I32) || !get_varint(r, &raw)) {
+        return false;
+    }
+    *value = (int32_t)((raw >> 1) ^ (0u - (raw & 1)));
+    return true;
+}
+
+bool rpc_get_bool(rpc_reader_t *r, bool *value) {
+    if (!get_tag(r, RPC_TAG_BOOL)) {
+        return false;
+    }
+    if (r->pos >= r->len || r->buf[r->pos] > 1) {
+        r->error = true;
+        return false;
+    }
+    *value = r->buf[r->pos++] == 1;
+    return true;
+}
+
+static bool get_blob(rpc_reader_t *r, uint8_t tag, const uint8_t **data, size_t *len) {
+    uint32_t n;
+    if (!get_tag(r, tag) || !get_varint(r, &n)) {
+        return false;
+    }
+    if (n > r->len - r->pos) {
+        r->error = true;
+        return false;
+    }
+    *data = r->buf + r->pos;
+    *len = n;
+    r->pos += n;
+    return true;
+}
+
+bool rpc_get_str(rpc_reader_t *r, const char **str, size_t *len) {
+    return get_blob(r, RPC_TAG_STR, (const uint8_t **)str, len);
+}
+
+bool rpc_get_bytes(rpc_reader_t *r, const uint8_t **data, size_t *len) {
+    return get_blob(r, RPC_TAG_BYTES, data, len);
+}
+
+bool rpc_reader_done(const rpc_reader_t *r) {
+    return !r->error && r->pos == r->len;
+}
+
+// Framing
+
+typedef struct {
+    uint8_t *out;
+    size_t cap;
+    size_t len;
+    size_t code_pos;             // Where the current block's length byte goes
+    uint8_t code;
+    bool overflow;
+} cobs_encoder_t;
+
+static void cobs_start(cobs_encoder_t *c) {
+    c->code_pos = c->len++;
+    c->code = 1;
+}
+
+static void cobs_end_block(cobs_encoder_t *c) {
+    if (c->code_pos < c->cap) {
+        c->out[c->code_pos] = c->code;
+    }
+}
+
+static void cobs_byte(cobs_encoder_t *c, uint8_t b) {
+    if (b == 0) {
+        cobs_end_block(c);
+        cobs_start(c);
+        return;
+    }
+    if (c->len < c->cap) {
+        c->out[c->len] = b;
+    } else {
+        c->overflow = true;
+    }
+    c->len++;
+    if (++c->code == 0xFF) {
+        cobs_end_block(c);
+        cobs_start(c);
+    }
+}
+
+static void cobs_bytes(cobs_encoder_t *c, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        cobs_byte(c, data[i]);
+    }
+}
+
+size_t rpc_frame_encode(const rpc_frame_t *frame, uint8_t *out, size_t cap) {
+    if (frame->payload_len > RPC_MAX_PAYLOAD || cap < 2) {
+        return 0;
+    }
+
+    uint8_t header[RPC_HEADER_LEN] = {
+        frame->kind, (uint8_t)frame->id, (uint8_t)(frame->id >> 8), frame->code,
+    };
+    uint16_t crc = crc16_update(rpc_crc16(header, sizeof(header)), frame->payload, frame->payload_len);
+    uint8_t trailer[RPC_CRC_LEN] = { (uint8_t)crc, (uint8_t)(crc >> 8) };
+
+    // Room for the closing delimiter is kept back from the encoder
+    cobs_encoder_t c = { .out = out, .cap = cap - 1, .len = 1 };
+    out[0] = 0;
+    cobs_start(&c);
+    cobs_bytes(&c, header, sizeof(header));
+    if (frame->payload_len > 0) {
+        cobs_bytes(&c, frame->payload, frame->payload_len);
+    }
+    cobs_bytes(&c, trailer, sizeof(trailer));
+    cobs_end_block(&c);
+
+    if (c.overflow || c.len > c.cap) {
+        return 0;
+    }
+    out[c.len] = 0;
+    return c.len + 1;
+}
+
+void rpc_decoder_init(rpc_decoder_t *d, rpc_frame_cb_t on_frame, void *ctx) {
+    memset(d, 0, sizeof(*d));
+    d->on_frame = on_frame;
+    d->ctx = ctx;
+}
+
+// Undo COBS in place, returns the decoded length or 0 when malformed
+static size_t cobs_decode(uint8_t *buf, size_t len) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < len) {
+        uint8_t code = buf[in++];
+        size_t run = (size_t)code - 1;
+        if (run > len - in) {
+            return 0;
+        }
+        memmove(buf + out, buf + in, run);
+        out += run;
+        in += run;
+        if (code < 0xFF && in < len) {
+            buf[out++] = 0;
+        }
+    }
+    return out;
+}
+
+static void end_of_frame(rpc_decoder_t *d) {
+    size_t len = cobs_decode(d->buf, d->len);
+    d->len = 0;
+    if (len < RPC_HEADER_LEN + RPC_CRC_LEN) {
+        d->bad_frames++;
+        return;
+    }
+
+    uint16_t crc = (uint16_t)(d->buf[len - 2] | (d->buf[len - 1] << 8));
+    if (rpc_crc16(d->buf, len - RPC_CRC_LEN) != crc) {
+        d->bad_frames++;
+        return;
+    }
+
+    rpc_frame_t frame = {
+        .kind = d->buf[0],
+        .id = (uint16_t)(d->buf[1] | (d->buf[2] << 8)),
+        .code = d->buf[3],
+        .payload = d->buf + RPC_HEADER_LEN,
+        .payload_len = len - RPC_HEADER_LEN - RPC_CRC_LEN,
+    };
+    d->frames++;
+    d->on_frame(&frame, d->ctx);
+}
+
+void rpc_decoder_feed(rpc_decoder_t *d, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = data[i];
+        if (b == 0) {
+            if (d->discarding) {
+                d->discarding = false;
+            } else if (d->len > 0) {
+                end_of_frame(d);
+            }
+        } else if (d->discarding) {
+            // Keep dropping until the next delimiter
+        } else if (d->len < sizeof(d->buf)) {
+            d->buf[d->len++] = b;
+        } else {
+            d->len = 0;
+            d->discarding = true;
+            d->overflows++;
+        }
+    }
+}
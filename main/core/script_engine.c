@@ -0,0 +1,323 @@
+#include "core/script_engine.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const var_names[] = { "free", "time", "uptime" };
+static const char *const cmp_names[] = { "<", "<=", ">", ">=", "==", "!=" };
+
+static char *trim(char *p) {
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    char *end = p + strlen(p);
+    while (end > p && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return p;
+}
+
+// Matches a keyword and returns its arguments, without touching the line
+// so commands reach the console exactly as written
+static bool keyword(const char *stmt, const char *kw, const char **args) {
+    size_t len = strlen(kw);
+    if (strncmp(stmt, kw, len) != 0 || (stmt[len] != '\0' && !isspace((unsigned char)stmt[len]))) {
+        return false;
+    }
+    *args = stmt + len;
+    while (isspace((unsigned char)**args)) {
+        (*args)++;
+    }
+    return true;
+}
+
+bool script_parse_duration(const char *text, uint64_t *ms) {
+    char *end;
+    if (!isdigit((unsigned char)*text)) {
+        return false;
+    }
+    unsigned long long n = strtoull(text, &end, 10);
+    uint64_t unit;
+    if (strcmp(end, "ms") == 0) {
+        unit = 1;
+    } else if (*end == '\0' || strcmp(end, "s") == 0) {
+        unit = 1000;
+    } else if (strcmp(end, "m") == 0) {
+        unit = 60000;
+    } else if (strcmp(end, "h") == 0) {
+        unit = 3600000;
+    } else {
+        return false;
+    }
+    // Delays are handed to sleep() as 32-bit milliseconds, about 49 days
+    if (n > UINT32_MAX / unit) {
+        return false;
+    }
+    *ms = n * unit;
+    return true;
+}
+
+static bool parse_size(const char *text, uint64_t *bytes) {
+    char *end;
+    if (!isdigit((unsigned char)*text)) {
+        return false;
+    }
+    unsigned long long n = strtoull(text, &end, 10);
+    unsigned shift = 0;
+    if (*end == 'K' || *end == 'k') {
+        shift = 10;
+    } else if (*end == 'M' || *end == 'm') {
+        shift = 20;
+    } else if (*end == 'G' || *end == 'g') {
+        shift = 30;
+    }
+    if (shift != 0) {
+        end++;
+    }
+    if (*end != '\0' || n > (UINT64_MAX >> shift)) {
+        return false;
+    }
+    *bytes = (uint64_t)n << shift;
+    return true;
+}
+
+static bool parse_time_of_day(const char *text, uint64_t *minutes) {
+    unsigned h, m;
+    char extra;
+    if (sscanf(text, "%2u:%2u%c", &h, &m, &extra) != 2 || h > 23 || m > 59) {
+        return false;
+    }
+    *minutes = h * 60 + m;
+    return true;
+}
+
+static bool parse_condition(const char *args, script_op_t *op) {
+    char var[8], cmp[3], value[24], extra;
+    if (sscanf(args, "%7s %2s %23s %c", var, cmp, value, &extra) != 3) {
+        return false;
+    }
+
+    size_t v, c;
+    for (v = 0; v < sizeof(var_names) / sizeof(var_names[0]) && strcmp(var, var_names[v]) != 0; v++) {
+    }
+    for (c = 0; c < sizeof(cmp_names) / sizeof(cmp_names[0]) && strcmp(cmp, cmp_names[c]) != 0; c++) {
+    }
+    if (v == sizeof(var_names) / sizeof(var_names[0]) || c == sizeof(cmp_names) / sizeof(cmp_names[0])) {
+        return false;
+    }
+    op->var = (uint8_t)v;
+    op->cmp = (uint8_t)c;
+
+    switch (op->var) {
+        case SCRIPT_VAR_FREE: return parse_size(value, &op->value);
+        case SCRIPT_VAR_TIME: return parse_time_of_day(value, &op->value);
+        default: return script_parse_duration(value, &op->value);
+    }
+}
+
+static bool fail(script_t *s, uint16_t line, const char *error) {
+    s->error_line = line;
+    s->error = error;
+    return false;
+}
+
+bool script_parse(script_t *s, char *text) {
+    uint16_t open[SCRIPT_MAX_DEPTH];
+    int depth = 0;
+    uint16_t line = 0;
+
+    memset(s, 0, sizeof(*s));
+
+    for (char *p = text; p != NULL; ) {
+        char *nl = strchr(p, '\n');
+        if (nl != NULL) {
+            *nl = '\0';
+        }
+        char *stmt = trim(p);
+        p = nl ? nl + 1 : NULL;
+        line++;
+
+        if (*stmt == '\0' || *stmt == '#') {
+            continue;
+        }
+        if (s->count == SCRIPT_MAX_OPS) {
+            return fail(s, line, "too many statements");
+        }
+
+        uint16_t index = s->count;
+        script_op_t *op = &s->ops[index];
+        const char *args;
+        op->line = line;
+
+        if (keyword(stmt, "delay", &args)) {
+            op->kind = SCRIPT_OP_DELAY;
+            if (!script_parse_duration(args, &op->value)) {
+                return fail(s, line, "expected a duration such as 500ms, 30s, 10m or 2h");
+            }
+        } else if (keyword(stmt, "waitjob", &args)) {
+            op->kind = SCRIPT_OP_WAITJOB;
+            if (*args != '\0' && !script_parse_duration(args, &op->value)) {
+                return fail(s, line, "expected a timeout such as 30s or 10m");
+            }
+        } else if (keyword(stmt, "exit", &args)) {
+            op->kind = SCRIPT_OP_EXIT;
+            if (*args != '\0') {
+                return fail(s, line, "exit takes no arguments");
+            }
+        } else if (keyword(stmt, "repeat", &args) || keyword(stmt, "while", &args) || keyword(stmt, "if", &args)) {
+            if (stmt[0] == 'r') {
+                op->kind = SCRIPT_OP_REPEAT;
+                char *end;
+                if (*args != '\0' && (!isdigit((unsigned char)*args) ||
+                                      (op->value = strtoull(args, &end, 10)) == 0 || *end != '\0')) {
+                    return fail(s, line, "repeat count must be a number from 1");
+                }
+            } else {
+                op->kind = stmt[0] == 'w' ? SCRIPT_OP_WHILE : SCRIPT_OP_IF;
+                if (!parse_condition(args, op)) {
+                    return fail(s, line, "expected a condition such as free < 100M, time >= 22:30 or uptime > 6h");
+                }
+            }
+            if (depth == SCRIPT_MAX_DEPTH) {
+                return fail(s, line, "blocks nested too deeply");
+            }
+            open[depth++] = index;
+        } else if (keyword(stmt, "else", &args)) {
+            op->kind = SCRIPT_OP_ELSE;
+            if (depth == 0 || s->ops[open[depth - 1]].kind != SCRIPT_OP_IF || *args != '\0') {
+                return fail(s, line, "else without if");
+            }
+            s->ops[open[depth - 1]].jump = index;
+            open[depth - 1] = index;
+        } else if (keyword(stmt, "end", &args)) {
+            op->kind = SCRIPT_OP_END;
+            if (depth == 0 || *args != '\0') {
+                return fail(s, line, "end without repeat, while or if");
+            }
+            uint16_t start = open[--depth];
+            s->ops[start].jump = index;
+            op->jump = start;
+        } else {
+            op->kind = SCRIPT_OP_CMD;
+            op->text = stmt;
+        }
+        s->count++;
+    }
+
+    if (depth > 0) {
+        return fail(s, s->ops[open[depth - 1]].line, "block has no end");
+    }
+    return true;
+}
+
+static bool evaluate(const script_op_t *op, const script_env_t *env, uint8_t *warned) {
+    uint64_t value = 0;
+    bool known;
+
+    if (op->var == SCRIPT_VAR_FREE) {
+        known = env->free_bytes(&value, env->ctx);
+    } else if (op->var == SCRIPT_VAR_TIME) {
+        uint32_t minutes;
+        known = env->time_of_day(&minutes, env->ctx);
+        value = minutes;
+    } else {
+        value = env->uptime_ms(env->ctx);
+        known = true;
+    }
+
+    if (!known) {
+        // Once per run, a loop on an unknown value would repeat it forever
+        if (!(*warned & (1u << op->var)) && env->note != NULL) {
+            env->note(op->line, op->var == SCRIPT_VAR_FREE ? "free space unknown, condition is false"
+                                                           : "clock not set, condition is false", env->ctx);
+        }
+        *warned |= 1u << op->var;
+        return false;
+    }
+
+    switch (op->cmp) {
+        case SCRIPT_LT: return value < op->value;
+        case SCRIPT_LE: return value <= op->value;
+        case SCRIPT_GT: return value > op->value;
+        case SCRIPT_GE: return value >= op->value;
+        case SCRIPT_EQ: return value == op->value;
+        default: return value != op->value;
+    }
+}
+
+script_result_t script_run(script_t *s, const script_env_t *env) {
+    uint8_t warned = 0;
+    uint16_t pc = 0;
+
+    s->commands = 0;
+    s->failed = 0;
+
+    while (pc < s->count) {
+        script_op_t *op = &s->ops[pc];
+
+        switch (op->kind) {
+            case SCRIPT_OP_CMD:
+                s->commands++;
+                if (env->run(op->text, env->ctx) != 0) {
+                    s->failed++;
+                }
+                pc++;
+                break;
+            case SCRIPT_OP_DELAY:
+                if (!env->sleep((uint32_t)op->value, env->ctx)) {
+                    return SCRIPT_STOPPED;
+                }
+                pc++;
+                break;
+            case SCRIPT_OP_REPEAT:
+                op->left = op->value;
+                pc++;
+                break;
+            case SCRIPT_OP_WHILE:
+            case SCRIPT_OP_IF:
+                // False skips to just past the else or end
+                pc = evaluate(op, env, &warned) ? pc + 1 : op->jump + 1;
+                break;
+            case SCRIPT_OP_ELSE:
+                pc = op->jump + 1;
+                break;
+            case SCRIPT_OP_END: {
+                script_op_t *start = &s->ops[op->jump];
+                bool again = (start->kind == SCRIPT_OP_REPEAT && (start->value == 0 || --start->left > 0)) ||
+                             start->kind == SCRIPT_OP_WHILE;
+                if (!again) {
+                    pc++;
+                    break;
+                }
+                // Every pass yields, so a loop without a delay cannot starve the system
+                if (!env->sleep(0, env->ctx)) {
+                    return SCRIPT_STOPPED;
+                }
+                pc = start->kind == SCRIPT_OP_WHILE ? op->jump : op->jump + 1;
+                break;
+            }
+            case SCRIPT_OP_WAITJOB: {
+                uint32_t id = env->latest_job(env->ctx);
+                uint64_t waited = 0;
+                while (id != 0 && env->job_active(id, env->ctx)) {
+                    if (op->value != 0 && waited >= op->value) {
+                        if (env->note != NULL) {
+                            env->note(op->line, "job still running, carrying on", env->ctx);
+                        }
+                        break;
+                    }
+                    if (!env->sleep(SCRIPT_POLL_MS, env->ctx)) {
+                        return SCRIPT_STOPPED;
+                    }
+                    waited += SCRIPT_POLL_MS;
+                }
+                pc++;
+                break;
+            }
+            default:
+                return SCRIPT_EXITED;
+        }
+    }
+    return SCRIPT_DONE;
+}
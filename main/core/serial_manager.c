@@ -8,9 +8,15 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
-#include <ctype.h>
+#include "freertos/semphr.h"
 #include <core/commandline.h>
 #include "driver/usb_serial_jtag.h"
+#include "driver/uart_vfs.h"
+#include "driver/usb_serial_jtag_vfs.h"
+#include "core/line_discipline.h"
+#include "managers/rpc_manager.h"
+#include <esp_log.h>
+#include <esp_timer.h>
 
 #if defined(CONFIG_IDF_TARGET_ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6)
     #define JTAG_SUPPORTED 1
@@ -20,12 +26,17 @@
 
 #define UART_NUM UART_NUM_0
 #define BUF_SIZE (1024)
+// Output is copied here and sent by the driver's interrupt, so printing only
+// waits once this much is still queued for the wire
+#define CONSOLE_TX_BUF_SIZE (8 * 1024)
+#define JTAG_TX_BUF_SIZE (4 * 1024)
 #define SERIAL_BUFFER_SIZE 528
+#define UART_EVENT_QUEUE_LEN 16
+#define COMMAND_QUEUE_LEN 10
 
-char serial_buffer[SERIAL_BUFFER_SIZE];
+static const char *TAG = "SERIAL";
 
-// Forward declaration of command handler
-int handle_serial_command(const char *command);
+static int run_line(char *line);
 
 #if IS_GHOST_BOARD
     #define UART_NUM_1 UART_NUM_1
@@ -34,88 +45,249 @@ int handle_serial_command(const char *command);
     #define GHOST_UART_BUF_SIZE (1024)
 #endif
 
-void serial_task(void *pvParameter) {
-    uint8_t *data = (uint8_t *)malloc(BUF_SIZE);
-    int index = 0;
+#if JTAG_SUPPORTED
+#define JTAG_CHUNK_SIZE 64
+#define JTAG_QUEUE_LEN 4
+
+typedef struct {
+    uint8_t len;
+    uint8_t data[JTAG_CHUNK_SIZE];
+} jtag_chunk_t;
+
+static QueueHandle_t jtag_queue;
+#else
+#define JTAG_QUEUE_LEN 0
+#endif
+
+typedef enum {
+    SERIAL_SOURCE_UART,
+    SERIAL_SOURCE_JTAG,
+    SERIAL_SOURCE_GHOST,
+    SERIAL_SOURCE_OTHER,         // Queued commands, other tasks
+} serial_source_t;
+
+// Scripts run commands from their own task, one command at a time with the console
+static SemaphoreHandle_t command_lock;
+
+// Input the serial task is working on, so rpc knows where to answer
+static serial_source_t current_source = SERIAL_SOURCE_OTHER;
+static serial_source_t rpc_source;
+
+// Every input feeds one queue of this set, so the task sleeps until one of them has work
+static QueueSetHandle_t serial_queue_set;
+static QueueHandle_t uart_event_queue;
+static line_discipline_t console_ld;
+static char serial_buffer[SERIAL_BUFFER_SIZE];
 
 #if IS_GHOST_BOARD
-    uint8_t *ghost_data = (uint8_t *)malloc(GHOST_UART_BUF_SIZE);
-    int ghost_index = 0;
+static QueueHandle_t ghost_event_queue;
+static line_discipline_t ghost_ld;
+static char ghost_buffer[SERIAL_BUFFER_SIZE];
+#define GHOST_QUEUE_LEN UART_EVENT_QUEUE_LEN
+#else
+#define GHOST_QUEUE_LEN 0
 #endif
 
-    while (1) {
-        int length = 0;
+static struct {
+    int64_t since_us;
+    int64_t wake_us;             // When the current wakeup started
+    uint32_t wakeups;
+    uint32_t idle_wakeups;       // Woke without input or a queued command
+    uint32_t bytes;
+    uint32_t commands;
+    uint32_t lost;               // Driver buffer overflows
+    uint32_t rejected;           // Simulated commands refused because the queue was full
+    uint64_t latency_us;         // Wakeup to command start
+    uint32_t max_latency_us;
+    uint64_t run_us;
+    uint32_t max_run_us;
+} serial_stats;
+
+static void run_command(char *line) {
+    int64_t start_us = esp_timer_get_time();
+    run_line(line);
+    int64_t end_us = esp_timer_get_time();
+
+    uint32_t latency_us = (uint32_t)(start_us - serial_stats.wake_us);
+    uint32_t run_us = (uint32_t)(end_us - start_us);
+    serial_stats.commands++;
+    serial_stats.latency_us += latency_us;
+    serial_stats.run_us += run_us;
+    if (latency_us > serial_stats.max_latency_us) {
+        serial_stats.max_latency_us = latency_us;
+    }
+    if (run_us > serial_stats.max_run_us) {
+        serial_stats.max_run_us = run_us;
+    }
+}
 
-        // Read data from the main UART
-        length = uart_read_bytes(UART_NUM, data, BUF_SIZE, 10 / portTICK_PERIOD_MS);
+static void console_line(char *line, size_t len, void *ctx) {
+    run_command(line);
+}
 
-#if JTAG_SUPPORTED
-        if (length <= 0) {
-            length = usb_serial_jtag_read_bytes(data, BUF_SIZE, 10 / portTICK_PERIOD_MS);
+static size_t console_complete(char *line, size_t len, size_t cap, void *ctx) {
+    const char *cands[16];
+    size_t count = command_complete(line, cands, 16);
+    if (count == 0) {
+        return len;
+    }
+
+    size_t word = len;
+    while (word > 0 && line[word - 1] != ' ') {
+        word--;
+    }
+
+    // Extend the word as far as every candidate agrees
+    size_t shown = count < 16 ? count : 16;
+    size_t common = count <= 16 ? cmd_common_prefix_len(cands, shown) : 0;
+    size_t start = len;
+    while (word + common > len && len < cap) {
+        line[len] = cands[0][len - word];
+        len++;
+    }
+    if (count == 1 && len < cap) {
+        line[len++] = ' ';
+    }
+
+    if (count > 1) {
+        printf("\n");
+        for (size_t i = 0; i < shown; i++) {
+            printf("%s  ", cands[i]);
         }
+        printf("%s\n%.*s", count > shown ? "..." : "", (int)len, line);
+    } else {
+        printf("%.*s", (int)(len - start), line + start);
+    }
+    fflush(stdout);
+    return len;
+}
+
+#if IS_GHOST_BOARD
+static void ghost_line(char *line, size_t len, void *ctx) {
+    printf("%s\n", line);
+}
 #endif
 
-        // Process data from the main UART
+#if JTAG_SUPPORTED
+// The USB-JTAG driver has no event queue, so a reader blocks on it and
+// hands each chunk to the serial task
+static void jtag_reader_task(void *pvParameter) {
+    jtag_chunk_t chunk;
+
+    while (1) {
+        int length = usb_serial_jtag_read_bytes(chunk.data, sizeof(chunk.data), portMAX_DELAY);
         if (length > 0) {
-            for (int i = 0; i < length; i++) {
-                char incoming_char = (char)data[i];
-
-                if (incoming_char == '\n' || incoming_char == '\r') {
-                    serial_buffer[index] = '\0';
-                    if (index > 0) {
-                        handle_serial_command(serial_buffer);
-                        index = 0;
-                    }
-                } else if (index < SERIAL_BUFFER_SIZE - 1) {
-                    serial_buffer[index++] = incoming_char;
-                } else {
-                    index = 0;
-                }
+            chunk.len = (uint8_t)length;
+            xQueueSend(jtag_queue, &chunk, portMAX_DELAY);
+        }
+    }
+}
+#endif
+
+// Input from the link an RPC session is open on goes to the frame decoder instead
+static void feed_input(serial_source_t source, line_discipline_t *ld, const uint8_t *data, size_t len) {
+    if (rpc_manager_is_open() && source == rpc_source) {
+        rpc_manager_feed(data, len);
+    } else {
+        line_discipline_feed(ld, data, len);
+    }
+}
+
+static void uart_write_frame(const uint8_t *data, size_t len) {
+    uart_write_bytes(UART_NUM, data, len);
+}
+
+#if JTAG_SUPPORTED
+static void jtag_write_frame(const uint8_t *data, size_t len) {
+    usb_serial_jtag_write_bytes(data, len, pdMS_TO_TICKS(50));
+}
+#endif
+
+static void drain_uart(uart_port_t port, QueueHandle_t events, serial_source_t source,
+                       line_discipline_t *ld, uint8_t *data) {
+    uart_event_t event;
+    if (xQueueReceive(events, &event, 0) != pdTRUE) {
+        return;
+    }
+
+    if (event.type == UART_DATA) {
+        size_t left = event.size;
+        while (left > 0) {
+            int length = uart_read_bytes(port, data, left < BUF_SIZE ? left : BUF_SIZE, 0);
+            if (length <= 0) {
+                break;
             }
+            serial_stats.bytes += length;
+            feed_input(source, ld, data, length);
+            left -= length;
         }
+    } else if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+        // Input was lost, so whatever line was being assembled is garbage
+        uart_flush_input(port);
+        line_discipline_reset(ld);
+        serial_stats.lost++;
+    }
+}
+
+void serial_task(void *pvParameter) {
+    uint8_t *data = (uint8_t *)malloc(BUF_SIZE);
 
+    while (1) {
+        // An open RPC session needs polling for its stats topic and idle timeout
+        TickType_t wait = rpc_manager_is_open() ? pdMS_TO_TICKS(RPC_POLL_MS) : portMAX_DELAY;
+        QueueSetMemberHandle_t member = xQueueSelectFromSet(serial_queue_set, wait);
+        if (member == NULL) {
+            rpc_manager_poll();
+            continue;
+        }
+        serial_stats.wake_us = esp_timer_get_time();
+        serial_stats.wakeups++;
+        uint32_t bytes = serial_stats.bytes;
+        uint32_t commands = serial_stats.commands;
+
+        if (member == uart_event_queue) {
+            current_source = SERIAL_SOURCE_UART;
+            drain_uart(UART_NUM, uart_event_queue, SERIAL_SOURCE_UART, &console_ld, data);
+#if JTAG_SUPPORTED
+        } else if (member == jtag_queue) {
+            jtag_chunk_t chunk;
+            if (xQueueReceive(jtag_queue, &chunk, 0) == pdTRUE) {
+                serial_stats.bytes += chunk.len;
+                current_source = SERIAL_SOURCE_JTAG;
+                feed_input(SERIAL_SOURCE_JTAG, &console_ld, chunk.data, chunk.len);
+            }
+#endif
 #if IS_GHOST_BOARD
-        int ghost_length = uart_read_bytes(UART_NUM_1, ghost_data, GHOST_UART_BUF_SIZE, 10 / portTICK_PERIOD_MS);
-        if (ghost_length > 0) {
-            for (int i = 0; i < ghost_length; i++) {
-                char incoming_char = (char)ghost_data[i];
-
-                if (incoming_char == '\n' || incoming_char == '\r') {
-                    serial_buffer[ghost_index] = '\0';
-                    if (ghost_index > 0) {
-                        printf(serial_buffer);
-                        ghost_index = 0;
-                    }
-                } else if (ghost_index < SERIAL_BUFFER_SIZE - 1) {
-                    serial_buffer[ghost_index++] = incoming_char;
-                } else {
-                    ghost_index = 0;
-                }
+        } else if (member == ghost_event_queue) {
+            current_source = SERIAL_SOURCE_GHOST;
+            drain_uart(UART_NUM_1, ghost_event_queue, SERIAL_SOURCE_GHOST, &ghost_ld, data);
+#endif
+        } else if (member == (QueueSetMemberHandle_t)commandQueue) {
+            // Simulated commands from the display and the web UI
+            SerialCommand command;
+            if (xQueueReceive((QueueHandle_t)commandQueue, &command, 0) == pdTRUE) {
+                run_command(command.command);
             }
         }
-#endif
 
-        // Check command queue for simulated commands
-        SerialCommand command;
-        if (xQueueReceive(commandQueue, &command, 0) == pdTRUE) {
-            handle_serial_command(command.command);
-        }
+        current_source = SERIAL_SOURCE_OTHER;
+        rpc_manager_poll();
 
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+        if (serial_stats.bytes == bytes && serial_stats.commands == commands) {
+            serial_stats.idle_wakeups++;
+        }
     }
 
     free(data);
-
-#if IS_GHOST_BOARD
-    free(ghost_data);
-#endif
 }
 
 // Initialize the SerialManager
 void serial_manager_init() {
+    command_lock = xSemaphoreCreateRecursiveMutex();
+
     // UART configuration for main UART
     const uart_config_t uart_config = {
-        .baud_rate = 115200,
+        .baud_rate = SERIAL_DEFAULT_BAUD,
         .data_bits = UART_DATA_8_BITS,
         .parity = UART_PARITY_DISABLE,
         .stop_bits = UART_STOP_BITS_1,
@@ -123,14 +295,23 @@ void serial_manager_init() {
     };
 
     uart_param_config(UART_NUM, &uart_config);
-    uart_driver_install(UART_NUM, BUF_SIZE * 2, 0, 0, NULL, 0);
+    uart_driver_install(UART_NUM, BUF_SIZE * 2, CONSOLE_TX_BUF_SIZE, UART_EVENT_QUEUE_LEN, &uart_event_queue, 0);
+#if CONFIG_ESP_CONSOLE_UART && CONFIG_ESP_CONSOLE_UART_NUM == 0
+    // stdout otherwise busy-waits on the 128 byte hardware FIFO for every character
+    uart_vfs_dev_use_driver(UART_NUM);
+#endif
 
 #if JTAG_SUPPORTED
     usb_serial_jtag_driver_config_t usb_serial_jtag_config = {
         .rx_buffer_size = BUF_SIZE,
-        .tx_buffer_size = BUF_SIZE,
+        .tx_buffer_size = JTAG_TX_BUF_SIZE,
     };
     usb_serial_jtag_driver_install(&usb_serial_jtag_config);
+#if CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG
+    // Full speed USB bulk transfers, the baud rate setting does not apply
+    usb_serial_jtag_vfs_use_driver();
+#endif
+    jtag_queue = xQueueCreate(JTAG_QUEUE_LEN, sizeof(jtag_chunk_t));
 #endif
 
 #if IS_GHOST_BOARD
@@ -144,71 +325,151 @@ void serial_manager_init() {
 
     uart_param_config(UART_NUM_1, &ghost_uart_config);
     uart_set_pin(UART_NUM_1, GHOST_UART_TX_PIN, GHOST_UART_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    uart_driver_install(UART_NUM_1, GHOST_UART_BUF_SIZE * 2, 0, 0, NULL, 0);
+    uart_driver_install(UART_NUM_1, GHOST_UART_BUF_SIZE * 2, 0, UART_EVENT_QUEUE_LEN, &ghost_event_queue, 0);
+    line_discipline_init(&ghost_ld, ghost_buffer, sizeof(ghost_buffer), ghost_line, NULL, NULL);
 #endif
 
-    commandQueue = xQueueCreate(10, sizeof(SerialCommand));
+    commandQueue = xQueueCreate(COMMAND_QUEUE_LEN, sizeof(SerialCommand));
+    line_discipline_init(&console_ld, serial_buffer, sizeof(serial_buffer), console_line, console_complete, NULL);
 
+    serial_queue_set = xQueueCreateSet(UART_EVENT_QUEUE_LEN + COMMAND_QUEUE_LEN + JTAG_QUEUE_LEN + GHOST_QUEUE_LEN);
+    if (serial_queue_set == NULL || uart_event_queue == NULL || commandQueue == NULL) {
+        ESP_LOGE(TAG, "Failed to create serial queues");
+        return;
+    }
+    xQueueAddToSet(uart_event_queue, serial_queue_set);
+    xQueueAddToSet((QueueHandle_t)commandQueue, serial_queue_set);
+#if JTAG_SUPPORTED
+    xQueueAddToSet(jtag_queue, serial_queue_set);
+    xTaskCreate(jtag_reader_task, "JtagReader", 2048, NULL, 10, NULL);
+#endif
+#if IS_GHOST_BOARD
+    xQueueAddToSet(ghost_event_queue, serial_queue_set);
+#endif
+
+    serial_stats.since_us = esp_timer_get_time();
     xTaskCreate(serial_task, "SerialTask", 8192, NULL, 10, NULL);
 }
 
-int handle_serial_command(const char *input) {
-    char *input_copy = strdup(input);
-    char *argv[10];
-    int argc = 0;
-    char *p = input_copy;
+void serial_manager_print_stats(bool reset) {
+    uint32_t elapsed_s = (uint32_t)((esp_timer_get_time() - serial_stats.since_us) / 1000000);
+    uint32_t commands = serial_stats.commands;
+
+    printf("Serial console over %lu s: %lu wakeups (%lu idle, %lu.%02lu idle/s), %lu bytes, %lu commands, %lu overflows\n",
+           (unsigned long)elapsed_s, (unsigned long)serial_stats.wakeups, (unsigned long)serial_stats.idle_wakeups,
+           (unsigned long)(elapsed_s ? serial_stats.idle_wakeups / elapsed_s : serial_stats.idle_wakeups),
+           (unsigned long)(elapsed_s ? serial_stats.idle_wakeups * 100 / elapsed_s % 100 : 0),
+           (unsigned long)serial_stats.bytes, (unsigned long)commands,
+           (unsigned long)(serial_stats.lost + console_ld.overflows));
+    if (serial_stats.rejected) {
+        printf("%lu queued commands were refused because the queue was full\n", (unsigned long)serial_stats.rejected);
+    }
+    printf("Input to command start: avg %lu us, max %lu us. Command run time: avg %lu us, max %lu us\n",
+           (unsigned long)(commands ? serial_stats.latency_us / commands : 0), (unsigned long)serial_stats.max_latency_us,
+           (unsigned long)(commands ? serial_stats.run_us / commands : 0), (unsigned long)serial_stats.max_run_us);
+
+    if (reset) {
+        memset(&serial_stats, 0, sizeof(serial_stats));
+        serial_stats.since_us = esp_timer_get_time();
+        console_ld.overflows = 0;
+    }
+}
 
-    while (isspace((unsigned char)*p)) {
-        p++;
+esp_err_t serial_manager_start_rpc(void) {
+    rpc_write_fn_t write;
+    if (current_source == SERIAL_SOURCE_UART) {
+        write = uart_write_frame;
+#if JTAG_SUPPORTED
+    } else if (current_source == SERIAL_SOURCE_JTAG) {
+        write = jtag_write_frame;
+#endif
+    } else {
+        return ESP_ERR_NOT_SUPPORTED;
     }
 
-    while (*p != '\0' && argc < 10) {
-        if (*p == '"') {
-            p++;
-            argv[argc++] = p;
-            while (*p != '\0' && *p != '"') {
-                p++;
-            }
-            if (*p == '"') {
-                *p = '\0';
-                p++;
-            }
-        } else {
-            argv[argc++] = p;
-            while (*p != '\0' && !isspace((unsigned char)*p)) {
-                p++;
-            }
-            if (*p != '\0') {
-                *p = '\0';
-                p++;
-            }
-        }
+    esp_err_t err = rpc_manager_open(write);
+    if (err == ESP_OK) {
+        rpc_source = current_source;
+    }
+    return err;
+}
 
-        while (isspace((unsigned char)*p)) {
-            p++;
-        }
+esp_err_t serial_manager_set_baud(uint32_t baud) {
+    if (baud < SERIAL_MIN_BAUD || baud > SERIAL_MAX_BAUD) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Let queued output finish at the rate the terminal is still listening at
+    fflush(stdout);
+    uart_wait_tx_done(UART_NUM, pdMS_TO_TICKS(1000));
+    esp_err_t err = uart_set_baudrate(UART_NUM, baud);
+    if (err != ESP_OK) {
+        return err;
     }
 
+    // Anything that arrived mid-switch was sampled at the wrong rate
+    uart_flush_input(UART_NUM);
+    line_discipline_reset(&console_ld);
+    return ESP_OK;
+}
+
+uint32_t serial_manager_get_baud(void) {
+    uint32_t baud = 0;
+    uart_get_baudrate(UART_NUM, &baud);
+    return baud;
+}
+
+// Tokenizes in place, so argv points into line until the command returns
+static int run_line(char *line) {
+    char *argv[CMD_MAX_ARGS];
+    int argc = cmd_tokenize(line, argv, CMD_MAX_ARGS);
+
+    if (argc == CMD_TOKENIZE_TOO_MANY) {
+        printf("Error: more than %d arguments\n", CMD_MAX_ARGS);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (argc == CMD_TOKENIZE_UNTERMINATED) {
+        printf("Error: unterminated quote\n");
+        return ESP_ERR_INVALID_ARG;
+    }
     if (argc == 0) {
-        free(input_copy);
         return ESP_ERR_INVALID_ARG;
     }
 
-    CommandFunction cmd_func = find_command(argv[0]);
-    if (cmd_func != NULL) {
-        cmd_func(argc, argv);
-        return ESP_OK;
-    } else {
-        printf("Unknown command: %s\n", argv[0]);
-        return ESP_ERR_INVALID_ARG;
+    if (command_lock == NULL) {
+        return command_execute(argc, argv);
     }
+    xSemaphoreTakeRecursive(command_lock, portMAX_DELAY);
+    int err = command_execute(argc, argv);
+    xSemaphoreGiveRecursive(command_lock);
+    return err;
+}
+
+int handle_serial_command(const char *input) {
+    char line[SERIAL_BUFFER_SIZE];
 
-    free(input_copy);
+    if (strlcpy(line, input, sizeof(line)) >= sizeof(line)) {
+        printf("Error: command longer than %d characters\n", SERIAL_BUFFER_SIZE - 1);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return run_line(line);
 }
 
-void simulateCommand(const char *commandString) {
+esp_err_t simulateCommand(const char *commandString) {
     SerialCommand command;
-    strncpy(command.command, commandString, sizeof(command.command) - 1);
-    command.command[sizeof(command.command) - 1] = '\0';
-    xQueueSend(commandQueue, &command, portMAX_DELAY);
-}
\ No newline at end of file
+
+    if (commandQueue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (strlcpy(command.command, commandString, sizeof(command.command)) >= sizeof(command.command)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Callers are UI and HTTP handlers, they report a busy console rather than stall
+    if (xQueueSend((QueueHandle_t)commandQueue, &command, 0) != pdTRUE) {
+        serial_stats.rejected++;
+        ESP_LOGW(TAG, "Command queue full, dropped: %s", commandString);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
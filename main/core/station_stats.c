@@ -0,0 +1,280 @@
+#include "core/station_stats.h"
+#include "core/json_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define FRAME_TYPE_MGMT 0x00
+#define FRAME_TYPE_DATA 0x08
+#define SUBTYPE_PROBE_REQ 0x40
+
+#define FLAG_TO_DS   0x01
+#define FLAG_FROM_DS 0x02
+#define FLAG_PWR_MGT 0x10
+
+#define MGMT_HDR_LEN 24
+
+static const char *sort_names[] = { "recent", "frames", "bytes", "rssi" };
+
+static uint32_t mac_hash(const uint8_t *mac) {
+    // FNV-1a over the address
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        h ^= mac[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void station_stats_init(station_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+static station_entry_t *find_station(station_stats_t *stats, const uint8_t *mac, uint32_t now_ms, bool *is_new) {
+    uint32_t start = mac_hash(mac) & (STATION_STATS_MAX_STATIONS - 1);
+    station_entry_t *free_slot = NULL;
+    station_entry_t *oldest = NULL;
+
+    for (int i = 0; i < STATION_STATS_MAX_PROBE; i++) {
+        station_entry_t *e = &stats->stations[(start + i) & (STATION_STATS_MAX_STATIONS - 1)];
+
+        if (!e->in_use) {
+            if (free_slot == NULL) {
+                free_slot = e;
+            }
+            continue;
+        }
+
+        if (memcmp(e->mac, mac, 6) == 0) {
+            return e;
+        }
+
+        if (oldest == NULL || (now_ms - e->last_seen_ms) > (now_ms - oldest->last_seen_ms)) {
+            oldest = e;
+        }
+    }
+
+    station_entry_t *slot = free_slot;
+    if (slot == NULL) {
+        // Probe window is full, recycle the least recently seen station
+        slot = oldest;
+        stats->evictions++;
+    } else {
+        stats->station_count++;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->in_use = true;
+    memcpy(slot->mac, mac, 6);
+    slot->first_seen_ms = now_ms;
+    *is_new = true;
+    return slot;
+}
+
+static void record_rssi(station_entry_t *e, int8_t rssi) {
+    if (!e->has_rssi) {
+        e->rssi_min = rssi;
+        e->rssi_max = rssi;
+        e->rssi_avg_q4 = (int16_t)(rssi * 16);
+        e->has_rssi = true;
+        return;
+    }
+
+    if (rssi < e->rssi_min) e->rssi_min = rssi;
+    if (rssi > e->rssi_max) e->rssi_max = rssi;
+    e->rssi_avg_q4 += (int16_t)((rssi * 16 - e->rssi_avg_q4) / 16);
+}
+
+station_entry_t *station_stats_update(station_stats_t *stats, const uint8_t *frame, size_t len,
+                                      int8_t rssi, uint32_t now_ms, bool *is_new) {
+    *is_new = false;
+
+    if (len < MGMT_HDR_LEN) {
+        return NULL;
+    }
+
+    uint8_t fc0 = frame[0];
+    uint8_t flags = frame[1];
+    const uint8_t *addr1 = &frame[4];
+    const uint8_t *addr2 = &frame[10];
+
+    stats->frames_seen++;
+
+    if ((fc0 & 0x0C) == FRAME_TYPE_MGMT) {
+        if ((fc0 & 0xF0) != SUBTYPE_PROBE_REQ || (addr2[0] & 0x01)) {
+            return NULL;
+        }
+
+        station_entry_t *e = find_station(stats, addr2, now_ms, is_new);
+        e->last_seen_ms = now_ms;
+        record_rssi(e, rssi);
+        e->probe_requests++;
+        return e;
+    }
+
+    if ((fc0 & 0x0C) != FRAME_TYPE_DATA) {
+        return NULL;
+    }
+
+    uint8_t ds = flags & (FLAG_TO_DS | FLAG_FROM_DS);
+    bool uplink;
+    const uint8_t *station;
+    const uint8_t *bssid;
+
+    if (ds == FLAG_TO_DS) {
+        uplink = true;
+        bssid = addr1;
+        station = addr2;
+    } else if (ds == FLAG_FROM_DS) {
+        uplink = false;
+        station = addr1;
+        bssid = addr2;
+    } else {
+        // IBSS and WDS frames have no station/AP direction
+        return NULL;
+    }
+
+    // Group addressed downlink traffic is not attributable to one station
+    if (station[0] & 0x01) {
+        return NULL;
+    }
+
+    station_entry_t *e = find_station(stats, station, now_ms, is_new);
+    e->last_seen_ms = now_ms;
+    memcpy(e->ap_bssid, bssid, 6);
+
+    if (uplink) {
+        e->frames_up++;
+        e->bytes_up += (uint32_t)len;
+
+        // Signal and power management bit describe the transmitter
+        record_rssi(e, rssi);
+
+        bool power_save = (flags & FLAG_PWR_MGT) != 0;
+        if (!*is_new && power_save != e->power_save) {
+            e->ps_transitions++;
+        }
+        e->power_save = power_save;
+    } else {
+        e->frames_down++;
+        e->bytes_down += (uint32_t)len;
+    }
+
+    return e;
+}
+
+static const station_stats_t *sort_table;
+static station_sort_t sort_key;
+
+static int compare_stations(const void *a, const void *b) {
+    const station_entry_t *x = &sort_table->stations[*(const uint16_t *)a];
+    const station_entry_t *y = &sort_table->stations[*(const uint16_t *)b];
+    int64_t vx;
+    int64_t vy;
+
+    switch (sort_key) {
+        case STATION_SORT_FRAMES:
+            vx = (int64_t)x->frames_up + x->frames_down;
+            vy = (int64_t)y->frames_up + y->frames_down;
+            break;
+        case STATION_SORT_BYTES:
+            vx = (int64_t)x->bytes_up + x->bytes_down;
+            vy = (int64_t)y->bytes_up + y->bytes_down;
+            break;
+        case STATION_SORT_RSSI:
+            vx = x->has_rssi ? x->rssi_avg_q4 : INT16_MIN;
+            vy = y->has_rssi ? y->rssi_avg_q4 : INT16_MIN;
+            break;
+        default:
+            vx = x->last_seen_ms;
+            vy = y->last_seen_ms;
+            break;
+    }
+
+    // Descending
+    return (vx < vy) - (vx > vy);
+}
+
+size_t station_stats_sort(const station_stats_t *stats, station_sort_t key, uint16_t *order, size_t max) {
+    size_t count = 0;
+
+    for (uint16_t i = 0; i < STATION_STATS_MAX_STATIONS && count < max; i++) {
+        if (stats->stations[i].in_use) {
+            order[count++] = i;
+        }
+    }
+
+    sort_table = stats;
+    sort_key = key;
+    qsort(order, count, sizeof(order[0]), compare_stations);
+    return count;
+}
+
+size_t station_stats_format_json(const station_entry_t *e, const probe_tracker_t *probes,
+                                 char *out, size_t out_size) {
+    int n = snprintf(out, out_size,
+        "{\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"bssid\":\"%02x:%02x:%02x:%02x:%02x:%02x\","
+        "\"frames_up\":%lu,\"frames_down\":%lu,\"bytes_up\":%lu,\"bytes_down\":%lu,"
+        "\"first_seen_ms\":%lu,\"last_seen_ms\":%lu,",
+        e->mac[0], e->mac[1], e->mac[2], e->mac[3], e->mac[4], e->mac[5],
+        e->ap_bssid[0], e->ap_bssid[1], e->ap_bssid[2], e->ap_bssid[3], e->ap_bssid[4], e->ap_bssid[5],
+        (unsigned long)e->frames_up, (unsigned long)e->frames_down,
+        (unsigned long)e->bytes_up, (unsigned long)e->bytes_down,
+        (unsigned long)e->first_seen_ms, (unsigned long)e->last_seen_ms);
+    if (n < 0 || (size_t)n >= out_size) {
+        return 0;
+    }
+    size_t used = (size_t)n;
+
+    if (e->has_rssi) {
+        n = snprintf(&out[used], out_size - used, "\"rssi_min\":%d,\"rssi_avg\":%d,\"rssi_max\":%d,",
+                     e->rssi_min, e->rssi_avg_q4 / 16, e->rssi_max);
+    } else {
+        n = snprintf(&out[used], out_size - used, "\"rssi_min\":null,\"rssi_avg\":null,\"rssi_max\":null,");
+    }
+    if (n < 0 || used + (size_t)n >= out_size) {
+        return 0;
+    }
+    used += (size_t)n;
+
+    n = snprintf(&out[used], out_size - used, "\"power_save\":%s,\"ps_transitions\":%u,\"probe_requests\":%u,\"probes\":[",
+                 e->power_save ? "true" : "false", e->ps_transitions, e->probe_requests);
+    if (n < 0 || used + (size_t)n >= out_size) {
+        return 0;
+    }
+    used += (size_t)n;
+
+    const probe_device_t *d = probes != NULL ? probe_tracker_find(probes, e->mac) : NULL;
+    bool first = true;
+    for (int i = 0; d != NULL && i < d->ssid_count; i++) {
+        const char *ssid = probe_tracker_ssid(probes, &d->ssids[i]);
+        if (ssid == NULL) {
+            continue;
+        }
+        if (!first) {
+            if (used < out_size) out[used] = ',';
+            used++;
+        }
+        used = json_append_string(out, out_size, used, ssid);
+        first = false;
+    }
+
+    if (used + 3 > out_size) {
+        return 0;
+    }
+    out[used++] = ']';
+    out[used++] = '}';
+    out[used] = '\0';
+    return used;
+}
+
+bool station_stats_parse_sort(const char *name, station_sort_t *key) {
+    for (size_t i = 0; i < sizeof(sort_names) / sizeof(sort_names[0]); i++) {
+        if (strcasecmp(name, sort_names[i]) == 0) {
+            *key = (station_sort_t)i;
+            return true;
+        }
+    }
+    return false;
+}
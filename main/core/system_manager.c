@@ -1,6 +1,10 @@
 // system_manager.c
 
 #include "core/system_manager.h"
+#include "managers/rpc_manager.h"
+#include "freertos/semphr.h"
+#include <esp_system.h>
+#include <esp_timer.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -8,9 +12,17 @@
 // Head of the linked list for tasks
 static ManagedTask *task_list_head = NULL;
 
+// Jobs are started and stopped from the serial task, the UI and RPC
+static job_table_t job_table;
+static SemaphoreHandle_t job_lock = NULL;
+
+static void on_job_finished(const job_t *job, void *ctx);
+
 // Initialize the System Manager
 void system_manager_init() {
     task_list_head = NULL;
+    job_lock = xSemaphoreCreateMutex();
+    job_table_init(&job_table, on_job_finished, NULL);
 }
 
 // Create a new task
@@ -150,4 +162,183 @@ void system_manager_list_tasks() {
         printf("Task Name: %s, Priority: %d\n", current->task_name, current->priority);
         current = current->next;
     }
-}
\ No newline at end of file
+}
+
+
+static uint32_t job_now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static const char *job_resource_name(uint32_t resources) {
+    if (resources & JOB_RES_WIFI) {
+        return "WiFi";
+    }
+    if (resources & JOB_RES_BLE) {
+        return "BLE";
+    }
+    if (resources & JOB_RES_SCRIPT) {
+        return "script runner";
+    }
+    return "capture file";
+}
+
+static void format_runtime(char *buf, size_t len, uint32_t ms) {
+    uint32_t s = ms / 1000;
+    if (s < 60) {
+        snprintf(buf, len, "%lu.%lus", (unsigned long)s, (unsigned long)(ms % 1000) / 100);
+    } else if (s < 3600) {
+        snprintf(buf, len, "%lum%02lus", (unsigned long)(s / 60), (unsigned long)(s % 60));
+    } else {
+        snprintf(buf, len, "%luh%02lum", (unsigned long)(s / 3600), (unsigned long)(s / 60 % 60));
+    }
+}
+
+// Progress is sampled when a job ends or is listed, so finished jobs keep their final count
+static void refresh_progress_locked(void) {
+    for (size_t i = 0; i < JOB_TABLE_SLOTS; i++) {
+        job_t *job = &job_table.jobs[i];
+        const job_desc_t *desc = job->owner;
+        if (job->id != 0 && job_state_active(job->state) && desc != NULL && desc->progress != NULL) {
+            job->items = desc->progress();
+        }
+    }
+}
+
+// Runs with job_lock held
+static void on_job_finished(const job_t *job, void *ctx) {
+    char runtime[16];
+    format_runtime(runtime, sizeof(runtime), job_runtime_ms(job, job->ended_ms));
+    if (job->state == JOB_FAILED) {
+        printf("[job %lu] %s failed after %s: %s\n", (unsigned long)job->id, job->label, runtime,
+               esp_err_to_name(job->result));
+    } else {
+        printf("[job %lu] %s %s after %s\n", (unsigned long)job->id, job->label, job_state_name(job->state), runtime);
+    }
+    rpc_manager_notify_job(job);
+}
+
+uint32_t system_manager_job_start(const job_desc_t *desc, const char *label) {
+    uint32_t holder;
+    xSemaphoreTake(job_lock, portMAX_DELAY);
+    uint32_t id = job_table_start(&job_table, label, desc->resources, desc, job_now_ms(),
+                                  esp_get_free_heap_size(), &holder);
+    if (id == 0) {
+        job_t *busy = job_table_find(&job_table, holder);
+        if (busy != NULL) {
+            printf("Busy: job %lu (%s) is using the %s, stop it or run 'kill %lu'\n", (unsigned long)busy->id,
+                   busy->label, job_resource_name(busy->resources & desc->resources), (unsigned long)busy->id);
+        } else {
+            printf("Too many jobs running, see 'jobs'\n");
+        }
+    }
+    xSemaphoreGive(job_lock);
+    return id;
+}
+
+void system_manager_job_finish(uint32_t id, esp_err_t result) {
+    xSemaphoreTake(job_lock, portMAX_DELAY);
+    refresh_progress_locked();
+    job_table_finish(&job_table, id, result, job_now_ms(), esp_get_free_heap_size());
+    xSemaphoreGive(job_lock);
+}
+
+void system_manager_job_release(const job_desc_t *desc) {
+    xSemaphoreTake(job_lock, portMAX_DELAY);
+    refresh_progress_locked();
+    job_table_release(&job_table, desc, ESP_OK, job_now_ms(), esp_get_free_heap_size());
+    xSemaphoreGive(job_lock);
+}
+
+esp_err_t system_manager_job_kill(uint32_t id) {
+    xSemaphoreTake(job_lock, portMAX_DELAY);
+    job_t *job = job_table_find(&job_table, id);
+    if (job == NULL || !job_state_active(job->state)) {
+        xSemaphoreGive(job_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+    const job_desc_t *desc = job->owner;
+    if (desc->stop == NULL) {
+        xSemaphoreGive(job_lock);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (!job_table_stop(&job_table, id)) {
+        // Already stopping from another kill
+        xSemaphoreGive(job_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreGive(job_lock);
+
+    // Stop hooks delete tasks and flush files, keep the table usable meanwhile
+    desc->stop();
+
+    system_manager_job_finish(id, ESP_OK);
+    return ESP_OK;
+}
+
+size_t system_manager_job_stop(const job_desc_t *desc) {
+    uint32_t ids[JOB_TABLE_SLOTS];
+    size_t count = 0;
+
+    xSemaphoreTake(job_lock, portMAX_DELAY);
+    for (int i = 0; i < JOB_TABLE_SLOTS; i++) {
+        job_t *job = &job_table.jobs[i];
+        if (job->id != 0 && job->owner == desc && job_table_stop(&job_table, job->id)) {
+            ids[count++] = job->id;
+        }
+    }
+    xSemaphoreGive(job_lock);
+
+    // The hook ends the operation as a whole, however many jobs share it
+    if (count > 0 && desc->stop != NULL) {
+        desc->stop();
+    }
+    for (size_t i = 0; i < count; i++) {
+        system_manager_job_finish(ids[i], ESP_OK);
+    }
+    return count;
+}
+
+void system_manager_print_jobs(void) {
+    job_t *jobs[JOB_TABLE_SLOTS];
+    uint32_t now = job_now_ms();
+    uint32_t heap = esp_get_free_heap_size();
+
+    xSemaphoreTake(job_lock, portMAX_DELAY);
+    refresh_progress_locked();
+    size_t count = job_table_list(&job_table, jobs, JOB_TABLE_SLOTS);
+    if (count == 0) {
+        printf("No jobs yet.\n");
+    } else {
+        printf("%-4s %-10s %8s %8s %8s  %s\n", "ID", "STATE", "TIME", "HEAP", "ITEMS", "JOB");
+    }
+    for (size_t i = 0; i < count; i++) {
+        const job_t *job = jobs[i];
+        const job_desc_t *desc = job->owner;
+        char runtime[16];
+        char items[12] = "-";
+        format_runtime(runtime, sizeof(runtime), job_runtime_ms(job, now));
+        if (desc != NULL && desc->progress != NULL) {
+            snprintf(items, sizeof(items), "%lu", (unsigned long)job->items);
+        }
+        // Free heap change since the job started, final once it ended
+        int32_t heap_delta = job_state_active(job->state) ? (int32_t)(heap - job->heap_at_start) : job->heap_delta;
+        printf("%-4lu %-10s %8s %+8ld %8s  %s\n", (unsigned long)job->id, job_state_name(job->state), runtime,
+               (long)heap_delta, items, job->label);
+    }
+    xSemaphoreGive(job_lock);
+}
+
+uint32_t system_manager_job_latest(void) {
+    xSemaphoreTake(job_lock, portMAX_DELAY);
+    uint32_t id = job_table.next_id - 1;
+    xSemaphoreGive(job_lock);
+    return id;
+}
+
+bool system_manager_job_active(uint32_t id) {
+    xSemaphoreTake(job_lock, portMAX_DELAY);
+    job_t *job = job_table_find(&job_table, id);
+    bool active = job != NULL && job_state_active(job->state);
+    xSemaphoreGive(job_lock);
+    return active;
+}
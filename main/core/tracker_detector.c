@@ -0,0 +1,226 @@
+#include "core/tracker_detector.h"
+#include <string.h>
+
+#define COMPANY_APPLE          0x004C
+#define FIND_MY_TYPE           0x12
+#define FIND_MY_SEPARATED_LEN  0x19    // Full key, broadcast while away from the owner
+#define FIND_MY_PAYLOAD_LEN    27      // Type, length, status, 22 key bytes, key bits, hint
+
+#define UUID_TILE              0xFEED
+#define UUID_TILE_ACTIVATED    0xFEEC
+#define UUID_SMARTTAG          0xFD5A
+#define SMARTTAG_MIN_LEN       12      // State, 3 byte aging counter, 8 byte privacy ID
+
+static const char *type_names[TRACKER_TYPE_COUNT] = { "Find My", "Tile", "SmartTag" };
+
+static uint32_t fnv1a(const uint8_t *data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void tracker_detector_init(tracker_detector_t *det, uint32_t dwell_ms) {
+    memset(det, 0, sizeof(*det));
+    det->dwell_ms = dwell_ms;
+}
+
+bool tracker_parse(const ble_adv_t *adv, const uint8_t *addr, tracker_sighting_t *out) {
+    memset(out, 0, sizeof(*out));
+
+    if (adv->has_mfg && adv->company_id == COMPANY_APPLE && adv->mfg_len >= FIND_MY_PAYLOAD_LEN &&
+        adv->mfg_data[0] == FIND_MY_TYPE && adv->mfg_data[1] == FIND_MY_SEPARATED_LEN) {
+        // The key (and the address derived from it) only rotates once a day
+        // while separated, so it identifies the tracker for a whole walk
+        out->type = TRACKER_FIND_MY;
+        out->status = adv->mfg_data[2];
+        out->identity = fnv1a(&adv->mfg_data[3], 23);
+        return true;
+    }
+
+    for (uint8_t i = 0; i < adv->service_data_count; i++) {
+        const ble_adv_service_data_t *sd = &adv->service_data[i];
+
+        if (sd->uuid == UUID_SMARTTAG && sd->len >= SMARTTAG_MIN_LEN) {
+            out->type = TRACKER_SMARTTAG;
+            out->status = sd->data[0];
+            out->has_link = true;
+            out->link = (uint32_t)sd->data[1] | ((uint32_t)sd->data[2] << 8) | ((uint32_t)sd->data[3] << 16);
+            out->identity = fnv1a(&sd->data[4], 8);
+            return true;
+        }
+
+        if (sd->uuid == UUID_TILE || sd->uuid == UUID_TILE_ACTIVATED) {
+            // Tiles keep a static address
+            out->type = TRACKER_TILE;
+            out->identity = fnv1a(addr, 6);
+            return true;
+        }
+    }
+
+    if (ble_adv_has_service(adv, UUID_TILE) || ble_adv_has_service(adv, UUID_TILE_ACTIVATED)) {
+        out->type = TRACKER_TILE;
+        out->identity = fnv1a(addr, 6);
+        return true;
+    }
+
+    return false;
+}
+
+static uint32_t dwell_from_history(const tracker_entry_t *t, uint32_t now_ms) {
+    uint32_t bucket = now_ms / TRACKER_BUCKET_MS;
+    uint32_t shift = bucket - t->head_bucket;
+    if (shift >= TRACKER_HISTORY_BUCKETS) {
+        return 0;
+    }
+
+    uint64_t history = t->history << shift;
+    int newest = -1;
+    int oldest = -1;
+    int gap = 0;
+
+    for (int i = 0; i < TRACKER_HISTORY_BUCKETS; i++) {
+        if (history & ((uint64_t)1 << i)) {
+            if (newest < 0) {
+                newest = i;
+            }
+            oldest = i;
+            gap = 0;
+        } else if (++gap > TRACKER_MAX_GAP_BUCKETS) {
+            // Before the first sighting a gap means the tracker has left
+            break;
+        }
+    }
+
+    if (newest < 0) {
+        return 0;
+    }
+
+    uint32_t start_ms = (bucket - (uint32_t)oldest) * TRACKER_BUCKET_MS;
+    if (start_ms < t->first_seen_ms) {
+        start_ms = t->first_seen_ms;
+    }
+    return t->last_seen_ms - start_ms;
+}
+
+uint32_t tracker_dwell_ms(const tracker_entry_t *tracker, uint32_t now_ms) {
+    return dwell_from_history(tracker, now_ms);
+}
+
+static tracker_entry_t *find_tracker(tracker_detector_t *det, const tracker_sighting_t *s, uint32_t now_ms) {
+    tracker_entry_t *linked = NULL;
+
+    for (int i = 0; i < TRACKER_DETECTOR_MAX_TRACKERS; i++) {
+        tracker_entry_t *t = &det->trackers[i];
+        if (!t->in_use || t->type != s->type) {
+            continue;
+        }
+        if (t->identity == s->identity) {
+            return t;
+        }
+
+        // A SmartTag bumps its aging counter when it picks a new privacy ID
+        if (s->has_link && t->has_link && linked == NULL && s->link == t->link + 1 &&
+            now_ms - t->last_seen_ms <= TRACKER_LINK_WINDOW_MS) {
+            linked = t;
+        }
+    }
+
+    if (linked != NULL) {
+        linked->identity = s->identity;
+        linked->rotations++;
+    }
+    return linked;
+}
+
+static int presence_minutes(const tracker_entry_t *t, uint32_t bucket) {
+    // A tracker that has left counts as nothing, whatever its history
+    if (bucket - t->head_bucket > TRACKER_MAX_GAP_BUCKETS) {
+        return 0;
+    }
+    return __builtin_popcountll(t->history);
+}
+
+static tracker_entry_t *claim_slot(tracker_detector_t *det, uint32_t bucket) {
+    tracker_entry_t *victim = NULL;
+
+    for (int i = 0; i < TRACKER_DETECTOR_MAX_TRACKERS; i++) {
+        tracker_entry_t *t = &det->trackers[i];
+        if (!t->in_use) {
+            return t;
+        }
+
+        // In a crowd, recycle passers-by before anything that has been around
+        // for a while, so a follower is never pushed out by traffic
+        int presence = presence_minutes(t, bucket);
+        int victim_presence = victim ? presence_minutes(victim, bucket) : 0;
+        if (victim == NULL || presence < victim_presence ||
+            (presence == victim_presence && t->last_seen_ms < victim->last_seen_ms)) {
+            victim = t;
+        }
+    }
+
+    det->evictions++;
+    return victim;
+}
+
+tracker_entry_t *tracker_detector_update(tracker_detector_t *det, const tracker_sighting_t *sighting,
+                                         const uint8_t *addr, int8_t rssi, uint32_t now_ms,
+                                         bool *is_new, bool *alerted, tracker_alert_t *alert) {
+    uint32_t bucket = now_ms / TRACKER_BUCKET_MS;
+    *is_new = false;
+    *alerted = false;
+    det->sightings++;
+
+    tracker_entry_t *t = find_tracker(det, sighting, now_ms);
+    if (t == NULL) {
+        t = claim_slot(det, bucket);
+        memset(t, 0, sizeof(*t));
+        t->in_use = true;
+        t->type = (uint8_t)sighting->type;
+        t->identity = sighting->identity;
+        t->first_seen_ms = now_ms;
+        t->last_seen_ms = now_ms;
+        t->head_bucket = bucket;
+        t->rssi_max = rssi;
+        *is_new = true;
+    } else if (bucket - t->head_bucket > TRACKER_MAX_GAP_BUCKETS) {
+        // Gone long enough to break the dwell; a fresh dwell may alert again
+        t->alerted = false;
+        t->first_seen_ms = now_ms;
+    }
+
+    uint32_t shift = bucket - t->head_bucket;
+    t->history = shift >= TRACKER_HISTORY_BUCKETS ? 0 : t->history << shift;
+    t->history |= 1;
+    t->head_bucket = bucket;
+
+    t->has_link = sighting->has_link;
+    t->link = sighting->link;
+    memcpy(t->addr, addr, 6);
+    t->rssi = rssi;
+    if (rssi > t->rssi_max) {
+        t->rssi_max = rssi;
+    }
+    t->sightings++;
+    t->last_seen_ms = now_ms;
+
+    if (!t->alerted) {
+        uint32_t dwell = dwell_from_history(t, now_ms);
+        if (dwell >= det->dwell_ms) {
+            t->alerted = true;
+            det->alerts++;
+            alert->tracker = t;
+            alert->dwell_ms = dwell;
+            *alerted = true;
+        }
+    }
+
+    return t;
+}
+
+const char *tracker_type_name(tracker_type_t type) {
+    return type < TRACKER_TYPE_COUNT ? type_names[type] : "Unknown";
+}
@@ -0,0 +1,287 @@
+#include "core/wps_set.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BEACON_FIXED_LEN 36      // MAC header (24) + timestamp, interval, capabilities (12)
+#define WPS_IE_MAX       512     // WPS data may be fragmented over several vendor IEs
+
+#define IE_SSID   0
+#define IE_VENDOR 221
+
+#define WPS_ATTR_CONFIG_METHODS 0x1008
+#define WPS_ATTR_DEVICE_NAME    0x1011
+#define WPS_ATTR_MANUFACTURER   0x1021
+#define WPS_ATTR_MODEL_NAME     0x1023
+#define WPS_ATTR_MODEL_NUMBER   0x1024
+#define WPS_ATTR_STATE          0x1044
+#define WPS_ATTR_VENDOR_EXT     0x1049
+#define WPS_ATTR_VERSION        0x104A
+#define WPS_ATTR_SETUP_LOCKED   0x1057
+
+#define WFA_SUBELEM_VERSION2    0x00
+
+static uint32_t bssid_hash(const uint8_t *bssid) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        h ^= bssid[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool wps_set_init(wps_set_t *set, uint32_t capacity) {
+    memset(set, 0, sizeof(*set));
+
+    if (capacity == 0 || capacity > WPS_SET_MAX_CAPACITY) {
+        return false;
+    }
+
+    // Keep the index at most half full so probes stay short
+    uint32_t slot_count = 1;
+    while (slot_count < capacity * 2) {
+        slot_count <<= 1;
+    }
+
+    set->networks = calloc(capacity, sizeof(wps_network_t));
+    set->slots = calloc(slot_count, sizeof(uint16_t));
+    if (set->networks == NULL || set->slots == NULL) {
+        wps_set_free(set);
+        return false;
+    }
+
+    set->capacity = capacity;
+    set->slot_mask = slot_count - 1;
+    return true;
+}
+
+void wps_set_free(wps_set_t *set) {
+    free(set->networks);
+    free(set->slots);
+    memset(set, 0, sizeof(*set));
+}
+
+void wps_set_clear(wps_set_t *set) {
+    if (set->slots != NULL) {
+        memset(set->slots, 0, (set->slot_mask + 1) * sizeof(uint16_t));
+    }
+    set->count = 0;
+    set->dropped = 0;
+}
+
+static uint32_t find_slot(const wps_set_t *set, const uint8_t *bssid) {
+    uint32_t slot = bssid_hash(bssid) & set->slot_mask;
+
+    // The index is never more than half full, so an empty slot always ends the probe
+    while (set->slots[slot] != 0) {
+        if (memcmp(set->networks[set->slots[slot] - 1].bssid, bssid, 6) == 0) {
+            break;
+        }
+        slot = (slot + 1) & set->slot_mask;
+    }
+
+    return slot;
+}
+
+wps_network_t *wps_set_find(const wps_set_t *set, const uint8_t *bssid) {
+    if (set->capacity == 0) {
+        return NULL;
+    }
+
+    uint16_t index = set->slots[find_slot(set, bssid)];
+    return index != 0 ? &set->networks[index - 1] : NULL;
+}
+
+wps_network_t *wps_set_insert(wps_set_t *set, const uint8_t *bssid, bool *is_new) {
+    *is_new = false;
+
+    if (set->capacity == 0) {
+        return NULL;
+    }
+
+    uint32_t slot = find_slot(set, bssid);
+    if (set->slots[slot] != 0) {
+        return &set->networks[set->slots[slot] - 1];
+    }
+
+    if (set->count >= set->capacity) {
+        set->dropped++;
+        return NULL;
+    }
+
+    wps_network_t *network = &set->networks[set->count];
+    memset(network, 0, sizeof(*network));
+    memcpy(network->bssid, bssid, 6);
+
+    set->slots[slot] = (uint16_t)(++set->count);
+    *is_new = true;
+    return network;
+}
+
+static void copy_string(char *dst, size_t dst_size, const uint8_t *src, size_t len) {
+    if (len >= dst_size) {
+        len = dst_size - 1;
+    }
+
+    // Strings come straight off the air, keep them printable
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = (src[i] >= 0x20 && src[i] < 0x7F) ? (char)src[i] : '?';
+    }
+    dst[len] = '\0';
+}
+
+// WFA vendor extension: the 00:37:2A vendor id, then id/length/value subelements
+static uint8_t parse_version2(const uint8_t *value, size_t len) {
+    if (len < 3 || value[0] != 0x00 || value[1] != 0x37 || value[2] != 0x2A) {
+        return 0;
+    }
+
+    size_t index = 3;
+    while (index + 2 <= len) {
+        uint8_t id = value[index];
+        uint8_t sub_len = value[index + 1];
+
+        if (index + 2 + sub_len > len) {
+            break;
+        }
+        if (id == WFA_SUBELEM_VERSION2 && sub_len == 1) {
+            return value[index + 2];
+        }
+        index += 2 + sub_len;
+    }
+
+    return 0;
+}
+
+static void parse_attributes(const uint8_t *data, size_t len, wps_network_t *out) {
+    size_t index = 0;
+    uint8_t version2 = 0;
+
+    while (index + 4 <= len) {
+        uint16_t attr_id = (data[index] << 8) | data[index + 1];
+        uint16_t attr_len = (data[index + 2] << 8) | data[index + 3];
+        const uint8_t *value = &data[index + 4];
+
+        if (attr_len > len - (index + 4)) {
+            break;
+        }
+
+        switch (attr_id) {
+            case WPS_ATTR_CONFIG_METHODS:
+                if (attr_len == 2) {
+                    out->config_methods = (value[0] << 8) | value[1];
+                }
+                break;
+            case WPS_ATTR_VERSION:
+                if (attr_len == 1) {
+                    out->version = value[0];
+                }
+                break;
+            case WPS_ATTR_VENDOR_EXT:
+                if (version2 == 0) {
+                    version2 = parse_version2(value, attr_len);
+                }
+                break;
+            case WPS_ATTR_STATE:
+                if (attr_len == 1) {
+                    out->state = value[0];
+                }
+                break;
+            case WPS_ATTR_SETUP_LOCKED:
+                if (attr_len == 1) {
+                    out->locked = value[0] != 0;
+                }
+                break;
+            case WPS_ATTR_MANUFACTURER:
+                copy_string(out->manufacturer, sizeof(out->manufacturer), value, attr_len);
+                break;
+            case WPS_ATTR_DEVICE_NAME:
+                copy_string(out->device_name, sizeof(out->device_name), value, attr_len);
+                break;
+            case WPS_ATTR_MODEL_NAME:
+                copy_string(out->model_name, sizeof(out->model_name), value, attr_len);
+                break;
+            case WPS_ATTR_MODEL_NUMBER:
+                copy_string(out->model_number, sizeof(out->model_number), value, attr_len);
+                break;
+            default:
+                break;
+        }
+
+        index += 4 + attr_len;
+    }
+
+    // WPS 2.0 devices keep 0x10 in the Version attribute for old registrars
+    if (version2 != 0) {
+        out->version = version2;
+    }
+}
+
+bool wps_parse_frame(const uint8_t *frame, size_t len, wps_network_t *out) {
+    if (len < BEACON_FIXED_LEN) {
+        return false;
+    }
+
+    uint8_t fc = frame[0] & 0xFC;
+    if (fc != 0x80 && fc != 0x50) {
+        return false;
+    }
+
+    uint8_t wps_data[WPS_IE_MAX];
+    size_t wps_len = 0;
+    bool wps_found = false;
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out->bssid, &frame[16], 6);
+
+    size_t index = BEACON_FIXED_LEN;
+    while (index + 2 <= len) {
+        uint8_t id = frame[index];
+        uint8_t ie_len = frame[index + 1];
+        const uint8_t *ie = &frame[index + 2];
+
+        if (index + 2 + ie_len > len) {
+            break;
+        }
+
+        if (id == IE_SSID && ie_len <= 32 && out->ssid[0] == '\0') {
+            memcpy(out->ssid, ie, ie_len);
+            out->ssid[ie_len] = '\0';
+        } else if (id == IE_VENDOR && ie_len >= 4 &&
+                   ie[0] == 0x00 && ie[1] == 0x50 && ie[2] == 0xF2 && ie[3] == 0x04) {
+            size_t chunk = ie_len - 4;
+            if (wps_len + chunk > sizeof(wps_data)) {
+                chunk = sizeof(wps_data) - wps_len;
+            }
+            memcpy(&wps_data[wps_len], &ie[4], chunk);
+            wps_len += chunk;
+            wps_found = true;
+        }
+
+        index += 2 + ie_len;
+    }
+
+    if (!wps_found) {
+        return false;
+    }
+
+    parse_attributes(wps_data, wps_len, out);
+
+    out->wps_enabled = true;
+    if (out->config_methods & (WPS_CONF_METHODS_PIN_DISPLAY | WPS_CONF_METHODS_PIN_KEYPAD)) {
+        out->wps_mode = WPS_MODE_PIN;
+    } else if (out->config_methods & WPS_CONF_METHODS_PBC) {
+        out->wps_mode = WPS_MODE_PBC;
+    } else {
+        out->wps_mode = WPS_MODE_NONE;
+    }
+
+    return true;
+}
+
+const char *wps_mode_name(wps_modes_t mode) {
+    switch (mode) {
+        case WPS_MODE_PIN: return "PIN";
+        case WPS_MODE_PBC: return "Push Button";
+        default: return "unknown";
+    }
+}
@@ -7,6 +7,9 @@
 #include "managers/ap_manager.h"
 #include "managers/sd_card_manager.h"
 #include "managers/display_manager.h"
+#include "managers/alert_manager.h"
+#include "managers/script_manager.h"
+#include "managers/log_manager.h"
 #ifndef CONFIG_IDF_TARGET_ESP32S2
 #include "managers/ble_manager.h"
 #endif
@@ -20,23 +23,11 @@ int ieee80211_raw_frame_sanity_check(int32_t arg, int32_t arg2, int32_t arg3){
   return 0;
 }
 
-int custom_vprintf(const char *fmt, va_list args)
-{
-  char buffer[256];
-  int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
-
-  ap_manager_add_log(buffer);
-
-  return len;
-}
-
 void app_main(void) {
+  log_manager_init();
   system_manager_init();
   serial_manager_init();
   wifi_manager_init();
-#ifndef CONFIG_IDF_TARGET_ESP32S2
-  ble_init();
-#endif
 
 #ifdef USB_MODULE
   wifi_manager_auto_deauth();
@@ -49,10 +40,20 @@ void app_main(void) {
 
   settings_init(&G_Settings);
 
+  // The console comes up at the configured rate, then moves to the saved one
+  if (settings_get_console_baud(&G_Settings) != SERIAL_DEFAULT_BAUD) {
+    printf("Console switching to %lu baud\n", (unsigned long)settings_get_console_baud(&G_Settings));
+    if (serial_manager_set_baud(settings_get_console_baud(&G_Settings)) != ESP_OK) {
+      ESP_LOGE("main", "Saved console baud rate %lu is not usable", (unsigned long)settings_get_console_baud(&G_Settings));
+    }
+  }
+
   ap_manager_init();
 
   esp_err_t err = sd_card_init();
 
+  alert_manager_init();
+
 #ifdef WITH_SCREEN
 
 #ifdef USE_JOYSTICK
@@ -88,4 +89,9 @@ void app_main(void) {
   xTaskCreate(rainbow_task, "Rainbow Task", 8192, &rgb_manager, 1, &rgb_effect_task_handle);
   }
 #endif
+
+  // Headless sensors set themselves up from the card
+  if (err == ESP_OK) {
+    script_manager_autorun();
+  }
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "managers/alert_manager.h"
+#include "managers/log_manager.h"
+#include "managers/rgb_manager.h"
+#include "managers/sd_card_manager.h"
+#include "managers/rpc_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ALERT_QUEUE_LENGTH 16
+
+static const char *TAG = "ALERT_MANAGER";
+static QueueHandle_t alert_queue = NULL;
+static uint32_t dropped_alerts = 0;
+
+static const char *severity_to_string(alert_severity_t severity) {
+    switch (severity) {
+        case ALERT_SEVERITY_CRITICAL: return "CRIT";
+        case ALERT_SEVERITY_WARNING: return "WARN";
+        default: return "INFO";
+    }
+}
+
+static void alert_write_to_sd(const alert_t *alert) {
+    if (!sd_card_manager.is_initialized) {
+        return;
+    }
+
+    FILE *f = fopen(ALERT_LOG_PATH, "a");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", ALERT_LOG_PATH);
+        return;
+    }
+
+    fprintf(f, "%lu.%03lu,%s,%s,%s\n",
+            (unsigned long)(alert->uptime_ms / 1000), (unsigned long)(alert->uptime_ms % 1000),
+            severity_to_string(alert->severity), alert->source, alert->message);
+    fclose(f);
+}
+
+static void alert_task(void *pvParameter) {
+    alert_t alert;
+    char line[ALERT_SOURCE_LEN + ALERT_MESSAGE_LEN + 32];
+
+    while (1) {
+        if (xQueueReceive(alert_queue, &alert, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        snprintf(line, sizeof(line), "[ALERT][%s][%s] %s\n",
+                 severity_to_string(alert.severity), alert.source, alert.message);
+
+        // Console, web log and terminal view
+        log_manager_write(alert.severity == ALERT_SEVERITY_CRITICAL  ? LOG_RING_ERROR
+                          : alert.severity == ALERT_SEVERITY_WARNING ? LOG_RING_WARN
+                                                                     : LOG_RING_INFO,
+                          0, line);
+
+        if (alert.severity == ALERT_SEVERITY_CRITICAL) {
+            rgb_manager_post_event(255, 0, 0, LED_PATTERN_SOLID, LED_EVENT_PRIORITY_HIGH);
+        } else if (alert.severity == ALERT_SEVERITY_WARNING) {
+            rgb_manager_post_event(255, 165, 0, LED_PATTERN_SOLID, LED_EVENT_PRIORITY_NORMAL);
+        }
+
+        alert_write_to_sd(&alert);
+
+        rpc_manager_notify_alert(&alert);
+    }
+
+    vTaskDelete(NULL);
+}
+
+esp_err_t alert_manager_init(void) {
+    if (alert_queue != NULL) {
+        return ESP_OK;
+    }
+
+    alert_queue = xQueueCreate(ALERT_QUEUE_LENGTH, sizeof(alert_t));
+    if (alert_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create alert queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(alert_task, "alert_task", 4096, NULL, 4, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create alert task");
+        vQueueDelete(alert_queue);
+        alert_queue = NULL;
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t alert_manager_post(alert_severity_t severity, const char *source, const char *fmt, ...) {
+    if (alert_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    alert_t alert;
+    alert.severity = severity;
+    alert.uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    strncpy(alert.source, source, sizeof(alert.source) - 1);
+    alert.source[sizeof(alert.source) - 1] = '\0';
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(alert.message, sizeof(alert.message), fmt, args);
+    va_end(args);
+
+    // Never block the caller, these are posted from radio callbacks
+    if (xQueueSend(alert_queue, &alert, 0) != pdTRUE) {
+        dropped_alerts++;
+        return ESP_ERR_TIMEOUT;
+    }
+
+    return ESP_OK;
+}
+
+uint32_t alert_manager_dropped_count(void) {
+    return dropped_alerts;
+}
@@ -1,12 +1,14 @@
 #include "managers/ap_manager.h"
 #include "managers/settings_manager.h"
+#include "managers/log_manager.h"
+#include "managers/log_stream.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <esp_wifi.h>
 #include <esp_event.h>
 #include <esp_log.h>
-#include "managers/ghost_esp_site.h"
+#include "managers/web_ui.h"
 #include <esp_http_server.h>
 #include <esp_netif.h>
 #include <nvs_flash.h>
@@ -15,10 +17,7 @@
 #include <cJSON.h>
 #include <math.h>
 
-#define MAX_LOG_BUFFER_SIZE 4096 // Adjust as needed
 #define MIN_(a,b) ((a) < (b) ? (a) : (b))
-static char log_buffer[MAX_LOG_BUFFER_SIZE];
-static size_t log_buffer_index = 0;
 
 static const char* TAG = "AP_MANAGER";
 static httpd_handle_t server = NULL;
@@ -26,9 +25,6 @@ static esp_netif_t* netif = NULL;
 static bool mdns_freed = false;
 
 // Forward declarations
-static esp_err_t http_get_handler(httpd_req_t* req);
-static esp_err_t api_logs_handler(httpd_req_t* req);
-static esp_err_t api_clear_logs_handler(httpd_req_t* req);
 static esp_err_t api_settings_handler(httpd_req_t* req);
 static esp_err_t api_command_handler(httpd_req_t *req);
 static esp_err_t api_settings_get_handler(httpd_req_t* req);
@@ -179,20 +175,6 @@ esp_err_t ap_manager_init(void) {
     }
 
      // Register URI handlers
-    httpd_uri_t uri_get = {
-        .uri       = "/",
-        .method    = HTTP_GET,
-        .handler   = http_get_handler,
-        .user_ctx  = NULL
-    };
-
-    httpd_uri_t uri_post_logs = {
-        .uri       = "/api/logs",
-        .method    = HTTP_GET,
-        .handler   = api_logs_handler,
-        .user_ctx  = NULL
-    };
-
 
     httpd_uri_t uri_post_settings = {
         .uri       = "/api/settings",
@@ -215,9 +197,9 @@ esp_err_t ap_manager_init(void) {
         .user_ctx  = NULL
     };
 
-    ret = httpd_register_uri_handler(server, &uri_post_logs);
-        if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error registering URI /");
+    ret = log_stream_register(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register the log stream: %s", esp_err_to_name(ret));
     }
 
      ret = httpd_register_uri_handler(server, &uri_get_settings);
@@ -231,10 +213,9 @@ esp_err_t ap_manager_init(void) {
         if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error registering URI /");
     }
-    ret = httpd_register_uri_handler(server, &uri_get);
-
-        if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error registering URI /");
+    ret = web_ui_register(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register the web UI: %s", esp_err_to_name(ret));
     }
 
     ret = httpd_register_uri_handler(server, &uri_post_command);
@@ -260,6 +241,7 @@ esp_err_t ap_manager_init(void) {
 // Deinitialize and stop the servers
 void ap_manager_deinit(void) {
     if (server) {
+        log_stream_stop();
         httpd_stop(server);
         server = NULL;
     }
@@ -275,22 +257,7 @@ void ap_manager_deinit(void) {
 
 
 void ap_manager_add_log(const char* log_message) {
-    size_t message_length = strlen(log_message);
-    if (log_buffer_index + message_length < MAX_LOG_BUFFER_SIZE) {
-        strcpy(&log_buffer[log_buffer_index], log_message);
-        log_buffer_index += message_length;
-    } else {
-        ESP_LOGW(TAG, "Log buffer full, clearing buffer and adding new log");
-
-        memset(log_buffer, 0, MAX_LOG_BUFFER_SIZE);
-        log_buffer_index = 0;
-
-
-        strcpy(&log_buffer[log_buffer_index], log_message);
-        log_buffer_index += message_length;
-    }
-
-    printf(log_message);
+    log_manager_write(LOG_RING_INFO, 0, log_message);
 }
 
 esp_err_t ap_manager_start_services() {
@@ -333,20 +300,6 @@ esp_err_t ap_manager_start_services() {
         return ret;
     }
 
-     httpd_uri_t uri_get = {
-        .uri       = "/",
-        .method    = HTTP_GET,
-        .handler   = http_get_handler,
-        .user_ctx  = NULL
-    };
-
-    httpd_uri_t uri_post_logs = {
-        .uri       = "/api/logs",
-        .method    = HTTP_GET,
-        .handler   = api_logs_handler,
-        .user_ctx  = NULL
-    };
-
 
     httpd_uri_t uri_post_settings = {
         .uri       = "/api/settings",
@@ -369,9 +322,9 @@ esp_err_t ap_manager_start_services() {
         .user_ctx  = NULL
     };
 
-    ret = httpd_register_uri_handler(server, &uri_post_logs);
-        if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error registering URI /");
+    ret = log_stream_register(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register the log stream: %s", esp_err_to_name(ret));
     }
 
     ret = httpd_register_uri_handler(server, &uri_get_settings);
@@ -384,10 +337,9 @@ esp_err_t ap_manager_start_services() {
         if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error registering URI /");
     }
-    ret = httpd_register_uri_handler(server, &uri_get);
-
-        if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error registering URI /");
+    ret = web_ui_register(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register the web UI: %s", esp_err_to_name(ret));
     }
 
     ret = httpd_register_uri_handler(server, &uri_post_command);
@@ -429,6 +381,7 @@ void ap_manager_stop_services() {
 
 
     if (server) {
+        log_stream_stop();
         httpd_stop(server);
         server = NULL;
     }
@@ -443,13 +396,6 @@ void ap_manager_stop_services() {
 }
 
 
-// Handler for GET requests (serves the HTML page)
-static esp_err_t http_get_handler(httpd_req_t* req) {
-    ESP_LOGI(TAG, "Received HTTP GET request: %s", req->uri);
-    httpd_resp_set_type(req, "text/html");
-     return httpd_resp_send(req, (const char*)ghost_site_html, ghost_site_html_size);
-}
-
 static esp_err_t api_command_handler(httpd_req_t *req)
 {
     char content[100];
@@ -490,53 +436,26 @@ static esp_err_t api_command_handler(httpd_req_t *req)
     const char *command = command_json->valuestring;
 
 
-    simulateCommand(command);
-   
-    httpd_resp_send(req, "Command executed", strlen("Command executed"));
-
+    esp_err_t err = simulateCommand(command);
     cJSON_Delete(json);
-    return ESP_OK;
-}
 
-
-static esp_err_t api_logs_handler(httpd_req_t* req) {
-    httpd_resp_set_type(req, "text/event-stream");
-    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
-    httpd_resp_set_hdr(req, "Connection", "keep-alive");
-
-    if (log_buffer_index > 0) {
-        char sse_event[2046];
-        size_t log_offset = 0;
-
-        while (log_offset < log_buffer_index) {
-            size_t chunk_size = log_buffer_index - log_offset;
-            if (chunk_size > 2046) {
-                chunk_size = 2046;
-            }
-
-            snprintf(sse_event, sizeof(sse_event), "data: %.*s\n\n", (int)chunk_size, log_buffer + log_offset);
-            httpd_resp_sendstr_chunk(req, sse_event);
-
-            log_offset += chunk_size;
-        }
-
-        log_buffer_index = 0;
-    } else {
-        httpd_resp_sendstr_chunk(req, "data: [No new logs]\n\n");
+    if (err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_set_status(req, "413 Payload Too Large");
+        httpd_resp_send(req, "Command too long", strlen("Command too long"));
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        // The console is still working through earlier commands, let the client retry
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_send(req, "Command queue full", strlen("Command queue full"));
+        return ESP_OK;
     }
 
-    httpd_resp_sendstr_chunk(req, NULL);
+    httpd_resp_send(req, "Command executed", strlen("Command executed"));
     return ESP_OK;
 }
 
-// Handler for /api/clear_logs (clears the log buffer)
-static esp_err_t api_clear_logs_handler(httpd_req_t* req) {
-    log_buffer_index = 0;
-    memset(log_buffer, 0, sizeof(log_buffer));
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, "{\"status\":\"logs_cleared\"}");
-    return ESP_OK;
-}
 
 // Handler for /api/settings (updates settings based on JSON payload)
 static esp_err_t api_settings_handler(httpd_req_t* req) {
@@ -10,36 +10,52 @@
 #include "nimble/nimble_port_freertos.h"
 #include "host/ble_gap.h"
 #include "managers/ble_manager.h"
-#include "esp_random.h"
-#include <esp_mac.h>
+#include "esp_timer.h"
 #include <managers/rgb_manager.h>
-#include <managers/settings_manager.h>
 #include "managers/views/terminal_screen.h"
+#include "managers/alert_manager.h"
+#include "vendor/pcap.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 
 
 #define MAX_DEVICES 30
 #define MAX_HANDLERS 10
 #define MAX_PACKET_SIZE 31
+#define BLE_SYNC_TIMEOUT_MS 3000
+#define BLE_IDLE_LOCK_TIMEOUT_MS 1000
+#define BLE_IDLE_RETRY_MS 1000
 
 static const char *TAG_BLE = "BLE_MANAGER";
 static int airTagCount = 0;
 
 typedef struct {
     ble_data_handler_t handler;
+    uint32_t flags;
 } ble_handler_t;
 
 
 static ble_handler_t *handlers = NULL;
 static int handler_count = 0;
-static int spam_counter = 0;
-static uint16_t *last_company_id = NULL;
-static TickType_t last_detection_time = 0;  
-
-
-static void notify_handlers(struct ble_gap_event *event, int len) {
+static ble_spam_detector_t spam_detector;
+static tracker_detector_t tracker_detector;
+static ble_device_table_t device_table;
+static uint32_t device_capacity = BLE_DEVICE_TABLE_DEFAULT_CAPACITY;
+static uint32_t last_expire_ms = 0;
+static ble_lifecycle_t ble_lifecycle;
+static SemaphoreHandle_t ble_lifecycle_mutex = NULL;
+static SemaphoreHandle_t ble_sync_sem = NULL;
+static esp_timer_handle_t ble_idle_timer = NULL;
+static TaskHandle_t ble_idle_task_handle = NULL;
+static bool scan_session = false;      // A scan holds a reference on the stack
+
+
+static void notify_handlers(struct ble_gap_event *event, const ble_adv_t *adv, bool changed) {
     for (int i = 0; i < handler_count; i++) {
-        if (handlers[i].handler) {
-            handlers[i].handler(event, len);
+        if (handlers[i].handler && (changed || (handlers[i].flags & BLE_HANDLER_ALL_ADVERTS))) {
+            handlers[i].handler(event, adv);
         }
     }
 }
@@ -49,149 +65,174 @@ void nimble_host_task(void *param) {
     nimble_port_freertos_deinit();
 }
 
-static int8_t generate_random_rssi() {
-    return (esp_random() % 121) - 100;
+static void ble_on_sync(void) {
+    xSemaphoreGive(ble_sync_sem);
+}
+
+static void ble_report_heap(const char *what, size_t before) {
+    size_t after = esp_get_free_heap_size();
+    printf("%s, free heap %u -> %u bytes (%+d)\n", what, (unsigned)before, (unsigned)after,
+           (int)after - (int)before);
+    TERMINAL_VIEW_ADD_TEXT("%s, free heap %u bytes\n", what, (unsigned)after);
 }
 
-static void generate_random_name(char *name, size_t max_len) {
-    static const char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
-    size_t len = (esp_random() % (max_len - 1)) + 1;
+static int ble_stack_start(void *ctx) {
+    size_t before = esp_get_free_heap_size();
 
-    for (size_t i = 0; i < len; i++) {
-        name[i] = charset[esp_random() % (sizeof(charset) - 1)];
+    nvs_flash_init();
+    esp_err_t err = nimble_port_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_BLE, "Failed to init NimBLE; err=%d", err);
+        return err;
     }
-    name[len] = '\0';
-}
 
-static void generate_random_mac(uint8_t *mac_addr) {
-    esp_fill_random(mac_addr, 6);
+    ble_hs_cfg.sync_cb = ble_on_sync;
+    xSemaphoreTake(ble_sync_sem, 0);
+    nimble_port_freertos_init(nimble_host_task);
 
-    mac_addr[0] |= 0xC0;
+    // Scanning before the host has synced with the controller fails
+    if (xSemaphoreTake(ble_sync_sem, pdMS_TO_TICKS(BLE_SYNC_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGE(TAG_BLE, "BLE host did not sync with the controller");
+        nimble_port_stop();
+        nimble_port_deinit();
+        return ESP_ERR_TIMEOUT;
+    }
 
-    mac_addr[0] &= 0xFE;
+    ble_report_heap("BLE stack started", before);
+    return 0;
 }
 
-void stop_ble_stack() {
-    int rc;
-
-    
-    rc = ble_gap_adv_stop();
-    if (rc != 0) {
-        ESP_LOGE(TAG_BLE, "Error stopping advertisement; rc=%d", rc);
-    }
+static int ble_stack_stop(void *ctx) {
+    size_t before = esp_get_free_heap_size();
 
-    
-    rc = nimble_port_stop();
+    int rc = nimble_port_stop();
     if (rc != 0) {
         ESP_LOGE(TAG_BLE, "Error stopping NimBLE port; rc=%d", rc);
-        return;
+        return rc;
     }
-
-    
     nimble_port_deinit();
 
-    ESP_LOGI(TAG_BLE, "NimBLE stack and task deinitialized.");
+    ble_report_heap("BLE stack released", before);
+    return 0;
 }
 
-static bool extract_company_id(const uint8_t *payload, size_t length, uint16_t *company_id) {
-    size_t index = 0;
-
-    while (index < length) {
-        uint8_t field_length = payload[index];
-
-        if (field_length == 0 || index + field_length >= length) {
-            break;
-        }
+// Tearing NimBLE down takes a while and must not stall the esp_timer task,
+// so the idle timer only hands the stop to a short-lived task of its own
+static void ble_idle_task(void *arg) {
+    if (xSemaphoreTake(ble_lifecycle_mutex, pdMS_TO_TICKS(BLE_IDLE_LOCK_TIMEOUT_MS)) == pdTRUE) {
+        ble_lifecycle_poll(&ble_lifecycle, (uint32_t)(esp_timer_get_time() / 1000));
+        xSemaphoreGive(ble_lifecycle_mutex);
+    } else {
+        ESP_LOGW(TAG_BLE, "BLE stack busy, retrying idle shutdown");
+        esp_timer_start_once(ble_idle_timer, (uint64_t)BLE_IDLE_RETRY_MS * 1000);
+    }
 
-        uint8_t field_type = payload[index + 1];
+    ble_idle_task_handle = NULL;
+    vTaskDelete(NULL);
+}
 
-        if (field_type == 0xFF && field_length >= 3) {
-            *company_id = payload[index + 2] | (payload[index + 3] << 8);
-            return true;
-        }
+static void ble_idle_timer_callback(void *arg) {
+    if (ble_idle_task_handle != NULL) {
+        return;
+    }
+    if (xTaskCreate(ble_idle_task, "ble_idle", 3072, NULL, 5, &ble_idle_task_handle) != pdPASS) {
+        ESP_LOGW(TAG_BLE, "Failed to create BLE idle task, retrying");
+        ble_idle_task_handle = NULL;
+        esp_timer_start_once(ble_idle_timer, (uint64_t)BLE_IDLE_RETRY_MS * 1000);
+    }
+}
 
-        index += field_length + 1;
+static bool ble_lifecycle_setup(void) {
+    if (ble_lifecycle_mutex != NULL) {
+        return true;
     }
 
-    return false;
+    static const ble_lifecycle_ops_t ops = { .start = ble_stack_start, .stop = ble_stack_stop };
+    ble_lifecycle_init(&ble_lifecycle, &ops, BLE_STACK_DEFAULT_IDLE_MS);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = ble_idle_timer_callback,
+        .name = "ble_idle",
+    };
+    ble_sync_sem = xSemaphoreCreateBinary();
+    ble_lifecycle_mutex = xSemaphoreCreateMutex();
+    if (ble_sync_sem == NULL || ble_lifecycle_mutex == NULL ||
+        esp_timer_create(&timer_args, &ble_idle_timer) != ESP_OK) {
+        ESP_LOGE(TAG_BLE, "Failed to set up BLE stack lifecycle");
+        return false;
+    }
+    return true;
 }
 
-static void parse_device_name(const uint8_t *data, uint8_t data_len, char *name, size_t name_size) {
-    int index = 0;
-
-    while (index < data_len) {
-        uint8_t length = data[index];
-        if (length == 0) {
-            break;
-        }
-        uint8_t type = data[index + 1];
+static esp_err_t ble_stack_acquire(void) {
+    if (!ble_lifecycle_setup()) {
+        return ESP_ERR_NO_MEM;
+    }
 
-        
-        if (type == BLE_HS_ADV_TYPE_COMP_NAME) {
-            int name_len = length - 1;
-            if (name_len > name_size - 1) {
-                name_len = name_size - 1;
-            }
-            strncpy(name, (const char *)&data[index + 2], name_len);
-            name[name_len] = '\0'; 
-            return;
-        }
+    xSemaphoreTake(ble_lifecycle_mutex, portMAX_DELAY);
+    esp_timer_stop(ble_idle_timer);
+    int rc = ble_lifecycle_acquire(&ble_lifecycle);
+    xSemaphoreGive(ble_lifecycle_mutex);
+    return rc == 0 ? ESP_OK : ESP_FAIL;
+}
 
-        index += length + 1; 
+static void ble_stack_release(void) {
+    xSemaphoreTake(ble_lifecycle_mutex, portMAX_DELAY);
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    ble_lifecycle_release(&ble_lifecycle, now_ms);
+    uint32_t remaining_ms = ble_lifecycle_idle_remaining_ms(&ble_lifecycle, now_ms);
+    if (remaining_ms != UINT32_MAX) {
+        esp_timer_start_once(ble_idle_timer, (uint64_t)remaining_ms * 1000);
     }
-
-    
-    strncpy(name, "Unknown", name_size);
+    xSemaphoreGive(ble_lifecycle_mutex);
 }
 
-static void parse_service_uuids(const uint8_t *data, uint8_t data_len, ble_service_uuids_t *uuids) {
-    int index = 0;
+static bool ble_stack_is_on(void) {
+    return ble_lifecycle_mutex != NULL && ble_lifecycle.state == BLE_STACK_ON;
+}
 
-    while (index < data_len) {
-        uint8_t length = data[index];
-        if (length == 0) {
-            break;
-        }
-        uint8_t type = data[index + 1];
+void stop_ble_stack(void) {
+    if (scan_session) {
+        ble_stop();
+    }
+    if (ble_lifecycle_mutex == NULL) {
+        return;
+    }
 
-        // Check for 16-bit UUIDs
-        if ((type == BLE_HS_ADV_TYPE_COMP_UUIDS16 || type == BLE_HS_ADV_TYPE_INCOMP_UUIDS16) && uuids->uuid16_count < MAX_UUID16) {
-            for (int i = 0; i < length - 1; i += 2) {
-                uint16_t uuid16 = data[index + 2 + i] | (data[index + 3 + i] << 8);
-                uuids->uuid16[uuids->uuid16_count++] = uuid16;
-            }
-        }
+    xSemaphoreTake(ble_lifecycle_mutex, portMAX_DELAY);
+    esp_timer_stop(ble_idle_timer);
+    ble_lifecycle_shutdown(&ble_lifecycle);
+    xSemaphoreGive(ble_lifecycle_mutex);
+}
 
-        // Check for 32-bit UUIDs
-        else if ((type == BLE_HS_ADV_TYPE_COMP_UUIDS32 || type == BLE_HS_ADV_TYPE_INCOMP_UUIDS32) && uuids->uuid32_count < MAX_UUID32) {
-            for (int i = 0; i < length - 1; i += 4) {
-                uint32_t uuid32 = data[index + 2 + i] | (data[index + 3 + i] << 8) | (data[index + 4 + i] << 16) | (data[index + 5 + i] << 24);
-                uuids->uuid32[uuids->uuid32_count++] = uuid32;
+static int ble_gap_event_general(struct ble_gap_event *event, void *arg) {
+    switch (event->type) {
+        case BLE_GAP_EVENT_DISC: {
+            if (handler_count == 0) {
+                break;
             }
-        }
 
-        // Check for 128-bit UUIDs
-        else if ((type == BLE_HS_ADV_TYPE_COMP_UUIDS128 || type == BLE_HS_ADV_TYPE_INCOMP_UUIDS128) && uuids->uuid128_count < MAX_UUID128) {
-            snprintf(uuids->uuid128[uuids->uuid128_count], sizeof(uuids->uuid128[uuids->uuid128_count]),
-                     "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-                     data[index + 17], data[index + 16], data[index + 15], data[index + 14],
-                     data[index + 13], data[index + 12], data[index + 11], data[index + 10],
-                     data[index + 9], data[index + 8], data[index + 7], data[index + 6],
-                     data[index + 5], data[index + 4], data[index + 3], data[index + 2]);
-            uuids->uuid128_count++;
-        }
-
-        index += length + 1;
-    }
-}
+            // Decode once, every handler works from the same struct
+            ble_adv_t adv;
+            ble_adv_parse(event->disc.data, event->disc.length_data, &adv);
 
+            uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+            if (now_ms - last_expire_ms >= 1000) {
+                ble_device_table_expire(&device_table, now_ms, BLE_DEVICE_EXPIRE_MS);
+                last_expire_ms = now_ms;
+            }
 
-static int ble_gap_event_general(struct ble_gap_event *event, void *arg) {
-    switch (event->type) {
-        case BLE_GAP_EVENT_DISC:
-            notify_handlers(event, event->disc.length_data);
+            // Duplicate filtering is done here instead of in the controller, so
+            // handlers only hear about new devices and payload changes unless
+            // they asked for every advertisement
+            ble_device_event_t device_event;
+            ble_device_table_update(&device_table, event->disc.addr.type, event->disc.addr.val,
+                                    event->disc.rssi, event->disc.event_type == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP,
+                                    &adv, now_ms, &device_event);
 
+            notify_handlers(event, &adv, device_event != BLE_DEVICE_SEEN);
             break;
+        }
 
         default:
             break;
@@ -201,7 +242,16 @@ static int ble_gap_event_general(struct ble_gap_event *event, void *arg) {
 }
 
 
-void ble_findtheflippers_callback(struct ble_gap_event *event, size_t len) {
+static const struct {
+    uint16_t uuid;
+    const char *color;
+} flipper_service_uuids[] = {
+    { 0x3082, "White" },
+    { 0x3081, "Black" },
+    { 0x3083, "Transparent" },
+};
+
+void ble_findtheflippers_callback(struct ble_gap_event *event, const ble_adv_t *adv) {
     int advertisementRssi = event->disc.rssi;
 
 
@@ -210,72 +260,18 @@ void ble_findtheflippers_callback(struct ble_gap_event *event, size_t len) {
              event->disc.addr.val[0], event->disc.addr.val[1], event->disc.addr.val[2],
              event->disc.addr.val[3], event->disc.addr.val[4], event->disc.addr.val[5]);
 
+    const char *advertisementName = adv->name[0] != '\0' ? adv->name : "Unknown";
 
-    char advertisementName[32];
-    parse_device_name(event->disc.data, event->disc.length_data, advertisementName, sizeof(advertisementName));
-
-
-    ble_service_uuids_t uuids = {0};
-    parse_service_uuids(event->disc.data, event->disc.length_data, &uuids);
-
-    for (int i = 0; i < uuids.uuid16_count; i++) {
-        if (uuids.uuid16[i] == 0x3082) {
-            printf("Found White Flipper Device: MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            TERMINAL_VIEW_ADD_TEXT("Found White Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 165, 0, true);
-        }
-        if (uuids.uuid16[i] == 0x3081) {
-            printf("Found Black Flipper Device: MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            TERMINAL_VIEW_ADD_TEXT("Found Black Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 165, 0, true);
-        }
-        if (uuids.uuid16[i] == 0x3083) {
-            printf("Found Transparent Flipper Device: MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            TERMINAL_VIEW_ADD_TEXT("Found Transparent Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 165, 0, true);
-        }
-    }
-
-
-    for (int i = 0; i < uuids.uuid32_count; i++) {
-        if (uuids.uuid32[i] == 0x3082) {
-            printf("Found White Flipper Device (32-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            TERMINAL_VIEW_ADD_TEXT("Found White Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 165, 0, true);
-        }
-        if (uuids.uuid32[i] == 0x3081) {
-            printf("Found Black Flipper Device (32-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            TERMINAL_VIEW_ADD_TEXT("Found Black Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 165, 0, true);
-        }
-        if (uuids.uuid32[i] == 0x3083) {
-            printf("Found Transparent Flipper Device (32-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            TERMINAL_VIEW_ADD_TEXT("Found Transparent Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 165, 0, true);
-        }
-    }
-
-    
-    for (int i = 0; i < uuids.uuid128_count; i++) {
-        if (strstr(uuids.uuid128[i], "3082") != NULL) {
-            printf("Found White Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            TERMINAL_VIEW_ADD_TEXT("Found White Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 165, 0, true);
-        }
-        if (strstr(uuids.uuid128[i], "3081") != NULL) {
-            printf("Found Black Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            TERMINAL_VIEW_ADD_TEXT("Found Black Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 165, 0, true);
-        }
-        if (strstr(uuids.uuid128[i], "3083") != NULL) {
-            printf("Found Transparent Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            TERMINAL_VIEW_ADD_TEXT("Found Transparent Flipper Device (128-bit UUID): MAC: %s, Name: %s, RSSI: %d\n", advertisementMac, advertisementName, advertisementRssi);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 165, 0, true);
+    for (size_t i = 0; i < sizeof(flipper_service_uuids) / sizeof(flipper_service_uuids[0]); i++) {
+        if (ble_adv_has_service(adv, flipper_service_uuids[i].uuid)) {
+            printf("Found %s Flipper Device: MAC: %s, Name: %s, RSSI: %d\n", flipper_service_uuids[i].color, advertisementMac, advertisementName, advertisementRssi);
+            TERMINAL_VIEW_ADD_TEXT("Found %s Flipper Device: MAC: %s, Name: %s, RSSI: %d\n", flipper_service_uuids[i].color, advertisementMac, advertisementName, advertisementRssi);
+            rgb_manager_post_event(255, 165, 0, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_LOW);
         }
     }
 }
 
-void ble_print_raw_packet_callback(struct ble_gap_event *event, size_t len) {
+void ble_print_raw_packet_callback(struct ble_gap_event *event, const ble_adv_t *adv) {
     
     int advertisementRssi = event->disc.rssi;
 
@@ -288,72 +284,48 @@ void ble_print_raw_packet_callback(struct ble_gap_event *event, size_t len) {
     
     printf("Received BLE Advertisement from MAC: %s, RSSI: %d\n", advertisementMac, advertisementRssi);
 
+    if (adv->has_mfg) {
+        printf("Manufacturer: %s (0x%04X)\n", ble_company_label(adv->company_id), adv->company_id);
+    }
+
     
-    printf("Raw Advertisement Data (len=%zu): ", event->disc.length_data);
+    printf("Raw Advertisement Data (len=%u): ", (unsigned)event->disc.length_data);
     for (size_t i = 0; i < event->disc.length_data; i++) {
         printf("%02x ", event->disc.data[i]);
     }
     printf("\n");
 }
 
-void detect_ble_spam_callback(struct ble_gap_event *event, size_t length) {
-    if (length < 4) {
-        return;
-    }
-
-    TickType_t current_time = xTaskGetTickCount();
-    TickType_t time_elapsed = current_time - last_detection_time;
-
-
-    uint16_t current_company_id;
-    if (!extract_company_id(event->disc.data, length, &current_company_id)) {
-        return; 
-    }
-
-    if (time_elapsed > pdMS_TO_TICKS(TIME_WINDOW_MS)) {
-        spam_counter = 0;
-    }
-
-    if (last_company_id != NULL && *last_company_id == current_company_id) {
-        spam_counter++;
-        
-        if (spam_counter > MAX_PAYLOADS) {
-            ESP_LOGW(TAG_BLE, "BLE Spam detected! Company ID: 0x%04X", current_company_id);
-            rgb_manager_set_color(&rgb_manager, 0, 255, 0, 0, true);
-            spam_counter = 0;
-        }
-    } else {
-        if (last_company_id == NULL) {
-            last_company_id = (uint16_t *)malloc(sizeof(uint16_t));
-        }
-
-        if (last_company_id != NULL) {
-            *last_company_id = current_company_id;
-            spam_counter = 1;               
-        }
+void detect_ble_spam_callback(struct ble_gap_event *event, const ble_adv_t *adv) {
+    ble_spam_report_t reports[BLE_SPAM_MAX_REPORTS];
+    size_t count = ble_spam_detector_update(&spam_detector, event->disc.addr.val, adv,
+                                            (uint32_t)(esp_timer_get_time() / 1000), reports);
+
+    for (size_t i = 0; i < count; i++) {
+        const ble_spam_report_t *r = &reports[i];
+        alert_manager_post(r->intensity == BLE_SPAM_INTENSITY_LOW ? ALERT_SEVERITY_WARNING : ALERT_SEVERITY_CRITICAL,
+            "BLE_SPAM",
+            "%s spam, %s intensity: %lu new addresses/s (%s 0x%04X%s%s), %lu adverts in window",
+            ble_spam_type_name(r->type), ble_spam_intensity_name(r->intensity),
+            (unsigned long)r->rate_per_sec, r->has_company ? "company" : "UUID", r->company_id,
+            r->has_company ? " " : "", r->has_company ? ble_company_label(r->company_id) : "",
+            (unsigned long)r->adverts);
     }
-
-    last_detection_time = current_time;
 }
 
 
-void airtag_scanner_callback(struct ble_gap_event *event, size_t len) {
+void airtag_scanner_callback(struct ble_gap_event *event, const ble_adv_t *adv) {
     if (event->type == BLE_GAP_EVENT_DISC) {
-        if (!event->disc.data || event->disc.length_data < 4) {
+        if (!adv->has_mfg || adv->company_id != 0x004C) {
             return; 
         }
 
-        const uint8_t *payload = event->disc.data;
-        size_t payloadLength = event->disc.length_data;
+        const uint8_t *payload = adv->raw;
+        size_t payloadLength = adv->raw_len;
 
-        bool patternFound = false;
-        for (size_t i = 0; i <= payloadLength - 4; i++) {
-            if ((payload[i] == 0x1E && payload[i + 1] == 0xFF && payload[i + 2] == 0x4C && payload[i + 3] == 0x00) ||
-                (payload[i] == 0x4C && payload[i + 1] == 0x00 && payload[i + 2] == 0x12 && payload[i + 3] == 0x19)) {
-                patternFound = true;
-                break;
-            }
-        }
+        // Apple manufacturer data of a full 30 byte field, or a Find My (0x12, length 0x19) frame
+        bool patternFound = adv->mfg_len == 27 ||
+                            (adv->mfg_len >= 2 && adv->mfg_data[0] == 0x12 && adv->mfg_data[1] == 0x19);
 
         if (patternFound) {
             char macAddress[18];
@@ -363,49 +335,158 @@ void airtag_scanner_callback(struct ble_gap_event *event, size_t len) {
 
             int rssi = event->disc.rssi;
 
+            // The payload as one line, not a log line per byte; a legacy advert is at most 31 bytes
+            char payloadHex[3 * BLE_HS_ADV_MAX_SZ + 1] = "";
+            size_t hexLen = 0;
+            for (size_t i = 0; i < payloadLength && hexLen + 3 < sizeof(payloadHex); i++) {
+                hexLen += snprintf(payloadHex + hexLen, sizeof(payloadHex) - hexLen, "%02X ", payload[i]);
+            }
+
             printf("AirTag found!\n");
             printf("Tag: %d\n", airTagCount);
             printf("MAC Address: %s\n", macAddress);
             printf("RSSI: %d dBm\n", rssi);
-
-            printf("Payload Data: ");
-            for (size_t i = 0; i < payloadLength; i++) {
-                printf("%02X ", payload[i]);
-            }
-            printf("\n\n");
+            printf("Payload Data: %s\n\n", payloadHex);
 
             TERMINAL_VIEW_ADD_TEXT("AirTag found!\n");
             TERMINAL_VIEW_ADD_TEXT("Tag: %d\n", airTagCount);
             TERMINAL_VIEW_ADD_TEXT("MAC Address: %s\n", macAddress);
             TERMINAL_VIEW_ADD_TEXT("RSSI: %d dBm\n", rssi);
+            TERMINAL_VIEW_ADD_TEXT("Payload Data: %s\n", payloadHex);
 
-            TERMINAL_VIEW_ADD_TEXT("Payload Data: ");
-            for (size_t i = 0; i < payloadLength; i++) {
-                TERMINAL_VIEW_ADD_TEXT("%02X ", payload[i]);
-            }
-            TERMINAL_VIEW_ADD_TEXT("\n\n");
+            rgb_manager_post_event(255, 255, 255, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_LOW);
         }
     }
 }
 
-void ble_start_scanning(void) {
+void tracker_detector_callback(struct ble_gap_event *event, const ble_adv_t *adv) {
+    tracker_sighting_t sighting;
+    if (!tracker_parse(adv, event->disc.addr.val, &sighting)) {
+        return;
+    }
+
+    bool is_new;
+    bool alerted;
+    tracker_alert_t alert;
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    const tracker_entry_t *t = tracker_detector_update(&tracker_detector, &sighting, event->disc.addr.val,
+                                                       event->disc.rssi, now_ms, &is_new, &alerted, &alert);
+
+    if (is_new) {
+        printf("%s tracker nearby: %02x:%02x:%02x:%02x:%02x:%02x, RSSI: %d\n", tracker_type_name(t->type),
+               t->addr[5], t->addr[4], t->addr[3], t->addr[2], t->addr[1], t->addr[0], t->rssi);
+        TERMINAL_VIEW_ADD_TEXT("%s tracker nearby, RSSI: %d\n", tracker_type_name(t->type), t->rssi);
+    }
+
+    if (alerted) {
+        alert_manager_post(ALERT_SEVERITY_CRITICAL, "TRACKER",
+            "%s tracker nearby for %lu min: %02x:%02x:%02x:%02x:%02x:%02x, RSSI %d (max %d), %u ID rotations, %lu sightings",
+            tracker_type_name(t->type), (unsigned long)(alert.dwell_ms / 60000),
+            t->addr[5], t->addr[4], t->addr[3], t->addr[2], t->addr[1], t->addr[0],
+            t->rssi, t->rssi_max, t->rotations, (unsigned long)t->sightings);
+    }
+}
+
+void ble_pcap_callback(struct ble_gap_event *event, const ble_adv_t *adv) {
+    uint8_t frame[BLE_PCAP_MAX_FRAME];
+    bool random_addr = event->disc.addr.type != BLE_ADDR_PUBLIC && event->disc.addr.type != BLE_ADDR_PUBLIC_ID;
+
+    // Scan reports carry no channel, the pseudo header marks it as unknown
+    size_t len = ble_pcap_build_adv(frame, sizeof(frame), event->disc.event_type, random_addr,
+                                    event->disc.addr.val, event->disc.direct_addr.val,
+                                    event->disc.data, event->disc.length_data,
+                                    event->disc.rssi, BLE_PCAP_CHANNEL_UNKNOWN);
+    if (len == 0) {
+        return;
+    }
+
+    esp_err_t ret = pcap_write_packet_to_buffer(frame, len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG_BLE, "Failed to write BLE advertisement to PCAP buffer.");
+    }
+}
+
+static int ble_start_discovery(void) {
     struct ble_gap_disc_params disc_params = {0};
     disc_params.itvl = BLE_HCI_SCAN_ITVL_DEF;
     disc_params.window = BLE_HCI_SCAN_WINDOW_DEF;
-    disc_params.filter_duplicates = 1;
+    disc_params.filter_duplicates = 0;
 
-    // Start a new BLE scan
     int rc = ble_gap_disc(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER, &disc_params, ble_gap_event_general, NULL);
-    if (rc != 0) {
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
         ESP_LOGE(TAG_BLE, "Error starting BLE scan; rc=%d", rc);
+    }
+    return rc;
+}
+
+// No scan is running any more: drop its reference so the stack can go idle
+static void ble_end_scan_session(void) {
+    scan_session = false;
+    ble_stack_release();
+}
+
+void ble_start_scanning(void) {
+    if (!scan_session) {
+        if (ble_stack_acquire() != ESP_OK) {
+            printf("Error: failed to start the BLE stack\n");
+            TERMINAL_VIEW_ADD_TEXT("Failed to start the BLE stack\n");
+            return;
+        }
+        scan_session = true;
+    }
+
+    if (device_table.devices != NULL && device_table.capacity != device_capacity) {
+        // Resized with blescan -n since the last scan
+        ble_device_table_free(&device_table);
+    }
+
+    if (device_table.devices == NULL) {
+        if (!ble_device_table_init(&device_table, device_capacity)) {
+            ESP_LOGE(TAG_BLE, "Failed to allocate BLE device table for %lu devices", (unsigned long)device_capacity);
+            ble_end_scan_session();
+            return;
+        }
     } else {
+        ble_device_table_clear(&device_table);
+    }
+    last_expire_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    int rc = ble_start_discovery();
+    if (rc == 0) {
         ESP_LOGI(TAG_BLE, "Scanning started...");
-        TERMINAL_VIEW_ADD_TEXT("Scanning started...");
+    } else if (rc != BLE_HS_EALREADY) {
+        ble_end_scan_session();
     }
 }
 
+uint32_t ble_set_device_capacity(uint32_t max_devices) {
+    device_capacity = ble_device_table_capacity_for(max_devices);
+    return device_capacity;
+}
 
-esp_err_t ble_register_handler(ble_data_handler_t handler) {
+esp_err_t ble_pause_scanning(void) {
+    if (!ble_stack_is_on()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int rc = ble_gap_disc_cancel();
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        ESP_LOGE(TAG_BLE, "Failed to pause BLE scan; rc=%d", rc);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ble_resume_scanning(void) {
+    if (!scan_session || device_table.devices == NULL) {
+        ESP_LOGE(TAG_BLE, "BLE scan was never started");
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ble_start_discovery() == 0 ? ESP_OK : ESP_FAIL;
+}
+
+
+esp_err_t ble_register_handler_flags(ble_data_handler_t handler, uint32_t flags) {
     if (handler_count < MAX_HANDLERS) {
         ble_handler_t *new_handlers = realloc(handlers, (handler_count + 1) * sizeof(ble_handler_t));
         if (!new_handlers) {
@@ -415,6 +496,7 @@ esp_err_t ble_register_handler(ble_data_handler_t handler) {
 
         handlers = new_handlers;
         handlers[handler_count].handler = handler;
+        handlers[handler_count].flags = flags;
         handler_count++;
         return ESP_OK;
     }
@@ -422,6 +504,10 @@ esp_err_t ble_register_handler(ble_data_handler_t handler) {
     return ESP_ERR_NO_MEM;
 }
 
+esp_err_t ble_register_handler(ble_data_handler_t handler) {
+    return ble_register_handler_flags(handler, 0);
+}
+
 
 esp_err_t ble_unregister_handler(ble_data_handler_t handler) {
     for (int i = 0; i < handler_count; i++) {
@@ -442,17 +528,6 @@ esp_err_t ble_unregister_handler(ble_data_handler_t handler) {
     return ESP_ERR_NOT_FOUND;
 }
 
-void ble_init(void) {
-#ifndef CONFIG_IDF_TARGET_ESP32S2
-    nvs_flash_init();
-    nimble_port_init();
-
-    nimble_port_freertos_init(nimble_host_task);
-
-    ESP_LOGI(TAG_BLE, "BLE initialized");
-#endif
-}
-
 void ble_start_find_flippers(void)
 {
     ble_register_handler(ble_findtheflippers_callback);
@@ -460,30 +535,96 @@ void ble_start_find_flippers(void)
 }
 
 void ble_stop(void) {
-    if (last_company_id != NULL) {
-        free(last_company_id);
-        last_company_id = NULL;
-    }
     rgb_manager_set_color(&rgb_manager, 0, 0, 0, 0, false);
     ble_unregister_handler(ble_findtheflippers_callback);
     ble_unregister_handler(airtag_scanner_callback);
     ble_unregister_handler(ble_print_raw_packet_callback);
     ble_unregister_handler(detect_ble_spam_callback);
+    ble_unregister_handler(tracker_detector_callback);
+    ble_unregister_handler(ble_pcap_callback);
+
+    if (!scan_session) {
+        ESP_LOGW(TAG_BLE, "BLE scanning was not active.");
+        return;
+    }
+
     int rc = ble_gap_disc_cancel();
 
     if (rc == 0) {
         ESP_LOGI(TAG_BLE, "BLE scanning stopped successfully.");
-        TERMINAL_VIEW_ADD_TEXT("BLE scanning stopped successfully.");
     } else if (rc == BLE_HS_EALREADY) {
         ESP_LOGW(TAG_BLE, "BLE scanning was not active.");
     } else {
         ESP_LOGE(TAG_BLE, "Failed to stop BLE scanning; rc=%d", rc);
     }
+
+    // The stack goes down once it has been idle for a while
+    ble_end_scan_session();
+}
+
+void ble_list_devices(void) {
+    if (device_table.devices == NULL || device_table.count == 0) {
+        printf("No BLE devices found.\n");
+        TERMINAL_VIEW_ADD_TEXT("No BLE devices found.\n");
+        return;
+    }
+
+    uint32_t *order = malloc(device_table.capacity * sizeof(uint32_t));
+    if (order == NULL) {
+        ESP_LOGE(TAG_BLE, "Failed to allocate memory for device list");
+        return;
+    }
+
+    size_t count = ble_device_table_sort(&device_table, order, device_table.capacity);
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    printf("%lu BLE devices (%lu adverts, %lu evicted, %lu expired):\n",
+           (unsigned long)count, (unsigned long)device_table.adverts_seen,
+           (unsigned long)device_table.evictions, (unsigned long)device_table.expired);
+    printf("Address            Type  Adverts  Changes  RSSI last/min/avg/max  Company                     Seen      Name\n");
+
+    for (size_t i = 0; i < count; i++) {
+        const ble_device_t *d = &device_table.devices[order[i]];
+
+        char company[28] = "-";
+        if (d->has_mfg) {
+            snprintf(company, sizeof(company), "0x%04X %s", d->company_id, ble_company_label(d->company_id));
+        }
+
+        // NimBLE stores addresses little endian
+        printf("%02X:%02X:%02X:%02X:%02X:%02X  %-4u  %-7lu  %-7u  %4d/%4d/%4d/%4d    %-26s  %-6lus   %s\n",
+               d->addr[5], d->addr[4], d->addr[3], d->addr[2], d->addr[1], d->addr[0],
+               d->addr_type, (unsigned long)d->adv_count, d->payload_changes,
+               d->rssi, d->rssi_min, d->rssi_avg_q4 / 16, d->rssi_max, company,
+               (unsigned long)((now_ms - d->last_seen_ms) / 1000), d->name[0] ? d->name : "-");
+
+        TERMINAL_VIEW_ADD_TEXT("%02X:%02X:%02X:%02X:%02X:%02X %d dBm %s %s\n",
+                               d->addr[5], d->addr[4], d->addr[3], d->addr[2], d->addr[1], d->addr[0],
+                               d->rssi, d->has_mfg ? ble_company_label(d->company_id) : "",
+                               d->name[0] ? d->name : "");
+    }
+
+    free(order);
 }
 
 void ble_start_blespam_detector(void)
 {
-    ble_register_handler(detect_ble_spam_callback);
+    ble_spam_detector_init(&spam_detector, BLE_SPAM_DEFAULT_WINDOW_MS, BLE_SPAM_DEFAULT_THRESHOLD,
+                           BLE_SPAM_DEFAULT_HOLDOFF_MS);
+    ble_register_handler_flags(detect_ble_spam_callback, BLE_HANDLER_ALL_ADVERTS);
+    ble_start_scanning();
+}
+
+void ble_start_tracker_detector(uint32_t dwell_minutes)
+{
+    tracker_detector_init(&tracker_detector, dwell_minutes * 60000);
+    ble_register_handler_flags(tracker_detector_callback, BLE_HANDLER_ALL_ADVERTS);
+    ble_start_scanning();
+}
+
+void ble_start_pcap_capture(void)
+{
+    ble_register_handler_flags(ble_pcap_callback, BLE_HANDLER_ALL_ADVERTS);
     ble_start_scanning();
 }
 
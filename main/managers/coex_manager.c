@@ -0,0 +1,210 @@
+#include "managers/coex_manager.h"
+
+#ifndef CONFIG_IDF_TARGET_ESP32S2
+
+#include "managers/ble_manager.h"
+#include "managers/wifi_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <stdio.h>
+#if CONFIG_ESP_COEX_SW_COEXIST_ENABLE
+#include "esp_coexist.h"
+#endif
+
+// Include Outside so we have access to the Terminal View Macro
+#include "managers/views/terminal_screen.h"
+
+static const char *TAG = "COEX_MANAGER";
+
+static coex_scheduler_t scheduler;
+static portMUX_TYPE scheduler_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t coex_task_handle = NULL;
+static volatile bool coex_running = false;
+static volatile uint32_t wifi_frames = 0;
+static volatile uint32_t ble_adverts = 0;
+
+static uint32_t now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void coex_wifi_callback(void *buf, wifi_promiscuous_pkt_type_t type) {
+    wifi_frames++;
+    wifi_stations_sniffer_callback(buf, type);
+}
+
+static void coex_ble_callback(struct ble_gap_event *event, const ble_adv_t *adv) {
+    ble_adverts++;
+}
+
+static void coex_apply(coex_radio_t radio) {
+    // Turn the old owner off first so the two never overlap
+    if (radio != COEX_RADIO_WIFI) {
+        esp_wifi_set_promiscuous(false);
+    }
+    if (radio != COEX_RADIO_BLE) {
+        ble_pause_scanning();
+    }
+
+#if CONFIG_ESP_COEX_SW_COEXIST_ENABLE
+    // Keep the arbiter from handing the slot owner's air time to the other stack
+    esp_coex_preference_set(radio == COEX_RADIO_WIFI ? ESP_COEX_PREFER_WIFI :
+                            radio == COEX_RADIO_BLE ? ESP_COEX_PREFER_BT : ESP_COEX_PREFER_BALANCE);
+#endif
+
+    if (radio == COEX_RADIO_WIFI) {
+        esp_wifi_set_promiscuous(true);
+    } else if (radio == COEX_RADIO_BLE) {
+        ble_resume_scanning();
+    }
+}
+
+static void coex_task(void *pvParameter) {
+    coex_radio_t active = COEX_RADIO_COUNT;
+
+    while (coex_running) {
+        taskENTER_CRITICAL(&scheduler_lock);
+        coex_radio_t radio = coex_scheduler_next(&scheduler, now_ms());
+        taskEXIT_CRITICAL(&scheduler_lock);
+
+        if (radio != active) {
+            int64_t start_us = esp_timer_get_time();
+            coex_apply(radio);
+            uint32_t cost_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+            taskENTER_CRITICAL(&scheduler_lock);
+            coex_scheduler_add_switch_cost(&scheduler, radio, cost_us);
+            taskEXIT_CRITICAL(&scheduler_lock);
+            active = radio;
+        }
+
+        // coex_manager_stop wakes us early
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(scheduler.slot_ms));
+    }
+
+    esp_wifi_set_promiscuous(false);
+    ble_unregister_handler(coex_ble_callback);
+    ble_stop();
+#if CONFIG_ESP_COEX_SW_COEXIST_ENABLE
+    esp_coex_preference_set(ESP_COEX_PREFER_BALANCE);
+#endif
+
+    ESP_LOGI(TAG, "Coexistence mode stopped.");
+
+    coex_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t coex_manager_start(uint32_t slot_ms, uint8_t wifi_pct, uint8_t ble_pct) {
+    if (coex_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!coex_scheduler_init(&scheduler, slot_ms, wifi_pct, ble_pct)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    wifi_frames = 0;
+    ble_adverts = 0;
+
+    // Arm both captures once, then only toggle them per slot
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_NULL));
+    ESP_ERROR_CHECK(esp_wifi_set_promiscuous_rx_cb(coex_wifi_callback));
+    ESP_ERROR_CHECK(esp_wifi_set_promiscuous(false));
+
+    ble_register_handler_flags(coex_ble_callback, BLE_HANDLER_ALL_ADVERTS);
+    ble_start_scanning();
+    if (ble_pause_scanning() != ESP_OK) {
+        // The scan may have come up and taken a stack reference: release it
+        ESP_LOGE(TAG, "Failed to start BLE scanning");
+        ble_unregister_handler(coex_ble_callback);
+        ble_stop();
+        return ESP_FAIL;
+    }
+
+    coex_running = true;
+    if (xTaskCreate(coex_task, "coex_task", 3072, NULL, 5, &coex_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create coexistence task");
+        coex_running = false;
+        ble_unregister_handler(coex_ble_callback);
+        ble_stop();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Coexistence mode started: WiFi %u%%, BLE %u%%, %lu ms slots",
+             wifi_pct, ble_pct, (unsigned long)slot_ms);
+    return ESP_OK;
+}
+
+void coex_manager_stop(void) {
+    if (coex_task_handle == NULL) {
+        return;
+    }
+
+    coex_running = false;
+    xTaskNotifyGive(coex_task_handle);
+}
+
+bool coex_manager_is_running(void) {
+    return coex_task_handle != NULL;
+}
+
+void coex_manager_print_status(void) {
+    if (!scheduler.running) {
+        printf("Coexistence mode has not run.\n");
+        return;
+    }
+
+    coex_radio_stats_t stats[COEX_RADIO_COUNT];
+    uint32_t effective[COEX_RADIO_COUNT];
+    uint32_t now = now_ms();
+
+    taskENTER_CRITICAL(&scheduler_lock);
+    for (int r = 0; r < COEX_RADIO_COUNT; r++) {
+        coex_scheduler_stats(&scheduler, (coex_radio_t)r, now, &stats[r]);
+        effective[r] = coex_scheduler_effective_permille(&scheduler, (coex_radio_t)r, now);
+    }
+    uint32_t elapsed_ms = now - scheduler.start_ms;
+    taskEXIT_CRITICAL(&scheduler_lock);
+
+    printf("Coexistence %s, %lu ms slots, %lu s elapsed%s\n",
+           coex_manager_is_running() ? "running" : "stopped", (unsigned long)scheduler.slot_ms,
+           (unsigned long)(elapsed_ms / 1000),
+#if CONFIG_ESP_COEX_SW_COEXIST_ENABLE
+           ", coexistence preference follows the slot owner"
+#else
+           ""
+#endif
+           );
+    printf("Radio  Target  Effective  Turns   Worst gap  Avg switch  Traffic\n");
+
+    for (int r = 0; r < COEX_RADIO_COUNT; r++) {
+        if (scheduler.weight[r] == 0) {
+            continue;
+        }
+
+        const coex_radio_stats_t *s = &stats[r];
+        char traffic[32] = "-";
+        uint32_t on_s = s->on_ms / 1000;
+        if (r == COEX_RADIO_WIFI) {
+            snprintf(traffic, sizeof(traffic), "%lu frames/s on air", (unsigned long)(on_s ? wifi_frames / on_s : wifi_frames));
+        } else if (r == COEX_RADIO_BLE) {
+            snprintf(traffic, sizeof(traffic), "%lu adverts/s on air", (unsigned long)(on_s ? ble_adverts / on_s : ble_adverts));
+        }
+
+        printf("%-5s  %5u%%  %7lu.%lu%%  %-6lu  %7lu ms  %7lu us  %s\n",
+               coex_radio_name((coex_radio_t)r), scheduler.weight[r],
+               (unsigned long)(effective[r] / 10), (unsigned long)(effective[r] % 10),
+               (unsigned long)s->slots, (unsigned long)s->max_gap_ms,
+               (unsigned long)(s->slots ? s->switch_us / s->slots : 0), traffic);
+
+        TERMINAL_VIEW_ADD_TEXT("%s: %u%% target, %lu.%lu%% effective, worst gap %lu ms\n",
+                               coex_radio_name((coex_radio_t)r), scheduler.weight[r],
+                               (unsigned long)(effective[r] / 10), (unsigned long)(effective[r] % 10),
+                               (unsigned long)s->max_gap_ms);
+    }
+}
+
+#endif
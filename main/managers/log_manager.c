@@ -0,0 +1,120 @@
+#include "managers/log_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "LOG";
+
+static log_ring_t ring;
+static bool ring_ready;
+static TaskHandle_t uart_task_handle;
+
+static uint32_t now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void wake_uart(void) {
+    TaskHandle_t task = uart_task_handle;
+    if (task != NULL && task != xTaskGetCurrentTaskHandle()) {
+        xTaskNotifyGive(task);
+    }
+}
+
+// Installed with esp_log_set_vprintf, so it runs on the logging task's stack
+static int log_vprintf(const char *fmt, va_list args) {
+    char line[LOG_LINE_MAX];
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    if (len < 0) {
+        return len;
+    }
+
+    size_t n = (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1;
+    uint8_t level = log_ring_clean_line(line, &n);
+    if (n > 0) {
+        log_ring_write(&ring, level, 0, now_ms(), line, n);
+        wake_uart();
+    }
+    return len;
+}
+
+void log_manager_write(uint8_t level, uint8_t flags, const char *text) {
+    size_t len = strlen(text);
+    while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r')) {
+        len--;
+    }
+
+    if (!ring_ready) {
+        if (!(flags & LOG_RING_NO_UART)) {
+            printf("%.*s\n", (int)len, text);
+        }
+        return;
+    }
+    if (len > 0) {
+        log_ring_write(&ring, level, flags, now_ms(), text, len);
+        wake_uart();
+    }
+}
+
+void log_manager_cursor(log_cursor_t *cursor, bool history) {
+    log_ring_cursor_init(&ring, cursor, history);
+}
+
+void log_manager_cursor_from(log_cursor_t *cursor, uint32_t seq) {
+    log_ring_cursor_from(&ring, cursor, seq);
+}
+
+bool log_manager_read(log_cursor_t *cursor, log_entry_t *out) {
+    return ring_ready && log_ring_read(&ring, cursor, out);
+}
+
+// The console is one consumer like any other: a burst of logging fills the
+// ring instead of stalling whoever logged it on the UART
+static void log_uart_task(void *pvParameter) {
+    log_cursor_t cursor;
+    log_entry_t entry;
+    uint32_t reported = 0;
+
+    log_ring_cursor_init(&ring, &cursor, true);
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (log_ring_read(&ring, &cursor, &entry)) {
+            if (cursor.missed != reported) {
+                printf("[log] %lu lines missed\n", (unsigned long)(cursor.missed - reported));
+                reported = cursor.missed;
+            }
+            if (entry.flags & LOG_RING_NO_UART) {
+                continue;
+            }
+            if (entry.level == LOG_RING_ERROR) {
+                printf(LOG_COLOR_E "%s" LOG_RESET_COLOR "\n", entry.text);
+            } else if (entry.level == LOG_RING_WARN) {
+                printf(LOG_COLOR_W "%s" LOG_RESET_COLOR "\n", entry.text);
+            } else {
+                printf("%s\n", entry.text);
+            }
+        }
+    }
+}
+
+esp_err_t log_manager_init(void) {
+    if (ring_ready) {
+        return ESP_OK;
+    }
+
+    log_ring_init(&ring);
+    ring_ready = true;
+
+    if (xTaskCreate(log_uart_task, "LogUART", LOG_UART_TASK_STACK, NULL, 4, &uart_task_handle) != pdPASS) {
+        // Without a console consumer everything keeps printing directly
+        ring_ready = false;
+        ESP_LOGE(TAG, "Failed to create the console log task");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_log_set_vprintf(log_vprintf);
+    return ESP_OK;
+}
@@ -0,0 +1,313 @@
+#include "managers/log_stream.h"
+#include "managers/log_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <ctype.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_STREAM_BUSY_RETRY_MS 10000   // Suggested to clients turned away while all streams are open
+
+static const char *TAG = "LOG_STREAM";
+
+typedef struct {
+    bool active;
+    int fd;
+    uint32_t generation;         // Bumped each time the slot is taken
+    log_cursor_t cursor;
+    uint32_t reported;           // Missed lines already sent as a missed event
+    int64_t last_send_us;
+} stream_client_t;
+
+// The session ctx handed to httpd. A slot dropped by flush_work can be taken
+// by a new stream before httpd gets round to closing the old session, so the
+// close only frees the slot if it still belongs to that session.
+typedef struct {
+    stream_client_t *client;
+    uint32_t generation;
+} stream_session_t;
+
+// Clients are only touched in the httpd task: the handler, the session close
+// callback and the queued flush all run there
+static stream_client_t clients[LOG_STREAM_CLIENTS];
+static volatile int client_count;
+static uint32_t next_generation;
+
+// Guards server between the poll timer and log_stream_stop
+static SemaphoreHandle_t server_lock;
+static httpd_handle_t server;
+static esp_timer_handle_t poll_timer;
+static volatile bool flush_queued;
+
+// Built in the httpd task only, too big for its stack
+static char chunk[8 + LOG_STREAM_CHUNK + 2];   // Room for the chunk size line and CRLF
+static size_t chunk_len;
+static char event[LOG_STREAM_CHUNK];
+
+static bool send_all(httpd_handle_t hd, int fd, const char *data, size_t len) {
+    while (len > 0) {
+        int sent = httpd_socket_send(hd, fd, data, len, 0);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return true;
+}
+
+// The response was started chunked by the handler, later data keeps the framing
+static bool send_chunk(httpd_handle_t hd, stream_client_t *c) {
+    if (chunk_len == 0) {
+        return true;
+    }
+    char head[10];
+    int n = snprintf(head, sizeof(head), "%x\r\n", (unsigned)chunk_len);
+    char *start = chunk + 8 - n;
+    memcpy(start, head, n);
+    memcpy(chunk + 8 + chunk_len, "\r\n", 2);
+
+    bool ok = send_all(hd, c->fd, start, n + chunk_len + 2);
+    chunk_len = 0;
+    c->last_send_us = esp_timer_get_time();
+    return ok;
+}
+
+static bool append(httpd_handle_t hd, stream_client_t *c, const char *data, size_t len) {
+    if (chunk_len + len > LOG_STREAM_CHUNK && !send_chunk(hd, c)) {
+        return false;
+    }
+    memcpy(chunk + 8 + chunk_len, data, len);
+    chunk_len += len;
+    return true;
+}
+
+// id is the sequence number, a line break inside the text continues its data
+static size_t format_event(const log_entry_t *entry) {
+    size_t len = (size_t)snprintf(event, sizeof(event), "id: %lu\ndata: ", (unsigned long)entry->seq);
+    for (const char *p = entry->text; *p != '\0' && len + 8 < sizeof(event); p++) {
+        if (*p == '\n') {
+            memcpy(event + len, "\ndata: ", 7);
+            len += 7;
+        } else if (*p != '\r') {
+            event[len++] = *p;
+        }
+    }
+    event[len++] = '\n';
+    event[len++] = '\n';
+    return len;
+}
+
+static bool report_missed(httpd_handle_t hd, stream_client_t *c) {
+    if (c->cursor.missed == c->reported) {
+        return true;
+    }
+    int n = snprintf(event, sizeof(event), "event: missed\ndata: %lu\n\n",
+                     (unsigned long)(c->cursor.missed - c->reported));
+    c->reported = c->cursor.missed;
+    return append(hd, c, event, n);
+}
+
+// Sends at most a ring's worth per call so one busy client cannot hold the
+// server; the rest goes out on the next poll
+static bool flush_client(httpd_handle_t hd, stream_client_t *c) {
+    log_entry_t entry;
+
+    chunk_len = 0;
+    for (int lines = 0; lines < LOG_RING_SLOTS && log_manager_read(&c->cursor, &entry); lines++) {
+        if (!report_missed(hd, c) || !append(hd, c, event, format_event(&entry))) {
+            return false;
+        }
+    }
+    if (!report_missed(hd, c)) {
+        return false;
+    }
+
+    if (chunk_len == 0 && esp_timer_get_time() - c->last_send_us >= LOG_STREAM_KEEPALIVE_MS * 1000LL) {
+        static const char keepalive[] = ": keep-alive\n\n";
+        append(hd, c, keepalive, sizeof(keepalive) - 1);
+    }
+    return send_chunk(hd, c);
+}
+
+static void drop_client(stream_client_t *c) {
+    if (c->active) {
+        c->active = false;
+        client_count--;
+    }
+}
+
+// Session free_ctx, called by httpd when the client goes away
+static void client_closed(void *ctx) {
+    stream_session_t *session = ctx;
+    if (session->client->generation == session->generation) {
+        drop_client(session->client);
+    }
+    free(session);
+}
+
+static void flush_work(void *arg) {
+    httpd_handle_t hd = arg;
+
+    flush_queued = false;
+    for (size_t i = 0; i < LOG_STREAM_CLIENTS; i++) {
+        stream_client_t *c = &clients[i];
+        if (c->active && !flush_client(hd, c)) {
+            ESP_LOGD(TAG, "Dropping stream on socket %d", c->fd);
+            drop_client(c);
+            httpd_sess_trigger_close(hd, c->fd);
+        }
+    }
+}
+
+static void poll_timer_cb(void *arg) {
+    xSemaphoreTake(server_lock, portMAX_DELAY);
+    if (server != NULL && client_count > 0 && !flush_queued) {
+        flush_queued = true;
+        if (httpd_queue_work(server, flush_work, server) != ESP_OK) {
+            flush_queued = false;
+        }
+    }
+    xSemaphoreGive(server_lock);
+}
+
+static bool parse_seq(const char *text, uint32_t *seq) {
+    char *end;
+    if (!isdigit((unsigned char)*text)) {
+        return false;
+    }
+    unsigned long long value = strtoull(text, &end, 10);
+    if (*end != '\0' || value > UINT32_MAX) {
+        return false;
+    }
+    *seq = (uint32_t)value;
+    return true;
+}
+
+// A reconnecting EventSource resumes after Last-Event-ID, which wins over the
+// ?since=N it first connected with
+static void start_cursor(httpd_req_t *req, log_cursor_t *cursor) {
+    char query[64];
+    char value[16];
+    uint32_t seq;
+
+    if (httpd_req_get_hdr_value_str(req, "Last-Event-ID", value, sizeof(value)) == ESP_OK &&
+        parse_seq(value, &seq)) {
+        log_manager_cursor_from(cursor, seq + 1);
+    } else if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+               httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK && parse_seq(value, &seq)) {
+        log_manager_cursor_from(cursor, seq);
+    } else {
+        log_manager_cursor(cursor, true);
+    }
+}
+
+static esp_err_t log_stream_handler(httpd_req_t *req) {
+    stream_client_t *c = NULL;
+    stream_client_t busy = { 0 };
+    stream_session_t *session = NULL;
+    char retry[32];
+
+    for (size_t i = 0; i < LOG_STREAM_CLIENTS && c == NULL; i++) {
+        if (!clients[i].active) {
+            c = &clients[i];
+        }
+    }
+    if (c != NULL) {
+        // Without a session ctx the request is served like a busy one
+        session = malloc(sizeof(*session));
+        if (session == NULL) {
+            c = NULL;
+        }
+    }
+
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    int n = snprintf(retry, sizeof(retry), "retry: %d\n\n", c != NULL ? LOG_STREAM_RETRY_MS : LOG_STREAM_BUSY_RETRY_MS);
+    if (httpd_resp_send_chunk(req, retry, n) != ESP_OK) {
+        free(session);
+        return ESP_FAIL;
+    }
+
+    if (c == NULL) {
+        // Every stream is taken: hand over what is held and end the response
+        busy.fd = httpd_req_to_sockfd(req);
+        start_cursor(req, &busy.cursor);
+        if (!flush_client(req->handle, &busy)) {
+            return ESP_FAIL;
+        }
+        return httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->fd = httpd_req_to_sockfd(req);
+    c->generation = ++next_generation;
+    start_cursor(req, &c->cursor);
+    c->last_send_us = esp_timer_get_time();
+    if (!flush_client(req->handle, c)) {
+        free(session);
+        return ESP_FAIL;
+    }
+
+    // Returning without the final chunk leaves the socket with us; httpd
+    // still watches it and calls client_closed once the browser goes away
+    c->active = true;
+    client_count++;
+    session->client = c;
+    session->generation = c->generation;
+    req->sess_ctx = session;
+    req->free_ctx = client_closed;
+    return ESP_OK;
+}
+
+esp_err_t log_stream_register(httpd_handle_t handle) {
+    if (server_lock == NULL) {
+        server_lock = xSemaphoreCreateMutex();
+        if (server_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (poll_timer == NULL) {
+        const esp_timer_create_args_t args = { .callback = poll_timer_cb, .name = "log_stream" };
+        esp_err_t err = esp_timer_create(&args, &poll_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    httpd_uri_t uri = {
+        .uri      = "/api/logs",
+        .method   = HTTP_GET,
+        .handler  = log_stream_handler,
+        .user_ctx = NULL,
+    };
+    esp_err_t ret = httpd_register_uri_handler(handle, &uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error registering URI /api/logs: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    xSemaphoreTake(server_lock, portMAX_DELAY);
+    server = handle;
+    flush_queued = false;
+    xSemaphoreGive(server_lock);
+
+    if (!esp_timer_is_active(poll_timer)) {
+        esp_timer_start_periodic(poll_timer, LOG_STREAM_POLL_MS * 1000);
+    }
+    return ESP_OK;
+}
+
+void log_stream_stop(void) {
+    if (server_lock == NULL) {
+        return;
+    }
+    esp_timer_stop(poll_timer);
+
+    xSemaphoreTake(server_lock, portMAX_DELAY);
+    server = NULL;
+    xSemaphoreGive(server_lock);
+}
@@ -1,12 +1,17 @@
 #include "managers/rgb_manager.h"
 #include "esp_log.h"
 #include <math.h>
+#include <stdlib.h>
 #include "driver/ledc.h"
 #include "managers/settings_manager.h"
+#include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 static const char* TAG = "RGBManager";
 
+RGBManager_t rgb_manager;
+TaskHandle_t rgb_effect_task_handle;
+
 typedef struct {
     double r;       // ∈ [0, 1]
     double g;       // ∈ [0, 1]
@@ -27,6 +32,13 @@ typedef struct {
 #define LEDC_DUTY_RES       LEDC_TIMER_8_BIT  // 8-bit resolution (0-255)
 #define LEDC_FREQUENCY      10000  // 10 kHz PWM frequency
 
+#define LED_PULSE_STEPS     50     // Per half of a pulse
+#define LED_PULSE_STEP_MS   10
+
+static led_event_queue_t led_events;
+static portMUX_TYPE led_events_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t led_event_task_handle = NULL;
+
 
 void calculate_matrix_dimensions(int total_leds, int *rows, int *cols) {
     int side = (int)sqrt(total_leds);
@@ -178,7 +190,7 @@ esp_err_t rgb_manager_init(RGBManager_t* rgb_manager, gpio_num_t pin, int num_le
         rgb_manager_set_color(rgb_manager, 1, 0, 0, 0, false);
 
         ESP_LOGI(TAG, "RGBManager initialized for separate R/G/B pins: %d, %d, %d", red_pin, green_pin, blue_pin);
-        return ESP_OK;
+        return rgb_manager_start_event_task(rgb_manager);
     } else {
         // Single pin for LED strip
         rgb_manager->is_separate_pins = false;
@@ -209,7 +221,7 @@ esp_err_t rgb_manager_init(RGBManager_t* rgb_manager, gpio_num_t pin, int num_le
         led_strip_clear(rgb_manager->strip);
 
         ESP_LOGI(TAG, "RGBManager initialized for pin %d with %d LEDs", pin, num_leds);
-        return ESP_OK;
+        return rgb_manager_start_event_task(rgb_manager);
     }
 }
 
@@ -286,39 +298,84 @@ void update_led_visualizer(uint8_t *amplitudes, size_t num_bars, bool square_mod
     led_strip_refresh(rgb_manager.strip);
 }
 
-void pulse_once(RGBManager_t* rgb_manager, uint8_t red, uint8_t green, uint8_t blue) {
-    uint8_t brightness = 0;
-    int direction = 1;
+static void led_event_task(void *pvParameter);
 
-    while (brightness <= 255 || brightness > 0) {
-        
-        float brightness_scale = brightness / 255.0;
-        uint8_t adj_red = red * brightness_scale;
-        uint8_t adj_green = green * brightness_scale;
-        uint8_t adj_blue = blue * brightness_scale;
+static esp_err_t rgb_manager_start_event_task(RGBManager_t* rgb_manager) {
+    if (led_event_task_handle != NULL) {
+        return ESP_OK;
+    }
 
-        
-        esp_err_t ret = led_strip_set_pixel(rgb_manager->strip, 0, adj_red, adj_green, adj_blue);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to set LED color");
-            return; 
-        }
+    led_event_queue_init(&led_events);
+    if (xTaskCreate(led_event_task, "led_event_task", 2048, rgb_manager, 2, &led_event_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create LED event task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
 
-        led_strip_refresh(rgb_manager->strip);
-        
-        
-        brightness += direction * 5; 
+esp_err_t rgb_manager_post_event(uint8_t red, uint8_t green, uint8_t blue, led_pattern_t pattern, led_event_priority_t priority) {
+    if (led_event_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-        if (brightness >= 255) {
-            direction = -1;
-        }
+    taskENTER_CRITICAL(&led_events_lock);
+    bool queued = led_event_queue_post(&led_events, red, green, blue, pattern, priority);
+    taskEXIT_CRITICAL(&led_events_lock);
 
-        
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+    if (!queued) {
+        return ESP_FAIL;
+    }
+    xTaskNotifyGive(led_event_task_handle);
+    return ESP_OK;
+}
+
+static bool led_event_next(led_event_t *event) {
+    taskENTER_CRITICAL(&led_events_lock);
+    bool found = led_event_queue_pop(&led_events, event);
+    taskEXIT_CRITICAL(&led_events_lock);
+    return found;
+}
+
+static bool led_event_preempted(const led_event_t *event) {
+    taskENTER_CRITICAL(&led_events_lock);
+    int top = led_event_queue_top_priority(&led_events);
+    taskEXIT_CRITICAL(&led_events_lock);
+    return top > (int)event->priority;
+}
+
+static void led_pulse(RGBManager_t* rgb_manager, const led_event_t *event) {
+    for (int step = -LED_PULSE_STEPS; step <= LED_PULSE_STEPS; step++) {
+        float brightness_scale = (float)(LED_PULSE_STEPS - abs(step)) / LED_PULSE_STEPS;
+        rgb_manager_set_color(rgb_manager, 0, event->red * brightness_scale, event->green * brightness_scale,
+                              event->blue * brightness_scale, false);
+
+        // Waking up early means something new was posted; let an alert cut in
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LED_PULSE_STEP_MS)) > 0 && led_event_preempted(event)) {
+            break;
+        }
     }
+
+    rgb_manager_set_color(rgb_manager, 0, 0, 0, 0, false);
 }
 
+static void led_event_task(void *pvParameter) {
+    RGBManager_t* rgb_manager = (RGBManager_t*) pvParameter;
+    led_event_t event;
 
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (led_event_next(&event)) {
+            if (event.pattern == LED_PATTERN_SOLID) {
+                rgb_manager_set_color(rgb_manager, 0, event.red, event.green, event.blue, false);
+            } else {
+                led_pulse(rgb_manager, &event);
+            }
+        }
+    }
+
+    vTaskDelete(NULL);
+}
 
 esp_err_t rgb_manager_set_color(RGBManager_t* rgb_manager, int led_idx, uint8_t red, uint8_t green, uint8_t blue, bool pulse) {
 #ifdef LED_DATA_PIN
@@ -341,8 +398,7 @@ esp_err_t rgb_manager_set_color(RGBManager_t* rgb_manager, int led_idx, uint8_t
 
 
     if (pulse) {
-        pulse_once(rgb_manager, red, green, blue);
-        return ESP_OK;
+        return rgb_manager_post_event(red, green, blue, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_NORMAL);
     } else {
         scale_grb_by_brightness(&green, &red, &blue, 0.3);
         esp_err_t ret = led_strip_set_pixel(rgb_manager->strip, led_idx, red, green, blue);
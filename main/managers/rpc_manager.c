@@ -0,0 +1,285 @@
+#include "managers/rpc_manager.h"
+#include "managers/wifi_manager.h"
+#include "core/serial_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <esp_log.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <string.h>
+#include "sdkconfig.h"
+
+#define RPC_TOPIC_BIT(topic) (1u << (topic))
+#define RPC_BIT_TOPIC(code, NAME, name, fields) | RPC_TOPIC_BIT(RPC_TOPIC_##NAME)
+#define RPC_ALL_TOPICS (0 RPC_TOPICS(RPC_BIT_TOPIC))
+
+static const char *TAG = "RPC";
+
+// Frames are sent from the serial task and the alert task, the lock keeps
+// them whole and guards everything below
+static SemaphoreHandle_t rpc_lock;
+static rpc_write_fn_t rpc_write;
+static rpc_decoder_t rpc_decoder;
+static uint8_t tx_frame[RPC_MAX_FRAME];
+static uint32_t topics;
+static uint16_t notify_seq;
+static int64_t last_frame_us;
+static int64_t last_stats_us;
+
+static void send_frame_locked(uint8_t kind, uint16_t id, uint8_t code, const rpc_writer_t *payload) {
+    if (rpc_write == NULL) {
+        return;
+    }
+
+    rpc_frame_t frame = {
+        .kind = kind, .id = id, .code = code,
+        .payload = payload ? payload->buf : NULL, .payload_len = payload ? payload->len : 0,
+    };
+    size_t len = rpc_frame_encode(&frame, tx_frame, sizeof(tx_frame));
+    if (len > 0) {
+        rpc_write(tx_frame, len);
+    }
+}
+
+static void respond(uint16_t id, rpc_status_t status, const rpc_writer_t *payload) {
+    xSemaphoreTake(rpc_lock, portMAX_DELAY);
+    if (payload && payload->overflow) {
+        send_frame_locked(RPC_KIND_RESPONSE, id, RPC_STATUS_TOO_LARGE, NULL);
+    } else {
+        send_frame_locked(RPC_KIND_RESPONSE, id, status, payload);
+    }
+    xSemaphoreGive(rpc_lock);
+}
+
+static void notify(rpc_topic_t topic, const rpc_writer_t *payload) {
+    if (payload->overflow) {
+        return;
+    }
+
+    xSemaphoreTake(rpc_lock, portMAX_DELAY);
+    if (topics & RPC_TOPIC_BIT(topic)) {
+        send_frame_locked(RPC_KIND_NOTIFY, notify_seq++, topic, payload);
+    }
+    xSemaphoreGive(rpc_lock);
+}
+
+static void put_stats(rpc_writer_t *w) {
+    rpc_put_u32(w, (uint32_t)(esp_timer_get_time() / 1000));
+    rpc_put_u32(w, esp_get_free_heap_size());
+    rpc_put_u32(w, esp_get_minimum_free_heap_size());
+    rpc_put_u32(w, alert_manager_dropped_count());
+    rpc_put_u32(w, rpc_decoder.frames);
+    rpc_put_u32(w, rpc_decoder.bad_frames + rpc_decoder.overflows);
+}
+
+// Each AP goes out as a notification so a large scan never has to fit one frame
+static uint32_t stream_aps(void) {
+    uint8_t buf[RPC_MAX_PAYLOAD];
+    rpc_writer_t w;
+
+    for (uint16_t i = 0; i < ap_count && scanned_aps != NULL; i++) {
+        const wifi_ap_record_t *ap = &scanned_aps[i];
+        char ssid[sizeof(ap->ssid) + 1];
+        memcpy(ssid, ap->ssid, sizeof(ap->ssid));
+        ssid[sizeof(ap->ssid)] = '\0';
+
+        rpc_writer_init(&w, buf, sizeof(buf));
+        rpc_put_u32(&w, i);
+        rpc_put_bytes(&w, ap->bssid, sizeof(ap->bssid));
+        rpc_put_str(&w, ssid);
+        rpc_put_i32(&w, ap->rssi);
+        rpc_put_u32(&w, ap->primary);
+        rpc_put_u32(&w, ap->authmode);
+        notify(RPC_TOPIC_AP, &w);
+    }
+    return scanned_aps != NULL ? ap_count : 0;
+}
+
+static void handle_request(const rpc_frame_t *frame) {
+    uint8_t buf[RPC_MAX_PAYLOAD];
+    rpc_writer_t out;
+    rpc_reader_t in;
+    rpc_writer_init(&out, buf, sizeof(buf));
+    rpc_reader_init(&in, frame->payload, frame->payload_len);
+
+    switch (frame->code) {
+    case RPC_METHOD_PING: {
+        uint32_t value;
+        if (!rpc_get_u32(&in, &value) || !rpc_reader_done(&in)) {
+            break;
+        }
+        rpc_put_u32(&out, value);
+        respond(frame->id, RPC_STATUS_OK, &out);
+        return;
+    }
+    case RPC_METHOD_INFO:
+        if (!rpc_reader_done(&in)) {
+            break;
+        }
+        rpc_put_str(&out, CONFIG_IDF_TARGET);
+        rpc_put_u32(&out, esp_get_free_heap_size());
+        rpc_put_u32(&out, (uint32_t)(esp_timer_get_time() / 1000));
+        respond(frame->id, RPC_STATUS_OK, &out);
+        return;
+    case RPC_METHOD_RUN: {
+        const char *cmd;
+        size_t len;
+        if (!rpc_get_str(&in, &cmd, &len) || !rpc_reader_done(&in)) {
+            break;
+        }
+        char line[RPC_MAX_PAYLOAD + 1];
+        memcpy(line, cmd, len);
+        line[len] = '\0';
+        // Whatever the command prints goes out as text between frames
+        rpc_put_i32(&out, handle_serial_command(line));
+        respond(frame->id, RPC_STATUS_OK, &out);
+        return;
+    }
+    case RPC_METHOD_SUBSCRIBE: {
+        uint32_t mask;
+        if (!rpc_get_u32(&in, &mask) || !rpc_reader_done(&in)) {
+            break;
+        }
+        xSemaphoreTake(rpc_lock, portMAX_DELAY);
+        topics = mask & RPC_ALL_TOPICS;
+        xSemaphoreGive(rpc_lock);
+        rpc_put_u32(&out, mask & RPC_ALL_TOPICS);
+        respond(frame->id, RPC_STATUS_OK, &out);
+        return;
+    }
+    case RPC_METHOD_AP_LIST:
+        if (!rpc_reader_done(&in)) {
+            break;
+        }
+        rpc_put_u32(&out, stream_aps());
+        respond(frame->id, RPC_STATUS_OK, &out);
+        return;
+    case RPC_METHOD_STATS:
+        if (!rpc_reader_done(&in)) {
+            break;
+        }
+        put_stats(&out);
+        respond(frame->id, RPC_STATUS_OK, &out);
+        return;
+    case RPC_METHOD_EXIT:
+        respond(frame->id, RPC_STATUS_OK, NULL);
+        rpc_manager_close();
+        return;
+    default:
+        respond(frame->id, RPC_STATUS_UNKNOWN_METHOD, NULL);
+        return;
+    }
+
+    respond(frame->id, RPC_STATUS_BAD_ARGS, NULL);
+}
+
+static void on_frame(const rpc_frame_t *frame, void *ctx) {
+    last_frame_us = esp_timer_get_time();
+    if (frame->kind == RPC_KIND_REQUEST) {
+        handle_request(frame);
+    }
+}
+
+esp_err_t rpc_manager_open(rpc_write_fn_t write) {
+    if (rpc_lock == NULL) {
+        rpc_lock = xSemaphoreCreateMutex();
+        if (rpc_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(rpc_lock, portMAX_DELAY);
+    if (rpc_write != NULL) {
+        xSemaphoreGive(rpc_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    rpc_decoder_init(&rpc_decoder, on_frame, NULL);
+    topics = 0;
+    notify_seq = 0;
+    last_frame_us = esp_timer_get_time();
+    last_stats_us = last_frame_us;
+    rpc_write = write;
+    xSemaphoreGive(rpc_lock);
+
+    ESP_LOGI(TAG, "Session opened");
+    return ESP_OK;
+}
+
+void rpc_manager_close(void) {
+    if (rpc_lock == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(rpc_lock, portMAX_DELAY);
+    bool was_open = rpc_write != NULL;
+    rpc_write = NULL;
+    topics = 0;
+    xSemaphoreGive(rpc_lock);
+
+    if (was_open) {
+        ESP_LOGI(TAG, "Session closed after %lu frames (%lu bad)", (unsigned long)rpc_decoder.frames,
+                 (unsigned long)(rpc_decoder.bad_frames + rpc_decoder.overflows));
+    }
+}
+
+bool rpc_manager_is_open(void) {
+    return rpc_write != NULL;
+}
+
+void rpc_manager_feed(const uint8_t *data, size_t len) {
+    rpc_decoder_feed(&rpc_decoder, data, len);
+}
+
+void rpc_manager_poll(void) {
+    if (!rpc_manager_is_open()) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (now - last_frame_us > (int64_t)RPC_IDLE_TIMEOUT_MS * 1000) {
+        ESP_LOGW(TAG, "No frames for %d s, back to the text console", RPC_IDLE_TIMEOUT_MS / 1000);
+        rpc_manager_close();
+        return;
+    }
+
+    if (now - last_stats_us >= (int64_t)RPC_STATS_PERIOD_MS * 1000) {
+        last_stats_us = now;
+        uint8_t buf[64];
+        rpc_writer_t w;
+        rpc_writer_init(&w, buf, sizeof(buf));
+        put_stats(&w);
+        notify(RPC_TOPIC_STATS, &w);
+    }
+}
+
+void rpc_manager_notify_alert(const alert_t *alert) {
+    if (!(topics & RPC_TOPIC_BIT(RPC_TOPIC_ALERT))) {
+        return;
+    }
+
+    uint8_t buf[RPC_MAX_PAYLOAD];
+    rpc_writer_t w;
+    rpc_writer_init(&w, buf, sizeof(buf));
+    rpc_put_u32(&w, alert->severity);
+    rpc_put_str(&w, alert->source);
+    rpc_put_str(&w, alert->message);
+    rpc_put_u32(&w, alert->uptime_ms);
+    notify(RPC_TOPIC_ALERT, &w);
+}
+
+void rpc_manager_notify_job(const job_t *job) {
+    if (!(topics & RPC_TOPIC_BIT(RPC_TOPIC_JOB))) {
+        return;
+    }
+
+    uint8_t buf[96];
+    rpc_writer_t w;
+    rpc_writer_init(&w, buf, sizeof(buf));
+    rpc_put_u32(&w, job->id);
+    rpc_put_str(&w, job->label);
+    rpc_put_str(&w, job_state_name(job->state));
+    rpc_put_i32(&w, job->result);
+    rpc_put_u32(&w, job_runtime_ms(job, job->ended_ms));
+    rpc_put_u32(&w, job->items);
+    notify(RPC_TOPIC_JOB, &w);
+}
@@ -0,0 +1,222 @@
+#include "managers/script_manager.h"
+#include "core/serial_manager.h"
+#include "core/system_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_vfs_fat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define SCRIPT_PATH_MAX 128
+
+static const char *TAG = "SCRIPT";
+
+typedef struct {
+    script_t script;
+    char text[SCRIPT_MAX_SIZE + 1];   // Statements point into this
+    char label[JOB_LABEL_LEN];
+    uint32_t job;
+    uint32_t start_delay_ms;
+} script_run_t;
+
+// Set while a script task exists; the task clears them as it exits
+static script_run_t *current;
+static TaskHandle_t script_task_handle;
+static volatile bool stop_requested;
+
+static void request_stop(void) {
+    stop_requested = true;
+}
+
+static uint32_t commands_run(void) {
+    script_run_t *run = current;
+    return run != NULL ? run->script.commands : 0;
+}
+
+static const job_desc_t script_job = {
+    .resources = JOB_RES_SCRIPT, .stop = request_stop, .progress = commands_run,
+};
+
+static int script_run_command(const char *line, void *ctx) {
+    printf("[script] %s\n", line);
+    return handle_serial_command(line) != ESP_OK;
+}
+
+// Wakes every SCRIPT_POLL_MS so kill takes effect in the middle of a long delay
+static bool script_sleep(uint32_t ms, void *ctx) {
+    do {
+        uint32_t step = ms > SCRIPT_POLL_MS ? SCRIPT_POLL_MS : ms;
+        TickType_t ticks = pdMS_TO_TICKS(step);
+        vTaskDelay(ticks > 0 ? ticks : 1);
+        ms -= step;
+        if (stop_requested) {
+            return false;
+        }
+    } while (ms > 0);
+    return true;
+}
+
+static bool script_free_bytes(uint64_t *out, void *ctx) {
+    uint64_t total;
+    return esp_vfs_fat_info("/mnt", &total, out) == ESP_OK;
+}
+
+static bool script_time_of_day(uint32_t *minutes, void *ctx) {
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    // Without SNTP or an RTC the clock starts in 1970
+    if (tm.tm_year + 1900 < 2024) {
+        return false;
+    }
+    *minutes = (uint32_t)(tm.tm_hour * 60 + tm.tm_min);
+    return true;
+}
+
+static uint64_t script_uptime_ms(void *ctx) {
+    return (uint64_t)(esp_timer_get_time() / 1000);
+}
+
+// The script's own job does not count, waitjob would wait for itself
+static uint32_t script_latest_job(void *ctx) {
+    script_run_t *run = ctx;
+    uint32_t id = system_manager_job_latest();
+    return id == run->job ? 0 : id;
+}
+
+static bool script_job_active(uint32_t id, void *ctx) {
+    return system_manager_job_active(id);
+}
+
+static void script_note(uint16_t line, const char *msg, void *ctx) {
+    printf("[script] line %u: %s\n", line, msg);
+}
+
+static void script_task(void *pvParameter) {
+    script_run_t *run = pvParameter;
+    script_env_t env = {
+        .run = script_run_command, .sleep = script_sleep, .free_bytes = script_free_bytes,
+        .time_of_day = script_time_of_day, .uptime_ms = script_uptime_ms, .latest_job = script_latest_job,
+        .job_active = script_job_active, .note = script_note, .ctx = run,
+    };
+
+    script_result_t result = SCRIPT_STOPPED;
+    if (script_sleep(run->start_delay_ms, run)) {
+        result = script_run(&run->script, &env);
+    }
+    ESP_LOGI(TAG, "%s: %lu commands, %lu failed", run->label, (unsigned long)run->script.commands,
+             (unsigned long)run->script.failed);
+
+    // A killed job is already marked cancelled, this does nothing then
+    system_manager_job_finish(run->job, result != SCRIPT_STOPPED && run->script.failed > 0 ? ESP_FAIL : ESP_OK);
+
+    current = NULL;
+    free(run);
+    script_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+static esp_err_t load(const char *path, script_run_t *run) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        printf("Error: cannot open %s\n", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    size_t len = fread(run->text, 1, sizeof(run->text), f);
+    fclose(f);
+    if (len > SCRIPT_MAX_SIZE) {
+        printf("Error: %s is larger than %d bytes\n", path, SCRIPT_MAX_SIZE);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    run->text[len] = '\0';
+
+    if (!script_parse(&run->script, run->text)) {
+        printf("Error: %s line %u: %s\n", path, run->script.error_line, run->script.error);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+// Hands run to the script task, which frees it
+static esp_err_t start(script_run_t *run, uint32_t *job) {
+    run->job = system_manager_job_start(&script_job, run->label);
+    if (run->job == 0) {
+        free(run);
+        return ESP_ERR_INVALID_STATE;
+    }
+    *job = run->job;
+
+    stop_requested = false;
+    current = run;
+    if (xTaskCreate(script_task, "ScriptTask", SCRIPT_TASK_STACK, run, 5, &script_task_handle) != pdPASS) {
+        current = NULL;
+        system_manager_job_finish(run->job, ESP_ERR_NO_MEM);
+        free(run);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t script_manager_exec(const char *path, bool check_only) {
+    char full[SCRIPT_PATH_MAX];
+    if (path[0] == '/') {
+        strlcpy(full, path, sizeof(full));
+    } else {
+        snprintf(full, sizeof(full), SCRIPT_DIR "/%s", path);
+    }
+
+    // A killed script finishes its current command before the task goes away
+    if (!check_only && script_task_handle != NULL) {
+        printf("Error: a script is still running or stopping, see 'jobs'\n");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    script_run_t *run = calloc(1, sizeof(*run));
+    if (run == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = load(full, run);
+    if (err != ESP_OK || check_only) {
+        if (err == ESP_OK) {
+            printf("%s: %u statements, OK\n", full, run->script.count);
+        }
+        free(run);
+        return err;
+    }
+
+    const char *name = strrchr(full, '/');
+    snprintf(run->label, sizeof(run->label), "exec %s", name ? name + 1 : full);
+    uint32_t job;
+    return start(run, &job);
+}
+
+void script_manager_autorun(void) {
+    struct stat st;
+    if (stat(SCRIPT_AUTORUN_PATH, &st) != 0) {
+        return;
+    }
+
+    script_run_t *run = calloc(1, sizeof(*run));
+    if (run == NULL) {
+        ESP_LOGE(TAG, "No memory for %s", SCRIPT_AUTORUN_PATH);
+        return;
+    }
+    if (load(SCRIPT_AUTORUN_PATH, run) != ESP_OK) {
+        free(run);
+        return;
+    }
+
+    strlcpy(run->label, "autorun", sizeof(run->label));
+    run->start_delay_ms = SCRIPT_AUTORUN_DELAY_MS;
+    uint32_t job;
+    if (start(run, &job) == ESP_OK) {
+        printf("Running %s as job %lu in %d s, 'kill %lu' to skip it\n", SCRIPT_AUTORUN_PATH,
+               (unsigned long)job, SCRIPT_AUTORUN_DELAY_MS / 1000, (unsigned long)job);
+    }
+}
@@ -1,5 +1,6 @@
 #include "managers/settings_manager.h"
 #include "managers/rgb_manager.h"
+#include "core/serial_manager.h"
 #include <string.h>
 #include <esp_log.h>
 
@@ -25,6 +26,7 @@ static const char* NVS_PRINTER_ALIGNMENT_KEY = "printer_alignment";
 static const char* NVS_PRINTER_CONNECTED_KEY = "printer_connected";
 static const char* NVS_BOARD_TYPE_KEY = "board_type";
 static const char* NVS_CUSTOM_PIN_CONFIG_KEY = "custom_pin_config";
+static const char* NVS_CONSOLE_BAUD_KEY = "console_baud";
 
 void settings_init(FSettings* settings) {
     settings_set_defaults(settings);
@@ -68,12 +70,16 @@ void settings_set_defaults(FSettings* settings) {
     strcpy(settings->printer_text, "Default Text");
     settings->printer_font_size = 12;
     settings->printer_alignment = ALIGNMENT_CM;
+
+    // Console defaults
+    settings->console_baud = SERIAL_DEFAULT_BAUD;
 }
 
 void settings_load(FSettings* settings) {
     esp_err_t err;
     uint8_t value_u8;
     uint16_t value_u16;
+    uint32_t value_u32;
     float value_float;
     size_t str_size;
 
@@ -176,6 +182,12 @@ void settings_load(FSettings* settings) {
         settings->printer_alignment = (PrinterAlignment)value_u8;
     }
 
+    // Load Console settings
+    err = nvs_get_u32(nvsHandle, NVS_CONSOLE_BAUD_KEY, &value_u32);
+    if (err == ESP_OK) {
+        settings->console_baud = value_u32;
+    }
+
     ESP_LOGI(S_TAG, "Settings loaded from NVS.");
 }
 
@@ -270,6 +282,12 @@ void settings_save(const FSettings* settings) {
         ESP_LOGE(S_TAG, "Failed to save Printer Alignment");
     }
 
+    // Save Console settings
+    err = nvs_set_u32(nvsHandle, NVS_CONSOLE_BAUD_KEY, settings->console_baud);
+    if (err != ESP_OK) {
+        ESP_LOGE(S_TAG, "Failed to save Console Baud Rate");
+    }
+
     printf(" RGB MODE INDEX = %i\n", (int)settings_get_rgb_mode(&G_Settings));
 
     if (settings_get_rgb_mode(&G_Settings) == 0)
@@ -436,4 +454,13 @@ void settings_set_printer_alignment(FSettings* settings, PrinterAlignment alignm
 
 PrinterAlignment settings_get_printer_alignment(const FSettings* settings) {
     return settings->printer_alignment;
+}
+
+// Console Getters and Setters
+void settings_set_console_baud(FSettings* settings, uint32_t baud) {
+    settings->console_baud = baud;
+}
+
+uint32_t settings_get_console_baud(const FSettings* settings) {
+    return settings->console_baud;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "managers/views/terminal_screen.h"
 #include "managers/views/main_menu_screen.h"
 #include "core/serial_manager.h"
+#include "managers/log_manager.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include <stdlib.h>
@@ -8,12 +9,40 @@
 #include <string.h>
 
 lv_obj_t *terminal_textarea = NULL;
-char text_buffer[1024] = "";
-uint32_t last_update = 0;
+static lv_timer_t *terminal_timer = NULL;
+static log_cursor_t terminal_cursor;
 #define MAX_TEXT_LENGTH 4096
-
-int custom_log_vprintf(const char *fmt, va_list args);
-static int (*default_log_vprintf)(const char *, va_list) = NULL;
+#define TERMINAL_POLL_MS 100
+
+// Runs in the LVGL task, the only place the textarea may be touched
+static void terminal_view_poll(lv_timer_t *timer) {
+    char batch[1024];
+    size_t len = 0;
+    log_entry_t entry;
+
+    while (len + LOG_RING_TEXT + 2 < sizeof(batch) && log_manager_read(&terminal_cursor, &entry)) {
+        memcpy(batch + len, entry.text, entry.len);
+        len += entry.len;
+        batch[len++] = '\n';
+    }
+    if (len == 0) {
+        return;
+    }
+    batch[len] = '\0';
+    lv_textarea_add_text(terminal_textarea, batch);
+
+    // Keep the newer half once the textarea gets long
+    const char *text = lv_textarea_get_text(terminal_textarea);
+    size_t total = strlen(text);
+    if (total > MAX_TEXT_LENGTH) {
+        char *tail = strdup(text + total - MAX_TEXT_LENGTH / 2);
+        if (tail != NULL) {
+            lv_textarea_set_text(terminal_textarea, tail);
+            free(tail);
+        }
+    }
+    lv_textarea_set_cursor_pos(terminal_textarea, LV_TEXTAREA_CURSOR_LAST);
+}
 
 void terminal_view_create(void) {
     if (terminal_view.root != NULL) {
@@ -35,16 +64,18 @@ void terminal_view_create(void) {
     lv_obj_set_style_text_font(terminal_textarea, &lv_font_montserrat_10, 0);
     lv_obj_set_style_border_width(terminal_textarea, 0, 0);
 
-    
-    //default_log_vprintf = esp_log_set_vprintf(custom_log_vprintf); // This is very slow might have to find a alternative
+    // Start with what is still in the log, then follow it
+    log_manager_cursor(&terminal_cursor, true);
+    terminal_timer = lv_timer_create(terminal_view_poll, TERMINAL_POLL_MS, NULL);
 
-    
     display_manager_add_status_bar("Terminal");
 }
 
 void terminal_view_destroy(void) {
-    //esp_log_set_vprintf(default_log_vprintf);
-    default_log_vprintf = NULL;
+    if (terminal_timer != NULL) {
+        lv_timer_del(terminal_timer);
+        terminal_timer = NULL;
+    }
     if (terminal_view.root != NULL) {
         lv_obj_del(terminal_view.root);
         terminal_view.root = NULL;
@@ -52,22 +83,9 @@ void terminal_view_destroy(void) {
     }
 }
 
+// Screen text goes through the log too, callers print their own console output
 void terminal_view_add_text(const char *text) {
-    if (terminal_textarea == NULL) return;
-
-    // Append new text to the buffer
-    strcat(text_buffer, text);
-    strcat(text_buffer, "\n");
-
-    // Get the current tick count
-    TickType_t now = xTaskGetTickCount();
-    if ((now - last_update) * portTICK_PERIOD_MS > 100) {
-        lv_textarea_set_text(terminal_textarea, text_buffer);
-        lv_textarea_set_cursor_pos(terminal_textarea, LV_TEXTAREA_CURSOR_LAST);
-        last_update = now;
-
-        text_buffer[0] = '\0';
-    }
+    log_manager_write(LOG_RING_INFO, LOG_RING_NO_UART, text);
 }
 
 void terminal_view_hardwareinput_callback(InputEvent *event) {
@@ -97,18 +115,6 @@ void terminal_view_get_hardwareinput_callback(void **callback) {
     }
 }
 
-int custom_log_vprintf(const char *fmt, va_list args) {
-    char buf[256];
-    int len = vsnprintf(buf, sizeof(buf), fmt, args);
-    if (len < 0) {
-        return len;
-    }
-
-    terminal_view_add_text(buf);
-
-    return len;
-}
-
 View terminal_view = {
     .root = NULL,
     .create = terminal_view_create,
@@ -0,0 +1,76 @@
+#include "managers/web_ui.h"
+#include "web_assets_table.h"         // Generated into the build directory
+#include <esp_log.h>
+#include <string.h>
+
+#define WEB_UI_MATCH_MAX 128          // Longer If-None-Match lists get a full response
+
+static const char *TAG = "WEB_UI";
+
+bool web_ui_etag_matches(const char *if_none_match, const char *etag) {
+    size_t etag_len = strlen(etag);
+    const char *p = if_none_match;
+
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        const char *start = p;
+        while (*p != '\0' && *p != ',') {
+            p++;
+        }
+        const char *end = p;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+            end--;
+        }
+
+        if (end - start == 1 && *start == '*') {
+            return true;
+        }
+        // If-None-Match compares weakly, so W/"x" matches "x"
+        if (end - start > 2 && start[0] == 'W' && start[1] == '/') {
+            start += 2;
+        }
+        if ((size_t)(end - start) == etag_len && memcmp(start, etag, etag_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t web_ui_get_handler(httpd_req_t *req) {
+    const web_asset_t *asset = req->user_ctx;
+    char match[WEB_UI_MATCH_MAX];
+
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cache_control);
+
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", match, sizeof(match)) == ESP_OK &&
+        web_ui_etag_matches(match, asset->etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    // Every browser takes gzip, there is no uncompressed copy to fall back to
+    ESP_LOGD(TAG, "Serving %s, %lu bytes", req->uri, (unsigned long)asset->len);
+    httpd_resp_set_type(req, asset->type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)asset->data, asset->len);
+}
+
+esp_err_t web_ui_register(httpd_handle_t server) {
+    for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        httpd_uri_t uri = {
+            .uri      = web_assets[i].uri,
+            .method   = HTTP_GET,
+            .handler  = web_ui_get_handler,
+            .user_ctx = (void *)&web_assets[i],
+        };
+        esp_err_t ret = httpd_register_uri_handler(server, &uri);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Error registering URI %s: %s", web_assets[i].uri, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
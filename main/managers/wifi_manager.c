@@ -4,6 +4,7 @@
 #include "managers/rgb_manager.h"
 #include "managers/ap_manager.h"
 #include "managers/settings_manager.h"
+#include "managers/sd_card_manager.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "esp_wifi.h"
@@ -22,6 +23,7 @@
 #include "lwip/lwip_napt.h"
 #include <esp_http_server.h>
 #include <core/dns_server.h>
+#include "core/callbacks.h"
 #include "esp_crt_bundle.h"
 #ifdef WITH_SCREEN
 #include "managers/views/music_visualizer.h"
@@ -40,8 +42,9 @@
 uint16_t ap_count;
 wifi_ap_record_t* scanned_aps;
 const char *TAG = "WiFiManager";
-char* PORTALURL = "";
-char* DOMAIN = "";
+// Copies, the command line that set them is reused for the next command
+char PORTALURL[256] = "";
+char DOMAIN[128] = "";
 EventGroupHandle_t wifi_event_group;
 const int WIFI_CONNECTED_BIT = BIT0;
 wifi_ap_record_t selected_ap;
@@ -50,6 +53,10 @@ httpd_handle_t evilportal_server = NULL;
 dns_server_handle_t dns_handle;
 esp_netif_t* wifiAP;
 esp_netif_t* wifiSTA;
+static station_stats_t station_stats;
+static void* beacon_task_handle;
+static void* deauth_task_handle;
+static int beacon_task_running = 0;
 
 typedef enum {
     COMPANY_DLINK,
@@ -235,29 +242,6 @@ static void generate_random_mac(uint8_t *mac) {
     mac[0] |= 0x02;            // Locally administered MAC address (set the second least significant bit)
 }
 
-static bool station_exists(const uint8_t *station_mac, const uint8_t *ap_bssid) {
-    for (int i = 0; i < station_count; i++) {
-        if (memcmp(station_ap_list[i].station_mac, station_mac, 6) == 0 &&
-            memcmp(station_ap_list[i].ap_bssid, ap_bssid, 6) == 0) {
-            return true;
-        }
-    }
-    return false;
-}
-
-static void add_station_ap_pair(const uint8_t *station_mac, const uint8_t *ap_bssid) {
-    if (station_count < MAX_STATIONS) {
-        memcpy(station_ap_list[station_count].station_mac, station_mac, 6);
-        memcpy(station_ap_list[station_count].ap_bssid, ap_bssid, 6);
-        station_count++;
-        ESP_LOGI(TAG, "Added station MAC: %02X:%02X:%02X:%02X:%02X:%02X -> AP BSSID: %02X:%02X:%02X:%02X:%02X:%02X",
-                 station_mac[0], station_mac[1], station_mac[2], station_mac[3], station_mac[4], station_mac[5],
-                 ap_bssid[0], ap_bssid[1], ap_bssid[2], ap_bssid[3], ap_bssid[4], ap_bssid[5]);
-    } else {
-        ESP_LOGW(TAG, "Station list is full, can't add more stations.");
-    }
-}
-
 // Function to match the BSSID to a company based on OUI
 ECompany match_bssid_to_company(const uint8_t *bssid) {
     char oui[7]; // First 3 bytes of the BSSID
@@ -317,21 +301,26 @@ ECompany match_bssid_to_company(const uint8_t *bssid) {
 }
 
 void wifi_stations_sniffer_callback(void *buf, wifi_promiscuous_pkt_type_t type) {
-    if (type != WIFI_PKT_DATA) {
+    if (type != WIFI_PKT_DATA && type != WIFI_PKT_MGMT) {
         return;
     }
 
     const wifi_promiscuous_pkt_t *packet = (wifi_promiscuous_pkt_t *)buf;
-    const wifi_ieee80211_packet_t *ipkt = (wifi_ieee80211_packet_t *)packet->payload;
-    const wifi_ieee80211_hdr_t *hdr = &ipkt->hdr;
 
-    
-    const uint8_t *src_mac = hdr->addr2;  // Station MAC
-    const uint8_t *dest_mac = hdr->addr1; // AP BSSID
+    bool is_new;
+    station_entry_t *station = station_stats_update(&station_stats, packet->payload, wifi_frame_len(packet),
+                                                    packet->rx_ctrl.rssi, (uint32_t)(esp_timer_get_time() / 1000), &is_new);
 
+    // Probed SSIDs are kept by the shared probe tracker, not per station
+    if (type == WIFI_PKT_MGMT) {
+        wifi_probe_tracker_feed(packet);
+    }
 
-    if (!station_exists(src_mac, dest_mac)) {
-        add_station_ap_pair(src_mac, dest_mac);
+    if (station != NULL && is_new) {
+        ESP_LOGI(TAG, "Added station MAC: %02X:%02X:%02X:%02X:%02X:%02X -> AP BSSID: %02X:%02X:%02X:%02X:%02X:%02X",
+                 station->mac[0], station->mac[1], station->mac[2], station->mac[3], station->mac[4], station->mac[5],
+                 station->ap_bssid[0], station->ap_bssid[1], station->ap_bssid[2],
+                 station->ap_bssid[3], station->ap_bssid[4], station->ap_bssid[5]);
     }
 }
 
@@ -696,8 +685,8 @@ void wifi_manager_start_evil_portal(const char *URL, const char *SSID, const cha
 
     if (strlen(URL) > 0 && strlen(domain) > 0)
     {
-        PORTALURL = URL;
-        DOMAIN = domain;
+        strlcpy(PORTALURL, URL, sizeof(PORTALURL));
+        strlcpy(DOMAIN, domain, sizeof(DOMAIN));
     }
 
     ap_manager_stop_services();
@@ -851,14 +840,12 @@ void wifi_manager_start_monitor_mode(wifi_promiscuous_cb_t_t callback) {
     ESP_ERROR_CHECK(esp_wifi_set_promiscuous_rx_cb(callback));
 
     ESP_LOGI(TAG, "WiFi monitor mode started.");
-    TERMINAL_VIEW_ADD_TEXT("WiFi monitor mode started.");
 }
 
 void wifi_manager_stop_monitor_mode() {
     ESP_ERROR_CHECK(esp_wifi_set_promiscuous(false));
 
     ESP_LOGI(TAG, "WiFi monitor mode stopped.");
-    TERMINAL_VIEW_ADD_TEXT("WiFi monitor mode stopped.");
 }
 
 void wifi_manager_init() {
@@ -946,14 +933,12 @@ void wifi_manager_start_scan() {
     rgb_manager_set_color(&rgb_manager, 0, 50, 255, 50, false);
 
     ESP_LOGI(TAG, "WiFi scanning started...");
-    TERMINAL_VIEW_ADD_TEXT("WiFi scanning started...");
     esp_err_t err = esp_wifi_scan_start(&scan_config, false);
 
     vTaskDelay(pdMS_TO_TICKS(1500));
 
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "WiFi scan failed to start: %s", esp_err_to_name(err));
-        TERMINAL_VIEW_ADD_TEXT("WiFi scan failed to start");
         return;
     }
 
@@ -971,7 +956,6 @@ void wifi_manager_stop_scan() {
     err = esp_wifi_scan_stop();
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to stop WiFi scan: %s", esp_err_to_name(err));
-        TERMINAL_VIEW_ADD_TEXT("Failed to stop WiFi scan");
         return;
     }
 
@@ -986,12 +970,10 @@ void wifi_manager_stop_scan() {
     err = esp_wifi_scan_get_ap_num(&initial_ap_count);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to get AP count: %s", esp_err_to_name(err));
-        TERMINAL_VIEW_ADD_TEXT( "Failed to get AP count: %s", esp_err_to_name(err));
         return;
     }
 
     ESP_LOGI(TAG, "Initial AP count: %u", initial_ap_count);
-    TERMINAL_VIEW_ADD_TEXT("Initial AP count: %u", initial_ap_count);
 
     if (initial_ap_count > 0) {
 
@@ -1021,30 +1003,97 @@ void wifi_manager_stop_scan() {
 
         ap_count = actual_ap_count;
         ESP_LOGI(TAG, "Actual AP count retrieved: %u", ap_count);
-        TERMINAL_VIEW_ADD_TEXT("Actual AP count retrieved: %u", ap_count);
     } else {
         ESP_LOGI(TAG, "No access points found");
         ap_count = 0;
     }
 
     ESP_LOGI(TAG, "WiFi scanning stopped.");
-    TERMINAL_VIEW_ADD_TEXT("WiFi scanning stopped.");
 }
 
-void wifi_manager_list_stations() {
-    if (station_count == 0) {
-        ESP_LOGI(TAG, "No stations found.");
+static void wifi_manager_export_stations_json(const uint16_t *order, size_t count) {
+    char entry_json[512];
+    FILE *f = NULL;
+
+    if (sd_card_manager.is_initialized) {
+        f = fopen(STATIONS_JSON_PATH, "w");
+        if (f == NULL) {
+            ESP_LOGE(TAG, "Failed to open %s", STATIONS_JSON_PATH);
+        }
+    }
+
+    printf("[");
+    if (f) fputc('[', f);
+
+    for (size_t i = 0; i < count; i++) {
+        if (station_stats_format_json(&station_stats.stations[order[i]], wifi_probe_tracker_get(),
+                                      entry_json, sizeof(entry_json)) == 0) {
+            continue;
+        }
+        printf("%s%s", i > 0 ? ",\n" : "\n", entry_json);
+        if (f) fprintf(f, "%s%s", i > 0 ? "," : "", entry_json);
+    }
+
+    printf("\n]\n");
+    if (f) {
+        fputs("]\n", f);
+        fclose(f);
+        printf("Saved to %s\n", STATIONS_JSON_PATH);
+    }
+}
+
+void wifi_manager_list_stations(station_sort_t sort, bool json) {
+    uint16_t order[STATION_STATS_MAX_STATIONS];
+    size_t count = station_stats_sort(&station_stats, sort, order, STATION_STATS_MAX_STATIONS);
+
+    if (json) {
+        wifi_manager_export_stations_json(order, count);
+        return;
+    }
+
+    if (count == 0) {
+        printf("No stations found.\n");
+        TERMINAL_VIEW_ADD_TEXT("No stations found.\n");
         return;
     }
 
-    ESP_LOGI(TAG, "Listing all stations and their associated APs:");
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    const probe_tracker_t *probes = wifi_probe_tracker_get();
+
+    printf("%lu stations (%lu evicted, %lu frames seen):\n",
+           (unsigned long)count, (unsigned long)station_stats.evictions, (unsigned long)station_stats.frames_seen);
+    printf("Station            AP                 Up frm/bytes      Down frm/bytes    RSSI min/avg/max  PS  Seen\n");
+
+    for (size_t i = 0; i < count; i++) {
+        const station_entry_t *s = &station_stats.stations[order[i]];
+
+        char rssi[20] = "-";
+        if (s->has_rssi) {
+            snprintf(rssi, sizeof(rssi), "%d/%d/%d", s->rssi_min, s->rssi_avg_q4 / 16, s->rssi_max);
+        }
+
+        printf("%02X:%02X:%02X:%02X:%02X:%02X  %02X:%02X:%02X:%02X:%02X:%02X  %6lu/%-10lu %6lu/%-10lu %-17s %-3u %lus ago\n",
+               s->mac[0], s->mac[1], s->mac[2], s->mac[3], s->mac[4], s->mac[5],
+               s->ap_bssid[0], s->ap_bssid[1], s->ap_bssid[2], s->ap_bssid[3], s->ap_bssid[4], s->ap_bssid[5],
+               (unsigned long)s->frames_up, (unsigned long)s->bytes_up,
+               (unsigned long)s->frames_down, (unsigned long)s->bytes_down,
+               rssi, s->ps_transitions, (unsigned long)((now_ms - s->last_seen_ms) / 1000));
+
+        const probe_device_t *d = probes != NULL ? probe_tracker_find(probes, s->mac) : NULL;
+        if (d != NULL && d->ssid_count > 0) {
+            printf("    Probes (%u):", s->probe_requests);
+            for (int p = 0; p < d->ssid_count; p++) {
+                const char *ssid = probe_tracker_ssid(probes, &d->ssids[p]);
+                if (ssid != NULL) {
+                    printf(" \"%s\"", ssid);
+                }
+            }
+            printf("\n");
+        }
 
-    for (int i = 0; i < station_count; i++) {
-        ESP_LOGI(TAG, "Station MAC: %02X:%02X:%02X:%02X:%02X:%02X -> AP BSSID: %02X:%02X:%02X:%02X:%02X:%02X",
-                 station_ap_list[i].station_mac[0], station_ap_list[i].station_mac[1], station_ap_list[i].station_mac[2],
-                 station_ap_list[i].station_mac[3], station_ap_list[i].station_mac[4], station_ap_list[i].station_mac[5],
-                 station_ap_list[i].ap_bssid[0], station_ap_list[i].ap_bssid[1], station_ap_list[i].ap_bssid[2],
-                 station_ap_list[i].ap_bssid[3], station_ap_list[i].ap_bssid[4], station_ap_list[i].ap_bssid[5]);
+        TERMINAL_VIEW_ADD_TEXT("%02X:%02X:%02X:%02X:%02X:%02X %lu/%lu frm %s dBm\n",
+                               s->mac[0], s->mac[1], s->mac[2], s->mac[3], s->mac[4], s->mac[5],
+                               (unsigned long)s->frames_up, (unsigned long)s->frames_down, rssi);
     }
 }
 
@@ -1149,7 +1198,6 @@ void wifi_manager_start_deauth()
 {
     if (!beacon_task_running) {
         ESP_LOGI(TAG, "Starting deauth transmission...");
-        TERMINAL_VIEW_ADD_TEXT("Starting deauth transmission...");
         ap_manager_stop_services();
         ESP_ERROR_CHECK(esp_wifi_start());
         xTaskCreate(wifi_deauth_task, "deauth_task", 2048, NULL, 5, &deauth_task_handle);
@@ -1157,7 +1205,6 @@ void wifi_manager_start_deauth()
         rgb_manager_set_color(&rgb_manager, 0, 255, 22, 23, false);
     } else {
         ESP_LOGW(TAG, "Deauth transmission already running.");
-        TERMINAL_VIEW_ADD_TEXT("Deauth transmission already running.");
     }
 }
 
@@ -1188,11 +1235,6 @@ void wifi_manager_select_ap(int index)
              selected_ap.ssid,
              selected_ap.bssid[0], selected_ap.bssid[1], selected_ap.bssid[2],
              selected_ap.bssid[3], selected_ap.bssid[4], selected_ap.bssid[5]);
-    
-    TERMINAL_VIEW_ADD_TEXT("Selected Access Point: SSID: %s, BSSID: %02X:%02X:%02X:%02X:%02X:%02X",
-             selected_ap.ssid,
-             selected_ap.bssid[0], selected_ap.bssid[1], selected_ap.bssid[2],
-             selected_ap.bssid[3], selected_ap.bssid[4], selected_ap.bssid[5]);
 
     printf("Selected Access Point Successfully\n");
     TERMINAL_VIEW_ADD_TEXT("Selected Access Point Successfully\n");
@@ -1510,7 +1552,6 @@ void wifi_manager_stop_deauth()
 {
     if (beacon_task_running) {
         ESP_LOGI(TAG, "Stopping deauth transmission...");
-        TERMINAL_VIEW_ADD_TEXT("Stopping deauth transmission...");
         if (deauth_task_handle != NULL) {
             vTaskDelete(deauth_task_handle);
             deauth_task_handle = NULL;
@@ -1661,7 +1702,6 @@ void wifi_manager_stop_beacon()
 {
     if (beacon_task_running) {
         ESP_LOGI(TAG, "Stopping beacon transmission...");
-        TERMINAL_VIEW_ADD_TEXT("Stopping beacon transmission...");
         if (beacon_task_handle != NULL) {
             vTaskDelete(beacon_task_handle);
             beacon_task_handle = NULL;
@@ -1702,19 +1742,16 @@ void wifi_manager_connect_wifi(const char* ssid, const char* password)
     int retry_count = 0;
     while (retry_count < 5) {
         ESP_LOGI(TAG, "Attempting to connect to Wi-Fi (Attempt %d/%d)...", retry_count + 1, 5);
-        TERMINAL_VIEW_ADD_TEXT("Attempting to connect to Wi-Fi (Attempt %d/%d)...", retry_count + 1, 5);
         
         int ret = esp_wifi_connect();
         if (ret == ESP_OK) {
             ESP_LOGI(TAG, "Connecting...");
-            TERMINAL_VIEW_ADD_TEXT("Connecting...");
             vTaskDelay(5000 / portTICK_PERIOD_MS);  // Wait for 5 seconds
             
             // Check if connected to the AP
             wifi_ap_record_t ap_info;
             if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
                 ESP_LOGI(TAG, "Successfully connected to Wi-Fi network: %s", ap_info.ssid);
-                TERMINAL_VIEW_ADD_TEXT("Successfully connected to Wi-Fi network: %s", ap_info.ssid);
                 break;
             } else {
                 ESP_LOGW(TAG, "Connection failed or timed out, retrying...");
@@ -1730,7 +1767,6 @@ void wifi_manager_connect_wifi(const char* ssid, const char* password)
 
     // Final status after retries
     if (retry_count == 5) {
-        TERMINAL_VIEW_ADD_TEXT("Failed to connect to Wi-Fi after %d attempts", 5);
         ESP_LOGE(TAG, "Failed to connect to Wi-Fi after %d attempts", 5);
     }
 }
@@ -1777,10 +1813,16 @@ void wifi_beacon_task(void *param) {
 }
 
 void wifi_manager_start_beacon(const char *ssid) {
+    // The task outlives the command line the SSID came from
+    static char beacon_ssid[33];
+
     if (!beacon_task_running) {
+        if (ssid != NULL) {
+            strlcpy(beacon_ssid, ssid, sizeof(beacon_ssid));
+            ssid = beacon_ssid;
+        }
         ap_manager_stop_services();
         ESP_LOGI(TAG, "Starting beacon transmission...");
-        TERMINAL_VIEW_ADD_TEXT("Starting beacon transmission...");
         configure_hidden_ap();
         esp_wifi_start();
         xTaskCreate(wifi_beacon_task, "beacon_task", 2048, (void *)ssid, 5, &beacon_task_handle);
@@ -1788,6 +1830,5 @@ void wifi_manager_start_beacon(const char *ssid) {
         rgb_manager_set_color(&rgb_manager, 0, 255, 0, 0, false);
     } else {
         ESP_LOGW(TAG, "Beacon transmission already running.");
-        TERMINAL_VIEW_ADD_TEXT("Beacon transmission already running.");
     }
 }
\ No newline at end of file
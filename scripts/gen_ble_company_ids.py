@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Generate the BLE company identifier lookup table.
+
+Reads Bluetooth SIG company identifiers, either as "id,name" CSV or as the
+SIG's company_identifiers.yaml, and writes a C header with a table indexed
+directly by company ID (offsets into one string pool), so a lookup is a
+single array read and everything stays in flash.
+
+Usage: gen_ble_company_ids.py <input.csv|input.yaml> <output.h>
+"""
+
+import re
+import sys
+
+
+def read_csv(lines):
+    companies = {}
+    for line in lines:
+        line = line.strip()
+        if not line or line.startswith("#") or line.lower().startswith("id,"):
+            continue
+        ident, name = line.split(",", 1)
+        companies[int(ident, 0)] = name.strip().strip('"')
+    return companies
+
+
+def read_yaml(lines):
+    # company_identifiers.yaml is a flat list of "- value: 0x...." / "name: '...'"
+    # pairs, parsed by hand so the build does not need PyYAML
+    companies = {}
+    ident = None
+    for line in lines:
+        m = re.match(r"\s*-?\s*value:\s*(0x[0-9A-Fa-f]+|\d+)", line)
+        if m:
+            ident = int(m.group(1), 0)
+            continue
+        m = re.match(r"\s*name:\s*(.*)$", line)
+        if m and ident is not None:
+            name = m.group(1).strip()
+            if len(name) >= 2 and name[0] == name[-1] and name[0] in "'\"":
+                name = name[1:-1].replace("''", "'")
+            companies[ident] = name
+            ident = None
+    return companies
+
+
+def ascii_name(name):
+    # Keep the pool plain ASCII for the terminal and the display font
+    return "".join(ch if 32 <= ord(ch) < 127 else "?" for ch in name)
+
+
+def c_string(name):
+    # Escape "?" too so runs of them can never form a trigraph
+    return name.replace("\\", "\\\\").replace('"', '\\"').replace("?", "\\?")
+
+
+def generate(companies):
+    size = max(companies) + 1 if companies else 1
+
+    pool = [""]
+    offsets = [0] * size
+    pool_len = 1
+    for ident in sorted(companies):
+        name = ascii_name(companies[ident])
+        offsets[ident] = pool_len
+        pool.append(name)
+        pool_len += len(name) + 1
+
+    offset_type = "uint16_t" if pool_len <= 0xFFFF else "uint32_t"
+
+    out = []
+    out.append("// Generated by scripts/gen_ble_company_ids.py, do not edit.")
+    out.append("")
+    out.append("#ifndef BLE_COMPANY_IDS_TABLE_H")
+    out.append("#define BLE_COMPANY_IDS_TABLE_H")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append("#define BLE_COMPANY_TABLE_SIZE  %d" % size)
+    out.append("#define BLE_COMPANY_TABLE_COUNT %d" % len(companies))
+    out.append("")
+    out.append("typedef %s ble_company_offset_t;" % offset_type)
+    out.append("")
+    out.append("// Offset into ble_company_names for each company ID, 0 when unassigned")
+    out.append("static const ble_company_offset_t ble_company_offsets[BLE_COMPANY_TABLE_SIZE] = {")
+    for i in range(0, size, 12):
+        out.append("    " + " ".join("%d," % o for o in offsets[i:i + 12]))
+    out.append("};")
+    out.append("")
+    out.append("static const char ble_company_names[] =")
+    out.append('    "\\0"')
+    for name in pool[1:]:
+        out.append('    "%s\\0"' % c_string(name))
+    out.append("    ;")
+    out.append("")
+    out.append("#endif // BLE_COMPANY_IDS_TABLE_H")
+    out.append("")
+    return "\n".join(out)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write(__doc__)
+        return 1
+
+    with open(sys.argv[1], encoding="utf-8") as f:
+        lines = f.readlines()
+
+    companies = read_yaml(lines) if sys.argv[1].endswith((".yaml", ".yml")) else read_csv(lines)
+    if any(ident > 0xFFFF for ident in companies):
+        sys.stderr.write("company identifiers are 16 bit\n")
+        return 1
+
+    header = generate(companies)
+
+    # Leave the file alone when nothing changed so the build does not recompile
+    try:
+        with open(sys.argv[2], encoding="utf-8") as f:
+            if f.read() == header:
+                return 0
+    except OSError:
+        pass
+
+    with open(sys.argv[2], "w", encoding="utf-8") as f:
+        f.write(header)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Generate the compressed web UI table.
+
+Gzips each file of the web UI and writes a C header with one web_asset_t per
+file (see include/managers/web_ui.h), ready to be served as-is with
+Content-Encoding: gzip. The first file is the page served at "/". The others
+are renamed after a hash of their content, and the page's references to them
+rewritten, so browsers can cache them for good while a new build still loads
+new ones. Every asset gets an ETag so repeat loads come back as 304.
+
+Prints the flash and transfer sizes, which shows up in the build output.
+
+Usage: gen_web_assets.py <output.h> <index.html> [asset ...]
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+CACHE_PAGE = "no-cache"                                 # Always revalidated, usually a 304
+CACHE_ASSET = "public, max-age=31536000, immutable"     # Name changes with the content
+
+
+def content_type(path):
+    ext = os.path.splitext(path)[1].lower()
+    if ext not in CONTENT_TYPES:
+        raise ValueError("no content type for %s" % path)
+    return CONTENT_TYPES[ext]
+
+
+def fingerprint(name, data):
+    stem, ext = os.path.splitext(name)
+    return "%s.%s%s" % (stem, hashlib.sha256(data).hexdigest()[:8], ext)
+
+
+def build(page_path, asset_paths):
+    assets = []
+    with open(page_path, "rb") as f:
+        page = f.read()
+
+    for path in asset_paths:
+        with open(path, "rb") as f:
+            data = f.read()
+        name = os.path.basename(path)
+        served = fingerprint(name, data)
+        ref = ('"%s"' % name).encode()
+        if ref not in page:
+            raise ValueError("%s does not reference %s" % (page_path, name))
+        page = page.replace(ref, ('"%s"' % served).encode())
+        assets.append(("/" + served, content_type(path), CACHE_ASSET, data))
+
+    content_type(page_path)
+    assets.insert(0, ("/", content_type(page_path), CACHE_PAGE, page))
+
+    table = []
+    for uri, ctype, cache, data in assets:
+        # mtime=0 keeps the output, and so the ETag, the same from build to build
+        packed = gzip.compress(data, compresslevel=9, mtime=0)
+        etag = '"%s"' % hashlib.sha256(packed).hexdigest()[:16]
+        table.append((uri, ctype, cache, etag, packed, len(data)))
+    return table
+
+
+def generate(table):
+    out = []
+    out.append("// Generated by scripts/gen_web_assets.py, do not edit.")
+    out.append("")
+    out.append("#ifndef WEB_ASSETS_TABLE_H")
+    out.append("#define WEB_ASSETS_TABLE_H")
+    out.append("")
+    out.append('#include "managers/web_ui.h"')
+    out.append("")
+    for i, (uri, _, _, _, packed, raw_len) in enumerate(table):
+        out.append("// %s, %d bytes before compression" % (uri, raw_len))
+        out.append("static const uint8_t web_asset_%d[%d] = {" % (i, len(packed)))
+        for j in range(0, len(packed), 16):
+            out.append("    " + " ".join("0x%02x," % b for b in packed[j:j + 16]))
+        out.append("};")
+        out.append("")
+    out.append("static const web_asset_t web_assets[] = {")
+    for i, (uri, ctype, cache, etag, packed, raw_len) in enumerate(table):
+        out.append('    { "%s", "%s", "%s", "%s", web_asset_%d, sizeof(web_asset_%d), %d },'
+                   % (uri, ctype, cache, etag.replace('"', '\\"'), i, i, raw_len))
+    out.append("};")
+    out.append("")
+    out.append("#define WEB_ASSET_COUNT (sizeof(web_assets) / sizeof(web_assets[0]))")
+    out.append("")
+    out.append("#endif // WEB_ASSETS_TABLE_H")
+    out.append("")
+    return "\n".join(out)
+
+
+def report(table):
+    raw = sum(t[5] for t in table)
+    packed = sum(len(t[4]) for t in table)
+    for uri, _, _, _, data, raw_len in table:
+        print("web UI: %-24s %6d -> %6d bytes gzip" % (uri, raw_len, len(data)))
+    print("web UI: %d bytes of flash instead of %d (%d saved), a first visit transfers %d bytes,"
+          " a repeat visit one 304 for the page" % (packed, raw, raw - packed, packed))
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.stderr.write(__doc__)
+        return 1
+
+    try:
+        table = build(sys.argv[2], sys.argv[3:])
+    except (OSError, ValueError) as e:
+        sys.stderr.write("gen_web_assets.py: %s\n" % e)
+        return 1
+
+    header = generate(table)
+    report(table)
+
+    # Keep the contents when nothing changed so the build does not recompile,
+    # but touch it so it is newer than its sources and the rule settles
+    try:
+        with open(sys.argv[1], encoding="utf-8") as f:
+            unchanged = f.read() == header
+        if unchanged:
+            os.utime(sys.argv[1], None)
+            return 0
+    except OSError:
+        pass
+
+    with open(sys.argv[1], "w", encoding="utf-8") as f:
+        f.write(header)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
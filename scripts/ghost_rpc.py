@@ -0,0 +1,413 @@
+#!/usr/bin/env python3
+"""Client for the Ghost ESP binary RPC mode.
+
+Sends `rpc` on the serial console, then talks in framed binary requests
+instead of scraping text. Methods, topics and status codes come from
+include/core/rpc_schema.h, read at start-up, so the firmware and this
+client cannot drift apart. Frames are COBS encoded between 0x00
+delimiters with a CRC-16/CCITT-FALSE, see include/core/rpc_codec.h.
+
+Usage:
+  ghost_rpc.py PORT [--baud N] info
+  ghost_rpc.py PORT run "scanap"
+  ghost_rpc.py PORT aps
+  ghost_rpc.py PORT watch [alert stats ap job]
+  ghost_rpc.py PORT bench [--count N]
+
+Uses pyserial when it is installed, otherwise opens PORT as a raw POSIX tty
+(which also works for a pty).
+"""
+
+import argparse
+import os
+import queue
+import re
+import struct
+import sys
+import threading
+import time
+
+SCHEMA_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "core", "rpc_schema.h")
+
+KIND_REQUEST, KIND_RESPONSE, KIND_NOTIFY = 1, 2, 3
+TAG_U32, TAG_I32, TAG_BOOL, TAG_STR, TAG_BYTES = 1, 2, 3, 4, 5
+TAG_NAMES = {TAG_U32: "u32", TAG_I32: "i32", TAG_BOOL: "bool", TAG_STR: "str", TAG_BYTES: "bytes"}
+MAX_PAYLOAD = 512
+
+
+class Schema:
+    def __init__(self, path=SCHEMA_PATH):
+        with open(path, encoding="utf-8") as f:
+            text = f.read()
+        self.methods = {}      # name -> (code, request fields, response fields)
+        self.topics = {}       # code -> (name, fields)
+        self.statuses = {}     # code -> name
+        section = None
+        for line in text.splitlines():
+            m = re.match(r"#define RPC_(METHODS|TOPICS|STATUSES)\(X\)", line)
+            if m:
+                section = m.group(1)
+                continue
+            m = re.match(r'\s*X\((.*?)\)\s*(/\*.*\*/)?\s*\\?\s*$', line)
+            if not m or section is None:
+                if not line.rstrip().endswith("\\"):
+                    section = None
+                continue
+            args = [a.strip() for a in re.findall(r'"[^"]*"|[^,]+', m.group(1))]
+            args = [a[1:-1] if a.startswith('"') else a for a in args]
+            code = int(args[0], 0)
+            if section == "METHODS":
+                self.methods[args[2]] = (code, args[3].split(), args[4].split())
+            elif section == "TOPICS":
+                self.topics[code] = (args[2], args[3].split())
+            else:
+                self.statuses[code] = args[2]
+
+    def topic_code(self, name):
+        for code, (topic, _) in self.topics.items():
+            if topic == name:
+                return code
+        raise KeyError(name)
+
+
+# Codec, mirrors main/core/rpc_codec.c
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos, code = 0, 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos, code = len(out), 1
+            out.append(0)
+            continue
+        out.append(b)
+        code += 1
+        if code == 0xFF:
+            out[code_pos] = code
+            code_pos, code = len(out), 1
+            out.append(0)
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            return None
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(kind, ident, code, payload=b""):
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("payload over %d bytes" % MAX_PAYLOAD)
+    raw = struct.pack("<BHB", kind, ident, code) + payload
+    raw += struct.pack("<H", crc16(raw))
+    return b"\x00" + cobs_encode(raw) + b"\x00"
+
+
+def decode_frame(encoded):
+    raw = cobs_decode(encoded)
+    if raw is None or len(raw) < 6 or crc16(raw[:-2]) != struct.unpack("<H", raw[-2:])[0]:
+        return None
+    kind, ident, code = struct.unpack("<BHB", raw[:4])
+    return kind, ident, code, raw[4:-2]
+
+
+def _varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def encode_values(types, values):
+    if len(types) != len(values):
+        raise ValueError("expected %d values (%s), got %d" % (len(types), " ".join(types), len(values)))
+    out = bytearray()
+    for t, v in zip(types, values):
+        if t == "u32":
+            out += bytes([TAG_U32]) + _varint(int(v) & 0xFFFFFFFF)
+        elif t == "i32":
+            v = int(v)
+            out += bytes([TAG_I32]) + _varint(((v << 1) ^ (v >> 31)) & 0xFFFFFFFF)
+        elif t == "bool":
+            out += bytes([TAG_BOOL, 1 if v else 0])
+        elif t in ("str", "bytes"):
+            data = v.encode() if t == "str" else bytes(v)
+            out += bytes([TAG_STR if t == "str" else TAG_BYTES]) + _varint(len(data)) + data
+        else:
+            raise ValueError("unknown type " + t)
+    return bytes(out)
+
+
+def decode_values(payload):
+    values, i = [], 0
+
+    def varint():
+        nonlocal i
+        result = shift = 0
+        while True:
+            if i >= len(payload) or shift > 28:
+                raise ValueError("truncated varint")
+            b = payload[i]
+            i += 1
+            result |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return result
+            shift += 7
+
+    while i < len(payload):
+        tag = payload[i]
+        i += 1
+        if tag == TAG_U32:
+            values.append(varint())
+        elif tag == TAG_I32:
+            raw = varint()
+            values.append((raw >> 1) ^ -(raw & 1))
+        elif tag == TAG_BOOL:
+            values.append(payload[i] == 1)
+            i += 1
+        elif tag in (TAG_STR, TAG_BYTES):
+            n = varint()
+            data = payload[i:i + n]
+            if len(data) != n:
+                raise ValueError("truncated string")
+            values.append(data.decode(errors="replace") if tag == TAG_STR else bytes(data))
+            i += n
+        else:
+            raise ValueError("unknown tag %d" % tag)
+    return values
+
+
+# Transport
+
+class _PosixPort:
+    def __init__(self, path, baud):
+        import termios
+        import tty
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        attrs = termios.tcgetattr(self.fd)
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is not None:
+            attrs[4] = attrs[5] = speed
+        attrs[6][termios.VMIN], attrs[6][termios.VTIME] = 0, 1
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+
+    def read(self, n):
+        return os.read(self.fd, n)
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            view = view[os.write(self.fd, view):]
+
+    def close(self):
+        os.close(self.fd)
+
+
+def open_port(path, baud):
+    try:
+        import serial
+    except ImportError:
+        return _PosixPort(path, baud)
+    return serial.Serial(path, baud, timeout=0.1)
+
+
+class RPCError(Exception):
+    pass
+
+
+class GhostRPC:
+    """One RPC session. Responses are matched by id, notifications are queued."""
+
+    def __init__(self, port, baud=115200, schema=None, keepalive=20.0):
+        self.schema = schema or Schema()
+        self.port = open_port(port, baud)
+        self.notifications = queue.Queue()
+        self._pending = {}
+        self._lock = threading.Lock()
+        self._next_id = 1
+        self._last_seq = None
+        self.dropped_notifications = 0
+        self.bad_frames = 0
+        self._closed = False
+        self._last_sent = time.monotonic()
+        self._reader = threading.Thread(target=self._read_loop, daemon=True)
+        self._reader.start()
+        self._enter()
+        if keepalive:
+            threading.Thread(target=self._keepalive, args=(keepalive,), daemon=True).start()
+
+    def _enter(self):
+        # Whatever was typed before is cut off by the newline, then the device
+        # answers pings once the session is open
+        self.port.write(b"\nrpc\n")
+        deadline = time.monotonic() + 5
+        while time.monotonic() < deadline:
+            try:
+                self.call("ping", 0, timeout=0.5)
+                return
+            except TimeoutError:
+                pass
+        raise RPCError("device did not enter RPC mode")
+
+    def _keepalive(self, period):
+        # The device drops a session that is quiet for a minute
+        while not self._closed:
+            time.sleep(1)
+            if time.monotonic() - self._last_sent > period:
+                try:
+                    self.call("ping", 0)
+                except (RPCError, TimeoutError, OSError):
+                    pass
+
+    def _read_loop(self):
+        buf = bytearray()
+        while not self._closed:
+            try:
+                data = self.port.read(4096)
+            except OSError:
+                break
+            for b in data:
+                if b != 0:
+                    buf.append(b)
+                    continue
+                if not buf:
+                    continue
+                frame = decode_frame(bytes(buf))
+                buf.clear()
+                if frame is None:
+                    # Console text between frames ends up here too
+                    self.bad_frames += 1
+                    continue
+                self._dispatch(*frame)
+
+    def _dispatch(self, kind, ident, code, payload):
+        try:
+            values = decode_values(payload)
+        except ValueError:
+            self.bad_frames += 1
+            return
+        if kind == KIND_RESPONSE:
+            with self._lock:
+                waiter = self._pending.pop(ident, None)
+            if waiter:
+                waiter.put((code, values))
+        elif kind == KIND_NOTIFY:
+            if self._last_seq is not None:
+                self.dropped_notifications += (ident - self._last_seq - 1) & 0xFFFF
+            self._last_seq = ident
+            name, _ = self.schema.topics.get(code, ("topic %d" % code, []))
+            self.notifications.put((name, values))
+
+    def call(self, method, *args, timeout=2.0):
+        code, req_types, _ = self.schema.methods[method]
+        payload = encode_values(req_types, args)
+        waiter = queue.Queue(maxsize=1)
+        with self._lock:
+            ident = self._next_id
+            self._next_id = (self._next_id % 0xFFFF) + 1
+            self._pending[ident] = waiter
+        self.port.write(encode_frame(KIND_REQUEST, ident, code, payload))
+        self._last_sent = time.monotonic()
+        try:
+            status, values = waiter.get(timeout=timeout)
+        except queue.Empty:
+            with self._lock:
+                self._pending.pop(ident, None)
+            raise TimeoutError("%s timed out" % method)
+        if status != 0:
+            raise RPCError("%s: %s" % (method, self.schema.statuses.get(status, "status %d" % status)))
+        return values
+
+    def subscribe(self, *topics):
+        mask = 0
+        for name in topics:
+            mask |= 1 << self.schema.topic_code(name)
+        return self.call("subscribe", mask)[0]
+
+    def close(self):
+        if self._closed:
+            return
+        try:
+            self.call("exit", timeout=1.0)
+        except (RPCError, TimeoutError, OSError):
+            pass
+        self._closed = True
+        self._reader.join(timeout=1)
+        self.port.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=115200)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    sub.add_parser("info")
+    run = sub.add_parser("run")
+    run.add_argument("line")
+    sub.add_parser("aps")
+    watch = sub.add_parser("watch")
+    watch.add_argument("topics", nargs="*", default=["alert", "stats"])
+    bench = sub.add_parser("bench")
+    bench.add_argument("--count", type=int, default=2000)
+    args = parser.parse_args()
+
+    with GhostRPC(args.port, args.baud) as rpc:
+        if args.cmd == "info":
+            target, heap, uptime = rpc.call("info")
+            print("%s, %d bytes free, up %.1f s" % (target, heap, uptime / 1000))
+        elif args.cmd == "run":
+            print("Result: %d" % rpc.call("run", args.line, timeout=30)[0])
+        elif args.cmd == "aps":
+            rpc.subscribe("ap")
+            count = rpc.call("ap_list", timeout=10)[0]
+            for _ in range(count):
+                _, (index, bssid, ssid, rssi, channel, auth) = rpc.notifications.get(timeout=2)
+                print("%3d  %s  ch %2d  %4d dBm  auth %d  %s" % (index, bssid.hex(":"), channel, rssi, auth, ssid))
+        elif args.cmd == "watch":
+            rpc.subscribe(*args.topics)
+            try:
+                while True:
+                    name, values = rpc.notifications.get()
+                    print(name, values)
+            except KeyboardInterrupt:
+                pass
+        elif args.cmd == "bench":
+            start = time.perf_counter()
+            for i in range(args.count):
+                if rpc.call("ping", i)[0] != i:
+                    raise RPCError("ping %d echoed wrong value" % i)
+            elapsed = time.perf_counter() - start
+            print("%d calls in %.2f s: %.0f calls/s, %.0f us round trip" %
+                  (args.count, elapsed, args.count / elapsed, elapsed / args.count * 1e6))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,233 @@
+// fuzz_cmd_registry.c
+//
+// libFuzzer target for the console command parser: the input is one command
+// line as it would arrive over serial, run through cmd_tokenize,
+// cmd_registry_find, cmd_parse, the help formatters and completion against
+// a copy of the console's option specs. Every invariant the handlers rely on
+// is checked, so a failure is a bug even when nothing crashes.
+//
+//   make fuzz       build with clang -fsanitize=fuzzer and run on corpus/cmd_registry
+//
+// test_cmd_registry replays the corpus and a fixed set of mutations of it
+// through the same entry point on every make.
+
+#include "core/cmd_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_LINE_MAX 256
+
+#define FUZZ_CHECK(cond)                                                                \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            fprintf(stderr, "%s:%d: invariant failed: %s\n", __FILE__, __LINE__, #cond); \
+            abort();                                                                    \
+        }                                                                               \
+    } while (0)
+
+// The shapes the console uses: ALONE flags, optional and ranged integers,
+// choices, strings, positionals and a RAW command
+
+static const char *const sort_names[] = { "recent", "frames", "bytes", "rssi", NULL };
+
+static const cmd_opt_t list_opts[] = {
+    { .name = "-a", .flags = CMD_OPT_ALONE, .help = "Show access points" },
+    { .name = "-s", .help = "List stations" },
+    { .name = "-o", .type = CMD_OPT_CHOICE, .help = "Sort stations by", .choices = sort_names },
+    { .name = "-j", .help = "Print as JSON" },
+};
+
+static const cmd_opt_t select_opts[] = {
+    { .name = "-a", .type = CMD_OPT_INT, .flags = CMD_OPT_ALONE | CMD_OPT_NO_DEFAULT, .value_name = "number",
+      .help = "AP selection index", .min = 0, .max = UINT16_MAX },
+};
+
+static const cmd_opt_t capture_opts[] = {
+    { .name = "-probe", .flags = CMD_OPT_ALONE, .help = "Probes" },
+    { .name = "-wps", .type = CMD_OPT_INT, .flags = CMD_OPT_ALONE | CMD_OPT_VALUE_OPTIONAL, .value_name = "max",
+      .help = "WPS", .min = 1, .max = 1024, .def = 64 },
+    { .name = "-stop", .flags = CMD_OPT_ALONE, .help = "Stop" },
+};
+
+static const cmd_opt_t rogueap_opts[] = {
+    { .name = "-f", .type = CMD_OPT_STRING, .value_name = "allowlist.csv", .help = "Allowlist" },
+    { .name = "-s", .flags = CMD_OPT_ALONE, .help = "Stop" },
+};
+
+static const cmd_opt_t blescan_opts[] = {
+    { .name = "-f", .flags = CMD_OPT_ALONE, .help = "Find the Flippers" },
+    { .name = "-ds", .flags = CMD_OPT_ALONE, .help = "Spam detector" },
+    { .name = "-t", .type = CMD_OPT_INT, .flags = CMD_OPT_ALONE | CMD_OPT_VALUE_OPTIONAL, .value_name = "minutes",
+      .help = "Trackers", .min = 1, .max = 55, .def = 10 },
+    { .name = "-n", .type = CMD_OPT_INT, .flags = CMD_OPT_ALONE | CMD_OPT_VALUE_OPTIONAL, .value_name = "max",
+      .help = "Devices", .min = 1, .max = 6553, .def = 100 },
+    { .name = "-s", .flags = CMD_OPT_ALONE, .help = "Stop" },
+};
+
+static const cmd_opt_t coex_opts[] = {
+    { .name = "-w", .type = CMD_OPT_INT, .value_name = "wifi %", .help = "WiFi share", .min = 0, .max = 100, .def = 50 },
+    { .name = "-b", .type = CMD_OPT_INT, .flags = CMD_OPT_NO_DEFAULT, .value_name = "ble %", .help = "BLE share",
+      .min = 0, .max = 100, .def = 50 },
+    { .name = "-t", .type = CMD_OPT_INT, .value_name = "slot ms", .help = "Slot", .min = 20, .max = 10000, .def = 100 },
+    { .name = "-i", .flags = CMD_OPT_ALONE, .help = "Info" },
+    { .name = "-s", .flags = CMD_OPT_ALONE, .help = "Stop" },
+};
+
+static const cmd_opt_t baud_opts[] = {
+    { .name = "-n", .help = "Do not save" },
+};
+
+static const cmd_spec_t fuzz_specs[] = {
+    { .name = "help", .positional = "[command]", .max_positional = 1 },
+    { .name = "list", .flags = CMD_SPEC_NEEDS_OPTION, .opts = list_opts, .opt_count = 4 },
+    { .name = "select", .flags = CMD_SPEC_NEEDS_OPTION, .opts = select_opts, .opt_count = 1 },
+    { .name = "capture", .flags = CMD_SPEC_NEEDS_OPTION, .opts = capture_opts, .opt_count = 3 },
+    { .name = "rogueap", .opts = rogueap_opts, .opt_count = 2 },
+    { .name = "blescan", .flags = CMD_SPEC_NEEDS_OPTION, .opts = blescan_opts, .opt_count = 5 },
+    { .name = "coex", .opts = coex_opts, .opt_count = 5 },
+    { .name = "baud", .positional = "[rate]", .max_positional = 1, .opts = baud_opts, .opt_count = 1 },
+    { .name = "connect", .positional = "<SSID> <Password>", .min_positional = 2, .max_positional = 2 },
+    { .name = "powerprinter", .positional = "<Printer IP> <Text> <FontSize> <alignment>", .max_positional = 4 },
+    { .name = "startportal", .usage = "startportal <URL> <SSID> ...", .flags = CMD_SPEC_RAW },
+    { .name = "stop" },
+};
+
+#define FUZZ_SPEC_COUNT (sizeof(fuzz_specs) / sizeof(fuzz_specs[0]))
+
+static cmd_registry_t registry;
+
+static void fuzz_setup(void) {
+    static int ready;
+    if (ready) {
+        return;
+    }
+    cmd_registry_init(&registry);
+    for (size_t i = 0; i < FUZZ_SPEC_COUNT; i++) {
+        FUZZ_CHECK(cmd_registry_add(&registry, &fuzz_specs[i]));
+    }
+    ready = 1;
+}
+
+static int points_into(const char *p, const char *buf, size_t len) {
+    return p >= buf && p < buf + len;
+}
+
+static void check_parsed(const cmd_spec_t *spec, const cmd_args_t *args, const char *line) {
+    int given = 0;
+    int alone = 0;
+
+    for (int i = 0; i < spec->opt_count; i++) {
+        const cmd_opt_t *opt = &spec->opts[i];
+        if (!(args->present & (1u << i))) {
+            continue;
+        }
+        given++;
+        alone |= (opt->flags & CMD_OPT_ALONE) != 0;
+        if (opt->type == CMD_OPT_INT) {
+            FUZZ_CHECK(args->ival[i] >= opt->min && args->ival[i] <= opt->max);
+            FUZZ_CHECK(cmd_arg_int(args, opt->name) == args->ival[i]);
+        } else if (opt->type == CMD_OPT_CHOICE) {
+            FUZZ_CHECK(args->ival[i] >= 0 && args->sval[i] == opt->choices[args->ival[i]]);
+        } else if (opt->type == CMD_OPT_STRING) {
+            FUZZ_CHECK(points_into(args->sval[i], line, FUZZ_LINE_MAX));
+        }
+        FUZZ_CHECK(cmd_arg_given(args, opt->name));
+    }
+    FUZZ_CHECK((args->present >> spec->opt_count) == 0);
+    FUZZ_CHECK(!alone || (given == 1 && args->positional_count == 0));
+    FUZZ_CHECK(!(spec->flags & CMD_SPEC_NEEDS_OPTION) || given > 0);
+    FUZZ_CHECK(args->positional_count >= spec->min_positional && args->positional_count <= spec->max_positional);
+    for (int i = 0; i < args->positional_count; i++) {
+        FUZZ_CHECK(points_into(args->positional[i], line, FUZZ_LINE_MAX));
+    }
+}
+
+static void check_formatting(const cmd_spec_t *spec, size_t small) {
+    char full[1024];
+    char part[64];
+
+    size_t need = cmd_format_help(spec, NULL, 0);
+    FUZZ_CHECK(need < sizeof(full));
+    FUZZ_CHECK(cmd_format_help(spec, full, sizeof(full)) == need && strlen(full) == need);
+    FUZZ_CHECK(cmd_format_help(spec, part, small) == need);
+    FUZZ_CHECK(small == 0 || (strlen(part) < small && strncmp(part, full, strlen(part)) == 0));
+
+    need = cmd_format_usage(spec, full, sizeof(full));
+    FUZZ_CHECK(need < sizeof(full) && strlen(full) == need);
+}
+
+static void check_completion(const char *line, size_t max_out) {
+    const char *cands[8];
+    size_t total = cmd_registry_complete(&registry, line, cands, max_out);
+    size_t shown = total < max_out ? total : max_out;
+
+    for (size_t i = 0; i < shown; i++) {
+        FUZZ_CHECK(cands[i] != NULL);
+    }
+    if (shown > 0) {
+        size_t common = cmd_common_prefix_len(cands, shown);
+        for (size_t i = 0; i < shown; i++) {
+            FUZZ_CHECK(common <= strlen(cands[i]) && strncmp(cands[i], cands[0], common) == 0);
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char line[FUZZ_LINE_MAX];
+    char copy[FUZZ_LINE_MAX];
+    char *argv[CMD_MAX_ARGS];
+    char err[CMD_ERR_LEN];
+    cmd_args_t args;
+
+    fuzz_setup();
+
+    // The console hands over at most a line buffer's worth, NUL terminated
+    size_t len = size < sizeof(line) - 1 ? size : sizeof(line) - 1;
+    memcpy(line, data, len);
+    line[len] = '\0';
+    memcpy(copy, line, len + 1);
+    uint8_t seed = size > 0 ? data[size - 1] : 0;
+
+    check_completion(copy, seed % 9);
+
+    int argc = cmd_tokenize(line, argv, CMD_MAX_ARGS);
+    if (argc < 0) {
+        FUZZ_CHECK(argc == CMD_TOKENIZE_TOO_MANY || argc == CMD_TOKENIZE_UNTERMINATED);
+        return 0;
+    }
+    for (int i = 0; i < argc; i++) {
+        FUZZ_CHECK(points_into(argv[i], line, sizeof(line)) && strlen(argv[i]) <= strlen(copy));
+    }
+    if (argc == 0) {
+        return 0;
+    }
+
+    // Unknown names still exercise the parser, against a spec picked by the input
+    const cmd_spec_t *spec = cmd_registry_find(&registry, argv[0]);
+    if (spec == NULL) {
+        spec = &fuzz_specs[seed % FUZZ_SPEC_COUNT];
+    } else {
+        FUZZ_CHECK(strcmp(spec->name, argv[0]) == 0);
+    }
+    check_formatting(spec, seed % 64);
+    if (spec->flags & CMD_SPEC_RAW) {
+        return 0;
+    }
+
+    // A short error buffer must still come back terminated
+    size_t err_len = (seed & 0x80) ? seed % 8 : sizeof(err);
+    memset(err, 'x', sizeof(err));
+    cmd_parse_result_t result = cmd_parse(spec, argc, argv, &args, err, err_len);
+    if (err_len > 0) {
+        FUZZ_CHECK(memchr(err, '\0', err_len) != NULL);
+    }
+    if (result == CMD_PARSE_ERROR) {
+        FUZZ_CHECK(err_len < sizeof(err) || strncmp(err, spec->name, strlen(spec->name)) == 0);
+    } else if (result == CMD_PARSE_OK) {
+        check_parsed(spec, &args, line);
+    } else {
+        FUZZ_CHECK(result == CMD_PARSE_HELP);
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""Cross-check for test_rpc_codec: scripts/ghost_rpc.py against rpc_codec.c.
+
+Prints the schema as the client parses it from rpc_schema.h, one line each:
+
+  method <name> <code> <request fields> ; <response fields>
+  topic <name> <code> <fields>
+  status <code> <name>
+
+then reads frames the C codec encoded, one per line:
+
+  <frame hex> <kind> <id> <code> [u32:<n> | i32:<n> | bool:<0|1> | str:<hex> | bytes:<hex>]...
+
+decodes each with the client, checks it against the values listed and that
+the client encodes the same values to the same bytes, and prints its own
+encoding back for the C side to decode. Exits 1 on the first mismatch.
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "scripts"))
+import ghost_rpc as g  # noqa: E402
+
+
+def parse_value(field):
+    t, v = field.split(":", 1)
+    if t in ("u32", "i32"):
+        return t, int(v)
+    if t == "bool":
+        return t, v == "1"
+    data = bytes.fromhex(v)
+    return t, data.decode() if t == "str" else data
+
+
+def main():
+    schema = g.Schema()
+    for name, (code, req, resp) in sorted(schema.methods.items()):
+        print("method %s %d %s ; %s" % (name, code, " ".join(req), " ".join(resp)))
+    for code, (name, fields) in sorted(schema.topics.items()):
+        print("topic %s %d %s" % (name, code, " ".join(fields)))
+    for code, name in sorted(schema.statuses.items()):
+        print("status %d %s" % (code, name))
+    print("frames")
+
+    for n, line in enumerate(sys.stdin, 1):
+        fields = line.split()
+        encoded = bytes.fromhex(fields[0])
+        kind, ident, code = (int(f) for f in fields[1:4])
+        types, values = zip(*(parse_value(f) for f in fields[4:])) if len(fields) > 4 else ((), ())
+
+        decoded = g.decode_frame(encoded[1:-1])
+        if decoded is None or decoded[:3] != (kind, ident, code):
+            sys.exit("line %d: client decoded %r, want %r" % (n, decoded and decoded[:3], (kind, ident, code)))
+        if g.decode_values(decoded[3]) != list(values):
+            sys.exit("line %d: client decoded values %r, want %r" % (n, g.decode_values(decoded[3]), list(values)))
+        ours = g.encode_frame(kind, ident, code, g.encode_values(list(types), list(values)))
+        if ours != encoded:
+            sys.exit("line %d: client encodes %s" % (n, ours.hex()))
+        print(ours.hex())
+
+
+if __name__ == "__main__":
+    main()
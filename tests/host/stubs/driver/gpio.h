@@ -0,0 +1,9 @@
+// driver/gpio.h, host stand-in for the ESP-IDF header; nothing on the host
+// drives a pin
+
+#ifndef HOST_STUB_DRIVER_GPIO_H
+#define HOST_STUB_DRIVER_GPIO_H
+
+typedef int gpio_num_t;
+
+#endif // HOST_STUB_DRIVER_GPIO_H
@@ -0,0 +1,16 @@
+// driver/uart.h, host stand-in for the ESP-IDF header; the test provides the
+// functions
+
+#ifndef HOST_STUB_DRIVER_UART_H
+#define HOST_STUB_DRIVER_UART_H
+
+#include <esp_err.h>
+#include <stddef.h>
+
+typedef int uart_port_t;
+
+#define UART_NUM_0  0
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+
+#endif // HOST_STUB_DRIVER_UART_H
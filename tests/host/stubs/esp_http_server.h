@@ -0,0 +1,55 @@
+// esp_http_server.h, host stand-in for the ESP-IDF header; the test provides
+// the functions. The request carries the socket and what the client sent, so
+// a simulated server can hand handlers any request it likes.
+
+#ifndef HOST_STUB_ESP_HTTP_SERVER_H
+#define HOST_STUB_ESP_HTTP_SERVER_H
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef void *httpd_handle_t;
+typedef void (*httpd_free_ctx_fn_t)(void *ctx);
+typedef void (*httpd_work_fn_t)(void *arg);
+
+typedef enum {
+    HTTP_GET = 1,
+    HTTP_POST = 3,
+} httpd_method_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    const char *uri;
+    void *user_ctx;
+    void *sess_ctx;
+    httpd_free_ctx_fn_t free_ctx;
+    // Host only: the session's socket and what the client sent
+    int fd;
+    const char *query;
+    const char *last_event_id;
+    const char *if_none_match;
+} httpd_req_t;
+
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+} httpd_uri_t;
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri);
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value);
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status);
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t len);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len);
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size);
+int httpd_req_to_sockfd(httpd_req_t *req);
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char *buf, size_t buf_len, int flags);
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg);
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+
+#endif // HOST_STUB_ESP_HTTP_SERVER_H
@@ -0,0 +1,11 @@
+// esp_idf_version.h, host stand-in for the ESP-IDF header. It reports a
+// release old enough that the LED strip headers leave out the RMT and SPI
+// driver types.
+
+#ifndef HOST_STUB_ESP_IDF_VERSION_H
+#define HOST_STUB_ESP_IDF_VERSION_H
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch)  (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION                           ESP_IDF_VERSION_VAL(4, 4, 0)
+
+#endif // HOST_STUB_ESP_IDF_VERSION_H
@@ -0,0 +1,23 @@
+// esp_log.h, host stand-in for the ESP-IDF header: errors and warnings go to
+// stderr, the rest is dropped
+
+#ifndef HOST_STUB_ESP_LOG_H
+#define HOST_STUB_ESP_LOG_H
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#define LOG_COLOR_E      ""
+#define LOG_COLOR_W      ""
+#define LOG_RESET_COLOR  ""
+
+typedef int (*vprintf_like_t)(const char *, va_list);
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGD(tag, fmt, ...) ((void)(tag))
+
+#endif // HOST_STUB_ESP_LOG_H
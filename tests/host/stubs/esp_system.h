@@ -0,0 +1,11 @@
+// esp_system.h, host stand-in for the ESP-IDF header; the test provides the
+// functions
+
+#ifndef HOST_STUB_ESP_SYSTEM_H
+#define HOST_STUB_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+uint32_t esp_get_free_heap_size(void);
+
+#endif // HOST_STUB_ESP_SYSTEM_H
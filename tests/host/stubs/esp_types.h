@@ -0,0 +1,11 @@
+// esp_types.h, host stand-in for the ESP-IDF header
+
+#ifndef HOST_STUB_ESP_TYPES_H
+#define HOST_STUB_ESP_TYPES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#endif // HOST_STUB_ESP_TYPES_H
@@ -0,0 +1,9 @@
+// esp_vfs_fat.h, host stand-in for the ESP-IDF header; the host file system
+// is already mounted
+
+#ifndef HOST_STUB_ESP_VFS_FAT_H
+#define HOST_STUB_ESP_VFS_FAT_H
+
+#include <esp_err.h>
+
+#endif // HOST_STUB_ESP_VFS_FAT_H
@@ -0,0 +1,15 @@
+// esp_wifi.h, host stand-in for the ESP-IDF header; the test provides the
+// functions
+
+#ifndef HOST_STUB_ESP_WIFI_H
+#define HOST_STUB_ESP_WIFI_H
+
+#include <esp_err.h>
+#include <esp_wifi_types.h>
+#include <stdbool.h>
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb);
+esp_err_t esp_wifi_set_promiscuous(bool en);
+
+#endif // HOST_STUB_ESP_WIFI_H
@@ -0,0 +1,32 @@
+// esp_wifi_types.h, host stand-in for the ESP-IDF header with the types the
+// host tests use
+
+#ifndef HOST_STUB_ESP_WIFI_TYPES_H
+#define HOST_STUB_ESP_WIFI_TYPES_H
+
+#include <stdint.h>
+
+typedef enum {
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA,
+} wifi_mode_t;
+
+typedef enum {
+    WIFI_PKT_MGMT,
+    WIFI_PKT_CTRL,
+    WIFI_PKT_DATA,
+    WIFI_PKT_MISC,
+} wifi_promiscuous_pkt_type_t;
+
+typedef void (*wifi_promiscuous_cb_t)(void *buf, wifi_promiscuous_pkt_type_t type);
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t ssid[33];
+    uint8_t primary;
+    int8_t rssi;
+} wifi_ap_record_t;
+
+#endif // HOST_STUB_ESP_WIFI_TYPES_H
@@ -0,0 +1,28 @@
+// FreeRTOS.h, host stand-in for the ESP-IDF header with the types the host
+// tests use
+
+#ifndef HOST_STUB_FREERTOS_H
+#define HOST_STUB_FREERTOS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE        0
+#define pdTRUE         1
+#define pdPASS         pdTRUE
+#define portMAX_DELAY  ((TickType_t)0xffffffffu)
+
+// A 1 kHz tick, as the firmware is configured
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+
+typedef struct {
+    int locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED  { 0 }
+
+#endif // HOST_STUB_FREERTOS_H
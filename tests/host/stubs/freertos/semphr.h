@@ -0,0 +1,16 @@
+// semphr.h, host stand-in for the ESP-IDF header; the test provides the
+// functions
+
+#ifndef HOST_STUB_SEMPHR_H
+#define HOST_STUB_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_semaphore *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+#endif // HOST_STUB_SEMPHR_H
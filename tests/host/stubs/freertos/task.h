@@ -0,0 +1,20 @@
+// task.h, host stand-in for the ESP-IDF header; the test provides the
+// functions
+
+#ifndef HOST_STUB_TASK_H
+#define HOST_STUB_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+
+BaseType_t xTaskCreate(void (*task)(void *), const char *name, uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *out);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+void vTaskDelete(TaskHandle_t task);
+void taskENTER_CRITICAL(portMUX_TYPE *mux);
+void taskEXIT_CRITICAL(portMUX_TYPE *mux);
+
+#endif // HOST_STUB_TASK_H
@@ -0,0 +1,42 @@
+// host/ble_gap.h, host stand-in for the NimBLE header with the GAP discovery
+// API the BLE manager uses; the test provides the functions
+
+#ifndef HOST_STUB_BLE_GAP_H
+#define HOST_STUB_BLE_GAP_H
+
+#include "nimble/ble.h"
+
+#define BLE_GAP_EVENT_DISC  7
+
+struct ble_gap_disc_desc {
+    uint8_t event_type;
+    uint8_t length_data;
+    ble_addr_t addr;
+    int8_t rssi;
+    const uint8_t *data;
+    ble_addr_t direct_addr;
+};
+
+struct ble_gap_event {
+    uint8_t type;
+    union {
+        struct ble_gap_disc_desc disc;
+    };
+};
+
+typedef int ble_gap_event_fn(struct ble_gap_event *event, void *arg);
+
+struct ble_gap_disc_params {
+    uint16_t itvl;
+    uint16_t window;
+    uint8_t filter_policy;
+    uint8_t limited;
+    uint8_t passive;
+    uint8_t filter_duplicates;
+};
+
+int ble_gap_disc(uint8_t own_addr_type, int32_t duration_ms, const struct ble_gap_disc_params *disc_params,
+                 ble_gap_event_fn *cb, void *cb_arg);
+int ble_gap_disc_cancel(void);
+
+#endif // HOST_STUB_BLE_GAP_H
@@ -0,0 +1,26 @@
+// host/ble_hs.h, host stand-in for the NimBLE header; the test defines
+// ble_hs_cfg
+
+#ifndef HOST_STUB_BLE_HS_H
+#define HOST_STUB_BLE_HS_H
+
+#include <stdint.h>
+#include "host/ble_gap.h"
+
+#define BLE_HS_EALREADY                  2
+#define BLE_HS_EBUSY                     15
+#define BLE_HS_FOREVER                   INT32_MAX
+#define BLE_HS_ADV_MAX_SZ                31
+#define BLE_HCI_SCAN_ITVL_DEF            0x0010
+#define BLE_HCI_SCAN_WINDOW_DEF          0x0010
+#define BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP  4
+
+typedef void ble_hs_sync_fn(void);
+
+struct ble_hs_cfg {
+    ble_hs_sync_fn *sync_cb;
+};
+
+extern struct ble_hs_cfg ble_hs_cfg;
+
+#endif // HOST_STUB_BLE_HS_H
@@ -0,0 +1,23 @@
+// lvgl.h, host stand-in for LVGL with the types the display headers name
+
+#ifndef HOST_STUB_LVGL_H
+#define HOST_STUB_LVGL_H
+
+#include <stdint.h>
+
+typedef struct lv_obj lv_obj_t;
+typedef struct lv_img_dsc lv_img_dsc_t;
+
+typedef struct {
+    uint16_t full;
+} lv_color_t;
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int state;
+} lv_indev_data_t;
+
+#define LV_IMG_DECLARE(name) extern const lv_img_dsc_t name
+
+#endif // HOST_STUB_LVGL_H
@@ -0,0 +1,18 @@
+// nimble/ble.h, host stand-in for the NimBLE header with the address types
+
+#ifndef HOST_STUB_NIMBLE_BLE_H
+#define HOST_STUB_NIMBLE_BLE_H
+
+#include <stdint.h>
+
+#define BLE_ADDR_PUBLIC      0x00
+#define BLE_ADDR_RANDOM      0x01
+#define BLE_ADDR_PUBLIC_ID   0x02
+#define BLE_OWN_ADDR_PUBLIC  0x00
+
+typedef struct {
+    uint8_t type;
+    uint8_t val[6];
+} ble_addr_t;
+
+#endif // HOST_STUB_NIMBLE_BLE_H
@@ -0,0 +1,14 @@
+// nimble/nimble_port.h, host stand-in for the NimBLE header; the test
+// provides the functions
+
+#ifndef HOST_STUB_NIMBLE_PORT_H
+#define HOST_STUB_NIMBLE_PORT_H
+
+#include <esp_err.h>
+
+esp_err_t nimble_port_init(void);
+esp_err_t nimble_port_deinit(void);
+int nimble_port_stop(void);
+void nimble_port_run(void);
+
+#endif // HOST_STUB_NIMBLE_PORT_H
@@ -0,0 +1,13 @@
+// nimble/nimble_port_freertos.h, host stand-in for the NimBLE header; the
+// test provides the functions
+
+#ifndef HOST_STUB_NIMBLE_PORT_FREERTOS_H
+#define HOST_STUB_NIMBLE_PORT_FREERTOS_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+void nimble_port_freertos_init(void (*host_task)(void *));
+void nimble_port_freertos_deinit(void);
+
+#endif // HOST_STUB_NIMBLE_PORT_FREERTOS_H
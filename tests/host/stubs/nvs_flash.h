@@ -0,0 +1,11 @@
+// nvs_flash.h, host stand-in for the ESP-IDF header; the test provides the
+// functions
+
+#ifndef HOST_STUB_NVS_FLASH_H
+#define HOST_STUB_NVS_FLASH_H
+
+#include <esp_err.h>
+
+esp_err_t nvs_flash_init(void);
+
+#endif // HOST_STUB_NVS_FLASH_H
@@ -0,0 +1,7 @@
+// sdkconfig.h, host stand-in for the generated configuration: every option
+// is off
+
+#ifndef HOST_STUB_SDKCONFIG_H
+#define HOST_STUB_SDKCONFIG_H
+
+#endif // HOST_STUB_SDKCONFIG_H
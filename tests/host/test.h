@@ -0,0 +1,57 @@
+// test.h
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+// Just enough to run the engine tests: a failed CHECK names the line and
+// exits, so the Makefile stops at the first broken test. A test binary run
+// with "bench" as its argument also runs its benchmarks.
+
+static int test_checks;
+
+#define CHECK(cond)                                                                     \
+    do {                                                                                \
+        test_checks++;                                                                  \
+        if (!(cond)) {                                                                  \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);    \
+            exit(1);                                                                    \
+        }                                                                               \
+    } while (0)
+
+#define TEST_RUN(fn)                                                                    \
+    do {                                                                                \
+        fn();                                                                           \
+        printf("  %-44s ok\n", #fn);                                                    \
+    } while (0)
+
+static inline int test_bench_requested(int argc, char **argv) {
+    return argc > 1 && strcmp(argv[1], "bench") == 0;
+}
+
+static inline double test_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline int test_done(const char *name) {
+    printf("%s: %d checks passed\n", name, test_checks);
+    return 0;
+}
+
+// xorshift32, so traces are the same on every host
+static inline uint32_t test_rand(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+#endif // HOST_TEST_H
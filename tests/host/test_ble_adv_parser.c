@@ -0,0 +1,337 @@
+#include "core/ble_adv_parser.h"
+#include "test.h"
+
+#define ADV_MAX 31
+
+typedef struct {
+    const char *what;
+    uint8_t len;
+    uint8_t data[ADV_MAX];
+} advert_t;
+
+// Adverts as the common devices send them, and one cut short
+static const advert_t corpus[] = {
+    { "airtag", 31, { 0x1E, 0xFF, 0x4C, 0x00, 0x12, 0x19, 0x10, 0x5A, 0x7B, 0x3C, 0x21, 0x9E, 0x55, 0x01, 0x02, 0x03,
+                      0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x01, 0x00 } },
+    { "nearby", 14, { 0x02, 0x01, 0x1A, 0x0A, 0xFF, 0x4C, 0x00, 0x10, 0x05, 0x41, 0x1C, 0x8E, 0x2B, 0x91 } },
+    { "ibeacon", 30, { 0x02, 0x01, 0x06, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, 0xE2, 0xC5, 0x6D, 0xB5, 0xDF, 0xFB, 0x48,
+                       0xD2, 0xB0, 0x60, 0xD0, 0xF5, 0xA7, 0x10, 0x96, 0xE0, 0x00, 0x01, 0x00, 0x02, 0xC5 } },
+    { "flipper16", 17, { 0x02, 0x01, 0x06, 0x03, 0x03, 0x82, 0x30, 0x09, 0x09, 'F', 'l', 'i', 'p', 'p', 'e', 'r',
+                         '1' } },
+    { "flipper128", 21, { 0x02, 0x01, 0x06, 0x11, 0x07, 0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10,
+                          0x00, 0x00, 0x81, 0x30, 0x00, 0x00 } },
+    { "eddystone", 27, { 0x02, 0x01, 0x06, 0x03, 0x03, 0xAA, 0xFE, 0x13, 0x16, 0xAA, 0xFE, 0x10, 0xEB, 0x03, 'e',
+                         'x', 'a', 'm', 'p', 'l', 'e', '.', 'c', 'o', 'm', '/', 0x00 } },
+    { "swiftpair", 10, { 0x09, 0xFF, 0x06, 0x00, 0x03, 0x00, 0x80, 0x4D, 0x53, 0x00 } },
+    { "tile", 15, { 0x02, 0x01, 0x06, 0x03, 0x03, 0xED, 0xFE, 0x07, 0x16, 0xED, 0xFE, 0x01, 0x02, 0x03, 0x04 } },
+    { "samsung", 27, { 0x02, 0x01, 0x18, 0x17, 0xFF, 0x75, 0x00, 0x42, 0x09, 0x81, 0x02, 0x14, 0x15, 0x03, 0x21, 0x01,
+                       0x09, 0xEF, 0x0C, 0x01, 0x47, 0x06, 0x3C, 0x0E, 0x00, 0x00, 0x00 } },
+    { "speaker", 24, { 0x02, 0x01, 0x06, 0x02, 0x0A, 0xF4, 0x03, 0x19, 0x41, 0x08, 0x0B, 0x09, 'J', 'B', 'L', ' ', 'F',
+                       'l', 'i', 'p', ' ', '5', 0x00, 0x00 } },
+    { "truncated", 12, { 0x02, 0x01, 0x06, 0x0D, 0x09, 'H', 'a', 'l', 'f', ' ', 'a', 'n' } },
+};
+
+#define CORPUS_COUNT (sizeof(corpus) / sizeof(corpus[0]))
+
+static const advert_t *find(const char *what) {
+    for (size_t i = 0; i < CORPUS_COUNT; i++) {
+        if (strcmp(corpus[i].what, what) == 0) {
+            return &corpus[i];
+        }
+    }
+    CHECK(false);
+    return NULL;
+}
+
+static bool parse(const char *what, ble_adv_t *adv) {
+    const advert_t *a = find(what);
+    return ble_adv_parse(a->data, a->len, adv);
+}
+
+static void test_corpus(void) {
+    ble_adv_t adv;
+
+    CHECK(parse("airtag", &adv) && !adv.has_flags && adv.has_mfg && adv.company_id == 0x004C);
+    CHECK(adv.mfg_len == 27 && adv.mfg_data[0] == 0x12 && adv.mfg_data[1] == 0x19);
+    CHECK(adv.raw == find("airtag")->data && adv.raw_len == 31);
+
+    CHECK(parse("ibeacon", &adv) && adv.has_flags && adv.flags == 0x06 && adv.company_id == 0x004C);
+    CHECK(adv.mfg_len == 23 && adv.mfg_data[0] == 0x02 && adv.mfg_data[1] == 0x15);
+
+    CHECK(parse("flipper16", &adv) && adv.uuid16_count == 1 && adv.uuid16[0] == 0x3082);
+    CHECK(strcmp(adv.name, "Flipper1") == 0 && adv.name_complete && ble_adv_has_service(&adv, 0x3082));
+
+    CHECK(parse("flipper128", &adv) && adv.uuid128_count == 1 && adv.uuid16_count == 0);
+    CHECK(ble_adv_has_service(&adv, 0x3081) && !ble_adv_has_service(&adv, 0x3082));
+
+    CHECK(parse("eddystone", &adv) && adv.service_data_count == 1 && adv.service_data[0].uuid == 0xFEAA);
+    CHECK(adv.service_data[0].len == 16 && adv.service_data[0].data[0] == 0x10 && ble_adv_has_service(&adv, 0xFEAA));
+
+    CHECK(parse("swiftpair", &adv) && adv.company_id == 0x0006 && adv.mfg_len == 6);
+
+    CHECK(parse("speaker", &adv) && strcmp(adv.name, "JBL Flip 5") == 0);
+    CHECK(adv.has_tx_power && adv.tx_power == -12 && adv.has_appearance && adv.appearance == 0x0841);
+
+    // What came before the cut is kept
+    CHECK(!parse("truncated", &adv) && adv.truncated && adv.has_flags && adv.name[0] == '\0');
+}
+
+static void test_malformed(void) {
+    ble_adv_t adv;
+
+    // A zero length ends the significant part, the padding after it is ignored
+    static const uint8_t padded[] = { 0x02, 0x01, 0x06, 0x00, 0x03, 0x03, 0x82, 0x30 };
+    CHECK(ble_adv_parse(padded, sizeof(padded), &adv) && adv.has_flags && adv.uuid16_count == 0);
+    CHECK(ble_adv_parse(padded, 0, &adv) && !adv.has_flags && adv.raw_len == 0);
+
+    // Lengths past the end
+    static const uint8_t over[] = { 0x02, 0x01, 0x06, 0x05, 0xFF, 0x4C, 0x00 };
+    CHECK(!ble_adv_parse(over, sizeof(over), &adv) && adv.truncated && adv.has_flags && !adv.has_mfg);
+    static const uint8_t lone_len[] = { 0x02, 0x01, 0x06, 0x03 };
+    CHECK(!ble_adv_parse(lone_len, sizeof(lone_len), &adv) && adv.has_flags);
+    static const uint8_t all_ff[] = { 0xFF, 0xFF, 0xFF };
+    CHECK(!ble_adv_parse(all_ff, sizeof(all_ff), &adv));
+
+    // Structures that only carry a type, or too little for it
+    static const uint8_t empty[] = { 0x01, 0x01, 0x01, 0x0A, 0x01, 0x19, 0x02, 0x19, 0x41, 0x01, 0xFF, 0x02, 0xFF,
+                                     0x4C, 0x02, 0x16, 0xAA, 0x01, 0x09, 0x02, 0x03, 0x82 };
+    CHECK(ble_adv_parse(empty, sizeof(empty), &adv));
+    CHECK(!adv.has_flags && !adv.has_tx_power && !adv.has_appearance && !adv.has_mfg);
+    CHECK(adv.service_data_count == 0 && adv.uuid16_count == 0 && adv.name[0] == '\0' && adv.name_complete);
+
+    // A list with a trailing odd byte keeps its whole UUIDs
+    static const uint8_t odd[] = { 0x06, 0x03, 0x0D, 0x18, 0x0F, 0x18, 0xAA };
+    CHECK(ble_adv_parse(odd, sizeof(odd), &adv) && adv.uuid16_count == 2 && adv.uuid16[1] == 0x180F);
+
+    // Lists longer than the decoded arrays are cut
+    uint8_t many[48] = { 0x13, 0x02 };
+    for (int i = 0; i < 9; i++) {
+        many[2 + 2 * i] = (uint8_t)i;
+    }
+    many[20] = 0x15;
+    many[21] = 0x05;
+    CHECK(ble_adv_parse(many, 42, &adv) && adv.uuid16_count == BLE_ADV_MAX_UUID16 && adv.uuid32_count == 4);
+    CHECK(adv.uuid16[7] == 7);
+
+    // Service data up to its limit, the first manufacturer data wins
+    static const uint8_t repeated[] = { 0x03, 0x16, 0x01, 0x00, 0x03, 0x16, 0x02, 0x00, 0x03, 0x16, 0x03, 0x00, 0x03,
+                                        0x16, 0x04, 0x00, 0x04, 0xFF, 0x4C, 0x00, 0x01, 0x04, 0xFF, 0x06, 0x00, 0x02 };
+    CHECK(ble_adv_parse(repeated, sizeof(repeated), &adv) && adv.service_data_count == BLE_ADV_MAX_SERVICE_DATA);
+    CHECK(adv.service_data[2].uuid == 3 && adv.service_data[2].len == 0 && adv.company_id == 0x004C);
+
+    // A complete name wins over a shortened one in either order, long names are cut
+    static const uint8_t names[] = { 0x05, 0x09, 'F', 'u', 'l', 'l', 0x03, 0x08, 'S', 'h' };
+    CHECK(ble_adv_parse(names, sizeof(names), &adv) && strcmp(adv.name, "Full") == 0 && adv.name_complete);
+    CHECK(ble_adv_parse(names + 6, 4, &adv) && strcmp(adv.name, "Sh") == 0 && !adv.name_complete);
+    uint8_t long_name[64] = { 41, 0x09 };
+    memset(&long_name[2], 'n', 40);
+    CHECK(ble_adv_parse(long_name, 42, &adv) && strlen(adv.name) == BLE_ADV_NAME_LEN - 1);
+
+    // Extended adverts are longer than the raw length can say
+    uint8_t ext[300] = { 0 };
+    CHECK(ble_adv_parse(ext, sizeof(ext), &adv) && adv.raw_len == 255);
+
+    // Any cut of any advert stays inside the buffer
+    for (size_t i = 0; i < CORPUS_COUNT; i++) {
+        for (size_t cut = 0; cut <= corpus[i].len; cut++) {
+            uint8_t *copy = malloc(cut > 0 ? cut : 1);
+            memcpy(copy, corpus[i].data, cut);
+            bool ok = ble_adv_parse(copy, cut, &adv);
+            CHECK(ok == !adv.truncated);
+            free(copy);
+        }
+    }
+
+    // Nor does noise
+    uint32_t rng = 0xad5;
+    for (int round = 0; round < 100000; round++) {
+        uint8_t len = (uint8_t)(test_rand(&rng) % (ADV_MAX + 1));
+        uint8_t *noise = malloc(len > 0 ? len : 1);
+        for (uint8_t k = 0; k < len; k++) {
+            noise[k] = (uint8_t)(test_rand(&rng) % 4 == 0 ? test_rand(&rng) % 8 : test_rand(&rng));
+        }
+        ble_adv_parse(noise, len, &adv);
+        CHECK(adv.uuid16_count <= BLE_ADV_MAX_UUID16 && strlen(adv.name) < BLE_ADV_NAME_LEN);
+        free(noise);
+    }
+}
+
+static void test_uuids(void) {
+    ble_adv_t adv;
+    uint32_t short_uuid;
+
+    uint8_t base[16] = { 0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x0F, 0x18, 0, 0 };
+    CHECK(ble_uuid128_to_short(base, &short_uuid) && short_uuid == 0x180F);
+    base[0] = 0xFC;
+    CHECK(!ble_uuid128_to_short(base, &short_uuid));
+
+    // 3082 in a vendor UUID is not the Flipper service
+    static const uint8_t vendor[] = { 0x11, 0x07, 0x82, 0x30, 0x82, 0x30, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                      0x88, 0x82, 0x30, 0x00, 0x00 };
+    CHECK(ble_adv_parse(vendor, sizeof(vendor), &adv) && adv.uuid128_count == 1);
+    CHECK(!ble_adv_has_service(&adv, 0x3082));
+
+    // 32-bit forms, and 16-bit lookups never match a wider UUID
+    static const uint8_t wide[] = { 0x05, 0x05, 0x82, 0x30, 0x01, 0x00 };
+    CHECK(ble_adv_parse(wide, sizeof(wide), &adv) && adv.uuid32[0] == 0x00013082);
+    CHECK(ble_adv_has_service(&adv, 0x00013082) && !ble_adv_has_service(&adv, 0x3082));
+}
+
+// What the Flipper, spam and AirTag handlers each did with the raw bytes
+// before the shared parse, kept to measure against
+
+typedef struct {
+    uint16_t uuid16[8];
+    int uuid16_count;
+    uint32_t uuid32[4];
+    int uuid32_count;
+    char uuid128[2][37];
+    int uuid128_count;
+} old_uuids_t;
+
+static bool old_company_id(const uint8_t *payload, size_t length, uint16_t *company_id) {
+    size_t index = 0;
+    while (index < length) {
+        uint8_t field_length = payload[index];
+        if (field_length == 0 || index + field_length >= length) {
+            break;
+        }
+        if (payload[index + 1] == 0xFF && field_length >= 3) {
+            *company_id = payload[index + 2] | (payload[index + 3] << 8);
+            return true;
+        }
+        index += field_length + 1;
+    }
+    return false;
+}
+
+static void old_device_name(const uint8_t *data, uint8_t data_len, char *name, size_t name_size) {
+    int index = 0;
+    while (index < data_len) {
+        uint8_t length = data[index];
+        if (length == 0) {
+            break;
+        }
+        if (data[index + 1] == BLE_AD_COMP_NAME) {
+            size_t name_len = length - 1;
+            if (name_len > name_size - 1) {
+                name_len = name_size - 1;
+            }
+            strncpy(name, (const char *)&data[index + 2], name_len);
+            name[name_len] = '\0';
+            return;
+        }
+        index += length + 1;
+    }
+    strncpy(name, "Unknown", name_size);
+}
+
+static void old_service_uuids(const uint8_t *data, uint8_t data_len, old_uuids_t *uuids) {
+    int index = 0;
+    while (index < data_len) {
+        uint8_t length = data[index];
+        if (length == 0) {
+            break;
+        }
+        uint8_t type = data[index + 1];
+        if ((type == BLE_AD_COMP_UUID16 || type == BLE_AD_INCOMP_UUID16) && uuids->uuid16_count < 8) {
+            for (int i = 0; i < length - 1 && uuids->uuid16_count < 8; i += 2) {
+                uuids->uuid16[uuids->uuid16_count++] = data[index + 2 + i] | (data[index + 3 + i] << 8);
+            }
+        } else if ((type == BLE_AD_COMP_UUID32 || type == BLE_AD_INCOMP_UUID32) && uuids->uuid32_count < 4) {
+            for (int i = 0; i < length - 1 && uuids->uuid32_count < 4; i += 4) {
+                uuids->uuid32[uuids->uuid32_count++] = (uint32_t)data[index + 2 + i] |
+                                                       ((uint32_t)data[index + 3 + i] << 8) |
+                                                       ((uint32_t)data[index + 4 + i] << 16) |
+                                                       ((uint32_t)data[index + 5 + i] << 24);
+            }
+        } else if ((type == BLE_AD_COMP_UUID128 || type == BLE_AD_INCOMP_UUID128) && uuids->uuid128_count < 2) {
+            const uint8_t *u = &data[index + 2];
+            snprintf(uuids->uuid128[uuids->uuid128_count], sizeof(uuids->uuid128[0]),
+                     "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x", u[15], u[14], u[13],
+                     u[12], u[11], u[10], u[9], u[8], u[7], u[6], u[5], u[4], u[3], u[2], u[1], u[0]);
+            uuids->uuid128_count++;
+        }
+        index += length + 1;
+    }
+}
+
+static int old_handlers(const uint8_t *data, uint8_t len) {
+    char name[32];
+    old_uuids_t uuids = { 0 };
+    uint16_t company;
+    int hits = 0;
+
+    old_device_name(data, len, name, sizeof(name));
+    old_service_uuids(data, len, &uuids);
+    for (int i = 0; i < uuids.uuid16_count; i++) {
+        hits += uuids.uuid16[i] >= 0x3081 && uuids.uuid16[i] <= 0x3083;
+    }
+    for (int i = 0; i < uuids.uuid32_count; i++) {
+        hits += uuids.uuid32[i] >= 0x3081 && uuids.uuid32[i] <= 0x3083;
+    }
+    for (int i = 0; i < uuids.uuid128_count; i++) {
+        hits += strstr(uuids.uuid128[i], "3082") != NULL || strstr(uuids.uuid128[i], "3081") != NULL ||
+                strstr(uuids.uuid128[i], "3083") != NULL;
+    }
+    hits += old_company_id(data, len, &company) && company == 0x004C;
+    for (int i = 0; len >= 4 && i <= len - 4; i++) {
+        if ((data[i] == 0x1E && data[i + 1] == 0xFF && data[i + 2] == 0x4C && data[i + 3] == 0x00) ||
+            (data[i] == 0x4C && data[i + 1] == 0x00 && data[i + 2] == 0x12 && data[i + 3] == 0x19)) {
+            hits++;
+            break;
+        }
+    }
+    return hits + name[0];
+}
+
+static int new_handlers(const uint8_t *data, uint8_t len) {
+    ble_adv_t adv;
+    int hits = 0;
+
+    ble_adv_parse(data, len, &adv);
+    for (uint32_t uuid = 0x3081; uuid <= 0x3083; uuid++) {
+        hits += ble_adv_has_service(&adv, uuid);
+    }
+    hits += adv.has_mfg && adv.company_id == 0x004C;
+    hits += adv.has_mfg && adv.company_id == 0x004C && adv.mfg_len >= 2 && adv.mfg_data[0] == 0x12 &&
+            adv.mfg_data[1] == 0x19;
+    return hits + adv.name[0];
+}
+
+// The old helpers read past malformed adverts, so both run over adverts
+// padded to ADV_MAX
+static void bench_parse(void) {
+    enum { ROUNDS = 200000 };
+    volatile int sink = 0;
+
+    double start = test_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < CORPUS_COUNT; i++) {
+            sink += old_handlers(corpus[i].data, corpus[i].len);
+        }
+    }
+    double before = (test_seconds() - start) * 1e9 / ((double)ROUNDS * CORPUS_COUNT);
+
+    start = test_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < CORPUS_COUNT; i++) {
+            sink += new_handlers(corpus[i].data, corpus[i].len);
+        }
+    }
+    double after = (test_seconds() - start) * 1e9 / ((double)ROUNDS * CORPUS_COUNT);
+
+    printf("  handlers per advert: %.1f ns each parsing for itself, %.1f ns sharing one ble_adv_parse "
+           "(%zu adverts)\n", before, after, CORPUS_COUNT);
+    (void)sink;
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_corpus);
+    TEST_RUN(test_malformed);
+    TEST_RUN(test_uuids);
+    if (test_bench_requested(argc, argv)) {
+        bench_parse();
+    }
+    return test_done("ble_adv_parser");
+}
@@ -0,0 +1,144 @@
+#include "core/ble_company_ids.h"
+#include "test.h"
+
+// The test reads the same CSV the table is generated from, so a change to
+// the list or the generator is checked against the lookup as built
+
+#define COMPANY_CSV HOST_TEST_ROOT "/scripts/ble_company_ids.csv"
+#define MAX_COMPANIES 4096
+
+typedef struct {
+    uint16_t id;
+    char name[96];
+} company_t;
+
+static company_t companies[MAX_COMPANIES];
+static size_t company_count;
+
+static int company_cmp(const void *a, const void *b) {
+    return (int)((const company_t *)a)->id - (int)((const company_t *)b)->id;
+}
+
+static void load_csv(void) {
+    FILE *f = fopen(COMPANY_CSV, "r");
+    char line[256];
+
+    CHECK(f != NULL);
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#' || strncmp(line, "id,", 3) == 0) {
+            continue;
+        }
+        char *comma = strchr(line, ',');
+        CHECK(comma != NULL && company_count < MAX_COMPANIES);
+        *comma = '\0';
+
+        char *name = comma + 1;
+        size_t len = strlen(name);
+        if (len >= 2 && name[0] == '"' && name[len - 1] == '"') {
+            name[len - 1] = '\0';
+            name++;
+        }
+        companies[company_count].id = (uint16_t)strtoul(line, NULL, 0);
+        snprintf(companies[company_count].name, sizeof(companies[company_count].name), "%s", name);
+        company_count++;
+    }
+    fclose(f);
+    CHECK(company_count > 0);
+    qsort(companies, company_count, sizeof(company_t), company_cmp);
+}
+
+static void test_every_listed_company(void) {
+    for (size_t i = 0; i < company_count; i++) {
+        const char *name = ble_company_name(companies[i].id);
+        if (name == NULL || strcmp(name, companies[i].name) != 0) {
+            fprintf(stderr, "0x%04X: want \"%s\", got \"%s\"\n", companies[i].id, companies[i].name,
+                    name != NULL ? name : "(null)");
+        }
+        CHECK(name != NULL && strcmp(name, companies[i].name) == 0);
+        CHECK(ble_company_label(companies[i].id) == name);
+    }
+    CHECK(ble_company_count() == company_count);
+
+    CHECK(strcmp(ble_company_label(0x004C), "Apple Inc.") == 0);
+    CHECK(strcmp(ble_company_label(0x0006), "Microsoft") == 0);
+    CHECK(strcmp(ble_company_label(0x00E0), "Google") == 0);
+}
+
+// Every other ID, including the ones past the end of the table, is unknown
+static void test_unlisted_ids_are_unknown(void) {
+    static uint8_t listed[0x10000];
+    uint32_t unknown = 0;
+
+    for (size_t i = 0; i < company_count; i++) {
+        listed[companies[i].id] = 1;
+    }
+    for (uint32_t id = 0; id <= 0xFFFF; id++) {
+        if (listed[id]) {
+            continue;
+        }
+        CHECK(ble_company_name((uint16_t)id) == NULL);
+        CHECK(strcmp(ble_company_label((uint16_t)id), "Unknown") == 0);
+        unknown++;
+    }
+    CHECK(unknown == 0x10000 - company_count);
+}
+
+// The direct-indexed table against a binary search over the sorted list,
+// which is what a lookup would cost without it
+static const char *bsearch_name(uint16_t id) {
+    size_t lo = 0, hi = company_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (companies[mid].id == id) {
+            return companies[mid].name;
+        }
+        if (companies[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+static void bench_lookup(void) {
+    enum { LOOKUPS = 10000000 };
+    uint16_t *ids = malloc(LOOKUPS * sizeof(uint16_t));
+    uint32_t rng = 3;
+    size_t hits = 0, check = 0;
+
+    CHECK(ids != NULL);
+    // Half the lookups are companies seen in the wild, half random IDs
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        uint32_t r = test_rand(&rng);
+        ids[i] = (i & 1) ? companies[r % company_count].id : (uint16_t)r;
+    }
+
+    double start = test_seconds();
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        hits += ble_company_name(ids[i]) != NULL;
+    }
+    double table = test_seconds() - start;
+
+    start = test_seconds();
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        check += bsearch_name(ids[i]) != NULL;
+    }
+    double search = test_seconds() - start;
+
+    CHECK(hits == check);
+    printf("  ble_company_name: %.2f ns/lookup, binary search over %lu entries: %.2f ns/lookup\n",
+           table * 1e9 / LOOKUPS, (unsigned long)company_count, search * 1e9 / LOOKUPS);
+    free(ids);
+}
+
+int main(int argc, char **argv) {
+    load_csv();
+    TEST_RUN(test_every_listed_company);
+    TEST_RUN(test_unlisted_ids_are_unknown);
+    if (test_bench_requested(argc, argv)) {
+        bench_lookup();
+    }
+    return test_done("ble_company_ids");
+}
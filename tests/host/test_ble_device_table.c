@@ -0,0 +1,176 @@
+#include "core/ble_device_table.h"
+#include "test.h"
+
+static const uint8_t adv_apple[] = { 2, 1, 6, 3, 0xFF, 0x4C, 0x00 };
+static const uint8_t adv_apple2[] = { 2, 1, 6, 3, 0xFF, 0x4C, 0x01 };
+static const uint8_t scan_rsp[] = { 5, 9, 'a', 'b', 'c', 'd' };
+
+static void make_addr(uint8_t addr[6], uint32_t id) {
+    addr[0] = 0xC0;
+    addr[1] = 0x01;
+    addr[2] = (uint8_t)(id >> 24);
+    addr[3] = (uint8_t)(id >> 16);
+    addr[4] = (uint8_t)(id >> 8);
+    addr[5] = (uint8_t)id;
+}
+
+static void test_events(void) {
+    ble_device_table_t t;
+    ble_adv_t a1, a2, rsp;
+    ble_device_event_t ev;
+    uint8_t addr[6] = { 1, 2, 3, 4, 5, 6 };
+
+    CHECK(!ble_device_table_init(&t, 100));
+    CHECK(t.devices == NULL);
+    CHECK(ble_device_table_init(&t, 128));
+    CHECK(ble_adv_parse(adv_apple, sizeof(adv_apple), &a1));
+    CHECK(ble_adv_parse(adv_apple2, sizeof(adv_apple2), &a2));
+    CHECK(ble_adv_parse(scan_rsp, sizeof(scan_rsp), &rsp));
+
+    ble_device_t *d = ble_device_table_update(&t, 0, addr, -60, false, &a1, 1000, &ev);
+    CHECK(d != NULL && ev == BLE_DEVICE_NEW);
+    ble_device_table_update(&t, 0, addr, -50, false, &a1, 1100, &ev);
+    CHECK(ev == BLE_DEVICE_SEEN);
+
+    // A scan response is tracked apart from the advertisement
+    ble_device_table_update(&t, 0, addr, -50, true, &rsp, 1150, &ev);
+    CHECK(ev == BLE_DEVICE_SEEN);
+    CHECK(strcmp(d->name, "abcd") == 0);
+    ble_device_table_update(&t, 0, addr, -50, false, &a1, 1200, &ev);
+    CHECK(ev == BLE_DEVICE_SEEN);
+
+    ble_device_table_update(&t, 0, addr, -70, false, &a2, 1300, &ev);
+    CHECK(ev == BLE_DEVICE_CHANGED);
+
+    // Same address, other address type: another device
+    ble_device_table_update(&t, 1, addr, -70, false, &a2, 1300, &ev);
+    CHECK(ev == BLE_DEVICE_NEW);
+    CHECK(t.count == 2);
+
+    ble_device_table_update(&t, 0, addr, -70, false, &a2, 1300 + BLE_DEVICE_ABSENT_MS + 1, &ev);
+    CHECK(ev == BLE_DEVICE_RETURNED);
+    CHECK(d->rssi_min == -70 && d->rssi_max == -50);
+    CHECK(d->adv_count == 6 && d->payload_changes == 1);
+    CHECK(d->has_mfg && d->company_id == 0x014C);
+
+    CHECK(ble_device_table_expire(&t, 1300 + BLE_DEVICE_EXPIRE_MS + 1, BLE_DEVICE_EXPIRE_MS) == 1);
+    CHECK(t.count == 1);
+    CHECK(ble_device_table_find(&t, 0, addr) == d);
+    CHECK(ble_device_table_find(&t, 1, addr) == NULL);
+
+    uint32_t order[128];
+    CHECK(ble_device_table_sort(&t, order, 128) == 1);
+    ble_device_table_free(&t);
+    CHECK(ble_device_table_update(&t, 0, addr, -70, false, &a2, 0, &ev) == NULL);
+}
+
+static void test_full_table_recycles(void) {
+    ble_device_table_t t;
+    ble_adv_t adv;
+    ble_device_event_t ev;
+    uint8_t addr[6];
+
+    CHECK(ble_device_table_init(&t, 128));
+    CHECK(ble_adv_parse(adv_apple, sizeof(adv_apple), &adv));
+    for (uint32_t i = 0; i < 1000; i++) {
+        make_addr(addr, i);
+        CHECK(ble_device_table_update(&t, 0, addr, -40, false, &adv, i, &ev) != NULL);
+        CHECK(ev == BLE_DEVICE_NEW);
+    }
+    CHECK(t.count <= 128);
+    CHECK(t.evictions == 1000 - t.count);
+
+    // The newest devices are the ones still there
+    make_addr(addr, 999);
+    CHECK(ble_device_table_find(&t, 0, addr) != NULL);
+    ble_device_table_free(&t);
+}
+
+static void test_capacity_for(void) {
+    CHECK(ble_device_table_capacity_for(1) == BLE_DEVICE_TABLE_MAX_PROBE);
+    CHECK(ble_device_table_capacity_for(BLE_DEVICE_TABLE_DEFAULT_DEVICES) == BLE_DEVICE_TABLE_DEFAULT_CAPACITY);
+    CHECK(ble_device_table_capacity_for(1000) == 2048);
+    CHECK(ble_device_table_capacity_for(5000) == 8192);
+    CHECK(ble_device_table_capacity_for(BLE_DEVICE_TABLE_MAX_DEVICES) == BLE_DEVICE_TABLE_MAX_CAPACITY);
+    CHECK(ble_device_table_capacity_for(100000) == BLE_DEVICE_TABLE_MAX_CAPACITY);
+
+    // Every size it picks is one init accepts
+    for (uint32_t n = 1; n <= BLE_DEVICE_TABLE_MAX_DEVICES; n += 97) {
+        ble_device_table_t t;
+        CHECK(ble_device_table_init(&t, ble_device_table_capacity_for(n)));
+        ble_device_table_free(&t);
+    }
+}
+
+// Devices stay put once the table is sized for the crowd: a sized table
+// only reports each device as new once
+static void test_sized_table_holds_crowd(void) {
+    ble_device_table_t t;
+    ble_adv_t adv;
+    ble_device_event_t ev;
+    uint8_t addr[6];
+    uint32_t rng = 5;
+    uint32_t news = 0;
+
+    CHECK(ble_device_table_init(&t, ble_device_table_capacity_for(1000)));
+    CHECK(ble_adv_parse(adv_apple, sizeof(adv_apple), &adv));
+    for (uint32_t i = 0; i < 100000; i++) {
+        make_addr(addr, test_rand(&rng) % 1000);
+        ble_device_table_update(&t, 0, addr, -50, false, &adv, i / 100, &ev);
+        news += ev == BLE_DEVICE_NEW;
+    }
+    CHECK(t.evictions < 10);
+    CHECK(news == t.count + t.evictions);
+    ble_device_table_free(&t);
+}
+
+// Random crowd of n devices advertising at the same rate, against the
+// default table and one sized with ble_device_table_capacity_for(n)
+static void bench_crowd(uint32_t n) {
+    uint8_t (*addrs)[6] = malloc((size_t)n * 6);
+    uint32_t caps[2] = { BLE_DEVICE_TABLE_DEFAULT_CAPACITY, ble_device_table_capacity_for(n) };
+    ble_adv_t adv;
+    uint32_t rng = 11;
+
+    CHECK(addrs != NULL);
+    CHECK(ble_adv_parse(adv_apple, sizeof(adv_apple), &adv));
+    for (uint32_t i = 0; i < n; i++) {
+        for (int j = 0; j < 6; j++) {
+            addrs[i][j] = (uint8_t)test_rand(&rng);
+        }
+    }
+
+    for (int c = 0; c < 2; c++) {
+        ble_device_table_t t;
+        ble_device_event_t ev;
+        const uint32_t adverts = 2000000;
+        uint32_t notify = 0;
+
+        CHECK(ble_device_table_init(&t, caps[c]));
+        double start = test_seconds();
+        for (uint32_t k = 0; k < adverts; k++) {
+            uint32_t i = test_rand(&rng) % n;
+            ble_device_table_update(&t, 0, addrs[i], -50 - (int8_t)(i & 31), false, &adv, k / 100, &ev);
+            notify += ev != BLE_DEVICE_SEEN;
+        }
+        double secs = test_seconds() - start;
+        printf("  %5lu devices, %4lu slots: %5.1f ns/advert, %5.2f%% reported new, %lu evictions, %lu bytes\n",
+               (unsigned long)n, (unsigned long)caps[c], secs * 1e9 / adverts, 100.0 * notify / adverts,
+               (unsigned long)t.evictions, (unsigned long)(caps[c] * sizeof(ble_device_t)));
+        ble_device_table_free(&t);
+    }
+    free(addrs);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_events);
+    TEST_RUN(test_full_table_recycles);
+    TEST_RUN(test_capacity_for);
+    TEST_RUN(test_sized_table_holds_crowd);
+    if (test_bench_requested(argc, argv)) {
+        bench_crowd(100);
+        bench_crowd(1000);
+        bench_crowd(5000);
+    }
+    return test_done("ble_device_table");
+}
@@ -0,0 +1,532 @@
+#include "core/ble_lifecycle.h"
+#include "managers/ble_manager.h"
+#include "managers/alert_manager.h"
+#include "managers/rgb_manager.h"
+#include "host/ble_hs.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <nvs_flash.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "test.h"
+
+// The state machine on its own, with stub ops, then ble_manager.c on top of
+// it with NimBLE, FreeRTOS and esp_timer stubbed on a fake clock. Both run
+// on the test thread: the idle task runs when the test says so, which is
+// how a new user gets in between the idle timer and the teardown.
+
+#define IDLE_MS  BLE_STACK_DEFAULT_IDLE_MS
+
+typedef struct {
+    int start_rc;
+    int stop_rc;
+    int starts;
+    int stops;
+    ble_lifecycle_t *lc;
+    int reentrant_rc;            // What an acquire from inside an op returned
+} stub_ops_t;
+
+static int stub_start(void *ctx) {
+    stub_ops_t *ops = ctx;
+    ops->starts++;
+    CHECK(ops->lc->state == BLE_STACK_STARTING);
+    ops->reentrant_rc = ble_lifecycle_acquire(ops->lc);
+    return ops->start_rc;
+}
+
+static int stub_stop(void *ctx) {
+    stub_ops_t *ops = ctx;
+    ops->stops++;
+    CHECK(ops->lc->state == BLE_STACK_STOPPING);
+    ops->reentrant_rc = ble_lifecycle_acquire(ops->lc);
+    return ops->stop_rc;
+}
+
+static void lifecycle_init(ble_lifecycle_t *lc, stub_ops_t *ops) {
+    memset(ops, 0, sizeof(*ops));
+    ops->lc = lc;
+    ble_lifecycle_ops_t o = { .start = stub_start, .stop = stub_stop, .ctx = ops };
+    ble_lifecycle_init(lc, &o, IDLE_MS);
+}
+
+static void test_lifecycle_idle(void) {
+    ble_lifecycle_t lc;
+    stub_ops_t ops;
+    lifecycle_init(&lc, &ops);
+
+    // Nothing starts until the first user, nothing is due while off
+    CHECK(lc.state == BLE_STACK_OFF && ble_lifecycle_idle_remaining_ms(&lc, 0) == UINT32_MAX);
+    CHECK(!ble_lifecycle_poll(&lc, IDLE_MS * 10));
+
+    // Start the clock just short of a wrap
+    uint32_t t = UINT32_MAX - IDLE_MS / 2;
+    CHECK(ble_lifecycle_acquire(&lc) == 0 && ops.starts == 1 && lc.state == BLE_STACK_ON);
+    CHECK(ble_lifecycle_acquire(&lc) == 0 && ops.starts == 1 && lc.users == 2);
+
+    // Only the last user leaving starts the idle time
+    ble_lifecycle_release(&lc, t);
+    CHECK(ble_lifecycle_idle_remaining_ms(&lc, t) == UINT32_MAX);
+    ble_lifecycle_release(&lc, t + 5);
+    CHECK(ble_lifecycle_idle_remaining_ms(&lc, t + 5) == IDLE_MS);
+    CHECK(ble_lifecycle_idle_remaining_ms(&lc, t + 5 + IDLE_MS - 1) == 1);
+    CHECK(!ble_lifecycle_poll(&lc, t + 5 + IDLE_MS - 1) && ops.stops == 0);
+    CHECK(ble_lifecycle_poll(&lc, t + 5 + IDLE_MS) && ops.stops == 1);
+    CHECK(lc.state == BLE_STACK_OFF && lc.starts == 1 && lc.stops == 1);
+    CHECK(!ble_lifecycle_poll(&lc, t + 5 + IDLE_MS * 2) && ops.stops == 1);
+
+    // A release too many does not wrap the count
+    ble_lifecycle_release(&lc, t);
+    CHECK(lc.users == 0);
+
+    // shutdown skips the wait, but not with a user
+    CHECK(ble_lifecycle_acquire(&lc) == 0 && ops.starts == 2);
+    CHECK(!ble_lifecycle_shutdown(&lc) && lc.state == BLE_STACK_ON);
+    ble_lifecycle_release(&lc, 0);
+    CHECK(ble_lifecycle_shutdown(&lc) && lc.state == BLE_STACK_OFF && ops.stops == 2);
+    CHECK(!ble_lifecycle_shutdown(&lc));
+
+    CHECK(strcmp(ble_stack_state_name(BLE_STACK_STOPPING), "stopping") == 0);
+    CHECK(strcmp(ble_stack_state_name((ble_stack_state_t)7), "unknown") == 0);
+}
+
+static void test_lifecycle_race(void) {
+    ble_lifecycle_t lc;
+    stub_ops_t ops;
+    lifecycle_init(&lc, &ops);
+
+    // A new user before the poll keeps the stack, and its release starts
+    // the idle time over
+    CHECK(ble_lifecycle_acquire(&lc) == 0);
+    ble_lifecycle_release(&lc, 1000);
+    CHECK(ble_lifecycle_acquire(&lc) == 0 && lc.users == 1);
+    CHECK(!ble_lifecycle_poll(&lc, 1000 + IDLE_MS) && ops.stops == 0 && lc.state == BLE_STACK_ON);
+    ble_lifecycle_release(&lc, 1000 + IDLE_MS);
+    CHECK(!ble_lifecycle_poll(&lc, 1000 + IDLE_MS * 2 - 1));
+    CHECK(ble_lifecycle_poll(&lc, 1000 + IDLE_MS * 2) && ops.stops == 1);
+
+    // A user arriving while the stack starts or stops is turned away
+    // rather than counted against a stack in flux
+    CHECK(ble_lifecycle_acquire(&lc) == 0 && ops.starts == 2 && ops.reentrant_rc == -1 && lc.users == 1);
+    ble_lifecycle_release(&lc, 0);
+    CHECK(ble_lifecycle_poll(&lc, IDLE_MS) && ops.reentrant_rc == -1 && lc.users == 0);
+
+    // A stop that fails leaves the stack up, and the next poll tries again
+    CHECK(ble_lifecycle_acquire(&lc) == 0);
+    ble_lifecycle_release(&lc, 0);
+    ops.stop_rc = 5;
+    CHECK(!ble_lifecycle_poll(&lc, IDLE_MS) && lc.state == BLE_STACK_ON && lc.failures == 1);
+    CHECK(ble_lifecycle_idle_remaining_ms(&lc, IDLE_MS) == 0);
+    ops.stop_rc = 0;
+    CHECK(ble_lifecycle_poll(&lc, IDLE_MS + 1000) && lc.state == BLE_STACK_OFF);
+}
+
+static void test_lifecycle_start_failure(void) {
+    ble_lifecycle_t lc;
+    stub_ops_t ops;
+    lifecycle_init(&lc, &ops);
+
+    // The error comes back, no user is counted and there is nothing to tear down
+    ops.start_rc = 0x107;
+    CHECK(ble_lifecycle_acquire(&lc) == 0x107);
+    CHECK(lc.state == BLE_STACK_OFF && lc.users == 0 && lc.failures == 1 && lc.starts == 0);
+    CHECK(ble_lifecycle_idle_remaining_ms(&lc, IDLE_MS) == UINT32_MAX && !ble_lifecycle_shutdown(&lc));
+
+    // The next user tries again
+    ops.start_rc = 0;
+    CHECK(ble_lifecycle_acquire(&lc) == 0 && ops.starts == 2 && lc.starts == 1 && lc.users == 1);
+}
+
+// Everything below stands in for what ble_manager.c runs on
+
+static int64_t clock_us;
+
+int64_t esp_timer_get_time(void) {
+    return clock_us;
+}
+
+struct esp_timer {
+    void (*callback)(void *arg);
+    void *arg;
+    bool armed;
+    int64_t due_us;
+};
+
+static struct esp_timer idle_timer;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+    CHECK(idle_timer.callback == NULL);
+    idle_timer.callback = args->callback;
+    idle_timer.arg = args->arg;
+    *out = &idle_timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    CHECK(!timer->armed);
+    timer->armed = true;
+    timer->due_us = clock_us + (int64_t)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    bool was_armed = timer->armed;
+    timer->armed = false;
+    return was_armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+// Move the clock on, firing the idle timer if it comes due
+static void advance_ms(uint32_t ms) {
+    clock_us += (int64_t)ms * 1000;
+    if (idle_timer.armed && clock_us >= idle_timer.due_us) {
+        idle_timer.armed = false;
+        idle_timer.callback(idle_timer.arg);
+    }
+}
+
+static uint32_t timer_remaining_ms(void) {
+    return idle_timer.armed ? (uint32_t)((idle_timer.due_us - clock_us) / 1000) : UINT32_MAX;
+}
+
+struct host_semaphore {
+    int count;
+};
+
+static struct host_semaphore lifecycle_mutex = { 1 };
+static struct host_semaphore sync_sem;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return &lifecycle_mutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return &sync_sem;
+}
+
+// Nobody else runs, so a wait that cannot be met just passes the time
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+    if (sem->count > 0) {
+        sem->count--;
+        return pdTRUE;
+    }
+    CHECK(wait != portMAX_DELAY);
+    clock_us += (int64_t)wait * 1000;
+    return pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    sem->count = 1;
+    return pdTRUE;
+}
+
+static void (*idle_task)(void *);
+static void *idle_task_arg;
+static int tasks_created;
+static bool create_fails;
+
+BaseType_t xTaskCreate(void (*task)(void *), const char *name, uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *out) {
+    CHECK(strcmp(name, "ble_idle") == 0 && idle_task == NULL);
+    if (create_fails) {
+        return pdFALSE;
+    }
+    tasks_created++;
+    idle_task = task;
+    idle_task_arg = arg;
+    *out = (TaskHandle_t)&idle_task;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    CHECK(task == NULL);
+    idle_task = NULL;
+}
+
+static void run_idle_task(void) {
+    CHECK(idle_task != NULL);
+    int lock = lifecycle_mutex.count;
+    idle_task(idle_task_arg);
+    CHECK(idle_task == NULL && lifecycle_mutex.count == lock);
+}
+
+// NimBLE: the host syncs with the controller as soon as its task starts
+struct ble_hs_cfg ble_hs_cfg;
+static esp_err_t init_rc;
+static bool sync_fails;
+static int disc_rc;
+static bool stack_up;
+static bool scanning;
+static int stack_starts;
+static int stack_stops;
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nimble_port_init(void) {
+    CHECK(!stack_up);
+    if (init_rc != ESP_OK) {
+        return init_rc;
+    }
+    stack_up = true;
+    stack_starts++;
+    return ESP_OK;
+}
+
+void nimble_port_freertos_init(void (*host_task)(void *)) {
+    if (!sync_fails) {
+        ble_hs_cfg.sync_cb();
+    }
+}
+
+void nimble_port_freertos_deinit(void) {
+}
+
+void nimble_port_run(void) {
+}
+
+int nimble_port_stop(void) {
+    CHECK(stack_up);
+    scanning = false;
+    return 0;
+}
+
+esp_err_t nimble_port_deinit(void) {
+    stack_up = false;
+    stack_stops++;
+    return ESP_OK;
+}
+
+int ble_gap_disc(uint8_t own_addr_type, int32_t duration_ms, const struct ble_gap_disc_params *disc_params,
+                 ble_gap_event_fn *cb, void *cb_arg) {
+    CHECK(stack_up);
+    if (scanning) {
+        return BLE_HS_EALREADY;
+    }
+    if (disc_rc != 0) {
+        return disc_rc;
+    }
+    scanning = true;
+    return 0;
+}
+
+int ble_gap_disc_cancel(void) {
+    if (!scanning) {
+        return BLE_HS_EALREADY;
+    }
+    scanning = false;
+    return 0;
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return 200000;
+}
+
+// The device table is the scan's one allocation
+static bool calloc_fails;
+
+void *__real_calloc(size_t n, size_t size);
+
+void *__wrap_calloc(size_t n, size_t size) {
+    return calloc_fails ? NULL : __real_calloc(n, size);
+}
+
+esp_err_t alert_manager_post(alert_severity_t severity, const char *source, const char *fmt, ...) {
+    return ESP_OK;
+}
+
+RGBManager_t rgb_manager;
+
+esp_err_t rgb_manager_post_event(uint8_t red, uint8_t green, uint8_t blue, led_pattern_t pattern,
+                                 led_event_priority_t priority) {
+    return ESP_OK;
+}
+
+esp_err_t rgb_manager_set_color(RGBManager_t *rgb_manager, int led_idx, uint8_t red, uint8_t green, uint8_t blue,
+                                bool pulse) {
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size) {
+    return (int)size;
+}
+
+int get_next_pcap_file_index(const char *base_name) {
+    return 0;
+}
+
+// The manager reports every start and stop on stdout
+static int saved_stdout = -1;
+
+static void quiet(bool on) {
+    fflush(stdout);
+    if (on) {
+        saved_stdout = dup(STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    } else {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+}
+
+// Take the stack down and check nothing is left behind
+static void settle(void) {
+    stop_ble_stack();
+    CHECK(!stack_up && !scanning && !idle_timer.armed && idle_task == NULL);
+}
+
+static void test_manager_idle_teardown(void) {
+    quiet(true);
+
+    ble_start_scanning();
+    CHECK(stack_up && scanning && stack_starts == 1);
+    CHECK(ble_pause_scanning() == ESP_OK && !scanning);
+    CHECK(ble_resume_scanning() == ESP_OK && scanning);
+
+    // Stopping the scan only arms the idle timer
+    ble_stop();
+    CHECK(!scanning && stack_up && timer_remaining_ms() == IDLE_MS);
+    advance_ms(IDLE_MS - 1);
+    CHECK(tasks_created == 0);
+
+    // The timer callback hands the teardown to a task, once
+    advance_ms(1);
+    CHECK(tasks_created == 1 && stack_up);
+    idle_timer.callback(idle_timer.arg);
+    CHECK(tasks_created == 1);
+    run_idle_task();
+    CHECK(!stack_up && stack_stops == 1 && !idle_timer.armed);
+
+    // The lifecycle lock is busy: the task gives up and the timer retries
+    ble_start_scanning();
+    ble_stop();
+    advance_ms(IDLE_MS);
+    lifecycle_mutex.count = 0;
+    run_idle_task();
+    lifecycle_mutex.count = 1;
+    CHECK(stack_up && timer_remaining_ms() == 1000);
+    advance_ms(1000);
+    run_idle_task();
+    CHECK(!stack_up && stack_stops == 2);
+
+    // No memory for the task: the timer retries as well
+    ble_start_scanning();
+    ble_stop();
+    create_fails = true;
+    advance_ms(IDLE_MS);
+    create_fails = false;
+    CHECK(stack_up && idle_task == NULL && timer_remaining_ms() == 1000);
+    advance_ms(1000);
+    run_idle_task();
+    CHECK(!stack_up && stack_stops == 3);
+
+    settle();
+    quiet(false);
+}
+
+static void test_manager_teardown_race(void) {
+    quiet(true);
+
+    // A scan starts between the idle timer firing and its task running:
+    // the task finds a user and leaves the stack up
+    ble_start_scanning();
+    ble_stop();
+    advance_ms(IDLE_MS);
+    CHECK(idle_task != NULL);
+    int starts = stack_starts;
+    ble_start_scanning();
+    CHECK(scanning && !idle_timer.armed);
+    run_idle_task();
+    CHECK(stack_up && scanning && stack_starts == starts && !idle_timer.armed);
+
+    // Its stop waits out a whole idle timeout again
+    advance_ms(IDLE_MS / 2);
+    ble_stop();
+    CHECK(timer_remaining_ms() == IDLE_MS);
+
+    // A scan started while the timer runs stops it
+    advance_ms(IDLE_MS / 2);
+    ble_start_scanning();
+    CHECK(!idle_timer.armed && stack_starts == starts);
+    advance_ms(IDLE_MS * 2);
+    CHECK(idle_task == NULL && stack_up);
+
+    // Starting a scan that is already running keeps the one session
+    ble_start_scanning();
+    CHECK(scanning && !idle_timer.armed);
+    ble_stop();
+    CHECK(timer_remaining_ms() == IDLE_MS);
+
+    // stop_ble_stack takes it down now
+    stop_ble_stack();
+    CHECK(!stack_up && !idle_timer.armed);
+
+    settle();
+    quiet(false);
+}
+
+static void test_manager_start_failure(void) {
+    quiet(true);
+
+    // The stack does not come up: no session, nothing to tear down, and the
+    // next scan tries again
+    init_rc = ESP_FAIL;
+    ble_start_scanning();
+    CHECK(!stack_up && !scanning && !idle_timer.armed);
+    CHECK(ble_pause_scanning() == ESP_ERR_INVALID_STATE);
+    init_rc = ESP_OK;
+    sync_fails = true;
+    ble_start_scanning();
+    CHECK(!stack_up && !scanning && !idle_timer.armed);
+    sync_fails = false;
+    ble_start_scanning();
+    CHECK(stack_up && scanning);
+    ble_stop();
+    settle();
+
+    // Discovery fails on a stack that came up: the session ends and the
+    // stack goes idle instead of holding its reference forever
+    disc_rc = BLE_HS_EBUSY;
+    ble_start_scanning();
+    disc_rc = 0;
+    CHECK(stack_up && !scanning && timer_remaining_ms() == IDLE_MS);
+    CHECK(ble_resume_scanning() == ESP_ERR_INVALID_STATE);
+    advance_ms(IDLE_MS);
+    run_idle_task();
+    CHECK(!stack_up);
+
+    // The same when there is no memory for the device table
+    ble_set_device_capacity(BLE_DEVICE_TABLE_DEFAULT_CAPACITY * 2);
+    calloc_fails = true;
+    ble_start_scanning();
+    calloc_fails = false;
+    CHECK(stack_up && !scanning && timer_remaining_ms() == IDLE_MS);
+    advance_ms(IDLE_MS);
+    run_idle_task();
+    CHECK(!stack_up);
+
+    // And a scan after either works
+    ble_start_scanning();
+    CHECK(stack_up && scanning);
+    ble_stop();
+
+    settle();
+    quiet(false);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_lifecycle_idle);
+    TEST_RUN(test_lifecycle_race);
+    TEST_RUN(test_lifecycle_start_failure);
+    TEST_RUN(test_manager_idle_teardown);
+    TEST_RUN(test_manager_teardown_race);
+    TEST_RUN(test_manager_start_failure);
+    return test_done("ble_lifecycle");
+}
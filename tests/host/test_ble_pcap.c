@@ -0,0 +1,246 @@
+#include "core/ble_pcap.h"
+#include "vendor/pcap.h"
+#include "driver/uart.h"
+#include "test.h"
+
+#define MARK_BEGIN  "[BUF/BEGIN]"
+#define MARK_CLOSE  "[BUF/CLOSE]\n"
+
+// Everything pcap.c sends to the console
+static uint8_t *serial;
+static size_t serial_len;
+static size_t serial_cap;
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size) {
+    if (serial_len + size > serial_cap) {
+        serial_cap = (serial_len + size) * 2;
+        serial = realloc(serial, serial_cap);
+    }
+    memcpy(serial + serial_len, src, size);
+    serial_len += size;
+    return (int)size;
+}
+
+int get_next_pcap_file_index(const char *base_name) {
+    return 0;
+}
+
+// Rebuild the capture file from the framed console output, as the host side
+// of a serial capture does. Returns its length, 0 on a framing error.
+static size_t unframe(uint8_t *out, size_t out_size) {
+    size_t pos = 0;
+    size_t len = 0;
+    const size_t begin_len = strlen(MARK_BEGIN);
+    const size_t close_len = strlen(MARK_CLOSE);
+
+    while (pos < serial_len) {
+        if (serial_len - pos < begin_len || memcmp(serial + pos, MARK_BEGIN, begin_len) != 0) {
+            return 0;
+        }
+        pos += begin_len;
+        size_t chunk = 0;
+        while (pos + chunk + close_len <= serial_len && memcmp(serial + pos + chunk, MARK_CLOSE, close_len) != 0) {
+            chunk++;
+        }
+        if (pos + chunk + close_len > serial_len) {
+            return 0;
+        }
+        if (len + chunk > out_size) {
+            return 0;
+        }
+        memcpy(out + len, serial + pos, chunk);
+        len += chunk;
+        pos += chunk + close_len;
+    }
+    return len;
+}
+
+static uint16_t get_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return get_le16(p) | ((uint32_t)get_le16(p + 2) << 16);
+}
+
+static const uint8_t addr[6] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0xC6 };
+static const uint8_t target[6] = { 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6 };
+
+// The CRC goes out least significant byte first, so running the same CRC over
+// the PDU and its CRC leaves nothing
+static bool crc_ok(const uint8_t *frame, size_t len) {
+    const uint8_t *pdu = frame + BLE_PCAP_PHDR_LEN + 4;
+    return ble_ll_crc(pdu, len - BLE_PCAP_PHDR_LEN - 4, BLE_ADV_CRC_INIT) == 0;
+}
+
+static void test_frame_fields(void) {
+    uint8_t data[BLE_PCAP_MAX_ADV_DATA];
+    uint8_t frame[BLE_PCAP_MAX_FRAME];
+
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(0xE0 + i);
+    }
+
+    // A full legacy advert from a random address, channel unknown
+    size_t len = ble_pcap_build_adv(frame, sizeof(frame), 0x00, true, addr, NULL, data, sizeof(data), -67,
+                                    BLE_PCAP_CHANNEL_UNKNOWN);
+    CHECK(len == BLE_PCAP_MAX_FRAME);
+
+    // Pseudo header
+    uint16_t flags = BLE_PHDR_FLAG_DEWHITENED | BLE_PHDR_FLAG_SIGNAL_VALID | BLE_PHDR_FLAG_REF_AA_VALID |
+                     BLE_PHDR_FLAG_CRC_CHECKED | BLE_PHDR_FLAG_CRC_VALID | BLE_PHDR_FLAG_CHANNEL_ALIASED;
+    CHECK(frame[0] == 0 && (int8_t)frame[1] == -67 && frame[2] == 0 && frame[3] == 0);
+    CHECK(get_le32(&frame[4]) == BLE_ADV_ACCESS_ADDRESS && get_le16(&frame[8]) == flags);
+
+    // Access address as sent on air, then the PDU header: ADV_IND with TxAdd
+    static const uint8_t aa[4] = { 0xD6, 0xBE, 0x89, 0x8E };
+    const uint8_t *ll = frame + BLE_PCAP_PHDR_LEN;
+    CHECK(memcmp(ll, aa, 4) == 0);
+    CHECK(ll[4] == (BLE_PDU_ADV_IND | 0x40) && ll[5] == 6 + sizeof(data));
+    CHECK(memcmp(&ll[6], addr, 6) == 0 && memcmp(&ll[12], data, sizeof(data)) == 0);
+    CHECK(crc_ok(frame, len));
+
+    // Each report type becomes its PDU type, a public address clears TxAdd
+    static const struct {
+        uint8_t report;
+        uint8_t pdu;
+    } types[] = {
+        { 0x00, BLE_PDU_ADV_IND },
+        { 0x01, BLE_PDU_ADV_DIRECT_IND },
+        { 0x02, BLE_PDU_ADV_SCAN_IND },
+        { 0x03, BLE_PDU_ADV_NONCONN_IND },
+        { 0x04, BLE_PDU_SCAN_RSP },
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        CHECK(ble_pdu_type_from_report(types[i].report) == types[i].pdu);
+        len = ble_pcap_build_adv(frame, sizeof(frame), types[i].report, false, addr, target, data, 3, -40, 37);
+        CHECK(len > 0 && ll[4] == types[i].pdu && crc_ok(frame, len));
+    }
+    CHECK(ble_pdu_type_from_report(0x05) == -1);
+
+    // Directed adverts carry the target instead of data, zeroed when unknown
+    len = ble_pcap_build_adv(frame, sizeof(frame), 0x01, false, addr, target, data, sizeof(data), -40, 37);
+    CHECK(len == BLE_PCAP_PHDR_LEN + 4 + 2 + 12 + 3 && ll[5] == 12);
+    CHECK(memcmp(&ll[6], addr, 6) == 0 && memcmp(&ll[12], target, 6) == 0 && crc_ok(frame, len));
+    len = ble_pcap_build_adv(frame, sizeof(frame), 0x01, false, addr, NULL, data, 0, -40, 37);
+    static const uint8_t zero[6] = { 0 };
+    CHECK(len > 0 && memcmp(&ll[12], zero, 6) == 0 && crc_ok(frame, len));
+
+    // Advertising channels map to RF channels
+    static const int rf[][2] = { { 37, 0 }, { 38, 12 }, { 39, 39 } };
+    for (size_t i = 0; i < 3; i++) {
+        len = ble_pcap_build_adv(frame, sizeof(frame), 0x03, true, addr, NULL, data, 5, -90, rf[i][0]);
+        CHECK(len > 0 && frame[0] == rf[i][1] && (get_le16(&frame[8]) & BLE_PHDR_FLAG_CHANNEL_ALIASED) == 0);
+    }
+    len = ble_pcap_build_adv(frame, sizeof(frame), 0x03, true, addr, NULL, data, 5, -90, 12);
+    CHECK(len > 0 && (get_le16(&frame[8]) & BLE_PHDR_FLAG_CHANNEL_ALIASED));
+
+    // What does not fit, or is not a legacy advert, is not built
+    size_t fit = BLE_PCAP_PHDR_LEN + 4 + 2 + 6 + 10 + 3;
+    CHECK(ble_pcap_build_adv(frame, fit, 0x00, true, addr, NULL, data, 10, -50, 37) == fit);
+    CHECK(ble_pcap_build_adv(frame, fit - 1, 0x00, true, addr, NULL, data, 10, -50, 37) == 0);
+    uint8_t big[BLE_PCAP_MAX_FRAME + 8];
+    CHECK(ble_pcap_build_adv(big, sizeof(big), 0x00, true, addr, NULL, big, BLE_PCAP_MAX_ADV_DATA + 1, -50, 37) == 0);
+    CHECK(ble_pcap_build_adv(frame, sizeof(frame), 0x05, true, addr, NULL, data, 10, -50, 37) == 0);
+}
+
+static void test_crc(void) {
+    uint8_t pdu[2 + 6 + BLE_PCAP_MAX_ADV_DATA + 3];
+    uint32_t rng = 0xc7c;
+
+    for (int round = 0; round < 200; round++) {
+        size_t len = 8 + test_rand(&rng) % (BLE_PCAP_MAX_ADV_DATA + 1);
+        for (size_t i = 0; i < len; i++) {
+            pdu[i] = (uint8_t)test_rand(&rng);
+        }
+        uint32_t crc = ble_ll_crc(pdu, len, BLE_ADV_CRC_INIT);
+        CHECK(crc <= 0xFFFFFF);
+
+        // Appended as sent, the residue is zero
+        pdu[len] = (uint8_t)crc;
+        pdu[len + 1] = (uint8_t)(crc >> 8);
+        pdu[len + 2] = (uint8_t)(crc >> 16);
+        CHECK(ble_ll_crc(pdu, len + 3, BLE_ADV_CRC_INIT) == 0);
+
+        // Every single bit error is caught
+        for (size_t bit = 0; bit < len * 8; bit++) {
+            pdu[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+            CHECK(ble_ll_crc(pdu, len, BLE_ADV_CRC_INIT) != crc);
+            pdu[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        }
+
+        // A different CRC init gives a different CRC
+        CHECK(ble_ll_crc(pdu, len, 0x123456) != crc);
+    }
+}
+
+static void test_capture(void) {
+    enum { ADVERTS = 300 };
+    static uint8_t frames[ADVERTS][BLE_PCAP_MAX_FRAME];
+    static size_t frame_len[ADVERTS];
+    static uint8_t file[64 * 1024];
+    uint8_t data[BLE_PCAP_MAX_ADV_DATA];
+    uint32_t rng = 0xb1e;
+
+    serial_len = 0;
+    uint32_t count = pcap_packet_count();
+
+    // No file open, so the header and the buffer go out framed on the console.
+    // 300 adverts fill the 4 KiB buffer several times over.
+    CHECK(pcap_write_global_header(NULL, PCAP_LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR) == ESP_OK);
+    for (int i = 0; i < ADVERTS; i++) {
+        size_t len = test_rand(&rng) % (BLE_PCAP_MAX_ADV_DATA + 1);
+        for (size_t k = 0; k < len; k++) {
+            data[k] = (uint8_t)test_rand(&rng);
+        }
+        frame_len[i] = ble_pcap_build_adv(frames[i], sizeof(frames[i]), (uint8_t)(i % 5), i & 1, addr, target, data,
+                                          len, (int8_t)(-30 - i % 60), BLE_PCAP_CHANNEL_UNKNOWN);
+        CHECK(frame_len[i] > 0);
+        CHECK(pcap_write_packet_to_buffer(frames[i], frame_len[i]) == ESP_OK);
+    }
+    CHECK(pcap_flush_buffer_to_file() == ESP_OK);
+    CHECK(pcap_packet_count() - count == ADVERTS);
+
+    size_t len = unframe(file, sizeof(file));
+    CHECK(len > PCAP_GLOBAL_HEADER_SIZE);
+
+    // Global header
+    CHECK(get_le32(&file[0]) == 0xa1b2c3d4 && get_le16(&file[4]) == 2 && get_le16(&file[6]) == 4);
+    CHECK(get_le32(&file[8]) == 0 && get_le32(&file[12]) == 0 && get_le32(&file[16]) == 4096);
+    CHECK(get_le32(&file[20]) == PCAP_LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR);
+
+    // Records, in order and whole
+    size_t pos = PCAP_GLOBAL_HEADER_SIZE;
+    uint64_t last_us = 0;
+    for (int i = 0; i < ADVERTS; i++) {
+        CHECK(pos + PCAP_PACKET_HEADER_SIZE <= len);
+        uint32_t usec = get_le32(&file[pos + 4]);
+        uint64_t us = get_le32(&file[pos]) * 1000000ull + usec;
+        uint32_t incl = get_le32(&file[pos + 8]);
+        CHECK(usec < 1000000 && us >= last_us);
+        CHECK(incl == frame_len[i] && get_le32(&file[pos + 12]) == incl);
+        pos += PCAP_PACKET_HEADER_SIZE;
+        CHECK(pos + incl <= len && memcmp(&file[pos], frames[i], incl) == 0);
+        CHECK(crc_ok(&file[pos], incl));
+        pos += incl;
+        last_us = us;
+    }
+    CHECK(pos == len);
+
+    // The file path writes the same header
+    char *mem = NULL;
+    size_t mem_len = 0;
+    FILE *f = open_memstream(&mem, &mem_len);
+    CHECK(pcap_write_global_header(f, PCAP_LINKTYPE_BLUETOOTH_LE_LL_WITH_PHDR) == ESP_OK);
+    fclose(f);
+    CHECK(mem_len == PCAP_GLOBAL_HEADER_SIZE && memcmp(mem, file, mem_len) == 0);
+    free(mem);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_frame_fields);
+    TEST_RUN(test_crc);
+    TEST_RUN(test_capture);
+    free(serial);
+    return test_done("ble_pcap");
+}
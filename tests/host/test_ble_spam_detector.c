@@ -0,0 +1,300 @@
+#include "core/ble_spam_detector.h"
+#include "test.h"
+
+// Trace harness: a simulated crowd of real devices (stable addresses that
+// rotate every 15 minutes, arrivals and departures), optionally with spam
+// tools on top that use a fresh address per advert. Every one-second window
+// is labelled spam or clean, and the detector's reports are scored per
+// window for precision and recall.
+
+#define TRACE_MS   300000
+#define WINDOW_MS  BLE_SPAM_DEFAULT_WINDOW_MS
+#define WINDOWS    (TRACE_MS / WINDOW_MS)
+
+typedef enum {
+    PAYLOAD_NEARBY_INFO = 0,   // Apple devices going about their business
+    PAYLOAD_APPLE_POPUP,
+    PAYLOAD_APPLE_ACTION,
+    PAYLOAD_SWIFT_PAIR,
+    PAYLOAD_SAMSUNG,
+    PAYLOAD_FAST_PAIR,
+    PAYLOAD_TILE,
+    PAYLOAD_NAME
+} payload_t;
+
+typedef struct {
+    uint32_t t;
+    uint8_t addr[6];
+    uint8_t kind;
+    uint8_t var;
+    bool spam;
+} advert_t;
+
+typedef struct {
+    advert_t *adverts;
+    size_t count;
+    size_t cap;
+    bool spam_window[WINDOWS];
+} trace_t;
+
+static uint32_t rng = 1;
+
+static size_t make_payload(uint8_t *d, payload_t kind, uint8_t var) {
+    static const uint8_t nearby[] = { 2, 1, 0x1A, 0x0A, 0xFF, 0x4C, 0x00, 0x10, 0x05, 0x01, 0x18, 0x1A, 0x2B, 0x3C };
+    static const uint8_t popup[] = { 0x1E, 0xFF, 0x4C, 0x00, 0x07, 0x19, 0x01, 0x0E, 0x20, 0x55, 0xAA, 0xB8, 0x11,
+                                     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    static const uint8_t action[] = { 0x0B, 0xFF, 0x4C, 0x00, 0x0F, 0x05, 0xC0, 0x01, 0, 0, 0, 0 };
+    static const uint8_t swift[] = { 0x0A, 0xFF, 0x06, 0x00, 0x03, 0x00, 0x80, 'M', 'o', 'u', 's' };
+    static const uint8_t samsung[] = { 0x0F, 0xFF, 0x75, 0x00, 0x42, 0x09, 0x81, 0x02, 0x14, 0x15, 0x03, 0x21,
+                                       0x01, 0x09, 0xEF, 0x0C };
+    static const uint8_t fast_pair[] = { 0x06, 0x16, 0x2C, 0xFE, 0x00, 0xB7, 0x27 };
+    static const uint8_t tile[] = { 0x03, 0x03, 0xED, 0xFE, 0x0E, 0x16, 0xED, 0xFE, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+    static const uint8_t name[] = { 0x02, 0x01, 0x06, 0x08, 0x09, 'S', 'p', 'e', 'a', 'k', 'e', 'r' };
+    static const struct { const uint8_t *p; size_t len; int var_at; } payloads[] = {
+        [PAYLOAD_NEARBY_INFO]  = { nearby, sizeof(nearby), -1 },
+        [PAYLOAD_APPLE_POPUP]  = { popup, sizeof(popup), 8 },
+        [PAYLOAD_APPLE_ACTION] = { action, sizeof(action), 7 },
+        [PAYLOAD_SWIFT_PAIR]   = { swift, sizeof(swift), -1 },
+        [PAYLOAD_SAMSUNG]      = { samsung, sizeof(samsung), 15 },
+        [PAYLOAD_FAST_PAIR]    = { fast_pair, sizeof(fast_pair), 5 },
+        [PAYLOAD_TILE]         = { tile, sizeof(tile), -1 },
+        [PAYLOAD_NAME]         = { name, sizeof(name), 11 },
+    };
+
+    memcpy(d, payloads[kind].p, payloads[kind].len);
+    if (payloads[kind].var_at >= 0) {
+        d[payloads[kind].var_at] = var;
+    }
+    return payloads[kind].len;
+}
+
+static void random_addr(uint8_t addr[6]) {
+    for (int i = 0; i < 6; i++) {
+        addr[i] = (uint8_t)test_rand(&rng);
+    }
+    addr[5] |= 0xC0;
+}
+
+static void push(trace_t *tr, uint32_t t, const uint8_t addr[6], payload_t kind, bool spam) {
+    if (tr->count == tr->cap) {
+        tr->cap = tr->cap ? tr->cap * 2 : 65536;
+        tr->adverts = realloc(tr->adverts, tr->cap * sizeof(advert_t));
+        CHECK(tr->adverts != NULL);
+    }
+    advert_t *a = &tr->adverts[tr->count++];
+    a->t = t;
+    memcpy(a->addr, addr, 6);
+    a->kind = (uint8_t)kind;
+    a->var = (uint8_t)test_rand(&rng);
+    a->spam = spam;
+    if (spam) {
+        tr->spam_window[t / WINDOW_MS] = true;
+    }
+}
+
+// devices real devices, each advertising every 100-1000 ms with a mix of
+// payloads seen in a busy public place
+static void add_crowd(trace_t *tr, int devices) {
+    for (int i = 0; i < devices; i++) {
+        uint32_t r = test_rand(&rng) % 100;
+        payload_t kind = r < 55 ? PAYLOAD_NEARBY_INFO : r < 62 ? PAYLOAD_APPLE_POPUP : r < 72 ? PAYLOAD_SAMSUNG :
+                         r < 80 ? PAYLOAD_TILE : r < 85 ? PAYLOAD_SWIFT_PAIR : PAYLOAD_NAME;
+        uint32_t period = 100 + test_rand(&rng) % 900;
+        uint32_t rotate = test_rand(&rng) % 900000;
+        uint32_t leave = 60000 + test_rand(&rng) % 600000;
+        uint8_t addr[6];
+
+        random_addr(addr);
+        for (uint32_t t = test_rand(&rng) % 1000; t < TRACE_MS; t += period * 9 / 10 + test_rand(&rng) % (period / 5 + 1)) {
+            if (t >= leave) {
+                // Replaced by a device arriving
+                random_addr(addr);
+                leave = t + 60000 + test_rand(&rng) % 600000;
+            }
+            if (t >= rotate) {
+                random_addr(addr);
+                rotate = t + 900000;
+            }
+            push(tr, t, addr, kind, false);
+        }
+    }
+}
+
+// A spam tool sending rate adverts a second from start to end (seconds), rotating
+// through kinds, each with a fresh address
+static void add_spam(trace_t *tr, uint32_t rate, const payload_t *kinds, int kind_count, uint32_t start, uint32_t end) {
+    uint8_t addr[6];
+    int k = 0;
+
+    for (uint64_t t_us = start * 1000000ull; t_us < end * 1000000ull; t_us += 1000000 / rate) {
+        random_addr(addr);
+        push(tr, (uint32_t)(t_us / 1000), addr, kinds[k++ % kind_count], true);
+    }
+}
+
+static int compare_adverts(const void *a, const void *b) {
+    const advert_t *x = a;
+    const advert_t *y = b;
+    return (x->t > y->t) - (x->t < y->t);
+}
+
+typedef struct {
+    int spam_windows;
+    int true_positives;
+    int false_positives;
+    uint32_t types_reported;     // Bit per ble_spam_type_t
+    double ns_per_advert;
+} score_t;
+
+static score_t run_trace(trace_t *tr) {
+    static ble_spam_detector_t det;
+    ble_spam_report_t reports[BLE_SPAM_MAX_REPORTS];
+    bool flagged[WINDOWS] = { false };
+    score_t score = { 0 };
+    ble_adv_t *parsed = malloc(tr->count * sizeof(ble_adv_t));
+    // ble_adv_t points into the payload, so the payloads must stay around
+    uint8_t (*payloads)[31] = malloc(tr->count * 31);
+
+    CHECK(parsed != NULL && payloads != NULL);
+    qsort(tr->adverts, tr->count, sizeof(advert_t), compare_adverts);
+    for (size_t i = 0; i < tr->count; i++) {
+        size_t len = make_payload(payloads[i], tr->adverts[i].kind, tr->adverts[i].var);
+        CHECK(ble_adv_parse(payloads[i], len, &parsed[i]));
+    }
+
+    // No hold-off, so every window that crosses the threshold reports
+    ble_spam_detector_init(&det, WINDOW_MS, BLE_SPAM_DEFAULT_THRESHOLD, 0);
+    double start = test_seconds();
+    for (size_t i = 0; i < tr->count; i++) {
+        size_t n = ble_spam_detector_update(&det, tr->adverts[i].addr, &parsed[i], tr->adverts[i].t, reports);
+        // Reports come out when the next window starts
+        uint32_t window = tr->adverts[i].t / WINDOW_MS;
+        for (size_t r = 0; r < n; r++) {
+            if (window > 0) {
+                flagged[window - 1] = true;
+            }
+            score.types_reported |= 1u << reports[r].type;
+        }
+    }
+    score.ns_per_advert = (test_seconds() - start) * 1e9 / tr->count;
+
+    // The last window never closes
+    for (int w = 0; w < WINDOWS - 1; w++) {
+        score.spam_windows += tr->spam_window[w];
+        if (flagged[w]) {
+            if (tr->spam_window[w]) {
+                score.true_positives++;
+            } else {
+                score.false_positives++;
+            }
+        }
+    }
+
+    free(parsed);
+    free(payloads);
+    free(tr->adverts);
+    memset(tr, 0, sizeof(*tr));
+    return score;
+}
+
+static double precision(const score_t *s) {
+    int flagged = s->true_positives + s->false_positives;
+    return flagged ? (double)s->true_positives / flagged : 1.0;
+}
+
+static double recall(const score_t *s) {
+    return s->spam_windows ? (double)s->true_positives / s->spam_windows : 1.0;
+}
+
+static void print_score(const char *name, const score_t *s) {
+    printf("    %-34s %3d spam windows  precision %5.1f%%  recall %5.1f%%  %4.1f ns/advert\n",
+           name, s->spam_windows, 100 * precision(s), 100 * recall(s), s->ns_per_advert);
+}
+
+static trace_t trace;
+
+static void test_busy_crowd_without_spam(void) {
+    add_crowd(&trace, 300);
+    score_t s = run_trace(&trace);
+    print_score("300 devices, no spam", &s);
+    CHECK(s.spam_windows == 0);
+    CHECK(s.false_positives == 0);
+}
+
+static void test_apple_popup_and_action(void) {
+    static const payload_t popup[] = { PAYLOAD_APPLE_POPUP };
+    static const payload_t action[] = { PAYLOAD_APPLE_ACTION };
+
+    add_crowd(&trace, 300);
+    add_spam(&trace, 20, popup, 1, 50, 120);
+    add_spam(&trace, 50, action, 1, 180, 250);
+    score_t s = run_trace(&trace);
+    print_score("Apple popup 20/s, action 50/s", &s);
+    CHECK(precision(&s) >= 0.98);
+    CHECK(recall(&s) >= 0.98);
+    CHECK(s.types_reported == ((1u << BLE_SPAM_APPLE_POPUP) | (1u << BLE_SPAM_APPLE_ACTION)));
+}
+
+static void test_interleaved_vendors(void) {
+    static const payload_t all[] = {
+        PAYLOAD_APPLE_POPUP, PAYLOAD_APPLE_ACTION, PAYLOAD_SWIFT_PAIR, PAYLOAD_SAMSUNG, PAYLOAD_FAST_PAIR
+    };
+
+    add_crowd(&trace, 300);
+    add_spam(&trace, 30, all, 5, 50, 250);
+    score_t s = run_trace(&trace);
+    print_score("5 vendors interleaved, 30/s", &s);
+    CHECK(precision(&s) >= 0.98);
+    CHECK(recall(&s) >= 0.98);
+}
+
+static void test_slow_popup(void) {
+    static const payload_t popup[] = { PAYLOAD_APPLE_POPUP };
+
+    add_crowd(&trace, 300);
+    add_spam(&trace, 8, popup, 1, 50, 250);
+    score_t s = run_trace(&trace);
+    print_score("Apple popup 8/s", &s);
+    CHECK(precision(&s) >= 0.98);
+    CHECK(recall(&s) >= 0.95);
+}
+
+static void test_address_flood(void) {
+    static const payload_t names[] = { PAYLOAD_NAME };
+
+    // Unknown payloads need BLE_SPAM_FLOOD_FACTOR times the threshold
+    add_crowd(&trace, 300);
+    add_spam(&trace, 15, names, 1, 50, 120);
+    add_spam(&trace, 40, names, 1, 180, 250);
+    score_t s = run_trace(&trace);
+    print_score("name flood 15/s, then 40/s", &s);
+    // Only the 40/s burst is above the flood threshold
+    CHECK(s.false_positives == 0);
+    CHECK(s.true_positives >= 69 && s.true_positives <= 71);
+    CHECK(s.types_reported == (1u << BLE_SPAM_GENERIC));
+}
+
+static void bench_busy_crowd(void) {
+    static const payload_t all[] = {
+        PAYLOAD_APPLE_POPUP, PAYLOAD_APPLE_ACTION, PAYLOAD_SWIFT_PAIR, PAYLOAD_SAMSUNG, PAYLOAD_FAST_PAIR
+    };
+
+    add_crowd(&trace, 1000);
+    add_spam(&trace, 100, all, 5, 0, TRACE_MS / 1000);
+    size_t adverts = trace.count;
+    score_t s = run_trace(&trace);
+    printf("  ble_spam_detector_update: %.1f ns/advert over %zu adverts (%zu bytes state)\n",
+           s.ns_per_advert, adverts, sizeof(ble_spam_detector_t));
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_busy_crowd_without_spam);
+    TEST_RUN(test_apple_popup_and_action);
+    TEST_RUN(test_interleaved_vendors);
+    TEST_RUN(test_slow_popup);
+    TEST_RUN(test_address_flood);
+    if (test_bench_requested(argc, argv)) {
+        bench_busy_crowd();
+    }
+    return test_done("ble_spam_detector");
+}
@@ -0,0 +1,294 @@
+#include "core/cmd_registry.h"
+#include "test.h"
+#include <dirent.h>
+
+// Replays corpus/cmd_registry and mutations of it through the libFuzzer
+// target in fuzz_cmd_registry.c, next to the parser's own tests
+
+#define CORPUS_DIR    HOST_TEST_ROOT "/tests/host/corpus/cmd_registry"
+#define CORPUS_MAX    128
+#define MUTATIONS     200000
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static const char *const sorts[] = { "recent", "frames", "bytes", "rssi", NULL };
+
+static const cmd_opt_t coex_opts[] = {
+    { .name = "-w", .type = CMD_OPT_INT, .value_name = "wifi %", .help = "WiFi share", .min = 0, .max = 100, .def = 50 },
+    { .name = "-b", .type = CMD_OPT_INT, .flags = CMD_OPT_NO_DEFAULT, .value_name = "ble %", .help = "BLE share",
+      .min = 0, .max = 100, .def = 50 },
+    { .name = "-t", .type = CMD_OPT_INT, .value_name = "slot ms", .help = "Slot", .min = 20, .max = 10000, .def = 100 },
+    { .name = "-i", .flags = CMD_OPT_ALONE, .help = "Info" },
+    { .name = "-s", .flags = CMD_OPT_ALONE, .help = "Stop" },
+};
+static const cmd_spec_t coex = { .name = "coex", .summary = "Coex.", .opts = coex_opts, .opt_count = 5 };
+
+static const cmd_opt_t list_opts[] = {
+    { .name = "-a", .flags = CMD_OPT_ALONE, .help = "APs" },
+    { .name = "-s", .help = "Stations" },
+    { .name = "-o", .type = CMD_OPT_CHOICE, .help = "Sort", .choices = sorts },
+    { .name = "-j", .help = "JSON" },
+};
+static const cmd_spec_t list = { .name = "list", .flags = CMD_SPEC_NEEDS_OPTION, .opts = list_opts, .opt_count = 4 };
+
+static const cmd_opt_t ble_opts[] = {
+    { .name = "-f", .flags = CMD_OPT_ALONE },
+    { .name = "-t", .type = CMD_OPT_INT, .flags = CMD_OPT_ALONE | CMD_OPT_VALUE_OPTIONAL, .value_name = "minutes",
+      .min = 1, .max = 61, .def = 10 },
+    { .name = "-s", .flags = CMD_OPT_ALONE },
+};
+static const cmd_spec_t ble = { .name = "blescan", .flags = CMD_SPEC_NEEDS_OPTION, .opts = ble_opts, .opt_count = 3 };
+
+static const cmd_opt_t rog_opts[] = {
+    { .name = "-f", .type = CMD_OPT_STRING, .value_name = "allowlist.csv" },
+    { .name = "-s", .flags = CMD_OPT_ALONE },
+};
+static const cmd_spec_t rog = { .name = "rogueap", .opts = rog_opts, .opt_count = 2 };
+
+static const cmd_spec_t conn = { .name = "connect", .positional = "<SSID> <Password>", .min_positional = 2,
+                                 .max_positional = 2 };
+static const cmd_spec_t help = { .name = "help", .positional = "[command]", .max_positional = 1 };
+
+static const cmd_spec_t *const all[] = { &help, &coex, &list, &ble, &rog, &conn };
+#define ALL_COUNT (sizeof(all) / sizeof(all[0]))
+
+static char parse_err[CMD_ERR_LEN];
+
+static cmd_parse_result_t parse(const cmd_spec_t *spec, const char *line, cmd_args_t *args) {
+    static char buf[256];
+    char *argv[CMD_MAX_ARGS];
+
+    snprintf(buf, sizeof(buf), "%s", line);
+    int argc = cmd_tokenize(buf, argv, CMD_MAX_ARGS);
+    CHECK(argc > 0);
+    return cmd_parse(spec, argc, argv, args, parse_err, sizeof(parse_err));
+}
+
+static bool parse_fails(const cmd_spec_t *spec, const char *line, const char *msg) {
+    cmd_args_t args;
+    return parse(spec, line, &args) == CMD_PARSE_ERROR && strstr(parse_err, msg) != NULL;
+}
+
+static void test_registry(void) {
+    static cmd_spec_t many[CMD_REGISTRY_MAX];
+    static char names[CMD_REGISTRY_MAX][16];
+    static const cmd_spec_t extra = { .name = "extra" };
+    cmd_registry_t reg;
+
+    cmd_registry_init(&reg);
+    for (size_t i = 0; i < ALL_COUNT; i++) {
+        CHECK(cmd_registry_add(&reg, all[i]));
+    }
+    CHECK(!cmd_registry_add(&reg, &coex));
+    CHECK(cmd_registry_find(&reg, "coex") == &coex);
+    CHECK(cmd_registry_find(&reg, "coe") == NULL);
+    CHECK(cmd_registry_find(&reg, "coexx") == NULL);
+
+    CHECK(cmd_registry_remove(&reg, "list") && cmd_registry_find(&reg, "list") == NULL);
+    CHECK(!cmd_registry_remove(&reg, "list"));
+    for (size_t i = 0; i < ALL_COUNT; i++) {
+        CHECK(all[i] == &list || cmd_registry_find(&reg, all[i]->name) == all[i]);
+    }
+
+    // A full table, then holes, to exercise probing past removed entries
+    cmd_registry_init(&reg);
+    for (int i = 0; i < CMD_REGISTRY_MAX; i++) {
+        snprintf(names[i], sizeof(names[i]), "c%d", i);
+        many[i].name = names[i];
+        CHECK(cmd_registry_add(&reg, &many[i]));
+    }
+    CHECK(!cmd_registry_add(&reg, &extra));
+    for (int i = 0; i < CMD_REGISTRY_MAX; i += 3) {
+        CHECK(cmd_registry_remove(&reg, names[i]));
+    }
+    for (int i = 0; i < CMD_REGISTRY_MAX; i++) {
+        CHECK((cmd_registry_find(&reg, names[i]) != NULL) == (i % 3 != 0));
+    }
+}
+
+static void test_parse(void) {
+    cmd_args_t a;
+
+    CHECK(parse(&coex, "coex", &a) == CMD_PARSE_OK && cmd_arg_int(&a, "-w") == 50 && !cmd_arg_given(&a, "-b"));
+    CHECK(parse(&coex, "coex -w 30 -t 200", &a) == CMD_PARSE_OK);
+    CHECK(cmd_arg_int(&a, "-w") == 30 && cmd_arg_int(&a, "-t") == 200);
+    CHECK(parse(&coex, "coex --help", &a) == CMD_PARSE_HELP);
+
+    CHECK(parse_fails(&coex, "coex -t 5", "-t must be 20-10000"));
+    CHECK(parse_fails(&coex, "coex -t abc", "expects a number"));
+    CHECK(parse_fails(&coex, "coex -t", "needs a value <slot ms>"));
+    CHECK(parse_fails(&coex, "coex -w 1 -w 2", "given more than once"));
+    CHECK(parse_fails(&coex, "coex -i -w 2", "cannot be combined"));
+    CHECK(parse_fails(&coex, "coex -x", "unknown option -x"));
+    CHECK(parse_fails(&coex, "coex foo", "unexpected argument 'foo'"));
+    CHECK(parse_fails(&coex, "coex -w -5", "must be 0-100"));
+    CHECK(parse_fails(&coex, "coex -w 99999999999", "expects a number"));
+
+    CHECK(parse_fails(&list, "list", "expected one of -a, -s, -o, -j"));
+    CHECK(parse(&list, "list -s -o RSSI -j", &a) == CMD_PARSE_OK);
+    CHECK(strcmp(cmd_arg_str(&a, "-o"), "rssi") == 0 && cmd_arg_int(&a, "-o") == 3);
+    CHECK(parse(&list, "list -s", &a) == CMD_PARSE_OK && strcmp(cmd_arg_str(&a, "-o"), "recent") == 0);
+    CHECK(parse_fails(&list, "list -s -o size", "must be one of recent, frames, bytes, rssi"));
+
+    CHECK(parse(&ble, "blescan -t", &a) == CMD_PARSE_OK && cmd_arg_int(&a, "-t") == 10);
+    CHECK(parse(&ble, "blescan -t 30", &a) == CMD_PARSE_OK && cmd_arg_int(&a, "-t") == 30);
+    CHECK(parse_fails(&ble, "blescan -t -s", "cannot be combined"));
+    CHECK(parse_fails(&ble, "blescan -t 0", "must be 1-61"));
+
+    CHECK(parse(&rog, "rogueap -f /a.csv", &a) == CMD_PARSE_OK && strcmp(cmd_arg_str(&a, "-f"), "/a.csv") == 0);
+    CHECK(parse(&rog, "rogueap", &a) == CMD_PARSE_OK && cmd_arg_str(&a, "-f") == NULL);
+
+    CHECK(parse_fails(&conn, "connect a", "missing <SSID> <Password>"));
+    CHECK(parse(&conn, "connect \"Cafe WiFi\" 'hunter 2'", &a) == CMD_PARSE_OK && a.positional_count == 2);
+    CHECK(strcmp(a.positional[0], "Cafe WiFi") == 0 && strcmp(a.positional[1], "hunter 2") == 0);
+    CHECK(parse_fails(&conn, "connect a b c", "unexpected argument 'c'"));
+}
+
+static void test_help_and_completion(void) {
+    cmd_registry_t reg;
+    const char *c[16];
+    char buf[1024];
+
+    size_t need = cmd_format_help(&coex, buf, 10);
+    CHECK(strlen(buf) == 9 && need > 100);
+    CHECK(cmd_format_help(&coex, NULL, 0) == need);
+
+    cmd_registry_init(&reg);
+    for (size_t i = 0; i < ALL_COUNT; i++) {
+        cmd_registry_add(&reg, all[i]);
+    }
+    CHECK(cmd_registry_complete(&reg, "", c, 16) == ALL_COUNT);
+    size_t n = cmd_registry_complete(&reg, "co", c, 16);
+    CHECK(n == 2 && cmd_common_prefix_len(c, n) == 2);
+    CHECK(cmd_registry_complete(&reg, "coe", c, 16) == 1 && strcmp(c[0], "coex") == 0);
+    CHECK(cmd_registry_complete(&reg, "coex ", c, 16) == 5);
+    CHECK(cmd_registry_complete(&reg, "coex -w 10 ", c, 16) == 4);
+    CHECK(cmd_registry_complete(&reg, "coex -w ", c, 16) == 0);
+    CHECK(cmd_registry_complete(&reg, "list -s -o ", c, 16) == 4);
+    n = cmd_registry_complete(&reg, "list -s -o r", c, 16);
+    CHECK(n == 2 && cmd_common_prefix_len(c, n) == 1);
+    CHECK(cmd_registry_complete(&reg, "list -s -o b", c, 16) == 1 && strcmp(c[0], "bytes") == 0);
+    CHECK(cmd_registry_complete(&reg, "blescan -t ", c, 16) == 2);
+    CHECK(cmd_registry_complete(&reg, "nope ", c, 16) == 0);
+    CHECK(cmd_registry_complete(&reg, "coex ", c, 2) == 5);
+}
+
+typedef struct {
+    uint8_t data[256];
+    size_t len;
+} corpus_entry_t;
+
+static corpus_entry_t corpus[CORPUS_MAX];
+static size_t corpus_count;
+
+static void load_corpus(void) {
+    DIR *dir = opendir(CORPUS_DIR);
+    struct dirent *ent;
+
+    CHECK(dir != NULL);
+    while ((ent = readdir(dir)) != NULL) {
+        char path[512];
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", CORPUS_DIR, ent->d_name);
+        FILE *f = fopen(path, "rb");
+        CHECK(f != NULL && corpus_count < CORPUS_MAX);
+        corpus[corpus_count].len = fread(corpus[corpus_count].data, 1, sizeof(corpus[0].data), f);
+        fclose(f);
+        corpus_count++;
+    }
+    closedir(dir);
+    CHECK(corpus_count > 0);
+}
+
+static void test_fuzz_corpus(void) {
+    load_corpus();
+    for (size_t i = 0; i < corpus_count; i++) {
+        CHECK(LLVMFuzzerTestOneInput(corpus[i].data, corpus[i].len) == 0);
+    }
+}
+
+// Byte flips, inserted option names and splices of corpus entries, with a
+// fixed seed so a failure reproduces
+static const char *const dict[] = {
+    "-w", "-b", "-t", "-i", "-s", "-a", "-o", "-j", "-f", "-n", "-wps", "--help", "-", "--", "-5", "0", "100",
+    "2147483647", "-2147483648", "2147483648", "rssi", "RSSI", "\"", "'", "\\", " ", "\t", "coex", "list", "blescan",
+    "\xff", "1e3", "0x10",
+};
+
+static size_t mutate(uint8_t *buf, size_t len, size_t cap, uint32_t *rng) {
+    int rounds = 1 + test_rand(rng) % 4;
+    for (int r = 0; r < rounds; r++) {
+        uint32_t op = test_rand(rng) % 5;
+        size_t at = len ? test_rand(rng) % (len + 1) : 0;
+        if (op == 0 && len > 0) {
+            buf[at % len] ^= (uint8_t)(1u << (test_rand(rng) % 8));
+        } else if (op == 1 && len > 0) {
+            buf[at % len] = (uint8_t)test_rand(rng);
+        } else if (op == 2 && len > 0) {
+            size_t cut = 1 + test_rand(rng) % len;
+            cut = cut > len - at ? len - at : cut;
+            memmove(buf + at, buf + at + cut, len - at - cut);
+            len -= cut;
+        } else {
+            const uint8_t *src;
+            size_t n;
+            if (op == 3) {
+                const char *word = dict[test_rand(rng) % (sizeof(dict) / sizeof(dict[0]))];
+                src = (const uint8_t *)word;
+                n = strlen(word);
+            } else {
+                const corpus_entry_t *other = &corpus[test_rand(rng) % corpus_count];
+                size_t from = other->len ? test_rand(rng) % other->len : 0;
+                src = other->data + from;
+                n = other->len - from;
+            }
+            n = n > cap - len ? cap - len : n;
+            memmove(buf + at + n, buf + at, len - at);
+            memcpy(buf + at, src, n);
+            len += n;
+        }
+    }
+    return len;
+}
+
+static void test_fuzz_mutations(void) {
+    uint8_t buf[300];
+    uint32_t rng = 41;
+
+    for (uint32_t i = 0; i < MUTATIONS; i++) {
+        const corpus_entry_t *seed = &corpus[test_rand(&rng) % corpus_count];
+        memcpy(buf, seed->data, seed->len);
+        size_t len = mutate(buf, seed->len, sizeof(buf), &rng);
+        CHECK(LLVMFuzzerTestOneInput(buf, len) == 0);
+    }
+}
+
+static void bench_fuzz(void) {
+    uint8_t buf[300];
+    uint32_t rng = 43;
+    const uint32_t execs = 2000000;
+
+    double start = test_seconds();
+    for (uint32_t i = 0; i < execs; i++) {
+        const corpus_entry_t *seed = &corpus[test_rand(&rng) % corpus_count];
+        memcpy(buf, seed->data, seed->len);
+        LLVMFuzzerTestOneInput(buf, mutate(buf, seed->len, sizeof(buf), &rng));
+    }
+    double secs = test_seconds() - start;
+    printf("  fuzz_cmd_registry: %.0f execs/s (%.0f ns/exec) over %lu corpus entries\n", execs / secs,
+           secs * 1e9 / execs, (unsigned long)corpus_count);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_registry);
+    TEST_RUN(test_parse);
+    TEST_RUN(test_help_and_completion);
+    TEST_RUN(test_fuzz_corpus);
+    TEST_RUN(test_fuzz_mutations);
+    if (test_bench_requested(argc, argv)) {
+        bench_fuzz();
+    }
+    return test_done("cmd_registry");
+}
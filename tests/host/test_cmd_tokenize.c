@@ -0,0 +1,256 @@
+#include "core/cmd_registry.h"
+#include "core/line_discipline.h"
+#include "test.h"
+#include <malloc.h>
+
+// The console input path as serial_manager runs it: line discipline, then
+// run_line (cmd_tokenize, registry lookup, cmd_parse, the handler), and
+// handle_serial_command's copy into a stack buffer for web and UI commands.
+// The binary is linked with malloc and friends wrapped, so any allocation on
+// that path shows up.
+
+#define SERIAL_BUFFER_SIZE 528   // As in serial_manager.c
+#define STRESS_COMMANDS    1000000
+
+static long allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+char *__real_strdup(const char *s);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    allocations++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    allocations++;
+    return __real_realloc(p, size);
+}
+
+char *__wrap_strdup(const char *s) {
+    allocations++;
+    return __real_strdup(s);
+}
+
+static bool tokenizes(const char *in, int max_args, int expect, const char *const *want) {
+    char buf[256];
+    char *argv[CMD_MAX_ARGS];
+
+    snprintf(buf, sizeof(buf), "%s", in);
+    int argc = cmd_tokenize(buf, argv, max_args);
+    if (argc != expect) {
+        fprintf(stderr, "'%s': argc %d, want %d\n", in, argc, expect);
+        return false;
+    }
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], want[i]) != 0 || argv[i] < buf || argv[i] >= buf + sizeof(buf)) {
+            fprintf(stderr, "'%s': argv[%d] '%s', want '%s'\n", in, i, argv[i], want[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+#define WORDS(...) ((const char *const[]){ __VA_ARGS__ })
+
+static void test_tokenize(void) {
+    CHECK(tokenizes("  a  b\tc ", 4, 3, WORDS("a", "b", "c")));
+    CHECK(tokenizes("connect \"My Net\" 'p w'", 4, 3, WORDS("connect", "My Net", "p w")));
+    CHECK(tokenizes("x \"\" ''", 4, 3, WORDS("x", "", "")));
+    CHECK(tokenizes("a\\ b \"q\\\"x\" 'no\\esc'", 4, 3, WORDS("a b", "q\"x", "no\\esc")));
+    CHECK(tokenizes("ab\"cd ef\"gh", 4, 1, WORDS("abcd efgh")));
+    CHECK(tokenizes("trail\\", 4, 1, WORDS("trail\\")));
+    CHECK(tokenizes("a b c d", 4, 4, WORDS("a", "b", "c", "d")));
+    CHECK(tokenizes("a b c d e", 4, CMD_TOKENIZE_TOO_MANY, NULL));
+    CHECK(tokenizes("a b c d    ", 4, 4, WORDS("a", "b", "c", "d")));
+    CHECK(tokenizes("a \"open", 4, CMD_TOKENIZE_UNTERMINATED, NULL));
+    // No escapes inside single quotes, so this one is closed
+    CHECK(tokenizes("a 'open\\'", 4, 2, WORDS("a", "open\\")));
+    CHECK(tokenizes("", 4, 0, NULL));
+    CHECK(tokenizes(" \t ", 4, 0, NULL));
+}
+
+static const cmd_opt_t coex_opts[] = {
+    { .name = "-w", .type = CMD_OPT_INT, .min = 0, .max = 100, .def = 50 },
+    { .name = "-t", .type = CMD_OPT_INT, .min = 20, .max = 10000, .def = 100 },
+    { .name = "-s", .flags = CMD_OPT_ALONE },
+};
+
+static const char *const sorts[] = { "recent", "frames", "bytes", "rssi", NULL };
+
+static const cmd_opt_t list_opts[] = {
+    { .name = "-s" },
+    { .name = "-o", .type = CMD_OPT_CHOICE, .choices = sorts },
+};
+
+static long ran;
+static long rejected;
+
+static void run_args(const cmd_args_t *args) {
+    ran += args->present != 0 ? 2 : 1;
+}
+
+static void run_raw(int argc, char **argv) {
+    ran += argc;
+}
+
+static const cmd_spec_t coex = { .name = "coex", .opts = coex_opts, .opt_count = 3, .run = run_args };
+static const cmd_spec_t list = { .name = "list", .flags = CMD_SPEC_NEEDS_OPTION, .opts = list_opts, .opt_count = 2,
+                                 .run = run_args };
+static const cmd_spec_t connect = { .name = "connect", .positional = "<SSID> <Password>", .min_positional = 2,
+                                    .max_positional = 2, .run_raw = run_raw };
+static const cmd_spec_t portal = { .name = "startportal", .flags = CMD_SPEC_RAW, .run_raw = run_raw };
+
+static cmd_registry_t registry;
+
+// serial_manager.c's run_line, minus the printing and the command lock
+static int run_line(char *line) {
+    char *argv[CMD_MAX_ARGS];
+    int argc = cmd_tokenize(line, argv, CMD_MAX_ARGS);
+    if (argc <= 0) {
+        rejected++;
+        return -1;
+    }
+
+    const cmd_spec_t *spec = cmd_registry_find(&registry, argv[0]);
+    if (spec == NULL) {
+        rejected++;
+        return -1;
+    }
+    if (spec->flags & CMD_SPEC_RAW) {
+        spec->run_raw(argc, argv);
+        return 0;
+    }
+
+    cmd_args_t args;
+    char err[CMD_ERR_LEN];
+    if (cmd_parse(spec, argc, argv, &args, err, sizeof(err)) != CMD_PARSE_OK) {
+        rejected++;
+        return -1;
+    }
+    if (spec->run) {
+        spec->run(&args);
+    } else {
+        spec->run_raw(argc, argv);
+    }
+    return 0;
+}
+
+static int handle_serial_command(const char *input) {
+    char line[SERIAL_BUFFER_SIZE];
+    if (strlen(input) >= sizeof(line)) {
+        rejected++;
+        return -1;
+    }
+    strcpy(line, input);
+    return run_line(line);
+}
+
+static void console_line(char *line, size_t len, void *ctx) {
+    run_line(line);
+}
+
+// Good commands and every way of getting one wrong
+static const struct {
+    const char *line;
+    bool runs;
+} stress_lines[] = {
+    { "coex -w 30 -t 200\r\n", true },
+    { "connect \"Cafe WiFi\" 'hunter 2'\n", true },
+    { "coex -s\n", true },
+    { "list -s -o RSSI\r\n", true },
+    { "startportal https://example.com Cafe pass Cafe_AP example.com\n", true },
+    { "connect a\\ b c\n", true },
+    { "coex -t 5\n", false },
+    { "nope a b\n", false },
+    { "connect \"open\n", false },
+    { "coex -w 10 -w 20\r\n", false },
+    { "list\n", false },
+    { "list -s -o size\n", false },
+    { "coex -w 99999999999\n", false },
+    { "coex a b c d e f g h i j k l m n o p q r s t u v w x y z 1 2 3 4 5 6 7 8\n", false },
+};
+
+#define STRESS_LINE_COUNT (sizeof(stress_lines) / sizeof(stress_lines[0]))
+
+static void run_stress(uint32_t commands, double *secs_out) {
+    char buf[SERIAL_BUFFER_SIZE];
+    line_discipline_t ld;
+    size_t lens[STRESS_LINE_COUNT];
+
+    for (size_t i = 0; i < STRESS_LINE_COUNT; i++) {
+        lens[i] = strlen(stress_lines[i].line);
+    }
+    line_discipline_init(&ld, buf, sizeof(buf), console_line, NULL, NULL);
+
+    double start = test_seconds();
+    for (uint32_t i = 0; i < commands; i++) {
+        size_t k = i % STRESS_LINE_COUNT;
+        if (i & 1) {
+            line_discipline_feed(&ld, (const uint8_t *)stress_lines[k].line, lens[k]);
+        } else {
+            // handle_serial_command gets the line without its ending
+            char line[96];
+            memcpy(line, stress_lines[k].line, lens[k] + 1);
+            line[strcspn(line, "\r\n")] = '\0';
+            handle_serial_command(line);
+        }
+    }
+    *secs_out = test_seconds() - start;
+    CHECK(ld.lines == commands / 2);
+}
+
+// A million commands through the input path allocate nothing
+static void test_million_commands_no_heap(void) {
+    double secs;
+
+    cmd_registry_init(&registry);
+    CHECK(cmd_registry_add(&registry, &coex) && cmd_registry_add(&registry, &list));
+    CHECK(cmd_registry_add(&registry, &connect) && cmd_registry_add(&registry, &portal));
+
+    long before = allocations;
+    long expect_rejected = 0;
+    for (uint32_t i = 0; i < STRESS_COMMANDS; i++) {
+        expect_rejected += !stress_lines[i % STRESS_LINE_COUNT].runs;
+    }
+    ran = rejected = 0;
+    run_stress(STRESS_COMMANDS, &secs);
+    printf("    %d commands, %ld run, %ld rejected, %ld allocations, %.0f ns/command\n", STRESS_COMMANDS,
+           STRESS_COMMANDS - rejected, rejected, allocations - before, secs * 1e9 / STRESS_COMMANDS);
+
+    CHECK(allocations == before);
+    CHECK(rejected == expect_rejected);
+    CHECK(ran > 0);
+}
+
+// Optimised and without ASan, glibc's own accounting agrees: heap in use is
+// the same before and after
+static void bench_stress(void) {
+    double secs;
+
+    run_stress(10000, &secs);
+    struct mallinfo2 before = mallinfo2();
+    long allocs = allocations;
+    run_stress(STRESS_COMMANDS, &secs);
+    struct mallinfo2 after = mallinfo2();
+
+    CHECK(allocations == allocs && after.uordblks == before.uordblks);
+    printf("  run_line: %.0f ns/command, heap in use %zu -> %zu bytes\n", secs * 1e9 / STRESS_COMMANDS,
+           before.uordblks, after.uordblks);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_tokenize);
+    TEST_RUN(test_million_commands_no_heap);
+    if (test_bench_requested(argc, argv)) {
+        bench_stress();
+    }
+    return test_done("cmd_tokenize");
+}
@@ -0,0 +1,373 @@
+#include "core/coex_scheduler.h"
+#include "managers/coex_manager.h"
+#include "managers/ble_manager.h"
+#include "managers/wifi_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include "test.h"
+
+// Fake clock, only the stubs below move it
+static int64_t clock_us;
+
+// Time each radio op takes, zero for exact bookkeeping
+static uint32_t wifi_toggle_us;
+static uint32_t ble_toggle_us;
+
+typedef struct {
+    bool on;
+    int64_t on_since_us;
+    int64_t on_us;
+    int64_t off_since_us;
+    int64_t max_gap_us;
+    bool ever_on;
+} radio_t;
+
+static radio_t wifi;
+static radio_t ble;
+static int overlaps;
+
+static void radio_set(radio_t *r, bool on) {
+    if (on == r->on) {
+        return;
+    }
+    if (on) {
+        if (r->ever_on && clock_us - r->off_since_us > r->max_gap_us) {
+            r->max_gap_us = clock_us - r->off_since_us;
+        }
+        r->ever_on = true;
+        r->on_since_us = clock_us;
+    } else {
+        r->on_us += clock_us - r->on_since_us;
+        r->off_since_us = clock_us;
+    }
+    r->on = on;
+    overlaps += wifi.on && ble.on;
+}
+
+// WiFi
+static wifi_promiscuous_cb_t promiscuous_cb;
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb) {
+    promiscuous_cb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool en) {
+    clock_us += wifi_toggle_us;
+    radio_set(&wifi, en);
+    return ESP_OK;
+}
+
+void wifi_stations_sniffer_callback(void *buf, wifi_promiscuous_pkt_type_t type) {
+}
+
+// BLE: a started scan holds a stack reference until ble_stop
+static ble_data_handler_t ble_handler;
+static bool ble_stack_held;
+static bool pause_fails;
+
+esp_err_t ble_register_handler_flags(ble_data_handler_t handler, uint32_t flags) {
+    CHECK(flags & BLE_HANDLER_ALL_ADVERTS);
+    ble_handler = handler;
+    return ESP_OK;
+}
+
+esp_err_t ble_unregister_handler(ble_data_handler_t handler) {
+    CHECK(handler == ble_handler);
+    ble_handler = NULL;
+    return ESP_OK;
+}
+
+void ble_start_scanning(void) {
+    ble_stack_held = true;
+    radio_set(&ble, true);
+}
+
+esp_err_t ble_pause_scanning(void) {
+    if (pause_fails) {
+        return ESP_FAIL;
+    }
+    clock_us += ble_toggle_us;
+    radio_set(&ble, false);
+    return ESP_OK;
+}
+
+esp_err_t ble_resume_scanning(void) {
+    clock_us += ble_toggle_us;
+    radio_set(&ble, true);
+    return ESP_OK;
+}
+
+void ble_stop(void) {
+    radio_set(&ble, false);
+    ble_stack_held = false;
+}
+
+// The coex task runs on the test thread: each wait sleeps one slot on the
+// fake clock, and the wait that reaches run_until_us stops the manager
+static void (*task_fn)(void *);
+static bool create_fails;
+static bool notified;
+static bool task_deleted;
+static int64_t run_until_us;
+static int critical_depth;
+
+int64_t esp_timer_get_time(void) {
+    return clock_us;
+}
+
+BaseType_t xTaskCreate(void (*task)(void *), const char *name, uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *out) {
+    if (create_fails) {
+        return pdFALSE;
+    }
+    task_fn = task;
+    *out = (TaskHandle_t)&task_fn;
+    return pdPASS;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    notified = true;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+    CHECK(critical_depth == 0);
+    if (notified) {
+        notified = false;
+        return 1;
+    }
+    clock_us += (int64_t)wait * 1000;
+    if (clock_us >= run_until_us) {
+        coex_manager_stop();
+    }
+    return 0;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    CHECK(task == NULL);
+    task_deleted = true;
+}
+
+void taskENTER_CRITICAL(portMUX_TYPE *mux) {
+    CHECK(critical_depth++ == 0);
+}
+
+void taskEXIT_CRITICAL(portMUX_TYPE *mux) {
+    CHECK(--critical_depth == 0);
+}
+
+static void reset(uint32_t wifi_cost_us, uint32_t ble_cost_us) {
+    memset(&wifi, 0, sizeof(wifi));
+    memset(&ble, 0, sizeof(ble));
+    overlaps = 0;
+    wifi_toggle_us = wifi_cost_us;
+    ble_toggle_us = ble_cost_us;
+    pause_fails = false;
+    create_fails = false;
+    notified = false;
+    task_deleted = false;
+    task_fn = NULL;
+}
+
+// Start the manager and run its task for slots slots of the fake clock
+static void run(uint32_t slot_ms, uint8_t wifi_pct, uint8_t ble_pct, uint32_t slots) {
+    CHECK(coex_manager_start(slot_ms, wifi_pct, ble_pct) == ESP_OK);
+    CHECK(coex_manager_is_running() && task_fn != NULL && promiscuous_cb != NULL && ble_handler != NULL);
+    CHECK(!ble.on && !wifi.on);
+
+    run_until_us = clock_us + (int64_t)slots * slot_ms * 1000;
+    task_fn(NULL);
+
+    // Stopped: both captures off, the handler and the stack released
+    CHECK(task_deleted && !coex_manager_is_running());
+    CHECK(!wifi.on && !ble.on && ble_handler == NULL && !ble_stack_held);
+    CHECK(overlaps == 0 && critical_depth == 0);
+}
+
+static uint32_t div_up(uint32_t a, uint32_t b) {
+    return (a + b - 1) / b;
+}
+
+static const uint8_t shares[][2] = {
+    { 50, 50 }, { 70, 30 }, { 10, 90 }, { 1, 99 }, { 30, 20 }, { 25, 25 }, { 33, 33 }, { 5, 0 }, { 0, 60 },
+};
+
+#define SHARE_COUNT (sizeof(shares) / sizeof(shares[0]))
+
+// Longest wait between two turns, in slots, that a share allows: with two
+// radios the round robin keeps it to the share, idle time competing as a
+// third can stretch it to twice that
+static uint32_t gap_bound(const uint8_t *w, int r) {
+    return w[0] + w[1] < 100 ? div_up(200, w[r]) - 1 : div_up(100, w[r]) - 1;
+}
+
+static void test_schedule(void) {
+    coex_scheduler_t sched;
+
+    CHECK(!coex_scheduler_init(&sched, COEX_MIN_SLOT_MS - 1, 50, 50));
+    CHECK(!coex_scheduler_init(&sched, COEX_MAX_SLOT_MS + 1, 50, 50));
+    CHECK(!coex_scheduler_init(&sched, 100, 60, 41));
+    CHECK(!coex_scheduler_init(&sched, 100, 0, 0));
+    CHECK(coex_scheduler_init(&sched, 100, 60, 40) && sched.weight[COEX_RADIO_IDLE] == 0);
+
+    // Drive the scheduler straight off a fake clock, where switching to a
+    // radio costs it 1.5 ms of its slot
+    for (size_t i = 0; i < SHARE_COUNT; i++) {
+        const uint8_t *w = shares[i];
+        const uint32_t slot_ms = 40;
+        const uint32_t slots = 2000;
+        uint32_t on_ms[COEX_RADIO_COUNT] = { 0 };
+        uint32_t turns[COEX_RADIO_COUNT] = { 0 };
+        uint32_t last_off[COEX_RADIO_COUNT] = { 0 };
+        uint32_t max_gap[COEX_RADIO_COUNT] = { 0 };
+        uint32_t switch_us[COEX_RADIO_COUNT] = { 0 };
+        int active = -1;
+
+        // Start off zero so the stats cope with a clock that wraps
+        uint32_t start = 0xFFFFFFFFu - 10 * slot_ms;
+        uint32_t now = start;
+        CHECK(coex_scheduler_init(&sched, slot_ms, w[0], w[1]));
+        CHECK(coex_scheduler_effective_permille(&sched, COEX_RADIO_WIFI, now) == 0);
+
+        for (uint32_t slot = 0; slot < slots; slot++) {
+            coex_radio_t r = coex_scheduler_next(&sched, now);
+            CHECK(r < COEX_RADIO_COUNT && sched.weight[r] > 0);
+            if ((int)r != active) {
+                if (active >= 0) {
+                    last_off[active] = now;
+                }
+                if (turns[r] > 0 && now - last_off[r] > max_gap[r]) {
+                    max_gap[r] = now - last_off[r];
+                }
+                turns[r]++;
+                coex_scheduler_add_switch_cost(&sched, r, 1500);
+                switch_us[r] += 1500;
+                active = (int)r;
+            }
+            on_ms[r] += slot_ms;
+            now += slot_ms;
+        }
+
+        for (int r = 0; r < COEX_RADIO_COUNT; r++) {
+            uint8_t weight = r == COEX_RADIO_IDLE ? (uint8_t)(100 - w[0] - w[1]) : w[r];
+            coex_radio_stats_t s;
+            coex_scheduler_stats(&sched, (coex_radio_t)r, now, &s);
+
+            // Each share holds exactly over every hundred slots
+            CHECK(on_ms[r] == weight * (slots / 100) * slot_ms);
+            CHECK(s.on_ms == on_ms[r] && s.slots == turns[r] && s.switch_us == switch_us[r]);
+            if (weight == 0) {
+                CHECK(!s.ever_on && s.slots == 0);
+                continue;
+            }
+
+            // A radio waiting at the end may already be past its worst gap
+            uint32_t gap = max_gap[r];
+            if (r != active && now - last_off[r] > gap) {
+                gap = now - last_off[r];
+            }
+            CHECK(s.max_gap_ms == gap);
+            if (r != COEX_RADIO_IDLE) {
+                CHECK(gap / slot_ms <= gap_bound(w, r));
+            }
+
+            // Effective share is the on time less what switching took
+            uint32_t effective = (uint32_t)(((uint64_t)on_ms[r] * 1000 - switch_us[r]) / (now - start));
+            CHECK(coex_scheduler_effective_permille(&sched, (coex_radio_t)r, now) == effective);
+            CHECK(effective <= weight * 10u && effective + 40 >= weight * 10u);
+        }
+    }
+
+    CHECK(strcmp(coex_radio_name(COEX_RADIO_BLE), "BLE") == 0);
+    CHECK(strcmp(coex_radio_name(COEX_RADIO_COUNT), "Unknown") == 0);
+}
+
+static void test_manager_shares(void) {
+    const uint32_t slot_ms = 100;
+    const uint32_t slots = 1000;
+    radio_t *radios[2] = { &wifi, &ble };
+
+    for (size_t i = 0; i < SHARE_COUNT; i++) {
+        const uint8_t *w = shares[i];
+
+        // Switches cost nothing, so every slot is exactly slot_ms long
+        reset(0, 0);
+        int64_t start_us = clock_us;
+        run(slot_ms, w[0], w[1], slots);
+        CHECK(clock_us - start_us == (int64_t)slots * slot_ms * 1000);
+
+        for (int r = 0; r < 2; r++) {
+            CHECK(radios[r]->on_us == (int64_t)w[r] * (slots / 100) * slot_ms * 1000);
+            if (w[r] > 0) {
+                CHECK(radios[r]->max_gap_us / 1000 / slot_ms <= gap_bound(w, r));
+            }
+        }
+    }
+
+    // Real switches take time: the radios still never overlap, and each
+    // stays within 3% of its share
+    for (size_t i = 0; i < SHARE_COUNT; i++) {
+        const uint8_t *w = shares[i];
+
+        reset(300, 2000);
+        int64_t start_us = clock_us;
+        run(slot_ms, w[0], w[1], slots);
+        int64_t elapsed_us = clock_us - start_us;
+
+        for (int r = 0; r < 2; r++) {
+            int64_t permille = radios[r]->on_us * 1000 / elapsed_us;
+            CHECK(llabs(permille - w[r] * 10) <= 30);
+            if (w[r] > 0) {
+                CHECK(radios[r]->max_gap_us / 1000 / (slot_ms + 5) <= gap_bound(w, r));
+            }
+        }
+    }
+}
+
+static void test_start_failures(void) {
+    reset(0, 0);
+
+    // Bad arguments touch nothing
+    CHECK(coex_manager_start(COEX_MIN_SLOT_MS - 1, 50, 50) == ESP_ERR_INVALID_ARG);
+    CHECK(coex_manager_start(100, 80, 30) == ESP_ERR_INVALID_ARG);
+    CHECK(ble_handler == NULL && !ble_stack_held && !coex_manager_is_running());
+
+    // The scan came up but could not be paused: it is stopped again and
+    // the stack reference released
+    pause_fails = true;
+    CHECK(coex_manager_start(100, 50, 50) == ESP_FAIL);
+    CHECK(!coex_manager_is_running() && task_fn == NULL);
+    CHECK(ble_handler == NULL && !ble_stack_held && !ble.on);
+    pause_fails = false;
+
+    // The same when the task cannot be created
+    create_fails = true;
+    CHECK(coex_manager_start(100, 50, 50) == ESP_ERR_NO_MEM);
+    CHECK(!coex_manager_is_running() && ble_handler == NULL && !ble_stack_held && !ble.on);
+    create_fails = false;
+
+    // After a failure the next start works, and a second start is refused
+    CHECK(coex_manager_start(100, 50, 50) == ESP_OK);
+    CHECK(coex_manager_start(100, 50, 50) == ESP_ERR_INVALID_STATE);
+    run_until_us = clock_us + 10 * 100 * 1000;
+    task_fn(NULL);
+    CHECK(!coex_manager_is_running() && ble_handler == NULL && !ble_stack_held);
+
+    // Stopping a stopped manager wakes nothing
+    notified = false;
+    coex_manager_stop();
+    CHECK(!notified);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_schedule);
+    TEST_RUN(test_manager_shares);
+    TEST_RUN(test_start_failures);
+    return test_done("coex_scheduler");
+}
@@ -0,0 +1,216 @@
+#include "test.h"
+#include <pthread.h>
+#include <pty.h>
+#include <stdbool.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Console TX path over a pty loopback. A printing thread copies scan output
+// into a ring of CONSOLE_FIFO bytes (stdout polling the hardware FIFO) or
+// CONSOLE_TX_BUF_SIZE bytes (the UART driver's ring, see serial_manager.c),
+// a drain thread moves it to the pty slave at baud / 10 bytes per second as
+// the UART would, and a reader on the master side checks that every byte
+// arrives in order. What matters is how long printing waits.
+
+#define CONSOLE_FIFO        128
+#define CONSOLE_TX_BUF_SIZE (8 * 1024)
+#define LINE_LEN            80
+#define LINES_PER_BURST     30
+#define BURST_MS            100
+
+typedef struct {
+    uint32_t baud;
+    size_t cap;
+    int bursts;
+    // Results
+    double blocked;
+    double worst;
+    long sent;
+    long received;
+    bool intact;
+} tx_run_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t moved = PTHREAD_COND_INITIALIZER;
+static uint8_t *ring;
+static size_t ring_cap, head, tail;
+static bool draining_done;
+static int master_fd, slave_fd;
+static uint32_t line_baud;
+static long reader_count;
+static bool reader_ok;
+
+static void sleep_seconds(double s) {
+    if (s > 0) {
+        struct timespec ts = { (time_t)s, (long)((s - (time_t)s) * 1e9) };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// printf's view: returns once the bytes are in the ring
+static void console_write(const uint8_t *data, size_t len) {
+    pthread_mutex_lock(&lock);
+    for (size_t i = 0; i < len; i++) {
+        while (head - tail == ring_cap) {
+            pthread_cond_wait(&moved, &lock);
+        }
+        ring[head++ % ring_cap] = data[i];
+    }
+    pthread_cond_broadcast(&moved);
+    pthread_mutex_unlock(&lock);
+}
+
+static void *drain_task(void *arg) {
+    double wire = test_seconds();
+
+    for (;;) {
+        uint8_t chunk[64];
+        size_t n = 0;
+
+        pthread_mutex_lock(&lock);
+        while (head == tail && !draining_done) {
+            pthread_cond_wait(&moved, &lock);
+        }
+        if (head == tail) {
+            pthread_mutex_unlock(&lock);
+            return NULL;
+        }
+        while (n < sizeof(chunk) && tail != head) {
+            chunk[n++] = ring[tail++ % ring_cap];
+        }
+        pthread_cond_broadcast(&moved);
+        pthread_mutex_unlock(&lock);
+
+        CHECK(write(slave_fd, chunk, n) == (ssize_t)n);
+        // 8N1: ten bit times per byte
+        wire += n * 10.0 / line_baud;
+        double ahead = wire - test_seconds();
+        if (ahead > 0) {
+            sleep_seconds(ahead);
+        } else {
+            wire = test_seconds();
+        }
+    }
+}
+
+static void *reader_task(void *arg) {
+    uint8_t buf[4096];
+    long expect = 0;
+
+    for (;;) {
+        ssize_t n = read(master_fd, buf, sizeof(buf));
+        if (n <= 0) {
+            return NULL;
+        }
+        for (ssize_t i = 0; i < n; i++, expect++) {
+            reader_ok &= buf[i] == (uint8_t)('A' + expect % 26);
+        }
+        __atomic_store_n(&reader_count, expect, __ATOMIC_RELEASE);
+    }
+}
+
+// Scan output: LINES_PER_BURST lines every BURST_MS, 24 KB/s on average
+static void run_tx(tx_run_t *run) {
+    pthread_t drain, reader;
+    struct termios tio;
+    uint8_t line[LINE_LEN];
+
+    ring = malloc(run->cap);
+    CHECK(ring != NULL);
+    ring_cap = run->cap;
+    head = tail = 0;
+    draining_done = false;
+    line_baud = run->baud;
+    reader_count = 0;
+    reader_ok = true;
+
+    CHECK(openpty(&master_fd, &slave_fd, NULL, NULL, NULL) == 0);
+    CHECK(tcgetattr(slave_fd, &tio) == 0);
+    cfmakeraw(&tio);
+    CHECK(tcsetattr(slave_fd, TCSANOW, &tio) == 0);
+    CHECK(pthread_create(&reader, NULL, reader_task, NULL) == 0);
+    CHECK(pthread_create(&drain, NULL, drain_task, NULL) == 0);
+
+    run->blocked = run->worst = 0;
+    run->sent = 0;
+    for (int burst = 0; burst < run->bursts; burst++) {
+        double start = test_seconds();
+        for (int l = 0; l < LINES_PER_BURST; l++) {
+            for (int i = 0; i < LINE_LEN; i++) {
+                line[i] = (uint8_t)('A' + (run->sent + i) % 26);
+            }
+            double t = test_seconds();
+            console_write(line, LINE_LEN);
+            t = test_seconds() - t;
+            run->blocked += t;
+            run->worst = t > run->worst ? t : run->worst;
+            run->sent += LINE_LEN;
+        }
+        sleep_seconds(BURST_MS / 1e3 - (test_seconds() - start));
+    }
+
+    pthread_mutex_lock(&lock);
+    draining_done = true;
+    pthread_cond_broadcast(&moved);
+    pthread_mutex_unlock(&lock);
+    pthread_join(drain, NULL);
+    while (__atomic_load_n(&reader_count, __ATOMIC_ACQUIRE) < run->sent) {
+        sleep_seconds(0.001);
+    }
+    close(slave_fd);
+    pthread_join(reader, NULL);
+    close(master_fd);
+    free(ring);
+
+    run->received = reader_count;
+    run->intact = reader_ok;
+}
+
+static void print_run(const char *indent, const tx_run_t *run) {
+    printf("%s%7lu baud, %5lu B buffer: printing blocked %6.3f s for %.1f s of output, worst line %7.3f ms, %ld/%ld bytes %s\n",
+           indent, (unsigned long)run->baud, (unsigned long)run->cap, run->blocked, run->bursts * BURST_MS / 1e3,
+           run->worst * 1e3, run->received, run->sent, run->intact ? "in order" : "CORRUPT");
+}
+
+// With the driver's ring, a burst of scan output at 921600 baud never waits
+// for the wire; polling the FIFO at 115200 waits for most of the run
+static void test_buffered_output_does_not_block(void) {
+    tx_run_t buffered = { .baud = 921600, .cap = CONSOLE_TX_BUF_SIZE, .bursts = 5 };
+    tx_run_t polled = { .baud = 115200, .cap = CONSOLE_FIFO, .bursts = 5 };
+
+    run_tx(&buffered);
+    run_tx(&polled);
+    print_run("    ", &buffered);
+    print_run("    ", &polled);
+
+    CHECK(buffered.intact && buffered.received == buffered.sent);
+    CHECK(polled.intact && polled.received == polled.sent);
+    // A burst is 2400 bytes, well inside the ring, so a line only ever waits
+    // for the lock, never for a whole line of wire time
+    CHECK(buffered.worst < LINE_LEN * 10.0 / 115200);
+    CHECK(buffered.blocked < 0.05 * buffered.bursts * BURST_MS / 1e3);
+    CHECK(polled.blocked > 10 * buffered.blocked);
+}
+
+static void bench_console_tx(void) {
+    tx_run_t runs[] = {
+        { .baud = 115200, .cap = CONSOLE_FIFO, .bursts = 30 },
+        { .baud = 921600, .cap = CONSOLE_FIFO, .bursts = 30 },
+        { .baud = 115200, .cap = CONSOLE_TX_BUF_SIZE, .bursts = 30 },
+        { .baud = 921600, .cap = CONSOLE_TX_BUF_SIZE, .bursts = 30 },
+        { .baud = 2000000, .cap = CONSOLE_TX_BUF_SIZE, .bursts = 30 },
+    };
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+        run_tx(&runs[i]);
+        CHECK(runs[i].intact && runs[i].received == runs[i].sent);
+        print_run("  ", &runs[i]);
+    }
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_buffered_output_does_not_block);
+    if (test_bench_requested(argc, argv)) {
+        bench_console_tx();
+    }
+    return test_done("console_tx");
+}
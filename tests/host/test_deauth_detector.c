@@ -0,0 +1,209 @@
+#include "core/deauth_detector.h"
+#include "test.h"
+
+#define THRESHOLD 50
+#define HOLDOFF   10000
+
+static void make_mac(uint8_t mac[6], uint32_t id) {
+    mac[0] = 0x02;
+    mac[1] = 0x11;
+    mac[2] = (uint8_t)(id >> 24);
+    mac[3] = (uint8_t)(id >> 16);
+    mac[4] = (uint8_t)(id >> 8);
+    mac[5] = (uint8_t)id;
+}
+
+// Ordinary roaming and leaving: a few dozen APs, each sending a deauth or
+// disassoc every couple of seconds with the usual reason codes
+static int feed_background(deauth_detector_t *det, uint32_t *rng, uint32_t now_ms, deauth_alert_t alerts[2]) {
+    static const uint16_t reasons[] = { 1, 3, 4, 8 };
+    uint8_t bssid[6], sta[6];
+    uint32_t r = test_rand(rng);
+
+    make_mac(bssid, 0x1000 + r % 40);
+    make_mac(sta, 0x2000 + (r >> 8) % 200);
+    if (r & 0x10000) {
+        // Station leaving: the station transmits, the AP is the BSSID
+        return deauth_detector_process(det, bssid, sta, DEAUTH_SUBTYPE_DISASSOC, reasons[(r >> 20) % 4], now_ms, alerts);
+    }
+    return deauth_detector_process(det, bssid, bssid, DEAUTH_SUBTYPE_DEAUTH, reasons[(r >> 20) % 4], now_ms, alerts);
+}
+
+static void test_benign_background_never_alerts(void) {
+    deauth_detector_t det;
+    deauth_alert_t alerts[2];
+    uint32_t rng = 1;
+    int total = 0;
+
+    deauth_detector_init(&det, THRESHOLD, HOLDOFF);
+    // Ten frames a second across 40 APs for an hour
+    for (uint32_t ms = 0; ms < 3600 * 1000; ms += 100) {
+        total += feed_background(&det, &rng, ms, alerts);
+    }
+    CHECK(total == 0);
+    CHECK(det.frames_seen == 36000);
+}
+
+static void test_spoofed_flood_against_one_bssid(void) {
+    deauth_detector_t det;
+    deauth_alert_t alerts[2];
+    uint8_t ap[6];
+    uint32_t rng = 2;
+    int alerts_seen = 0;
+    uint32_t first_alert_ms = 0;
+
+    make_mac(ap, 0xABCD);
+    deauth_detector_init(&det, THRESHOLD, HOLDOFF);
+    // 100 frames/s from the AP's own address, reason 7, for 30 s, with background
+    for (uint32_t ms = 0; ms < 30000; ms += 10) {
+        int n = deauth_detector_process(&det, ap, ap, DEAUTH_SUBTYPE_DEAUTH, 7, ms, alerts);
+        for (int i = 0; i < n; i++) {
+            CHECK(alerts[i].key_type == DEAUTH_KEY_BSSID);
+            CHECK(memcmp(alerts[i].target, ap, 6) == 0);
+            if (alerts_seen++ == 0) {
+                first_alert_ms = ms;
+                CHECK(alerts[i].frames_in_window == THRESHOLD);
+                CHECK(alerts[i].deauth_count == THRESHOLD);
+                CHECK(alerts[i].reason_hist[7] == THRESHOLD);
+            } else {
+                // Later alerts see the full window: 100/s
+                CHECK(alerts[i].rate_per_sec >= 95 && alerts[i].rate_per_sec <= 100);
+            }
+        }
+        if (ms % 100 == 0) {
+            CHECK(feed_background(&det, &rng, ms, alerts) == 0);
+        }
+    }
+    // Half a second to cross the threshold, then once per hold-off
+    CHECK(first_alert_ms == 490);
+    CHECK(alerts_seen == 3);
+}
+
+static void test_attacker_across_many_networks(void) {
+    deauth_detector_t det;
+    deauth_alert_t alerts[2];
+    uint8_t attacker[6], bssid[6];
+    int source_alerts = 0, bssid_alerts = 0;
+
+    make_mac(attacker, 0xBAD);
+    deauth_detector_init(&det, THRESHOLD, HOLDOFF);
+    // 20 networks get 3 frames a second each: no single network floods
+    for (uint32_t ms = 0; ms < 5000; ms += 50) {
+        make_mac(bssid, 0x3000 + (ms / 50) % 20);
+        int n = deauth_detector_process(&det, bssid, attacker, DEAUTH_SUBTYPE_DISASSOC, 5, ms, alerts);
+        for (int i = 0; i < n; i++) {
+            if (alerts[i].key_type == DEAUTH_KEY_SOURCE) {
+                CHECK(memcmp(alerts[i].target, attacker, 6) == 0);
+                CHECK(alerts[i].disassoc_count == THRESHOLD);
+                source_alerts++;
+            } else {
+                bssid_alerts++;
+            }
+        }
+    }
+    CHECK(source_alerts == 1);
+    CHECK(bssid_alerts == 0);
+}
+
+static void test_random_sources_still_flag_the_target(void) {
+    deauth_detector_t det;
+    deauth_alert_t alerts[2];
+    uint8_t ap[6], src[6];
+    int bssid_alerts = 0;
+
+    make_mac(ap, 0x77);
+    deauth_detector_init(&det, THRESHOLD, HOLDOFF);
+    // Every frame from a fresh address: the source keys churn through the
+    // table and must not push the target out
+    for (uint32_t i = 0; i < 2000; i++) {
+        make_mac(src, 0x900000 + i);
+        int n = deauth_detector_process(&det, ap, src, DEAUTH_SUBTYPE_DEAUTH, 2, i * 5, alerts);
+        for (int k = 0; k < n; k++) {
+            CHECK(alerts[k].key_type == DEAUTH_KEY_BSSID);
+            bssid_alerts++;
+        }
+    }
+    CHECK(bssid_alerts == 1);
+    CHECK(det.evictions > 0);
+    CHECK(deauth_detector_window_count(&det, DEAUTH_KEY_BSSID, ap, 1999 * 5) >= THRESHOLD);
+}
+
+static void test_window_slides(void) {
+    deauth_detector_t det;
+    deauth_alert_t alerts[2];
+    uint8_t ap[6];
+
+    make_mac(ap, 0x55);
+    deauth_detector_init(&det, THRESHOLD, HOLDOFF);
+    // 49 frames, a quiet window, 49 more: never 50 inside one window
+    for (uint32_t i = 0; i < 49; i++) {
+        CHECK(deauth_detector_process(&det, ap, ap, DEAUTH_SUBTYPE_DEAUTH, 7, i * 20, alerts) == 0);
+    }
+    CHECK(deauth_detector_window_count(&det, DEAUTH_KEY_BSSID, ap, 1000) == 49);
+    CHECK(deauth_detector_window_count(&det, DEAUTH_KEY_BSSID, ap, 9999) == 49);
+    CHECK(deauth_detector_window_count(&det, DEAUTH_KEY_BSSID, ap, 10000) == 0);
+    for (uint32_t i = 0; i < 49; i++) {
+        CHECK(deauth_detector_process(&det, ap, ap, DEAUTH_SUBTYPE_DEAUTH, 7, 11000 + i * 20, alerts) == 0);
+    }
+
+    // A burst after the window drained alerts again without waiting out the hold-off
+    deauth_detector_init(&det, THRESHOLD, HOLDOFF);
+    int first = 0, second = 0;
+    for (uint32_t i = 0; i < 60; i++) {
+        first += deauth_detector_process(&det, ap, ap, DEAUTH_SUBTYPE_DEAUTH, 7, i, alerts);
+    }
+    for (uint32_t i = 0; i < 60; i++) {
+        second += deauth_detector_process(&det, ap, ap, DEAUTH_SUBTYPE_DEAUTH, 1, 10100 + i, alerts);
+    }
+    CHECK(first == 1 && second == 1);
+    CHECK(alerts[0].reason_hist[7] == 0 && alerts[0].reason_hist[1] == THRESHOLD);
+}
+
+static void test_format_reasons(void) {
+    uint16_t hist[DEAUTH_DETECTOR_REASON_BINS] = { 0 };
+    char out[64];
+
+    deauth_detector_format_reasons(hist, out, sizeof(out));
+    CHECK(strcmp(out, "") == 0);
+    hist[1] = 3;
+    hist[7] = 120;
+    hist[DEAUTH_DETECTOR_REASON_BINS - 1] = 2;
+    deauth_detector_format_reasons(hist, out, sizeof(out));
+    CHECK(strcmp(out, "1:3 7:120 >=15:2") == 0);
+    deauth_detector_format_reasons(hist, out, 8);
+    CHECK(strcmp(out, "1:3") == 0);
+}
+
+static void bench_mixed_traffic(void) {
+    static deauth_detector_t det;
+    deauth_alert_t alerts[2];
+    uint8_t bssid[6], src[6];
+    uint32_t rng = 3;
+    const uint32_t frames = 5000000;
+    int sink = 0;
+
+    deauth_detector_init(&det, THRESHOLD, HOLDOFF);
+    double start = test_seconds();
+    for (uint32_t i = 0; i < frames; i++) {
+        uint32_t r = test_rand(&rng);
+        make_mac(bssid, r % 16);
+        make_mac(src, (r & 3) ? r % 16 : r);
+        sink += deauth_detector_process(&det, bssid, src, DEAUTH_SUBTYPE_DEAUTH, r % 20, i / 4, alerts);
+    }
+    double secs = test_seconds() - start;
+    printf("  deauth_detector_process: %.0f frames/s, %.1f ns/frame (%d alerts, %zu bytes state)\n",
+           frames / secs, secs * 1e9 / frames, sink, sizeof(det));
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_benign_background_never_alerts);
+    TEST_RUN(test_spoofed_flood_against_one_bssid);
+    TEST_RUN(test_attacker_across_many_networks);
+    TEST_RUN(test_random_sources_still_flag_the_target);
+    TEST_RUN(test_window_slides);
+    TEST_RUN(test_format_reasons);
+    if (test_bench_requested(argc, argv)) {
+        bench_mixed_traffic();
+    }
+    return test_done("deauth_detector");
+}
@@ -0,0 +1,259 @@
+#include "core/job_table.h"
+#include "test.h"
+#include <stdbool.h>
+
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+static job_t finished[64];
+static int finished_count;
+
+static void on_finish(const job_t *job, void *ctx) {
+    CHECK(finished_count < 64);
+    finished[finished_count++] = *job;
+}
+
+static job_table_t table;
+static int scan_owner, capture_owner, script_owner;
+
+static void setup(void) {
+    job_table_init(&table, on_finish, NULL);
+    finished_count = 0;
+}
+
+static void test_start_and_refuse(void) {
+    uint32_t holder;
+
+    setup();
+    uint32_t scan = job_table_start(&table, "scanap", JOB_RES_WIFI, &scan_owner, 100, 5000, &holder);
+    CHECK(scan == 1 && holder == 0);
+    job_t *job = job_table_find(&table, scan);
+    CHECK(job != NULL && job->state == JOB_RUNNING && strcmp(job->label, "scanap") == 0 && job->owner == &scan_owner);
+    CHECK(job_table_held(&table) == JOB_RES_WIFI);
+
+    // Anything sharing a resource is refused and told who holds it
+    uint32_t capture = job_table_start(&table, "capture -probe", JOB_RES_WIFI | JOB_RES_PCAP, &capture_owner, 110,
+                                       5000, &holder);
+    CHECK(capture == 0 && holder == scan);
+    CHECK(job_table_held(&table) == JOB_RES_WIFI);
+
+    // A disjoint one starts alongside
+    uint32_t ble = job_table_start(&table, "blescan -pcap", JOB_RES_BLE | JOB_RES_PCAP, &capture_owner, 120, 5000,
+                                   &holder);
+    CHECK(ble == 2 && holder == 0);
+    CHECK(job_table_held(&table) == (JOB_RES_WIFI | JOB_RES_BLE | JOB_RES_PCAP));
+    CHECK(job_table_start(&table, "capture -wps", JOB_RES_PCAP, &capture_owner, 130, 5000, &holder) == 0 &&
+          holder == ble);
+
+    // Long labels are cut, not overrun
+    uint32_t long_label = job_table_start(&table, "a label much longer than the slot has room for", JOB_RES_SCRIPT,
+                                          &script_owner, 140, 5000, &holder);
+    CHECK(strlen(job_table_find(&table, long_label)->label) == JOB_LABEL_LEN - 1);
+
+    CHECK(job_table_find(&table, 0) == NULL && job_table_find(&table, 99) == NULL);
+    CHECK(finished_count == 0);
+}
+
+static void test_stop_and_finish(void) {
+    uint32_t holder;
+
+    setup();
+    uint32_t a = job_table_start(&table, "scanap", JOB_RES_WIFI, &scan_owner, 1000, 8000, &holder);
+    uint32_t b = job_table_start(&table, "blescan -f", JOB_RES_BLE, &scan_owner, 1000, 8000, &holder);
+    uint32_t c = job_table_start(&table, "exec a.txt", JOB_RES_SCRIPT, &script_owner, 1000, 8000, &holder);
+
+    // Done, failed and cancelled by how it ended
+    CHECK(job_table_finish(&table, a, ESP_OK, 1500, 7900));
+    CHECK(finished_count == 1 && finished[0].id == a && finished[0].state == JOB_DONE);
+    CHECK(finished[0].ended_ms == 1500 && finished[0].heap_delta == -100);
+    CHECK(job_runtime_ms(job_table_find(&table, a), 9999) == 500);
+
+    CHECK(job_table_finish(&table, b, ESP_FAIL, 2000, 8000));
+    CHECK(finished[1].state == JOB_FAILED && finished[1].result == ESP_FAIL);
+
+    CHECK(job_table_stop(&table, c));
+    CHECK(job_table_find(&table, c)->state == JOB_STOPPING);
+    // Still holds its resource while the hook runs
+    CHECK(job_table_held(&table) == JOB_RES_SCRIPT);
+    CHECK(job_runtime_ms(job_table_find(&table, c), 1700) == 700);
+    CHECK(!job_table_stop(&table, c));
+    CHECK(job_table_finish(&table, c, ESP_FAIL, 2500, 8000));
+    CHECK(finished[2].state == JOB_CANCELLED && finished[2].result == ESP_FAIL);
+    CHECK(job_table_held(&table) == 0);
+
+    // Finished jobs cannot be stopped or finished again
+    CHECK(!job_table_stop(&table, a) && !job_table_finish(&table, a, ESP_OK, 3000, 8000));
+    CHECK(!job_table_stop(&table, 42) && !job_table_finish(&table, 42, ESP_OK, 3000, 8000));
+    CHECK(finished_count == 3);
+    CHECK(strcmp(job_state_name(JOB_CANCELLED), "cancelled") == 0 && !job_state_active(JOB_DONE));
+}
+
+static void test_release_by_owner(void) {
+    uint32_t holder;
+
+    setup();
+    uint32_t a = job_table_start(&table, "blescan -f", JOB_RES_BLE, &scan_owner, 0, 0, &holder);
+    uint32_t b = job_table_start(&table, "scansta", JOB_RES_WIFI, &scan_owner, 0, 0, &holder);
+    uint32_t c = job_table_start(&table, "capture -probe", JOB_RES_PCAP, &capture_owner, 0, 0, &holder);
+    CHECK(job_table_stop(&table, b));
+
+    // Every active job of the owner ends, a stopping one as cancelled
+    CHECK(job_table_release(&table, &scan_owner, ESP_OK, 10, 0) == 2);
+    CHECK(job_table_find(&table, a)->state == JOB_DONE && job_table_find(&table, b)->state == JOB_CANCELLED);
+    CHECK(job_table_find(&table, c)->state == JOB_RUNNING && job_table_held(&table) == JOB_RES_PCAP);
+    CHECK(finished_count == 2);
+
+    // Nothing left to release
+    CHECK(job_table_release(&table, &scan_owner, ESP_OK, 20, 0) == 0);
+    CHECK(job_table_release(&table, &script_owner, ESP_OK, 20, 0) == 0);
+    CHECK(finished_count == 2);
+}
+
+static void test_slot_reuse(void) {
+    uint32_t ids[JOB_TABLE_SLOTS];
+    uint32_t holder;
+    job_t *list[JOB_TABLE_SLOTS];
+
+    setup();
+    for (int i = 0; i < JOB_TABLE_SLOTS; i++) {
+        ids[i] = job_table_start(&table, "job", 0, &scan_owner, (uint32_t)i, 0, &holder);
+        CHECK(ids[i] == (uint32_t)i + 1);
+    }
+
+    // Every slot running: refused, with no holder to name
+    CHECK(job_table_start(&table, "one more", 0, &scan_owner, 100, 0, &holder) == 0 && holder == 0);
+
+    // Finished jobs stay listed until their slot is needed, oldest first
+    CHECK(job_table_finish(&table, ids[5], ESP_OK, 200, 0));
+    CHECK(job_table_finish(&table, ids[2], ESP_OK, 200, 0));
+    uint32_t n1 = job_table_start(&table, "new", 0, &scan_owner, 300, 0, &holder);
+    CHECK(n1 == JOB_TABLE_SLOTS + 1 && job_table_find(&table, ids[2]) == NULL);
+    CHECK(job_table_find(&table, ids[5]) != NULL && job_table_find(&table, ids[5])->state == JOB_DONE);
+    uint32_t n2 = job_table_start(&table, "newer", 0, &scan_owner, 300, 0, &holder);
+    CHECK(n2 == n1 + 1 && job_table_find(&table, ids[5]) == NULL);
+    CHECK(job_table_start(&table, "full", 0, &scan_owner, 300, 0, &holder) == 0);
+
+    // A reused slot starts clean
+    job_t *job = job_table_find(&table, n2);
+    CHECK(job->state == JOB_RUNNING && job->result == 0 && job->items == 0 && strcmp(job->label, "newer") == 0);
+
+    // Listed newest first, and a short list still gets the newest
+    CHECK(job_table_list(&table, list, JOB_TABLE_SLOTS) == JOB_TABLE_SLOTS);
+    for (int i = 1; i < JOB_TABLE_SLOTS; i++) {
+        CHECK(list[i - 1]->id > list[i]->id);
+    }
+    CHECK(list[0]->id == n2 && list[1]->id == n1);
+    CHECK(job_table_list(&table, list, 3) == JOB_TABLE_SLOTS);
+    CHECK(list[0]->id == n2 && list[1]->id == n1 && list[2]->id == ids[7]);
+
+    // Ids skip 0 when they wrap
+    setup();
+    table.next_id = UINT32_MAX;
+    CHECK(job_table_start(&table, "last", 0, &scan_owner, 0, 0, &holder) == UINT32_MAX);
+    CHECK(job_table_start(&table, "first", 0, &scan_owner, 0, 0, &holder) == 1);
+}
+
+// The stop command as commandline.c runs it: system_manager_job_stop, minus
+// the lock, for each kind of job stop ends
+
+typedef struct {
+    uint32_t resources;
+    void (*stop)(void);
+} job_desc_t;
+
+static bool ble_scanning, pcap_open, coex_running, deauthing;
+
+static void ble_stop(void) {
+    ble_scanning = false;
+}
+
+static void stop_ble_capture(void) {
+    ble_stop();
+    pcap_open = false;
+}
+
+static void coex_manager_stop(void) {
+    coex_running = false;
+    ble_scanning = false;
+}
+
+static void wifi_manager_stop_deauth(void) {
+    deauthing = false;
+}
+
+static const job_desc_t attack_job = { JOB_RES_WIFI, wifi_manager_stop_deauth };
+static const job_desc_t blescan_job = { JOB_RES_BLE, ble_stop };
+static const job_desc_t blescan_pcap_job = { JOB_RES_BLE | JOB_RES_PCAP, stop_ble_capture };
+static const job_desc_t coex_job = { JOB_RES_WIFI | JOB_RES_BLE, coex_manager_stop };
+
+static size_t job_stop(const job_desc_t *desc) {
+    uint32_t ids[JOB_TABLE_SLOTS];
+    size_t count = 0;
+
+    for (int i = 0; i < JOB_TABLE_SLOTS; i++) {
+        job_t *job = &table.jobs[i];
+        if (job->id != 0 && job->owner == desc && job_table_stop(&table, job->id)) {
+            ids[count++] = job->id;
+        }
+    }
+    if (count > 0 && desc->stop != NULL) {
+        desc->stop();
+    }
+    for (size_t i = 0; i < count; i++) {
+        job_table_finish(&table, ids[i], ESP_OK, 0, 0);
+    }
+    return count;
+}
+
+static void handle_stop(void) {
+    if (job_stop(&attack_job) == 0) {
+        wifi_manager_stop_deauth();
+    }
+    if (job_stop(&blescan_job) + job_stop(&blescan_pcap_job) + job_stop(&coex_job) == 0) {
+        ble_stop();
+    }
+}
+
+static uint32_t start(const job_desc_t *desc, const char *label) {
+    uint32_t holder;
+    return job_table_start(&table, label, desc->resources, desc, 0, 0, &holder);
+}
+
+static void test_stop_command(void) {
+    // A BLE capture: the pcap closes and a WiFi capture can take it
+    setup();
+    uint32_t capture = start(&blescan_pcap_job, "blescan -pcap");
+    uint32_t attack = start(&attack_job, "attack -d");
+    ble_scanning = pcap_open = deauthing = true;
+    handle_stop();
+    CHECK(!ble_scanning && !pcap_open && !deauthing);
+    CHECK(job_table_find(&table, capture)->state == JOB_CANCELLED);
+    CHECK(job_table_find(&table, attack)->state == JOB_CANCELLED);
+    CHECK(job_table_held(&table) == 0);
+    CHECK(start(&blescan_pcap_job, "blescan -pcap") != 0);
+
+    // Coex mode stops scheduling and gives both radios back
+    setup();
+    uint32_t coex = start(&coex_job, "coex");
+    coex_running = ble_scanning = true;
+    CHECK(start(&blescan_job, "blescan -f") == 0);
+    handle_stop();
+    CHECK(!coex_running && job_table_find(&table, coex)->state == JOB_CANCELLED);
+    CHECK(start(&blescan_job, "blescan -f") != 0 && start(&attack_job, "attack -d") != 0);
+
+    // Without jobs the bare calls still stop whatever runs
+    setup();
+    ble_scanning = deauthing = pcap_open = true;
+    handle_stop();
+    CHECK(!ble_scanning && !deauthing && pcap_open);
+    CHECK(finished_count == 0);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_start_and_refuse);
+    TEST_RUN(test_stop_and_finish);
+    TEST_RUN(test_release_by_owner);
+    TEST_RUN(test_slot_reuse);
+    TEST_RUN(test_stop_command);
+    return test_done("job_table");
+}
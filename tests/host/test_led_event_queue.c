@@ -0,0 +1,244 @@
+#include "core/led_event_queue.h"
+#include "test.h"
+#include <pthread.h>
+
+static void test_coalesce_and_priority(void) {
+    led_event_queue_t q;
+    led_event_t e;
+
+    led_event_queue_init(&q);
+    CHECK(led_event_queue_top_priority(&q) == -1);
+    CHECK(!led_event_queue_pop(&q, &e));
+
+    CHECK(led_event_queue_post(&q, 1, 0, 0, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_LOW));
+    CHECK(led_event_queue_post(&q, 1, 0, 0, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_LOW));
+    CHECK(q.length == 1 && q.events[0].count == 2 && q.coalesced == 1);
+
+    for (int i = 2; i <= LED_EVENT_QUEUE_LEN; i++) {
+        CHECK(led_event_queue_post(&q, (uint8_t)i, 0, 0, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_LOW));
+    }
+    CHECK(q.length == LED_EVENT_QUEUE_LEN);
+
+    // Full: an equal priority event is dropped, a higher one displaces the newest low
+    CHECK(!led_event_queue_post(&q, 99, 0, 0, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_LOW));
+    CHECK(led_event_queue_post(&q, 255, 0, 0, LED_PATTERN_SOLID, LED_EVENT_PRIORITY_HIGH));
+    CHECK(q.dropped == 2);
+    CHECK(led_event_queue_top_priority(&q) == LED_EVENT_PRIORITY_HIGH);
+
+    CHECK(led_event_queue_pop(&q, &e) && e.red == 255 && e.pattern == LED_PATTERN_SOLID);
+    // FIFO within a priority
+    for (int i = 1; i < LED_EVENT_QUEUE_LEN; i++) {
+        CHECK(led_event_queue_pop(&q, &e) && e.red == i);
+    }
+    CHECK(!led_event_queue_pop(&q, &e));
+
+    // Folding a higher priority post raises the pending event
+    led_event_queue_init(&q);
+    led_event_queue_post(&q, 5, 5, 5, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_LOW);
+    led_event_queue_post(&q, 6, 6, 6, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_NORMAL);
+    led_event_queue_post(&q, 5, 5, 5, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_HIGH);
+    CHECK(led_event_queue_pop(&q, &e) && e.red == 5 && e.count == 2 && e.priority == LED_EVENT_PRIORITY_HIGH);
+
+    // Same color, other pattern: not the same notification
+    led_event_queue_post(&q, 6, 6, 6, LED_PATTERN_SOLID, LED_EVENT_PRIORITY_NORMAL);
+    CHECK(q.length == 2);
+}
+
+// The LED task of rgb_manager against a mocked strip: a mutex stands in for
+// the critical section and a condition variable for the task notification.
+// Pulses are 2 * PULSE_STEPS + 1 strip writes of STEP_US each, and a post
+// that wakes the task lets a higher priority event cut in.
+
+#define PULSE_STEPS 5
+#define STEP_US     2000
+#define BURST       1000
+#define ARRIVAL_US  20
+
+typedef struct {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+} strip_color_t;
+
+static led_event_queue_t queue;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static bool notified;
+static bool stopping;
+
+static strip_color_t strip;
+static uint32_t strip_writes;
+static uint32_t events_shown;
+static uint32_t preemptions;
+static uint32_t high_shown;
+
+static void strip_set(uint8_t red, uint8_t green, uint8_t blue) {
+    strip.red = red;
+    strip.green = green;
+    strip.blue = blue;
+    strip_writes++;
+}
+
+static bool post(uint8_t red, uint8_t green, uint8_t blue, led_pattern_t pattern, led_event_priority_t priority) {
+    pthread_mutex_lock(&lock);
+    bool queued = led_event_queue_post(&queue, red, green, blue, pattern, priority);
+    if (queued) {
+        notified = true;
+        pthread_cond_signal(&wake);
+    }
+    pthread_mutex_unlock(&lock);
+    return queued;
+}
+
+// ulTaskNotifyTake with a timeout: true if a post came in meanwhile
+static bool wait_notify(uint32_t timeout_us) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_nsec += (long)timeout_us * 1000;
+    until.tv_sec += until.tv_nsec / 1000000000;
+    until.tv_nsec %= 1000000000;
+
+    pthread_mutex_lock(&lock);
+    while (!notified && !stopping) {
+        if (pthread_cond_timedwait(&wake, &lock, &until) != 0) {
+            break;
+        }
+    }
+    bool got = notified;
+    notified = false;
+    pthread_mutex_unlock(&lock);
+    return got;
+}
+
+static bool preempted(const led_event_t *event) {
+    pthread_mutex_lock(&lock);
+    int top = led_event_queue_top_priority(&queue);
+    pthread_mutex_unlock(&lock);
+    return top > (int)event->priority;
+}
+
+static void *led_task(void *arg) {
+    led_event_t event;
+
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        bool found = led_event_queue_pop(&queue, &event);
+        bool done = stopping;
+        pthread_mutex_unlock(&lock);
+
+        if (!found) {
+            if (done) {
+                return NULL;
+            }
+            wait_notify(100 * STEP_US);
+            continue;
+        }
+
+        events_shown++;
+        high_shown += event.priority == LED_EVENT_PRIORITY_HIGH;
+        if (event.pattern == LED_PATTERN_SOLID) {
+            strip_set(event.red, event.green, event.blue);
+            continue;
+        }
+        for (int step = -PULSE_STEPS; step <= PULSE_STEPS; step++) {
+            int scale = PULSE_STEPS - abs(step);
+            strip_set(event.red * scale / PULSE_STEPS, event.green * scale / PULSE_STEPS,
+                      event.blue * scale / PULSE_STEPS);
+            if (wait_notify(STEP_US) && preempted(&event)) {
+                preemptions++;
+                break;
+            }
+        }
+        strip_set(0, 0, 0);
+    }
+}
+
+// 1000 posts from a scan callback, one every ARRIVAL_US, while the LED task
+// is busy pulsing: no post waits for the strip, every alert gets through and
+// cuts into the pulse showing, and the strip ends up off
+static void test_burst_does_not_block(void) {
+    pthread_t task;
+    uint32_t accepted = 0, high_posted = 0, high_accepted = 0;
+    double worst = 0;
+
+    led_event_queue_init(&queue);
+    CHECK(pthread_create(&task, NULL, led_task, NULL) == 0);
+
+    double start = test_seconds();
+    for (int i = 0; i < BURST; i++) {
+        bool high = i % 50 == 0;
+        bool ok;
+        // An advert every ARRIVAL_US, so alerts land in the middle of pulses
+        while (test_seconds() - start < i * ARRIVAL_US / 1e6) {
+        }
+        double t = test_seconds();
+        if (high) {
+            ok = post(255, 0, 0, LED_PATTERN_PULSE, LED_EVENT_PRIORITY_HIGH);
+        } else {
+            ok = post(0, (uint8_t)(165 * (i % 2)), (uint8_t)((i % 7) * 30), LED_PATTERN_PULSE, LED_EVENT_PRIORITY_LOW);
+        }
+        t = test_seconds() - t;
+        if (t > worst) {
+            worst = t;
+        }
+        accepted += ok;
+        high_posted += high;
+        high_accepted += high && ok;
+    }
+    double total = test_seconds() - start;
+
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+    pthread_join(task, NULL);
+
+    printf("    %d posts in %.0f us (worst %.0f us), %u accepted, %u folded, %u dropped\n", BURST, total * 1e6,
+           worst * 1e6, accepted, queue.coalesced, queue.dropped);
+    printf("    LED task: %u events shown, %u alerts cut in, %u strip writes\n", events_shown, preemptions,
+           strip_writes);
+
+    // Showing every event the blocking way would have taken 1000 pulses
+    CHECK(total < BURST * (2 * PULSE_STEPS + 1) * STEP_US / 1e6 / 10);
+    // and no single post waited out a pulse
+    CHECK(worst < (2 * PULSE_STEPS + 1) * STEP_US / 1e6);
+    CHECK(queue.posted == BURST);
+    // Refused posts count as dropped, and so do the events they displaced
+    CHECK(queue.dropped >= BURST - accepted);
+    CHECK(high_accepted == high_posted);
+    CHECK(high_shown > 0);
+    CHECK(preemptions > 0);
+    CHECK(events_shown <= accepted - queue.coalesced);
+    CHECK(queue.length == 0);
+    CHECK(strip.red == 0 && strip.green == 0 && strip.blue == 0);
+}
+
+static void bench_post_pop(void) {
+    led_event_queue_t q;
+    led_event_t e;
+    const uint32_t rounds = 10000000;
+    uint32_t rng = 9;
+    uint32_t shown = 0;
+
+    led_event_queue_init(&q);
+    double start = test_seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        uint32_t r = test_rand(&rng);
+        led_event_queue_post(&q, (uint8_t)(r & 15), 0, 0, LED_PATTERN_PULSE, (led_event_priority_t)((r >> 8) % 3));
+        if ((r >> 16) % 4 == 0) {
+            shown += led_event_queue_pop(&q, &e);
+        }
+    }
+    double secs = test_seconds() - start;
+    printf("  led_event_queue_post: %.1f ns/post with a pop every 4th (%u shown, %u dropped)\n",
+           secs * 1e9 / rounds, shown, q.dropped);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_coalesce_and_priority);
+    TEST_RUN(test_burst_does_not_block);
+    if (test_bench_requested(argc, argv)) {
+        bench_post_pop();
+    }
+    return test_done("led_event_queue");
+}
@@ -0,0 +1,215 @@
+#include "core/line_discipline.h"
+#include "test.h"
+
+#define MAX_LINES 128
+
+static char lines[MAX_LINES][64];
+static int line_count;
+
+static void on_line(char *line, size_t len, void *ctx) {
+    CHECK(strlen(line) == len && len > 0);
+    CHECK(line_count < MAX_LINES);
+    snprintf(lines[line_count++], sizeof(lines[0]), "%s", line);
+}
+
+// Completes whatever is there with "ex ", as far as it fits
+static size_t complete(char *line, size_t len, size_t cap, void *ctx) {
+    CHECK(line[len] == '\0');
+    for (const char *add = "ex "; *add && len < cap; add++) {
+        line[len++] = *add;
+    }
+    return len;
+}
+
+static void feed(line_discipline_t *ld, const char *s) {
+    line_discipline_feed(ld, (const uint8_t *)s, strlen(s));
+}
+
+static void setup(line_discipline_t *ld, char *buf, size_t cap) {
+    line_discipline_init(ld, buf, cap, on_line, complete, NULL);
+    line_count = 0;
+}
+
+static void test_line_endings(void) {
+    char buf[16];
+    line_discipline_t ld;
+
+    setup(&ld, buf, sizeof(buf));
+    feed(&ld, "scanap\r\nlist -a\nstop\rjobs\n");
+    CHECK(line_count == 4 && ld.lines == 4);
+    CHECK(strcmp(lines[0], "scanap") == 0 && strcmp(lines[1], "list -a") == 0);
+    CHECK(strcmp(lines[2], "stop") == 0 && strcmp(lines[3], "jobs") == 0);
+
+    // Empty lines, bare or from LF CR pairs, are dropped
+    feed(&ld, "\r\r\n\n\n\r\r\n");
+    CHECK(line_count == 4);
+
+    // A CRLF split across reads is still one ending
+    feed(&ld, "sca");
+    feed(&ld, "nsta\r");
+    feed(&ld, "\n");
+    feed(&ld, "help\n");
+    CHECK(line_count == 6 && strcmp(lines[4], "scansta") == 0 && strcmp(lines[5], "help") == 0);
+
+    // Only the LF right after a CR is swallowed
+    feed(&ld, "a\rx\nb\n");
+    CHECK(line_count == 9 && strcmp(lines[6], "a") == 0 && strcmp(lines[7], "x") == 0 && strcmp(lines[8], "b") == 0);
+}
+
+static void test_overflow_discards_whole_line(void) {
+    char buf[8];
+    line_discipline_t ld;
+
+    // cap - 1 characters still fit
+    setup(&ld, buf, sizeof(buf));
+    feed(&ld, "1234567\n");
+    CHECK(line_count == 1 && strcmp(lines[0], "1234567") == 0 && ld.overflows == 0);
+
+    // One more and the whole line goes, nothing of it runs
+    feed(&ld, "12345678\n");
+    CHECK(line_count == 1 && ld.overflows == 1);
+    feed(&ld, "0123456789abcdefXYZ\r\nok\n");
+    CHECK(line_count == 2 && strcmp(lines[1], "ok") == 0 && ld.overflows == 2);
+
+    // Backspace and tab do not resurrect a discarded line
+    feed(&ld, "0123456789\b\b\b\b\b\b\t\n");
+    CHECK(line_count == 2 && ld.overflows == 3);
+
+    // The overflow spans reads and ends at the next end of line, not before
+    feed(&ld, "abcdefgh");
+    feed(&ld, "ijkl");
+    feed(&ld, "mn\r");
+    feed(&ld, "\nnext\n");
+    CHECK(line_count == 3 && strcmp(lines[2], "next") == 0 && ld.overflows == 4);
+}
+
+static void test_backspace_and_control(void) {
+    char buf[16];
+    line_discipline_t ld;
+
+    setup(&ld, buf, sizeof(buf));
+    feed(&ld, "helx\x7fp\n");
+    feed(&ld, "\b\b\bab\x01\x1b" "c\n");
+    feed(&ld, "abc\b\b\b\b\b\n");
+    feed(&ld, "x\b\x7fy\n");
+    CHECK(line_count == 3);
+    CHECK(strcmp(lines[0], "help") == 0 && strcmp(lines[1], "abc") == 0 && strcmp(lines[2], "y") == 0);
+
+    // Bytes above 0x7F are kept, only C0 controls are dropped
+    feed(&ld, "caf\xc3\xa9\x07\n");
+    CHECK(line_count == 4 && strcmp(lines[3], "caf\xc3\xa9") == 0);
+}
+
+static void test_completion(void) {
+    char buf[16];
+    line_discipline_t ld;
+
+    setup(&ld, buf, sizeof(buf));
+    feed(&ld, "co\t-s\n");
+    CHECK(line_count == 1 && strcmp(lines[0], "coex -s") == 0);
+
+    // Completion never grows the line past the buffer
+    feed(&ld, "0123456789abc\t\t\t\n");
+    CHECK(line_count == 2 && strlen(lines[1]) == sizeof(buf) - 1);
+
+    // Tab on an empty line hands over an empty string
+    feed(&ld, "\t\n");
+    CHECK(line_count == 3 && strcmp(lines[2], "ex ") == 0);
+
+    // Without a hook tab is ignored
+    line_discipline_init(&ld, buf, sizeof(buf), on_line, NULL, NULL);
+    feed(&ld, "ab\tc\n");
+    CHECK(line_count == 4 && strcmp(lines[3], "abc") == 0);
+}
+
+static void test_reset(void) {
+    char buf[8];
+    line_discipline_t ld;
+
+    setup(&ld, buf, sizeof(buf));
+    feed(&ld, "partial");
+    line_discipline_reset(&ld);
+    feed(&ld, "x\n");
+    CHECK(line_count == 1 && strcmp(lines[0], "x") == 0);
+
+    // Reset also ends a discard and forgets a pending CR
+    feed(&ld, "0123456789");
+    line_discipline_reset(&ld);
+    feed(&ld, "y\n");
+    feed(&ld, "z\r");
+    line_discipline_reset(&ld);
+    feed(&ld, "\n");
+    CHECK(line_count == 3 && strcmp(lines[1], "y") == 0 && strcmp(lines[2], "z") == 0);
+}
+
+// Any split of the input into reads gives the same lines as one big read
+static void test_chunking_does_not_matter(void) {
+    static const char *const pieces[] = { "ab", " ", "\r", "\n", "\r\n", "\b", "\x7f", "\t", "0123456789", "\x1b", "q" };
+    char buf[12];
+    char input[4096];
+    char whole[MAX_LINES][64];
+    line_discipline_t ld;
+    uint32_t rng = 17;
+
+    for (int round = 0; round < 300; round++) {
+        size_t len = 0;
+        while (len < 200) {
+            const char *p = pieces[test_rand(&rng) % (sizeof(pieces) / sizeof(pieces[0]))];
+            memcpy(input + len, p, strlen(p));
+            len += strlen(p);
+        }
+
+        setup(&ld, buf, sizeof(buf));
+        line_discipline_feed(&ld, (const uint8_t *)input, len);
+        int whole_count = line_count;
+        uint32_t whole_overflows = ld.overflows;
+        memcpy(whole, lines, sizeof(whole));
+
+        setup(&ld, buf, sizeof(buf));
+        for (size_t at = 0; at < len;) {
+            size_t n = 1 + test_rand(&rng) % 7;
+            n = n > len - at ? len - at : n;
+            line_discipline_feed(&ld, (const uint8_t *)input + at, n);
+            at += n;
+        }
+        CHECK(line_count == whole_count && ld.overflows == whole_overflows);
+        for (int i = 0; i < line_count; i++) {
+            CHECK(strcmp(lines[i], whole[i]) == 0);
+        }
+    }
+}
+
+static void count_line(char *line, size_t len, void *ctx) {
+    (*(uint32_t *)ctx)++;
+}
+
+static void bench_feed(void) {
+    static const char text[] = "capture -probe\r\nlist -s -o rssi\r\nblescan -t 20\r\nstop\r\n";
+    char buf[528];
+    line_discipline_t ld;
+    uint32_t count = 0;
+    const uint32_t rounds = 2000000;
+
+    line_discipline_init(&ld, buf, sizeof(buf), count_line, NULL, &count);
+    double start = test_seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        line_discipline_feed(&ld, (const uint8_t *)text, sizeof(text) - 1);
+    }
+    double secs = test_seconds() - start;
+    CHECK(count == rounds * 4);
+    printf("  line_discipline_feed: %.2f ns/byte, %.0f MB/s\n", secs * 1e9 / ((double)rounds * (sizeof(text) - 1)),
+           (double)rounds * (sizeof(text) - 1) / secs / 1e6);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_line_endings);
+    TEST_RUN(test_overflow_discards_whole_line);
+    TEST_RUN(test_backspace_and_control);
+    TEST_RUN(test_completion);
+    TEST_RUN(test_reset);
+    TEST_RUN(test_chunking_does_not_matter);
+    if (test_bench_requested(argc, argv)) {
+        bench_feed();
+    }
+    return test_done("line_discipline");
+}
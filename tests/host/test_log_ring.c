@@ -0,0 +1,410 @@
+#include "core/log_ring.h"
+#include "managers/log_stream.h"
+#include "test.h"
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define PRODUCERS        4
+#define STRESS_LINES     200000  // Per producer
+#define STRESS_READERS   2
+#define STREAM_SECONDS   120
+
+static log_ring_t ring;
+
+static void write_str(uint8_t level, uint8_t flags, uint32_t ms, const char *text) {
+    CHECK(log_ring_write(&ring, level, flags, ms, text, strlen(text)) == 1);
+}
+
+static bool read_is(log_cursor_t *c, uint32_t seq, const char *text) {
+    log_entry_t e;
+    if (!log_ring_read(&ring, c, &e)) {
+        fprintf(stderr, "nothing to read, want %lu '%s'\n", (unsigned long)seq, text);
+        return false;
+    }
+    if (e.seq != seq || strcmp(e.text, text) != 0 || e.len != strlen(text)) {
+        fprintf(stderr, "read %lu '%s', want %lu '%s'\n", (unsigned long)e.seq, e.text, (unsigned long)seq, text);
+        return false;
+    }
+    return true;
+}
+
+static void test_write_and_read(void) {
+    log_cursor_t c;
+    log_entry_t e;
+
+    log_ring_init(&ring);
+    log_ring_cursor_init(&ring, &c, true);
+    CHECK(!log_ring_read(&ring, &c, &e) && c.missed == 0);
+
+    write_str(LOG_RING_WARN, LOG_RING_NO_UART, 1234, "W (1234) wifi: low heap");
+    CHECK(log_ring_read(&ring, &c, &e));
+    CHECK(e.seq == 0 && e.ms == 1234 && e.level == LOG_RING_WARN && e.flags == LOG_RING_NO_UART);
+    CHECK(strcmp(e.text, "W (1234) wifi: low heap") == 0);
+    CHECK(!log_ring_read(&ring, &c, &e));
+
+    write_str(LOG_RING_INFO, 0, 1, "one");
+    write_str(LOG_RING_INFO, 0, 2, "two");
+    CHECK(read_is(&c, 1, "one") && read_is(&c, 2, "two"));
+    CHECK(log_ring_head(&ring) == 3 && c.missed == 0);
+
+    // Empty writes take no slot
+    CHECK(log_ring_write(&ring, LOG_RING_INFO, 0, 0, "", 0) == 0 && log_ring_head(&ring) == 3);
+}
+
+static void test_long_lines_split(void) {
+    char line[3 * LOG_RING_TEXT + 10];
+    char joined[sizeof(line)] = "";
+    log_cursor_t c;
+    log_entry_t e;
+
+    log_ring_init(&ring);
+    log_ring_cursor_init(&ring, &c, false);
+    for (size_t i = 0; i < sizeof(line) - 1; i++) {
+        line[i] = (char)('a' + i % 26);
+    }
+    line[sizeof(line) - 1] = '\0';
+
+    CHECK(log_ring_write(&ring, LOG_RING_ERROR, 0, 7, line, strlen(line)) == 4);
+    for (int i = 0; i < 4; i++) {
+        CHECK(log_ring_read(&ring, &c, &e) && e.level == LOG_RING_ERROR && e.ms == 7);
+        CHECK(e.len == (i < 3 ? LOG_RING_TEXT : 9));
+        strcat(joined, e.text);
+    }
+    CHECK(strcmp(joined, line) == 0);
+
+    // Exactly one slot's worth stays one slot
+    CHECK(log_ring_write(&ring, LOG_RING_INFO, 0, 0, line, LOG_RING_TEXT) == 1);
+}
+
+static void test_cursors(void) {
+    char text[24];
+    log_cursor_t fast, slow, late, resume;
+    log_entry_t e;
+
+    log_ring_init(&ring);
+    log_ring_cursor_init(&ring, &fast, true);
+    log_ring_cursor_init(&ring, &slow, true);
+    for (int i = 0; i < 10; i++) {
+        snprintf(text, sizeof(text), "line %d", i);
+        write_str(LOG_RING_INFO, 0, 0, text);
+    }
+
+    // Consumers keep their own place
+    for (int i = 0; i < 10; i++) {
+        snprintf(text, sizeof(text), "line %d", i);
+        CHECK(read_is(&fast, (uint32_t)i, text));
+    }
+    CHECK(read_is(&slow, 0, "line 0"));
+
+    // A new consumer starts after the last line, or at the oldest held
+    log_ring_cursor_init(&ring, &late, false);
+    CHECK(!log_ring_read(&ring, &late, &e));
+    log_ring_cursor_init(&ring, &late, true);
+    CHECK(read_is(&late, 0, "line 0"));
+
+    // Lapping: the slow consumer skips what was overwritten and counts it
+    for (int i = 10; i < LOG_RING_SLOTS + 30; i++) {
+        snprintf(text, sizeof(text), "line %d", i);
+        write_str(LOG_RING_INFO, 0, 0, text);
+    }
+    CHECK(read_is(&slow, 30, "line 30") && slow.missed == 29);
+    int read = 1;
+    while (log_ring_read(&ring, &slow, &e)) {
+        read++;
+    }
+    CHECK(read == LOG_RING_SLOTS && slow.missed == 29 && slow.next == LOG_RING_SLOTS + 30);
+
+    // History past the first lap is the last LOG_RING_SLOTS lines
+    log_ring_cursor_init(&ring, &late, true);
+    CHECK(read_is(&late, 30, "line 30") && late.missed == 0);
+
+    // Resuming at a line still held, one overwritten, and one from before a restart
+    log_ring_cursor_from(&ring, &resume, 50);
+    CHECK(read_is(&resume, 50, "line 50") && resume.missed == 0);
+    log_ring_cursor_from(&ring, &resume, 5);
+    CHECK(read_is(&resume, 30, "line 30") && resume.missed == 25);
+    log_ring_cursor_from(&ring, &resume, 100000);
+    CHECK(read_is(&resume, 30, "line 30") && resume.missed == 0);
+    log_ring_cursor_from(&ring, &resume, log_ring_head(&ring));
+    CHECK(!log_ring_read(&ring, &resume, &e));
+}
+
+// A line whose writer never finished holds readers back at it, and reads
+// as missed once the ring laps it
+static void test_unfinished_write(void) {
+    log_cursor_t c;
+    log_entry_t e;
+
+    log_ring_init(&ring);
+    log_ring_cursor_init(&ring, &c, true);
+    write_str(LOG_RING_INFO, 0, 0, "before");
+    // What put() leaves while it copies line 1
+    atomic_store(&ring.slots[1].state, (1u << 2) | 0x1u);
+    atomic_store(&ring.head, 2);
+    write_str(LOG_RING_INFO, 0, 0, "after");
+
+    CHECK(read_is(&c, 0, "before"));
+    CHECK(!log_ring_read(&ring, &c, &e) && c.next == 1);
+
+    for (int i = 0; i < LOG_RING_SLOTS; i++) {
+        write_str(LOG_RING_INFO, 0, 0, "filler");
+    }
+    // The writer that reached slot 1 again gave up its line to the stuck one
+    CHECK(atomic_load(&ring.lost) == 1);
+    CHECK(log_ring_read(&ring, &c, &e) && e.seq > 1 && c.missed == e.seq - 1);
+}
+
+// A web UI stream under a busy but normal log: a scan's 100 lines a second,
+// one in eight long enough for two slots, a 100 line burst every 5 s, and
+// every eighth poll half a second late. Read as log_stream.c does, at most a
+// ring's worth per LOG_STREAM_POLL_MS poll, it must not lose a line.
+static void test_stream_rate_reader(void) {
+    log_cursor_t c;
+    log_entry_t e;
+    char line[2 * LOG_RING_TEXT];
+    uint32_t next_poll = LOG_STREAM_POLL_MS;
+    uint32_t polls = 0;
+    uint32_t read = 0;
+    uint32_t peak = 0;
+
+    log_ring_init(&ring);
+    log_ring_cursor_init(&ring, &c, false);
+    memset(line, 'x', sizeof(line));
+
+    for (uint32_t ms = 0; ms < STREAM_SECONDS * 1000; ms++) {
+        if (ms % 10 == 0) {
+            size_t len = (ms / 10) % 8 == 0 ? LOG_RING_TEXT + 40 : 70;
+            log_ring_write(&ring, LOG_RING_INFO, 0, ms, line, len);
+        }
+        if (ms % 5000 == 2500) {
+            for (int i = 0; i < 100; i++) {
+                log_ring_write(&ring, LOG_RING_INFO, 0, ms, line, 60);
+            }
+        }
+        if (ms == next_poll) {
+            uint32_t backlog = log_ring_head(&ring) - c.next;
+            peak = backlog > peak ? backlog : peak;
+            for (int lines = 0; lines < LOG_RING_SLOTS && log_ring_read(&ring, &c, &e); lines++) {
+                read++;
+            }
+            polls++;
+            next_poll += LOG_STREAM_POLL_MS + (polls % 8 == 7 ? 500 : 0);
+        }
+    }
+    while (log_ring_read(&ring, &c, &e)) {
+        read++;
+    }
+
+    printf("    %lu slots over %d s, at most %lu waiting for a poll of %d\n", (unsigned long)log_ring_head(&ring),
+           STREAM_SECONDS, (unsigned long)peak, LOG_RING_SLOTS);
+    CHECK(c.missed == 0 && read == log_ring_head(&ring));
+    CHECK(peak <= LOG_RING_SLOTS);
+}
+
+static void test_clean_line(void) {
+    char line[64];
+    size_t len;
+
+    snprintf(line, sizeof(line), "\033[0;31mE (1234) wifi: failed\033[0m\r\n");
+    len = strlen(line);
+    CHECK(log_ring_clean_line(line, &len) == LOG_RING_ERROR);
+    CHECK(strcmp(line, "E (1234) wifi: failed") == 0 && len == strlen(line));
+
+    snprintf(line, sizeof(line), "\033[0;33mW (5) x: y\033[0m\n");
+    len = strlen(line);
+    CHECK(log_ring_clean_line(line, &len) == LOG_RING_WARN && strcmp(line, "W (5) x: y") == 0);
+
+    snprintf(line, sizeof(line), "D (1) t: d");
+    len = strlen(line);
+    CHECK(log_ring_clean_line(line, &len) == LOG_RING_DEBUG);
+    snprintf(line, sizeof(line), "V (1) t: v");
+    len = strlen(line);
+    CHECK(log_ring_clean_line(line, &len) == LOG_RING_VERBOSE);
+    snprintf(line, sizeof(line), "I (1) t: i");
+    len = strlen(line);
+    CHECK(log_ring_clean_line(line, &len) == LOG_RING_INFO);
+
+    // Plain text is info, whatever its first letter
+    snprintf(line, sizeof(line), "Error: pcap failed to open\n");
+    len = strlen(line);
+    CHECK(log_ring_clean_line(line, &len) == LOG_RING_INFO && strcmp(line, "Error: pcap failed to open") == 0);
+
+    // An escape cut off at the end of the line is dropped, not left dangling
+    snprintf(line, sizeof(line), "text\033[0;3");
+    len = strlen(line);
+    log_ring_clean_line(line, &len);
+    CHECK(strcmp(line, "text") == 0 && len == 4);
+
+    snprintf(line, sizeof(line), "\r\n\r\n");
+    len = strlen(line);
+    log_ring_clean_line(line, &len);
+    CHECK(len == 0 && line[0] == '\0');
+}
+
+// Multi-producer stress: producers write numbered lines whose text is a
+// function of producer and number, readers check every line they get is
+// intact, in order per producer, and that read plus missed adds up.
+
+typedef struct {
+    int id;
+    uint32_t sleep_every;        // Reader: pause every this many lines, 0 never
+    // Results
+    uint32_t read;
+    uint32_t missed;
+    uint32_t last[PRODUCERS];    // Last line number seen per producer, plus one
+    bool intact;
+} stress_reader_t;
+
+static bool producers_done;
+
+static size_t stress_line(char *out, int producer, uint32_t n) {
+    size_t len = (size_t)snprintf(out, LOG_RING_TEXT + 1, "P%d %lu ", producer, (unsigned long)n);
+    size_t want = 10 + (n * 7 + (uint32_t)producer) % (LOG_RING_TEXT - 20);
+    while (len < want) {
+        out[len] = (char)('A' + (n + len) % 26);
+        len++;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static void *stress_producer(void *arg) {
+    int id = (int)(intptr_t)arg;
+    char line[LOG_RING_TEXT + 1];
+
+    for (uint32_t n = 0; n < STRESS_LINES; n++) {
+        size_t len = stress_line(line, id, n);
+        log_ring_write(&ring, LOG_RING_INFO, (uint8_t)id, n, line, len);
+    }
+    return NULL;
+}
+
+static bool stress_check(stress_reader_t *r, const log_entry_t *e) {
+    char want[LOG_RING_TEXT + 1];
+    int producer;
+    unsigned long n;
+
+    if (sscanf(e->text, "P%d %lu ", &producer, &n) != 2 || producer < 0 || producer >= PRODUCERS) {
+        return false;
+    }
+    size_t len = stress_line(want, producer, (uint32_t)n);
+    if (e->len != len || strcmp(e->text, want) != 0 || e->flags != producer || e->ms != n) {
+        return false;
+    }
+    if (n < r->last[producer]) {
+        return false;
+    }
+    r->last[producer] = (uint32_t)n + 1;
+    return true;
+}
+
+static void *stress_reader(void *arg) {
+    stress_reader_t *r = arg;
+    log_cursor_t c;
+    log_entry_t e;
+    uint32_t last_seq = 0;
+
+    log_ring_cursor_init(&ring, &c, true);
+    r->intact = true;
+    for (;;) {
+        bool done = __atomic_load_n(&producers_done, __ATOMIC_ACQUIRE);
+        while (log_ring_read(&ring, &c, &e)) {
+            r->intact &= stress_check(r, &e) && (r->read == 0 || e.seq > last_seq);
+            last_seq = e.seq;
+            r->read++;
+            if (r->sleep_every != 0 && r->read % r->sleep_every == 0) {
+                usleep(100);
+            }
+        }
+        // Everything written before the producers finished has been seen
+        if (done) {
+            break;
+        }
+        sched_yield();
+    }
+    r->missed = c.missed;
+    return NULL;
+}
+
+static void run_stress(stress_reader_t *readers, int reader_count, double *secs) {
+    pthread_t producers[PRODUCERS];
+    pthread_t reader_threads[STRESS_READERS];
+
+    log_ring_init(&ring);
+    producers_done = false;
+    for (int i = 0; i < reader_count; i++) {
+        CHECK(pthread_create(&reader_threads[i], NULL, stress_reader, &readers[i]) == 0);
+    }
+    double start = test_seconds();
+    for (int i = 0; i < PRODUCERS; i++) {
+        CHECK(pthread_create(&producers[i], NULL, stress_producer, (void *)(intptr_t)i) == 0);
+    }
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    *secs = test_seconds() - start;
+    __atomic_store_n(&producers_done, true, __ATOMIC_RELEASE);
+    for (int i = 0; i < reader_count; i++) {
+        pthread_join(reader_threads[i], NULL);
+    }
+}
+
+static void test_multi_producer_stress(void) {
+    stress_reader_t readers[STRESS_READERS] = { { .id = 0 }, { .id = 1, .sleep_every = 64 } };
+    double secs;
+
+    run_stress(readers, STRESS_READERS, &secs);
+    uint32_t written = log_ring_head(&ring);
+    uint32_t lost = atomic_load(&ring.lost);
+    CHECK(written == PRODUCERS * STRESS_LINES);
+
+    for (int i = 0; i < STRESS_READERS; i++) {
+        stress_reader_t *r = &readers[i];
+        printf("    reader %d: %lu read, %lu missed of %lu written (%lu lost to lapped writers)\n", r->id,
+               (unsigned long)r->read, (unsigned long)r->missed, (unsigned long)written, (unsigned long)lost);
+        CHECK(r->intact);
+        CHECK(r->read + r->missed == written);
+        CHECK(r->read > 0);
+    }
+    // Sleeping every 64 lines cannot keep up with four producers
+    CHECK(readers[1].missed > 0);
+}
+
+static void bench_log_ring(void) {
+    stress_reader_t reader = { .id = 0 };
+    double secs;
+    log_cursor_t c;
+    log_entry_t e;
+    const uint32_t rounds = 5000000;
+    static const char text[] = "I (123456) BLE: Found Flipper Device: MAC: 80:e1:26:00:00:01, RSSI: -61";
+
+    log_ring_init(&ring);
+    log_ring_cursor_init(&ring, &c, true);
+    double start = test_seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        log_ring_write(&ring, LOG_RING_INFO, 0, i, text, sizeof(text) - 1);
+        CHECK(log_ring_read(&ring, &c, &e));
+    }
+    double single = test_seconds() - start;
+    printf("  log_ring: %.0f ns per write and read, one thread\n", single * 1e9 / rounds);
+
+    run_stress(&reader, 1, &secs);
+    CHECK(reader.intact);
+    printf("  log_ring: %.1f M lines/s from %d producers, reader got %.1f%%\n",
+           PRODUCERS * STRESS_LINES / secs / 1e6, PRODUCERS, 100.0 * reader.read / (PRODUCERS * STRESS_LINES));
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_write_and_read);
+    TEST_RUN(test_long_lines_split);
+    TEST_RUN(test_cursors);
+    TEST_RUN(test_unfinished_write);
+    TEST_RUN(test_stream_rate_reader);
+    TEST_RUN(test_clean_line);
+    TEST_RUN(test_multi_producer_stress);
+    if (test_bench_requested(argc, argv)) {
+        bench_log_ring();
+    }
+    return test_done("log_ring");
+}
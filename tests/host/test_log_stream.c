@@ -0,0 +1,749 @@
+#include "managers/log_stream.h"
+#include "managers/log_manager.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "test.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+// log_stream.c, log_manager.c and log_ring.c as they run on the device, with
+// httpd simulated by one thread that runs requests, queued work and session
+// closes in order, as the server task does. Each socket keeps what was sent
+// on it, and the event streams are parsed back and checked line by line.
+
+#define PRODUCERS      3
+#define PRODUCER_LINES 20000
+#define SOCKETS        32
+
+// FreeRTOS. Nothing reads the console here, so the UART task is not started
+// and its notifications go nowhere.
+
+struct host_semaphore {
+    pthread_mutex_t mutex;
+};
+
+struct host_task {
+    int unused;
+};
+
+static struct host_semaphore semaphores[4];
+static int semaphore_count;
+static struct host_task uart_task;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    CHECK(semaphore_count < 4);
+    SemaphoreHandle_t sem = &semaphores[semaphore_count++];
+    pthread_mutex_init(&sem->mutex, NULL);
+    return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+    CHECK(wait == portMAX_DELAY);
+    pthread_mutex_lock(&sem->mutex);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    pthread_mutex_unlock(&sem->mutex);
+    return pdTRUE;
+}
+
+BaseType_t xTaskCreate(void (*task)(void *), const char *name, uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *out) {
+    *out = &uart_task;
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return NULL;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+    return 0;
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func) {
+    return NULL;
+}
+
+// esp_timer. The clock can be moved ahead to bring on the keep-alives, and
+// the poll timer fires every millisecond rather than every
+// LOG_STREAM_POLL_MS to keep the test short.
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    atomic_bool active;
+};
+
+static struct esp_timer poll_timer;
+static pthread_t timer_thread;
+static atomic_bool timer_running = true;
+static _Atomic int64_t clock_offset_us;
+
+int64_t esp_timer_get_time(void) {
+    return (int64_t)(test_seconds() * 1e6) + clock_offset_us;
+}
+
+static void *timer_task(void *arg) {
+    while (timer_running) {
+        if (poll_timer.active) {
+            poll_timer.args.callback(poll_timer.args.arg);
+        }
+        usleep(1000);
+    }
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+    CHECK(strcmp(args->name, "log_stream") == 0);
+    poll_timer.args = *args;
+    CHECK(pthread_create(&timer_thread, NULL, timer_task, NULL) == 0);
+    *out = &poll_timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    CHECK(period_us == LOG_STREAM_POLL_MS * 1000);
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    timer->active = false;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    return timer->active;
+}
+
+// httpd
+
+typedef enum {
+    SOCK_OK,
+    SOCK_TRICKLE,                // Takes a few bytes per send
+    SOCK_GONE,                   // The peer vanished without a FIN, sends fail
+} sock_mode_t;
+
+typedef struct {
+    char *out;
+    size_t len;
+    size_t cap;
+    sock_mode_t mode;
+    bool headers_sent;
+    bool hold_close;             // A triggered close waits for the test's client_close
+    bool close_held;
+    bool closed;
+    void *sess_ctx;
+    httpd_free_ctx_fn_t free_ctx;
+} sock_t;
+
+typedef enum {
+    OP_REQUEST,
+    OP_WORK,
+    OP_CLOSE,
+    OP_SYNC,
+    OP_QUIT,
+} op_kind_t;
+
+typedef struct op {
+    op_kind_t kind;
+    httpd_req_t req;
+    char *last_event_id;
+    httpd_work_fn_t work;
+    void *arg;
+    int fd;
+    struct op *next;
+} op_t;
+
+static int server_tag;
+#define SERVER ((httpd_handle_t)&server_tag)
+
+// sockets is only touched with server_mutex held, which the httpd thread
+// holds while it runs an op
+static sock_t sockets[SOCKETS];
+static pthread_mutex_t server_mutex = PTHREAD_MUTEX_INITIALIZER;
+static httpd_uri_t logs_uri;
+static pthread_t httpd_thread;
+static uint32_t trickle_rand = 7;
+
+static op_t *ops_head, *ops_tail;
+static pthread_mutex_t ops_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ops_cond = PTHREAD_COND_INITIALIZER;
+static atomic_long flushes;
+static atomic_long synced;
+
+static void push_op(op_t *op) {
+    pthread_mutex_lock(&ops_mutex);
+    op->next = NULL;
+    if (ops_tail != NULL) {
+        ops_tail->next = op;
+    } else {
+        ops_head = op;
+    }
+    ops_tail = op;
+    pthread_cond_signal(&ops_cond);
+    pthread_mutex_unlock(&ops_mutex);
+}
+
+static op_t *new_op(op_kind_t kind) {
+    op_t *op = calloc(1, sizeof(*op));
+    CHECK(op != NULL);
+    op->kind = kind;
+    return op;
+}
+
+static void put(sock_t *s, const char *data, size_t len) {
+    if (s->len + len > s->cap) {
+        s->cap = (s->len + len) * 2;
+        s->out = realloc(s->out, s->cap);
+        CHECK(s->out != NULL);
+    }
+    memcpy(s->out + s->len, data, len);
+    s->len += len;
+}
+
+static void close_session(sock_t *s) {
+    if (s->closed) {
+        return;
+    }
+    s->closed = true;
+    if (s->sess_ctx != NULL && s->free_ctx != NULL) {
+        s->free_ctx(s->sess_ctx);
+    }
+    s->sess_ctx = NULL;
+}
+
+static void run_request(op_t *op) {
+    sock_t *s = &sockets[op->req.fd];
+
+    CHECK(!s->closed && s->sess_ctx == NULL);
+    esp_err_t err = logs_uri.handler(&op->req);
+    s->sess_ctx = op->req.sess_ctx;
+    s->free_ctx = op->req.free_ctx;
+    if (err != ESP_OK) {
+        close_session(s);
+    }
+}
+
+static void *httpd_task(void *arg) {
+    for (;;) {
+        pthread_mutex_lock(&ops_mutex);
+        while (ops_head == NULL) {
+            pthread_cond_wait(&ops_cond, &ops_mutex);
+        }
+        op_t *op = ops_head;
+        ops_head = op->next;
+        if (ops_head == NULL) {
+            ops_tail = NULL;
+        }
+        pthread_mutex_unlock(&ops_mutex);
+
+        op_kind_t kind = op->kind;
+        pthread_mutex_lock(&server_mutex);
+        if (kind == OP_REQUEST) {
+            run_request(op);
+        } else if (kind == OP_WORK) {
+            op->work(op->arg);
+            flushes++;
+        } else if (kind == OP_CLOSE) {
+            close_session(&sockets[op->fd]);
+        } else if (kind == OP_SYNC) {
+            synced++;
+        }
+        pthread_mutex_unlock(&server_mutex);
+        free(op->last_event_id);
+        free(op);
+        if (kind == OP_QUIT) {
+            return NULL;
+        }
+    }
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri) {
+    CHECK(handle == SERVER && strcmp(uri->uri, "/api/logs") == 0 && uri->method == HTTP_GET);
+    logs_uri = *uri;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type) {
+    CHECK(strcmp(type, "text/event-stream") == 0);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value) {
+    CHECK(strcmp(field, "Cache-Control") == 0 && strcmp(value, "no-cache") == 0);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t len) {
+    sock_t *s = &sockets[req->fd];
+    char head[16];
+
+    CHECK(!s->closed);
+    s->headers_sent = true;
+    if (buf == NULL) {
+        put(s, "0\r\n\r\n", 5);
+        return ESP_OK;
+    }
+    put(s, head, (size_t)snprintf(head, sizeof(head), "%zx\r\n", (size_t)len));
+    put(s, buf, (size_t)len);
+    put(s, "\r\n", 2);
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size) {
+    CHECK(strcmp(field, "Last-Event-ID") == 0);
+    if (req->last_event_id == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    snprintf(val, val_size, "%s", req->last_event_id);
+    return strlen(req->last_event_id) < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len) {
+    if (req->query == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    snprintf(buf, buf_len, "%s", req->query);
+    return strlen(req->query) < buf_len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size) {
+    size_t key_len = strlen(key);
+
+    for (const char *p = qry; p != NULL; p = strchr(p, '&') != NULL ? strchr(p, '&') + 1 : NULL) {
+        if (strncmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            size_t len = strcspn(p + key_len + 1, "&");
+            if (len >= val_size) {
+                return ESP_ERR_HTTPD_RESULT_TRUNC;
+            }
+            memcpy(val, p + key_len + 1, len);
+            val[len] = '\0';
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *req) {
+    return req->fd;
+}
+
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char *buf, size_t buf_len, int flags) {
+    sock_t *s = &sockets[sockfd];
+
+    CHECK(handle == SERVER && s->headers_sent);
+    if (s->closed || s->mode == SOCK_GONE) {
+        return -1;
+    }
+    if (s->mode == SOCK_TRICKLE && buf_len > 1) {
+        buf_len = 1 + test_rand(&trickle_rand) % (buf_len < 7 ? buf_len : 7);
+    }
+    put(s, buf, buf_len);
+    return (int)buf_len;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg) {
+    CHECK(handle == SERVER && arg == SERVER);
+    op_t *op = new_op(OP_WORK);
+    op->work = work;
+    op->arg = arg;
+    push_op(op);
+    return ESP_OK;
+}
+
+// Like the real server the close happens later, on the httpd thread
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd) {
+    CHECK(handle == SERVER);
+    if (sockets[sockfd].hold_close) {
+        sockets[sockfd].close_held = true;
+        return ESP_OK;
+    }
+    op_t *op = new_op(OP_CLOSE);
+    op->fd = sockfd;
+    push_op(op);
+    return ESP_OK;
+}
+
+// Driving the server from the test
+
+static void client_connect(int fd, const char *query, long last_event_id) {
+    op_t *op = new_op(OP_REQUEST);
+    op->req.handle = SERVER;
+    op->req.uri = "/api/logs";
+    op->req.fd = fd;
+    op->req.query = query;
+    if (last_event_id >= 0) {
+        op->last_event_id = malloc(24);
+        CHECK(op->last_event_id != NULL);
+        snprintf(op->last_event_id, 24, "%ld", last_event_id);
+        op->req.last_event_id = op->last_event_id;
+    }
+    push_op(op);
+}
+
+// The browser goes away
+static void client_close(int fd) {
+    op_t *op = new_op(OP_CLOSE);
+    op->fd = fd;
+    push_op(op);
+}
+
+// Polls until cond holds, failing after five seconds
+#define WAIT_FOR(cond)                                                                  \
+    do {                                                                                \
+        double until_ = test_seconds() + 5;                                             \
+        while (!(cond)) {                                                               \
+            CHECK(test_seconds() < until_);                                             \
+            usleep(1000);                                                               \
+        }                                                                               \
+    } while (0)
+
+// Waits for everything queued so far to run
+static void httpd_sync(void) {
+    long target = synced + 1;
+    push_op(new_op(OP_SYNC));
+    WAIT_FOR(synced >= target);
+}
+
+static void wait_flushes(long count) {
+    long target = flushes + count;
+    WAIT_FOR(flushes >= target);
+}
+
+static void set_mode(int fd, sock_mode_t mode) {
+    pthread_mutex_lock(&server_mutex);
+    sockets[fd].mode = mode;
+    pthread_mutex_unlock(&server_mutex);
+}
+
+static bool sock_flag(int fd, const bool *flag) {
+    pthread_mutex_lock(&server_mutex);
+    bool value = *flag;
+    pthread_mutex_unlock(&server_mutex);
+    return value;
+}
+
+// Reading a stream back
+
+typedef struct {
+    int retry;
+    long events;
+    long missed;                 // Summed from the missed events
+    long missed_before_first;
+    long keepalives;
+    long first_id;
+    long last_id;
+    long with_second_line;
+    bool ended;                  // Closed with the final chunk
+} stream_t;
+
+// "init N", "note N" or "P<producer> <n> " and a run of one letter
+static bool line_intact(const char *text) {
+    int producer, n, off;
+    if (sscanf(text, "init %d", &n) == 1 || sscanf(text, "note %d", &n) == 1) {
+        return true;
+    }
+    if (sscanf(text, "P%d %d %n", &producer, &n, &off) != 2) {
+        return false;
+    }
+    for (const char *p = text + off; *p != '\0'; p++) {
+        if (*p != 'a' + (producer + n) % 26) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void parse_event(char *ev, stream_t *st, long *pending_missed) {
+    char data[2 * LOG_RING_TEXT] = "";
+    long id = -1;
+    bool missed = false;
+    int data_lines = 0;
+
+    for (char *line = strtok(ev, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+        if (strncmp(line, "retry: ", 7) == 0) {
+            st->retry = atoi(line + 7);
+        } else if (strncmp(line, "id: ", 4) == 0) {
+            id = atol(line + 4);
+        } else if (strcmp(line, "event: missed") == 0) {
+            missed = true;
+        } else if (strcmp(line, ": keep-alive") == 0) {
+            st->keepalives++;
+        } else {
+            CHECK(strncmp(line, "data: ", 6) == 0 && strlen(data) + strlen(line) < sizeof(data));
+            if (data_lines++ > 0) {
+                strcat(data, "\n");
+            }
+            strcat(data, line + 6);
+        }
+    }
+
+    if (missed) {
+        CHECK(id < 0 && atol(data) > 0);
+        *pending_missed += atol(data);
+        st->missed += atol(data);
+        return;
+    }
+    if (id < 0) {
+        return;
+    }
+
+    // A line break inside a line arrives as a second data line
+    char *second = strchr(data, '\n');
+    if (second != NULL) {
+        CHECK(strcmp(second, "\nsecond line") == 0);
+        *second = '\0';
+        st->with_second_line++;
+    }
+    if (!line_intact(data)) {
+        fprintf(stderr, "id %ld: '%s'\n", id, data);
+        CHECK(false);
+    }
+
+    // Every id is either sent or counted as missed, in order
+    if (st->first_id < 0) {
+        st->first_id = id;
+        st->missed_before_first = *pending_missed;
+    } else {
+        CHECK(id - st->last_id - 1 == *pending_missed);
+    }
+    st->last_id = id;
+    st->events++;
+    *pending_missed = 0;
+}
+
+static stream_t read_stream(int fd) {
+    stream_t st = { .first_id = -1, .last_id = -1 };
+    long pending_missed = 0;
+
+    pthread_mutex_lock(&server_mutex);
+    sock_t *s = &sockets[fd];
+    char *body = malloc(s->len + 1);
+    CHECK(body != NULL);
+
+    // Undo the chunked framing
+    size_t body_len = 0;
+    const char *p = s->out;
+    const char *end = s->out + s->len;
+    while (p < end) {
+        char *next;
+        unsigned long n = strtoul(p, &next, 16);
+        CHECK(next[0] == '\r' && next[1] == '\n');
+        p = next + 2;
+        if (n == 0) {
+            CHECK(p + 2 == end && p[0] == '\r' && p[1] == '\n');
+            st.ended = true;
+            break;
+        }
+        CHECK(p + n + 2 <= end && p[n] == '\r' && p[n + 1] == '\n');
+        memcpy(body + body_len, p, n);
+        body_len += n;
+        p += n + 2;
+    }
+    pthread_mutex_unlock(&server_mutex);
+    body[body_len] = '\0';
+
+    // Events end in a blank line. Found by hand: strstr under ASan walks the
+    // whole rest of the body every time
+    char *ev = body;
+    while (*ev != '\0') {
+        char *stop = ev;
+        while (stop[0] != '\0' && (stop[0] != '\n' || stop[1] != '\n')) {
+            stop++;
+        }
+        CHECK(stop[0] != '\0');
+        *stop = '\0';
+        parse_event(ev, &st, &pending_missed);
+        ev = stop + 2;
+    }
+    CHECK(pending_missed == 0);
+    free(body);
+    return st;
+}
+
+static void *producer_task(void *arg) {
+    int id = (int)(intptr_t)arg;
+    uint32_t state = (uint32_t)id + 1;
+    char line[LOG_RING_TEXT];
+
+    for (int i = 0; i < PRODUCER_LINES; i++) {
+        int len = snprintf(line, sizeof(line), "P%d %d ", id, i);
+        int fill = (int)(test_rand(&state) % 90);
+        memset(line + len, 'a' + (id + i) % 26, fill);
+        line[len + fill] = '\0';
+        if (i % 1000 == 0) {
+            strcat(line, "\nsecond line");
+        }
+        log_manager_write(LOG_RING_INFO, LOG_RING_NO_UART, line);
+        if (i % 8 == 0) {
+            usleep(200);
+        }
+    }
+    return NULL;
+}
+
+static void write_notes(int from, int count) {
+    char line[24];
+    for (int i = from; i < from + count; i++) {
+        snprintf(line, sizeof(line), "note %d", i);
+        log_manager_write(LOG_RING_INFO, LOG_RING_NO_UART, line);
+    }
+}
+
+static void test_concurrent_readers(void) {
+    pthread_t producers[PRODUCERS];
+    char line[24];
+
+    for (int i = 0; i < 10; i++) {
+        snprintf(line, sizeof(line), "init %d", i);
+        log_manager_write(LOG_RING_INFO, LOG_RING_NO_UART, line);
+    }
+
+    client_connect(1, NULL, -1);
+    client_connect(2, "since=5", -1);
+    client_connect(3, "x=1&since=3", -1);
+    client_connect(4, NULL, -1);
+    // Every stream taken: gets what is held and the response ends
+    client_connect(5, NULL, -1);
+    httpd_sync();
+    set_mode(2, SOCK_TRICKLE);
+
+    for (int i = 0; i < PRODUCERS; i++) {
+        CHECK(pthread_create(&producers[i], NULL, producer_task, (void *)(intptr_t)i) == 0);
+    }
+    wait_flushes(50);
+
+    // A tab closes and its EventSource comes back with Last-Event-ID
+    client_close(3);
+    httpd_sync();
+    long resume = read_stream(3).last_id;
+    client_connect(6, "since=3", resume);
+    wait_flushes(50);
+
+    // A client vanishes; its stream is dropped and the slot goes to the next
+    set_mode(4, SOCK_GONE);
+    WAIT_FOR(sock_flag(4, &sockets[4].closed));
+    client_connect(7, NULL, -1);
+
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    // Full again, and resuming from a sequence number of an earlier boot
+    client_connect(8, "since=4000000000", -1);
+    wait_flushes(3);
+
+    // Idle streams get a keep-alive
+    clock_offset_us += (LOG_STREAM_KEEPALIVE_MS + 1000) * 1000LL;
+    wait_flushes(3);
+
+    long total = 10 + PRODUCERS * PRODUCER_LINES;
+    stream_t st[9];
+    for (int fd = 1; fd <= 8; fd++) {
+        st[fd] = read_stream(fd);
+    }
+    printf("    %ld lines, stream 1 got %ld and missed %ld, trickling stream 2 got %ld and missed %ld\n", total,
+           st[1].events, st[1].missed, st[2].events, st[2].missed);
+
+    // Live streams see every line from where they started, sent or missed
+    CHECK(st[1].retry == LOG_STREAM_RETRY_MS && !st[1].ended && st[1].keepalives >= 1);
+    CHECK(st[1].first_id == 0 && st[1].last_id == total - 1 && st[1].events + st[1].missed == total);
+    CHECK(st[2].first_id - 5 == st[2].missed_before_first && st[2].last_id == total - 1);
+    CHECK(st[2].events + st[2].missed == total - 5 && st[2].keepalives >= 1);
+    CHECK(st[3].first_id - 3 == st[3].missed_before_first && sock_flag(3, &sockets[3].closed));
+    CHECK(st[6].first_id - (resume + 1) == st[6].missed_before_first && st[6].last_id == total - 1);
+    CHECK(st[6].retry == LOG_STREAM_RETRY_MS && st[6].keepalives >= 1);
+    CHECK(st[7].retry == LOG_STREAM_RETRY_MS && !st[7].ended && st[7].last_id == total - 1);
+    CHECK(!st[4].ended && sock_flag(4, &sockets[4].closed));
+    CHECK(st[1].with_second_line > 0);
+
+    // Busy: what was held, then the end, with the longer retry
+    CHECK(st[5].retry == 10000 && st[5].ended && st[5].first_id == 0 && st[5].last_id == 9 && st[5].events == 10);
+    CHECK(st[8].retry == 10000 && st[8].ended && st[8].events == LOG_RING_SLOTS && st[8].last_id == total - 1);
+
+    for (int fd = 1; fd <= 8; fd++) {
+        client_close(fd);
+    }
+    httpd_sync();
+}
+
+// A dropped stream's session closes after its slot went to a new stream:
+// the late close must not take the slot from the new one
+static void test_slot_taken_before_close(void) {
+    for (int fd = 10; fd < 10 + LOG_STREAM_CLIENTS; fd++) {
+        client_connect(fd, NULL, -1);
+    }
+    httpd_sync();
+    write_notes(0, 5);
+
+    pthread_mutex_lock(&server_mutex);
+    sockets[10].hold_close = true;
+    sockets[10].mode = SOCK_GONE;
+    pthread_mutex_unlock(&server_mutex);
+    WAIT_FOR(sock_flag(10, &sockets[10].close_held));
+
+    client_connect(20, NULL, -1);
+    httpd_sync();
+    client_close(10);
+    httpd_sync();
+    CHECK(sock_flag(10, &sockets[10].closed));
+
+    // Still every stream taken
+    client_connect(21, NULL, -1);
+    write_notes(5, 5);
+    httpd_sync();
+    wait_flushes(3);
+
+    stream_t late = read_stream(20);
+    stream_t other = read_stream(11);
+    CHECK(late.retry == LOG_STREAM_RETRY_MS && !late.ended && late.last_id == other.last_id);
+    CHECK(read_stream(21).retry == 10000 && read_stream(21).ended);
+
+    for (int fd = 11; fd < 10 + LOG_STREAM_CLIENTS; fd++) {
+        client_close(fd);
+    }
+    client_close(20);
+    client_close(21);
+    httpd_sync();
+}
+
+static void test_stop(void) {
+    client_connect(30, NULL, -1);
+    httpd_sync();
+    wait_flushes(1);
+
+    // Nothing is queued once stopped
+    log_stream_stop();
+    httpd_sync();
+    long then = flushes;
+    usleep(20000);
+    CHECK(flushes == then);
+    client_close(30);
+    httpd_sync();
+}
+
+int main(int argc, char **argv) {
+    CHECK(pthread_create(&httpd_thread, NULL, httpd_task, NULL) == 0);
+    CHECK(log_manager_init() == ESP_OK);
+    CHECK(log_stream_register(SERVER) == ESP_OK);
+
+    TEST_RUN(test_concurrent_readers);
+    TEST_RUN(test_slot_taken_before_close);
+    TEST_RUN(test_stop);
+
+    push_op(new_op(OP_QUIT));
+    pthread_join(httpd_thread, NULL);
+    timer_running = false;
+    pthread_join(timer_thread, NULL);
+    for (int fd = 0; fd < SOCKETS; fd++) {
+        free(sockets[fd].out);
+    }
+    return test_done("log_stream");
+}
@@ -0,0 +1,295 @@
+#include "core/probe_tracker.h"
+#include "core/station_stats.h"
+#include "core/json_util.h"
+#include "test.h"
+
+#define FRAME_MAX 160
+
+// Probe request from mac for ssid ("" for a wildcard probe). The elements
+// that identify the hardware depend only on model; the DS channel, sequence
+// number and vendor payload change per frame like on a real phone.
+static size_t make_probe(uint8_t *f, const uint8_t mac[6], const char *ssid, uint32_t model, uint32_t seq) {
+    static const uint8_t rates[] = { 1, 8, 0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24 };
+    size_t ssid_len = strlen(ssid);
+    size_t i = 24;
+
+    memset(f, 0, 24);
+    f[0] = 0x40;
+    memset(&f[4], 0xFF, 6);
+    memcpy(&f[10], mac, 6);
+    memset(&f[16], 0xFF, 6);
+    f[22] = (uint8_t)(seq << 4);
+    f[23] = (uint8_t)(seq >> 4);
+
+    f[i++] = 0;
+    f[i++] = (uint8_t)ssid_len;
+    memcpy(&f[i], ssid, ssid_len);
+    i += ssid_len;
+    memcpy(&f[i], rates, sizeof(rates));
+    i += sizeof(rates);
+    f[i++] = 3;
+    f[i++] = 1;
+    f[i++] = (uint8_t)(1 + seq % 13);
+    f[i++] = 45;
+    f[i++] = 26;
+    for (int k = 0; k < 26; k++) {
+        f[i++] = (uint8_t)(model * 7 + k);
+    }
+    f[i++] = 127;
+    f[i++] = 8;
+    for (int k = 0; k < 8; k++) {
+        f[i++] = (uint8_t)((model & 3) << k);
+    }
+    f[i++] = 221;
+    f[i++] = 9;
+    f[i++] = 0x00;
+    f[i++] = 0x50;
+    f[i++] = 0xF2;
+    f[i++] = 0x08;
+    for (int k = 0; k < 5; k++) {
+        f[i++] = (uint8_t)(seq * 31 + k);
+    }
+    return i;
+}
+
+static void make_mac(uint8_t mac[6], bool randomized, uint32_t id) {
+    mac[0] = randomized ? 0x12 : 0x00;
+    mac[1] = 0x10;
+    mac[2] = (uint8_t)(id >> 24);
+    mac[3] = (uint8_t)(id >> 16);
+    mac[4] = (uint8_t)(id >> 8);
+    mac[5] = (uint8_t)id;
+}
+
+static void test_preferred_network_list(void) {
+    static probe_tracker_t t;
+    uint8_t f[FRAME_MAX];
+    uint8_t mac[6];
+    probe_update_t r;
+
+    probe_tracker_init(&t);
+    make_mac(mac, false, 1);
+
+    probe_tracker_update(&t, f, make_probe(f, mac, "Home", 1, 1), -40, 0, &r);
+    CHECK(r.device != NULL && r.new_device && r.new_ssid);
+    CHECK(strcmp(r.ssid, "Home") == 0);
+
+    probe_tracker_update(&t, f, make_probe(f, mac, "Home", 1, 2), -30, 5, &r);
+    CHECK(!r.new_device && !r.new_ssid);
+    CHECK(r.device->ssids[0].count == 2);
+    CHECK(r.device->rssi_max == -30);
+
+    // Wildcard probes count but carry no SSID
+    probe_tracker_update(&t, f, make_probe(f, mac, "", 1, 3), -30, 6, &r);
+    CHECK(r.ssid == NULL && !r.new_ssid);
+    CHECK(r.device->probes == 3);
+    CHECK(r.device->ssid_count == 1);
+
+    // Only the most recent PROBE_TRACKER_SSIDS_PER_DEV SSIDs are kept
+    for (int k = 0; k < 8; k++) {
+        char ssid[16];
+        snprintf(ssid, sizeof(ssid), "N%d", k);
+        probe_tracker_update(&t, f, make_probe(f, mac, ssid, 1, 4 + k), -30, 10 + k, &r);
+    }
+    CHECK(r.device->ssid_count == PROBE_TRACKER_SSIDS_PER_DEV);
+    CHECK(probe_tracker_find(&t, mac) == r.device);
+
+    make_mac(mac, false, 2);
+    CHECK(probe_tracker_find(&t, mac) == NULL);
+}
+
+static void test_randomized_macs_cluster_by_fingerprint(void) {
+    static probe_tracker_t t;
+    uint8_t f[FRAME_MAX];
+    uint8_t mac[6];
+    probe_update_t r;
+
+    probe_tracker_init(&t);
+    // One phone rotating its address five times
+    for (uint32_t k = 0; k < 5; k++) {
+        make_mac(mac, true, 100 + k);
+        probe_tracker_update(&t, f, make_probe(f, mac, "", 2, k * 17), -60, 100 + k, &r);
+        CHECK(r.device->randomized);
+    }
+    uint32_t phone = r.device->fingerprint;
+    const probe_cluster_t *c = probe_tracker_cluster(&t, phone);
+    CHECK(c != NULL && c->mac_count == 5);
+
+    // Another model gets its own cluster
+    make_mac(mac, true, 200);
+    probe_tracker_update(&t, f, make_probe(f, mac, "", 3, 0), -60, 200, &r);
+    CHECK(r.device->fingerprint != phone);
+    c = probe_tracker_cluster(&t, r.device->fingerprint);
+    CHECK(c != NULL && c->mac_count == 1);
+
+    // Global addresses are never clustered
+    make_mac(mac, false, 300);
+    probe_tracker_update(&t, f, make_probe(f, mac, "", 2, 0), -60, 300, &r);
+    CHECK(r.device->fingerprint == phone);
+    CHECK(probe_tracker_cluster(&t, phone)->mac_count == 5);
+}
+
+static void test_ignored_and_malformed_frames(void) {
+    static probe_tracker_t t;
+    uint8_t f[FRAME_MAX];
+    uint8_t mac[6];
+    probe_update_t r;
+
+    probe_tracker_init(&t);
+    make_mac(mac, false, 1);
+
+    probe_tracker_update(&t, f, make_probe(f, mac, "x", 1, 0), -40, 0, &r);
+    CHECK(r.device != NULL);
+
+    // Truncated header
+    probe_tracker_update(&t, f, 10, -40, 0, &r);
+    CHECK(r.device == NULL);
+
+    // Group addressed source
+    f[10] = 0x01;
+    probe_tracker_update(&t, f, 60, -40, 0, &r);
+    CHECK(r.device == NULL);
+
+    // Probe response
+    make_probe(f, mac, "x", 1, 0);
+    f[0] = 0x50;
+    probe_tracker_update(&t, f, 60, -40, 0, &r);
+    CHECK(r.device == NULL);
+
+    // SSID element running past the frame
+    memset(f, 0, sizeof(f));
+    f[0] = 0x40;
+    f[10] = 0x02;
+    f[25] = 200;
+    probe_tracker_update(&t, f, 30, -1, 300, &r);
+    CHECK(r.ssid == NULL);
+}
+
+static void test_json_escape(void) {
+    char out[32];
+
+    CHECK(json_append_string(out, sizeof(out), 0, "plain") == 7);
+    CHECK(strcmp(out, "\"plain\"") == 0);
+    CHECK(json_append_string(out, sizeof(out), 0, "q\"\\\x01\xE9") == 2 + 1 + 2 + 2 + 6 + 6);
+    CHECK(strcmp(out, "\"q\\\"\\\\\\u0001\\u00e9\"") == 0);
+
+    // Appends after existing content
+    strcpy(out, "[");
+    CHECK(json_append_string(out, sizeof(out), 1, "a") == 4);
+    CHECK(strcmp(out, "[\"a\"") == 0);
+
+    // Too small: reports the length needed and stays terminated
+    CHECK(json_append_string(out, 6, 0, "abcdefgh") == 10);
+    CHECK(strlen(out) == 5);
+    CHECK(json_append_string(out, 4, 10, "a") == 13);
+}
+
+static void test_device_json(void) {
+    static probe_tracker_t t;
+    uint8_t f[FRAME_MAX];
+    uint8_t mac[6];
+    probe_update_t r;
+    char out[512];
+
+    probe_tracker_init(&t);
+    make_mac(mac, false, 0x42);
+    probe_tracker_update(&t, f, make_probe(f, mac, "Cafe \"Wifi\"", 1, 0), -50, 1000, &r);
+    probe_tracker_update(&t, f, make_probe(f, mac, "Home", 1, 1), -45, 2000, &r);
+
+    size_t len = probe_tracker_format_json(&t, r.device, out, sizeof(out));
+    CHECK(len == strlen(out));
+    CHECK(strstr(out, "\"mac\":\"00:10:00:00:00:42\",\"randomized\":false") != NULL);
+    CHECK(strstr(out, "\"ssids\":[{\"ssid\":\"Cafe \\\"Wifi\\\"\",\"count\":1,\"rssi\":-50,") != NULL);
+    CHECK(strstr(out, "{\"ssid\":\"Home\",\"count\":1,\"rssi\":-45,\"first_seen_ms\":2000,\"last_seen_ms\":2000}]}") != NULL);
+    CHECK(probe_tracker_format_json(&t, r.device, out, 40) == 0);
+}
+
+// Stations list their probed SSIDs from the tracker fed by the same frames
+static void test_station_json_uses_tracker(void) {
+    static probe_tracker_t t;
+    static station_stats_t stats;
+    uint8_t f[FRAME_MAX];
+    uint8_t mac[6];
+    probe_update_t r;
+    bool is_new;
+    char out[512];
+
+    probe_tracker_init(&t);
+    station_stats_init(&stats);
+    make_mac(mac, false, 7);
+
+    static const char *ssids[] = { "Home", "", "Office", "Home" };
+    station_entry_t *e = NULL;
+    for (uint32_t k = 0; k < 4; k++) {
+        size_t len = make_probe(f, mac, ssids[k], 1, k);
+        e = station_stats_update(&stats, f, len, -55, 100 * k, &is_new);
+        probe_tracker_update(&t, f, len, -55, 100 * k, &r);
+        CHECK(e != NULL);
+    }
+    CHECK(e->probe_requests == 4);
+
+    CHECK(station_stats_format_json(e, &t, out, sizeof(out)) == strlen(out));
+    CHECK(strstr(out, "\"probe_requests\":4,\"probes\":[\"Home\",\"Office\"]}") != NULL);
+
+    // Without a tracker the list is empty rather than stale
+    CHECK(station_stats_format_json(e, NULL, out, sizeof(out)) == strlen(out));
+    CHECK(strstr(out, "\"probes\":[]}") != NULL);
+
+    CHECK(station_stats_format_json(e, &t, out, 60) == 0);
+}
+
+// 200k probe requests from 3000 devices of 20 models, 60% with randomized
+// addresses, asking for a few hundred SSIDs with a skewed popularity
+static void bench_large_corpus(void) {
+    enum { FRAMES = 200000, DEVICES = 3000, MODELS = 20 };
+    static probe_tracker_t t;
+    uint8_t (*frames)[FRAME_MAX] = malloc((size_t)FRAMES * FRAME_MAX);
+    size_t *lens = malloc(FRAMES * sizeof(size_t));
+    probe_update_t r;
+    uint32_t rng = 7;
+
+    CHECK(frames != NULL && lens != NULL);
+    for (uint32_t k = 0; k < FRAMES; k++) {
+        uint32_t dev = test_rand(&rng) % DEVICES;
+        uint8_t mac[6];
+        char ssid[16] = "";
+
+        make_mac(mac, dev % 5 < 3, dev);
+        if (test_rand(&rng) % 100 >= 30) {
+            snprintf(ssid, sizeof(ssid), "net%u", (test_rand(&rng) % 20) * (test_rand(&rng) % 20));
+        }
+        lens[k] = make_probe(frames[k], mac, ssid, dev % MODELS, k);
+    }
+
+    probe_tracker_init(&t);
+    double start = test_seconds();
+    for (uint32_t k = 0; k < FRAMES; k++) {
+        probe_tracker_update(&t, frames[k], lens[k], -50, k / 10, &r);
+    }
+    double secs = test_seconds() - start;
+
+    int clusters = 0;
+    for (int i = 0; i < PROBE_TRACKER_MAX_CLUSTERS; i++) {
+        clusters += t.clusters[i].in_use;
+    }
+    printf("  probe_tracker_update: %.0f frames/s, %.1f ns/frame (%lu device / %lu SSID evictions, "
+           "%d clusters, %zu bytes state)\n",
+           FRAMES / secs, secs * 1e9 / FRAMES, (unsigned long)t.device_evictions,
+           (unsigned long)t.ssid_evictions, clusters, sizeof(t));
+
+    free(frames);
+    free(lens);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_preferred_network_list);
+    TEST_RUN(test_randomized_macs_cluster_by_fingerprint);
+    TEST_RUN(test_ignored_and_malformed_frames);
+    TEST_RUN(test_json_escape);
+    TEST_RUN(test_device_json);
+    TEST_RUN(test_station_json_uses_tracker);
+    if (test_bench_requested(argc, argv)) {
+        bench_large_corpus();
+    }
+    return test_done("probe_tracker");
+}
@@ -0,0 +1,305 @@
+#include "core/pwnagotchi.h"
+#include "test.h"
+
+#define FRAME_MAX 4096      // Room for the real payload in one-byte elements
+
+static const char identity_a[] = "32e9f315e92d974342c93d0fd952a914bfb4e6838953536ea6f63d54db6b9610";
+
+// What pwngrid advertises, face and all
+static const char real_json[] =
+    "{\"name\":\"bitey\",\"version\":\"1.5.5\",\"identity\":\"32e9f315e92d974342c93d0fd952a914bfb4e6838953536ea6f63d"
+    "54db6b9610\",\"face\":\"(\xe2\x97\x95\xe2\x80\xbf\xe2\x80\xbf\xe2\x97\x95)\",\"pwnd_run\":3,\"pwnd_tot\":120,"
+    "\"uptime\":3600,\"epoch\":42,\"session_id\":\"a2:b1:c3:d4:e5:f6\",\"grid_version\":\"1.10.3\",\"policy\":{"
+    "\"advertise\":true,\"ap_ttl\":120,\"associate\":true,\"bored_num_epochs\":15,\"channels\":[1,6,11],"
+    "\"deauth\":true,\"excited_num_epochs\":10,\"hop_recon_time\":10,\"max_inactive_scale\":2,"
+    "\"max_interactions\":3,\"max_misses_for_recon\":5,\"min_recon_time\":5,\"min_rssi\":-200,"
+    "\"recon_inactive_multiplier\":2,\"recon_time\":30,\"sad_num_epochs\":25,\"sta_ttl\":300}}";
+
+// Beacon header from src with SSID, rates and DS elements in front of the
+// vendor payload
+static size_t beacon_header(uint8_t *f, const uint8_t src[6]) {
+    static const uint8_t rest[] = { 0, 0, 1, 4, 0x82, 0x84, 0x8b, 0x96, 3, 1, 6 };
+    memset(f, 0, 36);
+    f[0] = 0x80;
+    memset(&f[4], 0xFF, 6);
+    memcpy(&f[10], src, 6);
+    memcpy(&f[16], src, 6);
+    f[32] = 0x64;
+    memcpy(&f[36], rest, sizeof(rest));
+    return 36 + sizeof(rest);
+}
+
+static size_t add_ie(uint8_t *f, size_t i, uint8_t id, const void *data, size_t len) {
+    f[i++] = id;
+    f[i++] = (uint8_t)len;
+    memcpy(&f[i], data, len);
+    return i + len;
+}
+
+// json cut into IE 222 elements of at most chunk bytes, ending in an FCS
+static size_t pwnagotchi_beacon(uint8_t *f, const char *json, size_t chunk) {
+    static const uint8_t mac[6] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xDE, 0xAD };
+    static const uint8_t fcs[4] = { 0x11, 0x22, 0x33, 0x44 };
+    size_t i = beacon_header(f, mac);
+    size_t len = strlen(json);
+
+    for (size_t off = 0; off < len; off += chunk) {
+        i = add_ie(f, i, PWNAGOTCHI_IE_ID, json + off, len - off < chunk ? len - off : chunk);
+    }
+    memcpy(&f[i], fcs, sizeof(fcs));
+    return i + sizeof(fcs);
+}
+
+static void test_real_beacon(void) {
+    static const uint8_t other[6] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+    uint8_t f[FRAME_MAX];
+    char json[PWNAGOTCHI_MAX_PAYLOAD];
+    pwnagotchi_info_t info;
+
+    size_t len = pwnagotchi_beacon(f, real_json, 255);
+    CHECK(pwnagotchi_is_beacon(f, len));
+    CHECK(pwnagotchi_reassemble(f, len, json, sizeof(json)) == (int)strlen(real_json));
+    CHECK(strcmp(json, real_json) == 0);
+    CHECK(pwnagotchi_parse_json(json, strlen(json), &info));
+    CHECK(strcmp(info.name, "bitey") == 0 && strcmp(info.version, "1.5.5") == 0);
+    CHECK(strcmp(info.identity, identity_a) == 0);
+    CHECK(info.pwnd_run == 3 && info.pwnd_tot == 120);
+
+    // Other senders, other frame types and runts are not pwnagotchis
+    uint8_t g[FRAME_MAX];
+    memcpy(g, f, len);
+    memcpy(&g[10], other, 6);
+    CHECK(!pwnagotchi_is_beacon(g, len));
+    memcpy(g, f, len);
+    g[0] = 0x50;
+    CHECK(!pwnagotchi_is_beacon(g, len));
+    CHECK(!pwnagotchi_is_beacon(f, 35));
+    CHECK(pwnagotchi_reassemble(f, 35, json, sizeof(json)) == -1);
+
+    // A beacon without IE 222
+    size_t plain = beacon_header(g, other);
+    CHECK(pwnagotchi_reassemble(g, plain, json, sizeof(json)) == -1);
+}
+
+static void test_split_elements(void) {
+    uint8_t f[FRAME_MAX];
+    char json[PWNAGOTCHI_MAX_PAYLOAD];
+
+    // Any split reassembles to the same JSON
+    static const size_t chunks[] = { 1, 7, 64, 200, 254 };
+    for (size_t k = 0; k < sizeof(chunks) / sizeof(chunks[0]); k++) {
+        size_t len = pwnagotchi_beacon(f, real_json, chunks[k]);
+        CHECK(pwnagotchi_reassemble(f, len, json, sizeof(json)) == (int)strlen(real_json));
+        CHECK(strcmp(json, real_json) == 0);
+    }
+
+    // Other elements between the pieces are skipped
+    static const uint8_t mac[6] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xDE, 0xAD };
+    static const uint8_t vendor[] = { 0x00, 0x50, 0xF2, 0x02, 0x01, 0x01 };
+    size_t i = beacon_header(f, mac);
+    i = add_ie(f, i, PWNAGOTCHI_IE_ID, "{\"name\":", 8);
+    i = add_ie(f, i, 221, vendor, sizeof(vendor));
+    i = add_ie(f, i, 5, "\x00\x01\x00\x00", 4);
+    i = add_ie(f, i, PWNAGOTCHI_IE_ID, "\"x\"}", 4);
+    CHECK(pwnagotchi_reassemble(f, i, json, sizeof(json)) == 12 && strcmp(json, "{\"name\":\"x\"}") == 0);
+
+    // Empty elements add nothing but still count as present
+    i = beacon_header(f, mac);
+    i = add_ie(f, i, PWNAGOTCHI_IE_ID, "", 0);
+    CHECK(pwnagotchi_reassemble(f, i, json, sizeof(json)) == 0 && json[0] == '\0');
+
+    // A payload that does not fit, counting its terminator, is refused
+    size_t len = pwnagotchi_beacon(f, real_json, 255);
+    CHECK(pwnagotchi_reassemble(f, len, json, strlen(real_json)) == -1);
+    CHECK(pwnagotchi_reassemble(f, len, json, strlen(real_json) + 1) == (int)strlen(real_json));
+    CHECK(pwnagotchi_reassemble(f, len, json, 0) == -1);
+}
+
+static void test_truncated_elements(void) {
+    static const uint8_t mac[6] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xDE, 0xAD };
+    uint8_t f[FRAME_MAX];
+    char json[PWNAGOTCHI_MAX_PAYLOAD];
+    pwnagotchi_info_t info;
+
+    // The last element claims more than the frame holds: it ends the list
+    size_t i = beacon_header(f, mac);
+    i = add_ie(f, i, PWNAGOTCHI_IE_ID, "{\"name\":\"bi", 11);
+    i = add_ie(f, i, PWNAGOTCHI_IE_ID, "tey\"}", 5);
+    CHECK(pwnagotchi_reassemble(f, i, json, sizeof(json)) == 16);
+    CHECK(pwnagotchi_reassemble(f, i - 1, json, sizeof(json)) == 11 && strcmp(json, "{\"name\":\"bi") == 0);
+    CHECK(!pwnagotchi_parse_json(json, 11, &info));
+
+    // Only an element header, or half of one, left
+    CHECK(pwnagotchi_reassemble(f, i - 5, json, sizeof(json)) == 11);
+    CHECK(pwnagotchi_reassemble(f, i - 6, json, sizeof(json)) == 11);
+
+    // Cut before the first IE 222 finishes
+    size_t first = beacon_header(f, mac);
+    CHECK(pwnagotchi_reassemble(f, first + 12, json, sizeof(json)) == -1);
+    CHECK(pwnagotchi_reassemble(f, first + 1, json, sizeof(json)) == -1);
+
+    // Every cut of a real beacon stays inside the frame and the buffer
+    size_t len = pwnagotchi_beacon(f, real_json, 255);
+    for (size_t cut = 0; cut <= len; cut++) {
+        uint8_t *copy = malloc(cut > 0 ? cut : 1);   // Exact, so ASan sees any overread
+        memcpy(copy, f, cut);
+        int n = pwnagotchi_reassemble(copy, cut, json, sizeof(json));
+        CHECK(n == -1 || ((size_t)n == strlen(json) && memcmp(json, real_json, (size_t)n) == 0));
+        free(copy);
+    }
+}
+
+static bool parses(const char *json, pwnagotchi_info_t *info) {
+    return pwnagotchi_parse_json(json, strlen(json), info);
+}
+
+static void test_malformed_json(void) {
+    pwnagotchi_info_t info;
+    char buf[sizeof(real_json)];
+
+    // Every strict prefix is incomplete
+    for (size_t n = 0; n < strlen(real_json); n++) {
+        memcpy(buf, real_json, n);
+        CHECK(!pwnagotchi_parse_json(buf, n, &info));
+    }
+    CHECK(pwnagotchi_parse_json(real_json, strlen(real_json), &info));
+
+    // Escapes
+    CHECK(parses("{\"name\":\"a\\\"b\\\\c\\/d\\u0041\\u00e9\"}", &info));
+    CHECK(strcmp(info.name, "a\"b\\c/dA?") == 0);
+    CHECK(!parses("{\"name\":\"\\x\"}", &info));
+    CHECK(!parses("{\"name\":\"\\u12G4\"}", &info));
+    CHECK(!parses("{\"name\":\"\\u12\"}", &info));
+    CHECK(!parses("{\"name\":\"ab\\", &info));
+    CHECK(!parses("{\"name\":\"a\nb\"}", &info));
+    CHECK(!parses("{\"na\\qme\":\"x\"}", &info));
+
+    // Structure
+    CHECK(!parses("", &info));
+    CHECK(!parses("[]", &info));
+    CHECK(!parses("{}", &info));
+    CHECK(!parses("{\"name\" \"x\"}", &info));
+    CHECK(!parses("{\"name\":\"x\",}", &info));
+    CHECK(!parses("{\"name\":\"x\"]", &info));
+    CHECK(!parses("{\"name\":\"x\",\"policy\":{\"a\":[1,2}}", &info));
+    CHECK(!parses("{\"name\":\"x\",\"flag\":tru}", &info));
+    CHECK(!parses("{\"name\":\"x\",\"n\":-}", &info));
+    CHECK(!parses("{name:\"x\"}", &info));
+
+    // Something has to say who it is
+    CHECK(!parses("{\"version\":\"1.5.5\",\"pwnd_tot\":1}", &info));
+    CHECK(parses("{\"identity\":\"abc\"}", &info) && strcmp(info.identity, "abc") == 0);
+
+    // Nesting is bounded
+    char deep[128] = "{\"name\":\"x\",\"p\":";
+    size_t at = strlen(deep);
+    for (int d = 0; d < 20; d++) {
+        deep[at++] = '[';
+    }
+    for (int d = 0; d < 20; d++) {
+        deep[at++] = ']';
+    }
+    strcpy(&deep[at], "}");
+    CHECK(!parses(deep, &info));
+    CHECK(parses("{\"name\":\"x\",\"p\":[[[{\"q\":[null,false,1.5e3]}]]]}", &info));
+
+    // Values the wrong type are skipped, long strings cut, odd numbers clamped
+    CHECK(parses("{\"name\":\"x\",\"pwnd_run\":\"3\",\"version\":2,\"pwnd_tot\":-7}", &info));
+    CHECK(info.pwnd_run == 0 && info.version[0] == '\0' && info.pwnd_tot == 0);
+    CHECK(parses("{\"name\":\"0123456789012345678901234567890123456789\",\"pwnd_run\":99999999999}", &info));
+    CHECK(strlen(info.name) == PWNAGOTCHI_NAME_LEN - 1 && info.pwnd_run == UINT32_MAX);
+
+    // Random damage to a real payload never reads outside it
+    uint32_t rng = 0x5eed;
+    for (int round = 0; round < 20000; round++) {
+        size_t n = strlen(real_json);
+        char *copy = malloc(n);
+        memcpy(copy, real_json, n);
+        for (int k = 0; k < 1 + (int)(test_rand(&rng) % 4); k++) {
+            copy[test_rand(&rng) % n] = "{}[]\":,\\u0 a\x01"[test_rand(&rng) % 14];
+        }
+        pwnagotchi_parse_json(copy, test_rand(&rng) % (n + 1), &info);
+        CHECK(strlen(info.name) < PWNAGOTCHI_NAME_LEN && strlen(info.identity) < PWNAGOTCHI_IDENTITY_LEN);
+        free(copy);
+    }
+}
+
+static pwnagotchi_info_t unit(const char *name, const char *identity, uint32_t pwnd) {
+    pwnagotchi_info_t info = { 0 };
+    snprintf(info.name, sizeof(info.name), "%s", name);
+    snprintf(info.identity, sizeof(info.identity), "%s", identity);
+    info.pwnd_tot = pwnd;
+    return info;
+}
+
+static void test_table(void) {
+    pwnagotchi_table_t table;
+    char name[16], id[16];
+    bool is_new;
+
+    pwnagotchi_table_init(&table);
+
+    // Repeats of one unit are one peer, even after a rename
+    pwnagotchi_info_t a = unit("bitey", identity_a, 1);
+    pwnagotchi_peer_t *peer = pwnagotchi_table_update(&table, &a, -60, 6, 1000, &is_new);
+    CHECK(is_new && peer->beacons == 1 && table.peer_count == 1);
+    a = unit("bitey2", identity_a, 2);
+    CHECK(pwnagotchi_table_update(&table, &a, -50, 11, 2000, &is_new) == peer && !is_new);
+    CHECK(peer->beacons == 2 && peer->rssi == -50 && peer->channel == 11 && peer->info.pwnd_tot == 2);
+    CHECK(peer->first_seen_ms == 1000 && peer->last_seen_ms == 2000 && strcmp(peer->info.name, "bitey2") == 0);
+
+    // Without an identity the name is the key; an identity never matches a bare name
+    pwnagotchi_info_t b = unit("nameonly", "", 0);
+    pwnagotchi_peer_t *pb = pwnagotchi_table_update(&table, &b, -70, 1, 3000, &is_new);
+    CHECK(is_new && pb != peer);
+    CHECK(pwnagotchi_table_update(&table, &b, -70, 1, 3100, &is_new) == pb && !is_new);
+    pwnagotchi_info_t b_id = unit("nameonly", "ffff", 0);
+    CHECK(pwnagotchi_table_update(&table, &b_id, -70, 1, 3200, &is_new) != pb && is_new);
+    CHECK(table.peer_count == 3);
+
+    // Fill the table; the next unit replaces the one seen longest ago
+    for (uint32_t i = table.peer_count; i < PWNAGOTCHI_MAX_PEERS; i++) {
+        snprintf(name, sizeof(name), "u%u", (unsigned)i);
+        snprintf(id, sizeof(id), "id%u", (unsigned)i);
+        pwnagotchi_info_t u = unit(name, id, 0);
+        pwnagotchi_table_update(&table, &u, -80, 1, 4000 + i, &is_new);
+        CHECK(is_new);
+    }
+    CHECK(table.peer_count == PWNAGOTCHI_MAX_PEERS);
+    a = unit("bitey2", identity_a, 3);
+    pwnagotchi_table_update(&table, &a, -50, 11, 9000, &is_new);
+    CHECK(!is_new);
+
+    pwnagotchi_info_t late = unit("late", "late", 0);
+    pwnagotchi_peer_t *pl = pwnagotchi_table_update(&table, &late, -40, 1, 9100, &is_new);
+    CHECK(is_new && pl == pb && table.peer_count == PWNAGOTCHI_MAX_PEERS);
+    CHECK(pl->beacons == 1 && pl->first_seen_ms == 9100 && strcmp(pl->info.name, "late") == 0);
+    CHECK(pwnagotchi_table_update(&table, &b, -70, 1, 9200, &is_new) != NULL && is_new);
+
+    // Each unit is still there once, whatever came and went
+    int seen = 0;
+    for (int i = 0; i < PWNAGOTCHI_MAX_PEERS; i++) {
+        CHECK(table.peers[i].in_use);
+        seen += strcmp(table.peers[i].info.identity, identity_a) == 0;
+    }
+    CHECK(seen == 1);
+
+    // Ages compare across the millisecond counter wrapping
+    pwnagotchi_table_init(&table);
+    for (uint32_t i = 0; i < PWNAGOTCHI_MAX_PEERS; i++) {
+        snprintf(id, sizeof(id), "w%u", (unsigned)i);
+        pwnagotchi_info_t u = unit("w", id, 0);
+        pwnagotchi_table_update(&table, &u, -80, 1, UINT32_MAX - 100 + i * 20, &is_new);
+    }
+    pwnagotchi_info_t wrapped = unit("new", "new", 0);
+    CHECK(pwnagotchi_table_update(&table, &wrapped, -80, 1, 500, &is_new) == &table.peers[0] && is_new);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_real_beacon);
+    TEST_RUN(test_split_elements);
+    TEST_RUN(test_truncated_elements);
+    TEST_RUN(test_malformed_json);
+    TEST_RUN(test_table);
+    return test_done("pwnagotchi");
+}
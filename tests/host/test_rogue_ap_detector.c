@@ -0,0 +1,358 @@
+#include "core/rogue_ap_detector.h"
+#include "test.h"
+
+#define AKM_PSK      2
+#define AKM_SAE      8
+#define AKM_SAE_EXT  24
+#define AKM_8021X    1
+
+typedef struct {
+    uint8_t fc;
+    uint8_t bssid[6];
+    const char *ssid;
+    uint8_t channel;            // 0 = no DS parameter set
+    bool privacy;
+    bool wpa_ie;
+    uint8_t akms[3];            // RSN AKM suite types, 0 terminated; no RSN IE when empty
+} beacon_spec_t;
+
+static size_t build_beacon(const beacon_spec_t *spec, uint8_t *frame) {
+    size_t len = 0;
+
+    memset(frame, 0, 36);
+    frame[0] = spec->fc ? spec->fc : 0x80;
+    memset(&frame[4], 0xFF, 6);
+    memcpy(&frame[10], spec->bssid, 6);
+    memcpy(&frame[16], spec->bssid, 6);
+    frame[32] = 0x64;                                   // Beacon interval
+    frame[34] = 0x01 | (spec->privacy ? 0x10 : 0x00);  // ESS, privacy
+    len = 36;
+
+    size_t ssid_len = strlen(spec->ssid);
+    frame[len++] = 0;
+    frame[len++] = (uint8_t)ssid_len;
+    memcpy(&frame[len], spec->ssid, ssid_len);
+    len += ssid_len;
+
+    static const uint8_t rates[] = { 1, 8, 0x82, 0x84, 0x8B, 0x96, 0x0C, 0x12, 0x18, 0x24 };
+    memcpy(&frame[len], rates, sizeof(rates));
+    len += sizeof(rates);
+
+    if (spec->channel) {
+        frame[len++] = 3;
+        frame[len++] = 1;
+        frame[len++] = spec->channel;
+    }
+
+    if (spec->akms[0]) {
+        size_t akm_count = 0;
+        while (akm_count < 3 && spec->akms[akm_count]) {
+            akm_count++;
+        }
+        frame[len++] = 48;
+        frame[len++] = (uint8_t)(2 + 4 + 2 + 4 + 2 + 4 * akm_count + 2);
+        frame[len++] = 1;                               // Version
+        frame[len++] = 0;
+        memcpy(&frame[len], "\x00\x0F\xAC\x04", 4);     // Group CCMP
+        len += 4;
+        frame[len++] = 1;
+        frame[len++] = 0;
+        memcpy(&frame[len], "\x00\x0F\xAC\x04", 4);     // Pairwise CCMP
+        len += 4;
+        frame[len++] = (uint8_t)akm_count;
+        frame[len++] = 0;
+        for (size_t i = 0; i < akm_count; i++) {
+            memcpy(&frame[len], "\x00\x0F\xAC", 3);
+            frame[len + 3] = spec->akms[i];
+            len += 4;
+        }
+        frame[len++] = 0x0C;                            // RSN capabilities, MFP capable
+        frame[len++] = 0;
+    }
+
+    if (spec->wpa_ie) {
+        static const uint8_t wpa[] = { 221, 22, 0x00, 0x50, 0xF2, 0x01, 0x01, 0x00, 0x00, 0x50, 0xF2, 0x02,
+                                       0x01, 0x00, 0x00, 0x50, 0xF2, 0x02, 0x01, 0x00, 0x00, 0x50, 0xF2, 0x02 };
+        memcpy(&frame[len], wpa, sizeof(wpa));
+        len += sizeof(wpa);
+    }
+    return len;
+}
+
+static const char *allowlist[] = {
+    "# SSID,BSSID,SECURITY[,CHANNEL]",
+    "",
+    "CorpNet,00:11:22:33:44:01,WPA2,6",
+    "CorpNet,00:11:22:33:44:02,WPA2,11",
+    "CorpNet,00:11:22:33:44:03,WPA2",
+    "Guest, Lobby,00:11:22:33:44:10,OPEN",
+    "Secure,00:11:22:33:44:20,WPA3",
+    "Mixed,00:11:22:33:44:30,WPA2/WPA3",
+    "Legacy,00:11:22:33:44:40,WPA",
+    "Lab,00:11:22:33:44:50,ANY,1",
+};
+
+static void load_allowlist(rogue_ap_detector_t *det) {
+    rogue_ap_init(det);
+    for (size_t i = 0; i < sizeof(allowlist) / sizeof(allowlist[0]); i++) {
+        rogue_ap_entry_t entry;
+        if (rogue_ap_parse_allowlist_line(allowlist[i], &entry)) {
+            CHECK(rogue_ap_add_entry(det, &entry));
+        }
+    }
+    CHECK(det->entry_count == 8);
+}
+
+#define OWN(last) { 0x00, 0x11, 0x22, 0x33, 0x44, last }
+#define SPOOF     { 0xDE, 0xAD, 0xBE, 0xEF, 0x00, 0x01 }
+#define SAME_OUI  { 0x00, 0x11, 0x22, 0x99, 0x99, 0x99 }
+
+typedef struct {
+    const char *what;
+    beacon_spec_t beacon;
+    uint32_t reasons;
+} corpus_case_t;
+
+// Each case runs against a fresh detector so hold-offs don't hide anything
+static const corpus_case_t corpus[] = {
+    { "allowlisted AP as configured",       { 0, OWN(0x01), "CorpNet", 6, true, false, { AKM_PSK } }, 0 },
+    { "second AP on its channel",           { 0, OWN(0x02), "CorpNet", 11, true, false, { AKM_PSK } }, 0 },
+    { "AP without a channel pinned",        { 0, OWN(0x03), "CorpNet", 1, true, false, { AKM_PSK, AKM_8021X } }, 0 },
+    { "not one of ours",                    { 0, SPOOF, "CoffeeShop", 6, false, false, { 0 } }, 0 },
+    { "SSID that only shares a prefix",     { 0, SPOOF, "CorpNet5G", 6, true, false, { AKM_PSK } }, 0 },
+    { "open guest with a comma in the SSID",{ 0, OWN(0x10), "Guest, Lobby", 1, false, false, { 0 } }, 0 },
+    { "WPA2 AP upgraded to transition",     { 0, OWN(0x01), "CorpNet", 6, true, false, { AKM_PSK, AKM_SAE } }, 0 },
+    { "WPA2 AP upgraded to SAE only",       { 0, OWN(0x01), "CorpNet", 6, true, false, { AKM_SAE } }, 0 },
+    { "transition entry seen as WPA2",      { 0, OWN(0x30), "Mixed", 0, true, false, { AKM_PSK } }, 0 },
+    { "transition entry seen as WPA3",      { 0, OWN(0x30), "Mixed", 0, true, false, { AKM_SAE_EXT } }, 0 },
+    { "transition entry as transition",     { 0, OWN(0x30), "Mixed", 0, true, false, { AKM_SAE, AKM_PSK } }, 0 },
+    { "WPA entry upgraded to WPA2",         { 0, OWN(0x40), "Legacy", 0, true, true, { AKM_PSK } }, 0 },
+    { "wildcard security on its channel",   { 0, OWN(0x50), "Lab", 1, false, false, { 0 } }, 0 },
+    { "probe response from a known AP",     { 0x50, OWN(0x01), "CorpNet", 6, true, false, { AKM_PSK } }, 0 },
+
+    { "evil twin, foreign vendor",          { 0, SPOOF, "CorpNet", 6, true, false, { AKM_PSK } },
+      ROGUE_AP_REASON_UNKNOWN_BSSID | ROGUE_AP_REASON_OUI },
+    { "evil twin, our vendor's OUI",        { 0, SAME_OUI, "CorpNet", 6, true, false, { AKM_PSK } },
+      ROGUE_AP_REASON_UNKNOWN_BSSID },
+    { "open evil twin of the guest net",    { 0, SPOOF, "Guest, Lobby", 1, false, false, { 0 } },
+      ROGUE_AP_REASON_UNKNOWN_BSSID | ROGUE_AP_REASON_OUI },
+    { "spoofed BSSID, open",                { 0, OWN(0x01), "CorpNet", 6, false, false, { 0 } }, ROGUE_AP_REASON_SECURITY },
+    { "spoofed BSSID, WEP",                 { 0, OWN(0x01), "CorpNet", 6, true, false, { 0 } }, ROGUE_AP_REASON_SECURITY },
+    { "spoofed BSSID, WPA1 only",           { 0, OWN(0x01), "CorpNet", 6, true, true, { 0 } }, ROGUE_AP_REASON_SECURITY },
+    { "spoofed BSSID, wrong channel",       { 0, OWN(0x01), "CorpNet", 1, true, false, { AKM_PSK } }, ROGUE_AP_REASON_CHANNEL },
+    { "spoofed BSSID, open and off channel",{ 0, OWN(0x02), "CorpNet", 3, false, false, { 0 } },
+      ROGUE_AP_REASON_SECURITY | ROGUE_AP_REASON_CHANNEL },
+    { "WPA3 AP downgraded to transition",   { 0, OWN(0x20), "Secure", 0, true, false, { AKM_SAE, AKM_PSK } },
+      ROGUE_AP_REASON_SECURITY },
+    { "WPA3 AP downgraded to WPA2",         { 0, OWN(0x20), "Secure", 0, true, false, { AKM_PSK } }, ROGUE_AP_REASON_SECURITY },
+    { "transition entry seen open",         { 0, OWN(0x30), "Mixed", 0, false, false, { 0 } }, ROGUE_AP_REASON_SECURITY },
+    { "wildcard security, wrong channel",   { 0, OWN(0x50), "Lab", 11, true, false, { AKM_PSK } }, ROGUE_AP_REASON_CHANNEL },
+};
+
+static void test_corpus(void) {
+    rogue_ap_detector_t det;
+    uint8_t frame[256];
+
+    for (size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        const corpus_case_t *c = &corpus[i];
+        rogue_ap_beacon_t beacon;
+        rogue_ap_alert_t alert;
+
+        load_allowlist(&det);
+        size_t len = build_beacon(&c->beacon, frame);
+        CHECK(rogue_ap_parse_beacon(frame, len, &beacon));
+        CHECK(strcmp(beacon.ssid, c->beacon.ssid) == 0);
+        CHECK(memcmp(beacon.bssid, c->beacon.bssid, 6) == 0);
+        CHECK(beacon.channel == c->beacon.channel);
+
+        bool raised = rogue_ap_check(&det, &beacon, 1000, &alert);
+        if (raised != (c->reasons != 0) || (raised && alert.reasons != c->reasons)) {
+            fprintf(stderr, "corpus case '%s': got %s 0x%x\n", c->what, raised ? "alert" : "nothing",
+                    raised ? (unsigned)alert.reasons : 0);
+        }
+        CHECK(raised == (c->reasons != 0));
+        if (raised) {
+            CHECK(alert.reasons == c->reasons);
+            CHECK(memcmp(alert.beacon.bssid, c->beacon.bssid, 6) == 0);
+        }
+    }
+}
+
+static void test_security_classes(void) {
+    static const struct {
+        beacon_spec_t beacon;
+        rogue_ap_security_t security;
+    } cases[] = {
+        { { 0, OWN(1), "x", 0, false, false, { 0 } }, ROGUE_AP_SEC_OPEN },
+        { { 0, OWN(1), "x", 0, true, false, { 0 } }, ROGUE_AP_SEC_WEP },
+        { { 0, OWN(1), "x", 0, true, true, { 0 } }, ROGUE_AP_SEC_WPA },
+        { { 0, OWN(1), "x", 0, true, true, { AKM_PSK } }, ROGUE_AP_SEC_WPA2 },
+        { { 0, OWN(1), "x", 0, true, false, { AKM_8021X } }, ROGUE_AP_SEC_WPA2 },
+        { { 0, OWN(1), "x", 0, true, false, { AKM_SAE } }, ROGUE_AP_SEC_WPA3 },
+        { { 0, OWN(1), "x", 0, true, false, { AKM_SAE, AKM_SAE_EXT } }, ROGUE_AP_SEC_WPA3 },
+        { { 0, OWN(1), "x", 0, true, false, { AKM_PSK, AKM_SAE } }, ROGUE_AP_SEC_WPA2_WPA3 },
+        { { 0, OWN(1), "x", 0, true, false, { AKM_SAE_EXT, AKM_8021X } }, ROGUE_AP_SEC_WPA2_WPA3 },
+    };
+    uint8_t frame[256];
+    rogue_ap_beacon_t beacon;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        size_t len = build_beacon(&cases[i].beacon, frame);
+        CHECK(rogue_ap_parse_beacon(frame, len, &beacon));
+        CHECK(beacon.security == cases[i].security);
+    }
+
+    rogue_ap_security_t security;
+    CHECK(rogue_ap_parse_security("wpa2/wpa3", &security) && security == ROGUE_AP_SEC_WPA2_WPA3);
+    CHECK(strcmp(rogue_ap_security_name(ROGUE_AP_SEC_WPA2_WPA3), "WPA2/WPA3") == 0);
+    CHECK(strcmp(rogue_ap_security_name(ROGUE_AP_SEC_ANY), "ANY") == 0);
+}
+
+static void test_malformed_frames(void) {
+    beacon_spec_t spec = { 0, OWN(0x01), "CorpNet", 6, true, false, { AKM_PSK, AKM_SAE } };
+    uint8_t frame[256];
+    rogue_ap_beacon_t beacon;
+    size_t len = build_beacon(&spec, frame);
+
+    // Every truncation either parses what is there or is rejected, never reads past len
+    for (size_t cut = 0; cut < len; cut++) {
+        uint8_t *copy = malloc(cut ? cut : 1);
+        memcpy(copy, frame, cut);
+        bool ok = rogue_ap_parse_beacon(copy, cut, &beacon);
+        CHECK(ok == (cut >= 36 + 2 + 7));               // SSID complete
+        free(copy);
+    }
+
+    // Not a beacon or probe response
+    uint8_t data[256];
+    memcpy(data, frame, len);
+    data[0] = 0x08;
+    CHECK(!rogue_ap_parse_beacon(data, len, &beacon));
+    data[0] = 0x40;
+    CHECK(!rogue_ap_parse_beacon(data, len, &beacon));
+
+    // SSID longer than 32 bytes is ignored, so the frame has none
+    memcpy(data, frame, len);
+    data[37] = 33;
+    CHECK(!rogue_ap_parse_beacon(data, len, &beacon));
+
+    // RSN element with counts that overrun it: classed by what fits
+    uint8_t rsn_frame[] = { 0x80, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0, 0x11, 0x22, 0x33, 0x44, 0x01,
+                            0, 0x11, 0x22, 0x33, 0x44, 0x01, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x64, 0, 0x11, 0,
+                            0, 1, 'x',
+                            48, 12, 1, 0, 0x00, 0x0F, 0xAC, 4, 0xFF, 0xFF, 0x00, 0x0F, 0xAC, 4 };
+    CHECK(rogue_ap_parse_beacon(rsn_frame, sizeof(rsn_frame), &beacon));
+    CHECK(beacon.security == ROGUE_AP_SEC_WPA2);
+
+    // Random garbage after a valid header never crashes
+    uint32_t rng = 7;
+    for (int round = 0; round < 20000; round++) {
+        size_t n = 36 + test_rand(&rng) % 200;
+        memcpy(data, frame, 36);
+        for (size_t i = 36; i < n; i++) {
+            data[i] = (uint8_t)test_rand(&rng);
+        }
+        if (rogue_ap_parse_beacon(data, n, &beacon)) {
+            CHECK(beacon.ssid_len <= 32);
+            CHECK(beacon.security <= ROGUE_AP_SEC_WPA2_WPA3);
+        }
+    }
+}
+
+static void test_allowlist_lines(void) {
+    rogue_ap_entry_t e;
+
+    CHECK(rogue_ap_parse_allowlist_line("  Home ,AA:BB:CC:DD:EE:FF, wpa2/wpa3 , 36\r\n", &e));
+    CHECK(strcmp(e.ssid, "Home ") == 0);             // Spaces inside an SSID are kept
+    CHECK(e.security == ROGUE_AP_SEC_WPA2_WPA3 && e.channel == 36 && e.bssid[5] == 0xFF);
+    CHECK(rogue_ap_parse_allowlist_line("a,b,c,00:00:00:00:00:01,OPEN", &e));
+    CHECK(strcmp(e.ssid, "a,b,c") == 0);
+    CHECK(!rogue_ap_parse_allowlist_line("# comment", &e));
+    CHECK(!rogue_ap_parse_allowlist_line("   ", &e));
+    CHECK(!rogue_ap_parse_allowlist_line("Net,00:11:22:33:44,WPA2", &e));
+    CHECK(!rogue_ap_parse_allowlist_line("Net,00:11:22:33:44:55,WPA4", &e));
+    CHECK(!rogue_ap_parse_allowlist_line("Net,00:11:22:33:44:55,WPA2,300", &e));
+    CHECK(!rogue_ap_parse_allowlist_line(",00:11:22:33:44:55,WPA2", &e));
+    CHECK(!rogue_ap_parse_allowlist_line("0123456789012345678901234567890123,00:11:22:33:44:55,WPA2", &e));
+}
+
+static void test_holdoff(void) {
+    rogue_ap_detector_t det;
+    rogue_ap_beacon_t beacon;
+    rogue_ap_alert_t alert;
+    uint8_t frame[256];
+    beacon_spec_t twin = { 0, SPOOF, "CorpNet", 6, true, false, { AKM_PSK } };
+
+    load_allowlist(&det);
+    CHECK(rogue_ap_parse_beacon(frame, build_beacon(&twin, frame), &beacon));
+    CHECK(rogue_ap_check(&det, &beacon, 0, &alert));
+    // Ten beacons a second for the hold-off: no repeats
+    for (uint32_t ms = 100; ms < ROGUE_AP_HOLDOFF_MS; ms += 100) {
+        CHECK(!rogue_ap_check(&det, &beacon, ms, &alert));
+    }
+    CHECK(rogue_ap_check(&det, &beacon, ROGUE_AP_HOLDOFF_MS, &alert));
+
+    // A new reason on a known AP gets through the hold-off straight away
+    beacon_spec_t known = { 0, OWN(0x01), "CorpNet", 1, true, false, { AKM_PSK } };
+    CHECK(rogue_ap_parse_beacon(frame, build_beacon(&known, frame), &beacon));
+    CHECK(rogue_ap_check(&det, &beacon, 40000, &alert) && alert.reasons == ROGUE_AP_REASON_CHANNEL);
+    known.channel = 6;
+    known.akms[0] = 0;
+    CHECK(rogue_ap_parse_beacon(frame, build_beacon(&known, frame), &beacon));
+    CHECK(rogue_ap_check(&det, &beacon, 40100, &alert));
+    CHECK(alert.reasons == ROGUE_AP_REASON_SECURITY);
+    CHECK(!rogue_ap_check(&det, &beacon, 40200, &alert));
+    CHECK(det.alerts_raised == 4);
+}
+
+static void bench_beacon_path(void) {
+    enum { FRAMES = 4096 };
+    static uint8_t frames[FRAMES][160];
+    static size_t lens[FRAMES];
+    static const char *ssids[] = { "CorpNet", "Guest, Lobby", "CoffeeShop", "Neighbour", "xfinitywifi", "Mixed" };
+    rogue_ap_detector_t det;
+    uint32_t rng = 11;
+
+    load_allowlist(&det);
+    // Mostly other people's networks, some of ours, some twins
+    for (int i = 0; i < FRAMES; i++) {
+        uint32_t r = test_rand(&rng);
+        beacon_spec_t spec = { 0, OWN(0x01), ssids[r % 6], (uint8_t)(1 + r % 11), true, false, { AKM_PSK } };
+        spec.bssid[3] = (uint8_t)(r >> 8);
+        spec.bssid[4] = (uint8_t)(r >> 16);
+        if (r & 0x80000000u) {
+            spec.akms[1] = AKM_SAE;
+        }
+        lens[i] = build_beacon(&spec, frames[i]);
+    }
+
+    const uint32_t rounds = 500;
+    uint32_t alerts = 0;
+    rogue_ap_beacon_t beacon;
+    rogue_ap_alert_t alert;
+    double start = test_seconds();
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (int i = 0; i < FRAMES; i++) {
+            if (rogue_ap_parse_beacon(frames[i], lens[i], &beacon) &&
+                rogue_ap_check(&det, &beacon, round * 1000 + i / 4, &alert)) {
+                alerts++;
+            }
+        }
+    }
+    double secs = test_seconds() - start;
+    double total = (double)rounds * FRAMES;
+    printf("  parse + check: %.0f beacons/s, %.0f ns/beacon (%u alerts, %zu bytes state)\n",
+           total / secs, secs * 1e9 / total, alerts, sizeof(det));
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_corpus);
+    TEST_RUN(test_security_classes);
+    TEST_RUN(test_malformed_frames);
+    TEST_RUN(test_allowlist_lines);
+    TEST_RUN(test_holdoff);
+    if (test_bench_requested(argc, argv)) {
+        bench_beacon_path();
+    }
+    return test_done("rogue_ap_detector");
+}
@@ -0,0 +1,498 @@
+#include "core/rpc_codec.h"
+#include "core/rpc_schema.h"
+#include "test.h"
+#include <stdbool.h>
+#include <unistd.h>
+
+// The codec against itself, against a noisy serial line, and against
+// scripts/ghost_rpc.py: rpc_crosscheck.py decodes frames encoded here with
+// the Python client and sends back the client's encoding of the same values.
+
+#define CROSS_FRAMES 2000
+#define MAX_VALUES   6
+#define MAX_BLOB     250
+
+static rpc_frame_t got;
+static uint8_t got_payload[RPC_MAX_PAYLOAD];
+static int got_count;
+
+static void on_frame(const rpc_frame_t *frame, void *ctx) {
+    got = *frame;
+    memcpy(got_payload, frame->payload, frame->payload_len);
+    got.payload = got_payload;
+    got_count++;
+}
+
+static void test_values(void) {
+    uint8_t buf[128];
+    rpc_writer_t w;
+    rpc_reader_t r;
+    uint32_t u;
+    int32_t i;
+    bool b;
+    const char *s;
+    const uint8_t *d;
+    size_t n;
+
+    rpc_writer_init(&w, buf, sizeof(buf));
+    rpc_put_u32(&w, 0);
+    rpc_put_u32(&w, 127);
+    rpc_put_u32(&w, 128);
+    rpc_put_u32(&w, UINT32_MAX);
+    rpc_put_i32(&w, -1);
+    rpc_put_i32(&w, INT32_MIN);
+    rpc_put_i32(&w, INT32_MAX);
+    rpc_put_bool(&w, true);
+    rpc_put_str(&w, "");
+    rpc_put_str(&w, "ghost");
+    rpc_put_bytes(&w, (const uint8_t *)"\0\1\2", 3);
+    CHECK(!w.overflow);
+
+    rpc_reader_init(&r, buf, w.len);
+    CHECK(rpc_get_u32(&r, &u) && u == 0);
+    CHECK(rpc_get_u32(&r, &u) && u == 127);
+    CHECK(rpc_get_u32(&r, &u) && u == 128);
+    CHECK(rpc_get_u32(&r, &u) && u == UINT32_MAX);
+    CHECK(rpc_get_i32(&r, &i) && i == -1);
+    CHECK(rpc_get_i32(&r, &i) && i == INT32_MIN);
+    CHECK(rpc_get_i32(&r, &i) && i == INT32_MAX);
+    CHECK(rpc_get_bool(&r, &b) && b);
+    CHECK(rpc_get_str(&r, &s, &n) && n == 0);
+    CHECK(rpc_get_str(&r, &s, &n) && n == 5 && memcmp(s, "ghost", 5) == 0);
+    CHECK(rpc_get_bytes(&r, &d, &n) && n == 3 && d[0] == 0 && d[2] == 2);
+    CHECK(rpc_reader_done(&r));
+    CHECK(!rpc_get_u32(&r, &u));
+
+    // A wrong tag fails, and so does everything after it
+    rpc_reader_init(&r, buf, w.len);
+    CHECK(!rpc_get_i32(&r, &i));
+    CHECK(!rpc_get_u32(&r, &u));
+    CHECK(!rpc_reader_done(&r));
+
+    // Malformed values: a varint past 32 bits, a truncated varint, a string
+    // longer than the payload, a bool that is not 0 or 1
+    static const uint8_t too_wide[] = { RPC_TAG_U32, 0xFF, 0xFF, 0xFF, 0xFF, 0x10 };
+    static const uint8_t truncated[] = { RPC_TAG_U32, 0x80, 0x80 };
+    static const uint8_t short_str[] = { RPC_TAG_STR, 10, 'a' };
+    static const uint8_t bad_bool[] = { RPC_TAG_BOOL, 2 };
+    rpc_reader_init(&r, too_wide, sizeof(too_wide));
+    CHECK(!rpc_get_u32(&r, &u));
+    rpc_reader_init(&r, truncated, sizeof(truncated));
+    CHECK(!rpc_get_u32(&r, &u));
+    rpc_reader_init(&r, short_str, sizeof(short_str));
+    CHECK(!rpc_get_str(&r, &s, &n));
+    rpc_reader_init(&r, bad_bool, sizeof(bad_bool));
+    CHECK(!rpc_get_bool(&r, &b));
+
+    // The writer never runs past its buffer
+    rpc_writer_init(&w, buf, 4);
+    rpc_put_str(&w, "too long");
+    CHECK(w.overflow && w.len <= 4);
+    rpc_writer_init(&w, buf, 2);
+    rpc_put_u32(&w, UINT32_MAX);
+    CHECK(w.overflow);
+}
+
+static void test_frame_edges(void) {
+    static const size_t sizes[] = { 0, 1, 248, 249, 250, 251, 252, 253, 254, 255, 256, 507, 508, 509, 510,
+                                    RPC_MAX_PAYLOAD };
+    static uint8_t payload[RPC_MAX_PAYLOAD + 1];
+    static uint8_t enc[RPC_MAX_FRAME + 64];
+    rpc_decoder_t d;
+
+    // CRC-16/CCITT-FALSE check value
+    CHECK(rpc_crc16((const uint8_t *)"123456789", 9) == 0x29B1);
+
+    // All zeros, all 0xFF, and runs of non-zero bytes across the COBS block size
+    rpc_decoder_init(&d, on_frame, NULL);
+    for (int fill = 0; fill < 3; fill++) {
+        for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+            for (size_t j = 0; j < sizes[k]; j++) {
+                payload[j] = fill == 0 ? 0 : fill == 1 ? 0xFF : (uint8_t)(j % 255 + 1);
+            }
+            rpc_frame_t f = { RPC_KIND_RESPONSE, 0xBEEF, 7, payload, sizes[k] };
+            size_t n = rpc_frame_encode(&f, enc, sizeof(enc));
+            CHECK(n > 0 && n <= RPC_MAX_FRAME && enc[0] == 0 && enc[n - 1] == 0);
+            CHECK(memchr(enc + 1, 0, n - 2) == NULL);
+
+            got_count = 0;
+            rpc_decoder_feed(&d, enc, n);
+            CHECK(got_count == 1 && got.kind == RPC_KIND_RESPONSE && got.id == 0xBEEF && got.code == 7);
+            CHECK(got.payload_len == sizes[k] && memcmp(got.payload, payload, sizes[k]) == 0);
+
+            // Exactly the encoded length fits, one byte less does not
+            CHECK(rpc_frame_encode(&f, enc, n) == n);
+            CHECK(rpc_frame_encode(&f, enc, n - 1) == 0);
+        }
+    }
+    CHECK(d.bad_frames == 0 && d.overflows == 0);
+
+    rpc_frame_t big = { RPC_KIND_REQUEST, 1, RPC_METHOD_PING, payload, RPC_MAX_PAYLOAD + 1 };
+    CHECK(rpc_frame_encode(&big, enc, sizeof(enc)) == 0);
+}
+
+static void feed_in_reads(rpc_decoder_t *d, const uint8_t *data, size_t len, uint32_t *rng) {
+    for (size_t off = 0; off < len;) {
+        size_t chunk = 1 + test_rand(rng) % 300;
+        chunk = chunk > len - off ? len - off : chunk;
+        rpc_decoder_feed(d, data + off, chunk);
+        off += chunk;
+    }
+}
+
+// Random frames in random read sizes, with console text between them and
+// one in fifty corrupted: every good frame comes out, no bad one does
+static void test_noisy_stream(void) {
+    static uint8_t payload[RPC_MAX_PAYLOAD];
+    static uint8_t enc[RPC_MAX_FRAME];
+    static uint8_t stream[1 << 20];
+    static const char text[] = "I (1234) WiFiManager: scan done\r\n";
+    const int frames = 200000;
+    rpc_decoder_t d;
+    uint32_t rng = 1;
+    long sent_ok = 0;
+    long corrupted = 0;
+    size_t pos = 0;
+
+    rpc_decoder_init(&d, on_frame, NULL);
+    for (int it = 0; it < frames; it++) {
+        size_t len = test_rand(&rng) % 64 ? test_rand(&rng) % 48 : test_rand(&rng) % (RPC_MAX_PAYLOAD + 1);
+        for (size_t j = 0; j < len; j++) {
+            payload[j] = test_rand(&rng) % 4 ? (uint8_t)test_rand(&rng) : 0;
+        }
+        rpc_frame_t f = { (uint8_t)(test_rand(&rng) % 3 + 1), (uint16_t)it, (uint8_t)test_rand(&rng), payload, len };
+        size_t n = rpc_frame_encode(&f, enc, sizeof(enc));
+        CHECK(n > 0);
+
+        // A flipped byte that became a delimiter would split the frame rather
+        // than corrupt it, so only count flips that stay non-zero
+        bool corrupt = test_rand(&rng) % 50 == 0;
+        if (corrupt) {
+            enc[1 + test_rand(&rng) % (n - 2)] ^= (uint8_t)(1 + test_rand(&rng) % 255);
+            if (memchr(enc + 1, 0, n - 2) != NULL) {
+                continue;
+            }
+            corrupted++;
+        } else {
+            sent_ok++;
+        }
+        if (test_rand(&rng) % 10 == 0) {
+            memcpy(stream + pos, text, sizeof(text) - 1);
+            pos += sizeof(text) - 1;
+        }
+        memcpy(stream + pos, enc, n);
+        pos += n;
+
+        if (pos > sizeof(stream) - 2 * RPC_MAX_FRAME) {
+            feed_in_reads(&d, stream, pos, &rng);
+            pos = 0;
+        }
+    }
+    feed_in_reads(&d, stream, pos, &rng);
+    printf("    %ld good frames sent, %lu decoded; %ld corrupted, %lu rejected\n", sent_ok, (unsigned long)d.frames,
+           corrupted, (unsigned long)d.bad_frames);
+    CHECK(d.frames == (uint32_t)sent_ok);
+    CHECK(d.bad_frames >= (uint32_t)corrupted);
+
+    // Garbage longer than any frame is dropped whole, the next frame decodes
+    memset(stream, 'x', 3000);
+    rpc_decoder_feed(&d, stream, 3000);
+    rpc_frame_t f = { RPC_KIND_REQUEST, 42, RPC_METHOD_PING, NULL, 0 };
+    size_t n = rpc_frame_encode(&f, enc, sizeof(enc));
+    got_count = 0;
+    rpc_decoder_feed(&d, enc, n);
+    CHECK(got_count == 1 && got.id == 42 && d.overflows == 1);
+}
+
+// Cross-check with the Python client
+
+typedef struct {
+    uint8_t tag;
+    uint32_t u;                  // u32, i32 and bool
+    char data[MAX_BLOB + 1];     // str and bytes
+    size_t len;
+} value_t;
+
+typedef struct {
+    rpc_frame_t frame;
+    value_t values[MAX_VALUES];
+    int count;
+} cross_frame_t;
+
+static cross_frame_t cross[CROSS_FRAMES];
+
+#define SCHEMA_METHOD(code, NAME, name, req, resp) "method " name " " #code " " req " ; " resp,
+#define SCHEMA_TOPIC(code, NAME, name, fields)     "topic " name " " #code " " fields,
+#define SCHEMA_STATUS(code, NAME, name)            "status " #code " " name,
+
+static const char *const schema_lines[] = { RPC_METHODS(SCHEMA_METHOD) RPC_TOPICS(SCHEMA_TOPIC)
+                                            RPC_STATUSES(SCHEMA_STATUS) };
+
+#define SCHEMA_LINE_COUNT (sizeof(schema_lines) / sizeof(schema_lines[0]))
+
+// The client prints method codes in decimal, the schema has them in hex
+static bool schema_line_known(const char *line) {
+    for (size_t i = 0; i < SCHEMA_LINE_COUNT; i++) {
+        char want[192];
+        unsigned code;
+        char rest[128];
+        const char *expect = schema_lines[i];
+        if (sscanf(expect, "method %*s 0x%x%127[^\n]", &code, rest) == 2) {
+            char name[32];
+            sscanf(expect, "method %31s", name);
+            snprintf(want, sizeof(want), "method %s %u%s", name, code, rest);
+            expect = want;
+        }
+        if (strcmp(expect, line) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void random_value(value_t *v, uint32_t *rng) {
+    static const char utf8[] = "Caf\xc3\xa9 \xe2\x98\x95";
+
+    v->tag = (uint8_t)(RPC_TAG_U32 + test_rand(rng) % 5);
+    switch (v->tag) {
+    case RPC_TAG_U32:
+    case RPC_TAG_I32:
+        v->u = test_rand(rng) >> (test_rand(rng) % 32);
+        if (v->tag == RPC_TAG_I32 && test_rand(rng) % 2) {
+            v->u = 0u - v->u;
+        }
+        break;
+    case RPC_TAG_BOOL:
+        v->u = test_rand(rng) % 2;
+        break;
+    default:
+        if (v->tag == RPC_TAG_STR && test_rand(rng) % 4 == 0) {
+            v->len = sizeof(utf8) - 1;
+            memcpy(v->data, utf8, sizeof(utf8));
+            break;
+        }
+        v->len = test_rand(rng) % 8 ? test_rand(rng) % 16 : test_rand(rng) % MAX_BLOB;
+        for (size_t i = 0; i < v->len; i++) {
+            v->data[i] = v->tag == RPC_TAG_STR ? (char)(' ' + test_rand(rng) % 95) : (char)test_rand(rng);
+        }
+        v->data[v->len] = '\0';
+        break;
+    }
+}
+
+static void put_value(rpc_writer_t *w, const value_t *v) {
+    switch (v->tag) {
+    case RPC_TAG_U32:   rpc_put_u32(w, v->u); break;
+    case RPC_TAG_I32:   rpc_put_i32(w, (int32_t)v->u); break;
+    case RPC_TAG_BOOL:  rpc_put_bool(w, v->u != 0); break;
+    case RPC_TAG_STR:   rpc_put_str(w, v->data); break;
+    default:            rpc_put_bytes(w, (const uint8_t *)v->data, v->len); break;
+    }
+}
+
+static bool value_matches(rpc_reader_t *r, const value_t *v) {
+    uint32_t u;
+    int32_t i;
+    bool b;
+    const char *s;
+    const uint8_t *d;
+    size_t n;
+
+    switch (v->tag) {
+    case RPC_TAG_U32:   return rpc_get_u32(r, &u) && u == v->u;
+    case RPC_TAG_I32:   return rpc_get_i32(r, &i) && i == (int32_t)v->u;
+    case RPC_TAG_BOOL:  return rpc_get_bool(r, &b) && b == (v->u != 0);
+    case RPC_TAG_STR:   return rpc_get_str(r, &s, &n) && n == v->len && memcmp(s, v->data, n) == 0;
+    default:            return rpc_get_bytes(r, &d, &n) && n == v->len && memcmp(d, v->data, n) == 0;
+    }
+}
+
+static void print_hex(FILE *f, const void *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        fprintf(f, "%02x", ((const uint8_t *)data)[i]);
+    }
+}
+
+static void print_value(FILE *f, const value_t *v) {
+    static const char *const names[] = { NULL, "u32", "i32", "bool", "str", "bytes" };
+
+    fprintf(f, " %s:", names[v->tag]);
+    if (v->tag == RPC_TAG_U32) {
+        fprintf(f, "%lu", (unsigned long)v->u);
+    } else if (v->tag == RPC_TAG_I32) {
+        fprintf(f, "%ld", (long)(int32_t)v->u);
+    } else if (v->tag == RPC_TAG_BOOL) {
+        fprintf(f, "%u", (unsigned)v->u);
+    } else {
+        print_hex(f, v->data, v->len);
+    }
+}
+
+static void test_python_client_agrees(void) {
+    static uint8_t payloads[CROSS_FRAMES][RPC_MAX_PAYLOAD];
+    static uint8_t enc[RPC_MAX_FRAME];
+    static char line[2 * RPC_MAX_FRAME + 2];
+    char path[] = "/tmp/rpc_crosscheck_XXXXXX";
+    char cmd[512];
+    uint32_t rng = 99;
+    rpc_decoder_t d;
+
+    if (system("python3 -c '' 2>/dev/null") != 0) {
+        printf("    python3 not found, skipped\n");
+        return;
+    }
+
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    FILE *out = fdopen(fd, "w");
+    CHECK(out != NULL);
+    for (int k = 0; k < CROSS_FRAMES; k++) {
+        cross_frame_t *c = &cross[k];
+        rpc_writer_t w;
+
+        rpc_writer_init(&w, payloads[k], RPC_MAX_PAYLOAD);
+        c->count = (int)(test_rand(&rng) % (MAX_VALUES + 1));
+        for (int i = 0; i < c->count; i++) {
+            random_value(&c->values[i], &rng);
+            size_t before = w.len;
+            put_value(&w, &c->values[i]);
+            if (w.overflow) {
+                w.len = before;
+                w.overflow = false;
+                c->count = i;
+            }
+        }
+        c->frame = (rpc_frame_t){ (uint8_t)(1 + test_rand(&rng) % 3), (uint16_t)test_rand(&rng),
+                                  (uint8_t)test_rand(&rng), payloads[k], w.len };
+        size_t n = rpc_frame_encode(&c->frame, enc, sizeof(enc));
+        CHECK(n > 0);
+
+        print_hex(out, enc, n);
+        fprintf(out, " %u %u %u", c->frame.kind, c->frame.id, c->frame.code);
+        for (int i = 0; i < c->count; i++) {
+            print_value(out, &c->values[i]);
+        }
+        fputc('\n', out);
+    }
+    CHECK(fclose(out) == 0);
+
+    snprintf(cmd, sizeof(cmd), "python3 %s/tests/host/rpc_crosscheck.py < %s", HOST_TEST_ROOT, path);
+    FILE *in = popen(cmd, "r");
+    CHECK(in != NULL);
+
+    // The client's view of rpc_schema.h, then its encoding of every frame
+    size_t schema_seen = 0;
+    while (fgets(line, sizeof(line), in) != NULL && strcmp(line, "frames\n") != 0) {
+        line[strcspn(line, "\n")] = '\0';
+        if (!schema_line_known(line)) {
+            fprintf(stderr, "client schema line not in rpc_schema.h: '%s'\n", line);
+        }
+        CHECK(schema_line_known(line));
+        schema_seen++;
+    }
+    CHECK(schema_seen == SCHEMA_LINE_COUNT);
+
+    rpc_decoder_init(&d, on_frame, NULL);
+    int checked = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        const cross_frame_t *c = &cross[checked];
+        size_t n = strcspn(line, "\n") / 2;
+        CHECK(checked < CROSS_FRAMES && n <= sizeof(enc));
+        for (size_t i = 0; i < n; i++) {
+            CHECK(sscanf(line + 2 * i, "%2hhx", &enc[i]) == 1);
+        }
+
+        got_count = 0;
+        rpc_decoder_feed(&d, enc, n);
+        CHECK(got_count == 1);
+        CHECK(got.kind == c->frame.kind && got.id == c->frame.id && got.code == c->frame.code);
+        rpc_reader_t r;
+        rpc_reader_init(&r, got.payload, got.payload_len);
+        for (int i = 0; i < c->count; i++) {
+            CHECK(value_matches(&r, &c->values[i]));
+        }
+        CHECK(rpc_reader_done(&r));
+        checked++;
+    }
+    CHECK(pclose(in) == 0);
+    unlink(path);
+
+    printf("    %d frames and %zu schema entries agree with scripts/ghost_rpc.py\n", checked, schema_seen);
+    CHECK(checked == CROSS_FRAMES);
+}
+
+// A console command over RPC, both ends in one thread: the host encodes a
+// run request, the device decodes it and answers with the esp_err_t, the
+// host decodes the answer. Wire time is not included, only the codec's.
+
+static uint8_t response[64];
+static size_t response_len;
+static int32_t result;
+
+static void device_frame(const rpc_frame_t *frame, void *ctx) {
+    uint8_t buf[16];
+    rpc_writer_t w;
+    rpc_reader_t r;
+    const char *cmd;
+    size_t len;
+
+    rpc_reader_init(&r, frame->payload, frame->payload_len);
+    rpc_writer_init(&w, buf, sizeof(buf));
+    uint8_t status = RPC_STATUS_BAD_ARGS;
+    if (frame->code == RPC_METHOD_RUN && rpc_get_str(&r, &cmd, &len) && rpc_reader_done(&r)) {
+        rpc_put_i32(&w, (int32_t)len);
+        status = RPC_STATUS_OK;
+    }
+    rpc_frame_t out = { RPC_KIND_RESPONSE, frame->id, status, buf, w.len };
+    response_len = rpc_frame_encode(&out, response, sizeof(response));
+}
+
+static void host_frame(const rpc_frame_t *frame, void *ctx) {
+    rpc_reader_t r;
+
+    rpc_reader_init(&r, frame->payload, frame->payload_len);
+    if (frame->code != RPC_STATUS_OK || !rpc_get_i32(&r, &result)) {
+        result = -1;
+    }
+}
+
+static void bench_commands(void) {
+    static const char *const commands[] = { "scanap", "list -s -o rssi", "capture -probe",
+                                            "connect \"Cafe WiFi\" hunter2", "stop" };
+    const long rounds = 2000000;
+    uint8_t request[RPC_MAX_FRAME];
+    uint8_t payload[64];
+    rpc_decoder_t device, host;
+    size_t wire = 0;
+
+    rpc_decoder_init(&device, device_frame, NULL);
+    rpc_decoder_init(&host, host_frame, NULL);
+    double start = test_seconds();
+    for (long i = 0; i < rounds; i++) {
+        const char *cmd = commands[i % 5];
+        rpc_writer_t w;
+        rpc_writer_init(&w, payload, sizeof(payload));
+        rpc_put_str(&w, cmd);
+        rpc_frame_t f = { RPC_KIND_REQUEST, (uint16_t)i, RPC_METHOD_RUN, payload, w.len };
+        size_t n = rpc_frame_encode(&f, request, sizeof(request));
+        rpc_decoder_feed(&device, request, n);
+        rpc_decoder_feed(&host, response, response_len);
+        CHECK(result == (int32_t)strlen(cmd));
+        wire += n + response_len;
+    }
+    double secs = test_seconds() - start;
+    CHECK(device.frames == rounds && host.frames == rounds);
+    printf("  rpc run: %.2f M commands/s, %.0f ns per round trip, %.1f bytes on the wire each\n", rounds / secs / 1e6,
+           secs * 1e9 / rounds, (double)wire / rounds);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_values);
+    TEST_RUN(test_frame_edges);
+    TEST_RUN(test_noisy_stream);
+    TEST_RUN(test_python_client_agrees);
+    if (test_bench_requested(argc, argv)) {
+        bench_commands();
+    }
+    return test_done("rpc_codec");
+}
@@ -0,0 +1,329 @@
+#include "core/script_engine.h"
+#include "test.h"
+#include <stdbool.h>
+
+// Scripts run against a fake environment: sleep() only moves a simulated
+// clock, commands are logged, "scan <ms>" starts a job that runs that long
+// and "capture" uses 40M of card space.
+
+typedef struct {
+    uint64_t now;
+    uint64_t stop_at;            // sleep() reports a stop from here on, 0 never
+    uint32_t max_sleeps;         // Or after this many sleeps, 0 never
+    uint32_t sleeps;
+    uint32_t yields;             // sleep(0), the loop passes
+    bool free_known;
+    uint64_t free;
+    bool clock_set;
+    uint32_t clock_minutes;      // Time of day at now == 0
+    uint32_t job;
+    uint64_t job_ends;
+    char log[512];
+    uint32_t notes;
+    uint16_t note_line;
+    const char *note;
+} fake_t;
+
+static int fake_run(const char *line, void *ctx) {
+    fake_t *f = ctx;
+    size_t len = strlen(f->log);
+
+    snprintf(f->log + len, sizeof(f->log) - len, "%s%s", len ? ";" : "", line);
+    if (strncmp(line, "scan ", 5) == 0) {
+        f->job++;
+        f->job_ends = f->now + strtoull(line + 5, NULL, 10);
+    } else if (strcmp(line, "capture") == 0) {
+        f->free -= f->free < (40u << 20) ? f->free : 40u << 20;
+    }
+    return strncmp(line, "fail", 4) == 0;
+}
+
+static bool fake_sleep(uint32_t ms, void *ctx) {
+    fake_t *f = ctx;
+
+    f->sleeps++;
+    f->yields += ms == 0;
+    f->now += ms;
+    return (f->stop_at == 0 || f->now < f->stop_at) && (f->max_sleeps == 0 || f->sleeps < f->max_sleeps);
+}
+
+static bool fake_free_bytes(uint64_t *out, void *ctx) {
+    fake_t *f = ctx;
+    *out = f->free;
+    return f->free_known;
+}
+
+static bool fake_time_of_day(uint32_t *minutes, void *ctx) {
+    fake_t *f = ctx;
+    *minutes = (uint32_t)((f->clock_minutes + f->now / 60000) % 1440);
+    return f->clock_set;
+}
+
+static uint64_t fake_uptime_ms(void *ctx) {
+    return ((fake_t *)ctx)->now;
+}
+
+static uint32_t fake_latest_job(void *ctx) {
+    return ((fake_t *)ctx)->job;
+}
+
+static bool fake_job_active(uint32_t id, void *ctx) {
+    fake_t *f = ctx;
+    return id == f->job && f->now < f->job_ends;
+}
+
+static void fake_note(uint16_t line, const char *msg, void *ctx) {
+    fake_t *f = ctx;
+    f->notes++;
+    f->note_line = line;
+    f->note = msg;
+}
+
+static fake_t fake;
+static script_t script;
+static char text[4096];
+
+static script_env_t env(void) {
+    return (script_env_t){ fake_run, fake_sleep, fake_free_bytes, fake_time_of_day, fake_uptime_ms,
+                           fake_latest_job, fake_job_active, fake_note, &fake };
+}
+
+static bool parse(const char *src) {
+    snprintf(text, sizeof(text), "%s", src);
+    return script_parse(&script, text);
+}
+
+// Parses and runs src from a fresh fake with 1G free and the clock at 12:00
+static script_result_t run(const char *src) {
+    memset(&fake, 0, sizeof(fake));
+    fake.free_known = fake.clock_set = true;
+    fake.free = 1ull << 30;
+    fake.clock_minutes = 12 * 60;
+    CHECK(parse(src));
+    script_env_t e = env();
+    return script_run(&script, &e);
+}
+
+static bool parse_fails(const char *src, uint16_t line, const char *error_start) {
+    if (parse(src)) {
+        fprintf(stderr, "'%s' parsed\n", src);
+        return false;
+    }
+    if (script.error_line != line || strncmp(script.error, error_start, strlen(error_start)) != 0) {
+        fprintf(stderr, "'%s': line %u '%s'\n", src, script.error_line, script.error);
+        return false;
+    }
+    return true;
+}
+
+static void test_durations(void) {
+    uint64_t ms;
+
+    CHECK(script_parse_duration("500ms", &ms) && ms == 500);
+    CHECK(script_parse_duration("30s", &ms) && ms == 30000);
+    CHECK(script_parse_duration("30", &ms) && ms == 30000);
+    CHECK(script_parse_duration("10m", &ms) && ms == 600000);
+    CHECK(script_parse_duration("2h", &ms) && ms == 7200000);
+    CHECK(script_parse_duration("0ms", &ms) && ms == 0);
+
+    // Anything a 32-bit sleep cannot take is refused
+    CHECK(script_parse_duration("4294967295ms", &ms) && ms == UINT32_MAX);
+    CHECK(!script_parse_duration("4294967296ms", &ms));
+    CHECK(script_parse_duration("1193h", &ms) && !script_parse_duration("1194h", &ms));
+
+    CHECK(!script_parse_duration("", &ms) && !script_parse_duration("s", &ms));
+    CHECK(!script_parse_duration("-5s", &ms) && !script_parse_duration(" 5s", &ms));
+    CHECK(!script_parse_duration("5 s", &ms) && !script_parse_duration("5d", &ms));
+    CHECK(!script_parse_duration("5ms2", &ms));
+}
+
+static void test_parse(void) {
+    CHECK(parse("# survey\n\n  scanap  \r\nrepeat 3\n  delay 2s\n  list -a\nend\nif free < 100M\n  exit\nelse\n"
+                "  capture -probe\nend\n\t\n# done"));
+    CHECK(script.count == 10);
+    CHECK(script.ops[0].kind == SCRIPT_OP_CMD && strcmp(script.ops[0].text, "scanap") == 0 && script.ops[0].line == 3);
+    CHECK(script.ops[1].kind == SCRIPT_OP_REPEAT && script.ops[1].value == 3 && script.ops[1].jump == 4);
+    CHECK(script.ops[2].kind == SCRIPT_OP_DELAY && script.ops[2].value == 2000);
+    CHECK(script.ops[4].kind == SCRIPT_OP_END && script.ops[4].jump == 1 && script.ops[4].line == 7);
+    CHECK(script.ops[5].kind == SCRIPT_OP_IF && script.ops[5].var == SCRIPT_VAR_FREE &&
+          script.ops[5].cmp == SCRIPT_LT && script.ops[5].value == 100ull << 20);
+    CHECK(script.ops[5].jump == 7 && script.ops[7].kind == SCRIPT_OP_ELSE && script.ops[7].jump == 9);
+    CHECK(script.ops[8].kind == SCRIPT_OP_CMD && strcmp(script.ops[8].text, "capture -probe") == 0);
+
+    // Commands keep their spacing and quotes, only the ends are trimmed
+    CHECK(parse("connect  \"My Net\"   'pass word'  "));
+    CHECK(strcmp(script.ops[0].text, "connect  \"My Net\"   'pass word'") == 0);
+
+    // A keyword only matches as a whole word
+    CHECK(parse("delayed\nexits\nrepeater\nendless\nwhilst"));
+    CHECK(script.count == 5);
+    for (int i = 0; i < 5; i++) {
+        CHECK(script.ops[i].kind == SCRIPT_OP_CMD);
+    }
+
+    CHECK(parse("while time >= 22:30\nend\nif uptime != 90m\nend\nwaitjob\nwaitjob 10m\nif free == 2G\nend"));
+    CHECK(script.ops[0].var == SCRIPT_VAR_TIME && script.ops[0].cmp == SCRIPT_GE);
+    CHECK(script.ops[0].value == 22 * 60 + 30);
+    CHECK(script.ops[2].var == SCRIPT_VAR_UPTIME && script.ops[2].cmp == SCRIPT_NE && script.ops[2].value == 5400000);
+    CHECK(script.ops[4].kind == SCRIPT_OP_WAITJOB && script.ops[4].value == 0 && script.ops[5].value == 600000);
+    CHECK(script.ops[6].value == 2ull << 30 && script.ops[6].cmp == SCRIPT_EQ);
+
+    CHECK(parse("") && script.count == 0);
+    CHECK(parse("# nothing\n\n") && script.count == 0);
+}
+
+static void test_parse_errors(void) {
+    CHECK(parse_fails("scanap\ndelay soon", 2, "expected a duration"));
+    CHECK(parse_fails("delay", 1, "expected a duration"));
+    CHECK(parse_fails("waitjob forever", 1, "expected a timeout"));
+    CHECK(parse_fails("exit now", 1, "exit takes no arguments"));
+    CHECK(parse_fails("repeat 0\nend", 1, "repeat count"));
+    CHECK(parse_fails("repeat three\nend", 1, "repeat count"));
+    CHECK(parse_fails("repeat 3x\nend", 1, "repeat count"));
+    CHECK(parse_fails("if free < lots\nend", 1, "expected a condition"));
+    CHECK(parse_fails("if disk < 5M\nend", 1, "expected a condition"));
+    CHECK(parse_fails("if free =< 5M\nend", 1, "expected a condition"));
+    CHECK(parse_fails("while time > 24:00\nend", 1, "expected a condition"));
+    CHECK(parse_fails("while time > 12:00 pm\nend", 1, "expected a condition"));
+    CHECK(parse_fails("if free < 5M\nelse\nelse\nend", 3, "else without if"));
+    CHECK(parse_fails("repeat\nelse\nend", 2, "else without if"));
+    CHECK(parse_fails("else", 1, "else without if"));
+    CHECK(parse_fails("scanap\nend", 2, "end without"));
+    CHECK(parse_fails("repeat\nend now", 2, "end without"));
+
+    // An unclosed block is reported where it opens, the innermost first; an
+    // end closes the nearest block, so here it is the repeat that has none
+    CHECK(parse_fails("repeat\n  scanap\n  if free < 1M\n    stop", 3, "block has no end"));
+    CHECK(parse_fails("repeat\n  scanap\n  if free < 1M\n    stop\nend", 1, "block has no end"));
+
+    char deep[256] = "";
+    for (int i = 0; i < SCRIPT_MAX_DEPTH; i++) {
+        strcat(deep, "repeat\n");
+    }
+    for (int i = 0; i < SCRIPT_MAX_DEPTH; i++) {
+        strcat(deep, "end\n");
+    }
+    CHECK(parse(deep));
+    char deeper[300];
+    snprintf(deeper, sizeof(deeper), "repeat\n%s", deep);
+    CHECK(parse_fails(deeper, SCRIPT_MAX_DEPTH + 1, "blocks nested too deeply"));
+
+    // Comments and blank lines do not count, statements do
+    char many[4096] = "# header\n\n";
+    for (int i = 0; i < SCRIPT_MAX_OPS; i++) {
+        strcat(many, "stop\n");
+    }
+    CHECK(parse(many) && script.count == SCRIPT_MAX_OPS);
+    strcat(many, "\n# still fine\nstop\n");
+    CHECK(parse_fails(many, SCRIPT_MAX_OPS + 5, "too many statements"));
+}
+
+static void test_commands_and_loops(void) {
+    CHECK(run("scanap\nrepeat 3\n  delay 2s\n  list -a\nend\nstop") == SCRIPT_DONE);
+    CHECK(strcmp(fake.log, "scanap;list -a;list -a;list -a;stop") == 0);
+    CHECK(script.commands == 5 && script.failed == 0);
+    // Three delays, and a yield for each of the two passes back to the top
+    CHECK(fake.now == 6000 && fake.yields == 2);
+
+    // Nested counts multiply, and a second run starts the counts afresh
+    CHECK(run("repeat 2\n  a\n  repeat 3\n    b\n  end\nend") == SCRIPT_DONE);
+    CHECK(strcmp(fake.log, "a;b;b;b;a;b;b;b") == 0);
+    fake.log[0] = '\0';
+    script_env_t e = env();
+    CHECK(script_run(&script, &e) == SCRIPT_DONE && strcmp(fake.log, "a;b;b;b;a;b;b;b") == 0);
+
+    // Failures are counted and the script carries on
+    CHECK(run("fail one\nok\nfail two") == SCRIPT_DONE);
+    CHECK(script.commands == 3 && script.failed == 2 && strcmp(fake.log, "fail one;ok;fail two") == 0);
+
+    CHECK(run("a\nexit\nb") == SCRIPT_EXITED && strcmp(fake.log, "a") == 0);
+    CHECK(run("repeat\n  a\n  repeat 2\n    exit\n  end\nend") == SCRIPT_EXITED && strcmp(fake.log, "a") == 0);
+}
+
+static void test_conditions(void) {
+    // free: runs captures until the card drops to 100M
+    CHECK(run("while free > 100M\n  capture\n  delay 1s\nend\ndone") == SCRIPT_DONE);
+    CHECK(script.commands == 25 && fake.free == (1ull << 30) - 24 * (40ull << 20));
+
+    CHECK(run("if free < 2G\n  small\nelse\n  big\nend") == SCRIPT_DONE && strcmp(fake.log, "small") == 0);
+    CHECK(run("if free >= 2G\n  big\nelse\n  small\nend\nafter") == SCRIPT_DONE &&
+          strcmp(fake.log, "small;after") == 0);
+    CHECK(run("if free == 1G\n  exact\nend\nif free != 1G\n  other\nend") == SCRIPT_DONE &&
+          strcmp(fake.log, "exact") == 0);
+
+    // time of day from 12:00 and uptime, both moved by the delays
+    CHECK(run("while time < 12:30\n  delay 10m\nend\nif time == 12:30\n  half\nend") == SCRIPT_DONE);
+    CHECK(fake.now == 30 * 60000 && strcmp(fake.log, "half") == 0);
+    CHECK(run("while uptime <= 1m\n  delay 20s\nend\nif uptime > 1m\n  late\nend") == SCRIPT_DONE);
+    CHECK(fake.now == 80000 && strcmp(fake.log, "late") == 0);
+}
+
+static void test_unknown_values_are_false(void) {
+    memset(&fake, 0, sizeof(fake));
+    CHECK(parse("if free > 0\n  a\nelse\n  b\nend\nrepeat 3\n  while free < 1G\n    c\n  end\nend\nif time < 23:59\n"
+                "  d\nend"));
+    script_env_t e = env();
+    CHECK(script_run(&script, &e) == SCRIPT_DONE && strcmp(fake.log, "b") == 0);
+
+    // One note per unknown value per run, however often it is checked
+    CHECK(fake.notes == 2 && fake.note_line == 11 && strstr(fake.note, "clock not set") != NULL);
+    fake.notes = 0;
+    CHECK(script_run(&script, &e) == SCRIPT_DONE && fake.notes == 2);
+
+    // Without a note hook nothing is reported and nothing breaks
+    e.note = NULL;
+    CHECK(script_run(&script, &e) == SCRIPT_DONE);
+}
+
+static void test_waitjob(void) {
+    // Waits for the job the last command started, polling at SCRIPT_POLL_MS
+    CHECK(run("scan 1000\nwaitjob\nlist") == SCRIPT_DONE);
+    CHECK(fake.now == 1000 && fake.sleeps == 1000 / SCRIPT_POLL_MS && strcmp(fake.log, "scan 1000;list") == 0);
+
+    // A timeout gives up with a note, not an error
+    CHECK(run("scan 600000\nwaitjob 1s\nstop") == SCRIPT_DONE);
+    CHECK(fake.now == 1000 && fake.notes == 1 && fake.note_line == 2 && strcmp(fake.log, "scan 600000;stop") == 0);
+
+    // No job started yet, or it already ended: nothing to wait for
+    CHECK(run("waitjob\nscan 100\ndelay 1s\nwaitjob\na") == SCRIPT_DONE);
+    CHECK(fake.now == 1000 && fake.sleeps == 1 && fake.notes == 0);
+}
+
+static void test_stop(void) {
+    // A stop during a delay ends the script there
+    memset(&fake, 0, sizeof(fake));
+    CHECK(parse("a\ndelay 10s\nb"));
+    fake.stop_at = 5000;
+    script_env_t e = env();
+    CHECK(script_run(&script, &e) == SCRIPT_STOPPED && strcmp(fake.log, "a") == 0);
+
+    // Loops without a delay still yield every pass, so they can be stopped
+    memset(&fake, 0, sizeof(fake));
+    CHECK(parse("repeat\n  a\nend"));
+    fake.max_sleeps = 100;
+    CHECK(script_run(&script, &e) == SCRIPT_STOPPED && script.commands == 100 && fake.yields == 100);
+
+    // Or during a waitjob poll
+    memset(&fake, 0, sizeof(fake));
+    CHECK(parse("scan 600000\nwaitjob\nb"));
+    fake.stop_at = 3000;
+    CHECK(script_run(&script, &e) == SCRIPT_STOPPED && fake.now == 3000 && strcmp(fake.log, "scan 600000") == 0);
+
+    // An endless repeat with a delay runs until stopped, a pass per delay
+    memset(&fake, 0, sizeof(fake));
+    CHECK(parse("repeat\n  tick\n  delay 1m\nend"));
+    fake.stop_at = 60 * 60000;
+    CHECK(script_run(&script, &e) == SCRIPT_STOPPED && script.commands == 60);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_durations);
+    TEST_RUN(test_parse);
+    TEST_RUN(test_parse_errors);
+    TEST_RUN(test_commands_and_loops);
+    TEST_RUN(test_conditions);
+    TEST_RUN(test_unknown_values_are_false);
+    TEST_RUN(test_waitjob);
+    TEST_RUN(test_stop);
+    return test_done("script_engine");
+}
@@ -0,0 +1,258 @@
+#include "core/station_stats.h"
+#include "test.h"
+
+#define FRAME_MAX 64
+
+#define TO_DS    0x01
+#define FROM_DS  0x02
+#define PWR_MGT  0x10
+
+static const uint8_t ap[6] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+
+static void make_mac(uint8_t mac[6], uint32_t id) {
+    mac[0] = 0x00;
+    mac[1] = 0x10;
+    mac[2] = (uint8_t)(id >> 24);
+    mac[3] = (uint8_t)(id >> 16);
+    mac[4] = (uint8_t)(id >> 8);
+    mac[5] = (uint8_t)id;
+}
+
+// Data frame of len bytes between sta and ap, ToDS when uplink
+static size_t make_data(uint8_t *f, const uint8_t sta[6], bool uplink, uint8_t extra_flags, size_t len) {
+    memset(f, 0, len);
+    f[0] = 0x08;
+    f[1] = (uint8_t)((uplink ? TO_DS : FROM_DS) | extra_flags);
+    memcpy(&f[4], uplink ? ap : sta, 6);
+    memcpy(&f[10], uplink ? sta : ap, 6);
+    memcpy(&f[16], ap, 6);
+    return len;
+}
+
+static size_t make_probe(uint8_t *f, const uint8_t sta[6]) {
+    memset(f, 0, 26);
+    f[0] = 0x40;
+    memset(&f[4], 0xFF, 6);
+    memcpy(&f[10], sta, 6);
+    memset(&f[16], 0xFF, 6);
+    return 26;                   // Wildcard SSID element
+}
+
+// The table's own hash, to place stations on purpose
+static uint32_t slot_of(const uint8_t mac[6]) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        h ^= mac[i];
+        h *= 16777619u;
+    }
+    return h & (STATION_STATS_MAX_STATIONS - 1);
+}
+
+static void test_counters(void) {
+    static station_stats_t stats;
+    uint8_t f[FRAME_MAX];
+    uint8_t sta[6];
+    bool is_new;
+
+    station_stats_init(&stats);
+    make_mac(sta, 1);
+
+    station_entry_t *e = station_stats_update(&stats, f, make_data(f, sta, true, 0, 60), -60, 1000, &is_new);
+    CHECK(e != NULL && is_new && memcmp(e->mac, sta, 6) == 0 && memcmp(e->ap_bssid, ap, 6) == 0);
+    CHECK(e->frames_up == 1 && e->bytes_up == 60 && e->frames_down == 0 && e->first_seen_ms == 1000);
+    CHECK(e->has_rssi && e->rssi_min == -60 && e->rssi_max == -60 && e->rssi_avg_q4 == -60 * 16);
+
+    // Downlink counts but says nothing about the station's signal
+    CHECK(station_stats_update(&stats, f, make_data(f, sta, false, 0, 40), -20, 1100, &is_new) == e && !is_new);
+    CHECK(e->frames_down == 1 && e->bytes_down == 40 && e->rssi_max == -60 && e->last_seen_ms == 1100);
+
+    // Uplink signal: extremes and a slow average
+    station_stats_update(&stats, f, make_data(f, sta, true, 0, 30), -40, 1200, &is_new);
+    station_stats_update(&stats, f, make_data(f, sta, true, 0, 30), -80, 1300, &is_new);
+    CHECK(e->rssi_min == -80 && e->rssi_max == -40 && e->frames_up == 3 && e->bytes_up == 120);
+    CHECK(e->rssi_avg_q4 / 16 >= -61 && e->rssi_avg_q4 / 16 <= -59);
+
+    // Power save changes count once each way, downlink bits are ignored
+    station_stats_update(&stats, f, make_data(f, sta, true, PWR_MGT, 30), -60, 1400, &is_new);
+    station_stats_update(&stats, f, make_data(f, sta, true, PWR_MGT, 30), -60, 1500, &is_new);
+    station_stats_update(&stats, f, make_data(f, sta, false, PWR_MGT, 30), -60, 1550, &is_new);
+    CHECK(e->power_save && e->ps_transitions == 1);
+    station_stats_update(&stats, f, make_data(f, sta, true, 0, 30), -60, 1600, &is_new);
+    CHECK(!e->power_save && e->ps_transitions == 2);
+
+    // A new station dozing from its first frame is no transition
+    uint8_t dozy[6];
+    make_mac(dozy, 2);
+    station_entry_t *d = station_stats_update(&stats, f, make_data(f, dozy, true, PWR_MGT, 30), -60, 1700, &is_new);
+    CHECK(is_new && d->power_save && d->ps_transitions == 0);
+
+    // Probes from a known station add to it
+    CHECK(station_stats_update(&stats, f, make_probe(f, sta), -50, 1800, &is_new) == e && !is_new);
+    CHECK(e->probe_requests == 1 && e->rssi_max == -40);
+
+    // Frames that are not one station's traffic
+    uint32_t seen = stats.frames_seen;
+    uint8_t group[6] = { 0x01, 0x00, 0x5e, 0x00, 0x00, 0x01 };
+    CHECK(station_stats_update(&stats, f, make_data(f, group, false, 0, 40), -50, 1900, &is_new) == NULL);
+    CHECK(station_stats_update(&stats, f, make_probe(f, group), -50, 1900, &is_new) == NULL);
+    make_data(f, sta, true, 0, 40);
+    f[1] = TO_DS | FROM_DS;
+    CHECK(station_stats_update(&stats, f, 40, -50, 1900, &is_new) == NULL);
+    f[1] = 0;
+    CHECK(station_stats_update(&stats, f, 40, -50, 1900, &is_new) == NULL);
+    make_probe(f, sta);
+    f[0] = 0x80;
+    CHECK(station_stats_update(&stats, f, 26, -50, 1900, &is_new) == NULL);
+    f[0] = 0xB4;
+    CHECK(station_stats_update(&stats, f, 26, -50, 1900, &is_new) == NULL);
+    CHECK(stats.frames_seen == seen + 6);
+    CHECK(station_stats_update(&stats, f, 23, -50, 1900, &is_new) == NULL && !is_new);
+    CHECK(stats.frames_seen == seen + 6 && stats.station_count == 2 && stats.evictions == 0);
+}
+
+static void test_fill_and_eviction(void) {
+    static station_stats_t stats;
+    uint8_t f[FRAME_MAX];
+    uint8_t macs[STATION_STATS_MAX_PROBE + 1][6];
+    bool is_new;
+
+    // Enough stations hashing to one slot to overflow its probe window
+    station_stats_init(&stats);
+    int found = 0;
+    for (uint32_t id = 0; found <= STATION_STATS_MAX_PROBE; id++) {
+        make_mac(macs[found], id);
+        if (slot_of(macs[found]) == 5) {
+            found++;
+        }
+    }
+    for (int i = 0; i < STATION_STATS_MAX_PROBE; i++) {
+        station_stats_update(&stats, f, make_data(f, macs[i], true, 0, 30), -50, 100 + (uint32_t)i, &is_new);
+        CHECK(is_new);
+    }
+    CHECK(stats.station_count == STATION_STATS_MAX_PROBE && stats.evictions == 0);
+    for (int i = 0; i < STATION_STATS_MAX_PROBE; i++) {
+        CHECK(stats.stations[5 + i].in_use);
+    }
+
+    // The oldest after a refresh of the first goes
+    station_stats_update(&stats, f, make_data(f, macs[0], true, 0, 30), -50, 500, &is_new);
+    CHECK(!is_new);
+    station_entry_t *e = station_stats_update(&stats, f, make_data(f, macs[8], true, 0, 30), -50, 600, &is_new);
+    CHECK(is_new && e == &stats.stations[6] && e->frames_up == 1 && e->first_seen_ms == 600);
+    CHECK(stats.evictions == 1 && stats.station_count == STATION_STATS_MAX_PROBE);
+    CHECK(station_stats_update(&stats, f, make_data(f, macs[0], true, 0, 30), -50, 700, &is_new)->frames_up == 3);
+    CHECK(!is_new);
+    station_stats_update(&stats, f, make_data(f, macs[1], true, 0, 30), -50, 800, &is_new);
+    CHECK(is_new && stats.evictions == 2);
+
+    // Ages compare across the millisecond counter wrapping
+    station_stats_init(&stats);
+    for (int i = 0; i < STATION_STATS_MAX_PROBE; i++) {
+        station_stats_update(&stats, f, make_data(f, macs[i], true, 0, 30), -50, UINT32_MAX - 50 + 10 * (uint32_t)i,
+                             &is_new);
+    }
+    e = station_stats_update(&stats, f, make_data(f, macs[8], true, 0, 30), -50, 100, &is_new);
+    CHECK(is_new && e == &stats.stations[5]);
+
+    // A crowd: every new station either takes a slot or evicts one
+    station_stats_init(&stats);
+    uint32_t added = 0;
+    for (uint32_t id = 0; id < 1000; id++) {
+        uint8_t mac[6];
+        make_mac(mac, 0x1000 + id);
+        station_stats_update(&stats, f, make_data(f, mac, id % 2 == 0, 0, 30), -50, id, &is_new);
+        added += is_new;
+        CHECK(stats.station_count <= STATION_STATS_MAX_STATIONS);
+    }
+    CHECK(added == 1000 && stats.station_count + stats.evictions == added);
+    CHECK(stats.station_count > STATION_STATS_MAX_STATIONS * 3 / 4 && stats.evictions > 0);
+    uint32_t in_use = 0;
+    for (int i = 0; i < STATION_STATS_MAX_STATIONS; i++) {
+        in_use += stats.stations[i].in_use;
+    }
+    CHECK(in_use == stats.station_count);
+}
+
+static void test_sort(void) {
+    static station_stats_t stats;
+    uint8_t f[FRAME_MAX];
+    uint8_t mac[6];
+    uint16_t order[STATION_STATS_MAX_STATIONS];
+    station_sort_t key;
+    bool is_new;
+
+    station_stats_init(&stats);
+    // a: many small frames, b: few big ones and the best signal, c: most recent, d: no signal
+    for (int i = 0; i < 10; i++) {
+        make_mac(mac, 0xa);
+        station_stats_update(&stats, f, make_data(f, mac, true, 0, 40), -70, 100, &is_new);
+    }
+    make_mac(mac, 0xb);
+    station_stats_update(&stats, f, make_data(f, mac, true, 0, 60), -30, 200, &is_new);
+    station_stats_update(&stats, f, make_data(f, mac, false, 0, 64), -30, 200, &is_new);
+    station_stats_update(&stats, f, make_data(f, mac, false, 0, 64), -30, 200, &is_new);
+    station_stats_update(&stats, f, make_data(f, mac, false, 0, 64), -30, 200, &is_new);
+    station_stats_update(&stats, f, make_data(f, mac, false, 0, 64), -30, 200, &is_new);
+    make_mac(mac, 0xc);
+    station_stats_update(&stats, f, make_data(f, mac, true, 0, 30), -50, 400, &is_new);
+    station_stats_update(&stats, f, make_data(f, mac, true, 0, 30), -50, 400, &is_new);
+    make_mac(mac, 0xd);
+    station_stats_update(&stats, f, make_data(f, mac, false, 0, 30), 0, 300, &is_new);
+
+    static const struct {
+        const char *name;
+        uint8_t first, last;
+    } want[] = { { "recent", 0xc, 0xa }, { "FRAMES", 0xa, 0xd }, { "bytes", 0xa, 0xd }, { "rssi", 0xb, 0xd } };
+    for (size_t k = 0; k < sizeof(want) / sizeof(want[0]); k++) {
+        CHECK(station_stats_parse_sort(want[k].name, &key));
+        CHECK(station_stats_sort(&stats, key, order, STATION_STATS_MAX_STATIONS) == 4);
+        CHECK(stats.stations[order[0]].mac[5] == want[k].first && stats.stations[order[3]].mac[5] == want[k].last);
+    }
+    CHECK(!station_stats_parse_sort("loudest", &key));
+    CHECK(station_stats_sort(&stats, STATION_SORT_RECENT, order, 2) == 2);
+}
+
+// Per-frame cost of a busy channel: 500 stations, mostly data both ways
+// with some probing, cycling through the frames many times
+static void bench_frames(void) {
+    enum { CORPUS = 4096, STATIONS = 500, ROUNDS = 500 };
+    static station_stats_t stats;
+    static uint8_t frames[CORPUS][FRAME_MAX];
+    static size_t lens[CORPUS];
+    uint32_t rng = 11;
+    bool is_new;
+
+    for (uint32_t k = 0; k < CORPUS; k++) {
+        uint8_t mac[6];
+        make_mac(mac, test_rand(&rng) % STATIONS);
+        uint32_t kind = test_rand(&rng) % 10;
+        if (kind == 0) {
+            lens[k] = make_probe(frames[k], mac);
+        } else {
+            lens[k] = make_data(frames[k], mac, kind < 6, kind == 3 ? PWR_MGT : 0, 24 + test_rand(&rng) % 40);
+        }
+    }
+
+    station_stats_init(&stats);
+    double start = test_seconds();
+    for (uint32_t r = 0; r < ROUNDS; r++) {
+        for (uint32_t k = 0; k < CORPUS; k++) {
+            station_stats_update(&stats, frames[k], lens[k], -50, r * CORPUS + k, &is_new);
+        }
+    }
+    double secs = test_seconds() - start;
+    double n = (double)ROUNDS * CORPUS;
+    printf("  station_stats_update: %.0f frames/s, %.1f ns/frame (%lu stations, %lu evictions, %zu bytes state)\n",
+           n / secs, secs * 1e9 / n, (unsigned long)stats.station_count, (unsigned long)stats.evictions,
+           sizeof(stats));
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_counters);
+    TEST_RUN(test_fill_and_eviction);
+    TEST_RUN(test_sort);
+    if (test_bench_requested(argc, argv)) {
+        bench_frames();
+    }
+    return test_done("station_stats");
+}
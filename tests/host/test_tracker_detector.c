@@ -0,0 +1,365 @@
+#include "core/tracker_detector.h"
+#include "test.h"
+
+#define MINUTE 60000u
+
+static size_t make_find_my(uint8_t *d, const uint8_t key[23]) {
+    d[0] = 0x1E;
+    d[1] = 0xFF;
+    d[2] = 0x4C;
+    d[3] = 0x00;
+    d[4] = 0x12;     // Offline finding
+    d[5] = 0x19;
+    d[6] = 0x10;     // Status
+    memcpy(&d[7], key, 22);
+    d[29] = key[22] & 3;
+    d[30] = 0;
+    return 31;
+}
+
+static size_t make_smarttag(uint8_t *d, uint32_t aging, const uint8_t privacy_id[8]) {
+    size_t i = 0;
+    d[i++] = 2;
+    d[i++] = 0x01;
+    d[i++] = 0x06;
+    d[i++] = 1 + 2 + 1 + 3 + 8 + 1 + 4;   // Service data: UUID, state, aging, ID, region, tail
+    d[i++] = 0x16;
+    d[i++] = 0x5A;
+    d[i++] = 0xFD;
+    d[i++] = 0x13;
+    d[i++] = (uint8_t)aging;
+    d[i++] = (uint8_t)(aging >> 8);
+    d[i++] = (uint8_t)(aging >> 16);
+    memcpy(&d[i], privacy_id, 8);
+    i += 8;
+    d[i++] = 0x42;
+    memset(&d[i], 0xAB, 4);
+    return i + 4;
+}
+
+static size_t make_tile(uint8_t *d) {
+    static const uint8_t tile[] = { 0x02, 0x01, 0x06, 0x03, 0x03, 0xED, 0xFE, 0x09, 0x16, 0xED, 0xFE, 1, 2, 3, 4, 5, 6 };
+    memcpy(d, tile, sizeof(tile));
+    return sizeof(tile);
+}
+
+static void test_parse(void) {
+    uint8_t d[31];
+    uint8_t key[23] = { 1 };
+    ble_adv_t adv;
+    tracker_sighting_t s;
+
+    CHECK(ble_adv_parse(d, make_find_my(d, key), &adv));
+    CHECK(tracker_parse(&adv, key, &s) && s.type == TRACKER_FIND_MY && !s.has_link);
+
+    // Nearby frames of a device with its owner are not offline finding
+    d[5] = 0x02;
+    CHECK(ble_adv_parse(d, 31, &adv));
+    CHECK(!tracker_parse(&adv, key, &s));
+
+    static const uint8_t nearby_info[] = { 2, 1, 0x1A, 0x0A, 0xFF, 0x4C, 0x00, 0x10, 0x05, 0x01, 0x18, 0x1A, 0x2B, 0x3C };
+    CHECK(ble_adv_parse(nearby_info, sizeof(nearby_info), &adv));
+    CHECK(!tracker_parse(&adv, key, &s));
+
+    uint8_t pid[8] = { 9 };
+    CHECK(ble_adv_parse(d, make_smarttag(d, 100, pid), &adv));
+    CHECK(tracker_parse(&adv, key, &s) && s.type == TRACKER_SMARTTAG && s.has_link && s.link == 100);
+
+    CHECK(ble_adv_parse(d, make_tile(d), &adv));
+    CHECK(tracker_parse(&adv, key, &s) && s.type == TRACKER_TILE);
+}
+
+static void feed_smarttag(tracker_detector_t *det, uint32_t aging, uint8_t id, uint32_t now_ms,
+                          tracker_entry_t **entry, bool *is_new, bool *alerted, tracker_alert_t *alert) {
+    static const uint8_t addr[6] = { 1 };
+    uint8_t pid[8] = { id };
+    uint8_t d[31];
+    ble_adv_t adv;
+    tracker_sighting_t s;
+
+    CHECK(ble_adv_parse(d, make_smarttag(d, aging, pid), &adv));
+    CHECK(tracker_parse(&adv, addr, &s));
+    *entry = tracker_detector_update(det, &s, addr, -50, now_ms, is_new, alerted, alert);
+}
+
+static void test_smarttag_rotation_and_dwell(void) {
+    tracker_detector_t det;
+    tracker_entry_t *e, *e2;
+    tracker_alert_t alert;
+    bool is_new, alerted;
+
+    tracker_detector_init(&det, 10 * MINUTE);
+    feed_smarttag(&det, 100, 9, 0, &e, &is_new, &alerted, &alert);
+    CHECK(is_new && !alerted);
+
+    // Next privacy ID with the aging counter one up: the same tag
+    feed_smarttag(&det, 101, 7, 3 * MINUTE, &e2, &is_new, &alerted, &alert);
+    CHECK(!is_new && e2 == e && e->rotations == 1);
+
+    // Same counter, other ID: another tag
+    feed_smarttag(&det, 101, 8, 6 * MINUTE, &e2, &is_new, &alerted, &alert);
+    CHECK(is_new && e2 != e);
+
+    for (uint32_t t = 6 * MINUTE; t < 10 * MINUTE; t += MINUTE) {
+        feed_smarttag(&det, 101, 7, t, &e2, &is_new, &alerted, &alert);
+        CHECK(!alerted);
+    }
+    feed_smarttag(&det, 101, 7, 10 * MINUTE + 1, &e2, &is_new, &alerted, &alert);
+    CHECK(alerted && alert.dwell_ms >= 10 * MINUTE);
+    feed_smarttag(&det, 101, 7, 11 * MINUTE, &e2, &is_new, &alerted, &alert);
+    CHECK(!alerted);
+    CHECK(tracker_dwell_ms(e, 11 * MINUTE) == 11 * MINUTE);
+    CHECK(tracker_dwell_ms(e, 16 * MINUTE) == 0);
+
+    // A gap longer than TRACKER_MAX_GAP_BUCKETS starts over and may alert again
+    feed_smarttag(&det, 101, 7, 20 * MINUTE, &e2, &is_new, &alerted, &alert);
+    CHECK(!alerted && tracker_dwell_ms(e, 20 * MINUTE) == 0);
+    int alerts = 0;
+    for (uint32_t t = 21 * MINUTE; t <= 31 * MINUTE; t += MINUTE) {
+        feed_smarttag(&det, 101, 7, t, &e2, &is_new, &alerted, &alert);
+        alerts += alerted;
+    }
+    CHECK(alerts == 1);
+}
+
+// Simulated walk: followers stay with the user from the first minute,
+// passers-by are in range for a while somewhere along the way. Every tag
+// advertises every 2 s and each advert is lost with probability loss_pct.
+// SmartTags rotate their privacy ID and address every 15 minutes.
+
+typedef struct {
+    tracker_type_t type;
+    uint8_t key[23];
+    uint8_t pid[8];
+    uint32_t aging;
+    uint8_t addr[6];
+    uint32_t in_ms;
+    uint32_t out_ms;
+    uint32_t next_rotation_ms;
+    bool follower;
+    bool alerted;
+} tag_t;
+
+typedef struct {
+    int followers;
+    int passers;
+    uint32_t duration_ms;
+    uint32_t loss_pct;
+    uint32_t dwell_ms;
+    uint32_t types;            // Bit per tracker_type_t
+    uint32_t pass_max_ms;      // Longest a passer-by stays in range
+} walk_t;
+
+typedef struct {
+    int true_positives;
+    int false_negatives;
+    int false_positives;
+    double latency_min;        // Mean time from a follower's arrival to its alert
+    uint32_t evictions;
+} walk_result_t;
+
+// Every sighting fed during a walk, replayed by the benchmark
+typedef struct {
+    tracker_sighting_t sighting;
+    uint8_t addr[6];
+    uint32_t now_ms;
+} walk_log_t;
+
+static walk_log_t *walk_log;
+static size_t walk_log_count;
+static size_t walk_log_cap;
+
+static void rotate(tag_t *tag, uint32_t *rng) {
+    for (int i = 0; i < 8; i++) {
+        tag->pid[i] = (uint8_t)test_rand(rng);
+    }
+    for (int i = 0; i < 6; i++) {
+        tag->addr[i] = (uint8_t)test_rand(rng);
+    }
+    tag->aging++;
+}
+
+static walk_result_t run_walk(const walk_t *w, uint32_t seed) {
+    static tracker_detector_t det;
+    int n = w->followers + w->passers;
+    tag_t *tags = calloc(n, sizeof(tag_t));
+    walk_result_t res = { 0 };
+    uint32_t rng = seed;
+
+    CHECK(tags != NULL);
+    tracker_detector_init(&det, w->dwell_ms);
+    for (int i = 0; i < n; i++) {
+        tag_t *t = &tags[i];
+        do {
+            t->type = (tracker_type_t)(test_rand(&rng) % TRACKER_TYPE_COUNT);
+        } while (!(w->types & (1u << t->type)));
+        for (int k = 0; k < 23; k++) {
+            t->key[k] = (uint8_t)test_rand(&rng);
+        }
+        t->aging = test_rand(&rng) & 0xFFFF;
+        rotate(t, &rng);
+        t->next_rotation_ms = test_rand(&rng) % (15 * MINUTE);
+        t->follower = i < w->followers;
+        if (t->follower) {
+            t->in_ms = test_rand(&rng) % MINUTE;
+            t->out_ms = w->duration_ms;
+        } else {
+            t->in_ms = test_rand(&rng) % w->duration_ms;
+            t->out_ms = t->in_ms + 30000 + test_rand(&rng) % (w->pass_max_ms - 30000);
+        }
+    }
+
+    for (uint32_t now = 0; now < w->duration_ms; now += 2000) {
+        for (int i = 0; i < n; i++) {
+            tag_t *t = &tags[i];
+            uint8_t d[31];
+            size_t len;
+            ble_adv_t adv;
+            tracker_sighting_t s;
+
+            if (now < t->in_ms || now >= t->out_ms) {
+                continue;
+            }
+            if (t->type == TRACKER_SMARTTAG && now >= t->next_rotation_ms) {
+                rotate(t, &rng);
+                t->next_rotation_ms = now + 15 * MINUTE;
+            }
+            if (test_rand(&rng) % 100 < w->loss_pct) {
+                continue;
+            }
+
+            if (t->type == TRACKER_FIND_MY) {
+                len = make_find_my(d, t->key);
+            } else if (t->type == TRACKER_SMARTTAG) {
+                len = make_smarttag(d, t->aging, t->pid);
+            } else {
+                len = make_tile(d);
+            }
+            CHECK(ble_adv_parse(d, len, &adv));
+
+            bool is_new, alerted;
+            tracker_alert_t alert;
+            CHECK(tracker_parse(&adv, t->addr, &s));
+            CHECK(s.type == t->type);
+            tracker_detector_update(&det, &s, t->addr, -60, now, &is_new, &alerted, &alert);
+
+            if (walk_log_count == walk_log_cap) {
+                walk_log_cap = walk_log_cap ? walk_log_cap * 2 : 65536;
+                walk_log = realloc(walk_log, walk_log_cap * sizeof(walk_log_t));
+                CHECK(walk_log != NULL);
+            }
+            walk_log[walk_log_count].sighting = s;
+            memcpy(walk_log[walk_log_count].addr, t->addr, 6);
+            walk_log[walk_log_count++].now_ms = now;
+
+            if (alerted && !t->alerted) {
+                t->alerted = true;
+                if (t->follower) {
+                    res.true_positives++;
+                    res.latency_min += (now - t->in_ms) / (double)MINUTE;
+                } else {
+                    res.false_positives++;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < w->followers; i++) {
+        res.false_negatives += !tags[i].alerted;
+    }
+    if (res.true_positives > 0) {
+        res.latency_min /= res.true_positives;
+    }
+    res.evictions = det.evictions;
+    free(tags);
+    return res;
+}
+
+static walk_result_t walk(const char *name, const walk_t *w) {
+    walk_log_count = 0;
+    walk_result_t r = run_walk(w, 0x1234567);
+    printf("    %-40s TP %d FN %d FP %2d, %4.1f min to alert, %5lu evictions\n", name,
+           r.true_positives, r.false_negatives, r.false_positives, r.latency_min, (unsigned long)r.evictions);
+    return r;
+}
+
+#define ALL_TYPES ((1u << TRACKER_FIND_MY) | (1u << TRACKER_TILE) | (1u << TRACKER_SMARTTAG))
+
+static void test_walk_clean_signal(void) {
+    walk_t w = { 1, 150, 60 * MINUTE, 0, 10 * MINUTE, ALL_TYPES, 4 * MINUTE };
+    walk_result_t r = walk("1 follower, 150 passers, no loss", &w);
+    CHECK(r.true_positives == 1 && r.false_positives == 0);
+    CHECK(r.latency_min >= 10.0 && r.latency_min < 11.0);
+}
+
+static void test_walk_lossy(void) {
+    walk_t w = { 3, 150, 60 * MINUTE, 50, 10 * MINUTE, ALL_TYPES, 4 * MINUTE };
+    walk_result_t r = walk("3 followers, 50% adverts lost", &w);
+    CHECK(r.true_positives == 3 && r.false_positives == 0);
+
+    w.loss_pct = 90;
+    r = walk("3 followers, 90% adverts lost", &w);
+    CHECK(r.true_positives == 3 && r.false_positives == 0);
+    CHECK(r.latency_min < 12.0);
+}
+
+static void test_walk_smarttags_rotating(void) {
+    walk_t w = { 4, 100, 60 * MINUTE, 30, 10 * MINUTE, 1u << TRACKER_SMARTTAG, 4 * MINUTE };
+    walk_result_t r = walk("4 SmartTag followers, IDs rotating", &w);
+    CHECK(r.true_positives == 4 && r.false_positives == 0);
+}
+
+static void test_walk_crowd(void) {
+    // Far more trackers than table slots: followers must survive the churn
+    walk_t w = { 2, 400, 60 * MINUTE, 30, 10 * MINUTE, ALL_TYPES, 8 * MINUTE };
+    walk_result_t r = walk("2 followers, crowd of 400", &w);
+    CHECK(r.true_positives == 2 && r.false_positives == 0);
+    CHECK(r.evictions > 0);
+}
+
+static void test_walk_cafe(void) {
+    // Passers-by that stay longer than the dwell time are reported; a
+    // longer dwell filters them out
+    walk_t w = { 2, 100, 60 * MINUTE, 30, 10 * MINUTE, ALL_TYPES, 15 * MINUTE };
+    walk_result_t r = walk("cafe, guests up to 15 min, dwell 10", &w);
+    CHECK(r.true_positives == 2 && r.false_positives > 0);
+
+    w.dwell_ms = 20 * MINUTE;
+    r = walk("cafe, guests up to 15 min, dwell 20", &w);
+    CHECK(r.true_positives == 2 && r.false_positives == 0);
+    CHECK(r.latency_min >= 20.0 && r.latency_min < 21.0);
+}
+
+static void bench_walk(void) {
+    static tracker_detector_t det;
+    walk_t w = { 4, 1000, 120 * MINUTE, 30, 10 * MINUTE, ALL_TYPES, 8 * MINUTE };
+    bool is_new, alerted;
+    tracker_alert_t alert;
+
+    walk_log_count = 0;
+    run_walk(&w, 99);
+    tracker_detector_init(&det, w.dwell_ms);
+    double start = test_seconds();
+    for (size_t i = 0; i < walk_log_count; i++) {
+        const walk_log_t *l = &walk_log[i];
+        tracker_detector_update(&det, &l->sighting, l->addr, -60, l->now_ms, &is_new, &alerted, &alert);
+    }
+    double secs = test_seconds() - start;
+    printf("  tracker_detector_update: %.1f ns/sighting over %zu sightings, 1004 tags (%zu bytes state)\n",
+           secs * 1e9 / walk_log_count, walk_log_count, sizeof(tracker_detector_t));
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_parse);
+    TEST_RUN(test_smarttag_rotation_and_dwell);
+    TEST_RUN(test_walk_clean_signal);
+    TEST_RUN(test_walk_lossy);
+    TEST_RUN(test_walk_smarttags_rotating);
+    TEST_RUN(test_walk_crowd);
+    TEST_RUN(test_walk_cafe);
+    if (test_bench_requested(argc, argv)) {
+        bench_walk();
+    }
+    free(walk_log);
+    return test_done("tracker_detector");
+}
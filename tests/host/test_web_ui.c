@@ -0,0 +1,256 @@
+#include "managers/web_ui.h"
+#include "test.h"
+#include <strings.h>
+
+// web_ui.c serving the table gen_web_assets.py builds from web/, with httpd
+// stubbed: each request goes straight to the registered handler and the
+// response it sends is kept for the test to look at.
+
+#define SERVER      ((httpd_handle_t)0x5e)
+#define MAX_URIS    16
+#define MAX_HEADERS 8
+
+static httpd_uri_t uris[MAX_URIS];
+static int uri_count;
+static int register_fails_at = -1;
+
+typedef struct {
+    const char *status;
+    const char *type;
+    const char *fields[MAX_HEADERS];
+    const char *values[MAX_HEADERS];
+    int header_count;
+    const char *body;
+    ssize_t len;
+    int sends;
+} response_t;
+
+static response_t resp;
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri) {
+    CHECK(handle == SERVER && uri->method == HTTP_GET && uri_count < MAX_URIS);
+    if (uri_count == register_fails_at) {
+        return ESP_ERR_NO_MEM;
+    }
+    uris[uri_count++] = *uri;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status) {
+    CHECK(resp.sends == 0);
+    resp.status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type) {
+    CHECK(resp.sends == 0);
+    resp.type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value) {
+    CHECK(resp.sends == 0 && resp.header_count < MAX_HEADERS);
+    resp.fields[resp.header_count] = field;
+    resp.values[resp.header_count] = value;
+    resp.header_count++;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len) {
+    resp.sends++;
+    resp.body = buf;
+    resp.len = len;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size) {
+    CHECK(strcmp(field, "If-None-Match") == 0);
+    if (req->if_none_match == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    snprintf(val, val_size, "%s", req->if_none_match);
+    return strlen(req->if_none_match) < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+// The value sent for a header, checking it was sent at most once
+static const char *header(const char *field) {
+    const char *value = NULL;
+    for (int i = 0; i < resp.header_count; i++) {
+        if (strcasecmp(resp.fields[i], field) == 0) {
+            CHECK(value == NULL);
+            value = resp.values[i];
+        }
+    }
+    return value;
+}
+
+static const web_asset_t *asset_at(int i) {
+    return uris[i].user_ctx;
+}
+
+// A GET of one registered URI, with If-None-Match when it is not NULL
+static void get(int i, const char *if_none_match) {
+    httpd_req_t req = {
+        .handle = SERVER,
+        .uri = uris[i].uri,
+        .user_ctx = uris[i].user_ctx,
+        .if_none_match = if_none_match,
+    };
+    memset(&resp, 0, sizeof(resp));
+    resp.status = "200 OK";             // What httpd sends unless told otherwise
+    CHECK(uris[i].handler(&req) == ESP_OK);
+    CHECK(resp.sends == 1);
+}
+
+static void check_full(int i) {
+    const web_asset_t *asset = asset_at(i);
+
+    CHECK(strcmp(resp.status, "200 OK") == 0);
+    CHECK(resp.type != NULL && strcmp(resp.type, asset->type) == 0);
+    CHECK(header("ETag") != NULL && strcmp(header("ETag"), asset->etag) == 0);
+    CHECK(header("Cache-Control") != NULL && strcmp(header("Cache-Control"), asset->cache_control) == 0);
+    CHECK(header("Content-Encoding") != NULL && strcmp(header("Content-Encoding"), "gzip") == 0);
+    CHECK(resp.body == (const char *)asset->data && resp.len == (ssize_t)asset->len);
+}
+
+static void check_not_modified(int i) {
+    const web_asset_t *asset = asset_at(i);
+
+    // The validators go out again, the body and its encoding do not
+    CHECK(strcmp(resp.status, "304 Not Modified") == 0);
+    CHECK(header("ETag") != NULL && strcmp(header("ETag"), asset->etag) == 0);
+    CHECK(header("Cache-Control") != NULL && strcmp(header("Cache-Control"), asset->cache_control) == 0);
+    CHECK(header("Content-Encoding") == NULL && resp.type == NULL);
+    CHECK(resp.body == NULL && resp.len == 0);
+}
+
+static void test_register(void) {
+    // A failed registration is returned and stops the rest
+    register_fails_at = 1;
+    CHECK(web_ui_register(SERVER) == ESP_ERR_NO_MEM && uri_count == 1);
+    uri_count = 0;
+    register_fails_at = -1;
+
+    CHECK(web_ui_register(SERVER) == ESP_OK && uri_count == 3);
+
+    // The page comes first and is always revalidated, the rest are named
+    // after their content and cached for good
+    CHECK(strcmp(uris[0].uri, "/") == 0);
+    CHECK(strcmp(asset_at(0)->type, "text/html") == 0 && strcmp(asset_at(0)->cache_control, "no-cache") == 0);
+    for (int i = 1; i < uri_count; i++) {
+        const web_asset_t *asset = asset_at(i);
+        const char *dot = strchr(asset->uri + 1, '.');
+        CHECK(dot != NULL && strspn(dot + 1, "0123456789abcdef") == 8 && dot[9] == '.');
+        CHECK(strcmp(uris[i].uri, asset->uri) == 0);
+        CHECK(strstr(asset->cache_control, "immutable") != NULL);
+    }
+    CHECK(strcmp(asset_at(1)->type, "text/css") == 0 && strcmp(asset_at(2)->type, "application/javascript") == 0);
+
+    // Every ETag is quoted and different
+    for (int i = 0; i < uri_count; i++) {
+        const char *etag = asset_at(i)->etag;
+        CHECK(strlen(etag) == 18 && etag[0] == '"' && etag[17] == '"');
+        for (int j = 0; j < i; j++) {
+            CHECK(strcmp(etag, asset_at(j)->etag) != 0);
+        }
+    }
+}
+
+static void test_full_response(void) {
+    for (int i = 0; i < uri_count; i++) {
+        const web_asset_t *asset = asset_at(i);
+
+        get(i, NULL);
+        check_full(i);
+
+        // What goes out is a gzip member with no timestamp, so the ETag
+        // holds from build to build, and it inflates to the original size
+        const uint8_t *d = asset->data;
+        CHECK(asset->len > 18 && d[0] == 0x1f && d[1] == 0x8b && d[2] == 8);
+        CHECK(d[4] == 0 && d[5] == 0 && d[6] == 0 && d[7] == 0);
+        const uint8_t *isize = d + asset->len - 4;
+        CHECK((uint32_t)(isize[0] | isize[1] << 8 | isize[2] << 16 | (uint32_t)isize[3] << 24) == asset->raw_len);
+        CHECK(asset->raw_len > 0);
+    }
+    printf("    %d assets, %u bytes gzip\n", uri_count,
+           (unsigned)(asset_at(0)->len + asset_at(1)->len + asset_at(2)->len));
+}
+
+static void test_not_modified(void) {
+    char list[256];
+
+    for (int i = 0; i < uri_count; i++) {
+        const char *etag = asset_at(i)->etag;
+
+        get(i, etag);
+        check_not_modified(i);
+
+        // Weak, in a list with others, or any
+        snprintf(list, sizeof(list), "W/%s", etag);
+        get(i, list);
+        check_not_modified(i);
+        snprintf(list, sizeof(list), "\"0123456789abcdef\", %s ,W/\"x\"", etag);
+        get(i, list);
+        check_not_modified(i);
+        get(i, "*");
+        check_not_modified(i);
+    }
+}
+
+static void test_stale(void) {
+    char etag[32];
+
+    for (int i = 0; i < uri_count; i++) {
+        // Another asset's tag, the same tag from another build, or one a
+        // character short
+        get(i, asset_at((i + 1) % uri_count)->etag);
+        check_full(i);
+
+        snprintf(etag, sizeof(etag), "%s", asset_at(i)->etag);
+        etag[16] = etag[16] == '0' ? '1' : '0';
+        get(i, etag);
+        check_full(i);
+
+        etag[16] = '"';
+        etag[17] = '\0';
+        get(i, etag);
+        check_full(i);
+
+        get(i, "");
+        check_full(i);
+    }
+
+    // A list too long for the handler's buffer is not searched, it gets
+    // the full response even if the tag is at the end
+    char list[256];
+    int n = 0;
+    while (n < 140) {
+        n += snprintf(list + n, sizeof(list) - n, "\"%08x\", ", n);
+    }
+    snprintf(list + n, sizeof(list) - n, "%s", asset_at(0)->etag);
+    get(0, list);
+    check_full(0);
+}
+
+static void test_etag_matches(void) {
+    CHECK(web_ui_etag_matches("\"a\"", "\"a\""));
+    CHECK(web_ui_etag_matches(" \t\"b\" , \"a\"\t", "\"a\""));
+    CHECK(web_ui_etag_matches("W/\"a\"", "\"a\""));
+    CHECK(web_ui_etag_matches("\"b\",*", "\"a\""));
+    CHECK(!web_ui_etag_matches("", "\"a\""));
+    CHECK(!web_ui_etag_matches(" , ,", "\"a\""));
+    CHECK(!web_ui_etag_matches("\"a", "\"a\""));
+    CHECK(!web_ui_etag_matches("\"a\"x", "\"a\""));
+    CHECK(!web_ui_etag_matches("\"*\"", "\"a\""));
+    CHECK(!web_ui_etag_matches("W/", "\"a\""));
+    CHECK(!web_ui_etag_matches("w/\"a\"", "\"a\""));
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_register);
+    TEST_RUN(test_full_response);
+    TEST_RUN(test_not_modified);
+    TEST_RUN(test_stale);
+    TEST_RUN(test_etag_matches);
+    return test_done("web_ui");
+}
@@ -0,0 +1,308 @@
+#include "core/wps_set.h"
+#include "test.h"
+
+typedef struct {
+    uint8_t data[400];
+    size_t len;
+} attrs_t;
+
+static void attr(attrs_t *a, uint16_t id, const void *value, size_t len) {
+    a->data[a->len++] = id >> 8;
+    a->data[a->len++] = id & 0xFF;
+    a->data[a->len++] = (uint8_t)(len >> 8);
+    a->data[a->len++] = (uint8_t)len;
+    memcpy(&a->data[a->len], value, len);
+    a->len += len;
+}
+
+static void attr_u8(attrs_t *a, uint16_t id, uint8_t value) {
+    attr(a, id, &value, 1);
+}
+
+// Beacon with some filler IEs and the WPS attributes split over vendor IEs
+// of at most split bytes each
+static size_t build_frame(uint8_t *frame, const uint8_t *bssid, const char *ssid, const attrs_t *wps, size_t split) {
+    size_t len = 36;
+
+    memset(frame, 0, 36);
+    frame[0] = 0x80;
+    memcpy(&frame[10], bssid, 6);
+    memcpy(&frame[16], bssid, 6);
+
+    frame[len++] = 0;
+    frame[len++] = (uint8_t)strlen(ssid);
+    memcpy(&frame[len], ssid, strlen(ssid));
+    len += strlen(ssid);
+    for (int i = 0; i < 6; i++) {
+        frame[len++] = (uint8_t)(45 + i);
+        frame[len++] = 4;
+        memset(&frame[len], i, 4);
+        len += 4;
+    }
+
+    for (size_t off = 0; wps != NULL && off < wps->len; off += split) {
+        size_t chunk = wps->len - off < split ? wps->len - off : split;
+        frame[len++] = 221;
+        frame[len++] = (uint8_t)(4 + chunk);
+        memcpy(&frame[len], "\x00\x50\xF2\x04", 4);
+        memcpy(&frame[len + 4], &wps->data[off], chunk);
+        len += 4 + chunk;
+    }
+    return len;
+}
+
+static void wps1_attrs(attrs_t *a) {
+    memset(a, 0, sizeof(*a));
+    attr_u8(a, 0x104A, 0x10);
+    attr_u8(a, 0x1044, WPS_STATE_CONFIGURED);
+    attr_u8(a, 0x1057, 1);
+    attr(a, 0x1008, "\x00\x8C", 2);                     // Display, keypad, PBC
+    attr(a, 0x1021, "Netgear", 7);
+    attr(a, 0x1011, "Router\x01", 7);
+    attr(a, 0x1023, "R7000", 5);
+    attr(a, 0x1024, "V1.0.9", 6);
+}
+
+// What WPS 2.0 APs send: 0x10 in Version, the real version in the WFA
+// vendor extension, after other subelements
+static void wps2_attrs(attrs_t *a) {
+    memset(a, 0, sizeof(*a));
+    attr_u8(a, 0x104A, 0x10);
+    attr_u8(a, 0x1044, WPS_STATE_CONFIGURED);
+    attr(a, 0x1008, "\x00\x80", 2);
+    attr(a, 0x1049, "\x00\x37\x2A" "\x01\x06\xFF\xFF\xFF\xFF\xFF\xFF" "\x00\x01\x20", 3 + 8 + 3);
+    attr(a, 0x1011, "Home AP", 7);
+}
+
+static void test_parse_wps1(void) {
+    uint8_t frame[512];
+    uint8_t bssid[6] = { 0xC0, 0xFF, 0xEE, 0, 0, 1 };
+    wps_network_t n;
+    attrs_t a;
+
+    wps1_attrs(&a);
+    CHECK(wps_parse_frame(frame, build_frame(frame, bssid, "Office", &a, 250), &n));
+    CHECK(strcmp(n.ssid, "Office") == 0 && memcmp(n.bssid, bssid, 6) == 0);
+    CHECK(n.wps_enabled && n.wps_mode == WPS_MODE_PIN);
+    CHECK(n.config_methods == 0x008C && n.version == 0x10);
+    CHECK(n.state == WPS_STATE_CONFIGURED && n.locked);
+    CHECK(strcmp(n.manufacturer, "Netgear") == 0);
+    CHECK(strcmp(n.device_name, "Router?") == 0);       // Unprintable bytes are masked
+    CHECK(strcmp(n.model_name, "R7000") == 0 && strcmp(n.model_number, "V1.0.9") == 0);
+
+    // Same attributes fragmented over many vendor IEs
+    wps_network_t split;
+    CHECK(wps_parse_frame(frame, build_frame(frame, bssid, "Office", &a, 5), &split));
+    CHECK(memcmp(&n, &split, sizeof(n)) == 0);
+
+    CHECK(!wps_parse_frame(frame, build_frame(frame, bssid, "Office", NULL, 1), &n));
+}
+
+static void test_parse_version2(void) {
+    uint8_t frame[512];
+    uint8_t bssid[6] = { 0xC0, 0xFF, 0xEE, 0, 0, 2 };
+    wps_network_t n;
+    attrs_t a;
+
+    wps2_attrs(&a);
+    CHECK(wps_parse_frame(frame, build_frame(frame, bssid, "Home", &a, 250), &n));
+    CHECK(n.version == 0x20);
+    CHECK(n.wps_mode == WPS_MODE_PBC && !n.locked);
+    CHECK(strcmp(n.device_name, "Home AP") == 0);
+
+    // Vendor extension before Version, and split across IEs
+    memset(&a, 0, sizeof(a));
+    attr(&a, 0x1049, "\x00\x37\x2A\x00\x01\x20", 6);
+    attr_u8(&a, 0x104A, 0x10);
+    CHECK(wps_parse_frame(frame, build_frame(frame, bssid, "Home", &a, 3), &n));
+    CHECK(n.version == 0x20);
+
+    // Extensions from other vendors and malformed subelements leave 0x104A
+    static const struct {
+        const char *ext;
+        size_t len;
+    } ignored[] = {
+        { "\x00\x10\x18\x00\x01\x20", 6 },             // Not the WFA vendor id
+        { "\x00\x37\x2A\x00\x02\x20\x00", 7 },         // Version2 must be one byte
+        { "\x00\x37\x2A\x01\x09\x00\x01\x20", 8 },     // Subelement overruns the attribute
+        { "\x00\x37", 2 },
+    };
+    for (size_t i = 0; i < sizeof(ignored) / sizeof(ignored[0]); i++) {
+        memset(&a, 0, sizeof(a));
+        attr_u8(&a, 0x104A, 0x10);
+        attr(&a, 0x1049, ignored[i].ext, ignored[i].len);
+        CHECK(wps_parse_frame(frame, build_frame(frame, bssid, "Home", &a, 250), &n));
+        CHECK(n.version == 0x10);
+    }
+}
+
+static void test_parse_malformed(void) {
+    uint8_t frame[4096];
+    uint8_t bssid[6] = { 1, 2, 3, 4, 5, 6 };
+    wps_network_t n;
+    attrs_t a;
+
+    wps2_attrs(&a);
+    size_t len = build_frame(frame, bssid, "Home", &a, 250);
+    for (size_t cut = 0; cut < len; cut++) {
+        uint8_t *copy = malloc(cut ? cut : 1);
+        memcpy(copy, frame, cut);
+        wps_parse_frame(copy, cut, &n);
+        free(copy);
+    }
+
+    // Attribute lengths that overrun the data stop the walk
+    memset(&a, 0, sizeof(a));
+    attr_u8(&a, 0x104A, 0x10);
+    attr(&a, 0x1011, "Router", 6);
+    a.data[a.len - 6 - 1] = 200;
+    CHECK(wps_parse_frame(frame, build_frame(frame, bssid, "Home", &a, 250), &n));
+    CHECK(n.version == 0x10 && n.device_name[0] == '\0');
+
+    uint32_t rng = 5;
+    for (int round = 0; round < 20000; round++) {
+        memset(&a, 0, sizeof(a));
+        a.len = test_rand(&rng) % 300;
+        for (size_t i = 0; i < a.len; i++) {
+            a.data[i] = (uint8_t)test_rand(&rng);
+        }
+        if (wps_parse_frame(frame, build_frame(frame, bssid, "x", &a, 1 + test_rand(&rng) % 250), &n)) {
+            CHECK(strlen(n.manufacturer) < WPS_STRING_LEN && strlen(n.device_name) < WPS_STRING_LEN);
+        }
+    }
+}
+
+static void make_bssid(uint8_t *bssid, uint32_t i) {
+    bssid[0] = 0x10;
+    bssid[1] = 0x20;
+    bssid[2] = 0x30;
+    bssid[3] = (uint8_t)(i >> 16);
+    bssid[4] = (uint8_t)(i >> 8);
+    bssid[5] = (uint8_t)i;
+}
+
+static void test_set(void) {
+    wps_set_t set;
+    uint8_t bssid[6];
+    bool is_new;
+
+    CHECK(!wps_set_init(&set, 0));
+    CHECK(!wps_set_init(&set, WPS_SET_MAX_CAPACITY + 1));
+    CHECK(wps_set_insert(&set, bssid, &is_new) == NULL);
+
+    CHECK(wps_set_init(&set, 15));
+    for (uint32_t i = 0; i < 20; i++) {
+        make_bssid(bssid, i);
+        wps_network_t *n = wps_set_insert(&set, bssid, &is_new);
+        CHECK((n != NULL) == (i < 15));
+        CHECK(is_new == (i < 15));
+        if (n != NULL) {
+            snprintf(n->ssid, sizeof(n->ssid), "net%u", i);
+        }
+    }
+    CHECK(set.count == 15 && set.dropped == 5);
+    for (uint32_t i = 0; i < 20; i++) {
+        make_bssid(bssid, i);
+        wps_network_t *n = wps_set_find(&set, bssid);
+        CHECK((n != NULL) == (i < 15));
+        CHECK(wps_set_insert(&set, bssid, &is_new) == n && !is_new);
+    }
+    make_bssid(bssid, 3);
+    CHECK(strcmp(wps_set_find(&set, bssid)->ssid, "net3") == 0);
+
+    wps_set_clear(&set);
+    CHECK(set.count == 0 && wps_set_find(&set, bssid) == NULL);
+    CHECK(wps_set_insert(&set, bssid, &is_new) != NULL && is_new);
+    wps_set_free(&set);
+
+    CHECK(wps_set_init(&set, WPS_SET_MAX_CAPACITY));
+    for (uint32_t i = 0; i < WPS_SET_MAX_CAPACITY; i++) {
+        make_bssid(bssid, i * 7919);
+        CHECK(wps_set_insert(&set, bssid, &is_new) != NULL && is_new);
+    }
+    for (uint32_t i = 0; i < WPS_SET_MAX_CAPACITY; i++) {
+        make_bssid(bssid, i * 7919);
+        CHECK(wps_set_find(&set, bssid) == &set.networks[i]);
+    }
+    wps_set_free(&set);
+}
+
+// The list this replaced: a strcmp over every recorded network, once per IE
+typedef struct {
+    char ssid[33];
+    uint8_t bssid[6];
+} linear_entry_t;
+
+static bool linear_seen(const linear_entry_t *list, uint32_t count, const char *ssid, const uint8_t *bssid) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(list[i].ssid, ssid) == 0 && memcmp(list[i].bssid, bssid, 6) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void bench_sizes(void) {
+    static const uint32_t sizes[] = { 15, 1000 };
+    static linear_entry_t list[1000];
+    const uint32_t lookups = 2000000;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t n = sizes[s];
+        wps_set_t set;
+        uint8_t bssid[6];
+        bool is_new;
+        uint32_t hits = 0;
+
+        CHECK(wps_set_init(&set, n));
+        for (uint32_t i = 0; i < n; i++) {
+            make_bssid(bssid, i);
+            wps_set_insert(&set, bssid, &is_new);
+            memcpy(list[i].bssid, bssid, 6);
+            snprintf(list[i].ssid, sizeof(list[i].ssid), "network-%u", i);
+        }
+
+        double start = test_seconds();
+        for (uint32_t k = 0; k < lookups; k++) {
+            make_bssid(bssid, (k * 2654435761u) % n);
+            hits += wps_set_find(&set, bssid) != NULL;
+        }
+        double hashed = (test_seconds() - start) * 1e9 / lookups;
+
+        uint32_t linear_lookups = lookups / (n > 100 ? 100 : 1);
+        start = test_seconds();
+        for (uint32_t k = 0; k < linear_lookups; k++) {
+            uint32_t i = (k * 2654435761u) % n;
+            hits += linear_seen(list, n, list[i].ssid, list[i].bssid);
+        }
+        double linear = (test_seconds() - start) * 1e9 / linear_lookups;
+
+        CHECK(hits == lookups + linear_lookups);
+        printf("  %4u networks: hashed %.1f ns/lookup, linear strcmp %.1f ns/lookup\n", n, hashed, linear);
+        wps_set_free(&set);
+    }
+
+    uint8_t frame[512];
+    uint8_t bssid[6] = { 1, 2, 3, 4, 5, 6 };
+    wps_network_t parsed;
+    attrs_t a;
+    wps2_attrs(&a);
+    size_t len = build_frame(frame, bssid, "Home", &a, 250);
+    double start = test_seconds();
+    for (uint32_t k = 0; k < lookups; k++) {
+        frame[21] = (uint8_t)k;
+        wps_parse_frame(frame, len, &parsed);
+    }
+    printf("  wps_parse_frame: %.1f ns/beacon\n", (test_seconds() - start) * 1e9 / lookups);
+}
+
+int main(int argc, char **argv) {
+    TEST_RUN(test_parse_wps1);
+    TEST_RUN(test_parse_version2);
+    TEST_RUN(test_parse_malformed);
+    TEST_RUN(test_set);
+    if (test_bench_requested(argc, argv)) {
+        bench_sizes();
+    }
+    return test_done("wps_set");
+}
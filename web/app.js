@@ -0,0 +1,340 @@
+// Function to handle tab switching
+function openTab(evt, tabName) {
+    var i, tabcontent, tablinks;
+    tabcontent = document.getElementsByClassName("tabcontent");
+    for (i = 0; i < tabcontent.length; i++) {
+        tabcontent[i].classList.remove("show");
+    }
+    tablinks = document.getElementsByClassName("tablinks");
+    for (i = 0; i < tablinks.length; i++) {
+        tablinks[i].classList.remove("active");
+    }
+    document.getElementById(tabName).classList.add("show");
+    evt.currentTarget.classList.add("active");
+}
+// Set the default tab to open on page load
+document.getElementById("defaultTab").click();
+
+// Live logs: one Server-Sent Events stream, opened the first time the Console
+// tab is shown. EventSource reconnects by itself and resumes after the last
+// line it got, so nothing is fetched twice.
+const MAX_LOG_LINES = 500;
+let logStream = null;
+
+function appendLog(text) {
+    const consoleDiv = document.getElementById('console');
+    const atBottom = consoleDiv.scrollTop + consoleDiv.clientHeight >= consoleDiv.scrollHeight - 5;
+    const line = document.createElement('div');
+    line.textContent = text;
+    consoleDiv.appendChild(line);
+    while (consoleDiv.childElementCount > MAX_LOG_LINES) {
+        consoleDiv.removeChild(consoleDiv.firstChild);
+    }
+    if (atBottom) {
+        consoleDiv.scrollTop = consoleDiv.scrollHeight;
+    }
+}
+
+function startLogStream() {
+    if (logStream) {
+        return;
+    }
+    logStream = new EventSource('/api/logs');
+    logStream.onmessage = event => appendLog(event.data);
+    logStream.addEventListener('missed', event => appendLog('[' + event.data + ' lines missed]'));
+}
+
+// Function to load current settings from the ESP32
+function loadSettings() {
+    fetch('/api/settings')
+    .then(response => response.json())
+    .then(data => {
+        // WiFi/BLE Settings
+        document.getElementById('broadcast_speed').value = data.broadcast_speed;
+        document.getElementById('ap_ssid').value = data.ap_ssid;
+        document.getElementById('ap_password').value = data.ap_password;
+
+        // RGB Settings
+        document.getElementById('rainbow_mode').checked = data.rainbow_mode;
+        document.getElementById('rgb_speed').value = data.rgb_speed;
+
+        // Evil Portal Settings
+        document.getElementById('portal_url').value = data.portal_url;
+        document.getElementById('portal_ssid').value = data.portal_ssid;
+        document.getElementById('portal_password').value = data.portal_password;
+        document.getElementById('portal_ap_ssid').value = data.portal_ap_ssid;
+        document.getElementById('portal_domain').value = data.portal_domain;
+        document.getElementById('portal_offline_mode').checked = data.portal_offline_mode;
+
+        // Power Printer Settings
+        document.getElementById('printer_ip').value = data.printer_ip;
+        document.getElementById('printer_text').value = data.printer_text;
+        document.getElementById('printer_font_size').value = data.printer_font_size;
+        document.getElementById('printer_alignment').value = data.printer_alignment;
+
+
+        if (data.station_ip) {
+            document.getElementById('station_ip').value = data.station_ip;
+        } else {
+            document.getElementById('station_ip').value = 'Not connected';
+        }
+
+    })
+    .catch(error => console.error('Error fetching settings:', error));
+}
+
+// Function to save settings to the ESP32
+function saveSettings() {
+    let settings = {
+        // WiFi/BLE Settings
+        broadcast_speed: parseInt(document.getElementById('broadcast_speed').value),
+        ap_ssid: document.getElementById('ap_ssid').value.trim(),
+        ap_password: document.getElementById('ap_password').value.trim(),
+
+        // RGB Settings
+        rainbow_mode: document.getElementById('rainbow_mode').checked,
+        rgb_speed: parseInt(document.getElementById('rgb_speed').value),
+
+        // Evil Portal Settings
+        portal_url: document.getElementById('portal_url').value.trim(),
+        portal_ssid: document.getElementById('portal_ssid').value.trim(),
+        portal_password: document.getElementById('portal_password').value.trim(),
+        portal_ap_ssid: document.getElementById('portal_ap_ssid').value.trim(),
+        portal_domain: document.getElementById('portal_domain').value.trim(),
+        portal_offline_mode: document.getElementById('portal_offline_mode').checked,
+
+        // Power Printer Settings
+        printer_ip: document.getElementById('printer_ip').value.trim(),
+        printer_text: document.getElementById('printer_text').value.trim(),
+        printer_font_size: parseInt(document.getElementById('printer_font_size').value),
+        printer_alignment: parseInt(document.getElementById('printer_alignment').value),
+    };
+
+    fetch('/api/settings', {
+        method: 'POST',
+        headers: {'Content-Type': 'application/json'},
+        body: JSON.stringify(settings)
+    })
+    .then(response => {
+        if (response.ok) {
+            alert('Settings saved successfully!');
+        } else {
+            alert('Error saving settings.');
+        }
+    })
+    .catch(error => console.error('Error saving settings:', error));
+}
+
+// Function to send command to the ESP32
+function sendCommand() {
+    let command = document.getElementById('commandInput').value.trim();
+    if (command === '') {
+        alert('Please enter a command.');
+        return;
+    }
+    fetch('/api/command', {
+        method: 'POST',
+        headers: {'Content-Type': 'application/json'},
+        body: JSON.stringify({ command: command })
+    })
+    .then(response => {
+        if (response.ok) {
+            document.getElementById('commandInput').value = '';
+            alert('Command sent successfully!');
+        } else {
+            alert('Error sending command.');
+        }
+    })
+    .catch(error => console.error('Error sending command:', error));
+}
+
+
+function startevilportal() {
+    const PortalURL = document.getElementById('portal_url').value;
+    let PortalSSID = document.getElementById('portal_ssid').value;
+    let PortalPassword = document.getElementById('portal_password').value;
+    let PortalAPSSID = document.getElementById('portal_ap_ssid').value;
+    let PortalDomain = document.getElementById('portal_domain').value;
+
+    // Validate inputs
+    if (PortalURL === '') {
+        alert('Please enter a Portal URL or File Path.');
+        return;
+    }
+    if (PortalSSID === '') {
+        alert('Please enter a Portal SSID');
+        return;
+    }
+
+    if (PortalPassword === '') {
+        alert('Please enter a Valid Portal Password');
+        return;
+    }
+
+    if (PortalAPSSID === '') {
+        alert('Please enter a Valid Portal AP SSID');
+        return;
+    }
+
+    if (PortalDomain === '') {
+        alert('Please enter a Valid Portal Domain');
+        return;
+    }
+
+    // Wrap parameters in double quotes if they contain spaces
+    if (PortalSSID.includes(' ')) {
+        PortalSSID = `"${PortalSSID}"`;
+    }
+    if (PortalPassword.includes(' ')) {
+        PortalPassword = `"${PortalPassword}"`;
+    }
+    if (PortalAPSSID.includes(' ')) {
+        PortalAPSSID = `"${PortalAPSSID}"`;
+    }
+    if (PortalDomain.includes(' ')) {
+        PortalDomain = `"${PortalDomain}"`;
+    }
+
+    const command = `startportal ${PortalURL} ${PortalSSID} ${PortalPassword} ${PortalAPSSID} ${PortalDomain}`;
+
+    fetch('/api/command', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify({ command: command })
+    })
+    .then(response => {
+        if (response.ok) {
+            alert('Evil Portal Executed Successfully... You Are now Disconnected From GhostNet');
+        } else {
+            alert('Error Sending Evil Portal Command...');
+        }
+    })
+    .catch(error => console.error('Error Sending Evil Portal Command...', error));
+}
+
+
+function sendtoprinter() {
+    const printerip = document.getElementById('printer_ip').value;
+    const printertext = document.getElementById('printer_text').value;
+    const fontsize = document.getElementById('printer_font_size').value;
+    let finalprintertext = printertext;
+
+    // Validate inputs
+    if (printerip === '') {
+        alert('Please enter a Printer IP.');
+        return;
+    }
+    if (printertext === '') {
+        alert('Please enter a Text to Send to Printer');
+        return;
+    }
+
+    if (fontsize === '') {
+        alert('Please enter a Valid Font Size');
+        return;
+    }
+
+    if (printertext.includes(' ')) {
+        finalprintertext = `"${printertext}"`;
+    }
+
+    const command = `powerprinter ${printerip} ${finalprintertext} ${fontsize} CM`;
+
+    fetch('/api/command', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify({ command: command })
+    })
+    .then(response => {
+        if (response.ok) {
+            alert('Printer connection command sent successfully!');
+
+            setTimeout(function() {
+                loadSettings();
+            }, 3000);
+        } else {
+            alert('Error sending Printer connection command.');
+        }
+    })
+    .catch(error => console.error('Error sending Printer connection command:', error));
+}
+
+
+function connectToWiFi() {
+    const ssid = document.getElementById('wifi_ssid').value;
+    const password = document.getElementById('wifi_password').value;
+    let finalssid = ssid;
+    let finalpassword = password;
+
+    // Validate inputs
+    if (ssid === '') {
+        alert('Please enter a WiFi SSID.');
+        return;
+    }
+    if (password === '') {
+        alert('Please enter a WiFi password.');
+        return;
+    }
+
+    if (ssid.includes(' ')) {
+        finalssid = `"${ssid}"`;
+    }
+
+    if (password.includes(' ')) {
+        finalpassword = `"${password}"`;
+    }
+
+
+    const command = `connect ${finalssid} ${finalpassword}`;
+
+
+    fetch('/api/command', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify({ command: command })
+    })
+    .then(response => {
+        if (response.ok) {
+            alert('WiFi connection command sent successfully!');
+
+            setTimeout(function() {
+                loadSettings();
+            }, 3000);
+        } else {
+            alert('Error sending WiFi connection command.');
+        }
+    })
+    .catch(error => console.error('Error sending WiFi connection command:', error));
+}
+
+
+window.onload = function() {
+    loadSettings();
+};
+
+
+function toggleSection(sectionId, disabled) {
+    const section = document.getElementById(sectionId);
+    if (disabled) {
+        section.classList.add('disabled-section');
+
+        if (!section.querySelector('.disabled-overlay')) {
+            const overlay = document.createElement('div');
+            overlay.className = 'disabled-overlay';
+            overlay.textContent = 'Feature Under Maintenance';
+            section.appendChild(overlay);
+        }
+    } else {
+        section.classList.remove('disabled-section');
+
+        const overlay = section.querySelector('.disabled-overlay');
+        if (overlay) {
+            overlay.remove();
+        }
+    }
+}
+
+
+// Example: Toggling a section (uncomment to use)
+// toggleSection('connect-wifi-section', true); // Disable
+toggleSection('connect-wifi-section', false); // Enable